@@ -318,6 +318,22 @@ namespace Cubiquity
 			::validate(cuAcceptOverrideChunks(m_volumeHandle));
 		}
 
+		/**
+		 * As acceptOverrideChunks() but without throwing, so a failed commit can be reported rather than unwinding the caller
+		 * \return an empty string on success, or the error
+		 */
+		std::string tryAcceptOverrideChunks()
+		{
+			const int32_t returnCode = cuAcceptOverrideChunks(m_volumeHandle);
+			if (returnCode != CU_OK)
+			{
+				std::stringstream ss;
+				ss << cuGetErrorCodeAsString(returnCode) << " : " << cuGetLastErrorMessage();
+				return ss.str();
+			}
+			return std::string();
+		}
+
 		void discardOverrideChunks()
 		{
 			::validate(cuDiscardOverrideChunks(m_volumeHandle));
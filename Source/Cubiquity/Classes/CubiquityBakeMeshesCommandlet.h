@@ -0,0 +1,27 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "CubiquityBakeMeshesCommandlet.generated.h"
+
+/**
+ * Converts the meshes of every octree node of a volume, at every LOD, and writes them to a baked mesh archive.
+ *
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquityBakeMeshes -Volume=Path/To.vdb -Type=ColoredCubes|Terrain [-Output=Path/To.meshes] [-BaseNodeSize=32] [-Greedy] [-Compact] [-Optimise]
+ *
+ * The switches must match the settings of the volume actor which will use the archive or none of its entries will be found.
+ * The archive is only used with the revision of the volume it was baked from, so bake it again after committing changes.
+ */
+UCLASS()
+class UCubiquityBakeMeshesCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityBakeMeshesCommandlet(const FObjectInitializer& PCIP);
+
+	virtual int32 Main(const FString& Params) override;
+};
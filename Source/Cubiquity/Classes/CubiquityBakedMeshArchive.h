@@ -0,0 +1,115 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include <memory>
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityMeshData.h"
+
+/**
+ * Which state of a voxel database something was made from. Voxel databases are SQLite files, whose header has a counter
+ * which every write transaction moves on, so committing changes to a volume gives it a new revision.
+ */
+struct FCubiquityVolumeRevision
+{
+	int64 bytes = -1; ///< The size of the file, -1 if it couldn't be read
+	uint32 changeCounter = 0; ///< 0 for a file which isn't a SQLite database
+
+	/** The revision of the database as it is on disk now */
+	static FCubiquityVolumeRevision of(const FString& volumeFileName);
+
+	bool isValid() const { return bytes >= 0; }
+
+	bool operator==(const FCubiquityVolumeRevision& other) const { return bytes == other.bytes && changeCounter == other.changeCounter; }
+	bool operator!=(const FCubiquityVolumeRevision& other) const { return !(*this == other); }
+};
+
+/**
+ * A single file holding converted meshes for every node of a volume across its whole LOD range.
+ * These are written by the CubiquityBakeMeshes commandlet so that shipping builds don't have to convert meshes at runtime.
+ *
+ * Nodes are looked up by their position and LOD rather than by mesh key, so a baked node skips extracting and hashing
+ * its mesh as well as converting it. That only holds for the database and base node size the archive was baked from,
+ * which are in its header, and open() turns the archive down for any other. Edits since the volume was opened aren't in
+ * the database yet, so the volume doesn't ask for nodes over edited voxels.
+ *
+ * The file is a header, an index of {key, offset, size} sorted by key, an index of {position, LOD, entry} for the nodes,
+ * and then the entries themselves, each starting on an EntryAlignment boundary and in the same format as the disk cache.
+ * Nodes with identical meshes share an entry, whose key lets them share the mesh with nodes converted as normal.
+ */
+class FCubiquityBakedMeshArchive
+{
+public:
+
+	enum { EntryAlignment = 16 };
+
+	/** A node which was baked, and the mesh it had */
+	struct FBakedNode
+	{
+		FIntVector position;
+		uint32 height;
+		FCubiquityMeshKey key;
+	};
+
+	/**
+	 * Write an archive of the given meshes and the nodes which had them, replacing any existing file
+	 * \param conversionFlags FCubiquityConversionSettings::flags() of the settings the meshes were converted with
+	 */
+	static bool write(const FString& path, const FCubiquityVolumeRevision& revision, uint32 baseNodeSize, uint32 conversionFlags,
+		const TArray<FBakedNode>& nodes, const TArray<TSharedPtr<FCubiquityMeshData>>& meshes);
+
+	/**
+	 * Read the indices of an archive. The entries are read as they are asked for.
+	 * \return false, having logged why, if it isn't an archive or it was baked from another revision or base node size
+	 */
+	bool open(const FString& path, const FCubiquityVolumeRevision& revision, uint32 baseNodeSize);
+
+	bool isOpen() const { return reader != nullptr; }
+
+	int32 numEntries() const { return index.Num(); }
+
+	int32 numNodes() const { return nodes.Num(); }
+
+	/**
+	 * The key of the mesh baked for a node, found by where the node is without touching its mesh
+	 * \return false if the node wasn't baked, or was baked with other conversion settings
+	 */
+	bool find(const Cubiquity::OctreeNode& octreeNode, uint32 conversionFlags, FCubiquityMeshKey& outKey) const;
+
+	/**
+	 * Fill in the mesh data for `key` from the archive
+	 * \return false if the archive has no valid entry for it
+	 */
+	bool load(const FCubiquityMeshKey& key, FCubiquityMeshData& outMeshData);
+
+private:
+
+	struct FIndexEntry
+	{
+		uint64 offset;
+		uint32 size;
+	};
+
+	struct FNodeKey
+	{
+		FIntVector position;
+		uint32 height;
+
+		bool operator==(const FNodeKey& other) const { return position == other.position && height == other.height; }
+
+		friend uint32 GetTypeHash(const FNodeKey& key) { return HashCombine(GetTypeHash(key.position), key.height); }
+	};
+
+	uint32 conversionFlags = 0;
+
+	TMap<FCubiquityMeshKey, FIndexEntry> index;
+
+	TMap<FNodeKey, FCubiquityMeshKey> nodes;
+
+	std::unique_ptr<FArchive> reader;
+
+	//Reused between loads so that reading an entry doesn't allocate
+	TArray<uint8> scratch;
+};
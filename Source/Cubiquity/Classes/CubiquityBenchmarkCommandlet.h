@@ -0,0 +1,53 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "CubiquityBenchmarkCommandlet.generated.h"
+
+/**
+ * Measures the voxel sync pipeline without an editor session or a GPU.
+ *
+ * A volume is opened, or a synthetic one is generated, and then edited while a moving eye drives Cubiquity's LOD.
+ * Each frame the octree is walked the way the octree node actors walk it and every changed node goes through
+ * the same key, conversion and collision staging code the mesh components use. Timings and throughput are written as JSON.
+ *
+ * With -CheckpointEvery=N a checkpoint is made every N frames of a synthetic volume's edits, then the middle and first
+ * checkpoints are restored so the cost of saving chunks, their compressed size and restore times are measured too.
+ *
+ * With -BrushWindow=N a terrain volume's brushes are queued and merged as ACubiquityVolume::coalesceBrushes does, and
+ * applied every N frames, with what's left applied on the last frame. The brushes section reports the meshes converted
+ * as measured, and comparing that with a run without -BrushWindow shows the re-meshes merging saves.
+ *
+ * For colored cubes every node mesh left at the end of the run is also converted with and without greedy meshing, and the
+ * triangle counts and conversion times of both go in greedy_meshing.
+ *
+ * With -DiskCache the final state of the volume is synced from nothing with an empty mesh disk cache and then again with
+ * the cache the first sync filled, limited to -DiskCacheMegabytes. The cold and warm times go in disk_cache.
+ *
+ * -SyncsPerFrame=N holds each branch of the walk to N node syncs a frame, -FastLane=N lets up to N drawn nodes over recent
+ * edits sync on top of that, and -CoarseNodeSyncsPerSecond=N paces the meshes of hidden coarse nodes. The defaults are a
+ * volume's, and 0 syncs everything, turns the fast lane off or turns lazy coarse nodes off. edit_to_visible is how long
+ * edits took to show and edit_to_synced how long until every node over them had caught up. Edits still waiting at the
+ * end are counted, not timed.
+ *
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquityBenchmark -nullrhi [-Volume=Path/To.vdb] [-Type=ColoredCubes|Terrain]
+ *     [-Size=128] [-Height=32] [-Frames=300] [-Edits=1] [-Pattern=Scatter|Dig|Wall] [-Seed=0] [-BaseNodeSize=32] [-Greedy] [-Compact]
+ *     [-LodThreshold=1.0] [-CheckpointEvery=0] [-BrushWindow=0]
+ *     [-SyncsPerFrame=1] [-FastLane=16] [-CoarseNodeSyncsPerSecond=10] [-DiskCache] [-DiskCacheMegabytes=512] [-Output=Path/To.json]
+ *
+ * The run itself is FCubiquityBenchmarkRun, which Tools/CubiquityBenchmark also builds as a standalone program against a
+ * stand-in for the library, so the pipeline can be timed and tested without the editor or the Windows DLL.
+ */
+UCLASS()
+class UCubiquityBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityBenchmarkCommandlet(const FObjectInitializer& PCIP);
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,140 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include <memory>
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityEditLatency.h"
+#include "CubiquityMeshConverter.h"
+#include "CubiquitySyncSimulator.h"
+
+/** The switches UCubiquityBenchmarkCommandlet and the standalone benchmark both take */
+struct FCubiquityBenchmarkOptions
+{
+	FString typeName = TEXT("ColoredCubes");
+	FString volumeFileName; ///< Empty for a synthetic volume
+	FString pattern = TEXT("Scatter");
+	FString outputFileName;
+	int32 size = 128;
+	int32 height = 32;
+	int32 frames = 300;
+	int32 editsPerFrame = 1;
+	int32 seed = 0;
+	int32 baseNodeSize = 32;
+	float lodThreshold = 1.0f;
+	int32 syncsPerFrame = 1; ///< Each branch's allowance, 1 as the volume has it. 0 syncs everything.
+	int32 fastLaneSyncs = 16; ///< As ACubiquityVolume::editFastLaneSyncs
+	float coarseNodeSyncsPerSecond = 10.0f; ///< As ACubiquityVolume::coarseNodeSyncsPerSecond. 0 turns lazyCoarseNodes off.
+	int32 diskCacheMegabytes = 512;
+	bool measureDiskCache = false;
+	bool greedyMeshing = false;
+	bool compactFaceStorage = false;
+
+	/** The switches read by parse(), for FCubiquityCommandletSwitches::validate() */
+	static TArray<const TCHAR*> switches();
+
+	/** Read the switches. Anything not given keeps its default. */
+	void parse(const FString& params);
+
+	bool synthetic() const { return volumeFileName.IsEmpty(); }
+};
+
+/**
+ * One run of the benchmark, shared by UCubiquityBenchmarkCommandlet and Tools/CubiquityBenchmark so the two can't drift
+ * apart. The volume is opened or generated, edited while a circling eye drives the LOD and synced each frame through
+ * FCubiquitySyncSimulator. The final state is then converted with and without greedy meshing and, with -DiskCache, synced
+ * cold and warm through a mesh disk cache. writeResults() puts it all in the JSON report.
+ *
+ * The simulator is set up as a volume's defaults set it up, with the same sync allowance, edit fast lane and lazy coarse
+ * nodes, so the latencies are those of the configuration the report names. The coarse node allowance builds up with a
+ * clock which ticks a 60th of a second a frame, whatever the frames really took.
+ *
+ * Two latencies are timed for each edit through FCubiquityEditLatency. edit_to_visible ends once the drawn nodes over the
+ * edit show it, and edit_to_synced once every node over it, drawn or not, has caught up. Edits still waiting when the run
+ * ends are counted in the report rather than timed.
+ *
+ * open_seconds is the database open alone, apart from generating a synthetic volume. For an existing volume that is the
+ * stall ACubiquityVolume makes on the game thread to open it, as the library can only be called from there.
+ *
+ * buffer_pool counts the mesh buffer pool's misses over the frames, each of which went to the allocator.
+ *
+ * The commandlet's checkpoints and brush queue need code the standalone build doesn't have, so they come in through the
+ * virtual hooks below.
+ */
+class FCubiquityBenchmarkRun
+{
+public:
+
+	explicit FCubiquityBenchmarkRun(const FCubiquityBenchmarkOptions& inOptions);
+	virtual ~FCubiquityBenchmarkRun();
+
+	/**
+	 * Open an existing volume, or generate a synthetic one in a database which writeResults() deletes
+	 * \return false, having logged why, if the volume type is unknown or the volume doesn't exist
+	 */
+	bool openVolume(const FString& databaseFileName);
+
+	/** Edit and sync options.frames frames, then make the comparisons the report asks for */
+	void run();
+
+	/**
+	 * Close the volume and write the report to options.outputFileName
+	 * \param backend if not nullptr, noted in the report's config, e.g. "stand-in"
+	 */
+	bool writeResults(const TCHAR* backend);
+
+protected:
+
+	/** Before the frame's edits are timed */
+	virtual void beforeFrame(int32 frame) {}
+
+	/** Make the frame's edits, by default options.editsPerFrame of the pattern. Only called for synthetic volumes. */
+	virtual void makeEdits(int32 frame);
+
+	/** Ahead of each edit, with how far around `position` it reaches. Starts timing the edit's latencies. */
+	virtual void beforeEdit(const FVector& position, float radius);
+
+	/** After the frames and before the comparisons, with the volume as the run left it */
+	virtual void afterFrames() {}
+
+	/** Phases of the commandlet's own, each ending ",\n" */
+	virtual FString extraPhasesJson() { return FString(); }
+
+	/** Members of the commandlet's own, each ending ",\n" */
+	virtual FString extraSectionsJson() { return FString(); }
+
+	const FCubiquityBenchmarkOptions options;
+	FCubiquityConversionSettings settings;
+	FString databaseFileName;
+
+	std::unique_ptr<Cubiquity::Volume> volume;
+	Cubiquity::TerrainVolume* terrainVolume = nullptr;
+	Cubiquity::ColoredCubesVolume* coloredCubesVolume = nullptr;
+
+	FCubiquitySyncSimulator simulator;
+	FRandomStream random;
+
+private:
+
+	void compareGreedyMeshing();
+	void measureDiskCache();
+
+	double openSeconds = 0.0; ///< Opening or creating the database, as ACubiquityVolume::secondsToOpen
+	double generationSeconds = 0.0;
+	double runSeconds = 0.0;
+	uint32 bufferAllocations = 0; ///< Mesh buffer pool misses over the frames
+	uint32 bufferReuses = 0;
+
+	FCubiquitySamples edits;
+	FCubiquitySamples updates;
+	FCubiquitySamples syncs;
+	FCubiquitySamples editToSynced;
+	FCubiquitySamples editToVisible;
+	FCubiquityEditLatency syncedEdits;
+	FCubiquityEditLatency visibleEdits;
+
+	FString greedyJson;
+	FString diskCacheJson;
+};
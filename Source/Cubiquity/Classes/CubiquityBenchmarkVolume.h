@@ -0,0 +1,58 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityMeshConverter.h"
+#include "CubiquitySyncSimulator.h"
+
+/** One edit of a benchmark pattern, worked out before it is made so the caller can note where it goes first */
+struct FCubiquityBenchmarkEdit
+{
+	FVector position;
+	float radius = 0.0f; ///< How far around `position` the edit reaches
+	float opacity = 0.0f; ///< Terrain: the sculpt's opacity. Colored cubes Scatter: 1 fills the voxel and 0 empties it.
+	FColor color; ///< Colored cubes Scatter only
+
+	static const float TerrainInnerRadius;
+	static const float TerrainOuterRadius;
+};
+
+/**
+ * The synthetic volumes and edit patterns the benchmarks run. UCubiquityBenchmarkCommandlet and the standalone benchmark in
+ * Tools/CubiquityBenchmark both use these so that they measure the same work.
+ *
+ * The patterns are Scatter (random voxels or sculpts anywhere), Dig (a tunnel through the middle, a little further each frame)
+ * and Wall (a wall growing along the diagonal).
+ */
+class FCubiquityBenchmarkVolume
+{
+public:
+
+	/** Rolling hills in bands of colour */
+	static void generateColoredCubes(Cubiquity::ColoredCubesVolume& volume, int32 size, int32 height);
+
+	static FCubiquityBenchmarkEdit coloredCubesEdit(const FString& pattern, FRandomStream& random, int32 frame, int32 size, int32 height);
+	static void applyColoredCubesEdit(Cubiquity::ColoredCubesVolume& volume, const FString& pattern, const FCubiquityBenchmarkEdit& edit, int32 size, int32 height);
+
+	/** Terrain edits are sculpts between TerrainInnerRadius and TerrainOuterRadius */
+	static FCubiquityBenchmarkEdit terrainEdit(const FString& pattern, FRandomStream& random, int32 frame, int32 size, int32 height);
+	static void applyTerrainEdit(Cubiquity::TerrainVolume& volume, const FCubiquityBenchmarkEdit& edit);
+};
+
+/** Every node mesh in a volume converted with and without greedy meshing, to show what the merge buys and costs */
+struct FCubiquityGreedyComparison
+{
+	int32 nodes = 0;
+	int64 trianglesBefore = 0;
+	int64 trianglesAfter = 0;
+	FCubiquitySamples conversionBefore;
+	FCubiquitySamples conversionAfter;
+
+	/** Convert the node and everything below it both ways */
+	void addNode(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings);
+
+	/** The "greedy_meshing" member of the benchmark results, with its trailing comma */
+	FString toJson();
+};
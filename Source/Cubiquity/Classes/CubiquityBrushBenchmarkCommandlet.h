@@ -0,0 +1,30 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "CubiquityBrushBenchmarkCommandlet.generated.h"
+
+/**
+ * Measures FCubiquityBrushEngine's per-voxel throughput at a few brush radii.
+ *
+ * A cube of volume big enough for the largest brush is generated with its lower half solid, then each shape is
+ * applied at the centre of its surface with Add, and a sphere with every mode. Between brushes the changes are
+ * discarded so every brush starts from the same voxels. The read, compute and write passes are timed separately.
+ * On terrain the library's own sculpt, paint and blur brushes of the same radius are timed for comparison.
+ *
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquityBrushBenchmark -nullrhi [-Type=ColoredCubes|Terrain|Both]
+ *     [-Radii=8,32,128] [-Repeats=3] [-Output=Path/To.json]
+ */
+UCLASS()
+class UCubiquityBrushBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityBrushBenchmarkCommandlet(const FObjectInitializer& PCIP);
+
+	virtual int32 Main(const FString& Params) override;
+};
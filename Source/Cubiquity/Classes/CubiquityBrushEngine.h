@@ -0,0 +1,135 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityBrushEngine.generated.h"
+
+/** The solid part of an FCubiquityBrush */
+UENUM(BlueprintType)
+enum class ECubiquityBrushShape : uint8
+{
+	Sphere, ///< Radius size.X
+	Box, ///< Half-extents size
+	Cylinder, ///< Upright, with radius size.X and half-height size.Z
+	Heightmap, ///< A column size.X by size.Y half-extents whose top follows the heightmap, up to 2 * size.Z above its base
+	Custom, ///< FCubiquityBrush::signedDistance, within half-extents size
+};
+
+/** What an FCubiquityBrush does to the voxels under it */
+UENUM(BlueprintType)
+enum class ECubiquityBrushMode : uint8
+{
+	Add, ///< Build up solid, of materialIndex on terrain or color on colored cubes
+	Remove, ///< Dig out
+	Paint, ///< Change what is already solid to materialIndex or color
+	Smooth, ///< Average each voxel with its neighbours
+};
+
+/**
+ * A brush for ACubiquityVolume::applyBrushKernel(). Every shape is a signed distance from its surface which is fully
+ * applied inside and fades out over `falloff` voxels outside, with optional value noise roughening the surface.
+ */
+USTRUCT(BlueprintType)
+struct FCubiquityBrush
+{
+	GENERATED_USTRUCT_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	ECubiquityBrushShape shape = ECubiquityBrushShape::Sphere;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	ECubiquityBrushMode mode = ECubiquityBrushMode::Add;
+
+	/** In voxels. What each component means depends on the shape. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	FVector size = FVector(4.0f, 4.0f, 4.0f);
+
+	/** Voxels outside the shape over which the brush fades out */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	float falloff = 1.5f;
+
+	/** How strongly the brush applies, 0 to 1 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	float opacity = 0.8f;
+
+	/** How many voxels in or out noise moves the shape's surface. 0 turns it off. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	float noiseAmount = 0.0f;
+
+	/** Noise features per voxel. Smaller is smoother. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	float noiseScale = 0.2f;
+
+	/** Heights from 0 to 1, heightmapWidth across and x fastest, stretched over a Heightmap brush */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	TArray<float> heightmap;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	int32 heightmapWidth = 0;
+
+	/** Which of the material set's materials terrain Add and Paint use */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	int32 materialIndex = 0;
+
+	/** What colored cubes Add and Paint use */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Cubiquity")
+	FColor color = FColor::White;
+
+	/**
+	 * For Custom. Distance in voxels from a point relative to the brush centre to the shape's surface, negative inside.
+	 * Called from worker threads so it must not touch anything they could race on.
+	 */
+	TFunction<float(const FVector&)> signedDistance;
+};
+
+/** What one FCubiquityBrushEngine::apply() did and how long it took */
+struct FCubiquityBrushResult
+{
+	FIntVector lower = FIntVector(0, 0, 0); ///< The voxels the brush covered, clipped to the volume
+	FIntVector upper = FIntVector(-1, -1, -1);
+	int64 voxelsProcessed = 0;
+	int64 voxelsWritten = 0; ///< Only the ones which changed
+	int32 tasks = 0;
+	double readSeconds = 0.0;
+	double computeSeconds = 0.0;
+	double writeSeconds = 0.0;
+
+	bool isEmpty() const { return upper.X < lower.X || upper.Y < lower.Y || upper.Z < lower.Z; }
+};
+
+/**
+ * Applies an FCubiquityBrush outside the library, in three passes: the voxels under the brush are read into a buffer,
+ * the brush is evaluated into a second buffer by worker threads a slab of z at a time, and the voxels which changed
+ * are written back. The library isn't thread safe so only the middle pass is parallel. Terrain material weights are
+ * blended four channels at a time with the engine's vector maths.
+ */
+class FCubiquityBrushEngine
+{
+public:
+
+	/** Below this many voxels a brush is evaluated on the calling thread, as handing it out costs more than it saves */
+	enum { VoxelsPerTask = 32 * 32 * 32 };
+
+	/** The biggest heightmap save() takes, so a brush always fits in an edit batch */
+	enum { MaximumHeightmapSamples = 128 * 128 };
+
+	/** Apply a brush centred on a volume-space position. Must be called from the thread which owns the volume. */
+	static FCubiquityBrushResult apply(Cubiquity::Volume& volume, const FVector& centre, const FCubiquityBrush& brush);
+
+	/** Half the size of the box around the centre a brush can change */
+	static FVector halfExtent(const FCubiquityBrush& brush);
+
+	/** How much of a brush applies at an offset from its centre, 0 to 1, before opacity */
+	static float weight(const FCubiquityBrush& brush, const FVector& offset);
+
+	/**
+	 * Write a brush's settings for a recorded or replicated op
+	 * \return false for a Custom brush, whose signedDistance is code, or a heightmap over MaximumHeightmapSamples
+	 */
+	static bool save(const FCubiquityBrush& brush, TArray<uint8>& outData);
+
+	/** Read a brush save() wrote. \return false if the data is corrupt */
+	static bool load(const TArray<uint8>& data, FCubiquityBrush& outBrush);
+};
@@ -0,0 +1,77 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquitySessionRecording.h"
+
+/**
+ * Holds back terrain sculpt, paint and blur brushes for a frame, or a few, and merges the ones which land on top of each
+ * other so a held mouse button makes one brush pass per window rather than one per call.
+ *
+ * Two brushes merge when they are the same op with the same radii and material, push the same way, and the new one is
+ * within mergeDistance outer radii of where the queued one was first made. The merged brush sits at their
+ * opacity-weighted centre with their opacities added (up to 1 for paint and blur and MaximumSculptOpacity for sculpt),
+ * which is close to applying them one after the other but not identical. Measuring from the first brush rather than the
+ * merged centre stops a stroke chaining into one brush which creeps along it. A brush is only merged past queued brushes
+ * it doesn't overlap, as the order of overlapping ones matters.
+ */
+class FCubiquityBrushQueue
+{
+public:
+
+	/** Merged sculpt brushes stop growing at this opacity, which is as far as edit replication can send */
+	enum { MaximumSculptOpacity = 4 };
+
+	/** Whether an op is one this queue takes */
+	static bool isBrush(const FCubiquityRecordedEvent& event);
+
+	/**
+	 * Queue a brush, merging it into one already queued if it can be
+	 * \param nodeSize edge length of the smallest octree nodes, for estimating the re-meshes a merge saves
+	 */
+	void add(const FCubiquityRecordedEvent& event, uint32 nodeSize, double now);
+
+	/**
+	 * Queue a brush every `spacing` voxels along a path. A path starting where the last one ended carries on its spacing,
+	 * so calling this each frame from the last mouse position to the new one gives an evenly spaced stroke.
+	 * \param brush the op, radii, opacity and material. Its position is ignored.
+	 */
+	void stroke(const TArray<FVector>& path, float spacing, const FCubiquityRecordedEvent& brush, uint32 nodeSize, double now);
+
+	/** Whether the oldest queued brush has waited `windowSeconds`. With a window of 0 anything queued is due. */
+	bool isDue(double now, float windowSeconds) const { return pending.Num() > 0 && now - firstQueued >= windowSeconds; }
+
+	bool isEmpty() const { return pending.Num() == 0; }
+
+	/** Everything queued, oldest first, as one pass */
+	void take(TArray<FCubiquityRecordedEvent>& outEvents);
+
+	/** Drop anything queued and end the stroke */
+	void reset();
+
+	/** How close, in outer radii, two brushes have to be to merge */
+	float mergeDistance = 0.5f;
+
+	int32 brushesQueued = 0;
+	int32 brushesMerged = 0;
+	int32 passesApplied = 0;
+	int64 remeshesAvoided = 0; ///< Estimated: the smallest nodes under each merged brush, which its own pass would have dirtied again
+
+private:
+
+	struct FQueuedBrush
+	{
+		FCubiquityRecordedEvent event;
+		FVector firstPosition; ///< Where the first of the brushes merged into this one was
+	};
+
+	bool canMerge(const FQueuedBrush& queued, const FCubiquityRecordedEvent& event) const;
+
+	TArray<FQueuedBrush> pending;
+	double firstQueued = 0.0;
+
+	//Where the last stroke ended and how far it had gone since its last brush
+	bool strokeOpen = false;
+	FVector strokeEnd = FVector::ZeroVector;
+	float strokeTravel = 0.0f;
+};
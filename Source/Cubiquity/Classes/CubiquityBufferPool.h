@@ -0,0 +1,129 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquityStats.h"
+
+/**
+ * A pool of spare TArray allocations shared by all the mesh components.
+ * When a node loses its mesh its storage is handed back here rather than freed, and when a node is (re)meshed it
+ * takes the best fitting allocation from here rather than growing its own. In steady state this keeps the allocator
+ * out of the octree sync entirely.
+ *
+ * Mesh conversion, the disk cache's loads and the last release of a mesh all happen on the game thread, since the library
+ * isn't thread safe, so that is the only thread allowed in. The disk cache's workers only ever see serialised bytes.
+ */
+template <typename ElementType>
+class TCubiquityBufferPool
+{
+public:
+
+	static TCubiquityBufferPool& get()
+	{
+		static TCubiquityBufferPool pool;
+		return pool;
+	}
+
+	/**
+	 * Empty the buffer and make sure it has room for at least `size` elements.
+	 * Its own allocation is kept if it is big enough, otherwise it is swapped for a pooled one or grown.
+	 */
+	void acquire(TArray<ElementType>& buffer, int32 size)
+	{
+		check(IsInGameThread());
+
+		buffer.Reset();
+
+		if (buffer.Max() >= size)
+		{
+			reuses++;
+			INC_DWORD_STAT(STAT_CubiquityBufferReuses);
+			return;
+		}
+
+		//Find the smallest pooled buffer which is big enough
+		int32 bestIndex = INDEX_NONE;
+		for (int32 i = 0; i < freeBuffers.Num(); ++i)
+		{
+			const int32 capacity = freeBuffers[i].Max();
+			if (capacity >= size && (bestIndex == INDEX_NONE || capacity < freeBuffers[bestIndex].Max()))
+			{
+				bestIndex = i;
+			}
+		}
+
+		if (bestIndex != INDEX_NONE)
+		{
+			TArray<ElementType> pooled = MoveTemp(freeBuffers[bestIndex]);
+			freeBuffers.RemoveAtSwap(bestIndex);
+			DEC_MEMORY_STAT_BY(STAT_CubiquityPooledBufferMemory, pooled.GetAllocatedSize());
+
+			release(buffer); //Our old allocation is too small for us but may suit someone else
+			buffer = MoveTemp(pooled);
+
+			reuses++;
+			INC_DWORD_STAT(STAT_CubiquityBufferReuses);
+			return;
+		}
+
+		//Nothing suitable. Leave some slack so that a node which grows a little on the next edit doesn't come back here
+		buffer.Reserve(size + size / 4);
+		allocations++;
+		INC_DWORD_STAT(STAT_CubiquityBufferAllocations);
+	}
+
+	/**
+	 * Give the buffer's allocation to the pool. The buffer is left empty with no allocation.
+	 * If the pool is already full the allocation is simply freed.
+	 */
+	void release(TArray<ElementType>& buffer)
+	{
+		check(IsInGameThread());
+
+		if (buffer.Max() == 0)
+		{
+			return;
+		}
+
+		const uint32 bufferBytes = buffer.GetAllocatedSize();
+
+		if (freeBuffers.Num() >= maxPooledBuffers || pooledBytes() + bufferBytes > maxPooledBytes)
+		{
+			buffer.Empty();
+			return;
+		}
+
+		buffer.Reset();
+		freeBuffers.Add(MoveTemp(buffer));
+		INC_MEMORY_STAT_BY(STAT_CubiquityPooledBufferMemory, bufferBytes);
+	}
+
+	/** The maximum number of spare allocations held */
+	int32 maxPooledBuffers = 64;
+
+	/** The maximum number of bytes held in spare allocations */
+	uint32 maxPooledBytes = 16 * 1024 * 1024;
+
+	/** Acquires which had to go to the allocator, and those served by a buffer's own or a pooled allocation. Kept without stats for the benchmark. */
+	uint32 allocations = 0;
+	uint32 reuses = 0;
+
+private:
+
+	TCubiquityBufferPool()
+	{
+		freeBuffers.Reserve(maxPooledBuffers);
+	}
+
+	uint32 pooledBytes() const
+	{
+		uint32 total = 0;
+		for (const auto& freeBuffer : freeBuffers)
+		{
+			total += freeBuffer.GetAllocatedSize();
+		}
+		return total;
+	}
+
+	TArray<TArray<ElementType>> freeBuffers;
+};
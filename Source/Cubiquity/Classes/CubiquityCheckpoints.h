@@ -0,0 +1,87 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquitySessionRecording.h"
+
+/**
+ * Undo checkpoints for a volume, kept as compressed copies of only the chunks which change.
+ *
+ * Once a checkpoint exists, the first edit to touch a chunk saves the chunk as it was before the edit. Each checkpoint
+ * holds those copies for the chunks changed after it was made, so restoring a checkpoint writes back one copy per chunk
+ * changed since then and costs time in proportion to how much changed, not to the size of the volume. The copies come back
+ * as WriteChunk ops so the volume can record them and send them to clients like any other edit.
+ *
+ * This works on the library volume directly so that the benchmark commandlet can time it without a world.
+ */
+class FCubiquityCheckpoints
+{
+public:
+
+	/** Call before making an edit at `position` which changes voxels within `radius` of it */
+	void beforeEdit(Cubiquity::Volume& volume, const FVector& position, float radius);
+
+	/**
+	 * Start a new checkpoint from the volume as it is now
+	 * \return the checkpoint's index, for passing to restore()
+	 */
+	int32 create();
+
+	/**
+	 * The writes which put every chunk changed since `checkpoint` back how it was. The checkpoints after it are dropped and
+	 * it starts again from nothing, so the writes have to be applied without calling beforeEdit().
+	 * \param outWrites a WriteChunk op for each chunk
+	 * \return false if there is no such checkpoint
+	 */
+	bool restore(int32 checkpoint, TArray<FCubiquityRecordedEvent>& outWrites);
+
+	/** Forget every checkpoint */
+	void reset();
+
+	/** Call when the uncommitted changes have been committed */
+	void committed() { numCommitted = checkpoints.Num(); }
+
+	/**
+	 * Call when the uncommitted changes have been discarded. Checkpoints made since the last commit are dropped as they
+	 * hold changes which are gone. The ones before it still know every chunk changed since them so they are kept.
+	 */
+	void discarded();
+
+	int32 num() const { return checkpoints.Num(); }
+
+	/** Compressed size of every saved chunk */
+	uint64 compressedBytes() const { return totalCompressedBytes; }
+
+	/** Size of every saved chunk before compression */
+	uint64 uncompressedBytes() const { return totalUncompressedBytes; }
+
+private:
+
+	struct FSavedChunk
+	{
+		FIntVector chunk;
+		int32 uncompressedSize;
+		TArray<uint8> compressed;
+	};
+
+	struct FCheckpoint
+	{
+		TArray<FSavedChunk> savedChunks;
+		TSet<FIntVector> chunks; ///< Which chunks are in savedChunks
+	};
+
+	void saveChunk(Cubiquity::Volume& volume, const FIntVector& chunk, FCheckpoint& checkpoint);
+
+	//Drop the checkpoints from `first` on
+	void removeFrom(int32 first);
+
+	TArray<FCheckpoint> checkpoints;
+
+	//How many checkpoints there were at the last commit
+	int32 numCommitted = 0;
+	uint64 totalCompressedBytes = 0;
+	uint64 totalUncompressedBytes = 0;
+
+	//Reused between chunks so that saving one doesn't allocate
+	TArray<uint8> scratch;
+};
@@ -0,0 +1,24 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include <DynamicMeshBuilder.h>
+
+/** A colored cubes vertex as we keep it on the CPU and upload it. Kept apart from the vertex factory so that mesh data doesn't need the renderer. */
+struct FColoredCubesVertex
+{
+	FColoredCubesVertex() {}
+	
+	FColoredCubesVertex(const FVector& InPosition, const FColor& InColor) :
+		Position(InPosition),
+		Color(InColor)
+	{}
+
+	FColoredCubesVertex(const FDynamicMeshVertex& other) :
+		Position(other.Position),
+		Color(other.Position)
+	{}
+
+	FVector Position;
+	FColor Color;
+};
@@ -6,25 +6,10 @@
 
 #include <DynamicMeshBuilder.h>
 
-//#include "CubiquityColoredCubesVertexFactory.generated.h"
-
-struct FColoredCubesVertex
-{
-	FColoredCubesVertex() {}
-	
-	FColoredCubesVertex(const FVector& InPosition, const FColor& InColor) :
-		Position(InPosition),
-		Color(InColor)
-	{}
-
-	FColoredCubesVertex(const FDynamicMeshVertex& other) :
-		Position(other.Position),
-		Color(other.Position)
-	{}
+#include "CubiquityColoredCubesVertex.h"
+#include "CubiquityPackedFacesVertexFactory.h"
 
-	FVector Position;
-	FColor Color;
-};
+//#include "CubiquityColoredCubesVertexFactory.generated.h"
 
 /** Vertex Buffer */
 class FColoredCubesVertexBuffer : public FVertexBuffer
@@ -113,6 +98,30 @@ protected:
 
 
 
+/**
+ * The render resources for one colored cubes mesh.
+ * This is shared between the proxies of all nodes whose meshes are identical and released by the last of them.
+ */
+struct FColoredCubesRenderData
+{
+	FColoredCubesRenderData();
+	~FColoredCubesRenderData();
+
+	/** Call once the buffers have been filled. traceNode labels the GPU upload in Cubiquity traces */
+	void initResources(const FCubiquityTraceNode& traceNode);
+
+	/** Whether this is drawn straight from packed faces, in which case the vertex and index buffers are empty */
+	bool usesPackedFaces() const { return PackedFaceBuffer.Faces.Num() > 0; }
+
+	FColoredCubesVertexBuffer VertexBuffer;
+	FColoredCubesIndexBuffer IndexBuffer;
+	FColoredCubesVertexFactory VertexFactory;
+
+	FCubiquityPackedFaceBuffer PackedFaceBuffer;
+	FCubiquityFacePaletteBuffer FacePaletteBuffer;
+	FCubiquityPackedFacesVertexFactory PackedFacesVertexFactory;
+};
+
 class UCubiquityMeshComponent; //Forward declare
 
 class FColoredCubesSceneProxy : public FPrimitiveSceneProxy
@@ -136,9 +145,7 @@ public:
 private:
 
 	UMaterialInterface* Material;
-	FColoredCubesVertexBuffer VertexBuffer;
-	FColoredCubesIndexBuffer IndexBuffer;
-	FColoredCubesVertexFactory VertexFactory;
+	TSharedPtr<FColoredCubesRenderData, ESPMode::ThreadSafe> RenderData;
 
 	FMaterialRelevance MaterialRelevance;
 };
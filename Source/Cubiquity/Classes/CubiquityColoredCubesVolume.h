@@ -24,6 +24,20 @@ public:
 
 	virtual void Destroyed() override;
 
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent & PropertyChangedEvent) override;
+#endif
+
+	/** Merge adjacent same-coloured faces into larger quads. Far fewer triangles on flat areas but can cause T-junction sparkles */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity")
+	bool greedyMeshing = false;
+
+	/** Keep node meshes as 8 bytes per face rather than 88, on the CPU and on SM4 GPUs which draw them straight from the packed faces */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity")
+	bool compactFaceStorage = false;
+
+	virtual FCubiquityConversionSettings conversionSettings() const override;
+
 	//Along a raycast, get the position of the first non-empty voxel
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Cubiquity")
 	FVector pickFirstSolidVoxel(FVector localStartPosition, FVector localDirection) const;
@@ -36,6 +50,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
 	void setVoxel(FVector localPosition, FColor newColor);
 
+	//Set every voxel from lowerCorner to upperCorner inclusive to a specific value
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void fillRegion(FVector lowerCorner, FVector upperCorner, FColor newColor);
+
 	//Get the value of a voxel in the terrain
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Cubiquity")
 	FColor getVoxel(FVector localPosition) const;
@@ -43,6 +61,7 @@ public:
 private:
 	std::unique_ptr<Cubiquity::ColoredCubesVolume> m_volume = nullptr;
 	Cubiquity::Volume* volume() override { return m_volume.get(); }
+	void setVolume(Cubiquity::Volume* newVolume) override;
 
 	void loadVolume() override;
 };
@@ -0,0 +1,22 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+/**
+ * Checks a commandlet's switches against the ones it reads. FParse::Value() and FParse::Param() just don't find a
+ * switch which is misspelt, so without this a typo quietly runs with the default instead.
+ *
+ * Switches the engine itself reads, such as -nullrhi or -abslog=, are allowed through.
+ */
+class FCubiquityCommandletSwitches
+{
+public:
+
+	/**
+	 * \param params what the commandlet's Main() was given
+	 * \param known the switches the commandlet reads, without the '-' and with '=' on the end of those which take a value
+	 * \param usage logged if there are any unknown switches
+	 * \return false, having logged each unknown switch, if there were any
+	 */
+	static bool validate(const FString& params, const TArray<const TCHAR*>& known, const TCHAR* usage);
+};
@@ -0,0 +1,93 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+/**
+ * The boxes of voxels recent edits touched, kept until every drawn node over them shows the edit. The octree walk for
+ * the edit fast lane only goes down branches over these boxes, and how long each edit took to show is its latency.
+ *
+ * An edit counts as shown once the drawn nodes over it are in step with the library and either one of them has been
+ * re-meshed since the edit or the library has nothing left to update. Edits which change nothing never re-mesh
+ * anything, so they are dropped after timeoutSeconds if the library is busy elsewhere all that time.
+ *
+ * Every node the walks visit asks about the edits, so they are indexed by the cells of CellSize voxels they cover and a
+ * node only looks at those in its own cells. Edits too big for that are few and are always checked.
+ */
+class FCubiquityEditLatency
+{
+public:
+
+	/** Start waiting for an edit around a volume-space position */
+	void add(const FVector& position, float radius, double now);
+
+	bool isEmpty() const { return pending.Num() == 0; }
+
+	/** How many edits are still being waited for */
+	int32 numPending() const { return pending.Num(); }
+
+	/** Forget every edit being waited for, e.g. when the volume is reopened */
+	void reset();
+
+	/** Whether a node, including the voxel of padding its mesh reads around it, is over any edit being waited for */
+	bool touches(const Cubiquity::OctreeNode& node, uint32 baseNodeSize) const;
+
+	/**
+	 * Note a drawn node over edits being waited for
+	 * \param inStep whether the node's mesh and visibility now match the library's
+	 */
+	void visit(const Cubiquity::OctreeNode& node, uint32 baseNodeSize, bool inStep);
+
+	/**
+	 * Finish a walk of the nodes, taking out the edits which are now shown
+	 * \param libraryUpToDate what the volume's update() returned this frame
+	 * \param outLatencies if not nullptr, gets the seconds each shown edit took
+	 */
+	void endFrame(double now, bool libraryUpToDate, TArray<double>* outLatencies);
+
+	float timeoutSeconds = 5.0f;
+
+	int32 editsShown = 0;
+	int32 editsTimedOut = 0;
+
+private:
+
+	enum { CellSize = 32, MaximumCellsPerEdit = 64 };
+
+	struct FPendingEdit
+	{
+		FIntVector lower;
+		FIntVector upper;
+		uint32 editedAt = 0; ///< The library's clock when the edit was made
+		double started = 0.0;
+		bool remeshed = false; ///< A drawn node over it has been re-meshed since
+		bool waiting = false; ///< A drawn node over it was out of step on this walk
+	};
+
+	static void nodeBounds(const Cubiquity::OctreeNode& node, uint32 baseNodeSize, FIntVector& outLower, FIntVector& outUpper);
+
+	static int32 cellOf(int32 voxel) { return (voxel >= 0 ? voxel : voxel - (CellSize - 1)) / CellSize; }
+	static FIntVector cellOf(const FIntVector& voxel) { return FIntVector(cellOf(voxel.X), cellOf(voxel.Y), cellOf(voxel.Z)); }
+
+	//Put a pending edit into the cells, or largeEdits if it covers too many
+	void index(int32 editIndex);
+
+	//The pending edits a box overlaps, each possibly more than once. Returns early when function returns false.
+	template <typename Function>
+	void forEachOverlapping(const FIntVector& lower, const FIntVector& upper, Function function) const;
+
+	static bool overlaps(const FPendingEdit& edit, const FIntVector& lower, const FIntVector& upper)
+	{
+		return edit.lower.X <= upper.X && edit.upper.X >= lower.X
+			&& edit.lower.Y <= upper.Y && edit.upper.Y >= lower.Y
+			&& edit.lower.Z <= upper.Z && edit.upper.Z >= lower.Z;
+	}
+
+	TArray<FPendingEdit> pending;
+
+	TMap<FIntVector, TArray<int32>> cells; ///< The indices in pending of the edits over each cell
+	TArray<int32> largeEdits; ///< Those over more than MaximumCellsPerEdit cells
+	FIntVector pendingLower = FIntVector(0, 0, 0); ///< A box around every pending edit
+	FIntVector pendingUpper = FIntVector(-1, -1, -1);
+};
@@ -0,0 +1,48 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquityVoxelChunk.h"
+
+/**
+ * Uncommitted edits as a blob for save games, so a game can be saved without committing and rewriting the voxel database.
+ *
+ * Each modified chunk is read whole and run-length encoded voxel by voxel, which is fast and already shrinks the long
+ * runs of empty space and solid material most chunks are made of. The runs of every chunk are then zlib compressed
+ * together, biased for speed, through FArchive::SerializeCompressed, with a checksum of the result. Loading checks the
+ * header, every size and the checksum before uncompressing, and decodes every chunk before writing any of them straight
+ * back into the library's override chunks, where uncommitted edits live, so they can be committed or discarded as usual
+ * afterwards. A damaged blob is refused and leaves the volume as it was. The blob only makes sense on top of the same
+ * voxel database it was saved from.
+ *
+ * This works on the library volume directly so that the CubiquitySaveEdits commandlet can time it without a world.
+ */
+class FCubiquityEditSave
+{
+public:
+
+	/** Bumped whenever the layout changes. Older blobs are refused rather than misread. */
+	enum { Version = 2 };
+
+	/** Write the chunks to an archive. \return false if the archive had an error */
+	static bool save(Cubiquity::Volume& volume, const TSet<FIntVector>& chunks, FArchive& ar);
+
+	/** Check everything about a blob that doesn't need the volume it's for. \return false if load() would refuse it whatever the volume */
+	static bool isLoadable(FArchive& ar);
+
+	/**
+	 * Read chunks written by save() into the volume. Nothing is written unless all of them can be.
+	 * \param outChunks the chunks which were written, in chunk coordinates
+	 * \return false if the blob is from another version, type of volume or chunk size, or is corrupt
+	 */
+	static bool load(Cubiquity::Volume& volume, FArchive& ar, TArray<FIntVector>& outChunks);
+
+	/** Append voxels from FCubiquityVoxelChunk::read() as runs of a packed count and a voxel */
+	static void runLengthEncode(const TArray<uint8>& voxels, int32 bytesPerVoxel, TArray<uint8>& outRuns);
+
+	/**
+	 * Decode runs starting at `position`, moving it past them, until `outVoxels` holds `voxelBytes`
+	 * \return false if the runs end early or overrun
+	 */
+	static bool runLengthDecode(const TArray<uint8>& runs, int32& position, int32 bytesPerVoxel, int32 voxelBytes, TArray<uint8>& outVoxels);
+};
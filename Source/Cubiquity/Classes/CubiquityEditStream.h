@@ -0,0 +1,153 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquitySessionRecording.h"
+
+#include "CubiquityEditStream.generated.h"
+
+/**
+ * A run of edit ops sent from the server to clients in one net update.
+ *
+ * The ops are bit packed by FCubiquityEditStream and the batch writes itself to the network with packed integers, so a
+ * single voxel set costs a few bytes and a brush stroke under ten.
+ */
+USTRUCT()
+struct FCubiquityEditBatch
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Sequence number of the first op. The ops after it take the numbers after it. */
+	UPROPERTY()
+	uint32 firstSequence = 0;
+
+	UPROPERTY()
+	int32 numOps = 0;
+
+	UPROPERTY()
+	int32 numBits = 0;
+
+	UPROPERTY()
+	TArray<uint8> data;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	/** How many bytes NetSerialize() writes for this batch */
+	int32 wireBytes() const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FCubiquityEditBatch> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
+
+/**
+ * Turns edit ops into batches and back.
+ *
+ * Voxel positions are sent as packed differences from the op before, brush positions and radii in eighths of a voxel
+ * and opacities in 127ths. The server has to apply quantise()d ops itself so that clients, which replay the decoded
+ * ops through the same library calls, end up with identical voxels. WriteChunk ops carry their compressed voxels as they
+ * are, and BrushKernel ops their brush with only its position rounded.
+ */
+class FCubiquityEditStream
+{
+public:
+
+	/** Brush positions and radii are rounded to this fraction of a voxel */
+	enum { BrushUnitsPerVoxel = 8 };
+
+	/** The op as a client will decode it */
+	static FCubiquityRecordedEvent quantise(const FCubiquityRecordedEvent& event);
+
+	/** Camera events are skipped as clients have their own */
+	static FCubiquityEditBatch encode(const TArray<FCubiquityRecordedEvent>& events, uint32 firstSequence);
+
+	/**
+	 * As many ops from the start of `events` as fit in maximumBytes. None of them may be a Camera event. An op too
+	 * big on its own goes in a batch by itself.
+	 * \param outTaken how many ops are in the batch
+	 */
+	static FCubiquityEditBatch encode(const TArray<FCubiquityRecordedEvent>& events, uint32 firstSequence, int32 maximumBytes, int32& outTaken);
+
+	/** \return false if the batch is corrupt, in which case outEvents is left empty */
+	static bool decode(const FCubiquityEditBatch& batch, TArray<FCubiquityRecordedEvent>& outEvents);
+};
+
+/** The server side of edit replication: collects ops until the next net update and numbers them */
+class FCubiquityEditSender
+{
+public:
+
+	/** Most bytes of ops in one batch, so that a burst of edits goes out as several small messages rather than one huge one */
+	enum { MaximumBatchBytes = 4096 };
+
+	/** Most batches to send in one net update. The rest wait for the next one so a big restore can't flood the reliable buffer. */
+	enum { MaximumBatchesPerUpdate = 16 };
+
+	/** Add an op which has already been quantised and applied. Commits aren't sent as each client's voxel database is its own. */
+	void queue(const FCubiquityRecordedEvent& event);
+
+	bool hasEdits() const { return pending.Num() > 0; }
+
+	/** The oldest queued ops, as many as fit in MaximumBatchBytes */
+	FCubiquityEditBatch takeBatch();
+
+	/** Forget the queued ops without sending them, for when there is nobody to send them to */
+	void dropPending();
+
+	/** The sequence number the next op will get */
+	uint32 nextSequence() const { return sequence + pending.Num(); }
+
+	int32 opsSent = 0;
+	int32 batchesSent = 0;
+	int64 bytesSent = 0;
+
+private:
+
+	TArray<FCubiquityRecordedEvent> pending;
+	uint32 sequence = 0;
+};
+
+/** The client side of edit replication: puts batches back in sequence order and drops any it has seen */
+class FCubiquityEditReceiver
+{
+public:
+
+	/** Take a batch off the network. Its ops, and those of any batches it was holding up, are added to the ready queue. */
+	void receive(const FCubiquityEditBatch& batch);
+
+	/** Ops ready to apply, oldest first. The caller empties this as it applies them. */
+	TArray<FCubiquityRecordedEvent> ready;
+
+	/** Drop the ops before a sequence number, for a client which has been given the volume as it was at that point */
+	void skipTo(uint32 sequence);
+
+	/** The sequence number of the next op to apply */
+	uint32 nextSequence() const { return expected; }
+
+	/** Set when a corrupt batch has been skipped, so the volume no longer matches the server's. Cleared by the caller once it has asked to be resynced. */
+	bool lostOps = false;
+
+	int32 opsReceived = 0;
+	int32 batchesReceived = 0;
+	int32 batchesOutOfOrder = 0;
+	int32 batchesCorrupt = 0;
+	int64 bytesReceived = 0;
+
+private:
+
+	//Move any batches which are no longer early to the ready queue
+	void drainEarly();
+
+	//Add a batch's ops from expected onwards to the ready queue
+	void takeBatch(const FCubiquityEditBatch& batch);
+
+	uint32 expected = 0;
+
+	//Batches which arrived before the ones in front of them
+	TArray<FCubiquityEditBatch> early;
+};
@@ -0,0 +1,77 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityExplosion.generated.h"
+
+/** Voxels an explosion left floating, which have been taken out of the volume to be turned into debris */
+USTRUCT(BlueprintType)
+struct FCubiquityIsland
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Volume-space positions of the voxels */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	TArray<FIntVector> voxels;
+
+	/** Colored cubes only: the colour of each voxel, in the same order */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	TArray<FColor> colors;
+
+	/** The mean of the voxel positions */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	FVector centre = FVector::ZeroVector;
+
+	/** The box around the voxels, inclusive */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	FIntVector lower = FIntVector(0, 0, 0);
+
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	FIntVector upper = FIntVector(0, 0, 0);
+
+	/** Terrain only: the material set of each voxel, in the same order */
+	TArray<uint64> materialSets;
+};
+
+/** What one FCubiquityExplosion::apply() did and how long it took */
+struct FCubiquityExplosionResult
+{
+	int64 voxelsCarved = 0;
+	int64 voxelsSearched = 0;
+	int64 voxelsDetached = 0;
+	int32 islands = 0;
+	int32 tasks = 0;
+	double carveSeconds = 0.0;
+	double searchSeconds = 0.0;
+};
+
+/**
+ * Blows a crater in a volume and takes out anything it leaves floating.
+ *
+ * The crater is a sphere roughened by noise, removed with FCubiquityBrushEngine. The solid voxels around it, out to
+ * `searchMargin` past the crater, are then split into 6-connected components: each worker thread labels a slab of z
+ * slices and the slabs are joined where they meet. A component is anchored if it reaches the edge of the searched box,
+ * where it may carry on into the rest of the volume, or the bottom of the volume. Anything else is an island. Only the
+ * searched box is read so the cost follows the size of the explosion, not the volume, at the price of treating an
+ * island too big for the box as anchored.
+ *
+ * Everything is deterministic, so a client replaying an explosion ends up with the same voxels as the server.
+ */
+class FCubiquityExplosion
+{
+public:
+
+	/**
+	 * \param radius of the solid part of the crater in voxels
+	 * \param falloff voxels over which terrain fades back to untouched outside the radius
+	 * \param roughness how far noise moves the crater's edge, as a fraction of the radius
+	 * \param searchMargin voxels past the crater searched for islands
+	 * \param outIslands if not nullptr, gets the islands which were taken out
+	 */
+	static FCubiquityExplosionResult apply(Cubiquity::Volume& volume, const FVector& centre, float radius, float falloff, float roughness, int32 searchMargin, TArray<FCubiquityIsland>* outIslands);
+
+	/** How far around the centre an explosion can change voxels */
+	static float reach(float radius, float falloff, float roughness, int32 searchMargin);
+};
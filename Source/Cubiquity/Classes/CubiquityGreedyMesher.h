@@ -0,0 +1,351 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+/**
+ * An axis-aligned rectangle of colored cube faces, in the integer voxel-corner space of an octree node.
+ * Cubiquity places colored cube vertices at encodedPos - 0.5 so corner (0, 0, 0) is at (-0.5, -0.5, -0.5) in node space.
+ */
+struct FCubiquityQuad
+{
+	uint8 axis; ///< The axis the face is perpendicular to. 0, 1 or 2 for X, Y or Z.
+	bool positive; ///< Whether the triangles wind to face along the positive axis
+	int32 plane; ///< Position of the face along `axis`
+	int32 u; ///< Lower corner along the axis after `axis`
+	int32 v; ///< Lower corner along the axis after that
+	int32 width; ///< Extent along u
+	int32 height; ///< Extent along v
+	FColor color;
+};
+
+/**
+ * Merges coplanar, adjacent, same-coloured faces of a colored cubes mesh into larger quads.
+ *
+ * The extractor emits one quad (two triangles) per exposed voxel face so big flat walls become a lot of triangles.
+ * This runs as a post-process over an already converted node mesh: the triangle pairs are turned back into quads,
+ * rasterised into a 2D mask per face plane and then merged greedily.
+ *
+ * The merged quads no longer share edges with their neighbours one-to-one so this can introduce T-junctions,
+ * which is why it is optional. The object holds its scratch buffers so reusing one instance doesn't allocate.
+ */
+class FCubiquityGreedyMesher
+{
+public:
+
+	/**
+	 * Rebuild the mesh with merged quads.
+	 * \return false if the mesh isn't made of axis-aligned quads, in which case it is left untouched
+	 */
+	template <typename VertexType>
+	bool mergeFaces(TArray<VertexType>& vertices, TArray<int32>& indices)
+	{
+		if (!extractQuads(vertices, indices, quads))
+		{
+			return false;
+		}
+
+		mergeQuads(quads, mergedQuads);
+
+		vertices.Reset();
+		indices.Reset();
+		emitQuads(mergedQuads, vertices, indices);
+
+		return true;
+	}
+
+	/**
+	 * Turn each consecutive pair of triangles back into a quad.
+	 * \return false if any pair isn't a single-coloured, axis-aligned rectangle
+	 */
+	template <typename VertexType>
+	static bool extractQuads(const TArray<VertexType>& vertices, const TArray<int32>& indices, TArray<FCubiquityQuad>& outQuads)
+	{
+		outQuads.Reset();
+
+		if (indices.Num() % 6 != 0)
+		{
+			return false;
+		}
+
+		outQuads.Reserve(indices.Num() / 6);
+
+		for (int32 i = 0; i < indices.Num(); i += 6)
+		{
+			int32 corners[6][3];
+			for (int32 j = 0; j < 6; ++j)
+			{
+				const VertexType& vertex = vertices[indices[i + j]];
+				if (vertex.Color != vertices[indices[i]].Color)
+				{
+					return false;
+				}
+
+				corners[j][0] = FMath::RoundToInt(vertex.Position.X + 0.5f);
+				corners[j][1] = FMath::RoundToInt(vertex.Position.Y + 0.5f);
+				corners[j][2] = FMath::RoundToInt(vertex.Position.Z + 0.5f);
+			}
+
+			//Exactly one axis must be flat across all six vertices
+			int32 axis = -1;
+			for (int32 a = 0; a < 3; ++a)
+			{
+				bool flat = true;
+				for (int32 j = 1; j < 6; ++j)
+				{
+					flat = flat && (corners[j][a] == corners[0][a]);
+				}
+
+				if (flat)
+				{
+					if (axis != -1)
+					{
+						return false;
+					}
+					axis = a;
+				}
+			}
+
+			if (axis == -1)
+			{
+				return false;
+			}
+
+			const int32 uAxis = (axis + 1) % 3;
+			const int32 vAxis = (axis + 2) % 3;
+
+			FCubiquityQuad quad;
+			quad.axis = axis;
+			quad.plane = corners[0][axis];
+			quad.u = corners[0][uAxis];
+			quad.v = corners[0][vAxis];
+			int32 maxU = quad.u;
+			int32 maxV = quad.v;
+			for (int32 j = 1; j < 6; ++j)
+			{
+				quad.u = FMath::Min(quad.u, corners[j][uAxis]);
+				quad.v = FMath::Min(quad.v, corners[j][vAxis]);
+				maxU = FMath::Max(maxU, corners[j][uAxis]);
+				maxV = FMath::Max(maxV, corners[j][vAxis]);
+			}
+			quad.width = maxU - quad.u;
+			quad.height = maxV - quad.v;
+			quad.color = vertices[indices[i]].Color;
+
+			if (quad.width <= 0 || quad.height <= 0)
+			{
+				return false;
+			}
+
+			//Every vertex must sit on a corner of the rectangle, each triangle must use three different corners,
+			//and the two corners the triangles leave out must be opposite each other so together they cover it.
+			uint32 missingCorner[2];
+			int32 windingSign[2];
+			for (int32 t = 0; t < 2; ++t)
+			{
+				uint32 usedCorners = 0;
+				for (int32 j = t * 3; j < t * 3 + 3; ++j)
+				{
+					const bool atMinU = corners[j][uAxis] == quad.u;
+					const bool atMaxU = corners[j][uAxis] == maxU;
+					const bool atMinV = corners[j][vAxis] == quad.v;
+					const bool atMaxV = corners[j][vAxis] == maxV;
+					if (!(atMinU || atMaxU) || !(atMinV || atMaxV))
+					{
+						return false;
+					}
+					usedCorners |= 1 << ((atMaxU ? 1 : 0) | (atMaxV ? 2 : 0));
+				}
+
+				missingCorner[t] = usedCorners ^ 0xF;
+				if (missingCorner[t] == 0 || (missingCorner[t] & (missingCorner[t] - 1)) != 0) //Exactly one corner unused
+				{
+					return false;
+				}
+
+				const int32* c0 = corners[t * 3];
+				const int32* c1 = corners[t * 3 + 1];
+				const int32* c2 = corners[t * 3 + 2];
+				const int32 cross = (c1[uAxis] - c0[uAxis]) * (c2[vAxis] - c0[vAxis]) - (c1[vAxis] - c0[vAxis]) * (c2[uAxis] - c0[uAxis]);
+				windingSign[t] = cross > 0 ? 1 : -1;
+			}
+
+			if ((missingCorner[0] | missingCorner[1]) != 0x9 && (missingCorner[0] | missingCorner[1]) != 0x6)
+			{
+				return false;
+			}
+
+			if (windingSign[0] != windingSign[1])
+			{
+				return false;
+			}
+
+			quad.positive = windingSign[0] > 0;
+
+			outQuads.Add(quad);
+		}
+
+		return true;
+	}
+
+	/** Greedily merge the quads of each face plane into as few rectangles as possible */
+	void mergeQuads(TArray<FCubiquityQuad>& inQuads, TArray<FCubiquityQuad>& outQuads)
+	{
+		outQuads.Reset();
+
+		inQuads.Sort([](const FCubiquityQuad& a, const FCubiquityQuad& b)
+		{
+			if (a.axis != b.axis) return a.axis < b.axis;
+			if (a.positive != b.positive) return a.positive < b.positive;
+			return a.plane < b.plane;
+		});
+
+		int32 sliceStart = 0;
+		while (sliceStart < inQuads.Num())
+		{
+			int32 sliceEnd = sliceStart + 1;
+			while (sliceEnd < inQuads.Num() && inQuads[sliceEnd].axis == inQuads[sliceStart].axis && inQuads[sliceEnd].positive == inQuads[sliceStart].positive && inQuads[sliceEnd].plane == inQuads[sliceStart].plane)
+			{
+				++sliceEnd;
+			}
+
+			mergeSlice(inQuads, sliceStart, sliceEnd, outQuads);
+			sliceStart = sliceEnd;
+		}
+	}
+
+	/** Append two triangles per quad, wound the same way as the quads they were extracted from */
+	template <typename VertexType>
+	static void emitQuads(const TArray<FCubiquityQuad>& inQuads, TArray<VertexType>& vertices, TArray<int32>& indices)
+	{
+		vertices.Reserve(vertices.Num() + inQuads.Num() * 4);
+		indices.Reserve(indices.Num() + inQuads.Num() * 6);
+
+		for (const FCubiquityQuad& quad : inQuads)
+		{
+			const int32 uAxis = (quad.axis + 1) % 3;
+			const int32 vAxis = (quad.axis + 2) % 3;
+
+			const int32 cornerU[4] = { quad.u, quad.u + quad.width, quad.u + quad.width, quad.u };
+			const int32 cornerV[4] = { quad.v, quad.v, quad.v + quad.height, quad.v + quad.height };
+
+			const int32 firstVertex = vertices.Num();
+			for (int32 c = 0; c < 4; ++c)
+			{
+				FVector position;
+				position[quad.axis] = quad.plane - 0.5f;
+				position[uAxis] = cornerU[c] - 0.5f;
+				position[vAxis] = cornerV[c] - 0.5f;
+				vertices.Add(VertexType(position, quad.color));
+			}
+
+			//Corners go anticlockwise around +axis so this order faces along +axis
+			if (quad.positive)
+			{
+				indices.Add(firstVertex); indices.Add(firstVertex + 1); indices.Add(firstVertex + 2);
+				indices.Add(firstVertex); indices.Add(firstVertex + 2); indices.Add(firstVertex + 3);
+			}
+			else
+			{
+				indices.Add(firstVertex); indices.Add(firstVertex + 2); indices.Add(firstVertex + 1);
+				indices.Add(firstVertex); indices.Add(firstVertex + 3); indices.Add(firstVertex + 2);
+			}
+		}
+	}
+
+private:
+
+	void mergeSlice(const TArray<FCubiquityQuad>& inQuads, int32 sliceStart, int32 sliceEnd, TArray<FCubiquityQuad>& outQuads)
+	{
+		const FCubiquityQuad& first = inQuads[sliceStart];
+
+		int32 minU = first.u, minV = first.v, maxU = first.u + first.width, maxV = first.v + first.height;
+		for (int32 i = sliceStart + 1; i < sliceEnd; ++i)
+		{
+			minU = FMath::Min(minU, inQuads[i].u);
+			minV = FMath::Min(minV, inQuads[i].v);
+			maxU = FMath::Max(maxU, inQuads[i].u + inQuads[i].width);
+			maxV = FMath::Max(maxV, inQuads[i].v + inQuads[i].height);
+		}
+
+		const int32 maskWidth = maxU - minU;
+		const int32 maskHeight = maxV - minV;
+
+		maskColors.Reset();
+		maskColors.AddUninitialized(maskWidth * maskHeight);
+		maskFilled.Reset();
+		maskFilled.AddZeroed(maskWidth * maskHeight);
+
+		for (int32 i = sliceStart; i < sliceEnd; ++i)
+		{
+			const FCubiquityQuad& quad = inQuads[i];
+			for (int32 v = quad.v; v < quad.v + quad.height; ++v)
+			{
+				for (int32 u = quad.u; u < quad.u + quad.width; ++u)
+				{
+					const int32 cell = (v - minV) * maskWidth + (u - minU);
+					maskColors[cell] = quad.color;
+					maskFilled[cell] = true;
+				}
+			}
+		}
+
+		for (int32 v = 0; v < maskHeight; ++v)
+		{
+			for (int32 u = 0; u < maskWidth; ++u)
+			{
+				const int32 cell = v * maskWidth + u;
+				if (!maskFilled[cell])
+				{
+					continue;
+				}
+
+				const FColor color = maskColors[cell];
+
+				//Grow along u as far as the colour runs
+				int32 width = 1;
+				while (u + width < maskWidth && maskFilled[cell + width] && maskColors[cell + width] == color)
+				{
+					++width;
+				}
+
+				//Then along v while every cell of the next row matches
+				int32 height = 1;
+				for (; v + height < maskHeight; ++height)
+				{
+					const int32 rowStart = cell + height * maskWidth;
+					bool rowMatches = true;
+					for (int32 k = 0; k < width && rowMatches; ++k)
+					{
+						rowMatches = maskFilled[rowStart + k] && maskColors[rowStart + k] == color;
+					}
+
+					if (!rowMatches)
+					{
+						break;
+					}
+				}
+
+				for (int32 dv = 0; dv < height; ++dv)
+				{
+					for (int32 du = 0; du < width; ++du)
+					{
+						maskFilled[cell + dv * maskWidth + du] = false;
+					}
+				}
+
+				FCubiquityQuad merged = first;
+				merged.u = minU + u;
+				merged.v = minV + v;
+				merged.width = width;
+				merged.height = height;
+				merged.color = color;
+				outQuads.Add(merged);
+			}
+		}
+	}
+
+	TArray<FCubiquityQuad> quads;
+	TArray<FCubiquityQuad> mergedQuads;
+	TArray<FColor> maskColors;
+	TArray<bool> maskFilled;
+};
@@ -0,0 +1,272 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquityVoxelChunk.h"
+
+#include "CubiquityJoinSync.generated.h"
+
+/** A piece of one compressed chunk on its way to a late-joining client. Chunks are split so that no one message is large. */
+USTRUCT()
+struct FCubiquityChunkSlice
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Which chunk this is, as an index into FCubiquityChunkGrid */
+	UPROPERTY()
+	int32 chunkIndex = 0;
+
+	/** Where data goes in the compressed chunk */
+	UPROPERTY()
+	int32 offset = 0;
+
+	/** Size of the whole compressed chunk */
+	UPROPERTY()
+	int32 compressedBytes = 0;
+
+	UPROPERTY()
+	int32 uncompressedBytes = 0;
+
+	UPROPERTY()
+	TArray<uint8> data;
+
+	friend FArchive& operator<<(FArchive& ar, FCubiquityChunkSlice& slice)
+	{
+		return ar << slice.chunkIndex << slice.offset << slice.compressedBytes << slice.uncompressedBytes << slice.data;
+	}
+};
+
+/** A run of the server's chunk hashes. A volume can have far too many chunks to send the hashes of in one message. */
+USTRUCT()
+struct FCubiquityChunkHashPage
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** The chunk index of the first hash */
+	UPROPERTY()
+	int32 firstIndex = 0;
+
+	/** How many chunks the server's volume has */
+	UPROPERTY()
+	int32 totalChunks = 0;
+
+	/** The sequence number of the next edit op, which the chunks sent won't have */
+	UPROPERTY()
+	uint32 sequence = 0;
+
+	UPROPERTY()
+	TArray<uint32> hashes;
+
+	friend FArchive& operator<<(FArchive& ar, FCubiquityChunkHashPage& page)
+	{
+		return ar << page.firstIndex << page.totalChunks << page.sequence << page.hashes;
+	}
+};
+
+/** Every chunk of a volume, numbered x fastest then y then z, so that both ends of a join sync can refer to one by index */
+struct FCubiquityChunkGrid
+{
+	FIntVector lower = FIntVector(0, 0, 0); ///< The lowest chunk
+	FIntVector count = FIntVector(0, 0, 0); ///< Chunks along each axis
+
+	static FCubiquityChunkGrid of(const Cubiquity::Volume& volume);
+
+	int32 num() const { return count.X * count.Y * count.Z; }
+
+	FIntVector chunk(int32 index) const { return FIntVector(lower.X + index % count.X, lower.Y + (index / count.X) % count.Y, lower.Z + index / (count.X * count.Y)); }
+
+	/** \return INDEX_NONE if the chunk isn't in the volume */
+	int32 indexOf(const FIntVector& chunk) const;
+};
+
+/**
+ * A hash of every chunk in a volume, kept up to date for join syncs.
+ *
+ * Hashing a chunk reads all of its voxels, which is far too slow to do for a whole volume when a client asks. A first
+ * pass is spread over frames by update(), and after that only chunks which have changed are hashed again by flush().
+ */
+class FCubiquityChunkHashes
+{
+public:
+
+	/** Forget every hash and start a first pass over the volume */
+	void reset(const Cubiquity::Volume& volume);
+
+	/** Call after the voxels of chunks have changed */
+	void changed(const TArray<FIntVector>& chunks);
+
+	/** Carry on with the first pass for up to `seconds`, hashing at least one chunk */
+	void update(Cubiquity::Volume& volume, double seconds);
+
+	/** Hash every chunk which has changed since it was hashed, and any the first pass hasn't reached */
+	void flush(Cubiquity::Volume& volume);
+
+	/** Whether the first pass is done, after which flush() only has the changed chunks to hash */
+	bool hasAll() const { return started && firstPass >= hashes.Num(); }
+
+	const FCubiquityChunkGrid& grid() const { return chunkGrid; }
+
+	/** One per chunk of grid(). Only current straight after flush(). */
+	const TArray<uint32>& all() const { return hashes; }
+
+	int64 chunksHashed = 0;
+
+private:
+
+	void hash(Cubiquity::Volume& volume, int32 index);
+
+	bool started = false;
+	FCubiquityChunkGrid chunkGrid;
+	TArray<uint32> hashes;
+	int32 firstPass = 0; ///< Chunks before this have been hashed at least once
+	TSet<int32> changedChunks; ///< Chunks before firstPass which need hashing again
+	TArray<uint8> voxels;
+};
+
+/**
+ * The server side of bringing a late-joining client's volume up to date.
+ *
+ * The hash of every chunk in the volume is sent a page at a time. The client compares them with its own and answers
+ * with the chunks which differ, nearest its spawn point first, and those are streamed a slice at a time. The client
+ * has to end up with the chunks as they were at the edit sequence number the hashes were sent with, so rather than
+ * snapshotting the whole volume up front, a chunk is only copied if it is about to be edited before it has been sent.
+ */
+class FCubiquityJoinSyncServer
+{
+public:
+
+	/** Largest slice of a chunk sent at once */
+	enum { MaximumSliceBytes = 4096 };
+
+	/** Hashes in a page */
+	enum { HashesPerPage = 1024 };
+
+	/** Most chunk indices the client can ask for at once */
+	enum { MaximumIndicesPerRequest = 1024 };
+
+	/**
+	 * \param hashes the volume's hashes, just flushed
+	 * \param sequence the sequence number of the next edit op, which the chunks sent won't have
+	 */
+	void start(const FCubiquityChunkHashes& hashes, uint32 sequence);
+
+	/** The next page of hashes to send. \return false once they have all been sent */
+	bool nextHashPage(FCubiquityChunkHashPage& outPage);
+
+	int32 numChunks() const { return grid.num(); }
+
+	/** Call before the voxels within radius of position change, to keep any chunks the client may still need as they were */
+	void beforeEdit(Cubiquity::Volume& volume, const FVector& position, float radius);
+
+	/**
+	 * Part of the client's answer
+	 * \param indices chunks it needs, nearest its spawn point first
+	 * \param last whether this is the end of the answer
+	 */
+	void requestChunks(const TArray<int32>& indices, bool last);
+
+	/** The next piece to send. \return false if there's nothing to send until more is requested */
+	bool nextSlice(Cubiquity::Volume& volume, FCubiquityChunkSlice& outSlice);
+
+	bool hasRequest() const { return queue.Num() > 0 || requestComplete; }
+	bool isFinished() const { return requestComplete && queuePosition >= queue.Num() && sliceOffset == 0; }
+
+	int64 bytesSent = 0;
+	int32 chunksKept = 0; ///< Chunks copied because they were about to be edited before being sent
+	double snapshotSeconds = 0.0; ///< Spent reading and compressing chunks
+
+private:
+
+	void compressChunk(Cubiquity::Volume& volume, int32 index, int32& outUncompressedBytes, TArray<uint8>& outCompressed);
+
+	FCubiquityChunkGrid grid;
+	TArray<uint32> hashes;
+	uint32 snapshotSequence = 0;
+	int32 hashesSent = 0;
+
+	//Chunks as they were at the sequence number, copied before an edit changed them
+	struct FKeptChunk
+	{
+		int32 uncompressedBytes = 0;
+		TArray<uint8> compressed;
+	};
+	TMap<int32, FKeptChunk> kept;
+
+	bool requestComplete = false;
+	TSet<int32> requested;
+	TSet<int32> sent; ///< Chunks which have been read for sending, so later edits don't matter to this client
+	TArray<int32> queue;
+	int32 queuePosition = 0;
+
+	//The chunk being sent
+	int32 sliceOffset = 0;
+	int32 currentUncompressedBytes = 0;
+	TArray<uint8> current;
+	TArray<uint8> voxels;
+};
+
+/** The client side of a join sync: works out which chunks it needs and writes them as they arrive */
+class FCubiquityJoinSyncClient
+{
+public:
+
+	/**
+	 * \param spawnPoint where the player starts, in volume space
+	 * \param playableRadius voxels around the spawn point which have to be up to date before the player can carry on
+	 */
+	void start(const FVector& spawnPoint, float playableRadius);
+
+	/** Take a page of the server's hashes. \return false if it doesn't follow on from the pages before it */
+	bool receiveHashes(const FCubiquityChunkHashPage& page);
+
+	bool hasAllHashes() const { return hashesStarted && serverHashes.Num() == serverChunks; }
+
+	/** The sequence number the server's chunks are at */
+	uint32 sequence() const { return serverSequence; }
+
+	/**
+	 * List the chunks whose hashes differ from ours, nearest the spawn point first. None are if the server's volume
+	 * isn't the same size as ours, since its chunks wouldn't fit.
+	 * \param ours our volume's hashes, just flushed
+	 */
+	void compare(const FCubiquityChunkHashes& ours, TArray<int32>& outNeeded);
+
+	/**
+	 * Take a slice from the server, writing its chunk to the volume once all of it has arrived
+	 * \param outChunk the chunk written, if one was
+	 * \return whether a chunk was written
+	 */
+	bool receiveSlice(Cubiquity::Volume& volume, const FCubiquityChunkSlice& slice, FIntVector& outChunk);
+
+	/** Whether everything near the spawn point has arrived */
+	bool isPlayable() const { return compared && nearChunksRemaining == 0; }
+
+	bool isFinished() const { return compared && chunksRemaining == 0; }
+
+	int32 candidateChunks = 0; ///< Chunks the server sent hashes for
+	int32 neededChunks = 0; ///< Of those, the ones which differed here
+	int64 bytesReceived = 0;
+
+private:
+
+	bool isNear(const FIntVector& chunk) const;
+
+	FVector spawn = FVector::ZeroVector;
+	float radius = 0.0f;
+
+	bool hashesStarted = false;
+	int32 serverChunks = 0;
+	uint32 serverSequence = 0;
+	TArray<uint32> serverHashes;
+
+	bool compared = false;
+	FCubiquityChunkGrid grid;
+	TSet<int32> remaining;
+	int32 chunksRemaining = 0;
+	int32 nearChunksRemaining = 0;
+
+	//The chunk being put back together
+	int32 partialIndex = INDEX_NONE;
+	TArray<uint8> partial;
+	TArray<uint8> voxels;
+};
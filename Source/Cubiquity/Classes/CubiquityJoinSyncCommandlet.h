@@ -0,0 +1,34 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "CubiquityJoinSyncCommandlet.generated.h"
+
+/**
+ * Measures bringing a late-joining client up to date, with a server and a client in separate processes.
+ *
+ * The server applies a session recorded with "cubiquity.Record" to a copy of its volume, as if the game had been running
+ * for a while, then waits for a client on a local TCP port. The client opens its own copy of the unedited volume, as a
+ * player who has just installed the game would, and runs a join sync against the server over the same steps
+ * UCubiquityJoinSyncComponent uses, with the server pacing chunks to -KilobytesPerSecond. The client writes the seconds
+ * until the chunks within -PlayableRadius of -Spawn had arrived, the seconds until all had, and the bytes on the wire as
+ * JSON, and checks every chunk of the volume against the server's hash. Start the server first:
+ *
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquityJoinSync -nullrhi -Role=Server -Recording=Path/To.cqrec
+ *     [-Volume=Path/To.vdb] [-Port=7788] [-KilobytesPerSecond=512]
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquityJoinSync -nullrhi -Role=Client -Recording=Path/To.cqrec
+ *     [-Volume=Path/To.vdb] [-Server=127.0.0.1] [-Port=7788] [-Spawn=X,Y,Z] [-PlayableRadius=64] [-Output=Path/To.json]
+ */
+UCLASS()
+class UCubiquityJoinSyncCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityJoinSyncCommandlet(const FObjectInitializer& PCIP);
+
+	virtual int32 Main(const FString& Params) override;
+};
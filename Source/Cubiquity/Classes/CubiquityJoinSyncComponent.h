@@ -0,0 +1,75 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquityJoinSync.h"
+
+#include "CubiquityJoinSyncComponent.generated.h"
+
+class ACubiquityVolume;
+
+/**
+ * Carries join syncs between the server and one client.
+ *
+ * A volume is placed in the level rather than owned by a player so clients can't call server functions on it. Servers
+ * add one of these to each player controller, and the client's copy asks for each volume to be brought up to date once
+ * it has opened and hashed its chunks. The server's hashes and then the chunks the client needs are sent at up to
+ * ACubiquityVolume::joinSyncKilobytesPerSecond, and every message is kept small so a big volume can't flood the
+ * connection's reliable buffer.
+ */
+UCLASS()
+class UCubiquityJoinSyncComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityJoinSyncComponent(const FObjectInitializer& PCIP);
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Give every player controller in the world which doesn't have one of these one. Called by volumes on servers each frame. */
+	static void addToPlayerControllers(UWorld* world);
+
+	UFUNCTION(Server, Reliable, WithValidation)
+	void serverRequestJoinSync(ACubiquityVolume* volume, FVector spawnPoint);
+
+	UFUNCTION(Client, Reliable)
+	void clientJoinSyncHashes(ACubiquityVolume* volume, const FCubiquityChunkHashPage& page);
+
+	/** Part of the client's answer, at most FCubiquityJoinSyncServer::MaximumIndicesPerRequest chunks. \param last whether this is the end of it */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void serverRequestJoinSyncChunks(ACubiquityVolume* volume, const TArray<int32>& chunkIndices, bool last);
+
+	UFUNCTION(Client, Reliable)
+	void clientJoinSyncSlice(ACubiquityVolume* volume, const FCubiquityChunkSlice& slice);
+
+	UFUNCTION(Client, Reliable)
+	void clientJoinSyncFinished(ACubiquityVolume* volume);
+
+private:
+
+	//A sync this server is running for the client
+	struct FServerSession
+	{
+		TWeakObjectPtr<ACubiquityVolume> volume;
+		TSharedPtr<FCubiquityJoinSyncServer> sync; ///< nullptr until the server's volume has opened
+	};
+	TArray<FServerSession> sessions;
+
+	//Most pages of the client's answer sent a tick
+	enum { MaximumRequestsPerTick = 4 };
+
+	//A client's answer waiting to be sent
+	struct FClientRequest
+	{
+		TWeakObjectPtr<ACubiquityVolume> volume;
+		TArray<int32> chunkIndices;
+		int32 sent = 0;
+	};
+	TArray<FClientRequest> requests;
+
+	void tickServer(float DeltaTime);
+	void tickClient();
+	FServerSession* findSession(const ACubiquityVolume* volume);
+};
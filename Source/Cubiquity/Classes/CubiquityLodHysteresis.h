@@ -0,0 +1,43 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+/**
+ * Stops nodes flipping between LODs while the camera hovers near a switching distance.
+ *
+ * The eye handed to the library's update() only moves once the camera has gone more than `band` voxels from where it
+ * was last handed over, so jitter inside the band changes nothing. On top of that a node which has just started being
+ * drawn stays drawn for minimumNodeLifetime seconds, and a node actor lives at least that long after being spawned.
+ * While a node is held drawn the nodes under it wait hidden, so two LODs are never drawn over each other. A node actor
+ * kept after its node has gone is hidden and only kept to be reused if the node comes back.
+ */
+class FCubiquityLodHysteresis
+{
+public:
+
+	/** The eye to give the library for the camera being at `eye` */
+	FVector eyeFor(const FVector& eye);
+
+	/** Forget the held eye, e.g. when the volume is reopened */
+	void reset();
+
+	/** Whether something which started being drawn or was spawned at `since` is still too new to take away */
+	bool holdNode(double since, double now) const { return now - since < minimumNodeLifetime; }
+
+	/** Count LOD flips as they happen, giving flipsPerSecond() over the last second or so */
+	void countFlips(int32 flips, double now);
+
+	float flipsPerSecond() const { return lastFlipsPerSecond; }
+
+	float band = 0.0f; ///< In voxels
+	float minimumNodeLifetime = 0.0f; ///< In seconds
+
+private:
+
+	FVector heldEye = FVector::ZeroVector;
+	bool eyeHeld = false;
+
+	int32 flipsThisWindow = 0;
+	double windowStarted = 0.0;
+	float lastFlipsPerSecond = 0.0f;
+};
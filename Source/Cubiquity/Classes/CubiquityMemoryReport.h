@@ -0,0 +1,85 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquityMemoryReport.generated.h"
+
+/** Memory held by some of a volume's octree nodes. Meshes and collision shared between nodes are counted once, against the first node found using them. */
+USTRUCT(BlueprintType)
+struct FCubiquityMemoryUsage
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** Octree node actors */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 nodes = 0;
+
+	/** Distinct node meshes */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 meshes = 0;
+
+	/** Vertex, index and face arrays the mesh components keep on the CPU */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 meshCpuKilobytes = 0;
+
+	/** Vertex and index buffers the scene proxies have created on the GPU */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 meshGpuKilobytes = 0;
+
+	/** Cooked collision and physics meshes in the body setups */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 collisionKilobytes = 0;
+
+	/** The node actors, mesh components and body setups themselves */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 objectKilobytes = 0;
+
+	int32 totalKilobytes() const { return meshCpuKilobytes + meshGpuKilobytes + collisionKilobytes + objectKilobytes; }
+
+	void add(const FCubiquityMemoryUsage& other)
+	{
+		nodes += other.nodes;
+		meshes += other.meshes;
+		meshCpuKilobytes += other.meshCpuKilobytes;
+		meshGpuKilobytes += other.meshGpuKilobytes;
+		collisionKilobytes += other.collisionKilobytes;
+		objectKilobytes += other.objectKilobytes;
+	}
+};
+
+/** Where a volume's memory goes, from ACubiquityVolume::getMemoryReport() or the cubiquity.MemoryReport console command */
+USTRUCT(BlueprintType)
+struct FCubiquityMemoryReport
+{
+	GENERATED_USTRUCT_BODY()
+
+	/**
+	 * Size of the voxel database. CubiquityC doesn't tell us how much of it the library is caching in memory,
+	 * so this is what it would cost to hold the lot.
+	 */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 voxelDatabaseKilobytes = 0;
+
+	/** Voxel chunks edited since the last commitChanges() or discardChanges() */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 uncommittedChunks = 0;
+
+	/** What the uncommitted chunks take uncompressed. The library compresses them so this is an upper bound. */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 uncommittedKilobytes = 0;
+
+	/** Compressed chunks kept so that edit checkpoints can be restored */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	int32 checkpointKilobytes = 0;
+
+	/** Everything held by the octree nodes */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	FCubiquityMemoryUsage total;
+
+	/** The same broken down by octree height, indexed by height. Height 0 is full detail. */
+	UPROPERTY(BlueprintReadOnly, Category = "Cubiquity")
+	TArray<FCubiquityMemoryUsage> byHeight;
+
+	/** A table of the report for the log */
+	FString toString() const;
+};
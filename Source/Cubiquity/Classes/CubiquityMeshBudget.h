@@ -0,0 +1,46 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+class ACubiquityVolume;
+
+/**
+ * Keeps the node meshes of every Cubiquity volume within one memory budget, set with the cubiquity.MeshBudget console variable.
+ *
+ * A few times a second it adds up the CPU and GPU memory of every node mesh. When that is over budget it evicts the
+ * least valuable meshes, scored by how big the node is on screen and how long it is since it was last drawn. Nodes the
+ * octree isn't drawing (kept for quick LOD transitions) go first. Evicted nodes are converted again as soon as they are
+ * drawn. If evicting everything it may evict still doesn't fit, each volume's lodThreshold is scaled up until it does,
+ * and relaxed again once there has been room to spare for a while.
+ */
+class FCubiquityMeshBudget
+{
+public:
+
+	static FCubiquityMeshBudget& get();
+
+	void addVolume(ACubiquityVolume* volume);
+	void removeVolume(ACubiquityVolume* volume);
+
+	/** Called by every volume each tick. The work is only done a few times a second across all of them. */
+	void update();
+
+	/** The budget in bytes. 0 means there isn't one. */
+	uint64 budgetBytes() const;
+
+	/** What node meshes were using at the last update, in bytes */
+	uint64 usedBytes() const { return used; }
+
+private:
+
+	FCubiquityMeshBudget() {}
+
+	//Put each volume's lodThreshold scale up or down depending on how the last eviction pass went
+	void updateLodThresholdScales(uint64 budget, bool overBudget, double now);
+
+	TArray<TWeakObjectPtr<ACubiquityVolume>> volumes;
+
+	uint64 used = 0;
+	double lastUpdated = 0.0;
+	double lastOverBudget = 0.0;
+};
@@ -0,0 +1,52 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityMeshData.h"
+
+#include "CubiquityMeshCollision.generated.h"
+
+/**
+ * The cooked collision of one node mesh, shared by every node of a volume which uses that mesh.
+ * A body cooks from the triangles of its outer, so each shared body gets one of these as its outer rather than
+ * whichever component first needed it. These belong to the volume, which lets them go once the mesh is no longer in use.
+ */
+UCLASS(Transient)
+class UCubiquityMeshCollision : public UObject, public IInterface_CollisionDataProvider
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityMeshCollision(const FObjectInitializer& PCIP);
+
+	/** Make the body for a mesh. Nothing is cooked until a component creates its physics state. */
+	void initialise(const TSharedPtr<FCubiquityMeshData>& inMeshData, Cubiquity::VolumeType inVolumeType);
+
+	/** Whether the mesh this is the collision of is still in use by any node */
+	bool isInUse() const { return meshData.IsValid(); }
+
+	/** Throw away what was cooked from the mesh, for when its arrays have changed. The next CreatePhysicsMeshes() cooks them again. */
+	void invalidate();
+
+	/** Free the cooked meshes. Called by the volume once the mesh is no longer in use. */
+	void release();
+
+	// Begin Interface_CollisionDataProvider Interface
+	virtual bool GetPhysicsTriMeshData(struct FTriMeshCollisionData* CollisionData, bool InUseAllTriData) override;
+	virtual bool ContainsPhysicsTriMeshData(bool InUseAllTriData) const override;
+	virtual bool WantsNegXTriMesh() override { return false; }
+	// End Interface_CollisionDataProvider Interface
+
+	UPROPERTY()
+	class UBodySetup* bodySetup;
+
+private:
+
+	/** Weak so that the nodes alone decide how long the mesh lives */
+	TWeakPtr<FCubiquityMeshData> meshData;
+
+	Cubiquity::VolumeType volumeType;
+};
@@ -8,8 +8,8 @@
 
 #include <DynamicMeshBuilder.h>
 
-#include "CubiquityColoredCubesVertexFactory.h"
-#include "CubiquityTerrainVertexFactory.h"
+#include "CubiquityMeshData.h"
+#include "CubiquityMeshConverter.h"
 
 #include "CubiquityMeshComponent.generated.h"
 
@@ -26,12 +26,15 @@ public:
 	/** Set the geometry to use on this triangle mesh */
 	bool SetGeneratedMeshTriangles(const Cubiquity::OctreeNode& octreeNode);
 
-	bool SetGeneratedMeshTrianglesColoredCubes(const Cubiquity::OctreeNode& octreeNode);
-	bool SetGeneratedMeshTrianglesTerrain(const Cubiquity::OctreeNode& octreeNode);
-
 	UFUNCTION(BlueprintCallable, Category = "Components|GeneratedMesh")
 	bool ClearMeshTriangles();
 
+	/** Drop our reference to the mesh data without touching render or physics state. Used when the node is going away. */
+	void releaseMeshData();
+
+	/** The mesh this component draws. Possibly shared with other components of the same volume */
+	const TSharedPtr<FCubiquityMeshData>& getMeshData() const { return meshData; }
+
 	/** Description of collision */
 	UPROPERTY(BlueprintReadOnly, Category = "Collision")
 	class UBodySetup* ModelBodySetup;
@@ -62,10 +65,31 @@ private:
 	virtual FBoxSphereBounds CalcBounds(const FTransform & LocalToWorld) const override;
 	// Begin USceneComponent interface.
 
-	/** */
-	TArray<FDynamicMeshVertex> terrainVertices;
-	TArray<FColoredCubesVertex> coloredCubesVertices; //TODO It's horrible that we have a different vertex list for the different terrain types. This is due to differing vertex types and data layout.
-	TArray<int32> indices;
+	/** Our node, for labelling trace spans */
+	FCubiquityTraceNode traceNode() const;
+
+	/** The settings of our volume which change what a node's mesh is converted into */
+	FCubiquityConversionSettings conversionSettings() const;
+
+	/**
+	 * Look for a mesh identical to this payload which another node of the volume already has, or in the disk cache
+	 * \return an empty pointer if there isn't one
+	 */
+	TSharedPtr<FCubiquityMeshData> findExistingMesh(const FCubiquityMeshKey& key) const;
+
+	/**
+	 * Look for the node in the volume's baked mesh archive, which goes by where the node is so its mesh isn't touched
+	 * eturn an empty pointer if it isn't there
+	 */
+	TSharedPtr<FCubiquityMeshData> findBakedMesh(const Cubiquity::OctreeNode& octreeNode) const;
+
+	/** Let other nodes share a mesh we just built, and start optimising it if the volume wants that */
+	void shareNewMesh(const FCubiquityMeshKey& key, const TSharedPtr<FCubiquityMeshData>& newMeshData);
+
+	/** Switch to a different mesh and rebuild the physics and render state from it */
+	void setMeshData(const TSharedPtr<FCubiquityMeshData>& newMeshData, bool optimisationPending);
+
+	TSharedPtr<FCubiquityMeshData> meshData;
 
 	Cubiquity::VolumeType volumeType;
 
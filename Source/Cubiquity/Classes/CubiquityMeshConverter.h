@@ -0,0 +1,54 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityMeshData.h"
+
+struct FTriMeshCollisionData;
+
+/** The volume settings which change what a node's raw mesh is converted into */
+struct FCubiquityConversionSettings
+{
+	Cubiquity::VolumeType volumeType = Cubiquity::VolumeType::ColoredCubes;
+	bool optimiseMeshes = false;
+	bool greedyMeshing = false; ///< Colored cubes only
+	bool compactFaceStorage = false; ///< Colored cubes only
+
+	/** The settings as a set of flags, which go into the mesh key */
+	uint32 flags() const
+	{
+		return static_cast<uint32>(volumeType) | (optimiseMeshes ? 1 << 8 : 0) | (greedyMeshing ? 1 << 9 : 0) | (compactFaceStorage ? 1 << 10 : 0);
+	}
+};
+
+/**
+ * Turns the meshes Cubiquity extracts for octree nodes into our own mesh data.
+ * This is shared by the mesh components and the bake commandlet so that both produce byte-identical meshes and keys.
+ * Everything but optimise() uses the buffer pools so has to be called on the game thread.
+ */
+class FCubiquityMeshConverter
+{
+public:
+
+	/** The key for a node's current mesh with these settings */
+	static FCubiquityMeshKey keyForNode(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings);
+
+	/** Convert a node's mesh. The vertex cache optimisation is left to the caller, which can run optimise() wherever suits it. */
+	static void convert(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings, FCubiquityMeshData& outMeshData);
+
+	/** Reorder a copy of a mesh for the vertex cache. Safe to call on worker threads. */
+	static void optimise(FCubiquityOptimisedMesh& mesh, bool isTerrain);
+
+	/** Copy an optimised mesh back over the mesh data it was made from */
+	static void applyOptimisedMesh(const FCubiquityOptimisedMesh& optimisedMesh, FCubiquityMeshData& meshData);
+
+	/** Append a mesh's triangles to the data handed to the physics cooker */
+	static void stageCollision(const FCubiquityMeshData& meshData, Cubiquity::VolumeType volumeType, FTriMeshCollisionData& outCollisionData);
+
+private:
+
+	static void convertTerrain(const Cubiquity::OctreeNode& octreeNode, FCubiquityMeshData& outMeshData);
+	static void convertColoredCubes(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings, FCubiquityMeshData& outMeshData);
+};
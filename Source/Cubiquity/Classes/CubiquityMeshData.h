@@ -0,0 +1,215 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include <DynamicMeshBuilder.h>
+
+#include "CubiquityColoredCubesVertex.h"
+#include "CubiquityMeshOptimiser.h"
+#include "CubiquityPackedFaces.h"
+#include "CubiquityBufferPool.h"
+
+#include "Future.h"
+
+class UCubiquityMeshCollision;
+struct FGeneratedMeshRenderData;
+struct FColoredCubesRenderData;
+
+/**
+ * Identifies a node mesh by the content of the raw mesh Cubiquity gave us for it and the settings used to convert it.
+ * Node meshes are in node-local space so two nodes with the same payload end up with identical converted meshes.
+ */
+struct FCubiquityMeshKey
+{
+	FSHAHash hash;
+
+	/** \param conversionSettings anything which changes what the payload is converted into, as a set of flags */
+	static FCubiquityMeshKey fromPayload(const void* vertices, uint32 vertexBytes, const uint16* indices, uint32 noOfIndices, uint32 conversionSettings)
+	{
+		FSHA1 sha;
+		sha.Update(static_cast<const uint8*>(vertices), vertexBytes);
+		sha.Update(reinterpret_cast<const uint8*>(indices), noOfIndices * sizeof(uint16));
+		sha.Update(reinterpret_cast<const uint8*>(&conversionSettings), sizeof(conversionSettings));
+		sha.Final();
+
+		FCubiquityMeshKey key;
+		sha.GetHash(key.hash.Hash);
+		return key;
+	}
+
+	/** The first 128 bits of the hash, for things which want a GUID */
+	FGuid toGuid() const
+	{
+		FGuid guid;
+		FMemory::Memcpy(&guid, hash.Hash, sizeof(FGuid));
+		return guid;
+	}
+
+	bool operator==(const FCubiquityMeshKey& other) const
+	{
+		return hash == other.hash;
+	}
+
+	friend uint32 GetTypeHash(const FCubiquityMeshKey& key)
+	{
+		return FCrc::MemCrc32(key.hash.Hash, sizeof(key.hash.Hash));
+	}
+};
+
+/**
+ * A converted node mesh. This is shared between all the nodes of a volume whose raw meshes are identical,
+ * along with the GPU buffers made from it and the collision body cooked from it.
+ * It is only touched on the game thread, apart from the render data which the proxies own.
+ */
+struct FCubiquityMeshData
+{
+	~FCubiquityMeshData()
+	{
+		//Hand the allocations back to the pools rather than freeing them so the next node to be meshed can use them
+		TCubiquityBufferPool<FDynamicMeshVertex>::get().release(terrainVertices);
+		TCubiquityBufferPool<FColoredCubesVertex>::get().release(coloredCubesVertices);
+		TCubiquityBufferPool<int32>::get().release(indices);
+	}
+
+	/** What this mesh was converted from */
+	FCubiquityMeshKey key;
+
+	TArray<FDynamicMeshVertex> terrainVertices;
+	TArray<FColoredCubesVertex> coloredCubesVertices; //TODO It's horrible that we have a different vertex list for the different terrain types. This is due to differing vertex types and data layout.
+	TArray<int32> indices;
+
+	//Colored cubes meshes can instead be kept as one packed record per face. When these are used the arrays above are empty.
+	TArray<FCubiquityPackedFace> packedFaces;
+	TArray<FColor> facePalette;
+
+	/** Cooked collision, created by the volume for the first node to need it */
+	TWeakObjectPtr<UCubiquityMeshCollision> collision;
+
+	/** GPU buffers, created by the first proxy to need them and released with the last */
+	TWeakPtr<FGeneratedMeshRenderData, ESPMode::ThreadSafe> terrainRenderData;
+	TWeakPtr<FColoredCubesRenderData, ESPMode::ThreadSafe> coloredCubesRenderData;
+
+	bool hasTriangles() const
+	{
+		return ((terrainVertices.Num() > 0 || coloredCubesVertices.Num() > 0) && indices.Num() > 0) || packedFaces.Num() > 0;
+	}
+
+	/**
+	 * Identifies the triangles collision is cooked from, so the derived data cache hands back the right cooked body.
+	 * Unlike the key this changes when the mesh is optimised, since that reorders the triangles.
+	 */
+	FGuid collisionGuid() const
+	{
+		FSHA1 sha;
+		sha.Update(key.hash.Hash, sizeof(key.hash.Hash));
+		for (const FDynamicMeshVertex& vertex : terrainVertices)
+		{
+			sha.Update(reinterpret_cast<const uint8*>(&vertex.Position), sizeof(vertex.Position));
+		}
+		for (const FColoredCubesVertex& vertex : coloredCubesVertices)
+		{
+			sha.Update(reinterpret_cast<const uint8*>(&vertex.Position), sizeof(vertex.Position));
+		}
+		sha.Update(reinterpret_cast<const uint8*>(indices.GetData()), indices.Num() * sizeof(int32));
+		sha.Update(reinterpret_cast<const uint8*>(packedFaces.GetData()), packedFaces.Num() * sizeof(FCubiquityPackedFace));
+		sha.Final();
+
+		uint8 hash[20];
+		sha.GetHash(hash);
+		FGuid guid;
+		FMemory::Memcpy(&guid, hash, sizeof(FGuid));
+		return guid;
+	}
+
+	uint32 cpuBytes() const
+	{
+		return terrainVertices.GetAllocatedSize() + coloredCubesVertices.GetAllocatedSize() + indices.GetAllocatedSize() + packedFaces.GetAllocatedSize() + facePalette.GetAllocatedSize();
+	}
+
+	/** Size of the buffers this takes on the GPU. Packed faces are uploaded as they are, see FCubiquityPackedFacesVertexFactory. */
+	uint32 gpuBytes() const
+	{
+		return terrainVertices.Num() * sizeof(FDynamicMeshVertex) + coloredCubesVertices.Num() * sizeof(FColoredCubesVertex) + indices.Num() * sizeof(int32)
+			+ packedFaces.Num() * sizeof(FCubiquityPackedFace) + facePalette.Num() * sizeof(FColor);
+	}
+};
+
+/** A copy of a mesh which is being optimised on a worker thread */
+struct FCubiquityOptimisedMesh
+{
+	TArray<FDynamicMeshVertex> terrainVertices;
+	TArray<FColoredCubesVertex> coloredCubesVertices;
+	TArray<int32> indices;
+
+	FCubiquityVertexCacheStats before;
+	FCubiquityVertexCacheStats after;
+};
+
+/** A mesh and the optimised copy of it which a worker thread is making */
+struct FCubiquityPendingOptimisation
+{
+	TSharedPtr<FCubiquityMeshData> meshData;
+	TFuture<FCubiquityOptimisedMesh> result;
+};
+
+/** Memory saved by sharing meshes, as reported on each volume */
+struct FCubiquityMeshSharingStats
+{
+	int32 uniqueMeshes = 0; ///< Distinct meshes in use
+	int32 sharingNodes = 0; ///< Nodes using a mesh which another node also uses
+	uint64 bytesSaved = 0; ///< CPU and GPU bytes which would have been spent on duplicates
+};
+
+/**
+ * Finds the shared mesh data for a raw mesh payload. The cache only holds weak references: the nodes using
+ * a mesh keep it alive and it goes away with the last of them.
+ */
+class FCubiquityMeshCache
+{
+public:
+
+	TSharedPtr<FCubiquityMeshData> find(const FCubiquityMeshKey& key) const
+	{
+		const TWeakPtr<FCubiquityMeshData>* entry = entries.Find(key);
+		return entry ? entry->Pin() : TSharedPtr<FCubiquityMeshData>();
+	}
+
+	void add(const FCubiquityMeshKey& key, const TSharedPtr<FCubiquityMeshData>& meshData)
+	{
+		entries.Add(key, meshData);
+	}
+
+	void empty()
+	{
+		entries.Empty();
+	}
+
+	/** Drop entries whose meshes nobody uses any more and total up what sharing saves */
+	FCubiquityMeshSharingStats updateStatistics()
+	{
+		FCubiquityMeshSharingStats stats;
+
+		for (auto entry = entries.CreateIterator(); entry; ++entry)
+		{
+			const TSharedPtr<FCubiquityMeshData> meshData = entry.Value().Pin();
+			if (!meshData.IsValid())
+			{
+				entry.RemoveCurrent();
+				continue;
+			}
+
+			const int32 users = meshData.GetSharedReferenceCount() - 1; //Not counting our own reference
+			stats.uniqueMeshes++;
+			if (users > 1)
+			{
+				stats.sharingNodes += users;
+				stats.bytesSaved += uint64(users - 1) * (meshData->cpuBytes() + meshData->gpuBytes());
+			}
+		}
+
+		return stats;
+	}
+
+private:
+	TMap<FCubiquityMeshKey, TWeakPtr<FCubiquityMeshData>> entries;
+};
@@ -0,0 +1,79 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquityMeshData.h"
+
+/**
+ * Keeps converted node meshes on disk so that the next level load or PIE session can skip converting them.
+ *
+ * Entries live in Saved/Cubiquity/MeshCache, one directory per volume file, and are named by the mesh key. As the key is
+ * a hash of the raw mesh Cubiquity extracted plus the conversion settings, editing the volume simply produces different
+ * keys and there is nothing to invalidate. Each file also stores the key so that renamed or truncated files are rejected.
+ *
+ * Since edits leave old entries behind the directory is kept to a size and age limit. A hit touches the entry's timestamp,
+ * and once the entries add up to more than the limit the least recently used go first, down to nine tenths of it.
+ */
+class FCubiquityMeshDiskCache
+{
+public:
+
+	/**
+	 * Starts trimming the directory to the limits on a worker thread
+	 * \param volumeFileName the .vdb the meshes come from
+	 * \param maxBytes how big the entries may get in total. 0 for no limit.
+	 * \param maxAgeDays entries not used for this long are deleted. 0 to keep them however old they are.
+	 */
+	FCubiquityMeshDiskCache(const FString& volumeFileName, int64 maxBytes, int32 maxAgeDays);
+
+	/**
+	 * Fill in the mesh data for `key` from disk
+	 * \return false if there is no valid entry, in which case the mesh data is left empty
+	 */
+	bool load(const FCubiquityMeshKey& key, FCubiquityMeshData& outMeshData) const;
+
+	/** Write an entry for the mesh data. The file is written on a worker thread. */
+	void save(const FCubiquityMeshData& meshData) const;
+
+	/** Delete every entry for this volume */
+	void clear() const;
+
+	/** Block until every save() and trim started so far has finished. For the benchmark, which reads back what it just wrote. */
+	void flush() const;
+
+	/** Roughly what the entries take on disk, as of the last trim plus what has been saved since */
+	int64 bytesOnDisk() const { return int64(state->kilobytesOnDisk.GetValue()) * 1024; }
+
+	/** Entries deleted to keep within the limits since this was created */
+	int32 entriesEvicted() const { return state->entriesEvicted.GetValue(); }
+
+	/** Append the on-disk form of a mesh. This is also the entry format of baked mesh archives. */
+	static void writeEntry(const FCubiquityMeshData& meshData, TArray<uint8>& outBytes);
+
+	/**
+	 * Read a mesh back from its on-disk form
+	 * \return false if the entry is damaged or isn't for `key`, in which case the mesh data is left empty
+	 */
+	static bool readEntry(const uint8* bytes, int64 size, const FCubiquityMeshKey& key, FCubiquityMeshData& outMeshData);
+
+private:
+
+	FString entryPath(const FCubiquityMeshKey& key) const;
+
+	/** Start a trim on a worker thread unless one is already going */
+	void startTrim() const;
+
+	/** What the workers share with the cache, so that it can go away while they are still running */
+	struct FSharedState
+	{
+		FThreadSafeCounter tasksInFlight;
+		FThreadSafeCounter kilobytesOnDisk;
+		FThreadSafeCounter entriesEvicted;
+		FThreadSafeCounter trimming;
+	};
+
+	FString directory;
+	int64 maxBytes;
+	int32 maxAgeDays;
+	TSharedRef<FSharedState, ESPMode::ThreadSafe> state;
+};
@@ -0,0 +1,295 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+/** Results of simulating a post-transform vertex cache over an index buffer */
+struct FCubiquityVertexCacheStats
+{
+	float acmr = 0.0f; ///< Average cache miss ratio. Vertex shader runs per triangle: 3.0 is worst, 0.5 is the best a regular grid can do
+	float atvr = 0.0f; ///< Average transform to vertex ratio. Vertex shader runs per referenced vertex: 1.0 is perfect
+};
+
+/**
+ * Reorders node meshes to make better use of the GPU's post-transform vertex cache and vertex fetch.
+ *
+ * The triangle reordering is Tom Forsyth's 'Linear-Speed Vertex Cache Optimisation' which greedily emits the triangle
+ * whose vertices score best given an LRU model of the cache. Vertices are then renumbered in the order the new index
+ * buffer first uses them so that fetches walk forwards through memory.
+ *
+ * None of this touches UObjects so it is safe to run on worker threads.
+ */
+class FCubiquityMeshOptimiser
+{
+public:
+
+	/** Reorder the triangles of an indexed triangle list in place */
+	static void optimiseVertexCache(TArray<int32>& indices, int32 vertexCount)
+	{
+		const int32 triangleCount = indices.Num() / 3;
+		if (triangleCount == 0)
+		{
+			return;
+		}
+
+		//Build the vertex to triangle adjacency as one flat array with an offset per vertex
+		TArray<int32> remainingTriangles;
+		remainingTriangles.AddZeroed(vertexCount);
+		for (const int32 index : indices)
+		{
+			remainingTriangles[index]++;
+		}
+
+		TArray<int32> adjacencyOffsets;
+		adjacencyOffsets.AddUninitialized(vertexCount);
+		int32 offset = 0;
+		for (int32 vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			adjacencyOffsets[vertex] = offset;
+			offset += remainingTriangles[vertex];
+		}
+
+		TArray<int32> adjacency;
+		adjacency.AddUninitialized(indices.Num());
+		{
+			TArray<int32> fillCursor = adjacencyOffsets;
+			for (int32 i = 0; i < indices.Num(); ++i)
+			{
+				adjacency[fillCursor[indices[i]]++] = i / 3;
+			}
+		}
+
+		TArray<int32> cachePosition;
+		cachePosition.Init(-1, vertexCount);
+
+		TArray<float> vertexScores;
+		vertexScores.AddUninitialized(vertexCount);
+		for (int32 vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			vertexScores[vertex] = vertexScore(-1, remainingTriangles[vertex]);
+		}
+
+		TArray<float> triangleScores;
+		triangleScores.AddUninitialized(triangleCount);
+		TArray<bool> triangleAdded;
+		triangleAdded.AddZeroed(triangleCount);
+
+		int32 bestTriangle = 0;
+		for (int32 triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+			if (triangleScores[triangle] > triangleScores[bestTriangle])
+			{
+				bestTriangle = triangle;
+			}
+		}
+
+		TArray<int32> output;
+		output.Reserve(indices.Num());
+
+		int32 cache[CacheSize + 3];
+		int32 cacheCount = 0;
+		int32 scanCursor = 0;
+
+		for (int32 emitted = 0; emitted < triangleCount; ++emitted)
+		{
+			if (bestTriangle == INDEX_NONE)
+			{
+				//Nothing in the cache touches a remaining triangle so just start again from the next unused one
+				while (triangleAdded[scanCursor])
+				{
+					++scanCursor;
+				}
+				bestTriangle = scanCursor;
+			}
+
+			const int32 triangle = bestTriangle;
+			triangleAdded[triangle] = true;
+
+			int32 newCache[CacheSize + 3];
+			int32 newCacheCount = 0;
+
+			for (int32 corner = 0; corner < 3; ++corner)
+			{
+				const int32 vertex = indices[triangle * 3 + corner];
+				output.Add(vertex);
+
+				//Take this triangle out of the vertex's list of remaining triangles
+				const int32 first = adjacencyOffsets[vertex];
+				const int32 last = first + remainingTriangles[vertex] - 1;
+				for (int32 j = first; j <= last; ++j)
+				{
+					if (adjacency[j] == triangle)
+					{
+						Swap(adjacency[j], adjacency[last]);
+						break;
+					}
+				}
+				remainingTriangles[vertex]--;
+
+				if (!containsVertex(newCache, newCacheCount, vertex))
+				{
+					newCache[newCacheCount++] = vertex;
+				}
+			}
+
+			//The rest of the old cache moves down behind this triangle's vertices
+			for (int32 i = 0; i < cacheCount; ++i)
+			{
+				if (!containsVertex(newCache, newCacheCount, cache[i]))
+				{
+					newCache[newCacheCount++] = cache[i];
+				}
+			}
+
+			//Rescore everything whose cache position changed, including anything which just fell out
+			for (int32 i = 0; i < newCacheCount; ++i)
+			{
+				const int32 vertex = newCache[i];
+				cachePosition[vertex] = (i < CacheSize) ? i : -1;
+
+				const float newScore = vertexScore(cachePosition[vertex], remainingTriangles[vertex]);
+				const float scoreChange = newScore - vertexScores[vertex];
+				vertexScores[vertex] = newScore;
+
+				const int32 first = adjacencyOffsets[vertex];
+				for (int32 j = first; j < first + remainingTriangles[vertex]; ++j)
+				{
+					triangleScores[adjacency[j]] += scoreChange;
+				}
+			}
+
+			//The next triangle is the best one touching the cache
+			bestTriangle = INDEX_NONE;
+			float bestScore = -1.0f;
+			cacheCount = FMath::Min(newCacheCount, static_cast<int32>(CacheSize));
+			for (int32 i = 0; i < cacheCount; ++i)
+			{
+				cache[i] = newCache[i];
+
+				const int32 first = adjacencyOffsets[cache[i]];
+				for (int32 j = first; j < first + remainingTriangles[cache[i]]; ++j)
+				{
+					const int32 candidate = adjacency[j];
+					if (triangleScores[candidate] > bestScore)
+					{
+						bestScore = triangleScores[candidate];
+						bestTriangle = candidate;
+					}
+				}
+			}
+		}
+
+		Exchange(indices, output);
+	}
+
+	/**
+	 * Renumber the vertices in the order the index buffer first uses them.
+	 * Vertices which no triangle references are dropped.
+	 */
+	template <typename VertexType>
+	static void optimiseVertexFetch(TArray<VertexType>& vertices, TArray<int32>& indices)
+	{
+		TArray<int32> remap;
+		remap.Init(INDEX_NONE, vertices.Num());
+
+		TArray<VertexType> reordered;
+		reordered.Reserve(vertices.Num());
+
+		for (int32& index : indices)
+		{
+			if (remap[index] == INDEX_NONE)
+			{
+				remap[index] = reordered.Num();
+				reordered.Add(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		Exchange(vertices, reordered);
+	}
+
+	/**
+	 * Run the index buffer through a FIFO post-transform cache, which is how most hardware behaves.
+	 * This lets us measure how well a mesh is ordered without going near a GPU.
+	 */
+	static FCubiquityVertexCacheStats simulateVertexCache(const TArray<int32>& indices, int32 vertexCount, int32 simulatedCacheSize = 16)
+	{
+		FCubiquityVertexCacheStats result;
+
+		const int32 triangleCount = indices.Num() / 3;
+		if (triangleCount == 0)
+		{
+			return result;
+		}
+
+		//A vertex is in the cache if fewer than simulatedCacheSize misses have happened since it was loaded
+		TArray<int32> loadedAtMiss;
+		loadedAtMiss.Init(-simulatedCacheSize - 1, vertexCount);
+
+		int32 misses = 0;
+		int32 referencedVertices = 0;
+		for (const int32 index : indices)
+		{
+			if (misses - loadedAtMiss[index] > simulatedCacheSize)
+			{
+				if (loadedAtMiss[index] < -simulatedCacheSize)
+				{
+					++referencedVertices;
+				}
+				loadedAtMiss[index] = misses++;
+			}
+		}
+
+		result.acmr = static_cast<float>(misses) / triangleCount;
+		result.atvr = static_cast<float>(misses) / FMath::Max(referencedVertices, 1);
+		return result;
+	}
+
+private:
+
+	enum { CacheSize = 32 };
+
+	static float vertexScore(int32 position, int32 remaining)
+	{
+		const float CacheDecayPower = 1.5f;
+		const float LastTriangleScore = 0.75f;
+		const float ValenceBoostScale = 2.0f;
+		const float ValenceBoostPower = 0.5f;
+
+		if (remaining == 0)
+		{
+			return -1.0f; //Nothing left to draw with this vertex
+		}
+
+		float score = 0.0f;
+		if (position >= 0)
+		{
+			if (position < 3)
+			{
+				//It was used by the last triangle. Fixed score so we don't favour any particular corner.
+				score = LastTriangleScore;
+			}
+			else
+			{
+				score = FMath::Pow(1.0f - (position - 3) * (1.0f / (CacheSize - 3)), CacheDecayPower);
+			}
+		}
+
+		//Favour vertices with few triangles left so we finish them off rather than leave lone triangles behind
+		score += ValenceBoostScale * FMath::Pow(static_cast<float>(remaining), -ValenceBoostPower);
+
+		return score;
+	}
+
+	static bool containsVertex(const int32* cache, int32 count, int32 vertex)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			if (cache[i] == vertex)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
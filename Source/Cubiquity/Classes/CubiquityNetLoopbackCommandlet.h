@@ -0,0 +1,31 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "CubiquityNetLoopbackCommandlet.generated.h"
+
+/**
+ * Checks and measures edit replication without a network, using a session recorded with "cubiquity.Record".
+ *
+ * Two copies of the recorded volume are opened, one for the server and one for a client. The server quantises and
+ * applies each recorded edit as ACubiquityVolume does and batches them at the net update rate. Each batch goes through
+ * NetSerialize to the client, which decodes and applies it. At the end every voxel of the two copies is compared.
+ * -Reorder delivers batches in swapped pairs to exercise the client putting them back in order. A recorded digging
+ * session makes a good bandwidth benchmark. Bytes per batch, per op and per second are written as JSON.
+ *
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquityNetLoopback -nullrhi -Recording=Path/To.cqrec [-Volume=Path/To.vdb]
+ *     [-NetUpdateRate=30] [-Reorder] [-Output=Path/To.json]
+ */
+UCLASS()
+class UCubiquityNetLoopbackCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityNetLoopbackCommandlet(const FObjectInitializer& PCIP);
+
+	virtual int32 Main(const FString& Params) override;
+};
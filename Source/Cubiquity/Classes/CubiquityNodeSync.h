@@ -0,0 +1,339 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityEditLatency.h"
+#include "CubiquityLodHysteresis.h"
+
+/** What a walk of the octree nodes may do on top of each branch's sync allowance, and what it left for later */
+struct FCubiquityNodeSyncBudget
+{
+	bool limitHiddenNodes = false; ///< Whether meshes of nodes which aren't drawn are rate limited
+	int32 hiddenNodeSyncs = 0; ///< How many of those may still be converted on this walk
+	int32 hiddenNodesDeferred = 0; ///< Those left out of date for a later walk
+	int32 nodesOverAllowance = 0; ///< Changed nodes left out of step because their branch had used its allowance
+	int32 nodesVisited = 0;
+
+	const FCubiquityLodHysteresis* lod = nullptr; ///< If not nullptr, how long new nodes are held on to
+	double now = 0.0;
+	int32 lodChangesHeld = 0; ///< Nodes kept drawn or hidden, or actors kept alive, because of a node too new to take away
+	int32 lodFlips = 0; ///< Nodes which started or stopped being drawn
+
+	//Anything which leaves a node out of step means the walk has to come back
+	int32 leftForLater() const { return hiddenNodesDeferred + nodesOverAllowance + lodChangesHeld; }
+};
+
+/**
+ * The allowance of hidden coarse node syncs, which builds up at a steady rate. It is kept small so it can't save up
+ * for a burst.
+ */
+struct FCubiquityCoarseNodeAllowance
+{
+	float allowance = 0.0f;
+	double lastTopped = 0.0;
+
+	/** Top up the allowance and hand it to a walk's budget. With `lazy` off hidden nodes aren't limited. */
+	void begin(FCubiquityNodeSyncBudget& budget, bool lazy, float syncsPerSecond, double now)
+	{
+		budget.limitHiddenNodes = lazy;
+		if (lazy)
+		{
+			const float rate = FMath::Max(syncsPerSecond, 0.1f);
+			allowance = FMath::Min(allowance + static_cast<float>(now - lastTopped) * rate, FMath::Max(rate, 1.0f));
+			budget.hiddenNodeSyncs = FMath::FloorToInt(allowance);
+		}
+		lastTopped = now;
+	}
+
+	/** Take what the walk spent out of the allowance */
+	void end(const FCubiquityNodeSyncBudget& budget)
+	{
+		if (budget.limitHiddenNodes)
+		{
+			allowance -= FMath::FloorToInt(allowance) - budget.hiddenNodeSyncs;
+		}
+	}
+};
+
+/** How far a node is in step with the library, as kept by whatever mirrors the octree */
+struct FCubiquityNodeSyncState
+{
+	uint32 structureLastSynced = 0;
+	uint32 propertiesLastSynced = 0;
+	uint32 meshLastSynced = 0;
+	uint32 nodeAndChildrenLastSynced = 0;
+	bool renderThisNode = false;
+	bool meshEvicted = false; ///< The memory budget took the mesh away. It comes back once the node is drawn.
+	double renderedSince = 0.0; ///< When renderThisNode last became true
+	double spawnedAt = 0.0;
+};
+
+/**
+ * The octree walks ACubiquityOctreeNode makes each frame, shared with FCubiquitySyncSimulator so that the benchmark and
+ * replay commandlets time the same decisions the volume makes: which LOD changes are held, which hidden meshes are
+ * deferred or left evicted, which meshes are synced before a node is shown, and when a branch counts as settled.
+ *
+ * NodeType mirrors one octree node and provides:
+ *   FCubiquityNodeSyncState& syncState();
+ *   void syncMesh(const Cubiquity::OctreeNode& octreeNode); //Convert or clear the mesh. The walk stamps meshLastSynced.
+ *   void setMeshVisible(bool visible);
+ *   NodeType* getChild(uint32 x, uint32 y, uint32 z);
+ *   NodeType* spawnChild(const Cubiquity::OctreeNode& childNode, uint32 x, uint32 y, uint32 z);
+ *   void destroyChild(uint32 x, uint32 y, uint32 z);
+ */
+template <typename NodeType>
+class TCubiquityNodeSync
+{
+public:
+
+	/**
+	 * Bring a node and the nodes under it in step with the library
+	 * \param availableNodeSyncs how many meshes this branch may sync. Each child gets what its parent left.
+	 * \param ancestorDrawn whether a node above is drawn, which only happens while it is held drawn
+	 * \return the number of meshes synced
+	 */
+	static int32 processOctreeNode(NodeType& node, const Cubiquity::OctreeNode& octreeNode, int32 availableNodeSyncs, FCubiquityNodeSyncBudget& budget, bool ancestorDrawn)
+	{
+		FCubiquityNodeSyncState& state = node.syncState();
+		int32 nodeSyncsPerformed = 0;
+		budget.nodesVisited++;
+
+		if (octreeNode.nodeOrChildrenLastChanged() <= state.nodeAndChildrenLastSynced)
+		{
+			return nodeSyncsPerformed;
+		}
+
+		//Only meshes come out of the allowance. A branch which has used it is still walked, so that nodes under one which
+		//has just been drawn are hidden on the same frame rather than drawn over.
+		const int32 leftForLaterBefore = budget.leftForLater();
+
+		if (octreeNode.propertiesLastChanged() > state.propertiesLastSynced)
+		{
+			const bool render = octreeNode.renderThisNode();
+
+			if (state.renderThisNode && !render && !ancestorDrawn && budget.lod && budget.lod->holdNode(state.renderedSince, budget.now))
+			{
+				//Only just started being drawn, so stay drawn a little longer. The properties stay unsynced so the walk comes back.
+				budget.lodChangesHeld++;
+			}
+			else if (!state.renderThisNode && render && ancestorDrawn)
+			{
+				//A node above is being held drawn, so this waits rather than drawing over it
+				budget.lodChangesHeld++;
+			}
+			else if (render && (state.meshEvicted || octreeNode.meshLastChanged() > state.meshLastSynced) && availableNodeSyncs <= 0)
+			{
+				//Needs its mesh before it can be shown, which the branch can't afford until a later walk
+				budget.nodesOverAllowance++;
+			}
+			else
+			{
+				//The first sync of a new node isn't a flip
+				if (render != state.renderThisNode && state.propertiesLastSynced > 0)
+				{
+					budget.lodFlips++;
+				}
+				if (render && !state.renderThisNode)
+				{
+					state.renderedSince = budget.now;
+				}
+				state.renderThisNode = render;
+
+				//An evicted node has to get its mesh back as soon as it is drawn
+				if (state.renderThisNode && state.meshEvicted)
+				{
+					state.meshEvicted = false;
+					state.meshLastSynced = 0;
+				}
+
+				//So is one which was deferred while hidden, before it is shown, or its old mesh would be drawn for a frame
+				if (state.renderThisNode && octreeNode.meshLastChanged() > state.meshLastSynced)
+				{
+					syncMesh(node, octreeNode);
+
+					availableNodeSyncs--;
+					nodeSyncsPerformed++;
+				}
+
+				node.setMeshVisible(state.renderThisNode);
+
+				state.propertiesLastSynced = Cubiquity::currentTime();
+			}
+		}
+
+		if (octreeNode.meshLastChanged() > state.meshLastSynced && state.meshEvicted)
+		{
+			//Don't spend time converting a mesh the memory budget took away. Restoring it brings it back.
+			state.meshLastSynced = Cubiquity::currentTime();
+		}
+		else if (octreeNode.meshLastChanged() > state.meshLastSynced && !state.renderThisNode && budget.limitHiddenNodes && budget.hiddenNodeSyncs <= 0)
+		{
+			//Nothing is drawing this coarser node yet so it can wait. It stays out of date so the next walk comes back for it.
+			budget.hiddenNodesDeferred++;
+		}
+		else if (octreeNode.meshLastChanged() > state.meshLastSynced && availableNodeSyncs <= 0)
+		{
+			//The parent mustn't count this branch as synced or nothing brings the walk back to it
+			budget.nodesOverAllowance++;
+		}
+		else if (octreeNode.meshLastChanged() > state.meshLastSynced)
+		{
+			if (!state.renderThisNode && budget.limitHiddenNodes)
+			{
+				budget.hiddenNodeSyncs--;
+			}
+
+			syncMesh(node, octreeNode);
+
+			availableNodeSyncs--;
+			nodeSyncsPerformed++;
+		}
+
+		if (octreeNode.structureLastChanged() > state.structureLastSynced)
+		{
+			bool childrenHeld = false;
+
+			for (uint32 z = 0; z < 2; z++)
+			{
+				for (uint32 y = 0; y < 2; y++)
+				{
+					for (uint32 x = 0; x < 2; x++)
+					{
+						NodeType* const child = node.getChild(x, y, z);
+
+						if (octreeNode.hasChildNode({ x, y, z }))
+						{
+							if (!child)
+							{
+								node.spawnChild(octreeNode.childNode({ x, y, z }), x, y, z);
+							}
+						}
+						else if (child && budget.lod && budget.lod->holdNode(child->syncState().spawnedAt, budget.now))
+						{
+							//Too new to delete, so only hidden. It is picked up again if the child node comes back before it would have been.
+							hide(*child);
+							budget.lodChangesHeld++;
+							childrenHeld = true;
+						}
+						else if (child)
+						{
+							node.destroyChild(x, y, z);
+						}
+					}
+				}
+			}
+
+			if (!childrenHeld)
+			{
+				state.structureLastSynced = Cubiquity::currentTime();
+			}
+		}
+
+		for (uint32 z = 0; z < 2; z++)
+		{
+			for (uint32 y = 0; y < 2; y++)
+			{
+				for (uint32 x = 0; x < 2; x++)
+				{
+					if (octreeNode.hasChildNode({ x, y, z }))
+					{
+						nodeSyncsPerformed += processOctreeNode(*node.getChild(x, y, z), octreeNode.childNode({ x, y, z }), availableNodeSyncs, budget, ancestorDrawn || state.renderThisNode);
+					}
+				}
+			}
+		}
+
+		if (budget.leftForLater() == leftForLaterBefore)
+		{
+			state.nodeAndChildrenLastSynced = Cubiquity::currentTime();
+		}
+
+		return nodeSyncsPerformed;
+	}
+
+	/**
+	 * The edit fast lane: sync the drawn nodes over recent edits, whatever else is waiting, and note which edits they now show
+	 * \param availableNodeSyncs the fast lane's allowance, shared by the whole walk
+	 * \return the number of meshes synced
+	 */
+	static int32 processEditedNodes(NodeType& node, const Cubiquity::OctreeNode& octreeNode, FCubiquityEditLatency& edits, uint32 baseNodeSize, int32& availableNodeSyncs)
+	{
+		FCubiquityNodeSyncState& state = node.syncState();
+		int32 nodeSyncsPerformed = 0;
+
+		if (!edits.touches(octreeNode, baseNodeSize))
+		{
+			return nodeSyncsPerformed;
+		}
+
+		//Coarser nodes which aren't drawn are left to processOctreeNode()
+		if (octreeNode.renderThisNode() && !state.meshEvicted)
+		{
+			if (octreeNode.meshLastChanged() > state.meshLastSynced && availableNodeSyncs > 0)
+			{
+				syncMesh(node, octreeNode);
+
+				availableNodeSyncs--;
+				nodeSyncsPerformed++;
+			}
+
+			//Until processOctreeNode() has caught up with the node's properties it may not be showing
+			edits.visit(octreeNode, baseNodeSize, octreeNode.meshLastChanged() <= state.meshLastSynced && state.renderThisNode);
+		}
+
+		for (uint32 z = 0; z < 2; z++)
+		{
+			for (uint32 y = 0; y < 2; y++)
+			{
+				for (uint32 x = 0; x < 2; x++)
+				{
+					//Children processOctreeNode() hasn't made yet are picked up once it has
+					NodeType* const child = node.getChild(x, y, z);
+					if (octreeNode.hasChildNode({ x, y, z }) && child)
+					{
+						nodeSyncsPerformed += processEditedNodes(*child, octreeNode.childNode({ x, y, z }), edits, baseNodeSize, availableNodeSyncs);
+					}
+				}
+			}
+		}
+
+		return nodeSyncsPerformed;
+	}
+
+	/** Stop drawing a node and everything under it, for one kept after the octree dropped it */
+	static void hide(NodeType& node)
+	{
+		FCubiquityNodeSyncState& state = node.syncState();
+		state.renderThisNode = false;
+		node.setMeshVisible(false);
+
+		//If the node comes back this is synced again as though it were new, apart from keeping its mesh
+		state.structureLastSynced = 0;
+		state.propertiesLastSynced = 0;
+		state.nodeAndChildrenLastSynced = 0;
+
+		for (uint32 z = 0; z < 2; z++)
+		{
+			for (uint32 y = 0; y < 2; y++)
+			{
+				for (uint32 x = 0; x < 2; x++)
+				{
+					if (NodeType* const child = node.getChild(x, y, z))
+					{
+						hide(*child);
+					}
+				}
+			}
+		}
+	}
+
+private:
+
+	static void syncMesh(NodeType& node, const Cubiquity::OctreeNode& octreeNode)
+	{
+		node.syncMesh(octreeNode);
+		node.syncState().meshLastSynced = Cubiquity::currentTime();
+	}
+};
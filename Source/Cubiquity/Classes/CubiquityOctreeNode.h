@@ -6,6 +6,9 @@
 
 #include "Cubiquity.hpp"
 
+#include "CubiquityTrace.h"
+#include "CubiquityNodeSync.h"
+
 #include "CubiquityOctreeNode.generated.h"
 
 class ACubiquityVolume;
@@ -28,22 +31,56 @@ public:
 
 	void initialiseOctreeNode(const Cubiquity::OctreeNode& newOctreeNode, UMaterialInterface* material);
 
-	int processOctreeNode(const Cubiquity::OctreeNode& octreeNode, int availableNodeSyncs);
+	//ancestorDrawn is whether a node actor above this one is drawn, which only happens while it is held drawn
+	int processOctreeNode(const Cubiquity::OctreeNode& octreeNode, int availableNodeSyncs, FCubiquityNodeSyncBudget& budget, bool ancestorDrawn);
+
+	//The edit fast lane: sync the drawn nodes over recent edits, whatever else is waiting, and note which edits they now show
+	int processEditedNodes(const Cubiquity::OctreeNode& octreeNode, FCubiquityEditLatency& edits, uint32 baseNodeSize, int& availableNodeSyncs);
 
 	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
 	ACubiquityVolume* getVolume() const;
 
+	//Whether Cubiquity is drawing this node. Nodes which aren't drawn are kept around to make LOD transitions quick.
+	bool isRendered() const { return sync.renderThisNode; }
+
+	bool isMeshEvicted() const { return sync.meshEvicted; }
+
+	//How far up the octree the node is. 0 is full detail.
+	int32 getHeight() const { return height; }
+
+	UCubiquityMeshComponent* getMeshComponent() const { return mesh; }
+
+	//Throw away the node's mesh to save memory. It is converted again when the node is next drawn or restoreMesh() is called.
+	void evictMesh();
+
+	//Have the node's mesh converted again on the volume's next update
+	void restoreMesh();
+
+	//Where the node is, for labelling trace spans
+	FCubiquityTraceNode traceNode() const { return FCubiquityTraceNode(volumePosition, height); }
+
 private:
 
+	//The walks themselves are shared with FCubiquitySyncSimulator. These are what they need of a node.
+	friend class TCubiquityNodeSync<ACubiquityOctreeNode>;
+
+	FCubiquityNodeSyncState& syncState() { return sync; }
+
+	//Bring the mesh component in step with the library's mesh for the node
+	void syncMesh(const Cubiquity::OctreeNode& octreeNode);
+
+	void setMeshVisible(bool visible);
+
+	ACubiquityOctreeNode* getChild(uint32 x, uint32 y, uint32 z) const { return children[x][y][z]; }
+	ACubiquityOctreeNode* spawnChild(const Cubiquity::OctreeNode& childNode, uint32 x, uint32 y, uint32 z);
+	void destroyChild(uint32 x, uint32 y, uint32 z);
+
 	ACubiquityOctreeNode* children[2][2][2];
 
 	UCubiquityMeshComponent* mesh = nullptr;
 
-	uint32_t structureLastSynced = 0;
-	uint32_t propertiesLastSynced = 0;
-	uint32_t meshLastSynced = 0;
-	uint32_t nodeAndChildrenLastSynced = 0;
+	FCubiquityNodeSyncState sync;
+	FIntVector volumePosition = FIntVector(0, 0, 0);
 	uint8_t height = 0;
-	bool renderThisNode = false;
 	
 };
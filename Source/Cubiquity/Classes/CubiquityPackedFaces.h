@@ -0,0 +1,157 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquityGreedyMesher.h"
+
+/**
+ * A colored cubes face, or a rectangle of merged faces, packed into 8 bytes.
+ * Storing one of these per face instead of four FColoredCubesVertex and six indices cuts 88 bytes down to 8.
+ * The faces go to the GPU as they are and FCubiquityPackedFacesVertexFactory turns each into two triangles in the vertex shader.
+ */
+struct FCubiquityPackedFace
+{
+	uint8 x; ///< Lower corner of the face in the node's voxel-corner space
+	uint8 y;
+	uint8 z;
+	uint8 direction; ///< Which way the face points: axis * 2, plus 1 if it faces along the negative axis
+	uint8 widthMinusOne; ///< Extent along the first in-plane axis, minus one so 256 fits
+	uint8 heightMinusOne; ///< Extent along the second in-plane axis, minus one
+	uint16 colorIndex; ///< Index into the node's palette
+};
+
+static_assert(sizeof(FCubiquityPackedFace) == 8, "FCubiquityPackedFace should pack into 8 bytes");
+
+/**
+ * Converts colored cubes quads to and from the packed face representation.
+ * Colours are stored once per node in a palette since a node rarely uses more than a handful.
+ */
+class FCubiquityPackedFaces
+{
+public:
+
+	/**
+	 * \return false if a quad can't be packed (outside the 0-255 range a node's mesh uses, or too many colours)
+	 */
+	static bool packQuads(const TArray<FCubiquityQuad>& quads, TArray<FCubiquityPackedFace>& outFaces, TArray<FColor>& outPalette)
+	{
+		outFaces.Reset();
+		outPalette.Reset();
+		outFaces.Reserve(quads.Num());
+
+		for (const FCubiquityQuad& quad : quads)
+		{
+			int32 corner[3];
+			corner[quad.axis] = quad.plane;
+			corner[(quad.axis + 1) % 3] = quad.u;
+			corner[(quad.axis + 2) % 3] = quad.v;
+
+			for (int32 a = 0; a < 3; ++a)
+			{
+				if (corner[a] < 0 || corner[a] > 255)
+				{
+					return false;
+				}
+			}
+
+			if (quad.width < 1 || quad.width > 256 || quad.height < 1 || quad.height > 256)
+			{
+				return false;
+			}
+
+			//Faces from the same node share a handful of colours so a linear search is fine, and quads of one colour tend to be together
+			int32 colorIndex = INDEX_NONE;
+			for (int32 i = outPalette.Num() - 1; i >= 0; --i)
+			{
+				if (outPalette[i] == quad.color)
+				{
+					colorIndex = i;
+					break;
+				}
+			}
+
+			if (colorIndex == INDEX_NONE)
+			{
+				if (outPalette.Num() > MAX_uint16)
+				{
+					return false;
+				}
+				colorIndex = outPalette.Add(quad.color);
+			}
+
+			FCubiquityPackedFace face;
+			face.x = corner[0];
+			face.y = corner[1];
+			face.z = corner[2];
+			face.direction = quad.axis * 2 + (quad.positive ? 0 : 1);
+			face.widthMinusOne = quad.width - 1;
+			face.heightMinusOne = quad.height - 1;
+			face.colorIndex = colorIndex;
+			outFaces.Add(face);
+		}
+
+		return true;
+	}
+
+	static FCubiquityQuad unpackFace(const FCubiquityPackedFace& face, const TArray<FColor>& palette)
+	{
+		const int32 corner[3] = { face.x, face.y, face.z };
+
+		FCubiquityQuad quad;
+		quad.axis = face.direction / 2;
+		quad.positive = (face.direction % 2) == 0;
+		quad.plane = corner[quad.axis];
+		quad.u = corner[(quad.axis + 1) % 3];
+		quad.v = corner[(quad.axis + 2) % 3];
+		quad.width = face.widthMinusOne + 1;
+		quad.height = face.heightMinusOne + 1;
+		quad.color = palette[face.colorIndex];
+		return quad;
+	}
+
+	/**
+	 * The four corners of a face in node space, in the order emitQuads() makes them.
+	 * CubiquityPackedFacesVertexFactory.usf builds the same corners on the GPU, so keep the two in step.
+	 */
+	static void faceCorners(const FCubiquityPackedFace& face, FVector outCorners[4])
+	{
+		const int32 axis = face.direction / 2;
+		const int32 uAxis = (axis + 1) % 3;
+		const int32 vAxis = (axis + 2) % 3;
+		const int32 corner[3] = { face.x, face.y, face.z };
+
+		const int32 width = face.widthMinusOne + 1;
+		const int32 height = face.heightMinusOne + 1;
+		const int32 cornerU[4] = { 0, width, width, 0 };
+		const int32 cornerV[4] = { 0, 0, height, height };
+
+		for (int32 c = 0; c < 4; ++c)
+		{
+			outCorners[c][axis] = corner[axis] - 0.5f;
+			outCorners[c][uAxis] = corner[uAxis] + cornerU[c] - 0.5f;
+			outCorners[c][vAxis] = corner[vAxis] + cornerV[c] - 0.5f;
+		}
+	}
+
+	/** Which of faceCorners() each of a face's six triangle-list vertices uses, wound as emitQuads() winds them */
+	static const int32* triangleCorners(const FCubiquityPackedFace& face)
+	{
+		static const int32 facingPositive[6] = { 0, 1, 2, 0, 2, 3 };
+		static const int32 facingNegative[6] = { 0, 2, 1, 0, 3, 2 };
+		return (face.direction % 2) == 0 ? facingPositive : facingNegative;
+	}
+
+	/** Expand packed faces back to a triangle list, four vertices and six indices per face. Only for hardware without buffer reads in the vertex shader. */
+	template <typename VertexType>
+	static void expandFaces(const TArray<FCubiquityPackedFace>& faces, const TArray<FColor>& palette, TArray<VertexType>& vertices, TArray<int32>& indices)
+	{
+		TArray<FCubiquityQuad> quads;
+		quads.Reserve(faces.Num());
+		for (const FCubiquityPackedFace& face : faces)
+		{
+			quads.Add(unpackFace(face, palette));
+		}
+
+		FCubiquityGreedyMesher::emitQuads(quads, vertices, indices);
+	}
+};
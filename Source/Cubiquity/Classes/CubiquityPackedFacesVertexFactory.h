@@ -0,0 +1,116 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "VertexFactory.h"
+
+#include "CubiquityPackedFaces.h"
+
+/** A node's packed faces on the GPU, read by the vertex shader as a Buffer<uint2> */
+class FCubiquityPackedFaceBuffer : public FVertexBuffer
+{
+public:
+	TArray<FCubiquityPackedFace> Faces;
+	FShaderResourceViewRHIRef ShaderResourceView;
+
+	virtual void InitRHI() override
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		VertexBufferRHI = RHICreateVertexBuffer(Faces.Num() * sizeof(FCubiquityPackedFace), BUF_Static | BUF_ShaderResource, CreateInfo);
+
+		void* BufferData = RHILockVertexBuffer(VertexBufferRHI, 0, Faces.Num() * sizeof(FCubiquityPackedFace), RLM_WriteOnly);
+		FMemory::Memcpy(BufferData, Faces.GetData(), Faces.Num() * sizeof(FCubiquityPackedFace));
+		RHIUnlockVertexBuffer(VertexBufferRHI);
+
+		ShaderResourceView = RHICreateShaderResourceView(VertexBufferRHI, sizeof(FCubiquityPackedFace), PF_R32G32_UINT);
+	}
+
+	virtual void ReleaseRHI() override
+	{
+		ShaderResourceView.SafeRelease();
+		FVertexBuffer::ReleaseRHI();
+	}
+};
+
+/** A node's face palette on the GPU, read by the vertex shader as a Buffer<uint> and unpacked there */
+class FCubiquityFacePaletteBuffer : public FVertexBuffer
+{
+public:
+	TArray<FColor> Palette;
+	FShaderResourceViewRHIRef ShaderResourceView;
+
+	virtual void InitRHI() override
+	{
+		FRHIResourceCreateInfo CreateInfo;
+		VertexBufferRHI = RHICreateVertexBuffer(Palette.Num() * sizeof(FColor), BUF_Static | BUF_ShaderResource, CreateInfo);
+
+		void* BufferData = RHILockVertexBuffer(VertexBufferRHI, 0, Palette.Num() * sizeof(FColor), RLM_WriteOnly);
+		FMemory::Memcpy(BufferData, Palette.GetData(), Palette.Num() * sizeof(FColor));
+		RHIUnlockVertexBuffer(VertexBufferRHI);
+
+		ShaderResourceView = RHICreateShaderResourceView(VertexBufferRHI, sizeof(FColor), PF_R32_UINT);
+	}
+
+	virtual void ReleaseRHI() override
+	{
+		ShaderResourceView.SafeRelease();
+		FVertexBuffer::ReleaseRHI();
+	}
+};
+
+/**
+ * Shader parameters for FCubiquityPackedFacesVertexFactory.
+ */
+class FCubiquityPackedFacesVertexFactoryShaderParameters : public FVertexFactoryShaderParameters
+{
+public:
+	virtual void Bind(const FShaderParameterMap& ParameterMap) override;
+	virtual void Serialize(FArchive& Ar) override;
+	virtual void SetMesh(FRHICommandList& RHICmdList, FShader* Shader, const FVertexFactory* VertexFactory, const FSceneView& View, const FMeshBatchElement& BatchElement, uint32 DataFlags) const override;
+
+private:
+	FShaderResourceParameter PackedFacesParameter;
+	FShaderResourceParameter FacePaletteParameter;
+};
+
+/**
+ * Draws colored cubes straight from packed faces. There are no vertex or index buffers: the mesh is drawn as a
+ * non-indexed triangle list of six vertices per face and the vertex shader uses SV_VertexID to find its face
+ * and corner. Needs buffer reads in the vertex shader, so SM4 and up.
+ */
+class FCubiquityPackedFacesVertexFactory : public FVertexFactory
+{
+	DECLARE_VERTEX_FACTORY_TYPE(FCubiquityPackedFacesVertexFactory);
+public:
+
+	FCubiquityPackedFacesVertexFactory()
+		: PackedFaces(nullptr)
+		, FacePalette(nullptr)
+	{}
+
+	struct DataType : public FVertexFactory::DataType
+	{
+		/** Nothing is read from this. The declaration has to have a stream so it is bound to a single zero vertex with no stride. */
+		FVertexStreamComponent DummyComponent;
+	};
+
+	/** Called by the scene proxy to point the factory at the buffers it reads from */
+	void Init(const FCubiquityPackedFaceBuffer* InPackedFaces, const FCubiquityFacePaletteBuffer* InFacePalette);
+
+	void InitRHI() override;
+
+	static bool isSupported(ERHIFeatureLevel::Type FeatureLevel) { return FeatureLevel >= ERHIFeatureLevel::SM4; }
+
+	static FCubiquityPackedFacesVertexFactoryShaderParameters* ConstructShaderParameters(EShaderFrequency ShaderFrequency);
+
+	/**
+	* Should we cache the material's shadertype on this platform with this vertex factory?
+	*/
+	static bool ShouldCache(EShaderPlatform Platform, const class FMaterial* Material, const class FShaderType* ShaderType);
+
+	const FCubiquityPackedFaceBuffer* PackedFaces;
+	const FCubiquityFacePaletteBuffer* FacePalette;
+
+protected:
+	DataType Data;
+};
@@ -0,0 +1,33 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "CubiquityReplayCommandlet.generated.h"
+
+/**
+ * Replays a session recorded with "cubiquity.Record" or ACubiquityVolume::startRecording() without an editor or a GPU.
+ *
+ * The recorded volume is copied and every edit is applied to the copy at the same point in the camera path as it was
+ * made. Each recorded frame updates the volume from the recorded eye and syncs as many nodes as the volume would
+ * have, then the run carries on from the last eye until everything is synced. Frame times, how long edits took to be
+ * fully synced, nodes synced per frame and peak memory are written as JSON.
+ *
+ * -LodHysteresisBand and -MinimumNodeLifetime replay with ACubiquityVolume's LOD hysteresis. When either is given the
+ * recording is also replayed without it and both runs' LOD flips per second are reported.
+ *
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquityReplay -nullrhi -Recording=Path/To.cqrec [-Volume=Path/To.vdb]
+ *     [-SyncsPerFrame=1] [-BaseNodeSize=32] [-LodHysteresisBand=0] [-MinimumNodeLifetime=0] [-Output=Path/To.json]
+ */
+UCLASS()
+class UCubiquityReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityReplayCommandlet(const FObjectInitializer& PCIP);
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,30 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "CubiquitySaveEditsCommandlet.generated.h"
+
+/**
+ * Times saving and loading uncommitted edits as ACubiquityVolume::saveEdits() and loadEdits() do.
+ *
+ * A synthetic volume is generated and committed, then scattered with brush strokes until the chunks they touch add up to
+ * -Megabytes of voxels, as a long single-player session might leave it. Those chunks are saved, the blob is loaded
+ * into a fresh copy of the committed volume and every chunk is checked against the original. The blob size and save and
+ * load times are written as JSON, next to a commit of the same edits for comparison.
+ *
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquitySaveEdits -nullrhi [-Type=ColoredCubes|Terrain] [-Megabytes=100]
+ *     [-StrokesPerChunk=4] [-Seed=0] [-Output=Path/To.json]
+ */
+UCLASS()
+class UCubiquitySaveEditsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquitySaveEditsCommandlet(const FObjectInitializer& PCIP);
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,132 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquityMeshConverter.h"
+#include "CubiquityVoxelChunk.h"
+
+/** What a recorded event did to the volume */
+enum class ECubiquityRecordedOp : uint8
+{
+	Camera, ///< One frame: the eye the volume was updated from and the LOD threshold it used
+	SetColoredCubesVoxel,
+	SetTerrainVoxel,
+	SculptTerrain,
+	CommitChanges,
+	DiscardChanges,
+	PaintTerrain,
+	FillColoredCubesRegion,
+	FillTerrainRegion,
+	BlurTerrain,
+	Explosion, ///< FCubiquityExplosion::apply() with the islands it finds thrown away
+	WriteChunk, ///< A whole voxel chunk written back, as restoring a checkpoint does
+	BrushKernel, ///< FCubiquityBrushEngine::apply() with a brush FCubiquityBrushEngine::save() wrote
+};
+
+/** One call made on a volume while recording, with when it was made */
+struct FCubiquityRecordedEvent
+{
+	float time = 0.0f; ///< Seconds since recording started
+	ECubiquityRecordedOp op = ECubiquityRecordedOp::Camera;
+	FVector position = FVector::ZeroVector; ///< Volume space. The eye for Camera events and the centre of the region for the Fill events.
+	FVector extent = FVector::ZeroVector; ///< Fill events only: half the size of the region, so it runs from position - extent to position + extent inclusive
+	float innerRadius = 0.0f; ///< SculptTerrain, PaintTerrain and BlurTerrain, and the crater radius for Explosion
+	float outerRadius = 0.0f; ///< SculptTerrain, PaintTerrain and BlurTerrain, the crater radius plus falloff for Explosion, and the largest half-extent for BrushKernel
+	float opacity = 0.0f; ///< SculptTerrain, PaintTerrain and BlurTerrain, and the crater roughness for Explosion
+	float lodThreshold = 0.0f; ///< Camera only
+	uint64 value = 0; ///< The packed FColor or material set for the SetVoxel and Fill events, the material index for PaintTerrain, the island search margin for Explosion, the uncompressed size for WriteChunk
+	TArray<uint8> payload; ///< WriteChunk: the voxels as FCubiquityVoxelChunk::compress() left them, with position the middle of the chunk. BrushKernel: the brush.
+
+	/** Make the call again on a volume, which must be the type the op is for */
+	void applyTo(Cubiquity::Volume& volume) const;
+
+	/** How far around position the op changes voxels */
+	float radius() const
+	{
+		switch (op)
+		{
+		case ECubiquityRecordedOp::SculptTerrain:
+		case ECubiquityRecordedOp::PaintTerrain:
+		case ECubiquityRecordedOp::BlurTerrain:
+		case ECubiquityRecordedOp::BrushKernel:
+			return outerRadius;
+		case ECubiquityRecordedOp::FillColoredCubesRegion:
+		case ECubiquityRecordedOp::FillTerrainRegion:
+			return extent.GetMax();
+		case ECubiquityRecordedOp::Explosion:
+			return outerRadius + opacity * innerRadius + static_cast<float>(value); //As FCubiquityExplosion::reach()
+		case ECubiquityRecordedOp::WriteChunk:
+			return (FCubiquityVoxelChunk::Size - 1) * 0.5f; //Just inside the chunk so no neighbour is counted
+		default:
+			return 0.0f;
+		}
+	}
+
+	/** Whether the op changes voxels, rather than being a camera update or a commit or discard */
+	bool isVoxelEdit() const { return op != ECubiquityRecordedOp::Camera && op != ECubiquityRecordedOp::CommitChanges && op != ECubiquityRecordedOp::DiscardChanges; }
+
+	/** \param withExtent false to read events from recordings older than the Fill events */
+	void serialize(FArchive& ar, bool withExtent)
+	{
+		uint8 opValue = static_cast<uint8>(op);
+		ar << time << opValue << position;
+		if (withExtent)
+		{
+			ar << extent;
+		}
+		ar << innerRadius << outerRadius << opacity << lodThreshold << value;
+		op = static_cast<ECubiquityRecordedOp>(opValue);
+
+		//Older recordings can't have any so their layout is unchanged
+		if (op == ECubiquityRecordedOp::WriteChunk || op == ECubiquityRecordedOp::BrushKernel)
+		{
+			ar << payload;
+		}
+	}
+
+	friend FArchive& operator<<(FArchive& ar, FCubiquityRecordedEvent& event)
+	{
+		event.serialize(ar, true);
+		return ar;
+	}
+};
+
+/**
+ * The camera path and edits of a play session on one volume, so that it can be replayed exactly by the
+ * CubiquityReplay commandlet to compare sync performance between builds.
+ *
+ * Use "cubiquity.Record Start" and "cubiquity.Record Stop [File]" from the console, or startRecording() and
+ * stopRecording() on a volume. The replay starts from the volume's file as it is on disk, so commit or discard
+ * any changes before starting a recording.
+ */
+class FCubiquitySessionRecording
+{
+public:
+
+	/** Clear any events and start timing from now */
+	void start(const FString& inVolumeFileName, uint32 inBaseNodeSize, const FCubiquityConversionSettings& inSettings);
+
+	void record(FCubiquityRecordedEvent event);
+
+	bool save(const FString& path) const;
+	bool load(const FString& path);
+
+	const TArray<FCubiquityRecordedEvent>& events() const { return recordedEvents; }
+
+	/** The file the recorded volume was opened from */
+	const FString& volumeFileName() const { return recordedVolumeFileName; }
+
+	/** The node size the recorded volume was opened with */
+	uint32 baseNodeSize() const { return recordedBaseNodeSize; }
+
+	/** How the recorded volume converted its meshes */
+	const FCubiquityConversionSettings& conversionSettings() const { return settings; }
+
+private:
+
+	FString recordedVolumeFileName;
+	uint32 recordedBaseNodeSize = 32;
+	FCubiquityConversionSettings settings;
+	TArray<FCubiquityRecordedEvent> recordedEvents;
+	double started = 0.0;
+};
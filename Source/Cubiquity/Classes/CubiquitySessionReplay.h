@@ -0,0 +1,58 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CubiquitySessionRecording.h"
+#include "CubiquitySyncSimulator.h"
+
+/** What replaying a recording measured */
+struct FCubiquityReplayResult
+{
+	FCubiquitySamples frameTimes; ///< Milliseconds to update the volume and sync its nodes
+	FCubiquitySamples nodesPerFrame;
+	FCubiquitySamples syncLatency; ///< Milliseconds from an edit until every node was synced
+	FCubiquitySamples syncLatencyFrames; ///< The same in frames
+
+	int32 recordedFrames = 0;
+	int32 settleFrames = 0; ///< Frames run after the recording ended to let the volume catch up
+	int32 edits = 0;
+	bool settled = false;
+	double runSeconds = 0.0;
+
+	int32 nodesSynced = 0;
+	int32 meshesConverted = 0;
+	int32 meshesShared = 0;
+	int64 verticesConverted = 0;
+	uint64 peakMeshBytes = 0; ///< Most CPU and GPU mesh memory the synced nodes held at once
+
+	float lodHysteresisBand = 0.0f;
+	float minimumNodeLifetime = 0.0f;
+	int32 lodFlips = 0; ///< Nodes which started or stopped being drawn
+	int32 lodChangesHeld = 0;
+	float recordedSeconds = 0.0f; ///< How long the recording ran for, which lodFlips is per
+
+	float lodFlipsPerSecond() const { return recordedSeconds > 0.0f ? lodFlips / recordedSeconds : 0.0f; }
+
+	/** Everything above as the body of a JSON object, without the braces */
+	FString toJsonFields();
+};
+
+/**
+ * Replays a recorded session against a copy of a volume file with the octree walked as the node actors walk it.
+ * Used by the CubiquityReplay and CubiquityTune commandlets.
+ */
+class FCubiquitySessionReplay
+{
+public:
+
+	/**
+	 * \param volumeFileName the volume the recording starts from. It is copied so is left untouched.
+	 * \param baseNodeSize the node size to open the copy with, which needn't be the one recorded with
+	 * \param syncsPerFrame how many nodes to sync each frame, as the volume hands to its root node
+	 * \param lodHysteresisBand and minimumNodeLifetime as ACubiquityVolume's properties of the same names, with the
+	 *     recording's own clock for the lifetime. The recorded camera is the camera before any band was applied.
+	 * \return false if the volume couldn't be copied
+	 */
+	static bool run(const FCubiquitySessionRecording& recording, const FString& volumeFileName, uint32 baseNodeSize, int32 syncsPerFrame, FCubiquityReplayResult& outResult,
+		float lodHysteresisBand = 0.0f, float minimumNodeLifetime = 0.0f);
+};
@@ -0,0 +1,122 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("Cubiquity"), STATGROUP_Cubiquity, STATCAT_Advanced);
+
+//Octree sync
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Volume update"), STAT_CubiquityVolumeUpdate, STATGROUP_Cubiquity, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Octree traversal"), STAT_CubiquityOctreeTraversal, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nodes visited"), STAT_CubiquityNodesVisited, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Nodes synced"), STAT_CubiquityNodesSynced, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Node actors spawned"), STAT_CubiquityNodeActorsSpawned, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Node actors destroyed"), STAT_CubiquityNodeActorsDestroyed, STATGROUP_Cubiquity, );
+
+//Mesh conversion
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh conversion"), STAT_CubiquityMeshConversion, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Vertices converted"), STAT_CubiquityVerticesConverted, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Indices converted"), STAT_CubiquityIndicesConverted, STATGROUP_Cubiquity, );
+
+//Collision
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Collision cook"), STAT_CubiquityCollisionCook, STATGROUP_Cubiquity, );
+
+//Rendering
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Proxy creation"), STAT_CubiquityProxyCreation, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Proxies created"), STAT_CubiquityProxiesCreated, STATGROUP_Cubiquity, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Terrain proxy GetDynamicMeshElements"), STAT_CubiquityTerrainProxyDraw, STATGROUP_Cubiquity, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Colored cubes proxy GetDynamicMeshElements"), STAT_CubiquityColoredCubesProxyDraw, STATGROUP_Cubiquity, );
+
+//Mesh memory. Sampled by the mesh budget a few times a second with shared meshes counted once
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Mesh CPU memory"), STAT_CubiquityMeshCpuMemory, STATGROUP_Cubiquity, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Mesh GPU memory"), STAT_CubiquityMeshGpuMemory, STATGROUP_Cubiquity, );
+
+//Mesh buffer pooling
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mesh buffer allocations"), STAT_CubiquityBufferAllocations, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mesh buffer reuses"), STAT_CubiquityBufferReuses, STATGROUP_Cubiquity, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Pooled mesh buffer memory"), STAT_CubiquityPooledBufferMemory, STATGROUP_Cubiquity, );
+
+//Greedy meshing
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Greedy meshing"), STAT_CubiquityGreedyMeshing, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Greedy triangles in"), STAT_CubiquityGreedyTrianglesIn, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Greedy triangles out"), STAT_CubiquityGreedyTrianglesOut, STATGROUP_Cubiquity, );
+
+//Vertex cache optimisation
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh optimisation"), STAT_CubiquityMeshOptimisation, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Optimised triangles"), STAT_CubiquityOptimisedTriangles, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Vertex cache misses before"), STAT_CubiquityVertexCacheMissesBefore, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Vertex cache misses after"), STAT_CubiquityVertexCacheMissesAfter, STATGROUP_Cubiquity, );
+
+//Mesh sharing
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mesh cache hits"), STAT_CubiquityMeshCacheHits, STATGROUP_Cubiquity, );
+
+//Mesh disk cache
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh disk cache read"), STAT_CubiquityMeshDiskCacheRead, STATGROUP_Cubiquity, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh disk cache write"), STAT_CubiquityMeshDiskCacheWrite, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mesh disk cache hits"), STAT_CubiquityMeshDiskCacheHits, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mesh disk cache misses"), STAT_CubiquityMeshDiskCacheMisses, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Mesh disk cache evictions"), STAT_CubiquityMeshDiskCacheEvictions, STATGROUP_Cubiquity, );
+
+//Baked mesh archives
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Baked mesh read"), STAT_CubiquityBakedMeshRead, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Baked mesh hits"), STAT_CubiquityBakedMeshHits, STATGROUP_Cubiquity, );
+
+//Mesh memory budget
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Mesh budget update"), STAT_CubiquityMeshBudgetUpdate, STATGROUP_Cubiquity, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Mesh memory budget"), STAT_CubiquityMeshBudget, STATGROUP_Cubiquity, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Mesh memory used"), STAT_CubiquityMeshMemoryUsed, STATGROUP_Cubiquity, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Evicted nodes"), STAT_CubiquityEvictedNodes, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Node evictions"), STAT_CubiquityNodeEvictions, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Node restores"), STAT_CubiquityNodeRestores, STATGROUP_Cubiquity, );
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("LOD threshold scale"), STAT_CubiquityLodThresholdScale, STATGROUP_Cubiquity, );
+
+//Committing edits to the voxel database
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Last commit seconds"), STAT_CubiquityLastCommitSeconds, STATGROUP_Cubiquity, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Commits queued"), STAT_CubiquityCommitsQueued, STATGROUP_Cubiquity, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Voxel bytes committed (uncompressed estimate)"), STAT_CubiquityCommittedBytes, STATGROUP_Cubiquity, );
+
+//Edit checkpoints
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Checkpoint chunk save"), STAT_CubiquityCheckpointSave, STATGROUP_Cubiquity, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Checkpoint restore"), STAT_CubiquityCheckpointRestore, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Checkpoint chunks saved"), STAT_CubiquityCheckpointChunksSaved, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Checkpoint chunks restored"), STAT_CubiquityCheckpointChunksRestored, STATGROUP_Cubiquity, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Checkpoint memory"), STAT_CubiquityCheckpointMemory, STATGROUP_Cubiquity, );
+
+//Edit replication
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Edit ops sent"), STAT_CubiquityEditOpsSent, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Edit bytes sent"), STAT_CubiquityEditBytesSent, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Edit bytes received"), STAT_CubiquityEditBytesReceived, STATGROUP_Cubiquity, );
+
+//Late-join sync
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Join sync bytes sent"), STAT_CubiquityJoinSyncBytesSent, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Join sync bytes received"), STAT_CubiquityJoinSyncBytesReceived, STATGROUP_Cubiquity, );
+
+//Save game edits
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Save edits"), STAT_CubiquitySaveEdits, STATGROUP_Cubiquity, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load edits"), STAT_CubiquityLoadEdits, STATGROUP_Cubiquity, );
+
+//Brush coalescing
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Brushes merged"), STAT_CubiquityBrushesMerged, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Re-meshes avoided (estimated)"), STAT_CubiquityRemeshesAvoided, STATGROUP_Cubiquity, );
+
+//Plugin-side brushes
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Brush read"), STAT_CubiquityBrushRead, STATGROUP_Cubiquity, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Brush compute"), STAT_CubiquityBrushCompute, STATGROUP_Cubiquity, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Brush write"), STAT_CubiquityBrushWrite, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Brush voxels processed"), STAT_CubiquityBrushVoxelsProcessed, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Brush voxels written"), STAT_CubiquityBrushVoxelsWritten, STATGROUP_Cubiquity, );
+
+//Explosions
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Explosion"), STAT_CubiquityExplosion, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Islands detached"), STAT_CubiquityIslandsDetached, STATGROUP_Cubiquity, );
+
+//Edit fast lane
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("Edit to visible ms"), STAT_CubiquityEditLatency, STATGROUP_Cubiquity, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Fast lane node syncs"), STAT_CubiquityFastLaneSyncs, STATGROUP_Cubiquity, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Coarse nodes deferred"), STAT_CubiquityCoarseNodesDeferred, STATGROUP_Cubiquity, );
+
+//LOD hysteresis
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("LOD flips"), STAT_CubiquityLodFlips, STATGROUP_Cubiquity, );
+DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(TEXT("LOD flips per second"), STAT_CubiquityLodFlipsPerSecond, STATGROUP_Cubiquity, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("LOD changes held"), STAT_CubiquityLodChangesHeld, STATGROUP_Cubiquity, );
@@ -0,0 +1,139 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+#include "CubiquityMeshData.h"
+#include "CubiquityMeshConverter.h"
+#include "CubiquityEditLatency.h"
+#include "CubiquityLodHysteresis.h"
+#include "CubiquityNodeSync.h"
+#include "CubiquityMeshDiskCache.h"
+
+/** A set of timings or counts with the percentiles the benchmark reports want */
+class FCubiquitySamples
+{
+public:
+
+	void add(double sample) { samples.Add(sample); }
+
+	/** Add a duration in seconds as milliseconds */
+	void addSeconds(double seconds) { samples.Add(seconds * 1000.0); }
+
+	int32 num() const { return samples.Num(); }
+	double total() const;
+
+	/** Sorts the samples, so only call once everything has been added */
+	double percentile(double fraction);
+
+	/** count, total, mean, p50, p90, p99 and max as a JSON object, each named with the given unit, e.g. "p50_ms" */
+	FString toJson(const TCHAR* unit = TEXT("ms"));
+
+private:
+
+	TArray<double> samples;
+};
+
+/**
+ * Keeps a copy of a volume's node meshes in step with the library the way the octree node actors do, but without
+ * a world. Each changed node goes through the same key, conversion and collision staging as a mesh component.
+ * Used by the benchmark and replay commandlets to time the pipeline headlessly.
+ *
+ * The node states form a tree as the actors do and are walked by the same TCubiquityNodeSync, so LOD changes are held,
+ * hidden coarse nodes deferred and evicted meshes left alone exactly as the volume does it.
+ */
+class FCubiquitySyncSimulator
+{
+public:
+
+	explicit FCubiquitySyncSimulator(const FCubiquityConversionSettings& inSettings) : settings(inSettings) {}
+
+	/**
+	 * Walk the octree as ACubiquityVolume walks its node actors, then evict meshes if over meshBudgetBytes
+	 * \param availableNodeSyncs each branch's sync allowance, which the volume sets to 1. MAX_int32 syncs everything.
+	 * \return the number of nodes synced
+	 */
+	int32 syncNode(const Cubiquity::OctreeNode& octreeNode, int32 availableNodeSyncs);
+
+	/**
+	 * Walk the nodes over recent edits as ACubiquityOctreeNode::processEditedNodes() does
+	 * \param availableNodeSyncs the fast lane's allowance, shared by the whole walk
+	 * \return the number of nodes synced
+	 */
+	int32 syncEditedNodes(const Cubiquity::OctreeNode& octreeNode, FCubiquityEditLatency& edits, uint32 baseNodeSize, int32& availableNodeSyncs);
+
+	/**
+	 * Tell edits about every node over them, drawn or not, without syncing anything. A node is in step once its
+	 * structure, properties and mesh have all caught up with the library, so this times edits until they are fully synced.
+	 */
+	void noteSyncedEdits(const Cubiquity::OctreeNode& octreeNode, FCubiquityEditLatency& edits, uint32 baseNodeSize) const;
+
+	/** CPU and GPU bytes of the meshes the synced nodes are holding, counting shared meshes once */
+	uint64 liveMeshBytes() const;
+
+	FCubiquitySamples conversion; ///< Milliseconds per node mesh, including the cache lookup
+	FCubiquitySamples collisionStaging; ///< Milliseconds per newly converted mesh
+
+	const FCubiquityLodHysteresis* lod = nullptr; ///< If not nullptr, nodes are held on to as the volume holds them
+	const FCubiquityMeshDiskCache* diskCache = nullptr; ///< If not nullptr, read before converting and written after, as the volume does
+	double now = 0.0; ///< The time holdNode() and the coarse node allowance are asked about, which for a replay is the recording's
+
+	bool lazyCoarseNodes = false; ///< As ACubiquityVolume::lazyCoarseNodes
+	float coarseNodeSyncsPerSecond = 10.0f; ///< As ACubiquityVolume::coarseNodeSyncsPerSecond
+
+	/**
+	 * If not 0, meshes of nodes which aren't drawn are evicted after each walk until the live meshes fit in 90% of this,
+	 * as FCubiquityMeshBudget does with its default of only evicting hidden nodes. There is no view to score them by
+	 * so they go in the order the walk finds them.
+	 */
+	uint64 meshBudgetBytes = 0;
+
+	int32 lodFlips = 0; ///< Nodes which started or stopped being drawn, not counting their first sync
+	int32 lodChangesHeld = 0; ///< Summed over walks, so a node held for three walks counts three times. Held nodes leave the walk unsettled.
+	int32 hiddenNodesDeferred = 0; ///< Summed over walks, as lodChangesHeld
+	int32 nodesLeftForLater = 0; ///< What the last syncNode() left out of step. 0 once the walk has caught up with the library.
+	int32 meshesEvicted = 0;
+
+	int32 nodesSynced = 0;
+	int32 meshesConverted = 0;
+	int32 meshesShared = 0;
+	int32 meshesFromDiskCache = 0;
+	int64 verticesConverted = 0;
+	int64 trianglesStaged = 0;
+
+private:
+
+	//What TCubiquityNodeSync needs of a node, as ACubiquityOctreeNode provides it
+	struct FNodeState
+	{
+		FCubiquitySyncSimulator* simulator = nullptr;
+		FCubiquityNodeSyncState sync;
+		TSharedPtr<FCubiquityMeshData> meshData;
+		TSharedPtr<FNodeState> children[2][2][2]; ///< As the node actor's, including any held after their nodes went
+
+		FCubiquityNodeSyncState& syncState() { return sync; }
+		void syncMesh(const Cubiquity::OctreeNode& octreeNode) { simulator->syncMesh(octreeNode, *this); }
+		void setMeshVisible(bool visible) {}
+		FNodeState* getChild(uint32 x, uint32 y, uint32 z) const { return children[x][y][z].Get(); }
+		FNodeState* spawnChild(const Cubiquity::OctreeNode& childNode, uint32 x, uint32 y, uint32 z);
+		void destroyChild(uint32 x, uint32 y, uint32 z) { children[x][y][z].Reset(); }
+	};
+
+	void syncMesh(const Cubiquity::OctreeNode& octreeNode, FNodeState& state);
+
+	//A missing state is a node the walk hasn't reached yet, which is out of step
+	static void noteSyncedEditState(const Cubiquity::OctreeNode& octreeNode, const FNodeState* state, FCubiquityEditLatency& edits, uint32 baseNodeSize);
+
+	//Evict hidden meshes until the live ones fit in the budget
+	void evictMeshes();
+	static void findEvictable(FNodeState& state, TArray<FNodeState*>& outNodes);
+
+	static void countMeshBytes(const FNodeState& state, TSet<const FCubiquityMeshData*>& counted, uint64& bytes);
+
+	FCubiquityConversionSettings settings;
+
+	TSharedPtr<FNodeState> root;
+	FCubiquityMeshCache meshes;
+	FCubiquityCoarseNodeAllowance coarseNodeSyncs;
+};
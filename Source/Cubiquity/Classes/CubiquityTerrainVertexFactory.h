@@ -59,6 +59,21 @@ public:
 
 //IMPLEMENT_VERTEX_FACTORY_TYPE(FGeneratedMeshVertexFactory, "GeneratedMeshVertexFactory", true, true, true, true, true);
 
+/**
+ * The render resources for one terrain mesh.
+ * This is shared between the proxies of all nodes whose meshes are identical and released by the last of them.
+ */
+struct FGeneratedMeshRenderData
+{
+	/** \param traceNode labels the GPU upload in Cubiquity traces */
+	FGeneratedMeshRenderData(const TArray<FDynamicMeshVertex>& vertices, const TArray<int32>& indices, const FCubiquityTraceNode& traceNode);
+	~FGeneratedMeshRenderData();
+
+	FGeneratedMeshVertexBuffer VertexBuffer;
+	FGeneratedMeshIndexBuffer IndexBuffer;
+	FGeneratedMeshVertexFactory VertexFactory;
+};
+
 
 
 
@@ -73,14 +88,11 @@ public:
 
 	virtual ~FGeneratedMeshSceneProxy()
 	{
-		VertexBuffer.ReleaseResource();
-		IndexBuffer.ReleaseResource();
-		VertexFactory.ReleaseResource();
 	}
 
 	void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
 	{
-		QUICK_SCOPE_CYCLE_COUNTER(STAT_GeneratedMeshSceneProxy_DrawDynamicElements);
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityTerrainProxyDraw);
 
 		const bool bWireframe = AllowDebugViewmodes() && ViewFamily.EngineShowFlags.Wireframe;
 
@@ -109,7 +121,7 @@ public:
 				// Draw the mesh.
 				FMeshBatch& Mesh = Collector.AllocateMesh();
 				Mesh.bWireframe = bWireframe;
-				Mesh.VertexFactory = &VertexFactory;
+				Mesh.VertexFactory = &RenderData->VertexFactory;
 				Mesh.MaterialRenderProxy = MaterialProxy;
 				Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
 				Mesh.Type = PT_TriangleList;
@@ -117,12 +129,12 @@ public:
 				Mesh.bCanApplyViewModeOverrides = false;
 
 				FMeshBatchElement& BatchElement = Mesh.Elements[0];
-				BatchElement.IndexBuffer = &IndexBuffer;
+				BatchElement.IndexBuffer = &RenderData->IndexBuffer;
 				BatchElement.PrimitiveUniformBuffer = CreatePrimitiveUniformBufferImmediate(GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, UseEditorDepthTest());
 				BatchElement.FirstIndex = 0;
-				BatchElement.NumPrimitives = IndexBuffer.Indices.Num() / 3;
+				BatchElement.NumPrimitives = RenderData->IndexBuffer.Indices.Num() / 3;
 				BatchElement.MinVertexIndex = 0;
-				BatchElement.MaxVertexIndex = VertexBuffer.Vertices.Num() - 1;
+				BatchElement.MaxVertexIndex = RenderData->VertexBuffer.Vertices.Num() - 1;
 
 				Collector.AddMesh(ViewIndex, Mesh);
 			}
@@ -151,9 +163,7 @@ public:
 private:
 
 	UMaterialInterface* Material;
-	FGeneratedMeshVertexBuffer VertexBuffer;
-	FGeneratedMeshIndexBuffer IndexBuffer;
-	FGeneratedMeshVertexFactory VertexFactory;
+	TSharedPtr<FGeneratedMeshRenderData, ESPMode::ThreadSafe> RenderData;
 
 	FMaterialRelevance MaterialRelevance;
 };
@@ -9,6 +9,15 @@
 class UCubiquityMeshComponent;
 class UCubiquityMaterialSet;
 
+/** What a terrain brush stroke does */
+UENUM(BlueprintType)
+enum class ECubiquityTerrainBrush : uint8
+{
+	Sculpt,
+	Paint,
+	Blur,
+};
+
 /**
 * A voxel terrain object that uses marching cubes
 */
@@ -25,6 +34,8 @@ public:
 
 	virtual void Destroyed() override;
 
+	virtual FCubiquityConversionSettings conversionSettings() const override;
+
 	/**
 	* \param localPosition the volume-space position of the position to sculpt
 	* \param innerRadius the volume-space size of the solid part of the brush
@@ -34,6 +45,35 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
 	void sculptTerrain(FVector localPosition, float innerRadius = 0.5, float outerRadius = 2.0, float opacity = 0.8);
 
+	/**
+	* \param localPosition the volume-space position to paint at
+	* \param innerRadius the volume-space size of the solid part of the brush
+	* \param outerRadius the volume-space radius of the fall-off region of the brush
+	* \param opacity
+	* \param materialIndex which of the material set's materials to paint with
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void paintTerrain(FVector localPosition, float innerRadius = 0.5, float outerRadius = 2.0, float opacity = 0.8, int32 materialIndex = 0);
+
+	/**
+	* \param localPosition the volume-space position to smooth around
+	* \param innerRadius the volume-space size of the solid part of the brush
+	* \param outerRadius the volume-space radius of the fall-off region of the brush
+	* \param opacity
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void blurTerrain(FVector localPosition, float innerRadius = 0.5, float outerRadius = 2.0, float opacity = 0.8);
+
+	/**
+	* Apply a brush every `spacing` voxels along a path. Passing the last mouse position and the new one each frame makes
+	* an evenly spaced stroke, as a path which starts where the last one ended carries on its spacing.
+	* \param localPath volume-space points the stroke goes through
+	* \param spacing voxels between brushes. 0 uses a quarter of outerRadius.
+	* \param materialIndex which of the material set's materials to paint with, for Paint
+	*/
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void strokeTerrain(const TArray<FVector>& localPath, ECubiquityTerrainBrush brush, float spacing = 0.0, float innerRadius = 0.5, float outerRadius = 2.0, float opacity = 0.8, int32 materialIndex = 0);
+
 	/**
 	 * \param localStartPosition the volume-space position of the start of the raycast
 	 * \param localDirection the volume-space direction of the raycast
@@ -46,6 +86,10 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
 	void setVoxel(FVector localPosition, const UCubiquityMaterialSet* materialSet);
 
+	//Set every voxel from lowerCorner to upperCorner inclusive to a specific value
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void fillRegion(FVector lowerCorner, FVector upperCorner, const UCubiquityMaterialSet* materialSet);
+
 	//Get the value of a voxel in the terrain
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Cubiquity")
 	UCubiquityMaterialSet* getVoxel(FVector localPosition) const;
@@ -53,6 +97,7 @@ public:
 private:
 	std::unique_ptr<Cubiquity::TerrainVolume> m_volume = nullptr;
 	Cubiquity::Volume* volume() override { return m_volume.get(); }
+	void setVolume(Cubiquity::Volume* newVolume) override;
 
 	void loadVolume() override;
 };
@@ -0,0 +1,82 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "ThreadSafeBool.h"
+
+//Set to 0 to compile the tracer out completely. It is never in shipping builds.
+#ifndef CUBIQUITY_TRACE
+#define CUBIQUITY_TRACE !UE_BUILD_SHIPPING
+#endif
+
+/** Which octree node a span was for. A height of -1 means it wasn't for a node. */
+struct FCubiquityTraceNode
+{
+	FCubiquityTraceNode() : position(0, 0, 0), height(-1) {}
+	FCubiquityTraceNode(const FIntVector& inPosition, int32 inHeight) : position(inPosition), height(inHeight) {}
+
+	FIntVector position;
+	int32 height;
+};
+
+/**
+ * Records timed spans of the voxel pipeline while capturing and writes them out as Chrome trace JSON,
+ * which can be opened in chrome://tracing to see exactly which nodes and LODs a spike came from.
+ *
+ * Use "cubiquity.Trace Start" and "cubiquity.Trace Stop [File]" from the console. While not capturing a span costs
+ * one flag test, and with CUBIQUITY_TRACE set to 0 the macros compile to nothing.
+ */
+class FCubiquityTrace
+{
+public:
+
+	static bool isRecording() { return recording; }
+
+	static void start();
+
+	/** Stop capturing and write what was captured. An empty path writes to Saved/Profiling/Cubiquity */
+	static bool stop(const FString& path);
+
+	/** Add a finished span. Called from any thread. */
+	static void addSpan(const TCHAR* name, double startSeconds, double endSeconds, const FCubiquityTraceNode& node);
+
+private:
+
+	static FThreadSafeBool recording;
+};
+
+/** Times the enclosing scope, if a capture is running when it starts */
+class FCubiquityTraceScope
+{
+public:
+
+	FCubiquityTraceScope(const TCHAR* inName, const FCubiquityTraceNode& inNode = FCubiquityTraceNode())
+		: name(FCubiquityTrace::isRecording() ? inName : nullptr)
+		, node(inNode)
+		, startSeconds(name ? FPlatformTime::Seconds() : 0.0)
+	{
+	}
+
+	~FCubiquityTraceScope()
+	{
+		if (name)
+		{
+			FCubiquityTrace::addSpan(name, startSeconds, FPlatformTime::Seconds(), node);
+		}
+	}
+
+private:
+
+	const TCHAR* name;
+	FCubiquityTraceNode node;
+	double startSeconds;
+};
+
+#if CUBIQUITY_TRACE
+	#define CUBIQUITY_TRACE_SCOPE(Name) FCubiquityTraceScope ANONYMOUS_VARIABLE(CubiquityTraceScope)(TEXT(Name))
+	//The node expression is only evaluated while capturing
+	#define CUBIQUITY_TRACE_NODE_SCOPE(Name, Node) FCubiquityTraceScope ANONYMOUS_VARIABLE(CubiquityTraceScope)(TEXT(Name), FCubiquityTrace::isRecording() ? (Node) : FCubiquityTraceNode())
+#else
+	#define CUBIQUITY_TRACE_SCOPE(Name)
+	#define CUBIQUITY_TRACE_NODE_SCOPE(Name, Node)
+#endif
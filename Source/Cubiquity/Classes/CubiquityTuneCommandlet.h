@@ -0,0 +1,29 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+
+#include "CubiquityTuneCommandlet.generated.h"
+
+/**
+ * Finds the best baseNodeSize for a volume by replaying a recorded session with each of several node sizes.
+ *
+ * Every candidate gets the same replay as the CubiquityReplay commandlet. Of those which caught up with all the
+ * edits, the ones with a 99th percentile frame time within 10% of the fastest are considered equally quick and
+ * the one of them which needed the least mesh memory is recommended. Results for every candidate are written as JSON.
+ *
+ * UE4Editor-Cmd.exe Project.uproject -run=CubiquityTune -nullrhi -Recording=Path/To.cqrec [-Volume=Path/To.vdb]
+ *     [-BaseNodeSizes=16,32,64,128] [-SyncsPerFrame=1] [-Output=Path/To.json]
+ */
+UCLASS()
+class UCubiquityTuneCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	UCubiquityTuneCommandlet(const FObjectInitializer& PCIP);
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -6,12 +6,33 @@
 
 #include <memory>
 
+#include "CubiquityMeshData.h"
+#include "CubiquityMeshDiskCache.h"
+#include "CubiquityBakedMeshArchive.h"
+#include "CubiquitySessionRecording.h"
+#include "CubiquityMemoryReport.h"
+#include "CubiquityCheckpoints.h"
+#include "CubiquityEditStream.h"
+#include "CubiquityJoinSync.h"
+#include "CubiquityBrushQueue.h"
+#include "CubiquityBrushEngine.h"
+#include "CubiquityExplosion.h"
+#include "CubiquityLodHysteresis.h"
+#include "CubiquityNodeSync.h"
+#include "CubiquityMeshCollision.h"
+
+#include "Async.h"
+
 #include "CubiquityVolume.generated.h"
 
 class UCubiquityMeshComponent;
 class UCubiquityUpdateComponent;
 class ACubiquityOctreeNode;
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCubiquityLoadProgressDelegate, float, progress);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FCubiquityCommitFinishedDelegate, bool, succeeded, float, seconds);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCubiquityJoinSyncDelegate, float, seconds);
+
 /**
 * A CubiquityVolume is the base class for the volume actors in Cubiquity.
 * It is an abstact class with derived classes for the types of terrain supported.
@@ -34,6 +55,8 @@ public:
 
 	virtual void Destroyed() override;
 
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
 	void processOctree();
 
 #if WITH_EDITOR
@@ -52,6 +75,159 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Cubiquity")
 	float lodThreshold = 1.0;
 
+	/**
+	 * Voxels the camera can move before the LOD is worked out again. Stops nodes flipping between LODs while the camera
+	 * hovers near a switching distance, at the cost of the LOD lagging the camera by up to this much. 0 turns it off.
+	 * This and minimumNodeLifetime are off by default. Try a recording with the replay commandlet's -LodHysteresisBand
+	 * and -MinimumNodeLifetime to see how much they help a level before turning them on.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity", meta = (ClampMin = "0"))
+	float lodHysteresisBand = 0.0f;
+
+	/**
+	 * Seconds a node stays drawn after first appearing even if the LOD moves away from it again, with the nodes under it
+	 * kept hidden meanwhile. A node actor is also kept this long after spawning, hidden, in case its node comes back.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity", meta = (ClampMin = "0"))
+	float minimumNodeLifetime = 0.0f;
+
+	/** Nodes which started or stopped being drawn over the last second */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float lodFlipsPerSecond = 0.0f;
+
+	/**
+	 * Edge length in voxels of the smallest octree nodes, and so of the node meshes. Small nodes suit small dense volumes which
+	 * are edited a lot as an edit rebuilds less, large nodes suit big sparse ones as there are fewer nodes. Rounded up to a power of two.
+	 * Use the CubiquityTune commandlet to find the best size for a recorded session.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity", meta = (ClampMin = "8", ClampMax = "256"))
+	int32 baseNodeSize = 32;
+
+	/** The upper corner in voxels of the volume created when volumeFileName doesn't exist yet. The lower corner is the origin. */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity")
+	FIntVector newVolumeUpperCorner = FIntVector(128, 128, 32);
+
+	/** How many LODs coarser than full detail to show first while the volume streams in. 0 goes straight to full detail */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity", meta = (ClampMin = "0"))
+	int32 coarsestStreamingLod = 3;
+
+	/** Seconds the game thread spent in the library opening the volume, the frame's stall for it */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float secondsToOpen = 0.0f;
+
+	/** Seconds from starting to open the volume until the first node mesh was shown */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float secondsToFirstVisible = 0.0f;
+
+	/** Seconds from starting to open the volume until every node was synced at full detail */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float secondsToFullDetail = 0.0f;
+
+	/** Called each time loading moves on a step, and with 1.0 once the volume is at full detail */
+	UPROPERTY(BlueprintAssignable, Category = "Cubiquity")
+	FCubiquityLoadProgressDelegate onLoadProgress;
+
+	//How far the volume has got with opening and streaming in, from 0.0 to 1.0
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Cubiquity")
+	float getLoadProgress() const;
+
+	//Whether the volume is open and every node has been synced at full detail
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Cubiquity")
+	bool isFullyLoaded() const;
+
+	/** Reorder node meshes on worker threads for better GPU vertex cache use. Meshes appear a frame or so later while this runs */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity")
+	bool optimiseMeshes = false;
+
+	/** Let nodes with identical meshes share one copy of the mesh, its GPU buffers and its collision */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity")
+	bool deduplicateMeshes = true;
+
+	/** Keep converted node meshes in Saved/Cubiquity/MeshCache so later loads of this volume can skip converting them */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity")
+	bool cacheMeshesOnDisk = false;
+
+	/** Once this volume's disk cache grows past this many megabytes the least recently used meshes are deleted. 0 for no limit */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity", meta = (ClampMin = "0"))
+	int32 meshDiskCacheMegabytes = 512;
+
+	/** Meshes in the disk cache that haven't been used for this many days are deleted. 0 to keep them however old they are */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity", meta = (ClampMin = "0"))
+	int32 meshDiskCacheMaxAgeDays = 30;
+
+	/** Archive of meshes made by the CubiquityBakeMeshes commandlet. Nodes found in it don't need converting */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity")
+	FString bakedMeshArchive;
+
+	/** Node meshes read from the baked mesh archive since the volume was opened */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 meshesFromBakedArchive = 0;
+
+	/** Node meshes read from the disk cache since the volume was opened */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 meshesFromDiskCache = 0;
+
+	/** Node meshes converted from Cubiquity's meshes since the volume was opened */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 meshesConverted = 0;
+
+	/** Distinct node meshes in use */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 uniqueMeshes = 0;
+
+	/** Nodes using a mesh which at least one other node also uses */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 sharedMeshNodes = 0;
+
+	/** CPU and GPU memory that sharing meshes saves, in kilobytes */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 meshKilobytesSaved = 0;
+
+	/** How much the memory budget has scaled lodThreshold by to make the meshes fit. 1.0 when they fit anyway */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float lodThresholdScale = 1.0f;
+
+	/** Nodes whose meshes the memory budget has thrown away until they are drawn again */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 evictedNodes = 0;
+
+	//lodThreshold after the memory budget has had its say
+	float effectiveLodThreshold() const { return lodThreshold * lodThresholdScale; }
+
+	//How this volume's node meshes are converted
+	virtual FCubiquityConversionSettings conversionSettings() const;
+
+	//Where the volume's memory goes: voxel data, uncommitted edits, meshes, GPU buffers, collision and the node objects
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	FCubiquityMemoryReport getMemoryReport() const;
+
+	//Every node mesh component of the volume
+	void getMeshComponents(TArray<UCubiquityMeshComponent*>& outMeshes) const;
+
+	//The meshes of this volume's nodes, by content, so that identical ones can be shared
+	FCubiquityMeshCache& meshCache() { return meshes; }
+
+	//Meshes baked ahead of time. nullptr if the volume doesn't have an archive or it couldn't be opened.
+	FCubiquityBakedMeshArchive* bakedMeshes() { return bakedArchive.isOpen() ? &bakedArchive : nullptr; }
+
+	//The key of the mesh baked for a node, found by where the node is. False if there is no archive, the node wasn't
+	//baked or any of the voxels its mesh reads have been edited since the volume was opened.
+	bool findBakedMesh(const Cubiquity::OctreeNode& octreeNode, FCubiquityMeshKey& outKey) const;
+
+	//Where to find and keep converted meshes between sessions. nullptr if the volume doesn't cache them.
+	const FCubiquityMeshDiskCache* meshDiskCache() const { return cacheMeshesOnDisk ? diskCache.get() : nullptr; }
+
+	//Delete this volume's converted meshes from disk
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void clearMeshDiskCache();
+
+	//The collision body shared by every node using a mesh. Made the first time a node needs it and kept until no node uses the mesh.
+	UBodySetup* bodySetupFor(const TSharedPtr<FCubiquityMeshData>& meshData, Cubiquity::VolumeType volumeType);
+
+	//Start a vertex cache optimisation of a node mesh on a worker thread.
+	//When it finishes the result is copied back into the mesh and every node using it is sent to the renderer again.
+	void optimiseMesh(const TSharedPtr<FCubiquityMeshData>& meshData, bool isTerrain);
+
 	//This should be called after setting the material to propgate the change
 	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
 	void updateMaterial();
@@ -60,10 +236,259 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
 	void commitChanges();
 
+	//As commitChanges() but queued, and made in processOctree() on a later frame with only one volume committing a frame, so an
+	//autosave of several volumes is spread out. The write itself still stalls the game thread for lastCommitSeconds, as the library
+	//isn't thread safe and can't snapshot its changes for another thread to write. It takes every edit made before then, and until
+	//then the volume, picks and getVoxel carry on as normal. onCommitFinished is called once it's made.
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void commitChangesNextFrame();
+
+	//Whether a commitChangesNextFrame() is still waiting to be made
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Cubiquity")
+	bool isCommitQueued() const { return commitQueued; }
+
+	/** Called when a commit finishes, with whether it succeeded and how long it took */
+	UPROPERTY(BlueprintAssignable, Category = "Cubiquity")
+	FCubiquityCommitFinishedDelegate onCommitFinished;
+
+	/** Seconds the last commit took to write */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float lastCommitSeconds = 0.0f;
+
+	/**
+	 * Estimate of what the last commit wrote, in kilobytes: the chunks it took times their uncompressed size. The library doesn't
+	 * say what it wrote, and the database compresses the chunks, so this is an upper bound rather than the bytes on disk.
+	 */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 lastCommitKilobytes = 0;
+
 	//This discards the temporary changes made to the volume
 	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
 	void discardChanges();
 
+	//Mark the volume as it is now so that restoreCheckpoint() can go back to it. Returns the checkpoint's index, or -1 if the volume isn't open.
+	//From then on the first edit to each voxel chunk keeps a compressed copy of the chunk, so only what changes costs memory.
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	int32 createCheckpoint();
+
+	//Put the volume back how it was at a checkpoint and forget the checkpoints after it. The restored voxels are uncommitted changes.
+	//This rewrites only the chunks changed since the checkpoint, and the rewrites are recorded and sent to clients like any other edit.
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	bool restoreCheckpoint(int32 checkpoint);
+
+	//Forget every checkpoint and the memory they hold. discardChanges() forgets those made since the last commit.
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void clearCheckpoints();
+
+	//Put the uncommitted changes in a blob for a save game, without committing them. Only the changed voxel chunks are
+	//saved, run-length encoded and compressed. The blob has to be loaded on top of the same voxel database.
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	bool saveEdits(TArray<uint8>& outData);
+
+	//Write changes from saveEdits() back as uncommitted changes, on top of any already made. Checkpoints are cleared.
+	//Returns false, changing nothing, if they are damaged or don't fit this volume. If the volume is still opening they are
+	//checked and kept, and loaded once it has, which is when one saved from another voxel database is found out. They
+	//aren't sent to clients.
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	bool loadEdits(const TArray<uint8>& data);
+
+	//saveEdits() or loadEdits() through an archive, depending on which way it goes
+	bool serializeEdits(FArchive& ar);
+
+	/** Seconds the last saveEdits() and loadEdits() took, and the size of the last blob in kilobytes */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float lastSaveEditsSeconds = 0.0f;
+
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float lastLoadEditsSeconds = 0.0f;
+
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float savedEditsKilobytes = 0.0f;
+
+	/**
+	 * Hold terrain sculpt, paint and blur brushes back and merge the ones which land on top of each other, so that a
+	 * brush called every frame, or several times a frame, makes one pass per brushWindowSeconds. Off by default because
+	 * getVoxel() and pickSurface() don't see a queued brush until it has been applied, at the latest when the volume next
+	 * updates, so a game which reads back what it has just sculpted should call flushBrushes() first.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Brushes")
+	bool coalesceBrushes = false;
+
+	/** How long to hold brushes back. 0 applies them once per frame. */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Brushes", meta = (ClampMin = "0"))
+	float brushWindowSeconds = 0.0f;
+
+	/** How close, in outer radii, two brushes of the same kind have to be to merge into one */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Brushes", meta = (ClampMin = "0", ClampMax = "1"))
+	float brushMergeDistance = 0.5f;
+
+	//Apply any brushes being held back now
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void flushBrushes();
+
+	/** Brushes made, and how many of them were merged into another rather than making a pass of their own */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 brushesQueued = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 brushesMerged = 0;
+
+	/** Estimated node re-meshes saved by merging brushes: the smallest nodes under each merged brush */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 remeshesAvoided = 0;
+
+	/**
+	 * Apply a box, cylinder, heightmap, noisy or custom brush, evaluated by the plugin across worker threads rather than by
+	 * the library. Works on both kinds of volume. They are recorded and replicated like an explosion but never merged.
+	 * A Custom brush's signedDistance is code, so it can't be either: it is refused on a server and left out of recordings.
+	 * \param localPosition the volume-space centre of the brush
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void applyBrushKernel(FVector localPosition, const FCubiquityBrush& brush);
+
+	/** How long the last applyBrushKernel() took, and how many voxels a second it got through */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float lastBrushKernelMilliseconds = 0.0f;
+
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float brushKernelVoxelsPerSecond = 0.0f;
+
+	/**
+	 * Blow a crater and take out anything it leaves floating. Explosions are recorded and replicated like other edits,
+	 * so clients carve the same crater and lose the same islands.
+	 * \param localPosition the volume-space centre of the crater
+	 * \param radius of the crater in voxels
+	 * \param falloff voxels over which terrain fades back to untouched outside the radius
+	 * \param roughness how far the crater's edge wanders, as a fraction of the radius
+	 * \return the islands, with the voxels they had, for turning into debris
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	TArray<FCubiquityIsland> applyExplosion(FVector localPosition, float radius = 6.0, float falloff = 1.5, float roughness = 0.25);
+
+	/** Voxels past an explosion's crater searched for islands. Islands reaching further than this are left where they are. */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Explosions", meta = (ClampMin = "1"))
+	int32 explosionSearchMargin = 16;
+
+	/** How long the last applyExplosion() took, and how many islands explosions have taken out in all */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float lastExplosionMilliseconds = 0.0f;
+
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 islandsDetached = 0;
+
+	/**
+	 * Node syncs each frame kept for the nodes drawn over recent edits, on top of the usual one per branch, so an edit
+	 * shows on the next frame whatever else is waiting. 0 turns the fast lane off.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Edit Latency", meta = (ClampMin = "0"))
+	int32 editFastLaneSyncs = 16;
+
+	/** Leave meshes of coarser nodes which aren't drawn out of date, converting them at coarseNodeSyncsPerSecond */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Edit Latency")
+	bool lazyCoarseNodes = true;
+
+	/** How many hidden coarse nodes may be converted each second when lazyCoarseNodes is on */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Edit Latency", meta = (ClampMin = "0.1", EditCondition = "lazyCoarseNodes"))
+	float coarseNodeSyncsPerSecond = 10.0f;
+
+	/** Milliseconds from the last edit being made to it showing, and a running average of the same */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float lastEditLatencyMilliseconds = 0.0f;
+
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float averageEditLatencyMilliseconds = 0.0f;
+
+	/** Hidden coarse nodes left out of date on the last frame */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 deferredCoarseNodes = 0;
+
+	/**
+	 * Send edits made on the server to clients as a compact stream of ops, batched once per net update, which clients
+	 * replay to end up with the same voxels. Clients start from their own copy of volumeFileName, so it must match the server's.
+	 * Edits made on a client only change that client.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Replication")
+	bool replicateEdits = true;
+
+	/** How fast the server sends chunks to a client which joins after the volume has been edited */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Replication", meta = (ClampMin = "1"))
+	float joinSyncKilobytesPerSecond = 512.0f;
+
+	/** Voxels around where a joining player starts which must be up to date before onJoinSyncPlayable is called */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Replication", meta = (ClampMin = "0"))
+	float joinSyncPlayableRadius = 64.0f;
+
+	/** Milliseconds a frame spent hashing chunks after the volume opens, which servers and clients need to do before a join sync */
+	UPROPERTY(EditAnywhere, Category = "Cubiquity|Replication", meta = (ClampMin = "0"))
+	float joinSyncHashingMilliseconds = 2.0f;
+
+	/** Called on a client once the chunks near where the player starts are up to date, with the seconds since it asked */
+	UPROPERTY(BlueprintAssignable, Category = "Cubiquity")
+	FCubiquityJoinSyncDelegate onJoinSyncPlayable;
+
+	/** Called on a client once every chunk is up to date and the server's edits are being applied again */
+	UPROPERTY(BlueprintAssignable, Category = "Cubiquity")
+	FCubiquityJoinSyncDelegate onJoinSyncFinished;
+
+	//Whether the chunks near where the player started are up to date, or there's no join sync going on
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Cubiquity")
+	bool isJoinSyncPlayable() const { return joinSyncState != EJoinSyncState::Requested && (joinSyncState != EJoinSyncState::Receiving || joinSync.isPlayable()); }
+
+	/** Seconds from asking the server for its chunks until those near the player had arrived */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float joinSyncSecondsToPlayable = 0.0f;
+
+	/** Seconds from asking the server for its chunks until all had arrived */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float joinSyncSeconds = 0.0f;
+
+	/** Chunks that differed from the server's when joining, and what they took to send in kilobytes */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 joinSyncChunks = 0;
+
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float joinSyncKilobytes = 0.0f;
+
+	//Join sync steps, called by UCubiquityJoinSyncComponent
+
+	//Whether this is a client whose volume has opened and hashed its chunks and not yet been brought up to date, or has lost edits since it was
+	bool needsJoinSync() const;
+
+	//Client: start holding back the server's edits until the sync is done
+	void beginJoinSync(const FVector& spawnPoint);
+
+	//Server: start sending the volume's hashes as they are now. nullptr if the volume is still opening or hashing its chunks.
+	TSharedPtr<FCubiquityJoinSyncServer> startJoinSyncSession();
+
+	//Server: the next piece of a chunk a session is sending
+	bool nextJoinSyncSlice(FCubiquityJoinSyncServer& session, FCubiquityChunkSlice& outSlice);
+
+	//Client: take a page of the server's hashes. Once all have arrived, list the chunks which differ from ours, drop the
+	//edits the server's chunks already have and return true.
+	bool receiveJoinSyncHashes(const FCubiquityChunkHashPage& page, TArray<int32>& outNeeded);
+
+	//Client: write a piece of a chunk from the server
+	void receiveJoinSyncSlice(const FCubiquityChunkSlice& slice);
+
+	//Client: everything has arrived so carry on with the server's edits
+	void finishJoinSync();
+
+	/** Edit ops sent to clients, or received from the server, since the volume was created */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	int32 replicatedEditOps = 0;
+
+	/** What those ops took on the wire, in kilobytes */
+	UPROPERTY(VisibleInstanceOnly, Transient, Category = "Cubiquity|Statistics")
+	float replicatedEditKilobytes = 0.0f;
+
+	//Start recording the camera path and edits for the CubiquityReplay commandlet. Replays start from the volume file as it is on disk.
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	void startRecording();
+
+	//Stop recording and write it out. An empty file name writes to Saved/Cubiquity/Recordings.
+	UFUNCTION(BlueprintCallable, Category = "Cubiquity")
+	bool stopRecording(const FString& fileName);
+
 	// Convert fom world-space to volume-space
 	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "Cubiquity")
 	FVector worldPositionToVolumePosition(const FVector& worldPosition) const;
@@ -88,33 +513,233 @@ protected:
 	//This provides access to the subclass' volume pointer in a subtype-independant way
 	//We can access all the general Volume stuff by this
 	//It returns a non-owning pointer which should not be stored and only used directly
+	//This is nullptr while the volume is still being opened
 	virtual Cubiquity::Volume* volume() PURE_VIRTUAL(ACubiquityVolume::getVolume, return nullptr;);
 
+	//Hand a volume opened by loadVolumeImpl() to the subclass, which takes ownership of it
+	virtual void setVolume(Cubiquity::Volume* newVolume) PURE_VIRTUAL(ACubiquityVolume::setVolume, );
+
 	//The the rendering position for the volume mesh extraction
 	FVector eyePositionInVolumeSpace() const;
 
+	//Note the voxel chunks an edit touched so the memory report can show what is waiting to be committed
+	void markUncommitted(const FVector& localPosition, float radius);
+
+	//Note chunks whose voxels have changed, for the chunk hashes and the baked mesh archive
+	void chunksChanged(const TArray<FIntVector>& chunks);
+
+	//Uncompressed size of one of the library's voxel chunks
+	int64 chunkBytes() const;
+
+	//Make an edit, record it and send it to clients
+	void applyEdit(const FCubiquityRecordedEvent& event);
+
+	//Make an edit that has already been recorded, or was received from the server
+	void applyEditLocally(const FCubiquityRecordedEvent& event);
+
+	//applyEdit() a brush, or queue it to be merged with others if coalesceBrushes is on
+	void applyBrush(const FCubiquityRecordedEvent& event);
+
+	//applyBrush() every `spacing` voxels along a path. The brush's position is ignored.
+	void applyBrushStroke(const TArray<FVector>& localPath, float spacing, const FCubiquityRecordedEvent& brush);
+
+	//Apply the queued brushes if they have waited long enough
+	void applyDueBrushes();
+
+	//Whether this is a server sending its edits to clients
+	bool sendsEdits() const;
+
+	//Queue an op for the next net update, if this is a server sending its edits
+	void sendEdit(const FCubiquityRecordedEvent& event);
+
+	//Apply the ops the server has sent which are ready, in order
+	void applyReceivedEdits();
+
+	//Ask for a join sync again if a corrupt batch of ops was skipped, once any sync under way has finished
+	void resyncIfOpsLost();
+
+	//Edits from the server, in order
+	UFUNCTION(NetMulticast, Reliable)
+	void multicastEditBatch(const FCubiquityEditBatch& batch);
+
+	FCubiquityEditSender editSender;
+	FCubiquityEditReceiver editReceiver;
+
+	//An event for one of the Fill ops covering the voxels from one corner to the other, in either order
+	static FCubiquityRecordedEvent makeFillEvent(ECubiquityRecordedOp op, const FVector& corner, const FVector& otherCorner, uint64 value);
+
+	//Add an event to the recording, if there is one
+	void recordEvent(const FCubiquityRecordedEvent& event)
+	{
+		if (recording)
+		{
+			recording->record(event);
+		}
+	}
+
 	//This is the root of the octree for our volume
 	ACubiquityOctreeNode* octreeRootNodeActor = nullptr;
 
+	FCubiquityMeshCache meshes;
+
+	std::unique_ptr<FCubiquityMeshDiskCache> diskCache;
+
+	FCubiquityBakedMeshArchive bakedArchive;
+
+	//Chunks edited since the last commit or discard
+	TSet<FIntVector> uncommittedChunks;
+
+	//Chunks changed in any way since the volume was opened, which the baked mesh archive doesn't know about
+	TSet<FIntVector> editedChunks;
+
+	//A hash of every chunk, on servers and clients which replicate edits
+	FCubiquityChunkHashes chunkHashes;
+	bool keepsChunkHashes() const;
+
+	//Join syncs this server is running, which need chunks copied before they are edited
+	TArray<TWeakPtr<FCubiquityJoinSyncServer>> joinSyncSessions;
+	void keepForJoinSyncs(const FVector& localPosition, float radius);
+
+	enum class EJoinSyncState : uint8
+	{
+		NotStarted,
+		Requested, ///< Waiting for the server's hashes
+		Receiving,
+		Finished,
+	};
+	EJoinSyncState joinSyncState = EJoinSyncState::NotStarted;
+	FCubiquityJoinSyncClient joinSync;
+	double joinSyncStarted = 0.0;
+
+	//Set by commitChangesNextFrame() until processOctree() makes the commit
+	bool commitQueued = false;
+
+	//The frame some volume last made a queued commit in, shared by every volume
+	static uint64 frameOfLastCommit;
+
+	//Chunks saved for restoreCheckpoint()
+	FCubiquityCheckpoints checkpoints;
+
+	FCubiquityLodHysteresis lodHysteresis;
+
+	//Edits waiting to show, for the fast lane and the edit latency statistics
+	FCubiquityEditLatency editLatency;
+
+	//Hidden coarse nodes which may still be converted, topped up at coarseNodeSyncsPerSecond
+	FCubiquityCoarseNodeAllowance coarseNodeSyncs;
+
+	//From a loadEdits() made before the volume had opened
+	TArray<uint8> editsToLoad;
+
+	FCubiquityBrushQueue brushQueue;
+
+	//Write every uncommitted change to the voxel database and report how it went
+	void makeCommit();
+
+	//Make the commit commitChangesNextFrame() queued, if there is one, before something which can't come after it
+	void makeQueuedCommit();
+
+	//The session being recorded. nullptr when not recording.
+	std::unique_ptr<FCubiquitySessionRecording> recording;
+
+	//When the sharing statistics were last updated
+	double meshStatisticsLastUpdated = 0.0;
+
+	//The shared collision bodies of the meshes in use, and the outers they cook from
+	UPROPERTY(Transient)
+	TArray<UCubiquityMeshCollision*> meshCollisions;
+
+	//Free the collision of meshes which no node uses any more
+	void releaseUnusedCollision();
+
+	//Meshes with a vertex cache optimisation in flight
+	TArray<FCubiquityPendingOptimisation> meshesBeingOptimised;
+
+	//Copy back any optimisations which have finished and resend the nodes using those meshes to the renderer
+	void applyMeshOptimisations();
+
 	//Create the octreeRootNodeActor and propagate down the tree
 	void createOctree();
 
-	//Load the volume into memory based on volumeFileName
+	//Destroy the octree node actors
+	void destroyOctree();
+
+	//Throw away all the octree node actors and build them again. Used when something changes how meshes are converted
+	void recreateOctree();
+
+	//Start loading the volume into memory based on volumeFileName
 	//The subclasses implementation of this will call loadVolumeImpl() with the correct template type
 	virtual void loadVolume() PURE_VIRTUAL(ACubiquityVolume::loadVolume, );
 
 	//This function is here and templated to avoid code duplication due to different volume types
+	//The library keeps global state and isn't thread safe, so every call into it is made on the game thread. The open is only
+	//queued here and processOctree() makes it, one volume a frame, so loading a level doesn't stall on every volume at once.
 	template <typename VolumeType>
-	std::unique_ptr<VolumeType> loadVolumeImpl()
+	void loadVolumeImpl()
 	{
-		if (FPlatformFileManager::Get().GetPlatformFile().FileExists(*volumeFileName))
+		cancelVolumeLoad();
+		makeQueuedCommit();
+		clearCheckpoints();
+		joinSyncSessions.Empty();
+		brushQueue.reset();
+		editLatency.reset();
+
+		setVolume(nullptr);
+		volumeOpened = false;
+
+		const FString fileName = volumeFileName;
+		const uint32 nodeSize = validBaseNodeSize();
+		const FIntVector upperCorner = newVolumeUpperCorner;
+		volumeLoadStarted = FPlatformTime::Seconds();
+		pendingVolumeOpen = [fileName, nodeSize, upperCorner]() -> Cubiquity::Volume*
 		{
-			return std::make_unique<VolumeType>(TCHAR_TO_ANSI(*volumeFileName), Cubiquity::WritePermissions::ReadOnly, 32);
+			return openVolume<VolumeType>(fileName, nodeSize, upperCorner).release();
+		};
+	}
+
+	//Open or create a volume on the calling thread
+	template <typename VolumeType>
+	static std::unique_ptr<VolumeType> openVolume(const FString& fileName, uint32 nodeSize, const FIntVector& upperCorner)
+	{
+		if (FPlatformFileManager::Get().GetPlatformFile().FileExists(*fileName))
+		{
+			return std::make_unique<VolumeType>(TCHAR_TO_ANSI(*fileName), Cubiquity::WritePermissions::ReadOnly, nodeSize);
 		}
 		else
 		{
-			return std::make_unique<VolumeType>(Cubiquity::Vector<int32_t>{ 0, 0, 0 }, Cubiquity::Vector<int32_t>{ 128, 128, 32 }, TCHAR_TO_ANSI(*volumeFileName), 32);
+			return std::make_unique<VolumeType>(Cubiquity::Vector<int32_t>{ 0, 0, 0 }, Cubiquity::Vector<int32_t>{ upperCorner.X, upperCorner.Y, upperCorner.Z }, TCHAR_TO_ANSI(*fileName), nodeSize);
 		}
 	}
 
+	//baseNodeSize as the library needs it: a power of two in range
+	uint32 validBaseNodeSize() const { return FMath::RoundUpToPowerOfTwo(FMath::Clamp(baseNodeSize, 8, 256)); }
+
+	//Forget any open which hasn't been made yet. Nothing is waited for.
+	void cancelVolumeLoad();
+
+private:
+
+	//Make the queued open and build the octree for the volume, coarsest LODs first
+	void finishVolumeLoad();
+
+	//Open the archive named by bakedMeshArchive, if there is one
+	void openBakedMeshArchive();
+
+	//Move on to the next finer LOD once everything at the current one is showing
+	void updateStreaming(bool volumeSettled);
+
+	//Opens the volume loadVolumeImpl() asked for. Empty once it has been made or cancelled.
+	TFunction<Cubiquity::Volume*()> pendingVolumeOpen;
+
+	//The frame some volume last made its open in, shared by every volume
+	static uint64 frameOfLastVolumeOpen;
+
+	//The finest LOD the volume is currently allowed to show. This steps down to 0 as the volume streams in.
+	int32 streamingLod = 0;
+
+	bool volumeOpened = false;
+	bool firstMeshVisible = false;
+	bool fullDetailReached = false;
+	double volumeLoadStarted = 0.0;
+
 };
@@ -0,0 +1,58 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "Cubiquity.hpp"
+
+/**
+ * Whole chunks of voxels as plain bytes, for edit checkpoints and for bringing late-joining clients up to date.
+ *
+ * A chunk is a cube of voxels aligned to multiples of Size, clipped to the volume. Colored cubes are stored as a 32 bit
+ * colour per voxel and terrain as a 64 bit material set, x fastest then y then z.
+ */
+class FCubiquityVoxelChunk
+{
+public:
+
+	/** Edge length of a chunk in voxels, the same as the chunks the library keeps */
+	enum { Size = 32 };
+
+	/** What read() stores per voxel */
+	static int32 bytesPerVoxel(Cubiquity::VolumeType volumeType) { return volumeType == Cubiquity::VolumeType::Terrain ? sizeof(uint64) : sizeof(uint32); }
+
+	/** The chunks a box of half-size `radius` around position overlaps */
+	static void chunksAround(const FVector& position, float radius, TArray<FIntVector>& outChunks);
+
+	/** The middle of a chunk in volume space */
+	static FVector centre(const FIntVector& chunk) { return (FVector(chunk.X, chunk.Y, chunk.Z) + 0.5f) * Size; }
+
+	/** The chunk a point in volume space is in */
+	static FIntVector containing(const FVector& position) { return FIntVector(FMath::FloorToInt(position.X / Size), FMath::FloorToInt(position.Y / Size), FMath::FloorToInt(position.Z / Size)); }
+
+	/** How many bytes read() gives for a chunk, which is 0 if the chunk is entirely outside the volume */
+	static int32 voxelBytes(const Cubiquity::Volume& volume, const FIntVector& chunk);
+
+	/** \return false if the chunk is entirely outside the volume, in which case outVoxels is empty */
+	static bool read(Cubiquity::Volume& volume, const FIntVector& chunk, TArray<uint8>& outVoxels);
+
+	/** Write back voxels from read(). The volume must be the same type and size as they were read from. */
+	static bool write(Cubiquity::Volume& volume, const FIntVector& chunk, const TArray<uint8>& voxels);
+
+	/** Read every voxel from lower to upper inclusive, which must be inside the volume, laid out as read() does */
+	static void readRegion(Cubiquity::Volume& volume, const FIntVector& lower, const FIntVector& upper, TArray<uint8>& outVoxels);
+
+	/**
+	 * Write back voxels laid out as readRegion() does
+	 * \param previousVoxels what readRegion() gave, so that only the voxels which differ are written. nullptr writes them all.
+	 * \return how many voxels were written, or -1 if there are the wrong number of them
+	 */
+	static int64 writeRegion(Cubiquity::Volume& volume, const FIntVector& lower, const FIntVector& upper, const TArray<uint8>& voxels, const TArray<uint8>* previousVoxels = nullptr);
+
+	/** zlib compress voxels. If that doesn't make them smaller they are copied as they are, which uncompress() can tell from the size. */
+	static void compress(const TArray<uint8>& voxels, TArray<uint8>& outCompressed);
+
+	static bool uncompress(const TArray<uint8>& compressed, int32 uncompressedSize, TArray<uint8>& outVoxels);
+
+	/** A hash of voxels from read(), for telling whether two volumes have the same chunk */
+	static uint32 hash(const TArray<uint8>& voxels) { return FCrc::MemCrc32(voxels.GetData(), voxels.Num()); }
+};
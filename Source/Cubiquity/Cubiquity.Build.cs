@@ -29,7 +29,7 @@ public class Cubiquity : ModuleRules
 	{
         MinFilesUsingPrecompiledHeaderOverride = 1;
         bFasterWithoutUnity = true;
-        PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "RHI", "RenderCore", "ShaderCore" });
+        PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "RHI", "RenderCore", "ShaderCore", "Sockets", "Networking" });
 
         LoadCubiquity(Target);
 	}
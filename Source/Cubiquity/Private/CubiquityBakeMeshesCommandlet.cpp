@@ -0,0 +1,178 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBakeMeshesCommandlet.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "Cubiquity.hpp"
+#include "CubiquityMeshConverter.h"
+#include "CubiquityBakedMeshArchive.h"
+
+#include <memory>
+
+namespace
+{
+	const int32 MaximumLod = 32; //More than any octree will have
+	const int32 MaximumUpdatesPerLod = 100000; //In case the volume never reports that it is up to date
+
+	//Only nodes of the LOD the range is pinned to are baked, so each node goes in once with the mesh it has at its own LOD
+	void bakeNode(const Cubiquity::OctreeNode& octreeNode, uint32 lod, const FCubiquityConversionSettings& settings, TMap<FCubiquityMeshKey, TSharedPtr<FCubiquityMeshData>>& meshes,
+		TArray<FCubiquityBakedMeshArchive::FBakedNode>& nodes)
+	{
+		if (octreeNode.height() == lod && octreeNode.hasMesh())
+		{
+			const FCubiquityMeshKey key = FCubiquityMeshConverter::keyForNode(octreeNode, settings);
+
+			const auto position = octreeNode.position();
+			FCubiquityBakedMeshArchive::FBakedNode node;
+			node.position = FIntVector(position.x, position.y, position.z);
+			node.height = lod;
+			node.key = key;
+			nodes.Add(node);
+
+			if (!meshes.Contains(key))
+			{
+				const TSharedPtr<FCubiquityMeshData> meshData = MakeShareable(new FCubiquityMeshData);
+				meshData->key = key;
+				FCubiquityMeshConverter::convert(octreeNode, settings, *meshData);
+
+				if (settings.optimiseMeshes && meshData->indices.Num() > 0)
+				{
+					FCubiquityOptimisedMesh optimisedMesh;
+					optimisedMesh.terrainVertices = meshData->terrainVertices;
+					optimisedMesh.coloredCubesVertices = meshData->coloredCubesVertices;
+					optimisedMesh.indices = meshData->indices;
+					FCubiquityMeshConverter::optimise(optimisedMesh, settings.volumeType == Cubiquity::VolumeType::Terrain);
+					FCubiquityMeshConverter::applyOptimisedMesh(optimisedMesh, *meshData);
+				}
+
+				meshes.Add(key, meshData);
+			}
+		}
+
+		for (uint32_t z = 0; z < 2; z++)
+		{
+			for (uint32_t y = 0; y < 2; y++)
+			{
+				for (uint32_t x = 0; x < 2; x++)
+				{
+					if (octreeNode.hasChildNode({ x, y, z }))
+					{
+						bakeNode(octreeNode.childNode({ x, y, z }), lod, settings, meshes, nodes);
+					}
+				}
+			}
+		}
+	}
+}
+
+UCubiquityBakeMeshesCommandlet::UCubiquityBakeMeshesCommandlet(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	LogToConsole = true;
+}
+
+int32 UCubiquityBakeMeshesCommandlet::Main(const FString& Params)
+{
+	if (!FCubiquityCommandletSwitches::validate(Params, { TEXT("Volume="), TEXT("Type="), TEXT("Output="), TEXT("BaseNodeSize="), TEXT("Greedy"), TEXT("Compact"), TEXT("Optimise") },
+		TEXT("Usage: -run=CubiquityBakeMeshes -Volume=Path/To.vdb -Type=ColoredCubes|Terrain [-Output=Path/To.meshes] [-BaseNodeSize=32] [-Greedy] [-Compact] [-Optimise]")))
+	{
+		return 1;
+	}
+
+	FString volumeFileName;
+	FString typeName;
+	if (!FParse::Value(*Params, TEXT("Volume="), volumeFileName) || !FParse::Value(*Params, TEXT("Type="), typeName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Usage: -run=CubiquityBakeMeshes -Volume=Path/To.vdb -Type=ColoredCubes|Terrain [-Output=Path/To.meshes] [-BaseNodeSize=32] [-Greedy] [-Compact] [-Optimise]"));
+		return 1;
+	}
+
+	FString outputFileName = FPaths::ChangeExtension(volumeFileName, TEXT("meshes"));
+	FParse::Value(*Params, TEXT("Output="), outputFileName);
+
+	if (!FPaths::FileExists(volumeFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Volume %s does not exist"), *volumeFileName);
+		return 1;
+	}
+
+	int32 baseNodeSize = 32;
+	FParse::Value(*Params, TEXT("BaseNodeSize="), baseNodeSize);
+
+	FCubiquityConversionSettings settings;
+	settings.optimiseMeshes = FParse::Param(*Params, TEXT("Optimise"));
+
+	//The volume is only read so this is the revision the meshes are from
+	const FCubiquityVolumeRevision revision = FCubiquityVolumeRevision::of(volumeFileName);
+
+	std::unique_ptr<Cubiquity::Volume> volume;
+	if (typeName == TEXT("Terrain"))
+	{
+		settings.volumeType = Cubiquity::VolumeType::Terrain;
+		volume = std::make_unique<Cubiquity::TerrainVolume>(TCHAR_TO_ANSI(*volumeFileName), Cubiquity::WritePermissions::ReadOnly, baseNodeSize);
+	}
+	else if (typeName == TEXT("ColoredCubes"))
+	{
+		settings.volumeType = Cubiquity::VolumeType::ColoredCubes;
+		settings.greedyMeshing = FParse::Param(*Params, TEXT("Greedy"));
+		settings.compactFaceStorage = FParse::Param(*Params, TEXT("Compact"));
+		volume = std::make_unique<Cubiquity::ColoredCubesVolume>(TCHAR_TO_ANSI(*volumeFileName), Cubiquity::WritePermissions::ReadOnly, baseNodeSize);
+	}
+	else
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Unknown volume type %s. Use ColoredCubes or Terrain"), *typeName);
+		return 1;
+	}
+
+	const double startTime = FPlatformTime::Seconds();
+
+	TMap<FCubiquityMeshKey, TSharedPtr<FCubiquityMeshData>> meshes;
+	TArray<FCubiquityBakedMeshArchive::FBakedNode> nodes;
+
+	//Pin the LOD range to one level at a time so that every node of that level gets a mesh, wherever it is
+	for (int32 lod = 0; lod <= MaximumLod; ++lod)
+	{
+		volume->setLodRange(lod, lod);
+
+		int32 updates = 0;
+		while (!volume->update({ 0.0f, 0.0f, 0.0f }, 0.0f) && ++updates < MaximumUpdatesPerLod) { /*Keep calling update until it returns true*/ }
+		if (updates == MaximumUpdatesPerLod)
+		{
+			//Baking what is there would leave nodes out of the archive without anyone noticing
+			UE_LOG(CubiquityLog, Error, TEXT("LOD %d still wasn't up to date after %d updates. Nothing was written."), lod, MaximumUpdatesPerLod);
+			return 1;
+		}
+
+		if (!volume->hasRootOctreeNode())
+		{
+			break;
+		}
+
+		const Cubiquity::OctreeNode rootNode = volume->rootOctreeNode();
+		if (lod > rootNode.height())
+		{
+			break;
+		}
+
+		const int32 meshesBefore = meshes.Num();
+		const int32 nodesBefore = nodes.Num();
+		bakeNode(rootNode, lod, settings, meshes, nodes);
+		UE_LOG(CubiquityLog, Display, TEXT("LOD %d: %d nodes, %d new meshes"), lod, nodes.Num() - nodesBefore, meshes.Num() - meshesBefore);
+	}
+
+	TArray<TSharedPtr<FCubiquityMeshData>> meshList;
+	meshes.GenerateValueArray(meshList);
+
+	if (!FCubiquityBakedMeshArchive::write(outputFileName, revision, baseNodeSize, settings.flags(), nodes, meshList))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to write %s"), *outputFileName);
+		return 1;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("Baked %d nodes with %d unique meshes into %s (%lld bytes) in %.2f seconds"),
+		nodes.Num(), meshList.Num(), *outputFileName, IFileManager::Get().FileSize(*outputFileName), FPlatformTime::Seconds() - startTime);
+
+	return 0;
+}
@@ -0,0 +1,286 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBakedMeshArchive.h"
+
+#include "CubiquityMeshDiskCache.h"
+
+namespace
+{
+	const uint32 ArchiveMagic = 0x414D5143; //'CQMA'
+	const uint32 ArchiveVersion = 2;
+
+	struct FArchiveHeader
+	{
+		uint32 magic;
+		uint32 version;
+		uint32 noOfEntries;
+		uint32 noOfNodes;
+		uint32 conversionFlags;
+		uint32 baseNodeSize;
+		uint32 volumeChangeCounter;
+		uint32 reserved;
+		int64 volumeBytes;
+	};
+
+	struct FArchiveIndexEntry
+	{
+		uint8 hash[20];
+		uint32 size;
+		uint64 offset;
+	};
+
+	struct FArchiveNodeEntry
+	{
+		int32 position[3];
+		uint32 height;
+		uint32 entry; ///< Into the index
+	};
+
+	static_assert(sizeof(FArchiveHeader) == 40, "Archive headers should be 40 bytes");
+	static_assert(sizeof(FArchiveIndexEntry) == 32, "Archive index entries should be 32 bytes");
+	static_assert(sizeof(FArchiveNodeEntry) == 20, "Archive node entries should be 20 bytes");
+
+	//Where SQLite keeps its file change counter, big endian, and the string its files start with
+	const int32 ChangeCounterOffset = 24;
+	const ANSICHAR SQLiteHeader[] = "SQLite format 3";
+}
+
+FCubiquityVolumeRevision FCubiquityVolumeRevision::of(const FString& volumeFileName)
+{
+	FCubiquityVolumeRevision revision;
+	std::unique_ptr<FArchive> reader(IFileManager::Get().CreateFileReader(*volumeFileName, FILEREAD_Silent));
+	if (!reader)
+	{
+		return revision;
+	}
+
+	revision.bytes = reader->TotalSize();
+
+	uint8 header[ChangeCounterOffset + 4];
+	if (revision.bytes >= static_cast<int64>(sizeof(header)))
+	{
+		reader->Serialize(header, sizeof(header));
+		if (!reader->IsError() && FMemory::Memcmp(header, SQLiteHeader, sizeof(SQLiteHeader)) == 0)
+		{
+			const uint8* counter = header + ChangeCounterOffset;
+			revision.changeCounter = (uint32(counter[0]) << 24) | (uint32(counter[1]) << 16) | (uint32(counter[2]) << 8) | uint32(counter[3]);
+		}
+	}
+
+	return revision;
+}
+
+bool FCubiquityBakedMeshArchive::write(const FString& path, const FCubiquityVolumeRevision& revision, uint32 baseNodeSize, uint32 conversionFlags,
+	const TArray<FBakedNode>& nodes, const TArray<TSharedPtr<FCubiquityMeshData>>& meshes)
+{
+	TArray<TSharedPtr<FCubiquityMeshData>> sortedMeshes = meshes;
+	sortedMeshes.Sort([](const TSharedPtr<FCubiquityMeshData>& a, const TSharedPtr<FCubiquityMeshData>& b)
+	{
+		return FMemory::Memcmp(a->key.hash.Hash, b->key.hash.Hash, sizeof(a->key.hash.Hash)) < 0;
+	});
+
+	TMap<FCubiquityMeshKey, uint32> entryForKey;
+	entryForKey.Reserve(sortedMeshes.Num());
+	for (int32 i = 0; i < sortedMeshes.Num(); ++i)
+	{
+		entryForKey.Add(sortedMeshes[i]->key, i);
+	}
+
+	TArray<FArchiveNodeEntry> nodeEntries;
+	nodeEntries.Reserve(nodes.Num());
+	for (const FBakedNode& node : nodes)
+	{
+		const uint32* entry = entryForKey.Find(node.key);
+		if (!entry)
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("A baked node's mesh isn't among the meshes to write"));
+			return false;
+		}
+
+		FArchiveNodeEntry nodeEntry;
+		nodeEntry.position[0] = node.position.X;
+		nodeEntry.position[1] = node.position.Y;
+		nodeEntry.position[2] = node.position.Z;
+		nodeEntry.height = node.height;
+		nodeEntry.entry = *entry;
+		nodeEntries.Add(nodeEntry);
+	}
+
+	FArchiveHeader header;
+	header.magic = ArchiveMagic;
+	header.version = ArchiveVersion;
+	header.noOfEntries = sortedMeshes.Num();
+	header.noOfNodes = nodeEntries.Num();
+	header.conversionFlags = conversionFlags;
+	header.baseNodeSize = baseNodeSize;
+	header.volumeChangeCounter = revision.changeCounter;
+	header.reserved = 0;
+	header.volumeBytes = revision.bytes;
+
+	TArray<FArchiveIndexEntry> indexEntries;
+	indexEntries.AddZeroed(sortedMeshes.Num());
+
+	TArray<uint8> entries;
+	const uint64 entriesStart = Align(sizeof(header) + indexEntries.Num() * sizeof(FArchiveIndexEntry) + nodeEntries.Num() * sizeof(FArchiveNodeEntry), EntryAlignment);
+	for (int32 i = 0; i < sortedMeshes.Num(); ++i)
+	{
+		entries.AddZeroed(Align(entries.Num(), EntryAlignment) - entries.Num());
+
+		const int32 start = entries.Num();
+		FCubiquityMeshDiskCache::writeEntry(*sortedMeshes[i], entries);
+
+		FMemory::Memcpy(indexEntries[i].hash, sortedMeshes[i]->key.hash.Hash, sizeof(indexEntries[i].hash));
+		indexEntries[i].offset = entriesStart + start;
+		indexEntries[i].size = entries.Num() - start;
+	}
+
+	std::unique_ptr<FArchive> writer(IFileManager::Get().CreateFileWriter(*path));
+	if (!writer)
+	{
+		return false;
+	}
+
+	writer->Serialize(&header, sizeof(header));
+	writer->Serialize(indexEntries.GetData(), indexEntries.Num() * sizeof(FArchiveIndexEntry));
+	writer->Serialize(nodeEntries.GetData(), nodeEntries.Num() * sizeof(FArchiveNodeEntry));
+
+	TArray<uint8> padding;
+	padding.AddZeroed(entriesStart - writer->Tell());
+	writer->Serialize(padding.GetData(), padding.Num());
+
+	writer->Serialize(entries.GetData(), entries.Num());
+
+	return writer->Close() && !writer->IsError();
+}
+
+bool FCubiquityBakedMeshArchive::open(const FString& path, const FCubiquityVolumeRevision& revision, uint32 baseNodeSize)
+{
+	index.Empty();
+	nodes.Empty();
+	reader.reset(IFileManager::Get().CreateFileReader(*path, FILEREAD_Silent));
+	if (!reader)
+	{
+		return false;
+	}
+
+	FArchiveHeader header;
+	if (reader->TotalSize() < static_cast<int64>(sizeof(header)))
+	{
+		reader.reset();
+		return false;
+	}
+
+	reader->Serialize(&header, sizeof(header));
+	if (header.magic != ArchiveMagic || header.version != ArchiveVersion
+		|| reader->TotalSize() < static_cast<int64>(sizeof(header) + uint64(header.noOfEntries) * sizeof(FArchiveIndexEntry) + uint64(header.noOfNodes) * sizeof(FArchiveNodeEntry)))
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("%s is not a baked mesh archive this version can read"), *path);
+		reader.reset();
+		return false;
+	}
+
+	//Nodes are found by where they are, which only says what their meshes are for the database they were baked from
+	FCubiquityVolumeRevision bakedRevision;
+	bakedRevision.bytes = header.volumeBytes;
+	bakedRevision.changeCounter = header.volumeChangeCounter;
+	if (bakedRevision != revision || header.baseNodeSize != baseNodeSize)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("%s was baked from another revision of the volume or with another base node size. Bake it again."), *path);
+		reader.reset();
+		return false;
+	}
+
+	conversionFlags = header.conversionFlags;
+
+	TArray<FArchiveIndexEntry> indexEntries;
+	indexEntries.AddUninitialized(header.noOfEntries);
+	reader->Serialize(indexEntries.GetData(), indexEntries.Num() * sizeof(FArchiveIndexEntry));
+
+	TArray<FArchiveNodeEntry> nodeEntries;
+	nodeEntries.AddUninitialized(header.noOfNodes);
+	reader->Serialize(nodeEntries.GetData(), nodeEntries.Num() * sizeof(FArchiveNodeEntry));
+
+	TArray<FCubiquityMeshKey> keys;
+	keys.Reserve(indexEntries.Num());
+	index.Reserve(indexEntries.Num());
+	for (const FArchiveIndexEntry& indexEntry : indexEntries)
+	{
+		FCubiquityMeshKey key;
+		FMemory::Memcpy(key.hash.Hash, indexEntry.hash, sizeof(key.hash.Hash));
+		keys.Add(key);
+
+		FIndexEntry entry;
+		entry.offset = indexEntry.offset;
+		entry.size = indexEntry.size;
+		index.Add(key, entry);
+	}
+
+	nodes.Reserve(nodeEntries.Num());
+	for (const FArchiveNodeEntry& nodeEntry : nodeEntries)
+	{
+		if (nodeEntry.entry >= static_cast<uint32>(keys.Num()))
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("%s is damaged"), *path);
+			index.Empty();
+			nodes.Empty();
+			reader.reset();
+			return false;
+		}
+
+		FNodeKey nodeKey;
+		nodeKey.position = FIntVector(nodeEntry.position[0], nodeEntry.position[1], nodeEntry.position[2]);
+		nodeKey.height = nodeEntry.height;
+		nodes.Add(nodeKey, keys[nodeEntry.entry]);
+	}
+
+	return true;
+}
+
+bool FCubiquityBakedMeshArchive::find(const Cubiquity::OctreeNode& octreeNode, uint32 inConversionFlags, FCubiquityMeshKey& outKey) const
+{
+	if (inConversionFlags != conversionFlags)
+	{
+		return false;
+	}
+
+	const auto position = octreeNode.position();
+	FNodeKey nodeKey;
+	nodeKey.position = FIntVector(position.x, position.y, position.z);
+	nodeKey.height = octreeNode.height();
+
+	const FCubiquityMeshKey* key = nodes.Find(nodeKey);
+	if (!key)
+	{
+		return false;
+	}
+
+	outKey = *key;
+	return true;
+}
+
+bool FCubiquityBakedMeshArchive::load(const FCubiquityMeshKey& key, FCubiquityMeshData& outMeshData)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityBakedMeshRead);
+
+	const FIndexEntry* entry = index.Find(key);
+	if (!entry || !reader || static_cast<int64>(entry->offset + entry->size) > reader->TotalSize())
+	{
+		return false;
+	}
+
+	scratch.Reset();
+	scratch.AddUninitialized(entry->size);
+	reader->Seek(entry->offset);
+	reader->Serialize(scratch.GetData(), scratch.Num());
+
+	if (reader->IsError() || !FCubiquityMeshDiskCache::readEntry(scratch.GetData(), scratch.Num(), key, outMeshData))
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("Ignoring damaged baked mesh entry"));
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_CubiquityBakedMeshHits);
+	return true;
+}
@@ -0,0 +1,203 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBenchmarkCommandlet.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "CubiquityBenchmarkRun.h"
+#include "CubiquityBenchmarkVolume.h"
+#include "CubiquityCheckpoints.h"
+#include "CubiquityBrushQueue.h"
+
+namespace
+{
+	//The shared run with the checkpoints and brush queue, which need code only the plugin has
+	class FCommandletBenchmarkRun : public FCubiquityBenchmarkRun
+	{
+	public:
+
+		FCommandletBenchmarkRun(const FCubiquityBenchmarkOptions& inOptions, int32 inCheckpointEvery, int32 inBrushWindow)
+			: FCubiquityBenchmarkRun(inOptions)
+			, checkpointEvery(inCheckpointEvery)
+			, brushWindow(inBrushWindow)
+		{
+		}
+
+	protected:
+
+		//Checkpoints only make sense with edits, so like them only for synthetic volumes
+		bool capturing() const { return options.synthetic() && checkpointEvery > 0; }
+
+		//Terrain brushes merged over a window of frames, for comparing meshes converted with and without
+		bool queueingBrushes() const { return options.synthetic() && terrainVolume && brushWindow > 0; }
+
+		virtual void beforeFrame(int32 frame) override
+		{
+			if (capturing() && frame % checkpointEvery == 0)
+			{
+				const double createStart = FPlatformTime::Seconds();
+				checkpoints.create();
+				checkpointCreates.addSeconds(FPlatformTime::Seconds() - createStart);
+			}
+			captureSeconds = 0.0;
+		}
+
+		//Queued brushes go in once their window is up, as ACubiquityVolume::applyDueBrushes() does
+		virtual void makeEdits(int32 frame) override
+		{
+			if (!queueingBrushes())
+			{
+				FCubiquityBenchmarkRun::makeEdits(frame);
+			}
+			else
+			{
+				for (int32 i = 0; i < options.editsPerFrame; ++i)
+				{
+					const FCubiquityBenchmarkEdit edit = FCubiquityBenchmarkVolume::terrainEdit(options.pattern, random, frame, options.size, options.height);
+
+					FCubiquityRecordedEvent brush;
+					brush.op = ECubiquityRecordedOp::SculptTerrain;
+					brush.position = edit.position;
+					brush.innerRadius = FCubiquityBenchmarkEdit::TerrainInnerRadius;
+					brush.outerRadius = FCubiquityBenchmarkEdit::TerrainOuterRadius;
+					brush.opacity = edit.opacity;
+					brushQueue.add(brush, options.baseNodeSize, FPlatformTime::Seconds());
+				}
+
+				//The last frame applies what's left so every brush is in the meshes converted
+				if ((frame + 1) % brushWindow == 0 || frame == options.frames - 1)
+				{
+					TArray<FCubiquityRecordedEvent> pass;
+					brushQueue.take(pass);
+					for (const FCubiquityRecordedEvent& brush : pass)
+					{
+						beforeEdit(brush.position, brush.outerRadius);
+						brush.applyTo(*terrainVolume);
+					}
+				}
+			}
+
+			if (capturing())
+			{
+				checkpointCaptures.addSeconds(captureSeconds);
+			}
+		}
+
+		//Saves chunks for the checkpoints ahead of each edit and times it
+		virtual void beforeEdit(const FVector& position, float radius) override
+		{
+			FCubiquityBenchmarkRun::beforeEdit(position, radius);
+			if (capturing())
+			{
+				const double start = FPlatformTime::Seconds();
+				checkpoints.beforeEdit(*volume, position, radius);
+				captureSeconds += FPlatformTime::Seconds() - start;
+			}
+		}
+
+		//Go back to the middle checkpoint and then to the first, which undoes every edit of the run
+		virtual void afterFrames() override
+		{
+			if (!capturing())
+			{
+				return;
+			}
+
+			const int32 created = checkpoints.num();
+			const uint64 compressedBytes = checkpoints.compressedBytes();
+			const uint64 uncompressedBytes = checkpoints.uncompressedBytes();
+
+			FString restoresJson;
+			for (int32 checkpoint : { created / 2, 0 })
+			{
+				//Applied as the volume actor applies them, without recording or sending
+				TArray<FCubiquityRecordedEvent> writes;
+				const double restoreStart = FPlatformTime::Seconds();
+				checkpoints.restore(checkpoint, writes);
+				for (const FCubiquityRecordedEvent& write : writes)
+				{
+					write.applyTo(*volume);
+				}
+				const double restoreSeconds = FPlatformTime::Seconds() - restoreStart;
+
+				restoresJson += FString::Printf(TEXT("%s{\"checkpoint\":%d,\"chunks\":%d,\"ms\":%.3f,\"chunks_per_second\":%.1f}"), restoresJson.IsEmpty() ? TEXT("") : TEXT(","),
+					checkpoint, writes.Num(), restoreSeconds * 1000.0, restoreSeconds > 0.0 ? writes.Num() / restoreSeconds : 0.0);
+			}
+
+			checkpointJson = FString::Printf(TEXT("\"checkpoints\":{\"every\":%d,\"created\":%d,\"compressed_bytes\":%llu,\"uncompressed_bytes\":%llu,\"compression_ratio\":%.2f,\"restores\":[%s]},\n"),
+				checkpointEvery, created, compressedBytes, uncompressedBytes, compressedBytes > 0 ? double(uncompressedBytes) / compressedBytes : 0.0, *restoresJson);
+		}
+
+		virtual FString extraPhasesJson() override
+		{
+			if (!capturing())
+			{
+				return FString();
+			}
+			return FString::Printf(TEXT("\"checkpoint_capture\":%s,\n\"checkpoint_create\":%s,\n"), *checkpointCaptures.toJson(), *checkpointCreates.toJson());
+		}
+
+		virtual FString extraSectionsJson() override
+		{
+			FString json = checkpointJson;
+			if (queueingBrushes())
+			{
+				json += FString::Printf(TEXT("\"brushes\":{\"window_frames\":%d,\"queued\":%d,\"merged\":%d,\"passes\":%d,\"meshes_converted\":%d},\n"),
+					brushWindow, brushQueue.brushesQueued, brushQueue.brushesMerged, brushQueue.passesApplied, simulator.meshesConverted);
+			}
+			return json;
+		}
+
+	private:
+
+		const int32 checkpointEvery;
+		const int32 brushWindow;
+
+		FCubiquityCheckpoints checkpoints;
+		FCubiquitySamples checkpointCaptures;
+		FCubiquitySamples checkpointCreates;
+		double captureSeconds = 0.0;
+		FString checkpointJson;
+
+		FCubiquityBrushQueue brushQueue;
+	};
+}
+
+UCubiquityBenchmarkCommandlet::UCubiquityBenchmarkCommandlet(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	LogToConsole = true;
+}
+
+int32 UCubiquityBenchmarkCommandlet::Main(const FString& Params)
+{
+	TArray<const TCHAR*> switches = FCubiquityBenchmarkOptions::switches();
+	switches.Add(TEXT("Volume="));
+	switches.Add(TEXT("CheckpointEvery="));
+	switches.Add(TEXT("BrushWindow="));
+	if (!FCubiquityCommandletSwitches::validate(Params, switches,
+		TEXT("Usage: -run=CubiquityBenchmark [-Volume=Path/To.vdb] [-Type=ColoredCubes|Terrain] [-Size=128] [-Height=32] [-Frames=300] [-Edits=1] [-Pattern=Scatter|Dig|Wall] [-Seed=0] [-BaseNodeSize=32] [-Greedy] [-Compact] [-LodThreshold=1.0] [-CheckpointEvery=0] [-BrushWindow=0] [-SyncsPerFrame=1] [-FastLane=16] [-CoarseNodeSyncsPerSecond=10] [-DiskCache] [-DiskCacheMegabytes=512] [-Output=Path/To.json]")))
+	{
+		return 1;
+	}
+
+	FCubiquityBenchmarkOptions options;
+	options.parse(Params);
+	FParse::Value(*Params, TEXT("Volume="), options.volumeFileName);
+
+	int32 checkpointEvery = 0;
+	int32 brushWindow = 0;
+	FParse::Value(*Params, TEXT("CheckpointEvery="), checkpointEvery);
+	FParse::Value(*Params, TEXT("BrushWindow="), brushWindow);
+
+	//A synthetic volume goes in a temporary database which is thrown away afterwards
+	FCommandletBenchmarkRun benchmark(options, checkpointEvery, brushWindow);
+	if (!benchmark.openVolume(options.synthetic() ? FPaths::CreateTempFilename(*(FPaths::GameSavedDir() / TEXT("Cubiquity")), TEXT("Benchmark"), TEXT(".vdb")) : options.volumeFileName))
+	{
+		return 1;
+	}
+
+	benchmark.run();
+	return benchmark.writeResults(nullptr) ? 0 : 1;
+}
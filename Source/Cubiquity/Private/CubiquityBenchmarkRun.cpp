@@ -0,0 +1,334 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBenchmarkRun.h"
+
+#include "CubiquityBenchmarkVolume.h"
+#include "CubiquityMeshDiskCache.h"
+
+namespace
+{
+	//The time a frame of the run stands for, for the coarse node allowance
+	const double FrameSeconds = 1.0 / 60.0;
+
+	FCubiquityConversionSettings settingsFor(const FCubiquityBenchmarkOptions& options)
+	{
+		FCubiquityConversionSettings settings;
+		settings.volumeType = options.typeName == TEXT("Terrain") ? Cubiquity::VolumeType::Terrain : Cubiquity::VolumeType::ColoredCubes;
+
+		//Greedy meshing and compact faces are colored cubes only
+		settings.greedyMeshing = settings.volumeType == Cubiquity::VolumeType::ColoredCubes && options.greedyMeshing;
+		settings.compactFaceStorage = settings.volumeType == Cubiquity::VolumeType::ColoredCubes && options.compactFaceStorage;
+		return settings;
+	}
+
+	//What all three mesh buffer pools have handed out so far
+	void countBufferPools(uint32& outAllocations, uint32& outReuses)
+	{
+		outAllocations = TCubiquityBufferPool<FDynamicMeshVertex>::get().allocations + TCubiquityBufferPool<FColoredCubesVertex>::get().allocations + TCubiquityBufferPool<int32>::get().allocations;
+		outReuses = TCubiquityBufferPool<FDynamicMeshVertex>::get().reuses + TCubiquityBufferPool<FColoredCubesVertex>::get().reuses + TCubiquityBufferPool<int32>::get().reuses;
+	}
+}
+
+TArray<const TCHAR*> FCubiquityBenchmarkOptions::switches()
+{
+	return { TEXT("Type="), TEXT("Pattern="), TEXT("Output="), TEXT("Size="), TEXT("Height="), TEXT("Frames="), TEXT("Edits="), TEXT("Seed="), TEXT("BaseNodeSize="),
+		TEXT("LodThreshold="), TEXT("SyncsPerFrame="), TEXT("FastLane="), TEXT("CoarseNodeSyncsPerSecond="), TEXT("DiskCacheMegabytes="), TEXT("DiskCache"), TEXT("Greedy"), TEXT("Compact") };
+}
+
+void FCubiquityBenchmarkOptions::parse(const FString& params)
+{
+	outputFileName = FPaths::ProfilingDir() / TEXT("Cubiquity") / FString::Printf(TEXT("Benchmark-%s.json"), *FDateTime::Now().ToString());
+
+	FParse::Value(*params, TEXT("Type="), typeName);
+	FParse::Value(*params, TEXT("Pattern="), pattern);
+	FParse::Value(*params, TEXT("Output="), outputFileName);
+	FParse::Value(*params, TEXT("Size="), size);
+	FParse::Value(*params, TEXT("Height="), height);
+	FParse::Value(*params, TEXT("Frames="), frames);
+	FParse::Value(*params, TEXT("Edits="), editsPerFrame);
+	FParse::Value(*params, TEXT("Seed="), seed);
+	FParse::Value(*params, TEXT("BaseNodeSize="), baseNodeSize);
+	FParse::Value(*params, TEXT("LodThreshold="), lodThreshold);
+	FParse::Value(*params, TEXT("SyncsPerFrame="), syncsPerFrame);
+	FParse::Value(*params, TEXT("FastLane="), fastLaneSyncs);
+	FParse::Value(*params, TEXT("CoarseNodeSyncsPerSecond="), coarseNodeSyncsPerSecond);
+	FParse::Value(*params, TEXT("DiskCacheMegabytes="), diskCacheMegabytes);
+	measureDiskCache = FParse::Param(*params, TEXT("DiskCache"));
+	greedyMeshing = FParse::Param(*params, TEXT("Greedy"));
+	compactFaceStorage = FParse::Param(*params, TEXT("Compact"));
+	size = FMath::Max(size, 8);
+	height = FMath::Max(height, 8);
+}
+
+FCubiquityBenchmarkRun::FCubiquityBenchmarkRun(const FCubiquityBenchmarkOptions& inOptions)
+	: options(inOptions)
+	, settings(settingsFor(inOptions))
+	, simulator(settingsFor(inOptions))
+	, random(inOptions.seed)
+{
+	simulator.lazyCoarseNodes = options.coarseNodeSyncsPerSecond > 0.0f;
+	simulator.coarseNodeSyncsPerSecond = options.coarseNodeSyncsPerSecond;
+}
+
+FCubiquityBenchmarkRun::~FCubiquityBenchmarkRun()
+{
+}
+
+bool FCubiquityBenchmarkRun::openVolume(const FString& inDatabaseFileName)
+{
+	databaseFileName = inDatabaseFileName;
+	const bool synthetic = options.synthetic();
+	if (!synthetic && !FPaths::FileExists(databaseFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Volume %s does not exist"), *databaseFileName);
+		return false;
+	}
+
+	const double openStart = FPlatformTime::Seconds();
+	double generationStart = openStart;
+	if (options.typeName == TEXT("Terrain"))
+	{
+		terrainVolume = synthetic
+			? new Cubiquity::TerrainVolume({ 0, 0, 0 }, { options.size - 1, options.size - 1, options.height - 1 }, TCHAR_TO_ANSI(*databaseFileName), options.baseNodeSize)
+			: new Cubiquity::TerrainVolume(TCHAR_TO_ANSI(*databaseFileName), Cubiquity::WritePermissions::ReadOnly, options.baseNodeSize);
+		volume.reset(terrainVolume);
+		generationStart = FPlatformTime::Seconds();
+		if (synthetic)
+		{
+			terrainVolume->generateFloor(options.height / 3, 0, options.height / 2, 1);
+		}
+	}
+	else if (options.typeName == TEXT("ColoredCubes"))
+	{
+		coloredCubesVolume = synthetic
+			? new Cubiquity::ColoredCubesVolume({ 0, 0, 0 }, { options.size - 1, options.size - 1, options.height - 1 }, TCHAR_TO_ANSI(*databaseFileName), options.baseNodeSize)
+			: new Cubiquity::ColoredCubesVolume(TCHAR_TO_ANSI(*databaseFileName), Cubiquity::WritePermissions::ReadOnly, options.baseNodeSize);
+		volume.reset(coloredCubesVolume);
+		generationStart = FPlatformTime::Seconds();
+		if (synthetic)
+		{
+			FCubiquityBenchmarkVolume::generateColoredCubes(*coloredCubesVolume, options.size, options.height);
+		}
+	}
+	else
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Unknown volume type %s. Use ColoredCubes or Terrain"), *options.typeName);
+		return false;
+	}
+	openSeconds = generationStart - openStart;
+	generationSeconds = FPlatformTime::Seconds() - generationStart;
+
+	return true;
+}
+
+void FCubiquityBenchmarkRun::makeEdits(int32 frame)
+{
+	for (int32 i = 0; i < options.editsPerFrame; ++i)
+	{
+		if (terrainVolume)
+		{
+			const FCubiquityBenchmarkEdit edit = FCubiquityBenchmarkVolume::terrainEdit(options.pattern, random, frame, options.size, options.height);
+			beforeEdit(edit.position, edit.radius);
+			FCubiquityBenchmarkVolume::applyTerrainEdit(*terrainVolume, edit);
+		}
+		else
+		{
+			const FCubiquityBenchmarkEdit edit = FCubiquityBenchmarkVolume::coloredCubesEdit(options.pattern, random, frame, options.size, options.height);
+			beforeEdit(edit.position, edit.radius);
+			FCubiquityBenchmarkVolume::applyColoredCubesEdit(*coloredCubesVolume, options.pattern, edit, options.size, options.height);
+		}
+	}
+}
+
+void FCubiquityBenchmarkRun::beforeEdit(const FVector& position, float radius)
+{
+	const double now = FPlatformTime::Seconds();
+	syncedEdits.add(position, radius, now);
+	visibleEdits.add(position, radius, now);
+}
+
+void FCubiquityBenchmarkRun::run()
+{
+	uint32 allocationsBefore = 0;
+	uint32 reusesBefore = 0;
+	countBufferPools(allocationsBefore, reusesBefore);
+
+	const double runStart = FPlatformTime::Seconds();
+	for (int32 frame = 0; frame < options.frames; ++frame)
+	{
+		//Edits are read-only against an existing database so only synthetic volumes get them
+		if (options.synthetic())
+		{
+			beforeFrame(frame);
+
+			const double editStart = FPlatformTime::Seconds();
+			makeEdits(frame);
+			edits.addSeconds(FPlatformTime::Seconds() - editStart);
+		}
+
+		//Circle the middle of the volume so the LOD keeps changing
+		const float angle = 2.0f * PI * frame / FMath::Max(options.frames, 1);
+		const Cubiquity::Vector<float> eye = { options.size * (0.5f + 0.6f * FMath::Cos(angle)), options.size * (0.5f + 0.6f * FMath::Sin(angle)), options.height * 1.5f };
+
+		const double updateStart = FPlatformTime::Seconds();
+		const bool upToDate = volume->update(eye, options.lodThreshold);
+		const double syncStart = FPlatformTime::Seconds();
+		updates.addSeconds(syncStart - updateStart);
+
+		simulator.now = frame * FrameSeconds;
+		if (volume->hasRootOctreeNode())
+		{
+			//Sync every changed node unless asked to hold back like the volume actor does
+			simulator.syncNode(volume->rootOctreeNode(), options.syncsPerFrame > 0 ? options.syncsPerFrame : MAX_int32);
+
+			if (!visibleEdits.isEmpty())
+			{
+				int32 availableNodeSyncs = options.fastLaneSyncs;
+				simulator.syncEditedNodes(volume->rootOctreeNode(), visibleEdits, options.baseNodeSize, availableNodeSyncs);
+			}
+		}
+		const double syncEnd = FPlatformTime::Seconds();
+		syncs.addSeconds(syncEnd - syncStart);
+
+		//Only looking, so this isn't part of the sync time
+		if (volume->hasRootOctreeNode() && !syncedEdits.isEmpty())
+		{
+			simulator.noteSyncedEdits(volume->rootOctreeNode(), syncedEdits, options.baseNodeSize);
+		}
+
+		TArray<double> latencies;
+		visibleEdits.endFrame(syncEnd, upToDate, &latencies);
+		for (double latency : latencies)
+		{
+			editToVisible.addSeconds(latency);
+		}
+
+		latencies.Reset();
+		syncedEdits.endFrame(syncEnd, upToDate, &latencies);
+		for (double latency : latencies)
+		{
+			editToSynced.addSeconds(latency);
+		}
+	}
+	runSeconds = FPlatformTime::Seconds() - runStart;
+
+	countBufferPools(bufferAllocations, bufferReuses);
+	bufferAllocations -= allocationsBefore;
+	bufferReuses -= reusesBefore;
+
+	afterFrames();
+	compareGreedyMeshing();
+	if (options.measureDiskCache)
+	{
+		measureDiskCache();
+	}
+}
+
+void FCubiquityBenchmarkRun::compareGreedyMeshing()
+{
+	//Greedy meshing is colored cubes only. The final state of the volume is converted both ways, whichever way the run used.
+	if (coloredCubesVolume && coloredCubesVolume->hasRootOctreeNode())
+	{
+		FCubiquityGreedyComparison greedy;
+		greedy.addNode(coloredCubesVolume->rootOctreeNode(), settings);
+		greedyJson = greedy.toJson();
+	}
+}
+
+void FCubiquityBenchmarkRun::measureDiskCache()
+{
+	//Sync the final state of the volume from nothing twice, first with an empty disk cache and then with the one the first
+	//sync filled. The cache gets its own directory so a real volume's cache is left alone.
+	const Cubiquity::Vector<float> eye = { options.size * 0.5f, options.size * 0.5f, options.height * 1.5f };
+	const int32 maximumSettleUpdates = 10000;
+	int32 settleUpdates = 0;
+	while (!volume->update(eye, options.lodThreshold) && ++settleUpdates < maximumSettleUpdates)
+	{
+	}
+	if (settleUpdates == maximumSettleUpdates)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("The volume was still changing after %d updates. The disk cache passes may not see the same nodes."), maximumSettleUpdates);
+	}
+
+	FCubiquityMeshDiskCache diskCache(databaseFileName + TEXT(".benchmark"), int64(options.diskCacheMegabytes) * 1024 * 1024, 0);
+	diskCache.clear();
+
+	double passMilliseconds[2] = { 0.0, 0.0 };
+	int32 passConverted[2] = { 0, 0 };
+	int32 passFromDisk[2] = { 0, 0 };
+	for (int32 pass = 0; pass < 2 && volume->hasRootOctreeNode(); ++pass)
+	{
+		FCubiquitySyncSimulator passSimulator(settings);
+		passSimulator.diskCache = &diskCache;
+		const double passStart = FPlatformTime::Seconds();
+		passSimulator.syncNode(volume->rootOctreeNode(), MAX_int32);
+		passMilliseconds[pass] = (FPlatformTime::Seconds() - passStart) * 1000.0;
+		passConverted[pass] = passSimulator.meshesConverted;
+		passFromDisk[pass] = passSimulator.meshesFromDiskCache;
+
+		//The saves are asynchronous and the warm pass has to find them
+		diskCache.flush();
+	}
+
+	diskCacheJson = FString::Printf(TEXT("\"disk_cache\":{\"limit_megabytes\":%d,\"cold_ms\":%.3f,\"cold_converted\":%d,\"warm_ms\":%.3f,\"warm_converted\":%d,\"warm_from_disk\":%d,\"bytes_on_disk\":%lld,\"evictions\":%d},\n"),
+		options.diskCacheMegabytes, passMilliseconds[0], passConverted[0], passMilliseconds[1], passConverted[1], passFromDisk[1], diskCache.bytesOnDisk(), diskCache.entriesEvicted());
+
+	diskCache.clear();
+}
+
+bool FCubiquityBenchmarkRun::writeResults(const TCHAR* backend)
+{
+	volume.reset();
+	terrainVolume = nullptr;
+	coloredCubesVolume = nullptr;
+	if (options.synthetic())
+	{
+		IFileManager::Get().Delete(*databaseFileName, false, false, true);
+	}
+
+	const double syncSeconds = syncs.total() / 1000.0;
+	FString json = TEXT("{\n");
+	json += FString::Printf(TEXT("\"config\":{%s\"type\":\"%s\",\"volume\":\"%s\",\"size\":%d,\"height\":%d,\"frames\":%d,\"edits_per_frame\":%d,\"pattern\":\"%s\",\"seed\":%d,\"base_node_size\":%d,\"lod_threshold\":%.3f,\"greedy\":%s,\"compact\":%s},\n"),
+		backend ? *FString::Printf(TEXT("\"backend\":\"%s\","), backend) : TEXT(""),
+		*options.typeName, options.synthetic() ? TEXT("synthetic") : *options.volumeFileName.Replace(TEXT("\\"), TEXT("/")), options.size, options.height, options.frames,
+		options.editsPerFrame, *options.pattern, options.seed, options.baseNodeSize, options.lodThreshold,
+		settings.greedyMeshing ? TEXT("true") : TEXT("false"), settings.compactFaceStorage ? TEXT("true") : TEXT("false"));
+	json += FString::Printf(TEXT("\"open_seconds\":%.6f,\n\"generation_seconds\":%.3f,\n\"run_seconds\":%.3f,\n"), openSeconds, generationSeconds, runSeconds);
+	json += TEXT("\"phases\":{\n");
+	json += FString::Printf(TEXT("\"edit\":%s,\n"), *edits.toJson());
+	json += extraPhasesJson();
+	json += FString::Printf(TEXT("\"volume_update\":%s,\n"), *updates.toJson());
+	json += FString::Printf(TEXT("\"octree_sync\":%s,\n"), *syncs.toJson());
+	json += FString::Printf(TEXT("\"node_conversion\":%s,\n"), *simulator.conversion.toJson());
+	json += FString::Printf(TEXT("\"collision_staging\":%s,\n"), *simulator.collisionStaging.toJson());
+	json += FString::Printf(TEXT("\"edit_to_synced\":%s,\n"), *editToSynced.toJson());
+	json += FString::Printf(TEXT("\"edit_to_visible\":%s\n"), *editToVisible.toJson());
+	json += TEXT("},\n");
+	json += FString::Printf(TEXT("\"edits_synced\":{\"synced\":%d,\"timed_out\":%d,\"unfinished\":%d},\n"),
+		syncedEdits.editsShown, syncedEdits.editsTimedOut, syncedEdits.numPending());
+	json += FString::Printf(TEXT("\"fast_lane\":{\"syncs_per_frame\":%d,\"fast_lane_syncs\":%d,\"coarse_node_syncs_per_second\":%.1f,\"hidden_nodes_deferred\":%d,\"edits_shown\":%d,\"edits_timed_out\":%d,\"edits_unfinished\":%d},\n"),
+		options.syncsPerFrame, options.fastLaneSyncs, simulator.lazyCoarseNodes ? options.coarseNodeSyncsPerSecond : 0.0f, simulator.hiddenNodesDeferred,
+		visibleEdits.editsShown, visibleEdits.editsTimedOut, visibleEdits.numPending());
+	json += FString::Printf(TEXT("\"buffer_pool\":{\"allocations\":%u,\"reuses\":%u,\"miss_rate\":%.3f},\n"),
+		bufferAllocations, bufferReuses, bufferAllocations + bufferReuses > 0 ? double(bufferAllocations) / (bufferAllocations + bufferReuses) : 0.0);
+	json += extraSectionsJson();
+	json += greedyJson;
+	json += diskCacheJson;
+	json += FString::Printf(TEXT("\"throughput\":{\"nodes_synced\":%d,\"meshes_converted\":%d,\"meshes_shared\":%d,\"vertices_converted\":%lld,\"triangles_staged\":%lld,\"nodes_per_second\":%.1f,\"vertices_per_second\":%.1f}\n"),
+		simulator.nodesSynced, simulator.meshesConverted, simulator.meshesShared, simulator.verticesConverted, simulator.trianglesStaged,
+		syncSeconds > 0.0 ? simulator.nodesSynced / syncSeconds : 0.0, syncSeconds > 0.0 ? simulator.verticesConverted / syncSeconds : 0.0);
+	json += TEXT("}\n");
+
+	UE_LOG(CubiquityLog, Display, TEXT("%s"), *json);
+
+	if (!FFileHelper::SaveStringToFile(json, *options.outputFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to write %s"), *options.outputFileName);
+		return false;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("Wrote benchmark results to %s"), *options.outputFileName);
+	return true;
+}
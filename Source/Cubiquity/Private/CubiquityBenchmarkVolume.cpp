@@ -0,0 +1,161 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBenchmarkVolume.h"
+
+const float FCubiquityBenchmarkEdit::TerrainInnerRadius = 2.0f;
+const float FCubiquityBenchmarkEdit::TerrainOuterRadius = 4.0f;
+
+void FCubiquityBenchmarkVolume::generateColoredCubes(Cubiquity::ColoredCubesVolume& volume, int32 size, int32 height)
+{
+	for (int32 y = 0; y < size; ++y)
+	{
+		for (int32 x = 0; x < size; ++x)
+		{
+			const int32 surface = FMath::Clamp(FMath::RoundToInt(height * (0.5f + 0.25f * FMath::Sin(x * 0.1f) * FMath::Cos(y * 0.13f))), 1, height - 1);
+			for (int32 z = 0; z < surface; ++z)
+			{
+				const uint8 band = uint8(64 + (z * 191) / height);
+				volume.setVoxel({ x, y, z }, Cubiquity::Color(band, uint8(255 - band), 96, 255));
+			}
+		}
+	}
+}
+
+FCubiquityBenchmarkEdit FCubiquityBenchmarkVolume::coloredCubesEdit(const FString& pattern, FRandomStream& random, int32 frame, int32 size, int32 height)
+{
+	FCubiquityBenchmarkEdit edit;
+	if (pattern == TEXT("Dig"))
+	{
+		edit.position = FVector(frame % size, size / 2, height / 2);
+		edit.radius = 2.0f;
+	}
+	else if (pattern == TEXT("Wall"))
+	{
+		edit.position = FVector(frame % size, frame % size, height / 2);
+		edit.radius = height / 2;
+	}
+	else
+	{
+		//Drawn one at a time so the sequence doesn't depend on the order the compiler evaluates arguments in
+		edit.opacity = random.FRand() < 0.5f ? 1.0f : 0.0f;
+		const int32 x = random.RandRange(0, size - 1);
+		const int32 y = random.RandRange(0, size - 1);
+		const int32 z = random.RandRange(0, height - 1);
+		edit.position = FVector(x, y, z);
+		const uint8 red = uint8(random.RandRange(0, 255));
+		const uint8 green = uint8(random.RandRange(0, 255));
+		const uint8 blue = uint8(random.RandRange(0, 255));
+		edit.color = FColor(red, green, blue, 255);
+	}
+	return edit;
+}
+
+void FCubiquityBenchmarkVolume::applyColoredCubesEdit(Cubiquity::ColoredCubesVolume& volume, const FString& pattern, const FCubiquityBenchmarkEdit& edit, int32 size, int32 height)
+{
+	const int32 cx = FMath::RoundToInt(edit.position.X);
+	if (pattern == TEXT("Dig"))
+	{
+		for (int32 z = height / 2 - 2; z <= height / 2 + 2; ++z)
+		{
+			for (int32 y = size / 2 - 2; y <= size / 2 + 2; ++y)
+			{
+				volume.setVoxel({ cx, y, z }, Cubiquity::Color(0, 0, 0, 0));
+			}
+		}
+	}
+	else if (pattern == TEXT("Wall"))
+	{
+		for (int32 z = 0; z < height; ++z)
+		{
+			volume.setVoxel({ cx, cx, z }, Cubiquity::Color(200, 200, 200, 255));
+		}
+	}
+	else
+	{
+		const Cubiquity::Vector<int32_t> position = { cx, FMath::RoundToInt(edit.position.Y), FMath::RoundToInt(edit.position.Z) };
+		volume.setVoxel(position, Cubiquity::Color(edit.color.R, edit.color.G, edit.color.B, edit.opacity > 0.0f ? 255 : 0));
+	}
+}
+
+FCubiquityBenchmarkEdit FCubiquityBenchmarkVolume::terrainEdit(const FString& pattern, FRandomStream& random, int32 frame, int32 size, int32 height)
+{
+	FCubiquityBenchmarkEdit edit;
+	edit.radius = FCubiquityBenchmarkEdit::TerrainOuterRadius;
+	if (pattern == TEXT("Dig"))
+	{
+		edit.position = FVector(frame % size, size * 0.5f, height * 0.5f);
+		edit.opacity = -1.0f;
+	}
+	else if (pattern == TEXT("Wall"))
+	{
+		edit.position = FVector(frame % size, frame % size, height * 0.75f);
+		edit.opacity = 1.0f;
+	}
+	else
+	{
+		const float x = random.FRandRange(0.0f, size);
+		const float y = random.FRandRange(0.0f, size);
+		const float z = random.FRandRange(0.0f, height);
+		edit.position = FVector(x, y, z);
+		edit.opacity = random.FRand() < 0.5f ? 1.0f : -1.0f;
+	}
+	return edit;
+}
+
+void FCubiquityBenchmarkVolume::applyTerrainEdit(Cubiquity::TerrainVolume& volume, const FCubiquityBenchmarkEdit& edit)
+{
+	volume.sculpt({ edit.position.X, edit.position.Y, edit.position.Z }, FCubiquityBenchmarkEdit::TerrainInnerRadius, FCubiquityBenchmarkEdit::TerrainOuterRadius, edit.opacity);
+}
+
+void FCubiquityGreedyComparison::addNode(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings)
+{
+	if (octreeNode.hasMesh())
+	{
+		FCubiquityConversionSettings plain = settings;
+		plain.compactFaceStorage = false;
+		plain.optimiseMeshes = false;
+		plain.greedyMeshing = false;
+		FCubiquityConversionSettings greedy = plain;
+		greedy.greedyMeshing = true;
+
+		double start = FPlatformTime::Seconds();
+		{
+			FCubiquityMeshData meshData;
+			FCubiquityMeshConverter::convert(octreeNode, plain, meshData);
+			trianglesBefore += meshData.indices.Num() / 3;
+		}
+		conversionBefore.addSeconds(FPlatformTime::Seconds() - start);
+
+		start = FPlatformTime::Seconds();
+		{
+			FCubiquityMeshData meshData;
+			FCubiquityMeshConverter::convert(octreeNode, greedy, meshData);
+			trianglesAfter += meshData.indices.Num() / 3;
+		}
+		conversionAfter.addSeconds(FPlatformTime::Seconds() - start);
+
+		nodes++;
+	}
+
+	for (uint32_t z = 0; z < 2; z++)
+	{
+		for (uint32_t y = 0; y < 2; y++)
+		{
+			for (uint32_t x = 0; x < 2; x++)
+			{
+				if (octreeNode.hasChildNode({ x, y, z }))
+				{
+					addNode(octreeNode.childNode({ x, y, z }), settings);
+				}
+			}
+		}
+	}
+}
+
+FString FCubiquityGreedyComparison::toJson()
+{
+	return FString::Printf(TEXT("\"greedy_meshing\":{\"nodes\":%d,\"triangles_before\":%lld,\"triangles_after\":%lld,\"triangle_ratio\":%.3f,\"conversion_before\":%s,\"conversion_after\":%s},\n"),
+		nodes, trianglesBefore, trianglesAfter, trianglesBefore > 0 ? double(trianglesAfter) / trianglesBefore : 0.0, *conversionBefore.toJson(), *conversionAfter.toJson());
+}
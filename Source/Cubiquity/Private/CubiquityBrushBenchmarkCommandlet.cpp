@@ -0,0 +1,294 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBrushBenchmarkCommandlet.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "CubiquityBrushEngine.h"
+
+#include <memory>
+
+namespace
+{
+	const int32 BaseNodeSize = 32;
+	const float Falloff = 1.5f;
+
+	//Room around the largest brush so none of it is clipped by the edge of the volume
+	const int32 Margin = 8;
+
+	struct FBrushCase
+	{
+		FString name;
+		FCubiquityBrush brush;
+	};
+
+	const TCHAR* modeName(ECubiquityBrushMode mode)
+	{
+		switch (mode)
+		{
+		case ECubiquityBrushMode::Add: return TEXT("Add");
+		case ECubiquityBrushMode::Remove: return TEXT("Remove");
+		case ECubiquityBrushMode::Paint: return TEXT("Paint");
+		case ECubiquityBrushMode::Smooth: return TEXT("Smooth");
+		}
+		return TEXT("Unknown");
+	}
+
+	//Every shape adding, then a sphere with each of the other modes
+	void makeCases(float radius, TArray<FBrushCase>& outCases)
+	{
+		FCubiquityBrush brush;
+		brush.size = FVector(radius);
+		brush.falloff = Falloff;
+		brush.opacity = 1.0f;
+		brush.materialIndex = 1;
+		brush.color = FColor(200, 80, 40);
+
+		brush.shape = ECubiquityBrushShape::Sphere;
+		outCases.Add({ TEXT("Sphere"), brush });
+
+		brush.shape = ECubiquityBrushShape::Box;
+		outCases.Add({ TEXT("Box"), brush });
+
+		brush.shape = ECubiquityBrushShape::Cylinder;
+		outCases.Add({ TEXT("Cylinder"), brush });
+
+		brush.shape = ECubiquityBrushShape::Sphere;
+		brush.noiseAmount = radius * 0.25f;
+		brush.noiseScale = 4.0f / radius;
+		outCases.Add({ TEXT("Noise"), brush });
+		brush.noiseAmount = 0.0f;
+
+		//Rolling bumps, 64 samples across
+		brush.shape = ECubiquityBrushShape::Heightmap;
+		brush.heightmapWidth = 64;
+		brush.heightmap.SetNumUninitialized(64 * 64);
+		for (int32 y = 0; y < 64; ++y)
+		{
+			for (int32 x = 0; x < 64; ++x)
+			{
+				brush.heightmap[y * 64 + x] = 0.5f + 0.5f * FMath::Sin(x * 0.3f) * FMath::Cos(y * 0.2f);
+			}
+		}
+		outCases.Add({ TEXT("Heightmap"), brush });
+		brush.heightmap.Empty();
+		brush.heightmapWidth = 0;
+
+		//A torus lying flat, as a stand-in for a game's own shapes
+		brush.shape = ECubiquityBrushShape::Custom;
+		brush.signedDistance = [radius](const FVector& offset)
+		{
+			const FVector2D ring(FVector2D(offset.X, offset.Y).Size() - radius * 0.7f, offset.Z);
+			return ring.Size() - radius * 0.3f;
+		};
+		outCases.Add({ TEXT("Custom"), brush });
+		brush.signedDistance = TFunction<float(const FVector&)>();
+
+		brush.shape = ECubiquityBrushShape::Sphere;
+		for (ECubiquityBrushMode mode : { ECubiquityBrushMode::Remove, ECubiquityBrushMode::Paint, ECubiquityBrushMode::Smooth })
+		{
+			brush.mode = mode;
+			outCases.Add({ TEXT("Sphere"), brush });
+		}
+	}
+
+	//A cube of volume with its lower half solid, made by the brush engine itself
+	std::unique_ptr<Cubiquity::Volume> generate(bool terrain, const FString& fileName, int32 width, double& outSeconds)
+	{
+		const double start = FPlatformTime::Seconds();
+
+		std::unique_ptr<Cubiquity::Volume> volume;
+		if (terrain)
+		{
+			volume = std::make_unique<Cubiquity::TerrainVolume>(Cubiquity::Vector<int32_t>{ 0, 0, 0 }, Cubiquity::Vector<int32_t>{ width - 1, width - 1, width - 1 }, TCHAR_TO_ANSI(*fileName), BaseNodeSize);
+		}
+		else
+		{
+			volume = std::make_unique<Cubiquity::ColoredCubesVolume>(Cubiquity::Vector<int32_t>{ 0, 0, 0 }, Cubiquity::Vector<int32_t>{ width - 1, width - 1, width - 1 }, TCHAR_TO_ANSI(*fileName), BaseNodeSize);
+		}
+
+		FCubiquityBrush ground;
+		ground.shape = ECubiquityBrushShape::Box;
+		ground.size = FVector(width * 0.5f, width * 0.5f, width * 0.25f);
+		ground.falloff = 0.0f;
+		ground.opacity = 1.0f;
+		ground.color = FColor(90, 140, 60);
+		FCubiquityBrushEngine::apply(*volume, FVector(width * 0.5f, width * 0.5f, width * 0.25f - 0.5f), ground);
+		volume->acceptOverrideChunks();
+
+		outSeconds = FPlatformTime::Seconds() - start;
+		return volume;
+	}
+}
+
+UCubiquityBrushBenchmarkCommandlet::UCubiquityBrushBenchmarkCommandlet(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	LogToConsole = true;
+}
+
+int32 UCubiquityBrushBenchmarkCommandlet::Main(const FString& Params)
+{
+	if (!FCubiquityCommandletSwitches::validate(Params, { TEXT("Type="), TEXT("Radii="), TEXT("Repeats="), TEXT("Output=") },
+		TEXT("Usage: -run=CubiquityBrushBenchmark [-Type=ColoredCubes|Terrain|Both] [-Radii=8,32,128] [-Repeats=3] [-Output=Path/To.json]")))
+	{
+		return 1;
+	}
+
+	FString typeName = TEXT("Both");
+	FString radiusList = TEXT("8,32,128");
+	FString outputFileName = FPaths::ProfilingDir() / TEXT("Cubiquity") / FString::Printf(TEXT("BrushBenchmark-%s.json"), *FDateTime::Now().ToString());
+	int32 repeats = 3;
+
+	FParse::Value(*Params, TEXT("Type="), typeName);
+	FParse::Value(*Params, TEXT("Radii="), radiusList, false);
+	FParse::Value(*Params, TEXT("Repeats="), repeats);
+	FParse::Value(*Params, TEXT("Output="), outputFileName);
+	repeats = FMath::Max(repeats, 1);
+
+	TArray<FString> radiusNames;
+	radiusList.ParseIntoArray(radiusNames, TEXT(","), true);
+	TArray<float> radii;
+	for (const FString& radiusName : radiusNames)
+	{
+		const float radius = FCString::Atof(*radiusName);
+		if (radius > 0.0f)
+		{
+			radii.Add(radius);
+		}
+	}
+	if (radii.Num() == 0)
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("No valid radii in %s"), *radiusList);
+		return 1;
+	}
+
+	TArray<bool> types;
+	if (typeName == TEXT("ColoredCubes") || typeName == TEXT("Both"))
+	{
+		types.Add(false);
+	}
+	if (typeName == TEXT("Terrain") || typeName == TEXT("Both"))
+	{
+		types.Add(true);
+	}
+	if (types.Num() == 0)
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Unknown volume type %s. Use ColoredCubes, Terrain or Both"), *typeName);
+		return 1;
+	}
+
+	float largestRadius = 0.0f;
+	for (float radius : radii)
+	{
+		largestRadius = FMath::Max(largestRadius, radius);
+	}
+	const int32 width = 2 * (FMath::CeilToInt(largestRadius + Falloff) + Margin);
+	const FVector centre(width * 0.5f);
+
+	FString json = TEXT("{\n");
+	json += FString::Printf(TEXT("\"config\":{\"type\":\"%s\",\"radii\":\"%s\",\"repeats\":%d,\"width\":%d,\"worker_threads\":%d},\n"),
+		*typeName, *radiusList, repeats, width, FTaskGraphInterface::Get().GetNumWorkerThreads());
+	json += TEXT("\"volumes\":[\n");
+
+	for (int32 typeIndex = 0; typeIndex < types.Num(); ++typeIndex)
+	{
+		const bool terrain = types[typeIndex];
+		const FString fileName = FPaths::CreateTempFilename(*(FPaths::GameSavedDir() / TEXT("Cubiquity")), TEXT("BrushBenchmark"), TEXT(".vdb"));
+
+		double generationSeconds = 0.0;
+		std::unique_ptr<Cubiquity::Volume> volume = generate(terrain, fileName, width, generationSeconds);
+
+		json += FString::Printf(TEXT("{\"type\":\"%s\",\"generation_seconds\":%.3f,\n\"brushes\":[\n"), terrain ? TEXT("Terrain") : TEXT("ColoredCubes"), generationSeconds);
+
+		bool first = true;
+		for (float radius : radii)
+		{
+			TArray<FBrushCase> cases;
+			makeCases(radius, cases);
+			for (const FBrushCase& brushCase : cases)
+			{
+				FCubiquityBrushResult total;
+				for (int32 repeat = 0; repeat < repeats; ++repeat)
+				{
+					const FCubiquityBrushResult result = FCubiquityBrushEngine::apply(*volume, centre, brushCase.brush);
+					volume->discardOverrideChunks();
+
+					total.voxelsProcessed = result.voxelsProcessed;
+					total.voxelsWritten = result.voxelsWritten;
+					total.tasks = result.tasks;
+					total.readSeconds += result.readSeconds / repeats;
+					total.computeSeconds += result.computeSeconds / repeats;
+					total.writeSeconds += result.writeSeconds / repeats;
+				}
+
+				const double seconds = total.readSeconds + total.computeSeconds + total.writeSeconds;
+				json += FString::Printf(TEXT("%s{\"shape\":\"%s\",\"mode\":\"%s\",\"radius\":%.0f,\"voxels\":%lld,\"voxels_written\":%lld,\"tasks\":%d,")
+					TEXT("\"read_ms\":%.3f,\"compute_ms\":%.3f,\"write_ms\":%.3f,\"compute_voxels_per_second\":%.0f,\"voxels_per_second\":%.0f}"),
+					first ? TEXT("") : TEXT(",\n"), *brushCase.name, modeName(brushCase.brush.mode), radius, total.voxelsProcessed, total.voxelsWritten, total.tasks,
+					total.readSeconds * 1000.0, total.computeSeconds * 1000.0, total.writeSeconds * 1000.0,
+					total.computeSeconds > 0.0 ? total.voxelsProcessed / total.computeSeconds : 0.0, seconds > 0.0 ? total.voxelsProcessed / seconds : 0.0);
+				first = false;
+			}
+		}
+		json += TEXT("\n]");
+
+		//The library's fixed spherical brushes, over the same sized sphere
+		if (terrain)
+		{
+			Cubiquity::TerrainVolume& terrainVolume = static_cast<Cubiquity::TerrainVolume&>(*volume);
+			const Cubiquity::Vector<float> position = { centre.X, centre.Y, centre.Z };
+			json += TEXT(",\n\"library\":[\n");
+			first = true;
+			for (float radius : radii)
+			{
+				const int64 across = 2 * FMath::CeilToInt(radius + Falloff) + 1;
+				const int64 voxels = across * across * across;
+				for (const TCHAR* op : { TEXT("Sculpt"), TEXT("Paint"), TEXT("Blur") })
+				{
+					double seconds = 0.0;
+					for (int32 repeat = 0; repeat < repeats; ++repeat)
+					{
+						const double start = FPlatformTime::Seconds();
+						if (FCString::Strcmp(op, TEXT("Sculpt")) == 0)
+						{
+							terrainVolume.sculpt(position, radius, radius + Falloff, 1.0f);
+						}
+						else if (FCString::Strcmp(op, TEXT("Paint")) == 0)
+						{
+							terrainVolume.paint(position, radius, radius + Falloff, 1.0f, 1);
+						}
+						else
+						{
+							terrainVolume.blur(position, radius, radius + Falloff, 1.0f);
+						}
+						seconds += (FPlatformTime::Seconds() - start) / repeats;
+						volume->discardOverrideChunks();
+					}
+
+					json += FString::Printf(TEXT("%s{\"op\":\"%s\",\"radius\":%.0f,\"voxels\":%lld,\"ms\":%.3f,\"voxels_per_second\":%.0f}"),
+						first ? TEXT("") : TEXT(",\n"), op, radius, voxels, seconds * 1000.0, seconds > 0.0 ? voxels / seconds : 0.0);
+					first = false;
+				}
+			}
+			json += TEXT("\n]");
+		}
+		json += typeIndex + 1 < types.Num() ? TEXT("},\n") : TEXT("}\n");
+
+		volume.reset();
+		IFileManager::Get().Delete(*fileName, false, false, true);
+	}
+	json += TEXT("]\n}\n");
+
+	UE_LOG(CubiquityLog, Display, TEXT("%s"), *json);
+
+	if (!FFileHelper::SaveStringToFile(json, *outputFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to write %s"), *outputFileName);
+		return 1;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("Wrote brush benchmark results to %s"), *outputFileName);
+	return 0;
+}
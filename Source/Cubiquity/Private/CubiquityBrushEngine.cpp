@@ -0,0 +1,491 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBrushEngine.h"
+
+#include "CubiquityVoxelChunk.h"
+
+#include "ParallelFor.h"
+
+namespace
+{
+	const int32 MaterialCount = 8;
+
+	//Colored cubes voxels are either solid or not, so they change where the brush is at least half applied
+	const float ColoredCubesThreshold = 0.5f;
+
+	//Lattice value in [-1, 1]
+	float latticeNoise(int32 x, int32 y, int32 z)
+	{
+		uint32 hash = uint32(x) * 73856093u ^ uint32(y) * 19349663u ^ uint32(z) * 83492791u;
+		hash = (hash ^ (hash >> 13)) * 1274126177u;
+		hash ^= hash >> 16;
+		return (hash & 0xFFFF) / 32767.5f - 1.0f;
+	}
+
+	//Smoothly interpolated lattice noise. Needs no state so the workers can all call it.
+	float valueNoise(const FVector& position)
+	{
+		const int32 x = FMath::FloorToInt(position.X);
+		const int32 y = FMath::FloorToInt(position.Y);
+		const int32 z = FMath::FloorToInt(position.Z);
+		const FVector fraction = position - FVector(x, y, z);
+		const FVector t = fraction * fraction * (FVector(3.0f) - fraction * 2.0f);
+
+		const float x00 = FMath::Lerp(latticeNoise(x, y, z), latticeNoise(x + 1, y, z), t.X);
+		const float x10 = FMath::Lerp(latticeNoise(x, y + 1, z), latticeNoise(x + 1, y + 1, z), t.X);
+		const float x01 = FMath::Lerp(latticeNoise(x, y, z + 1), latticeNoise(x + 1, y, z + 1), t.X);
+		const float x11 = FMath::Lerp(latticeNoise(x, y + 1, z + 1), latticeNoise(x + 1, y + 1, z + 1), t.X);
+		return FMath::Lerp(FMath::Lerp(x00, x10, t.Y), FMath::Lerp(x01, x11, t.Y), t.Z);
+	}
+
+	FIntVector clampVoxel(const FIntVector& voxel, const FIntVector& lower, const FIntVector& upper)
+	{
+		return FIntVector(FMath::Clamp(voxel.X, lower.X, upper.X), FMath::Clamp(voxel.Y, lower.Y, upper.Y), FMath::Clamp(voxel.Z, lower.Z, upper.Z));
+	}
+
+	float boxDistance(const FVector& offset, const FVector& halfSize)
+	{
+		const FVector d = offset.GetAbs() - halfSize;
+		return FMath::Min(d.GetMax(), 0.0f) + d.ComponentMax(FVector::ZeroVector).Size();
+	}
+
+	float heightAt(const FCubiquityBrush& brush, float u, float v)
+	{
+		const int32 width = brush.heightmapWidth;
+		const int32 height = width > 0 ? brush.heightmap.Num() / width : 0;
+		if (height == 0)
+		{
+			return 1.0f;
+		}
+
+		const float x = FMath::Clamp(u, 0.0f, 1.0f) * (width - 1);
+		const float y = FMath::Clamp(v, 0.0f, 1.0f) * (height - 1);
+		const int32 x0 = FMath::Min(FMath::FloorToInt(x), width - 1);
+		const int32 y0 = FMath::Min(FMath::FloorToInt(y), height - 1);
+		const int32 x1 = FMath::Min(x0 + 1, width - 1);
+		const int32 y1 = FMath::Min(y0 + 1, height - 1);
+		const float* row0 = brush.heightmap.GetData() + y0 * width;
+		const float* row1 = brush.heightmap.GetData() + y1 * width;
+		return FMath::Lerp(FMath::Lerp(row0[x0], row0[x1], x - x0), FMath::Lerp(row1[x0], row1[x1], x - x0), y - y0);
+	}
+
+	float signedDistance(const FCubiquityBrush& brush, const FVector& offset)
+	{
+		switch (brush.shape)
+		{
+		case ECubiquityBrushShape::Box:
+			return boxDistance(offset, brush.size);
+		case ECubiquityBrushShape::Cylinder:
+		{
+			const FVector2D d(FVector2D(offset.X, offset.Y).Size() - brush.size.X, FMath::Abs(offset.Z) - brush.size.Z);
+			return FMath::Min(FMath::Max(d.X, d.Y), 0.0f) + FVector2D(FMath::Max(d.X, 0.0f), FMath::Max(d.Y, 0.0f)).Size();
+		}
+		case ECubiquityBrushShape::Heightmap:
+		{
+			//The stamp stands on the bottom of its box and rises to the height under it
+			const float u = brush.size.X > 0.0f ? (offset.X + brush.size.X) / (2.0f * brush.size.X) : 0.5f;
+			const float v = brush.size.Y > 0.0f ? (offset.Y + brush.size.Y) / (2.0f * brush.size.Y) : 0.5f;
+			const float top = -brush.size.Z + 2.0f * brush.size.Z * heightAt(brush, u, v);
+			const float sides = boxDistance(FVector(offset.X, offset.Y, 0.0f), FVector(brush.size.X, brush.size.Y, 0.0f));
+			return FMath::Max3(sides, offset.Z - top, -brush.size.Z - offset.Z);
+		}
+		case ECubiquityBrushShape::Custom:
+			if (brush.signedDistance)
+			{
+				return brush.signedDistance(offset);
+			}
+			break;
+		case ECubiquityBrushShape::Sphere:
+			break;
+		}
+		return offset.Size() - brush.size.X;
+	}
+
+	struct FBrushPass
+	{
+		const FCubiquityBrush& brush;
+		FVector centre;
+		FIntVector footprintLower; ///< What the brush covers
+		FIntVector footprintUpper;
+		FIntVector lower; ///< What was read, which is the footprint and on Smooth the neighbours around it
+		FIntVector upper;
+		FIntVector dimensions;
+		const uint8* input;
+		uint8* output;
+		uint32 brushColor = 0;
+		uint32 emptyColor = 0;
+
+		FBrushPass(const FCubiquityBrush& inBrush) : brush(inBrush) {}
+
+		int32 index(int32 x, int32 y, int32 z) const
+		{
+			return ((z - lower.Z) * dimensions.Y + (y - lower.Y)) * dimensions.X + (x - lower.X);
+		}
+
+		//How strongly the brush applies to a voxel, opacity included
+		float alphaAt(int32 x, int32 y, int32 z) const
+		{
+			return FCubiquityBrushEngine::weight(brush, FVector(x, y, z) - centre) * FMath::Clamp(brush.opacity, 0.0f, 1.0f);
+		}
+
+		void terrainSlab(int32 lowerZ, int32 upperZ) const
+		{
+			const int32 material = FMath::Clamp(brush.materialIndex, 0, MaterialCount - 1);
+			MS_ALIGN(16) float blended[MaterialCount] GCC_ALIGN(16);
+			MS_ALIGN(16) float target[MaterialCount] GCC_ALIGN(16);
+
+			for (int32 z = lowerZ; z <= upperZ; ++z)
+			{
+				for (int32 y = footprintLower.Y; y <= footprintUpper.Y; ++y)
+				{
+					for (int32 x = footprintLower.X; x <= footprintUpper.X; ++x)
+					{
+						const float alpha = alphaAt(x, y, z);
+						if (alpha <= 0.0f)
+						{
+							continue; //Already copied
+						}
+
+						const uint8* in = input + index(x, y, z) * sizeof(uint64);
+						const VectorRegister oldLow = MakeVectorRegister(float(in[0]), float(in[1]), float(in[2]), float(in[3]));
+						const VectorRegister oldHigh = MakeVectorRegister(float(in[4]), float(in[5]), float(in[6]), float(in[7]));
+						VectorRegister targetLow;
+						VectorRegister targetHigh;
+
+						switch (brush.mode)
+						{
+						case ECubiquityBrushMode::Add:
+						case ECubiquityBrushMode::Paint:
+						{
+							//Add fills what room is left with the material, Paint moves everything there into it
+							int32 total = 0;
+							for (int32 i = 0; i < MaterialCount; ++i)
+							{
+								total += in[i];
+							}
+							const float amount = brush.mode == ECubiquityBrushMode::Add ? float(255 - total + in[material]) : float(total);
+							for (int32 i = 0; i < MaterialCount; ++i)
+							{
+								target[i] = brush.mode == ECubiquityBrushMode::Add ? float(in[i]) : 0.0f;
+							}
+							target[material] = amount;
+							targetLow = VectorLoadAligned(target);
+							targetHigh = VectorLoadAligned(target + 4);
+							break;
+						}
+						case ECubiquityBrushMode::Remove:
+							targetLow = VectorZero();
+							targetHigh = VectorZero();
+							break;
+						case ECubiquityBrushMode::Smooth:
+						default:
+						{
+							//The mean of the neighbours that were read. Only the footprint's edge is short of any.
+							targetLow = VectorZero();
+							targetHigh = VectorZero();
+							int32 neighbours = 0;
+							for (int32 nz = FMath::Max(z - 1, lower.Z); nz <= FMath::Min(z + 1, upper.Z); ++nz)
+							{
+								for (int32 ny = FMath::Max(y - 1, lower.Y); ny <= FMath::Min(y + 1, upper.Y); ++ny)
+								{
+									for (int32 nx = FMath::Max(x - 1, lower.X); nx <= FMath::Min(x + 1, upper.X); ++nx)
+									{
+										const uint8* neighbour = input + index(nx, ny, nz) * sizeof(uint64);
+										targetLow = VectorAdd(targetLow, MakeVectorRegister(float(neighbour[0]), float(neighbour[1]), float(neighbour[2]), float(neighbour[3])));
+										targetHigh = VectorAdd(targetHigh, MakeVectorRegister(float(neighbour[4]), float(neighbour[5]), float(neighbour[6]), float(neighbour[7])));
+										++neighbours;
+									}
+								}
+							}
+							const VectorRegister scale = VectorSetFloat1(1.0f / neighbours);
+							targetLow = VectorMultiply(targetLow, scale);
+							targetHigh = VectorMultiply(targetHigh, scale);
+							break;
+						}
+						}
+
+						//old + (target - old) * alpha, four materials at a time
+						const VectorRegister alphas = VectorSetFloat1(alpha);
+						VectorStoreAligned(VectorMultiplyAdd(VectorSubtract(targetLow, oldLow), alphas, oldLow), blended);
+						VectorStoreAligned(VectorMultiplyAdd(VectorSubtract(targetHigh, oldHigh), alphas, oldHigh), blended + 4);
+
+						uint8* out = output + index(x, y, z) * sizeof(uint64);
+						int32 total = 0;
+						int32 largest = 0;
+						for (int32 i = 0; i < MaterialCount; ++i)
+						{
+							out[i] = uint8(FMath::Clamp(FMath::RoundToInt(blended[i]), 0, 255));
+							total += out[i];
+							largest = out[i] > out[largest] ? i : largest;
+						}
+						//Rounding can push the total past what a voxel holds
+						if (total > 255)
+						{
+							out[largest] = uint8(out[largest] - FMath::Min<int32>(total - 255, out[largest]));
+						}
+					}
+				}
+			}
+		}
+
+		static bool isSolid(uint32 color)
+		{
+			return Cubiquity::Color(color).alpha() > 0;
+		}
+
+		void coloredCubesSlab(int32 lowerZ, int32 upperZ) const
+		{
+			for (int32 z = lowerZ; z <= upperZ; ++z)
+			{
+				for (int32 y = footprintLower.Y; y <= footprintUpper.Y; ++y)
+				{
+					for (int32 x = footprintLower.X; x <= footprintUpper.X; ++x)
+					{
+						if (alphaAt(x, y, z) < ColoredCubesThreshold)
+						{
+							continue;
+						}
+
+						uint32 color;
+						FMemory::Memcpy(&color, input + index(x, y, z) * sizeof(uint32), sizeof(color));
+
+						switch (brush.mode)
+						{
+						case ECubiquityBrushMode::Add:
+							color = brushColor;
+							break;
+						case ECubiquityBrushMode::Remove:
+							color = emptyColor;
+							break;
+						case ECubiquityBrushMode::Paint:
+							color = isSolid(color) ? brushColor : color;
+							break;
+						case ECubiquityBrushMode::Smooth:
+						{
+							//Solid where most of the neighbours are, filling in with their average colour
+							int32 neighbours = 0;
+							int32 solid = 0;
+							uint32 red = 0, green = 0, blue = 0, alpha = 0;
+							for (int32 nz = FMath::Max(z - 1, lower.Z); nz <= FMath::Min(z + 1, upper.Z); ++nz)
+							{
+								for (int32 ny = FMath::Max(y - 1, lower.Y); ny <= FMath::Min(y + 1, upper.Y); ++ny)
+								{
+									for (int32 nx = FMath::Max(x - 1, lower.X); nx <= FMath::Min(x + 1, upper.X); ++nx)
+									{
+										uint32 neighbour;
+										FMemory::Memcpy(&neighbour, input + index(nx, ny, nz) * sizeof(uint32), sizeof(neighbour));
+										++neighbours;
+										if (isSolid(neighbour))
+										{
+											const Cubiquity::Color components(neighbour);
+											red += components.red();
+											green += components.green();
+											blue += components.blue();
+											alpha += components.alpha();
+											++solid;
+										}
+									}
+								}
+							}
+
+							if (solid * 2 > neighbours && !isSolid(color))
+							{
+								color = Cubiquity::Color(uint8(red / solid), uint8(green / solid), uint8(blue / solid), uint8(alpha / solid)).colorStruct().data;
+							}
+							else if (solid * 2 <= neighbours && isSolid(color))
+							{
+								color = emptyColor;
+							}
+							break;
+						}
+						}
+
+						FMemory::Memcpy(output + index(x, y, z) * sizeof(uint32), &color, sizeof(color));
+					}
+				}
+			}
+		}
+	};
+}
+
+FVector FCubiquityBrushEngine::halfExtent(const FCubiquityBrush& brush)
+{
+	const FVector size = brush.size.GetAbs();
+	FVector extent = size;
+	switch (brush.shape)
+	{
+	case ECubiquityBrushShape::Sphere:
+		extent = FVector(size.X);
+		break;
+	case ECubiquityBrushShape::Cylinder:
+		extent = FVector(size.X, size.X, size.Z);
+		break;
+	case ECubiquityBrushShape::Box:
+	case ECubiquityBrushShape::Heightmap:
+	case ECubiquityBrushShape::Custom:
+		break;
+	}
+	return extent + FVector(FMath::Max(brush.falloff, 0.0f) + FMath::Abs(brush.noiseAmount));
+}
+
+float FCubiquityBrushEngine::weight(const FCubiquityBrush& brush, const FVector& offset)
+{
+	float distance = signedDistance(brush, offset);
+	if (brush.noiseAmount != 0.0f)
+	{
+		distance += brush.noiseAmount * valueNoise(offset * brush.noiseScale);
+	}
+
+	if (distance <= 0.0f)
+	{
+		return 1.0f;
+	}
+	if (distance >= brush.falloff)
+	{
+		return 0.0f;
+	}
+	const float t = distance / brush.falloff;
+	return 1.0f - t * t * (3.0f - 2.0f * t);
+}
+
+FCubiquityBrushResult FCubiquityBrushEngine::apply(Cubiquity::Volume& volume, const FVector& centre, const FCubiquityBrush& brush)
+{
+	FCubiquityBrushResult result;
+
+	const auto region = volume.enclosingRegion();
+	const FIntVector volumeLower(region.first.x, region.first.y, region.first.z);
+	const FIntVector volumeUpper(region.second.x, region.second.y, region.second.z);
+	const FVector extent = halfExtent(brush);
+
+	const FIntVector lower(FMath::FloorToInt(centre.X - extent.X), FMath::FloorToInt(centre.Y - extent.Y), FMath::FloorToInt(centre.Z - extent.Z));
+	const FIntVector upper(FMath::CeilToInt(centre.X + extent.X), FMath::CeilToInt(centre.Y + extent.Y), FMath::CeilToInt(centre.Z + extent.Z));
+	if (upper.X < volumeLower.X || upper.Y < volumeLower.Y || upper.Z < volumeLower.Z
+		|| lower.X > volumeUpper.X || lower.Y > volumeUpper.Y || lower.Z > volumeUpper.Z)
+	{
+		return result; //Nowhere near the volume
+	}
+
+	FBrushPass pass(brush);
+	pass.centre = centre;
+	pass.footprintLower = clampVoxel(lower, volumeLower, volumeUpper);
+	pass.footprintUpper = clampVoxel(upper, volumeLower, volumeUpper);
+	result.lower = pass.footprintLower;
+	result.upper = pass.footprintUpper;
+
+	const int32 padding = brush.mode == ECubiquityBrushMode::Smooth ? 1 : 0;
+	pass.lower = clampVoxel(pass.footprintLower - FIntVector(padding, padding, padding), volumeLower, volumeUpper);
+	pass.upper = clampVoxel(pass.footprintUpper + FIntVector(padding, padding, padding), volumeLower, volumeUpper);
+	pass.dimensions = pass.upper - pass.lower + FIntVector(1, 1, 1);
+
+	const bool terrain = volume.volumeType() == Cubiquity::VolumeType::Terrain;
+	if (!terrain)
+	{
+		//Packed here as the library's colour format is its own business
+		pass.brushColor = Cubiquity::Color(brush.color.R, brush.color.G, brush.color.B, FMath::Max<uint8>(brush.color.A, 1)).colorStruct().data;
+		pass.emptyColor = Cubiquity::Color(0, 0, 0, 0).colorStruct().data;
+	}
+
+	TArray<uint8> input;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityBrushRead);
+		const double start = FPlatformTime::Seconds();
+		FCubiquityVoxelChunk::readRegion(volume, pass.lower, pass.upper, input);
+		result.readSeconds = FPlatformTime::Seconds() - start;
+	}
+
+	TArray<uint8> output;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityBrushCompute);
+		const double start = FPlatformTime::Seconds();
+		output = input; //Anything the brush doesn't reach stays as it was
+
+		pass.input = input.GetData();
+		pass.output = output.GetData();
+
+		//Whole z slices go to each task, about VoxelsPerTask at a time, so no two tasks write the same voxel
+		const FIntVector footprint = pass.footprintUpper - pass.footprintLower + FIntVector(1, 1, 1);
+		const int32 slabDepth = FMath::Clamp(int32(VoxelsPerTask / (int64(footprint.X) * footprint.Y)), 1, footprint.Z);
+		result.tasks = (footprint.Z + slabDepth - 1) / slabDepth;
+		ParallelFor(result.tasks, [&pass, slabDepth, terrain](int32 task)
+		{
+			const int32 lowerZ = pass.footprintLower.Z + task * slabDepth;
+			const int32 upperZ = FMath::Min(lowerZ + slabDepth - 1, pass.footprintUpper.Z);
+			if (terrain)
+			{
+				pass.terrainSlab(lowerZ, upperZ);
+			}
+			else
+			{
+				pass.coloredCubesSlab(lowerZ, upperZ);
+			}
+		}, result.tasks == 1);
+
+		result.voxelsProcessed = int64(footprint.X) * footprint.Y * footprint.Z;
+		result.computeSeconds = FPlatformTime::Seconds() - start;
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityBrushWrite);
+		const double start = FPlatformTime::Seconds();
+		result.voxelsWritten = FMath::Max<int64>(FCubiquityVoxelChunk::writeRegion(volume, pass.lower, pass.upper, output, &input), 0);
+		result.writeSeconds = FPlatformTime::Seconds() - start;
+	}
+
+	INC_DWORD_STAT_BY(STAT_CubiquityBrushVoxelsProcessed, result.voxelsProcessed);
+	INC_DWORD_STAT_BY(STAT_CubiquityBrushVoxelsWritten, result.voxelsWritten);
+	return result;
+}
+
+bool FCubiquityBrushEngine::save(const FCubiquityBrush& brush, TArray<uint8>& outData)
+{
+	if (brush.shape == ECubiquityBrushShape::Custom || brush.heightmap.Num() > MaximumHeightmapSamples)
+	{
+		return false;
+	}
+
+	FMemoryWriter writer(outData);
+	uint8 shape = static_cast<uint8>(brush.shape);
+	uint8 mode = static_cast<uint8>(brush.mode);
+	FVector size = brush.size;
+	float falloff = brush.falloff;
+	float opacity = brush.opacity;
+	float noiseAmount = brush.noiseAmount;
+	float noiseScale = brush.noiseScale;
+	int32 materialIndex = brush.materialIndex;
+	FColor color = brush.color;
+	int32 heightmapWidth = brush.heightmapWidth;
+	int32 heightmapSamples = brush.heightmap.Num();
+	writer << shape << mode << size << falloff << opacity << noiseAmount << noiseScale << materialIndex << color << heightmapWidth << heightmapSamples;
+	writer.Serialize(const_cast<float*>(brush.heightmap.GetData()), heightmapSamples * sizeof(float));
+	return true;
+}
+
+bool FCubiquityBrushEngine::load(const TArray<uint8>& data, FCubiquityBrush& outBrush)
+{
+	FMemoryReader reader(data);
+	uint8 shape = 0;
+	uint8 mode = 0;
+	int32 heightmapSamples = 0;
+	reader << shape << mode << outBrush.size << outBrush.falloff << outBrush.opacity << outBrush.noiseAmount << outBrush.noiseScale
+		<< outBrush.materialIndex << outBrush.color << outBrush.heightmapWidth << heightmapSamples;
+
+	//The samples are checked against what's left before anything is allocated for them
+	if (reader.IsError() || shape >= static_cast<uint8>(ECubiquityBrushShape::Custom) || mode > static_cast<uint8>(ECubiquityBrushMode::Smooth)
+		|| heightmapSamples < 0 || heightmapSamples > MaximumHeightmapSamples || heightmapSamples * int64(sizeof(float)) != reader.TotalSize() - reader.Tell())
+	{
+		return false;
+	}
+
+	outBrush.shape = static_cast<ECubiquityBrushShape>(shape);
+	outBrush.mode = static_cast<ECubiquityBrushMode>(mode);
+	if (outBrush.size.ContainsNaN() || !FMath::IsFinite(halfExtent(outBrush).GetMax()))
+	{
+		return false;
+	}
+
+	outBrush.heightmap.SetNumUninitialized(heightmapSamples);
+	reader.Serialize(outBrush.heightmap.GetData(), heightmapSamples * sizeof(float));
+	return !reader.IsError();
+}
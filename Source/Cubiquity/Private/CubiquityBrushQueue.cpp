@@ -0,0 +1,149 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBrushQueue.h"
+
+namespace
+{
+	//Radii closer than this count as the same brush
+	const float RadiusTolerance = 0.01f;
+
+	//Path points closer than this to where the last stroke ended carry it on
+	const float StrokeJoinTolerance = 0.01f;
+
+	int64 nodesUnder(const FCubiquityRecordedEvent& event, uint32 nodeSize)
+	{
+		const float size = static_cast<float>(FMath::Max<uint32>(nodeSize, 1));
+		const FVector lower = event.position - event.outerRadius;
+		const FVector upper = event.position + event.outerRadius;
+		const int64 x = FMath::FloorToInt(upper.X / size) - FMath::FloorToInt(lower.X / size) + 1;
+		const int64 y = FMath::FloorToInt(upper.Y / size) - FMath::FloorToInt(lower.Y / size) + 1;
+		const int64 z = FMath::FloorToInt(upper.Z / size) - FMath::FloorToInt(lower.Z / size) + 1;
+		return x * y * z;
+	}
+}
+
+bool FCubiquityBrushQueue::isBrush(const FCubiquityRecordedEvent& event)
+{
+	return event.op == ECubiquityRecordedOp::SculptTerrain || event.op == ECubiquityRecordedOp::PaintTerrain || event.op == ECubiquityRecordedOp::BlurTerrain;
+}
+
+bool FCubiquityBrushQueue::canMerge(const FQueuedBrush& queued, const FCubiquityRecordedEvent& event) const
+{
+	return queued.event.op == event.op
+		&& queued.event.value == event.value
+		&& FMath::Abs(queued.event.innerRadius - event.innerRadius) < RadiusTolerance
+		&& FMath::Abs(queued.event.outerRadius - event.outerRadius) < RadiusTolerance
+		&& (queued.event.opacity >= 0.0f) == (event.opacity >= 0.0f)
+		&& FVector::Dist(queued.firstPosition, event.position) <= mergeDistance * event.outerRadius;
+}
+
+void FCubiquityBrushQueue::add(const FCubiquityRecordedEvent& event, uint32 nodeSize, double now)
+{
+	++brushesQueued;
+
+	//Newest first, stopping at the first queued brush this one has to come after
+	for (int32 i = pending.Num() - 1; i >= 0; --i)
+	{
+		if (canMerge(pending[i], event))
+		{
+			FCubiquityRecordedEvent& queued = pending[i].event;
+			const float queuedWeight = FMath::Abs(queued.opacity);
+			const float eventWeight = FMath::Abs(event.opacity);
+			const float totalWeight = queuedWeight + eventWeight;
+			if (totalWeight > 0.0f)
+			{
+				queued.position = (queued.position * queuedWeight + event.position * eventWeight) / totalWeight;
+			}
+			//Paint and blur can't go past fully painted or fully smoothed
+			const float maximumOpacity = queued.op == ECubiquityRecordedOp::SculptTerrain ? MaximumSculptOpacity : 1.0f;
+			queued.opacity = FMath::Clamp(queued.opacity + event.opacity, -maximumOpacity, maximumOpacity);
+
+			++brushesMerged;
+			remeshesAvoided += nodesUnder(event, nodeSize);
+			return;
+		}
+
+		const FCubiquityRecordedEvent& queued = pending[i].event;
+		if (FVector::Dist(queued.position, event.position) < queued.outerRadius + event.outerRadius)
+		{
+			break;
+		}
+	}
+
+	if (pending.Num() == 0)
+	{
+		firstQueued = now;
+	}
+	FQueuedBrush brush;
+	brush.event = event;
+	brush.firstPosition = event.position;
+	pending.Add(brush);
+}
+
+void FCubiquityBrushQueue::stroke(const TArray<FVector>& path, float spacing, const FCubiquityRecordedEvent& brush, uint32 nodeSize, double now)
+{
+	if (path.Num() == 0)
+	{
+		return;
+	}
+
+	//A quarter of the brush apart overlaps enough to leave no ridges
+	if (spacing <= 0.0f)
+	{
+		spacing = FMath::Max(brush.outerRadius * 0.25f, 0.25f);
+	}
+
+	FCubiquityRecordedEvent dab = brush;
+	if (!strokeOpen || FVector::Dist(path[0], strokeEnd) > StrokeJoinTolerance)
+	{
+		dab.position = path[0];
+		add(dab, nodeSize, now);
+		strokeTravel = 0.0f;
+	}
+
+	for (int32 i = 1; i < path.Num(); ++i)
+	{
+		const FVector start = path[i - 1];
+		const float length = FVector::Dist(start, path[i]);
+		if (length <= 0.0f)
+		{
+			continue;
+		}
+		const FVector direction = (path[i] - start) / length;
+
+		//The first brush on this segment goes where the spacing left over from the last one says
+		float along = spacing - strokeTravel;
+		while (along <= length)
+		{
+			dab.position = start + direction * along;
+			add(dab, nodeSize, now);
+			along += spacing;
+		}
+		strokeTravel = length - (along - spacing);
+	}
+
+	strokeOpen = true;
+	strokeEnd = path.Last();
+}
+
+void FCubiquityBrushQueue::take(TArray<FCubiquityRecordedEvent>& outEvents)
+{
+	if (pending.Num() > 0)
+	{
+		++passesApplied;
+	}
+	for (const FQueuedBrush& brush : pending)
+	{
+		outEvents.Add(brush.event);
+	}
+	pending.Reset();
+}
+
+void FCubiquityBrushQueue::reset()
+{
+	pending.Reset();
+	strokeOpen = false;
+	strokeTravel = 0.0f;
+}
@@ -0,0 +1,126 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityCheckpoints.h"
+
+void FCubiquityCheckpoints::beforeEdit(Cubiquity::Volume& volume, const FVector& position, float radius)
+{
+	if (checkpoints.Num() == 0)
+	{
+		return; //Nothing to go back to so nothing to save
+	}
+
+	FCheckpoint& current = checkpoints.Last();
+
+	TArray<FIntVector> chunks;
+	FCubiquityVoxelChunk::chunksAround(position, radius, chunks);
+	for (const FIntVector& chunk : chunks)
+	{
+		if (!current.chunks.Contains(chunk))
+		{
+			saveChunk(volume, chunk, current);
+		}
+	}
+}
+
+int32 FCubiquityCheckpoints::create()
+{
+	checkpoints.AddDefaulted();
+	return checkpoints.Num() - 1;
+}
+
+bool FCubiquityCheckpoints::restore(int32 checkpoint, TArray<FCubiquityRecordedEvent>& outWrites)
+{
+	if (!checkpoints.IsValidIndex(checkpoint))
+	{
+		return false;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityCheckpointRestore);
+
+	//A chunk changed after several checkpoints has a copy in each. The oldest is how it was at the checkpoint we want.
+	TSet<FIntVector> restored;
+	for (int32 i = checkpoint; i < checkpoints.Num(); ++i)
+	{
+		for (const FSavedChunk& savedChunk : checkpoints[i].savedChunks)
+		{
+			bool alreadyRestored = false;
+			restored.Add(savedChunk.chunk, &alreadyRestored);
+			if (!alreadyRestored)
+			{
+				FCubiquityRecordedEvent& write = outWrites[outWrites.AddDefaulted()];
+				write.op = ECubiquityRecordedOp::WriteChunk;
+				write.position = FCubiquityVoxelChunk::centre(savedChunk.chunk);
+				write.value = static_cast<uint64>(savedChunk.uncompressedSize);
+				write.payload = savedChunk.compressed;
+				INC_DWORD_STAT(STAT_CubiquityCheckpointChunksRestored);
+			}
+		}
+	}
+
+	//A discard would go back past changes only the dropped checkpoints knew about, which were committed after this one
+	if (checkpoint < numCommitted)
+	{
+		numCommitted = 0;
+	}
+
+	//The volume is about to be as it was at the checkpoint, which carries on as the current one
+	removeFrom(checkpoint);
+	checkpoints.AddDefaulted();
+	return true;
+}
+
+void FCubiquityCheckpoints::reset()
+{
+	checkpoints.Empty();
+	numCommitted = 0;
+	totalCompressedBytes = 0;
+	totalUncompressedBytes = 0;
+	SET_MEMORY_STAT(STAT_CubiquityCheckpointMemory, 0);
+}
+
+void FCubiquityCheckpoints::discarded()
+{
+	removeFrom(FMath::Min(numCommitted, checkpoints.Num()));
+}
+
+void FCubiquityCheckpoints::removeFrom(int32 first)
+{
+	for (int32 i = first; i < checkpoints.Num(); ++i)
+	{
+		for (const FSavedChunk& savedChunk : checkpoints[i].savedChunks)
+		{
+			totalCompressedBytes -= savedChunk.compressed.Num();
+			totalUncompressedBytes -= savedChunk.uncompressedSize;
+		}
+	}
+	checkpoints.SetNum(first);
+	numCommitted = FMath::Min(numCommitted, first);
+
+	SET_MEMORY_STAT(STAT_CubiquityCheckpointMemory, totalCompressedBytes);
+}
+
+void FCubiquityCheckpoints::saveChunk(Cubiquity::Volume& volume, const FIntVector& chunk, FCheckpoint& checkpoint)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityCheckpointSave);
+
+	checkpoint.chunks.Add(chunk);
+
+	if (!FCubiquityVoxelChunk::read(volume, chunk, scratch))
+	{
+		return; //Outside the volume so the edit can't change it
+	}
+
+	FSavedChunk savedChunk;
+	savedChunk.chunk = chunk;
+	savedChunk.uncompressedSize = scratch.Num();
+	FCubiquityVoxelChunk::compress(scratch, savedChunk.compressed);
+
+	totalCompressedBytes += savedChunk.compressed.Num();
+	totalUncompressedBytes += savedChunk.uncompressedSize;
+	INC_DWORD_STAT(STAT_CubiquityCheckpointChunksSaved);
+	SET_MEMORY_STAT(STAT_CubiquityCheckpointMemory, totalCompressedBytes);
+
+	checkpoint.savedChunks.Add(MoveTemp(savedChunk));
+}
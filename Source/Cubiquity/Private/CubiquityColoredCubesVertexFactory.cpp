@@ -5,6 +5,7 @@
 #include "CubiquityColoredCubesVertexFactory.h"
 
 #include "CubiquityMeshComponent.h"
+#include "CubiquityMeshData.h"
 
 void FColoredCubesVertexFactoryShaderParameters::Bind(const FShaderParameterMap& ParameterMap)
 {
@@ -93,26 +94,88 @@ IMPLEMENT_VERTEX_FACTORY_TYPE(FColoredCubesVertexFactory, "CubiquityColoredCubes
 
 
 
+FColoredCubesRenderData::FColoredCubesRenderData()
+{
+}
+
+void FColoredCubesRenderData::initResources(const FCubiquityTraceNode& traceNode)
+{
+	// Init vertex factory
+	if (usesPackedFaces())
+	{
+		PackedFacesVertexFactory.Init(&PackedFaceBuffer, &FacePaletteBuffer);
+	}
+	else
+	{
+		VertexFactory.Init(&VertexBuffer);
+	}
+
+	// Enqueue initialization of render resource. This is where the buffers are uploaded to the GPU.
+	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+		InitColoredCubesRenderData,
+		FColoredCubesRenderData*, RenderData, this,
+		FCubiquityTraceNode, TraceNode, traceNode,
+		{
+		CUBIQUITY_TRACE_NODE_SCOPE("GPU upload", TraceNode);
+		if (RenderData->usesPackedFaces())
+		{
+			RenderData->PackedFaceBuffer.InitResource();
+			RenderData->FacePaletteBuffer.InitResource();
+			RenderData->PackedFacesVertexFactory.InitResource();
+		}
+		else
+		{
+			RenderData->VertexBuffer.InitResource();
+			RenderData->IndexBuffer.InitResource();
+			RenderData->VertexFactory.InitResource();
+		}
+		});
+}
+
+FColoredCubesRenderData::~FColoredCubesRenderData()
+{
+	//The last reference is always held by a proxy so this happens on the rendering thread. Releasing what was never initialised does nothing.
+	VertexBuffer.ReleaseResource();
+	IndexBuffer.ReleaseResource();
+	VertexFactory.ReleaseResource();
+	PackedFaceBuffer.ReleaseResource();
+	FacePaletteBuffer.ReleaseResource();
+	PackedFacesVertexFactory.ReleaseResource();
+}
+
 FColoredCubesSceneProxy::FColoredCubesSceneProxy(UCubiquityMeshComponent* Component)
 	: FPrimitiveSceneProxy(Component)
 	, MaterialRelevance(Component->GetMaterialRelevance(ERHIFeatureLevel::SM4))
 {
 	//UE_LOG(CubiquityLog, Log, TEXT("Recreating proxy"));
-	//UE_LOG(CubiquityLog, Log, TEXT("Vertices in colored cubes proxy: %d"), Component->coloredCubesVertices.Num());
-	//Copy the buffers in from the component
-	for (const auto& vertex : Component->coloredCubesVertices)
+	//UE_LOG(CubiquityLog, Log, TEXT("Vertices in colored cubes proxy: %d"), Component->meshData->coloredCubesVertices.Num());
+
+	//Use the GPU buffers of any other node with the same mesh, or make them if we're the first
+	FCubiquityMeshData& meshData = *Component->meshData;
+	RenderData = meshData.coloredCubesRenderData.Pin();
+	if (!RenderData.IsValid())
 	{
-		VertexBuffer.Vertices.Add(vertex); //Do the conversion one vertex at a time
-	}
-	IndexBuffer.Indices = Component->indices;
+		RenderData = TSharedPtr<FColoredCubesRenderData, ESPMode::ThreadSafe>(new FColoredCubesRenderData());
 
-	// Init vertex factory
-	VertexFactory.Init(&VertexBuffer);
+		//Copy the buffers in from the mesh data. Packed faces go to the GPU as they are, unless it can't read buffers in the vertex shader.
+		if (meshData.packedFaces.Num() > 0 && FCubiquityPackedFacesVertexFactory::isSupported(GetScene().GetFeatureLevel()))
+		{
+			RenderData->PackedFaceBuffer.Faces = meshData.packedFaces;
+			RenderData->FacePaletteBuffer.Palette = meshData.facePalette;
+		}
+		else if (meshData.packedFaces.Num() > 0)
+		{
+			FCubiquityPackedFaces::expandFaces(meshData.packedFaces, meshData.facePalette, RenderData->VertexBuffer.Vertices, RenderData->IndexBuffer.Indices);
+		}
+		else
+		{
+			RenderData->VertexBuffer.Vertices = meshData.coloredCubesVertices;
+			RenderData->IndexBuffer.Indices = meshData.indices;
+		}
 
-	// Enqueue initialization of render resource
-	BeginInitResource(&VertexBuffer);
-	BeginInitResource(&IndexBuffer);
-	BeginInitResource(&VertexFactory);
+		RenderData->initResources(FCubiquityTrace::isRecording() ? Component->traceNode() : FCubiquityTraceNode());
+		meshData.coloredCubesRenderData = RenderData;
+	}
 
 	// Grab material
 	Material = Component->GetMaterial(0);
@@ -124,14 +187,11 @@ FColoredCubesSceneProxy::FColoredCubesSceneProxy(UCubiquityMeshComponent* Compon
 
 FColoredCubesSceneProxy::~FColoredCubesSceneProxy()
 {
-	VertexBuffer.ReleaseResource();
-	IndexBuffer.ReleaseResource();
-	VertexFactory.ReleaseResource();
 }
 
 void FColoredCubesSceneProxy::GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const
 {
-	QUICK_SCOPE_CYCLE_COUNTER(STAT_GeneratedMeshSceneProxy_DrawDynamicElements);
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityColoredCubesProxyDraw);
 
 	const bool bWireframe = AllowDebugViewmodes() && ViewFamily.EngineShowFlags.Wireframe;
 
@@ -160,7 +220,6 @@ void FColoredCubesSceneProxy::GetDynamicMeshElements(const TArray<const FSceneVi
 			// Draw the mesh.
 			FMeshBatch& Mesh = Collector.AllocateMesh();
 			Mesh.bWireframe = bWireframe;
-			Mesh.VertexFactory = &VertexFactory;
 			Mesh.MaterialRenderProxy = MaterialProxy;
 			Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
 			Mesh.Type = PT_TriangleList;
@@ -168,12 +227,25 @@ void FColoredCubesSceneProxy::GetDynamicMeshElements(const TArray<const FSceneVi
 			Mesh.bCanApplyViewModeOverrides = false;
 
 			FMeshBatchElement& BatchElement = Mesh.Elements[0];
-			BatchElement.IndexBuffer = &IndexBuffer;
 			BatchElement.PrimitiveUniformBuffer = CreatePrimitiveUniformBufferImmediate(GetLocalToWorld(), GetBounds(), GetLocalBounds(), true, UseEditorDepthTest());
 			BatchElement.FirstIndex = 0;
-			BatchElement.NumPrimitives = IndexBuffer.Indices.Num() / 3;
 			BatchElement.MinVertexIndex = 0;
-			BatchElement.MaxVertexIndex = VertexBuffer.Vertices.Num() - 1;
+			if (RenderData->usesPackedFaces())
+			{
+				//No index buffer: six vertices per face, which the vertex shader makes from the face's SV_VertexID
+				const int32 faceCount = RenderData->PackedFaceBuffer.Faces.Num();
+				Mesh.VertexFactory = &RenderData->PackedFacesVertexFactory;
+				BatchElement.IndexBuffer = nullptr;
+				BatchElement.NumPrimitives = faceCount * 2;
+				BatchElement.MaxVertexIndex = faceCount * 6 - 1;
+			}
+			else
+			{
+				Mesh.VertexFactory = &RenderData->VertexFactory;
+				BatchElement.IndexBuffer = &RenderData->IndexBuffer;
+				BatchElement.NumPrimitives = RenderData->IndexBuffer.Indices.Num() / 3;
+				BatchElement.MaxVertexIndex = RenderData->VertexBuffer.Vertices.Num() - 1;
+			}
 
 			Collector.AddMesh(ViewIndex, Mesh);
 		}
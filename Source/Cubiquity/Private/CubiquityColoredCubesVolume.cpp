@@ -34,13 +34,47 @@ void ACubiquityColoredCubesVolume::Destroyed()
 	m_volume.reset(nullptr);
 }
 
+#if WITH_EDITOR
+void ACubiquityColoredCubesVolume::PostEditChangeProperty(FPropertyChangedEvent & PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	const FName PropertyName = PropertyChangedEvent.Property ? PropertyChangedEvent.Property->GetFName() : NAME_None;
+
+	if (PropertyName == FName(TEXT("greedyMeshing")) || PropertyName == FName(TEXT("compactFaceStorage")))
+	{
+		//The meshes all need reconverting
+		recreateOctree();
+	}
+}
+#endif
+
+FCubiquityConversionSettings ACubiquityColoredCubesVolume::conversionSettings() const
+{
+	FCubiquityConversionSettings settings = Super::conversionSettings();
+	settings.volumeType = Cubiquity::VolumeType::ColoredCubes;
+	settings.greedyMeshing = greedyMeshing;
+	settings.compactFaceStorage = compactFaceStorage;
+	return settings;
+}
+
 void ACubiquityColoredCubesVolume::loadVolume()
 {
-	m_volume = loadVolumeImpl<Cubiquity::ColoredCubesVolume>();
+	loadVolumeImpl<Cubiquity::ColoredCubesVolume>();
+}
+
+void ACubiquityColoredCubesVolume::setVolume(Cubiquity::Volume* newVolume)
+{
+	m_volume.reset(static_cast<Cubiquity::ColoredCubesVolume*>(newVolume));
 }
 
 FVector ACubiquityColoredCubesVolume::pickFirstSolidVoxel(FVector localStartPosition, FVector localDirection) const
 {
+	if (!m_volume)
+	{
+		return FVector::ZeroVector; //Still being opened
+	}
+
 	bool success;
 	auto hitLocation = m_volume->pickFirstSolidVoxel({ localStartPosition.X, localStartPosition.Y, localStartPosition.Z }, { localDirection.X, localDirection.Y, localDirection.Z }, &success);
 
@@ -55,6 +89,11 @@ FVector ACubiquityColoredCubesVolume::pickFirstSolidVoxel(FVector localStartPosi
 
 FVector ACubiquityColoredCubesVolume::pickLastEmptyVoxel(FVector localStartPosition, FVector localDirection) const
 {
+	if (!m_volume)
+	{
+		return FVector::ZeroVector; //Still being opened
+	}
+
 	bool success;
 	auto hitLocation = m_volume->pickLastEmptyVoxel({ localStartPosition.X, localStartPosition.Y, localStartPosition.Z }, { localDirection.X, localDirection.Y, localDirection.Z }, &success);
 
@@ -69,11 +108,37 @@ FVector ACubiquityColoredCubesVolume::pickLastEmptyVoxel(FVector localStartPosit
 
 void ACubiquityColoredCubesVolume::setVoxel(FVector position, FColor newColor)
 {
-	m_volume->setVoxel({ position.X, position.Y, position.Z }, { newColor.R, newColor.G, newColor.B, newColor.A });
+	if (!m_volume)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("setVoxel called before the volume finished opening"));
+		return;
+	}
+
+	FCubiquityRecordedEvent event;
+	event.op = ECubiquityRecordedOp::SetColoredCubesVoxel;
+	event.position = position;
+	event.value = newColor.DWColor();
+	applyEdit(event);
+}
+
+void ACubiquityColoredCubesVolume::fillRegion(FVector lowerCorner, FVector upperCorner, FColor newColor)
+{
+	if (!m_volume)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("fillRegion called before the volume finished opening"));
+		return;
+	}
+
+	applyEdit(makeFillEvent(ECubiquityRecordedOp::FillColoredCubesRegion, lowerCorner, upperCorner, newColor.DWColor()));
 }
 
 FColor ACubiquityColoredCubesVolume::getVoxel(FVector position) const
 {
+	if (!m_volume)
+	{
+		return FColor(0, 0, 0, 0); //Still being opened
+	}
+
 	const auto& voxel = m_volume->getVoxel({ position.X, position.Y, position.Z });
 	return {voxel.red(), voxel.green(), voxel.blue(), voxel.alpha()};
 }
@@ -0,0 +1,61 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityCommandletSwitches.h"
+
+#include "Commandlets/Commandlet.h"
+
+namespace
+{
+	//Switches which reach a commandlet's Main() but are meant for the engine
+	const TCHAR* const EngineSwitches[] =
+	{
+		TEXT("run="), TEXT("nullrhi"), TEXT("unattended"), TEXT("nopause"), TEXT("nosplash"), TEXT("silent"), TEXT("stdout"),
+		TEXT("FullStdOutLogOutput"), TEXT("UTF8Output"), TEXT("AllowStdOutLogVerbosity"), TEXT("log"), TEXT("log="), TEXT("abslog="),
+		TEXT("NoLogTimes"), TEXT("LogCmds="), TEXT("ExecCmds="), TEXT("ini:"), TEXT("ddc="), TEXT("buildmachine"), TEXT("CrashForUAT"),
+		TEXT("installed"), TEXT("Multiprocess"), TEXT("messaging"), TEXT("NoShaderCompile"), TEXT("NoP4"), TEXT("SCCProvider="),
+	};
+
+	bool matches(const FString& givenSwitch, const TCHAR* knownSwitch)
+	{
+		const FString known(knownSwitch);
+		return known.EndsWith(TEXT("=")) || known.EndsWith(TEXT(":"))
+			? givenSwitch.StartsWith(known, ESearchCase::IgnoreCase)
+			: givenSwitch.Equals(known, ESearchCase::IgnoreCase);
+	}
+}
+
+bool FCubiquityCommandletSwitches::validate(const FString& params, const TArray<const TCHAR*>& known, const TCHAR* usage)
+{
+	TArray<FString> tokens;
+	TArray<FString> switches;
+	UCommandlet::ParseCommandLine(*params, tokens, switches);
+
+	bool allKnown = true;
+	for (const FString& givenSwitch : switches)
+	{
+		bool isKnown = false;
+		for (const TCHAR* knownSwitch : known)
+		{
+			isKnown = isKnown || matches(givenSwitch, knownSwitch);
+		}
+		for (const TCHAR* engineSwitch : EngineSwitches)
+		{
+			isKnown = isKnown || matches(givenSwitch, engineSwitch);
+		}
+
+		if (!isKnown)
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("Unknown switch -%s"), *givenSwitch);
+			allKnown = false;
+		}
+	}
+
+	if (!allKnown)
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("%s"), usage);
+	}
+
+	return allKnown;
+}
@@ -0,0 +1,192 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityEditLatency.h"
+
+void FCubiquityEditLatency::add(const FVector& position, float radius, double now)
+{
+	FPendingEdit edit;
+	edit.lower = FIntVector(FMath::FloorToInt(position.X - radius), FMath::FloorToInt(position.Y - radius), FMath::FloorToInt(position.Z - radius));
+	edit.upper = FIntVector(FMath::CeilToInt(position.X + radius), FMath::CeilToInt(position.Y + radius), FMath::CeilToInt(position.Z + radius));
+	edit.editedAt = Cubiquity::currentTime();
+	edit.started = now;
+	index(pending.Add(edit));
+}
+
+void FCubiquityEditLatency::reset()
+{
+	pending.Reset();
+	cells.Reset();
+	largeEdits.Reset();
+	pendingLower = FIntVector(0, 0, 0);
+	pendingUpper = FIntVector(-1, -1, -1);
+}
+
+void FCubiquityEditLatency::index(int32 editIndex)
+{
+	const FPendingEdit& edit = pending[editIndex];
+	if (editIndex == 0)
+	{
+		pendingLower = edit.lower;
+		pendingUpper = edit.upper;
+	}
+	else
+	{
+		pendingLower = FIntVector(FMath::Min(pendingLower.X, edit.lower.X), FMath::Min(pendingLower.Y, edit.lower.Y), FMath::Min(pendingLower.Z, edit.lower.Z));
+		pendingUpper = FIntVector(FMath::Max(pendingUpper.X, edit.upper.X), FMath::Max(pendingUpper.Y, edit.upper.Y), FMath::Max(pendingUpper.Z, edit.upper.Z));
+	}
+
+	const FIntVector lowerCell = cellOf(edit.lower);
+	const FIntVector upperCell = cellOf(edit.upper);
+	const int64 cellsCovered = int64(upperCell.X - lowerCell.X + 1) * (upperCell.Y - lowerCell.Y + 1) * (upperCell.Z - lowerCell.Z + 1);
+	if (cellsCovered > MaximumCellsPerEdit)
+	{
+		largeEdits.Add(editIndex);
+		return;
+	}
+
+	for (int32 z = lowerCell.Z; z <= upperCell.Z; ++z)
+	{
+		for (int32 y = lowerCell.Y; y <= upperCell.Y; ++y)
+		{
+			for (int32 x = lowerCell.X; x <= upperCell.X; ++x)
+			{
+				cells.FindOrAdd(FIntVector(x, y, z)).Add(editIndex);
+			}
+		}
+	}
+}
+
+template <typename Function>
+void FCubiquityEditLatency::forEachOverlapping(const FIntVector& lower, const FIntVector& upper, Function function) const
+{
+	//Most nodes the walks visit are nowhere near an edit
+	const FIntVector clippedLower(FMath::Max(lower.X, pendingLower.X), FMath::Max(lower.Y, pendingLower.Y), FMath::Max(lower.Z, pendingLower.Z));
+	const FIntVector clippedUpper(FMath::Min(upper.X, pendingUpper.X), FMath::Min(upper.Y, pendingUpper.Y), FMath::Min(upper.Z, pendingUpper.Z));
+	if (pending.Num() == 0 || clippedLower.X > clippedUpper.X || clippedLower.Y > clippedUpper.Y || clippedLower.Z > clippedUpper.Z)
+	{
+		return;
+	}
+
+	for (int32 editIndex : largeEdits)
+	{
+		if (overlaps(pending[editIndex], lower, upper) && !function(editIndex))
+		{
+			return;
+		}
+	}
+
+	//A coarse node spans more cells than there are edits, so checking them all is quicker
+	const FIntVector lowerCell = cellOf(clippedLower);
+	const FIntVector upperCell = cellOf(clippedUpper);
+	const int64 cellsCovered = int64(upperCell.X - lowerCell.X + 1) * (upperCell.Y - lowerCell.Y + 1) * (upperCell.Z - lowerCell.Z + 1);
+	if (cellsCovered > pending.Num())
+	{
+		for (int32 editIndex = 0; editIndex < pending.Num(); ++editIndex)
+		{
+			if (overlaps(pending[editIndex], lower, upper) && !function(editIndex))
+			{
+				return;
+			}
+		}
+		return;
+	}
+
+	for (int32 z = lowerCell.Z; z <= upperCell.Z; ++z)
+	{
+		for (int32 y = lowerCell.Y; y <= upperCell.Y; ++y)
+		{
+			for (int32 x = lowerCell.X; x <= upperCell.X; ++x)
+			{
+				if (const TArray<int32>* cellEdits = cells.Find(FIntVector(x, y, z)))
+				{
+					for (int32 editIndex : *cellEdits)
+					{
+						if (overlaps(pending[editIndex], lower, upper) && !function(editIndex))
+						{
+							return;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void FCubiquityEditLatency::nodeBounds(const Cubiquity::OctreeNode& node, uint32 baseNodeSize, FIntVector& outLower, FIntVector& outUpper)
+{
+	//A node's mesh reads a voxel either side of it so edits just outside change it too
+	const int32 size = static_cast<int32>(baseNodeSize << node.height());
+	const auto position = node.position();
+	outLower = FIntVector(position.x - 1, position.y - 1, position.z - 1);
+	outUpper = FIntVector(position.x + size + 1, position.y + size + 1, position.z + size + 1);
+}
+
+bool FCubiquityEditLatency::touches(const Cubiquity::OctreeNode& node, uint32 baseNodeSize) const
+{
+	FIntVector lower;
+	FIntVector upper;
+	nodeBounds(node, baseNodeSize, lower, upper);
+	bool touched = false;
+	forEachOverlapping(lower, upper, [&touched](int32)
+	{
+		touched = true;
+		return false;
+	});
+	return touched;
+}
+
+void FCubiquityEditLatency::visit(const Cubiquity::OctreeNode& node, uint32 baseNodeSize, bool inStep)
+{
+	FIntVector lower;
+	FIntVector upper;
+	nodeBounds(node, baseNodeSize, lower, upper);
+	const uint32 meshLastChanged = node.meshLastChanged();
+	forEachOverlapping(lower, upper, [this, inStep, meshLastChanged](int32 editIndex)
+	{
+		FPendingEdit& edit = pending[editIndex];
+		edit.waiting |= !inStep;
+		edit.remeshed |= meshLastChanged >= edit.editedAt;
+		return true;
+	});
+}
+
+void FCubiquityEditLatency::endFrame(double now, bool libraryUpToDate, TArray<double>* outLatencies)
+{
+	const int32 pendingBefore = pending.Num();
+	for (int32 i = 0; i < pending.Num(); ++i)
+	{
+		FPendingEdit& edit = pending[i];
+		if (!edit.waiting && (edit.remeshed || libraryUpToDate))
+		{
+			if (outLatencies)
+			{
+				outLatencies->Add(now - edit.started);
+			}
+			++editsShown;
+		}
+		else if (now - edit.started > timeoutSeconds)
+		{
+			++editsTimedOut;
+		}
+		else
+		{
+			edit.waiting = false;
+			continue;
+		}
+
+		pending.RemoveAt(i--);
+	}
+
+	//Taking edits out moves the others down, so the index is built again. It only holds the few still being waited for.
+	if (pending.Num() != pendingBefore)
+	{
+		cells.Reset();
+		largeEdits.Reset();
+		for (int32 i = 0; i < pending.Num(); ++i)
+		{
+			index(i);
+		}
+	}
+}
@@ -0,0 +1,311 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityEditSave.h"
+
+namespace
+{
+	const uint32 Magic = 0x44455143; //"CQED"
+
+	//Most of the time goes in compression so speed matters more than the last few percent of size
+	const ECompressionFlags RunCompression = static_cast<ECompressionFlags>(COMPRESS_ZLIB | COMPRESS_BiasSpeed);
+
+	//A run's count, then its voxel
+	const int32 MaximumCountBytes = 5;
+
+	void writePackedCount(uint32 count, TArray<uint8>& out)
+	{
+		while (count >= 0x80)
+		{
+			out.Add(static_cast<uint8>(count | 0x80));
+			count >>= 7;
+		}
+		out.Add(static_cast<uint8>(count));
+	}
+
+	bool readPackedCount(const TArray<uint8>& in, int32& position, uint32& outCount)
+	{
+		outCount = 0;
+		for (int32 shift = 0; shift < MaximumCountBytes * 7; shift += 7)
+		{
+			if (position >= in.Num())
+			{
+				return false;
+			}
+			const uint8 byte = in[position++];
+			outCount |= static_cast<uint32>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+void FCubiquityEditSave::runLengthEncode(const TArray<uint8>& voxels, int32 bytesPerVoxel, TArray<uint8>& outRuns)
+{
+	const int32 noOfVoxels = voxels.Num() / bytesPerVoxel;
+	const uint8* data = voxels.GetData();
+
+	int32 runStart = 0;
+	while (runStart < noOfVoxels)
+	{
+		const uint8* value = data + runStart * bytesPerVoxel;
+		int32 runEnd = runStart + 1;
+		while (runEnd < noOfVoxels && FMemory::Memcmp(data + runEnd * bytesPerVoxel, value, bytesPerVoxel) == 0)
+		{
+			++runEnd;
+		}
+
+		writePackedCount(runEnd - runStart, outRuns);
+		outRuns.Append(value, bytesPerVoxel);
+		runStart = runEnd;
+	}
+}
+
+bool FCubiquityEditSave::runLengthDecode(const TArray<uint8>& runs, int32& position, int32 bytesPerVoxel, int32 voxelBytes, TArray<uint8>& outVoxels)
+{
+	outVoxels.SetNumUninitialized(voxelBytes);
+	uint8* voxel = outVoxels.GetData();
+	uint8* const end = voxel + voxelBytes;
+
+	while (voxel < end)
+	{
+		uint32 count;
+		if (!readPackedCount(runs, position, count) || count == 0 || position + bytesPerVoxel > runs.Num()
+			|| count > static_cast<uint32>((end - voxel) / bytesPerVoxel))
+		{
+			return false;
+		}
+
+		const uint8* value = runs.GetData() + position;
+		position += bytesPerVoxel;
+		for (uint32 i = 0; i < count; ++i)
+		{
+			FMemory::Memcpy(voxel, value, bytesPerVoxel);
+			voxel += bytesPerVoxel;
+		}
+	}
+
+	return true;
+}
+
+bool FCubiquityEditSave::save(Cubiquity::Volume& volume, const TSet<FIntVector>& chunks, FArchive& ar)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CubiquitySaveEdits);
+
+	const Cubiquity::VolumeType volumeType = volume.volumeType();
+	const int32 bytesPerVoxel = FCubiquityVoxelChunk::bytesPerVoxel(volumeType);
+
+	//In memory order, so the same edits always make the same blob
+	TArray<FIntVector> ordered = chunks.Array();
+	ordered.Sort([](const FIntVector& a, const FIntVector& b)
+	{
+		return a.Z != b.Z ? a.Z < b.Z : (a.Y != b.Y ? a.Y < b.Y : a.X < b.X);
+	});
+
+	TArray<FIntVector> savedChunks;
+	TArray<int32> voxelBytes;
+	TArray<uint8> runs;
+	TArray<uint8> voxels;
+	for (const FIntVector& chunk : ordered)
+	{
+		if (FCubiquityVoxelChunk::read(volume, chunk, voxels))
+		{
+			savedChunks.Add(chunk);
+			voxelBytes.Add(voxels.Num());
+			runLengthEncode(voxels, bytesPerVoxel, runs);
+		}
+	}
+
+	//Compressed on its own so the checksum can be checked before anything tries to uncompress it
+	TArray<uint8> compressed;
+	int64 runBytes = runs.Num();
+	if (runBytes > 0)
+	{
+		FMemoryWriter writer(compressed);
+		writer.SerializeCompressed(runs.GetData(), runBytes, RunCompression);
+	}
+
+	uint32 magic = Magic;
+	int32 version = Version;
+	uint8 type = static_cast<uint8>(volumeType);
+	int32 chunkSize = FCubiquityVoxelChunk::Size;
+	int32 chunkCount = savedChunks.Num();
+	ar << magic << version << type << chunkSize << chunkCount;
+	for (int32 i = 0; i < chunkCount; ++i)
+	{
+		ar << savedChunks[i] << voxelBytes[i];
+	}
+
+	int32 compressedBytes = compressed.Num();
+	uint32 checksum = FCrc::MemCrc32(compressed.GetData(), compressed.Num());
+	ar << runBytes << compressedBytes << checksum;
+	ar.Serialize(compressed.GetData(), compressedBytes);
+
+	return !ar.IsError();
+}
+
+namespace
+{
+	//A blob's chunks with their runs uncompressed and checked
+	struct FSavedEdits
+	{
+		Cubiquity::VolumeType volumeType;
+		TArray<FIntVector> chunks;
+		TArray<int32> voxelBytes;
+		TArray<uint8> runs;
+	};
+
+	//Everything about a blob that can be checked without the volume it goes on. Every size is checked before it is used
+	//to allocate or read, and the checksum before the runs are uncompressed, so a damaged save can't take the game down.
+	bool readSavedEdits(FArchive& ar, FSavedEdits& out)
+	{
+		const int64 totalSize = ar.TotalSize();
+		auto bytesLeft = [&ar, totalSize]() { return totalSize >= 0 ? totalSize - ar.Tell() : MAX_int64; };
+
+		uint32 magic = 0;
+		int32 version = 0;
+		uint8 type = 0;
+		int32 chunkSize = 0;
+		int32 chunkCount = 0;
+		ar << magic << version << type << chunkSize << chunkCount;
+		if (ar.IsError() || magic != Magic || version != FCubiquityEditSave::Version)
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Saved edits are from another version or not saved edits at all"));
+			return false;
+		}
+		if (type > static_cast<uint8>(Cubiquity::VolumeType::Terrain) || chunkSize != FCubiquityVoxelChunk::Size)
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Saved edits are for another type of volume"));
+			return false;
+		}
+
+		//Each chunk is its coordinates and size
+		const int32 entryBytes = sizeof(int32) * 4;
+		if (chunkCount < 0 || chunkCount > bytesLeft() / entryBytes)
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Saved edits are corrupt"));
+			return false;
+		}
+
+		out.volumeType = static_cast<Cubiquity::VolumeType>(type);
+		const int32 bytesPerVoxel = FCubiquityVoxelChunk::bytesPerVoxel(out.volumeType);
+		const int32 largestChunkBytes = FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * bytesPerVoxel;
+
+		//A run is never bigger than the voxel it holds plus its count, so anything more is corrupt
+		int64 largestRunBytes = 0;
+		out.chunks.SetNumUninitialized(chunkCount);
+		out.voxelBytes.SetNumUninitialized(chunkCount);
+		for (int32 i = 0; i < chunkCount; ++i)
+		{
+			ar << out.chunks[i] << out.voxelBytes[i];
+			const int32 bytes = out.voxelBytes[i];
+			if (ar.IsError() || bytes <= 0 || bytes > largestChunkBytes || bytes % bytesPerVoxel != 0)
+			{
+				UE_LOG(CubiquityLog, Warning, TEXT("Saved edits are corrupt"));
+				return false;
+			}
+			largestRunBytes += (bytes / bytesPerVoxel) * int64(bytesPerVoxel + MaximumCountBytes);
+		}
+
+		int64 runBytes = 0;
+		int32 compressedBytes = 0;
+		uint32 checksum = 0;
+		ar << runBytes << compressedBytes << checksum;
+		if (ar.IsError() || runBytes < 0 || runBytes > largestRunBytes || compressedBytes < 0 || compressedBytes > bytesLeft() || (runBytes == 0) != (compressedBytes == 0))
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Saved edits are corrupt"));
+			return false;
+		}
+
+		TArray<uint8> compressed;
+		compressed.SetNumUninitialized(compressedBytes);
+		ar.Serialize(compressed.GetData(), compressedBytes);
+		if (ar.IsError() || FCrc::MemCrc32(compressed.GetData(), compressed.Num()) != checksum)
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Saved edits are corrupt"));
+			return false;
+		}
+
+		out.runs.SetNumUninitialized(runBytes);
+		if (runBytes > 0)
+		{
+			FMemoryReader reader(compressed);
+			reader.SerializeCompressed(out.runs.GetData(), runBytes, RunCompression);
+			if (reader.IsError())
+			{
+				UE_LOG(CubiquityLog, Warning, TEXT("Saved edits couldn't be uncompressed"));
+				return false;
+			}
+		}
+
+		//Every chunk has to decode, using up every run, before any of them is written
+		int32 position = 0;
+		TArray<uint8> voxels;
+		for (int32 i = 0; i < chunkCount; ++i)
+		{
+			if (!FCubiquityEditSave::runLengthDecode(out.runs, position, bytesPerVoxel, out.voxelBytes[i], voxels))
+			{
+				UE_LOG(CubiquityLog, Warning, TEXT("Saved chunk %s is corrupt"), *out.chunks[i].ToString());
+				return false;
+			}
+		}
+		if (position != out.runs.Num())
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Saved edits are corrupt"));
+			return false;
+		}
+
+		return true;
+	}
+}
+
+bool FCubiquityEditSave::isLoadable(FArchive& ar)
+{
+	FSavedEdits edits;
+	return readSavedEdits(ar, edits);
+}
+
+bool FCubiquityEditSave::load(Cubiquity::Volume& volume, FArchive& ar, TArray<FIntVector>& outChunks)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityLoadEdits);
+
+	FSavedEdits edits;
+	if (!readSavedEdits(ar, edits))
+	{
+		return false;
+	}
+
+	const Cubiquity::VolumeType volumeType = volume.volumeType();
+	if (edits.volumeType != volumeType)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("Saved edits are for another type of volume"));
+		return false;
+	}
+
+	//All or nothing, so a blob which doesn't fit leaves the volume as it was
+	for (int32 i = 0; i < edits.chunks.Num(); ++i)
+	{
+		if (FCubiquityVoxelChunk::voxelBytes(volume, edits.chunks[i]) != edits.voxelBytes[i])
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Saved chunk %s doesn't fit this volume. Were the edits saved on top of another voxel database?"), *edits.chunks[i].ToString());
+			return false;
+		}
+	}
+
+	//Writing through the volume puts the chunks in its override chunks like any other edit
+	const int32 bytesPerVoxel = FCubiquityVoxelChunk::bytesPerVoxel(volumeType);
+	int32 position = 0;
+	TArray<uint8> voxels;
+	for (int32 i = 0; i < edits.chunks.Num(); ++i)
+	{
+		runLengthDecode(edits.runs, position, bytesPerVoxel, edits.voxelBytes[i], voxels);
+		FCubiquityVoxelChunk::write(volume, edits.chunks[i], voxels);
+		outChunks.Add(edits.chunks[i]);
+	}
+
+	return true;
+}
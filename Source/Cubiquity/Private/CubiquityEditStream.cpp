@@ -0,0 +1,521 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityEditStream.h"
+
+#include "CubiquityBrushEngine.h"
+#include "CubiquityBrushQueue.h"
+
+namespace
+{
+	//Ops are numbered from 1 as 0 is Camera, which isn't sent
+	const uint32 MaximumOp = static_cast<uint32>(ECubiquityRecordedOp::BrushKernel) + 1;
+
+	//The most a WriteChunk can hold, a terrain chunk's 64 bit material sets
+	const int32 MaximumChunkBytes = FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * sizeof(uint64);
+
+	//The most a BrushKernel can hold: its settings, well within the first number, and the largest heightmap
+	const int32 MaximumBrushBytes = 256 + FCubiquityBrushEngine::MaximumHeightmapSamples * sizeof(float);
+
+	//Nothing sensible comes near this so a batch claiming more is corrupt
+	const int32 MaximumBatchBits = 8 * 1024 * 1024;
+
+	uint32 zigZag(int32 value)
+	{
+		return (static_cast<uint32>(value) << 1) ^ static_cast<uint32>(value >> 31);
+	}
+
+	int32 unZigZag(uint32 value)
+	{
+		return static_cast<int32>(value >> 1) ^ -static_cast<int32>(value & 1);
+	}
+
+	//Positions are sent as differences from the op before, which for edits made by a player are small
+	void writeDelta(FBitWriter& writer, const FIntVector& value, FIntVector& previous)
+	{
+		for (int32 i = 0; i < 3; ++i)
+		{
+			uint32 packed = zigZag(value[i] - previous[i]);
+			writer.SerializeIntPacked(packed);
+		}
+		previous = value;
+	}
+
+	FIntVector readDelta(FBitReader& reader, FIntVector& previous)
+	{
+		for (int32 i = 0; i < 3; ++i)
+		{
+			uint32 packed = 0;
+			reader.SerializeIntPacked(packed);
+			previous[i] += unZigZag(packed);
+		}
+		return previous;
+	}
+
+	void writePacked(FBitWriter& writer, int32 value)
+	{
+		uint32 packed = static_cast<uint32>(FMath::Max(value, 0));
+		writer.SerializeIntPacked(packed);
+	}
+
+	int32 readPacked(FBitReader& reader)
+	{
+		uint32 packed = 0;
+		reader.SerializeIntPacked(packed);
+		return static_cast<int32>(packed);
+	}
+
+	int32 toBrushUnits(float value)
+	{
+		return FMath::RoundToInt(value * FCubiquityEditStream::BrushUnitsPerVoxel);
+	}
+
+	float fromBrushUnits(int32 value)
+	{
+		return static_cast<float>(value) / FCubiquityEditStream::BrushUnitsPerVoxel;
+	}
+
+	//Opacity goes in 127ths, negative for digging. Merged sculpt brushes can go past 1.
+	const int32 OpacityStepsPerUnit = 127;
+	const int32 MaximumOpacityStep = FCubiquityBrushQueue::MaximumSculptOpacity * OpacityStepsPerUnit;
+	const uint32 OpacitySteps = 2 * MaximumOpacityStep + 1;
+
+	uint32 toOpacityStep(float opacity)
+	{
+		return static_cast<uint32>(FMath::Clamp(FMath::RoundToInt(opacity * OpacityStepsPerUnit), -MaximumOpacityStep, MaximumOpacityStep) + MaximumOpacityStep);
+	}
+
+	float fromOpacityStep(uint32 step)
+	{
+		return (static_cast<int32>(step) - MaximumOpacityStep) / static_cast<float>(OpacityStepsPerUnit);
+	}
+
+	//The voxel a SetVoxel op changes, rounded the same way as FCubiquityRecordedEvent::applyTo()
+	FIntVector voxelOf(const FVector& position)
+	{
+		return FIntVector(FMath::TruncToInt(position.X), FMath::TruncToInt(position.Y), FMath::TruncToInt(position.Z));
+	}
+
+	//The running values the ops of a batch are sent relative to
+	struct FStreamState
+	{
+		FIntVector lastVoxel = FIntVector(0, 0, 0);
+		FIntVector lastBrush = FIntVector(0, 0, 0);
+		FIntVector lastChunk = FIntVector(0, 0, 0);
+	};
+
+	void writeValue(FBitWriter& writer, ECubiquityRecordedOp op, uint64 value)
+	{
+		//Colours are 32 bits and material sets 64
+		if (op == ECubiquityRecordedOp::SetColoredCubesVoxel || op == ECubiquityRecordedOp::FillColoredCubesRegion)
+		{
+			uint32 color = static_cast<uint32>(value);
+			writer << color;
+		}
+		else
+		{
+			writer << value;
+		}
+	}
+
+	uint64 readValue(FBitReader& reader, ECubiquityRecordedOp op)
+	{
+		if (op == ECubiquityRecordedOp::SetColoredCubesVoxel || op == ECubiquityRecordedOp::FillColoredCubesRegion)
+		{
+			uint32 color = 0;
+			reader << color;
+			return color;
+		}
+		uint64 value = 0;
+		reader << value;
+		return value;
+	}
+
+	void writeEvent(FBitWriter& writer, const FCubiquityRecordedEvent& event, FStreamState& state)
+	{
+		writer.WriteInt(static_cast<uint32>(event.op), MaximumOp);
+
+		switch (event.op)
+		{
+		case ECubiquityRecordedOp::SetColoredCubesVoxel:
+		case ECubiquityRecordedOp::SetTerrainVoxel:
+			writeDelta(writer, voxelOf(event.position), state.lastVoxel);
+			writeValue(writer, event.op, event.value);
+			break;
+		case ECubiquityRecordedOp::FillColoredCubesRegion:
+		case ECubiquityRecordedOp::FillTerrainRegion:
+		{
+			const FVector lower = event.position - event.extent;
+			const FVector size = event.extent * 2.0f;
+			writeDelta(writer, FIntVector(FMath::RoundToInt(lower.X), FMath::RoundToInt(lower.Y), FMath::RoundToInt(lower.Z)), state.lastVoxel);
+			writePacked(writer, FMath::RoundToInt(size.X));
+			writePacked(writer, FMath::RoundToInt(size.Y));
+			writePacked(writer, FMath::RoundToInt(size.Z));
+			writeValue(writer, event.op, event.value);
+			break;
+		}
+		case ECubiquityRecordedOp::SculptTerrain:
+		case ECubiquityRecordedOp::PaintTerrain:
+		case ECubiquityRecordedOp::BlurTerrain:
+		case ECubiquityRecordedOp::Explosion:
+			writeDelta(writer, FIntVector(toBrushUnits(event.position.X), toBrushUnits(event.position.Y), toBrushUnits(event.position.Z)), state.lastBrush);
+			writePacked(writer, toBrushUnits(event.innerRadius));
+			writePacked(writer, toBrushUnits(event.outerRadius));
+			writer.WriteInt(toOpacityStep(event.opacity), OpacitySteps);
+			if (event.op == ECubiquityRecordedOp::PaintTerrain || event.op == ECubiquityRecordedOp::Explosion)
+			{
+				writePacked(writer, static_cast<int32>(event.value));
+			}
+			break;
+		case ECubiquityRecordedOp::WriteChunk:
+		{
+			writeDelta(writer, FCubiquityVoxelChunk::containing(event.position), state.lastChunk);
+			writePacked(writer, static_cast<int32>(event.value));
+			writePacked(writer, event.payload.Num());
+			writer.Serialize(const_cast<uint8*>(event.payload.GetData()), event.payload.Num());
+			break;
+		}
+		case ECubiquityRecordedOp::BrushKernel:
+			writeDelta(writer, FIntVector(toBrushUnits(event.position.X), toBrushUnits(event.position.Y), toBrushUnits(event.position.Z)), state.lastBrush);
+			writePacked(writer, event.payload.Num());
+			writer.Serialize(const_cast<uint8*>(event.payload.GetData()), event.payload.Num());
+			break;
+		case ECubiquityRecordedOp::CommitChanges:
+		case ECubiquityRecordedOp::DiscardChanges:
+		case ECubiquityRecordedOp::Camera:
+			break;
+		}
+	}
+
+	bool readEvent(FBitReader& reader, FCubiquityRecordedEvent& event, FStreamState& state)
+	{
+		const uint32 op = reader.ReadInt(MaximumOp);
+		if (reader.IsError() || op == static_cast<uint32>(ECubiquityRecordedOp::Camera))
+		{
+			return false;
+		}
+		event.op = static_cast<ECubiquityRecordedOp>(op);
+
+		switch (event.op)
+		{
+		case ECubiquityRecordedOp::SetColoredCubesVoxel:
+		case ECubiquityRecordedOp::SetTerrainVoxel:
+		{
+			const FIntVector voxel = readDelta(reader, state.lastVoxel);
+			event.position = FVector(voxel.X, voxel.Y, voxel.Z);
+			event.value = readValue(reader, event.op);
+			break;
+		}
+		case ECubiquityRecordedOp::FillColoredCubesRegion:
+		case ECubiquityRecordedOp::FillTerrainRegion:
+		{
+			const FIntVector lower = readDelta(reader, state.lastVoxel);
+			const int32 sizeX = readPacked(reader);
+			const int32 sizeY = readPacked(reader);
+			const int32 sizeZ = readPacked(reader);
+			event.extent = FVector(sizeX, sizeY, sizeZ) * 0.5f;
+			event.position = FVector(lower.X, lower.Y, lower.Z) + event.extent;
+			event.value = readValue(reader, event.op);
+			break;
+		}
+		case ECubiquityRecordedOp::SculptTerrain:
+		case ECubiquityRecordedOp::PaintTerrain:
+		case ECubiquityRecordedOp::BlurTerrain:
+		case ECubiquityRecordedOp::Explosion:
+		{
+			const FIntVector brush = readDelta(reader, state.lastBrush);
+			event.position = FVector(fromBrushUnits(brush.X), fromBrushUnits(brush.Y), fromBrushUnits(brush.Z));
+			event.innerRadius = fromBrushUnits(readPacked(reader));
+			event.outerRadius = fromBrushUnits(readPacked(reader));
+			event.opacity = fromOpacityStep(reader.ReadInt(OpacitySteps));
+			if (event.op == ECubiquityRecordedOp::PaintTerrain || event.op == ECubiquityRecordedOp::Explosion)
+			{
+				event.value = readPacked(reader);
+			}
+			break;
+		}
+		case ECubiquityRecordedOp::WriteChunk:
+		{
+			const FIntVector chunk = readDelta(reader, state.lastChunk);
+			event.position = FCubiquityVoxelChunk::centre(chunk);
+			const int32 uncompressedSize = readPacked(reader);
+			const int32 compressedSize = readPacked(reader);
+			//compress() never makes a chunk bigger, and the size has to be checked before anything is allocated for it
+			if (reader.IsError() || uncompressedSize > MaximumChunkBytes || compressedSize < 0 || compressedSize > uncompressedSize || compressedSize * 8 > reader.GetBitsLeft())
+			{
+				return false;
+			}
+			event.value = static_cast<uint64>(uncompressedSize);
+			event.payload.SetNumUninitialized(compressedSize);
+			reader.Serialize(event.payload.GetData(), compressedSize);
+			break;
+		}
+		case ECubiquityRecordedOp::BrushKernel:
+		{
+			const FIntVector brush = readDelta(reader, state.lastBrush);
+			event.position = FVector(fromBrushUnits(brush.X), fromBrushUnits(brush.Y), fromBrushUnits(brush.Z));
+			const int32 brushSize = readPacked(reader);
+			if (reader.IsError() || brushSize > MaximumBrushBytes || brushSize * 8 > reader.GetBitsLeft())
+			{
+				return false;
+			}
+			event.payload.SetNumUninitialized(brushSize);
+			reader.Serialize(event.payload.GetData(), brushSize);
+
+			//The reach isn't sent as it comes from the brush
+			FCubiquityBrush decoded;
+			if (reader.IsError() || !FCubiquityBrushEngine::load(event.payload, decoded))
+			{
+				return false;
+			}
+			event.outerRadius = FCubiquityBrushEngine::halfExtent(decoded).GetMax();
+			break;
+		}
+		default:
+			break;
+		}
+
+		return !reader.IsError();
+	}
+}
+
+bool FCubiquityEditBatch::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	uint32 ops = static_cast<uint32>(numOps);
+	uint32 bits = static_cast<uint32>(numBits);
+	Ar.SerializeIntPacked(firstSequence);
+	Ar.SerializeIntPacked(ops);
+	Ar.SerializeIntPacked(bits);
+
+	if (Ar.IsLoading())
+	{
+		if (bits > static_cast<uint32>(MaximumBatchBits))
+		{
+			Ar.SetError();
+			bOutSuccess = false;
+			return false;
+		}
+		numOps = static_cast<int32>(ops);
+		numBits = static_cast<int32>(bits);
+		data.SetNumZeroed((numBits + 7) / 8);
+	}
+
+	Ar.SerializeBits(data.GetData(), numBits);
+
+	bOutSuccess = !Ar.IsError();
+	return true;
+}
+
+int32 FCubiquityEditBatch::wireBytes() const
+{
+	FBitWriter writer(0, true);
+	bool success = false;
+	const_cast<FCubiquityEditBatch*>(this)->NetSerialize(writer, nullptr, success);
+	return writer.GetNumBytes();
+}
+
+FCubiquityRecordedEvent FCubiquityEditStream::quantise(const FCubiquityRecordedEvent& event)
+{
+	TArray<FCubiquityRecordedEvent> events;
+	events.Add(event);
+
+	TArray<FCubiquityRecordedEvent> decoded;
+	decode(encode(events, 0), decoded);
+	if (decoded.Num() != 1)
+	{
+		return event; //Camera events aren't sent so there's nothing to round
+	}
+
+	decoded[0].time = event.time;
+	return decoded[0];
+}
+
+FCubiquityEditBatch FCubiquityEditStream::encode(const TArray<FCubiquityRecordedEvent>& events, uint32 firstSequence)
+{
+	FBitWriter writer(0, true);
+	FStreamState state;
+
+	FCubiquityEditBatch batch;
+	batch.firstSequence = firstSequence;
+	for (const FCubiquityRecordedEvent& event : events)
+	{
+		if (event.op != ECubiquityRecordedOp::Camera)
+		{
+			writeEvent(writer, event, state);
+			++batch.numOps;
+		}
+	}
+
+	batch.numBits = static_cast<int32>(writer.GetNumBits());
+	batch.data.Append(writer.GetData(), writer.GetNumBytes());
+	return batch;
+}
+
+FCubiquityEditBatch FCubiquityEditStream::encode(const TArray<FCubiquityRecordedEvent>& events, uint32 firstSequence, int32 maximumBytes, int32& outTaken)
+{
+	FBitWriter writer(0, true);
+	FStreamState state;
+
+	FCubiquityEditBatch batch;
+	batch.firstSequence = firstSequence;
+	for (const FCubiquityRecordedEvent& event : events)
+	{
+		check(event.op != ECubiquityRecordedOp::Camera);
+
+		//Written and then taken back out if it doesn't fit, as the size depends on the ops before it
+		FBitWriterMark mark(writer);
+		const FStreamState stateBefore = state;
+		writeEvent(writer, event, state);
+		if (batch.numOps > 0 && writer.GetNumBytes() > maximumBytes)
+		{
+			mark.Pop(writer);
+			state = stateBefore;
+			break;
+		}
+		++batch.numOps;
+	}
+	outTaken = batch.numOps;
+
+	batch.numBits = static_cast<int32>(writer.GetNumBits());
+	batch.data.Append(writer.GetData(), writer.GetNumBytes());
+	return batch;
+}
+
+bool FCubiquityEditStream::decode(const FCubiquityEditBatch& batch, TArray<FCubiquityRecordedEvent>& outEvents)
+{
+	if (batch.numBits > batch.data.Num() * 8)
+	{
+		return false;
+	}
+
+	FBitReader reader(const_cast<uint8*>(batch.data.GetData()), batch.numBits);
+	FStreamState state;
+
+	const int32 firstEvent = outEvents.Num();
+	for (int32 i = 0; i < batch.numOps; ++i)
+	{
+		FCubiquityRecordedEvent event;
+		if (!readEvent(reader, event, state))
+		{
+			outEvents.SetNum(firstEvent);
+			return false;
+		}
+		outEvents.Add(event);
+	}
+
+	return true;
+}
+
+void FCubiquityEditSender::queue(const FCubiquityRecordedEvent& event)
+{
+	if (event.op != ECubiquityRecordedOp::Camera && event.op != ECubiquityRecordedOp::CommitChanges)
+	{
+		pending.Add(event);
+	}
+}
+
+FCubiquityEditBatch FCubiquityEditSender::takeBatch()
+{
+	int32 taken = 0;
+	FCubiquityEditBatch batch = FCubiquityEditStream::encode(pending, sequence, MaximumBatchBytes, taken);
+	sequence += taken;
+	pending.RemoveAt(0, taken, false);
+
+	const int32 bytes = batch.wireBytes();
+	opsSent += batch.numOps;
+	++batchesSent;
+	bytesSent += bytes;
+	INC_DWORD_STAT_BY(STAT_CubiquityEditOpsSent, batch.numOps);
+	INC_DWORD_STAT_BY(STAT_CubiquityEditBytesSent, bytes);
+
+	return batch;
+}
+
+void FCubiquityEditSender::dropPending()
+{
+	//They keep their numbers so a client which joins later starts from the right one
+	sequence += pending.Num();
+	pending.Reset();
+}
+
+void FCubiquityEditReceiver::receive(const FCubiquityEditBatch& batch)
+{
+	const int32 bytes = batch.wireBytes();
+	++batchesReceived;
+	bytesReceived += bytes;
+	INC_DWORD_STAT_BY(STAT_CubiquityEditBytesReceived, bytes);
+
+	//Differences rather than comparisons so that sequence numbers can wrap
+	if (static_cast<int32>(batch.firstSequence - expected) > 0)
+	{
+		early.Add(batch);
+		++batchesOutOfOrder;
+		return;
+	}
+
+	takeBatch(batch);
+	drainEarly();
+}
+
+void FCubiquityEditReceiver::skipTo(uint32 sequence)
+{
+	//The ready queue runs up to expected with no gaps
+	const uint32 firstReady = expected - ready.Num();
+	const int32 toDrop = static_cast<int32>(sequence - firstReady);
+	if (toDrop <= 0)
+	{
+		return;
+	}
+
+	if (toDrop < ready.Num())
+	{
+		ready.RemoveAt(0, toDrop);
+		return;
+	}
+
+	ready.Reset();
+	expected = sequence;
+	early.RemoveAll([this](const FCubiquityEditBatch& waiting) { return static_cast<int32>(waiting.firstSequence + waiting.numOps - expected) <= 0; });
+	drainEarly();
+}
+
+void FCubiquityEditReceiver::takeBatch(const FCubiquityEditBatch& batch)
+{
+	TArray<FCubiquityRecordedEvent> events;
+	if (!FCubiquityEditStream::decode(batch, events))
+	{
+		//Skip it rather than stall everything after it. The client's voxels no longer match until it is resynced.
+		UE_LOG(CubiquityLog, Error, TEXT("Edit batch %u with %d ops is corrupt and has been skipped"), batch.firstSequence, batch.numOps);
+		++batchesCorrupt;
+		lostOps = true;
+	}
+
+	//Anything before expected has been applied already
+	const int32 alreadyApplied = static_cast<int32>(expected - batch.firstSequence);
+	for (int32 i = alreadyApplied; i < events.Num(); ++i)
+	{
+		ready.Add(events[i]);
+		++opsReceived;
+	}
+	if (static_cast<int32>(batch.firstSequence + batch.numOps - expected) > 0)
+	{
+		expected = batch.firstSequence + batch.numOps;
+	}
+}
+
+void FCubiquityEditReceiver::drainEarly()
+{
+	for (;;)
+	{
+		const int32 unblocked = early.IndexOfByPredicate([this](const FCubiquityEditBatch& waiting) { return static_cast<int32>(waiting.firstSequence - expected) <= 0; });
+		if (unblocked == INDEX_NONE)
+		{
+			return;
+		}
+
+		const FCubiquityEditBatch batch = early[unblocked];
+		early.RemoveAtSwap(unblocked);
+		takeBatch(batch);
+	}
+}
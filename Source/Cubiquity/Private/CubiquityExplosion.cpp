@@ -0,0 +1,292 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityExplosion.h"
+
+#include "CubiquityBrushEngine.h"
+#include "CubiquityVoxelChunk.h"
+
+#include "ParallelFor.h"
+
+namespace
+{
+	//Terrain is solid where its materials add up to more than half, which is where the marching cubes surface goes
+	const int32 TerrainSolidThreshold = 128;
+
+	const int32 Empty = -1;
+
+	FCubiquityBrush craterBrush(float radius, float falloff, float roughness)
+	{
+		FCubiquityBrush brush;
+		brush.shape = ECubiquityBrushShape::Sphere;
+		brush.mode = ECubiquityBrushMode::Remove;
+		brush.size = FVector(FMath::Max(radius, 0.0f));
+		brush.falloff = FMath::Max(falloff, 0.0f);
+		brush.opacity = 1.0f;
+		brush.noiseAmount = FMath::Clamp(roughness, 0.0f, 1.0f) * brush.size.X;
+		brush.noiseScale = 2.0f / FMath::Max(brush.size.X, 1.0f); //A few lumps around the rim whatever the size
+		return brush;
+	}
+
+	bool isSolid(const uint8* voxel, bool terrain)
+	{
+		if (terrain)
+		{
+			int32 total = 0;
+			for (int32 i = 0; i < 8; ++i)
+			{
+				total += voxel[i];
+			}
+			return total >= TerrainSolidThreshold;
+		}
+
+		uint32 color;
+		FMemory::Memcpy(&color, voxel, sizeof(color));
+		return Cubiquity::Color(color).alpha() > 0;
+	}
+
+	//Only follows links, so any number of threads can call it once the links stop changing
+	int32 findRoot(const TArray<int32>& parent, int32 voxel)
+	{
+		while (parent[voxel] != voxel)
+		{
+			voxel = parent[voxel];
+		}
+		return voxel;
+	}
+
+	//Halves the path as it goes. Components always take the lowest index as their root.
+	int32 findAndShorten(TArray<int32>& parent, int32 voxel)
+	{
+		while (parent[voxel] != voxel)
+		{
+			parent[voxel] = parent[parent[voxel]];
+			voxel = parent[voxel];
+		}
+		return voxel;
+	}
+
+	void unite(TArray<int32>& parent, int32 a, int32 b)
+	{
+		const int32 rootA = findAndShorten(parent, a);
+		const int32 rootB = findAndShorten(parent, b);
+		if (rootA != rootB)
+		{
+			parent[FMath::Max(rootA, rootB)] = FMath::Min(rootA, rootB);
+		}
+	}
+}
+
+float FCubiquityExplosion::reach(float radius, float falloff, float roughness, int32 searchMargin)
+{
+	return FCubiquityBrushEngine::halfExtent(craterBrush(radius, falloff, roughness)).GetMax() + FMath::Max(searchMargin, 0);
+}
+
+FCubiquityExplosionResult FCubiquityExplosion::apply(Cubiquity::Volume& volume, const FVector& centre, float radius, float falloff, float roughness, int32 searchMargin, TArray<FCubiquityIsland>* outIslands)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityExplosion);
+
+	FCubiquityExplosionResult result;
+
+	double start = FPlatformTime::Seconds();
+	const FCubiquityBrushResult carved = FCubiquityBrushEngine::apply(volume, centre, craterBrush(radius, falloff, roughness));
+	result.voxelsCarved = carved.voxelsWritten;
+	result.carveSeconds = FPlatformTime::Seconds() - start;
+
+	start = FPlatformTime::Seconds();
+
+	const auto region = volume.enclosingRegion();
+	const FIntVector volumeLower(region.first.x, region.first.y, region.first.z);
+	const FIntVector volumeUpper(region.second.x, region.second.y, region.second.z);
+	const float extent = reach(radius, falloff, roughness, searchMargin);
+	const FIntVector lower(
+		FMath::Max(FMath::FloorToInt(centre.X - extent), volumeLower.X),
+		FMath::Max(FMath::FloorToInt(centre.Y - extent), volumeLower.Y),
+		FMath::Max(FMath::FloorToInt(centre.Z - extent), volumeLower.Z));
+	const FIntVector upper(
+		FMath::Min(FMath::CeilToInt(centre.X + extent), volumeUpper.X),
+		FMath::Min(FMath::CeilToInt(centre.Y + extent), volumeUpper.Y),
+		FMath::Min(FMath::CeilToInt(centre.Z + extent), volumeUpper.Z));
+	if (upper.X < lower.X || upper.Y < lower.Y || upper.Z < lower.Z)
+	{
+		return result; //Nowhere near the volume
+	}
+
+	const bool terrain = volume.volumeType() == Cubiquity::VolumeType::Terrain;
+	const int32 voxelBytes = FCubiquityVoxelChunk::bytesPerVoxel(volume.volumeType());
+	TArray<uint8> voxels;
+	FCubiquityVoxelChunk::readRegion(volume, lower, upper, voxels);
+
+	const FIntVector dimensions = upper - lower + FIntVector(1, 1, 1);
+	const int32 sliceVoxels = dimensions.X * dimensions.Y;
+	const int32 noOfVoxels = sliceVoxels * dimensions.Z;
+	result.voxelsSearched = noOfVoxels;
+
+	//Label each slab of z slices on its own. A slab only links voxels inside itself so no two tasks touch the same links.
+	TArray<int32> parent;
+	parent.SetNumUninitialized(noOfVoxels);
+	const int32 slabDepth = FMath::Clamp(int32(FCubiquityBrushEngine::VoxelsPerTask / sliceVoxels), 1, dimensions.Z);
+	result.tasks = (dimensions.Z + slabDepth - 1) / slabDepth;
+	ParallelFor(result.tasks, [&](int32 task)
+	{
+		const int32 lowerZ = task * slabDepth;
+		const int32 upperZ = FMath::Min(lowerZ + slabDepth, dimensions.Z);
+		for (int32 z = lowerZ; z < upperZ; ++z)
+		{
+			for (int32 y = 0; y < dimensions.Y; ++y)
+			{
+				for (int32 x = 0; x < dimensions.X; ++x)
+				{
+					const int32 voxel = (z * dimensions.Y + y) * dimensions.X + x;
+					if (!isSolid(voxels.GetData() + voxel * voxelBytes, terrain))
+					{
+						parent[voxel] = Empty;
+						continue;
+					}
+
+					parent[voxel] = voxel;
+					if (x > 0 && parent[voxel - 1] != Empty)
+					{
+						unite(parent, voxel, voxel - 1);
+					}
+					if (y > 0 && parent[voxel - dimensions.X] != Empty)
+					{
+						unite(parent, voxel, voxel - dimensions.X);
+					}
+					if (z > lowerZ && parent[voxel - sliceVoxels] != Empty)
+					{
+						unite(parent, voxel, voxel - sliceVoxels);
+					}
+				}
+			}
+		}
+	}, result.tasks == 1);
+
+	//Join the slabs where they meet
+	for (int32 task = 1; task < result.tasks; ++task)
+	{
+		const int32 first = task * slabDepth * sliceVoxels;
+		for (int32 voxel = first; voxel < first + sliceVoxels; ++voxel)
+		{
+			if (parent[voxel] != Empty && parent[voxel - sliceVoxels] != Empty)
+			{
+				unite(parent, voxel, voxel - sliceVoxels);
+			}
+		}
+	}
+
+	TArray<int32> roots;
+	roots.SetNumUninitialized(noOfVoxels);
+	ParallelFor(result.tasks, [&](int32 task)
+	{
+		const int32 first = task * slabDepth * sliceVoxels;
+		const int32 last = FMath::Min(first + slabDepth * sliceVoxels, noOfVoxels);
+		for (int32 voxel = first; voxel < last; ++voxel)
+		{
+			roots[voxel] = parent[voxel] == Empty ? Empty : findRoot(parent, voxel);
+		}
+	}, result.tasks == 1);
+
+	//The searched box's faces lead on into the rest of the volume, except where they are the volume's own sides or top.
+	//The bottom of the volume is the ground.
+	const bool openLowX = lower.X > volumeLower.X;
+	const bool openHighX = upper.X < volumeUpper.X;
+	const bool openLowY = lower.Y > volumeLower.Y;
+	const bool openHighY = upper.Y < volumeUpper.Y;
+	const bool openHighZ = upper.Z < volumeUpper.Z;
+	TBitArray<> anchored(false, noOfVoxels);
+	for (int32 z = 0; z < dimensions.Z; ++z)
+	{
+		for (int32 y = 0; y < dimensions.Y; ++y)
+		{
+			for (int32 x = 0; x < dimensions.X; ++x)
+			{
+				const int32 voxel = (z * dimensions.Y + y) * dimensions.X + x;
+				if (roots[voxel] == Empty)
+				{
+					continue;
+				}
+
+				const bool onOpenFace = z == 0
+					|| (z == dimensions.Z - 1 && openHighZ)
+					|| (x == 0 && openLowX) || (x == dimensions.X - 1 && openHighX)
+					|| (y == 0 && openLowY) || (y == dimensions.Y - 1 && openHighY);
+				if (onOpenFace)
+				{
+					anchored[roots[voxel]] = true;
+				}
+			}
+		}
+	}
+
+	//Gather and empty whatever isn't anchored
+	TArray<uint8> remaining = voxels;
+	TArray<FCubiquityIsland> islands;
+	TMap<int32, int32> islandOfRoot;
+	for (int32 voxel = 0; voxel < noOfVoxels; ++voxel)
+	{
+		const int32 root = roots[voxel];
+		if (root == Empty || anchored[root])
+		{
+			continue;
+		}
+
+		const int32* found = islandOfRoot.Find(root);
+		const int32 islandIndex = found ? *found : islandOfRoot.Add(root, islands.AddDefaulted());
+		FCubiquityIsland& island = islands[islandIndex];
+
+		const int32 x = voxel % dimensions.X;
+		const int32 y = (voxel / dimensions.X) % dimensions.Y;
+		const int32 z = voxel / sliceVoxels;
+		const FIntVector position = lower + FIntVector(x, y, z);
+		if (island.voxels.Num() == 0)
+		{
+			island.lower = position;
+			island.upper = position;
+		}
+		island.voxels.Add(position);
+		island.lower = FIntVector(FMath::Min(island.lower.X, position.X), FMath::Min(island.lower.Y, position.Y), FMath::Min(island.lower.Z, position.Z));
+		island.upper = FIntVector(FMath::Max(island.upper.X, position.X), FMath::Max(island.upper.Y, position.Y), FMath::Max(island.upper.Z, position.Z));
+		island.centre += FVector(position.X, position.Y, position.Z);
+
+		uint8* value = remaining.GetData() + voxel * voxelBytes;
+		if (terrain)
+		{
+			uint64 materialSet;
+			FMemory::Memcpy(&materialSet, value, sizeof(materialSet));
+			island.materialSets.Add(materialSet);
+			FMemory::Memzero(value, voxelBytes);
+		}
+		else
+		{
+			uint32 packed;
+			FMemory::Memcpy(&packed, value, sizeof(packed));
+			const Cubiquity::Color color(packed);
+			island.colors.Add(FColor(color.red(), color.green(), color.blue(), color.alpha()));
+			const uint32 empty = Cubiquity::Color(0, 0, 0, 0).colorStruct().data;
+			FMemory::Memcpy(value, &empty, sizeof(empty));
+		}
+	}
+
+	for (FCubiquityIsland& island : islands)
+	{
+		island.centre /= island.voxels.Num();
+		result.voxelsDetached += island.voxels.Num();
+	}
+	result.islands = islands.Num();
+
+	if (islands.Num() > 0)
+	{
+		FCubiquityVoxelChunk::writeRegion(volume, lower, upper, remaining, &voxels);
+	}
+
+	result.searchSeconds = FPlatformTime::Seconds() - start;
+	INC_DWORD_STAT_BY(STAT_CubiquityIslandsDetached, result.islands);
+
+	if (outIslands)
+	{
+		*outIslands = MoveTemp(islands);
+	}
+	return result;
+}
@@ -0,0 +1,383 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityJoinSync.h"
+
+namespace
+{
+	//The most a chunk can take, as terrain's 64 bit material sets
+	const int32 MaximumChunkBytes = FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * sizeof(uint64);
+
+	int32 floorDivide(int32 value, int32 divisor)
+	{
+		return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+	}
+}
+
+FCubiquityChunkGrid FCubiquityChunkGrid::of(const Cubiquity::Volume& volume)
+{
+	const auto region = volume.enclosingRegion();
+	const int32 size = FCubiquityVoxelChunk::Size;
+
+	FCubiquityChunkGrid grid;
+	grid.lower = FIntVector(floorDivide(region.first.x, size), floorDivide(region.first.y, size), floorDivide(region.first.z, size));
+	const FIntVector upper(floorDivide(region.second.x, size), floorDivide(region.second.y, size), floorDivide(region.second.z, size));
+	grid.count = FIntVector(upper.X - grid.lower.X + 1, upper.Y - grid.lower.Y + 1, upper.Z - grid.lower.Z + 1);
+	return grid;
+}
+
+int32 FCubiquityChunkGrid::indexOf(const FIntVector& chunk) const
+{
+	const FIntVector offset(chunk.X - lower.X, chunk.Y - lower.Y, chunk.Z - lower.Z);
+	if (offset.X < 0 || offset.Y < 0 || offset.Z < 0 || offset.X >= count.X || offset.Y >= count.Y || offset.Z >= count.Z)
+	{
+		return INDEX_NONE;
+	}
+	return offset.X + count.X * (offset.Y + count.Y * offset.Z);
+}
+
+void FCubiquityChunkHashes::reset(const Cubiquity::Volume& volume)
+{
+	chunkGrid = FCubiquityChunkGrid::of(volume);
+	hashes.SetNumZeroed(chunkGrid.num());
+	firstPass = 0;
+	changedChunks.Reset();
+	chunksHashed = 0;
+	started = true;
+}
+
+void FCubiquityChunkHashes::changed(const TArray<FIntVector>& chunks)
+{
+	for (const FIntVector& chunk : chunks)
+	{
+		//Those the first pass hasn't reached yet will be read as they are when it does
+		const int32 index = chunkGrid.indexOf(chunk);
+		if (index != INDEX_NONE && index < firstPass)
+		{
+			changedChunks.Add(index);
+		}
+	}
+}
+
+void FCubiquityChunkHashes::update(Cubiquity::Volume& volume, double seconds)
+{
+	const double stopAt = FPlatformTime::Seconds() + seconds;
+	do
+	{
+		if (firstPass >= hashes.Num())
+		{
+			return;
+		}
+		hash(volume, firstPass++);
+	}
+	while (FPlatformTime::Seconds() < stopAt);
+}
+
+void FCubiquityChunkHashes::flush(Cubiquity::Volume& volume)
+{
+	for (int32 index : changedChunks)
+	{
+		hash(volume, index);
+	}
+	changedChunks.Reset();
+
+	while (firstPass < hashes.Num())
+	{
+		hash(volume, firstPass++);
+	}
+}
+
+void FCubiquityChunkHashes::hash(Cubiquity::Volume& volume, int32 index)
+{
+	FCubiquityVoxelChunk::read(volume, chunkGrid.chunk(index), voxels);
+	hashes[index] = FCubiquityVoxelChunk::hash(voxels);
+	++chunksHashed;
+}
+
+void FCubiquityJoinSyncServer::start(const FCubiquityChunkHashes& chunkHashes, uint32 sequence)
+{
+	grid = chunkHashes.grid();
+	hashes = chunkHashes.all();
+	snapshotSequence = sequence;
+	hashesSent = 0;
+
+	kept.Reset();
+	requestComplete = false;
+	requested.Reset();
+	sent.Reset();
+	queue.Reset();
+	queuePosition = 0;
+	sliceOffset = 0;
+	current.Reset();
+
+	bytesSent = 0;
+	chunksKept = 0;
+	snapshotSeconds = 0.0;
+}
+
+bool FCubiquityJoinSyncServer::nextHashPage(FCubiquityChunkHashPage& outPage)
+{
+	if (hashesSent >= hashes.Num())
+	{
+		return false;
+	}
+
+	const int32 count = FMath::Min<int32>(HashesPerPage, hashes.Num() - hashesSent);
+	outPage.firstIndex = hashesSent;
+	outPage.totalChunks = hashes.Num();
+	outPage.sequence = snapshotSequence;
+	outPage.hashes.Reset(count);
+	outPage.hashes.Append(hashes.GetData() + hashesSent, count);
+	hashesSent += count;
+	return true;
+}
+
+void FCubiquityJoinSyncServer::compressChunk(Cubiquity::Volume& volume, int32 index, int32& outUncompressedBytes, TArray<uint8>& outCompressed)
+{
+	const double start = FPlatformTime::Seconds();
+	FCubiquityVoxelChunk::read(volume, grid.chunk(index), voxels);
+	outUncompressedBytes = voxels.Num();
+	FCubiquityVoxelChunk::compress(voxels, outCompressed);
+	snapshotSeconds += FPlatformTime::Seconds() - start;
+}
+
+void FCubiquityJoinSyncServer::beforeEdit(Cubiquity::Volume& volume, const FVector& position, float radius)
+{
+	TArray<FIntVector> chunks;
+	FCubiquityVoxelChunk::chunksAround(position, radius, chunks);
+	for (const FIntVector& chunk : chunks)
+	{
+		const int32 index = grid.indexOf(chunk);
+		if (index == INDEX_NONE || kept.Contains(index) || sent.Contains(index))
+		{
+			continue;
+		}
+
+		//Until the client has answered it could want any of them
+		if (requestComplete && !requested.Contains(index))
+		{
+			continue;
+		}
+
+		FKeptChunk& keptChunk = kept.Add(index);
+		compressChunk(volume, index, keptChunk.uncompressedBytes, keptChunk.compressed);
+		++chunksKept;
+	}
+}
+
+void FCubiquityJoinSyncServer::requestChunks(const TArray<int32>& indices, bool last)
+{
+	if (requestComplete)
+	{
+		return;
+	}
+
+	//The client's order is kept so that its nearest chunks come first
+	for (int32 index : indices)
+	{
+		if (hashes.IsValidIndex(index) && !requested.Contains(index))
+		{
+			requested.Add(index);
+			queue.Add(index);
+		}
+	}
+
+	if (last)
+	{
+		requestComplete = true;
+		for (auto iterator = kept.CreateIterator(); iterator; ++iterator)
+		{
+			if (!requested.Contains(iterator.Key()))
+			{
+				iterator.RemoveCurrent();
+			}
+		}
+	}
+}
+
+bool FCubiquityJoinSyncServer::nextSlice(Cubiquity::Volume& volume, FCubiquityChunkSlice& outSlice)
+{
+	if (queuePosition >= queue.Num())
+	{
+		return false;
+	}
+
+	const int32 index = queue[queuePosition];
+	if (sliceOffset == 0)
+	{
+		//A chunk which hasn't been edited since the hashes were sent is read as it is now
+		FKeptChunk keptChunk;
+		if (kept.RemoveAndCopyValue(index, keptChunk))
+		{
+			currentUncompressedBytes = keptChunk.uncompressedBytes;
+			current = MoveTemp(keptChunk.compressed);
+		}
+		else
+		{
+			compressChunk(volume, index, currentUncompressedBytes, current);
+		}
+		sent.Add(index);
+	}
+
+	const int32 sliceBytes = FMath::Min<int32>(MaximumSliceBytes, current.Num() - sliceOffset);
+
+	outSlice.chunkIndex = index;
+	outSlice.offset = sliceOffset;
+	outSlice.compressedBytes = current.Num();
+	outSlice.uncompressedBytes = currentUncompressedBytes;
+	outSlice.data.Reset();
+	outSlice.data.Append(current.GetData() + sliceOffset, sliceBytes);
+
+	sliceOffset += sliceBytes;
+	if (sliceOffset >= current.Num())
+	{
+		++queuePosition;
+		sliceOffset = 0;
+	}
+
+	bytesSent += sliceBytes;
+	INC_DWORD_STAT_BY(STAT_CubiquityJoinSyncBytesSent, sliceBytes);
+	return true;
+}
+
+void FCubiquityJoinSyncClient::start(const FVector& spawnPoint, float playableRadius)
+{
+	spawn = spawnPoint;
+	radius = playableRadius;
+	hashesStarted = false;
+	serverChunks = 0;
+	serverSequence = 0;
+	serverHashes.Reset();
+	compared = false;
+	remaining.Reset();
+	chunksRemaining = 0;
+	nearChunksRemaining = 0;
+	partialIndex = INDEX_NONE;
+	candidateChunks = 0;
+	neededChunks = 0;
+	bytesReceived = 0;
+}
+
+bool FCubiquityJoinSyncClient::receiveHashes(const FCubiquityChunkHashPage& page)
+{
+	if (!hashesStarted)
+	{
+		hashesStarted = true;
+		serverChunks = page.totalChunks;
+		serverSequence = page.sequence;
+	}
+
+	if (page.firstIndex != serverHashes.Num() || page.totalChunks != serverChunks || page.sequence != serverSequence
+		|| page.hashes.Num() > FCubiquityJoinSyncServer::HashesPerPage || serverHashes.Num() + page.hashes.Num() > serverChunks)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("Join sync hashes from %d arrived out of order"), page.firstIndex);
+		return false;
+	}
+
+	serverHashes.Append(page.hashes);
+	return true;
+}
+
+bool FCubiquityJoinSyncClient::isNear(const FIntVector& chunk) const
+{
+	const FVector lower = FVector(chunk.X, chunk.Y, chunk.Z) * FCubiquityVoxelChunk::Size;
+	const FBox bounds(lower, lower + FCubiquityVoxelChunk::Size);
+	return bounds.ComputeSquaredDistanceToPoint(spawn) <= FMath::Square(radius);
+}
+
+void FCubiquityJoinSyncClient::compare(const FCubiquityChunkHashes& ours, TArray<int32>& outNeeded)
+{
+	grid = ours.grid();
+	candidateChunks = serverHashes.Num();
+
+	const TArray<uint32>& ourHashes = ours.all();
+	if (ourHashes.Num() != serverHashes.Num())
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("The server's volume has %d chunks and ours has %d, so they can't be synced"), serverHashes.Num(), ourHashes.Num());
+	}
+	else
+	{
+		for (int32 i = 0; i < serverHashes.Num(); ++i)
+		{
+			if (ourHashes[i] != serverHashes[i])
+			{
+				outNeeded.Add(i);
+			}
+		}
+	}
+
+	//Nearest first so that what the player needs to start comes first
+	const FCubiquityChunkGrid& chunks = grid;
+	const FVector& spawnPoint = spawn;
+	outNeeded.Sort([&chunks, &spawnPoint](int32 a, int32 b)
+	{
+		return FVector::DistSquared(FCubiquityVoxelChunk::centre(chunks.chunk(a)), spawnPoint) < FVector::DistSquared(FCubiquityVoxelChunk::centre(chunks.chunk(b)), spawnPoint);
+	});
+
+	for (int32 index : outNeeded)
+	{
+		remaining.Add(index);
+		if (isNear(grid.chunk(index)))
+		{
+			++nearChunksRemaining;
+		}
+	}
+
+	neededChunks = outNeeded.Num();
+	chunksRemaining = neededChunks;
+	compared = true;
+}
+
+bool FCubiquityJoinSyncClient::receiveSlice(Cubiquity::Volume& volume, const FCubiquityChunkSlice& slice, FIntVector& outChunk)
+{
+	bytesReceived += slice.data.Num();
+	INC_DWORD_STAT_BY(STAT_CubiquityJoinSyncBytesReceived, slice.data.Num());
+
+	if (!remaining.Contains(slice.chunkIndex))
+	{
+		return false; //Not one we asked for, or already have
+	}
+
+	//compress() never makes a chunk bigger, and each slice has to fit in its chunk
+	if (slice.uncompressedBytes <= 0 || slice.uncompressedBytes > MaximumChunkBytes || slice.compressedBytes <= 0 || slice.compressedBytes > slice.uncompressedBytes
+		|| slice.offset < 0 || slice.data.Num() == 0 || slice.data.Num() > slice.compressedBytes - slice.offset)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("Join sync slice of chunk %d at %d doesn't fit in it"), slice.chunkIndex, slice.offset);
+		partialIndex = INDEX_NONE;
+		return false;
+	}
+
+	//Slices of a chunk come in order, one chunk after another
+	if (slice.offset == 0)
+	{
+		partialIndex = slice.chunkIndex;
+		partial.Reset(slice.compressedBytes);
+	}
+	if (slice.chunkIndex != partialIndex || slice.offset != partial.Num())
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("Join sync slice of chunk %d at %d arrived out of order"), slice.chunkIndex, slice.offset);
+		partialIndex = INDEX_NONE;
+		return false;
+	}
+	partial.Append(slice.data);
+	if (partial.Num() < slice.compressedBytes)
+	{
+		return false;
+	}
+
+	partialIndex = INDEX_NONE;
+	outChunk = grid.chunk(slice.chunkIndex);
+	if (!FCubiquityVoxelChunk::uncompress(partial, slice.uncompressedBytes, voxels) || !FCubiquityVoxelChunk::write(volume, outChunk, voxels))
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("Join sync chunk %s couldn't be written"), *outChunk.ToString());
+	}
+
+	remaining.Remove(slice.chunkIndex);
+	--chunksRemaining;
+	if (isNear(outChunk))
+	{
+		--nearChunksRemaining;
+	}
+	return true;
+}
@@ -0,0 +1,503 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityJoinSyncCommandlet.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "CubiquityJoinSync.h"
+#include "CubiquitySessionRecording.h"
+
+#include "Networking.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+#include <memory>
+
+namespace
+{
+	//The messages mirror UCubiquityJoinSyncComponent's functions
+	enum class EMessage : uint8
+	{
+		RequestJoinSync,
+		Hashes,
+		RequestChunks,
+		Slice,
+		Finished,
+	};
+
+	//Type byte and payload length in front of each message
+	const int32 HeaderBytes = 5;
+
+	//Long enough for either end to hash its volume
+	const float ReceiveTimeoutSeconds = 60.0f;
+
+	std::unique_ptr<Cubiquity::Volume> openCopy(const FCubiquitySessionRecording& recording, const FString& volumeFileName, const TCHAR* name, FString& outCopyFileName)
+	{
+		outCopyFileName = FPaths::CreateTempFilename(*(FPaths::GameSavedDir() / TEXT("Cubiquity")), name, TEXT(".vdb"));
+		if (IFileManager::Get().Copy(*outCopyFileName, *volumeFileName) != COPY_OK)
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("Failed to copy %s to %s"), *volumeFileName, *outCopyFileName);
+			return nullptr;
+		}
+
+		if (recording.conversionSettings().volumeType == Cubiquity::VolumeType::Terrain)
+		{
+			return std::make_unique<Cubiquity::TerrainVolume>(TCHAR_TO_ANSI(*outCopyFileName), Cubiquity::WritePermissions::ReadWrite, recording.baseNodeSize());
+		}
+		return std::make_unique<Cubiquity::ColoredCubesVolume>(TCHAR_TO_ANSI(*outCopyFileName), Cubiquity::WritePermissions::ReadWrite, recording.baseNodeSize());
+	}
+
+	bool sendAll(FSocket& socket, const uint8* data, int32 count)
+	{
+		while (count > 0)
+		{
+			int32 sent = 0;
+			if (!socket.Send(data, count, sent) || sent <= 0)
+			{
+				return false;
+			}
+			data += sent;
+			count -= sent;
+		}
+		return true;
+	}
+
+	bool receiveAll(FSocket& socket, uint8* data, int32 count)
+	{
+		while (count > 0)
+		{
+			if (!socket.Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(ReceiveTimeoutSeconds)))
+			{
+				return false;
+			}
+
+			int32 read = 0;
+			if (!socket.Recv(data, count, read) || read <= 0)
+			{
+				return false;
+			}
+			data += read;
+			count -= read;
+		}
+		return true;
+	}
+
+	//\return the bytes put on the wire, or 0 if the connection has gone
+	int32 sendMessage(FSocket& socket, EMessage type, const TArray<uint8>& payload)
+	{
+		TArray<uint8> message;
+		FMemoryWriter writer(message);
+		uint8 typeByte = static_cast<uint8>(type);
+		uint32 length = payload.Num();
+		writer << typeByte << length;
+		message.Append(payload);
+		return sendAll(socket, message.GetData(), message.Num()) ? message.Num() : 0;
+	}
+
+	int32 receiveMessage(FSocket& socket, EMessage& outType, TArray<uint8>& outPayload)
+	{
+		TArray<uint8> header;
+		header.SetNumUninitialized(HeaderBytes);
+		if (!receiveAll(socket, header.GetData(), HeaderBytes))
+		{
+			return 0;
+		}
+
+		FMemoryReader reader(header);
+		uint8 typeByte = 0;
+		uint32 length = 0;
+		reader << typeByte << length;
+		outType = static_cast<EMessage>(typeByte);
+
+		outPayload.SetNumUninitialized(length);
+		return receiveAll(socket, outPayload.GetData(), length) ? HeaderBytes + length : 0;
+	}
+
+	template <typename Writer>
+	TArray<uint8> makePayload(Writer write)
+	{
+		TArray<uint8> payload;
+		FMemoryWriter writer(payload);
+		write(writer);
+		return payload;
+	}
+
+	FSocket* connectToServer(const FString& serverAddress, int32 port)
+	{
+		FIPv4Address address;
+		if (!FIPv4Address::Parse(serverAddress, address))
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("'%s' isn't an IPv4 address"), *serverAddress);
+			return nullptr;
+		}
+
+		ISocketSubsystem* sockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+		FSocket* socket = sockets->CreateSocket(NAME_Stream, TEXT("CubiquityJoinSyncClient"), false);
+		const FIPv4Endpoint endpoint(address, port);
+
+		//The server may still be applying its recording
+		const double giveUp = FPlatformTime::Seconds() + ReceiveTimeoutSeconds;
+		while (!socket->Connect(*endpoint.ToInternetAddr()))
+		{
+			if (FPlatformTime::Seconds() > giveUp)
+			{
+				UE_LOG(CubiquityLog, Error, TEXT("Couldn't connect to %s"), *endpoint.ToString());
+				sockets->DestroySocket(socket);
+				return nullptr;
+			}
+			FPlatformProcess::Sleep(0.5f);
+		}
+		return socket;
+	}
+
+	int32 runServer(const FCubiquitySessionRecording& recording, const FString& volumeFileName, int32 port, float kilobytesPerSecond)
+	{
+		FString copyFileName;
+		std::unique_ptr<Cubiquity::Volume> volume = openCopy(recording, volumeFileName, TEXT("JoinSyncServer"), copyFileName);
+		if (!volume)
+		{
+			return 1;
+		}
+
+		//Play the session as the game would have
+		int32 edits = 0;
+		for (const FCubiquityRecordedEvent& event : recording.events())
+		{
+			if (event.isVoxelEdit())
+			{
+				event.applyTo(*volume);
+				++edits;
+			}
+		}
+
+		//The game spreads this over frames from when the volume opens, so it's done before any client can ask
+		const double hashStart = FPlatformTime::Seconds();
+		FCubiquityChunkHashes hashes;
+		hashes.reset(*volume);
+		hashes.flush(*volume);
+		UE_LOG(CubiquityLog, Display, TEXT("Applied %d edits and hashed %d chunks in %.3f seconds. Waiting for a client on port %d"),
+			edits, hashes.grid().num(), FPlatformTime::Seconds() - hashStart, port);
+
+		FSocket* listener = FTcpSocketBuilder(TEXT("CubiquityJoinSyncListener")).AsReusable().BoundToPort(port).Listening(1);
+		if (!listener)
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("Couldn't listen on port %d"), port);
+			return 1;
+		}
+
+		ISocketSubsystem* sockets = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+		bool pending = false;
+		const double giveUp = FPlatformTime::Seconds() + ReceiveTimeoutSeconds * 10.0f;
+		while (!(listener->HasPendingConnection(pending) && pending) && FPlatformTime::Seconds() < giveUp)
+		{
+			FPlatformProcess::Sleep(0.1f);
+		}
+		FSocket* socket = pending ? listener->Accept(TEXT("CubiquityJoinSyncServer")) : nullptr;
+		sockets->DestroySocket(listener);
+		if (!socket)
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("No client connected"));
+			return 1;
+		}
+
+		int32 result = 1;
+		FCubiquityJoinSyncServer sync;
+		EMessage type;
+		TArray<uint8> payload;
+		bool requested = false;
+		if (receiveMessage(*socket, type, payload) && type == EMessage::RequestJoinSync)
+		{
+			sync.start(hashes, edits);
+
+			FCubiquityChunkHashPage page;
+			bool connected = true;
+			while (connected && sync.nextHashPage(page))
+			{
+				connected = sendMessage(*socket, EMessage::Hashes, makePayload([&](FMemoryWriter& writer) { writer << page; })) > 0;
+			}
+			requested = connected;
+		}
+
+		//The answer comes in pages, as the component sends it
+		int32 requestedChunks = 0;
+		bool lastRequest = false;
+		while (requested && !lastRequest && receiveMessage(*socket, type, payload) && type == EMessage::RequestChunks)
+		{
+			TArray<int32> indices;
+			FMemoryReader reader(payload);
+			reader << indices << lastRequest;
+			sync.requestChunks(indices, lastRequest);
+			requestedChunks += indices.Num();
+		}
+
+		if (lastRequest)
+		{
+			//Hold each slice back until the rate allows it, as the component does a tick at a time
+			const double bytesPerSecond = FMath::Max(kilobytesPerSecond, 1.0f) * 1024.0;
+			const double sendStart = FPlatformTime::Seconds();
+			int64 wireBytes = 0;
+			FCubiquityChunkSlice slice;
+			bool connected = true;
+			while (connected && sync.nextSlice(*volume, slice))
+			{
+				const double sendAt = sendStart + wireBytes / bytesPerSecond;
+				const double now = FPlatformTime::Seconds();
+				if (sendAt > now)
+				{
+					FPlatformProcess::Sleep(sendAt - now);
+				}
+
+				const int32 sent = sendMessage(*socket, EMessage::Slice, makePayload([&](FMemoryWriter& writer) { writer << slice; }));
+				connected = sent > 0;
+				wireBytes += sent;
+			}
+
+			if (connected && sendMessage(*socket, EMessage::Finished, TArray<uint8>()))
+			{
+				UE_LOG(CubiquityLog, Display, TEXT("Sent %d of %d chunks, %lld bytes of slices in %.3f seconds, reading them took %.3f"),
+					requestedChunks, sync.numChunks(), sync.bytesSent, FPlatformTime::Seconds() - sendStart, sync.snapshotSeconds);
+				result = 0;
+			}
+		}
+
+		if (result != 0)
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("The client went away before the sync finished"));
+		}
+
+		//Wait for the client to hang up so it has everything before the socket goes
+		socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromSeconds(ReceiveTimeoutSeconds));
+		socket->Close();
+		sockets->DestroySocket(socket);
+
+		volume.reset();
+		IFileManager::Get().Delete(*copyFileName, false, false, true);
+		return result;
+	}
+
+	int32 runClient(const FCubiquitySessionRecording& recording, const FString& volumeFileName, const FString& serverAddress, int32 port,
+		const FVector& spawnPoint, float playableRadius, const FString& outputFileName)
+	{
+		FString copyFileName;
+		std::unique_ptr<Cubiquity::Volume> volume = openCopy(recording, volumeFileName, TEXT("JoinSyncClient"), copyFileName);
+		if (!volume)
+		{
+			return 1;
+		}
+
+		FSocket* socket = connectToServer(serverAddress, port);
+		if (!socket)
+		{
+			return 1;
+		}
+
+		FCubiquityJoinSyncClient sync;
+		sync.start(spawnPoint, playableRadius);
+
+		//The game hashes its own chunks before it asks, so this isn't part of the time to sync
+		const double hashStart = FPlatformTime::Seconds();
+		FCubiquityChunkHashes ourHashes;
+		ourHashes.reset(*volume);
+		ourHashes.flush(*volume);
+		const double hashingSeconds = FPlatformTime::Seconds() - hashStart;
+
+		TArray<uint32> serverHashes;
+		uint32 sequence = 0;
+		int64 wireBytes = 0;
+		double secondsToPlayable = -1.0;
+		bool finished = false;
+		EMessage type;
+		TArray<uint8> payload;
+
+		const double syncStart = FPlatformTime::Seconds();
+		wireBytes += sendMessage(*socket, EMessage::RequestJoinSync, makePayload([&](FMemoryWriter& writer) { writer << const_cast<FVector&>(spawnPoint); }));
+
+		int32 received = 0;
+		while ((received = receiveMessage(*socket, type, payload)) > 0)
+		{
+			wireBytes += received;
+			FMemoryReader reader(payload);
+
+			if (type == EMessage::Hashes)
+			{
+				FCubiquityChunkHashPage page;
+				reader << page;
+				if (!sync.receiveHashes(page))
+				{
+					break;
+				}
+				serverHashes.Append(page.hashes);
+				sequence = page.sequence;
+
+				if (sync.hasAllHashes())
+				{
+					TArray<int32> needed;
+					sync.compare(ourHashes, needed);
+
+					int32 first = 0;
+					bool last = false;
+					while (!last)
+					{
+						const int32 count = FMath::Min<int32>(FCubiquityJoinSyncServer::MaximumIndicesPerRequest, needed.Num() - first);
+						TArray<int32> indices;
+						indices.Append(needed.GetData() + first, count);
+						first += count;
+						last = first >= needed.Num();
+						wireBytes += sendMessage(*socket, EMessage::RequestChunks, makePayload([&](FMemoryWriter& writer) { writer << indices << last; }));
+					}
+				}
+			}
+			else if (type == EMessage::Slice)
+			{
+				FCubiquityChunkSlice slice;
+				reader << slice;
+				FIntVector chunk;
+				sync.receiveSlice(*volume, slice, chunk);
+			}
+			else if (type == EMessage::Finished)
+			{
+				finished = true;
+			}
+
+			if (secondsToPlayable < 0.0 && sync.isPlayable())
+			{
+				secondsToPlayable = FPlatformTime::Seconds() - syncStart;
+			}
+			if (finished)
+			{
+				break;
+			}
+		}
+		const double syncSeconds = FPlatformTime::Seconds() - syncStart;
+
+		socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(socket);
+
+		//Every chunk should now hash the same here as on the server
+		ourHashes.reset(*volume);
+		ourHashes.flush(*volume);
+		int32 mismatchedChunks = FMath::Abs(ourHashes.all().Num() - serverHashes.Num());
+		for (int32 i = 0; i < ourHashes.all().Num() && i < serverHashes.Num(); ++i)
+		{
+			if (ourHashes.all()[i] != serverHashes[i])
+			{
+				++mismatchedChunks;
+			}
+		}
+
+		const bool identical = finished && sync.isFinished() && mismatchedChunks == 0;
+		if (!identical)
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("The sync %s and %d of %d chunks differ from the server's"),
+				finished ? TEXT("finished") : TEXT("didn't finish"), mismatchedChunks, serverHashes.Num());
+		}
+
+		volume.reset();
+		IFileManager::Get().Delete(*copyFileName, false, false, true);
+
+		FString json = TEXT("{\n");
+		json += FString::Printf(TEXT("\"config\":{\"volume\":\"%s\",\"spawn\":[%.1f,%.1f,%.1f],\"playable_radius\":%.1f},\n"),
+			*volumeFileName.Replace(TEXT("\\"), TEXT("/")), spawnPoint.X, spawnPoint.Y, spawnPoint.Z, playableRadius);
+		json += FString::Printf(TEXT("\"identical\":%s,\n\"mismatched_chunks\":%d,\n"), identical ? TEXT("true") : TEXT("false"), mismatchedChunks);
+		json += FString::Printf(TEXT("\"seconds_to_playable\":%.3f,\n\"seconds_to_finish\":%.3f,\n"), secondsToPlayable, syncSeconds);
+		json += FString::Printf(TEXT("\"hashing_seconds\":%.3f,\n"), hashingSeconds);
+		json += FString::Printf(TEXT("\"volume_chunks\":%d,\n\"sent_chunks\":%d,\n\"edit_sequence\":%u,\n"), sync.candidateChunks, sync.neededChunks, sequence);
+		json += FString::Printf(TEXT("\"chunk_bytes\":%lld,\n\"wire_bytes\":%lld\n"), sync.bytesReceived, wireBytes);
+		json += TEXT("}\n");
+
+		UE_LOG(CubiquityLog, Display, TEXT("%s"), *json);
+
+		if (!FFileHelper::SaveStringToFile(json, *outputFileName))
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("Failed to write %s"), *outputFileName);
+			return 1;
+		}
+
+		UE_LOG(CubiquityLog, Display, TEXT("Wrote join sync results to %s"), *outputFileName);
+		return identical ? 0 : 1;
+	}
+}
+
+UCubiquityJoinSyncCommandlet::UCubiquityJoinSyncCommandlet(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	LogToConsole = true;
+}
+
+int32 UCubiquityJoinSyncCommandlet::Main(const FString& Params)
+{
+	if (!FCubiquityCommandletSwitches::validate(Params, { TEXT("Role="), TEXT("Recording="), TEXT("Volume="), TEXT("Server="), TEXT("Spawn="), TEXT("Output="), TEXT("Port="), TEXT("KilobytesPerSecond="), TEXT("PlayableRadius=") },
+		TEXT("Usage: -run=CubiquityJoinSync -Role=Server|Client -Recording=Path/To.cqrec [-Volume=Path/To.vdb] [-Server=127.0.0.1] [-Port=7788] [-KilobytesPerSecond=512] [-Spawn=X,Y,Z] [-PlayableRadius=64] [-Output=Path/To.json]")))
+	{
+		return 1;
+	}
+
+	FString role;
+	FString recordingFileName;
+	FString volumeFileName;
+	FString serverAddress = TEXT("127.0.0.1");
+	FString spawnText;
+	FString outputFileName = FPaths::ProfilingDir() / TEXT("Cubiquity") / FString::Printf(TEXT("JoinSync-%s.json"), *FDateTime::Now().ToString());
+	int32 port = 7788;
+	float kilobytesPerSecond = 512.0f;
+	float playableRadius = 64.0f;
+
+	FParse::Value(*Params, TEXT("Role="), role);
+	FParse::Value(*Params, TEXT("Recording="), recordingFileName);
+	FParse::Value(*Params, TEXT("Volume="), volumeFileName);
+	FParse::Value(*Params, TEXT("Server="), serverAddress);
+	FParse::Value(*Params, TEXT("Spawn="), spawnText, false);
+	FParse::Value(*Params, TEXT("Output="), outputFileName);
+	FParse::Value(*Params, TEXT("Port="), port);
+	FParse::Value(*Params, TEXT("KilobytesPerSecond="), kilobytesPerSecond);
+	FParse::Value(*Params, TEXT("PlayableRadius="), playableRadius);
+
+	FCubiquitySessionRecording recording;
+	if (recordingFileName.IsEmpty() || !recording.load(recordingFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Couldn't read a recording from '%s'. Use -Recording=Path/To.cqrec"), *recordingFileName);
+		return 1;
+	}
+
+	if (volumeFileName.IsEmpty())
+	{
+		volumeFileName = recording.volumeFileName();
+	}
+	if (!FPaths::FileExists(volumeFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Volume %s does not exist. Use -Volume= to say where it is now"), *volumeFileName);
+		return 1;
+	}
+
+	if (role == TEXT("Server"))
+	{
+		return runServer(recording, volumeFileName, port, kilobytesPerSecond);
+	}
+
+	if (role == TEXT("Client"))
+	{
+		//Without a spawn point the client starts where the first edit was made, which is likely to be near the most
+		FVector spawnPoint = FVector::ZeroVector;
+		TArray<FString> components;
+		if (spawnText.ParseIntoArray(components, TEXT(","), true) == 3)
+		{
+			spawnPoint = FVector(FCString::Atof(*components[0]), FCString::Atof(*components[1]), FCString::Atof(*components[2]));
+		}
+		else
+		{
+			for (const FCubiquityRecordedEvent& event : recording.events())
+			{
+				if (event.isVoxelEdit())
+				{
+					spawnPoint = event.position;
+					break;
+				}
+			}
+		}
+		return runClient(recording, volumeFileName, serverAddress, port, spawnPoint, playableRadius, outputFileName);
+	}
+
+	UE_LOG(CubiquityLog, Error, TEXT("Use -Role=Server or -Role=Client"));
+	return 1;
+}
@@ -0,0 +1,247 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityJoinSyncComponent.h"
+
+#include "CubiquityVolume.h"
+
+UCubiquityJoinSyncComponent::UCubiquityJoinSyncComponent(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	bReplicates = true;
+}
+
+void UCubiquityJoinSyncComponent::addToPlayerControllers(UWorld* world)
+{
+	if (!world)
+	{
+		return;
+	}
+
+	for (auto iterator = world->GetPlayerControllerIterator(); iterator; ++iterator)
+	{
+		APlayerController* playerController = *iterator;
+		if (playerController && !playerController->FindComponentByClass<UCubiquityJoinSyncComponent>())
+		{
+			UCubiquityJoinSyncComponent* component = NewObject<UCubiquityJoinSyncComponent>(playerController);
+			component->RegisterComponent();
+		}
+	}
+}
+
+void UCubiquityJoinSyncComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		tickServer(DeltaTime);
+	}
+	else
+	{
+		tickClient();
+	}
+}
+
+void UCubiquityJoinSyncComponent::tickClient()
+{
+	const APlayerController* playerController = Cast<APlayerController>(GetOwner());
+	if (!playerController || !playerController->IsLocalController())
+	{
+		return;
+	}
+
+	//Each volume is synced once it has opened, from wherever the player is looking from by then, and again if it loses edits
+	for (TActorIterator<ACubiquityVolume> volume(GetWorld()); volume; ++volume)
+	{
+		if (!volume->needsJoinSync())
+		{
+			continue;
+		}
+
+		FVector viewLocation;
+		FRotator viewRotation;
+		playerController->GetPlayerViewPoint(viewLocation, viewRotation);
+		const FVector spawnPoint = volume->worldPositionToVolumePosition(viewLocation);
+
+		//What's left of an answer to an earlier sync would go to the new one
+		const ACubiquityVolume* syncing = *volume;
+		requests.RemoveAll([syncing](const FClientRequest& request) { return request.volume.Get() == syncing; });
+
+		volume->beginJoinSync(spawnPoint);
+		serverRequestJoinSync(*volume, spawnPoint);
+	}
+
+	//Answers go a few pages a tick so a big one can't flood the reliable buffer
+	int32 budget = MaximumRequestsPerTick;
+	while (budget > 0 && requests.Num() > 0)
+	{
+		FClientRequest& request = requests[0];
+		ACubiquityVolume* volume = request.volume.Get();
+		if (!volume)
+		{
+			requests.RemoveAt(0);
+			continue;
+		}
+
+		const int32 count = FMath::Min<int32>(FCubiquityJoinSyncServer::MaximumIndicesPerRequest, request.chunkIndices.Num() - request.sent);
+		TArray<int32> page;
+		page.Append(request.chunkIndices.GetData() + request.sent, count);
+		request.sent += count;
+
+		const bool last = request.sent >= request.chunkIndices.Num();
+		serverRequestJoinSyncChunks(volume, page, last);
+		if (last)
+		{
+			requests.RemoveAt(0);
+		}
+		--budget;
+	}
+}
+
+UCubiquityJoinSyncComponent::FServerSession* UCubiquityJoinSyncComponent::findSession(const ACubiquityVolume* volume)
+{
+	for (FServerSession& session : sessions)
+	{
+		if (session.volume.Get() == volume && session.sync.IsValid())
+		{
+			return &session;
+		}
+	}
+	return nullptr;
+}
+
+void UCubiquityJoinSyncComponent::tickServer(float DeltaTime)
+{
+	for (int32 i = 0; i < sessions.Num(); ++i)
+	{
+		FServerSession& session = sessions[i];
+		ACubiquityVolume* volume = session.volume.Get();
+		if (!volume)
+		{
+			sessions.RemoveAt(i--);
+			continue;
+		}
+
+		if (!session.sync.IsValid())
+		{
+			//The server's own volume might still be opening or hashing its chunks
+			session.sync = volume->startJoinSyncSession();
+			if (!session.sync.IsValid())
+			{
+				continue;
+			}
+		}
+
+		//The hashes and then the chunks share the rate, with at least one message a tick so that a low rate still gets there
+		int32 budget = FMath::Max(FMath::RoundToInt(volume->joinSyncKilobytesPerSecond * 1024.0f * DeltaTime), 1);
+		FCubiquityChunkHashPage page;
+		while (budget > 0 && session.sync->nextHashPage(page))
+		{
+			clientJoinSyncHashes(volume, page);
+			budget -= page.hashes.Num() * sizeof(uint32);
+		}
+
+		FCubiquityChunkSlice slice;
+		while (budget > 0 && volume->nextJoinSyncSlice(*session.sync, slice))
+		{
+			clientJoinSyncSlice(volume, slice);
+			budget -= slice.data.Num();
+		}
+
+		if (session.sync->isFinished())
+		{
+			UE_LOG(CubiquityLog, Log, TEXT("%s: join sync for %s sent %lld bytes, %d chunks were kept from edits and reading took %.3f seconds"),
+				*volume->GetName(), *GetOwner()->GetName(), session.sync->bytesSent, session.sync->chunksKept, session.sync->snapshotSeconds);
+			clientJoinSyncFinished(volume);
+			sessions.RemoveAt(i--);
+		}
+	}
+}
+
+bool UCubiquityJoinSyncComponent::serverRequestJoinSync_Validate(ACubiquityVolume* volume, FVector spawnPoint)
+{
+	return !spawnPoint.ContainsNaN();
+}
+
+void UCubiquityJoinSyncComponent::serverRequestJoinSync_Implementation(ACubiquityVolume* volume, FVector spawnPoint)
+{
+	if (!volume)
+	{
+		return;
+	}
+
+	//A client asking again before its last sync finished starts over
+	for (int32 i = 0; i < sessions.Num(); ++i)
+	{
+		if (sessions[i].volume.Get() == volume)
+		{
+			sessions.RemoveAt(i--);
+		}
+	}
+
+	FServerSession session;
+	session.volume = volume;
+	sessions.Add(session);
+}
+
+void UCubiquityJoinSyncComponent::clientJoinSyncHashes_Implementation(ACubiquityVolume* volume, const FCubiquityChunkHashPage& page)
+{
+	if (!volume)
+	{
+		return;
+	}
+
+	FClientRequest request;
+	if (volume->receiveJoinSyncHashes(page, request.chunkIndices))
+	{
+		request.volume = volume;
+		requests.Add(request);
+	}
+}
+
+bool UCubiquityJoinSyncComponent::serverRequestJoinSyncChunks_Validate(ACubiquityVolume* volume, const TArray<int32>& chunkIndices, bool last)
+{
+	if (chunkIndices.Num() > FCubiquityJoinSyncServer::MaximumIndicesPerRequest)
+	{
+		return false;
+	}
+
+	//Without a session there's nothing to check against, and nothing the indices could do
+	const FServerSession* session = findSession(volume);
+	const int32 numChunks = session ? session->sync->numChunks() : MAX_int32;
+	for (int32 index : chunkIndices)
+	{
+		if (index < 0 || index >= numChunks)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void UCubiquityJoinSyncComponent::serverRequestJoinSyncChunks_Implementation(ACubiquityVolume* volume, const TArray<int32>& chunkIndices, bool last)
+{
+	if (FServerSession* session = findSession(volume))
+	{
+		session->sync->requestChunks(chunkIndices, last);
+	}
+}
+
+void UCubiquityJoinSyncComponent::clientJoinSyncSlice_Implementation(ACubiquityVolume* volume, const FCubiquityChunkSlice& slice)
+{
+	if (volume)
+	{
+		volume->receiveJoinSyncSlice(slice);
+	}
+}
+
+void UCubiquityJoinSyncComponent::clientJoinSyncFinished_Implementation(ACubiquityVolume* volume)
+{
+	if (volume)
+	{
+		volume->finishJoinSync();
+	}
+}
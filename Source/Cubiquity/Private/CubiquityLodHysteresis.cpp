@@ -0,0 +1,41 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityLodHysteresis.h"
+
+FVector FCubiquityLodHysteresis::eyeFor(const FVector& eye)
+{
+	if (!eyeHeld || FVector::DistSquared(eye, heldEye) > band * band)
+	{
+		heldEye = eye;
+		eyeHeld = true;
+	}
+	return heldEye;
+}
+
+void FCubiquityLodHysteresis::reset()
+{
+	eyeHeld = false;
+	flipsThisWindow = 0;
+	windowStarted = 0.0;
+	lastFlipsPerSecond = 0.0f;
+}
+
+void FCubiquityLodHysteresis::countFlips(int32 flips, double now)
+{
+	if (windowStarted == 0.0)
+	{
+		windowStarted = now;
+	}
+
+	flipsThisWindow += flips;
+
+	const double elapsed = now - windowStarted;
+	if (elapsed >= 1.0)
+	{
+		lastFlipsPerSecond = static_cast<float>(flipsThisWindow / elapsed);
+		flipsThisWindow = 0;
+		windowStarted = now;
+	}
+}
@@ -0,0 +1,56 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityMemoryReport.h"
+
+#include "CubiquityVolume.h"
+
+namespace
+{
+	FString usageRow(const TCHAR* label, const FCubiquityMemoryUsage& usage)
+	{
+		return FString::Printf(TEXT("%-8s %7d %7d %10d %10d %10d %10d %10d\n"), label, usage.nodes, usage.meshes,
+			usage.meshCpuKilobytes, usage.meshGpuKilobytes, usage.collisionKilobytes, usage.objectKilobytes, usage.totalKilobytes());
+	}
+
+	void memoryReportCommand()
+	{
+		int32 volumes = 0;
+		for (TObjectIterator<ACubiquityVolume> volume; volume; ++volume)
+		{
+			if (volume->IsTemplate() || !volume->GetWorld())
+			{
+				continue;
+			}
+
+			UE_LOG(CubiquityLog, Display, TEXT("%s (%s)\n%s"), *volume->GetName(), *volume->volumeFileName, *volume->getMemoryReport().toString());
+			++volumes;
+		}
+
+		if (volumes == 0)
+		{
+			UE_LOG(CubiquityLog, Display, TEXT("There are no Cubiquity volumes loaded"));
+		}
+	}
+
+	FAutoConsoleCommand memoryReportConsoleCommand(
+		TEXT("cubiquity.MemoryReport"),
+		TEXT("Log where each Cubiquity volume's memory goes, broken down by octree height."),
+		FConsoleCommandDelegate::CreateStatic(&memoryReportCommand));
+}
+
+FString FCubiquityMemoryReport::toString() const
+{
+	FString report = FString::Printf(TEXT("Voxel database: %d KB, uncommitted: %d chunks, up to %d KB, checkpoints: %d KB\n"), voxelDatabaseKilobytes, uncommittedChunks, uncommittedKilobytes, checkpointKilobytes);
+	report += TEXT("Height     Nodes  Meshes     CPU KB     GPU KB   Coll. KB  Object KB   Total KB\n");
+	for (int32 height = 0; height < byHeight.Num(); ++height)
+	{
+		if (byHeight[height].nodes > 0)
+		{
+			report += usageRow(*FString::FromInt(height), byHeight[height]);
+		}
+	}
+	report += usageRow(TEXT("Total"), total);
+	return report;
+}
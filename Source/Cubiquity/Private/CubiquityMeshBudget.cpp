@@ -0,0 +1,283 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityMeshBudget.h"
+
+#include "CubiquityVolume.h"
+#include "CubiquityOctreeNode.h"
+#include "CubiquityMeshComponent.h"
+
+static TAutoConsoleVariable<int32> CVarMeshBudget(
+	TEXT("cubiquity.MeshBudget"),
+	0,
+	TEXT("CPU plus GPU memory the node meshes of all Cubiquity volumes may use, in megabytes. 0 means no limit."));
+
+static TAutoConsoleVariable<float> CVarMeshBudgetOffscreenSeconds(
+	TEXT("cubiquity.MeshBudget.OffscreenSeconds"),
+	0.0f,
+	TEXT("Drawn nodes which have been out of view for this many seconds may be evicted too. Their collision goes with them,\n")
+	TEXT("so the default of 0 only evicts nodes the octree isn't drawing."));
+
+static TAutoConsoleVariable<float> CVarMeshBudgetMaxLodThresholdScale(
+	TEXT("cubiquity.MeshBudget.MaxLodThresholdScale"),
+	4.0f,
+	TEXT("The most the budget may scale a volume's lodThreshold by when evicting meshes isn't enough."));
+
+namespace
+{
+	const double UpdateInterval = 0.25;
+
+	//Evict down to a bit under the budget so we aren't back at it next update
+	const float EvictionTarget = 0.9f;
+
+	//Only make the LOD finer again once usage has stayed this far under budget for a while
+	const float RelaxTarget = 0.75f;
+	const double RelaxDelaySeconds = 5.0;
+	const float LodThresholdStep = 1.25f;
+
+	//Nodes the octree isn't drawing are only kept to make LOD transitions quicker so they are worth much less
+	const float HiddenNodeWeight = 0.1f;
+
+	struct FBudgetView
+	{
+		FVector location = FVector::ZeroVector;
+		FVector direction = FVector::ForwardVector;
+		float cosHalfFov = -1.0f; //Without a player we treat everything as in view
+
+		float screenSize(const FBoxSphereBounds& bounds) const
+		{
+			return bounds.SphereRadius / FMath::Max(FVector::Dist(location, bounds.Origin), 1.0f);
+		}
+
+		bool canSee(const FBoxSphereBounds& bounds) const
+		{
+			const FVector toBounds = bounds.Origin - location;
+			const float distance = toBounds.Size();
+			if (distance <= bounds.SphereRadius)
+			{
+				return true;
+			}
+
+			//Widen the view cone by the angle the bounds take up
+			const float angle = FMath::Acos(FMath::Clamp(FVector::DotProduct(toBounds / distance, direction), -1.0f, 1.0f)) - FMath::Asin(bounds.SphereRadius / distance);
+			return FMath::Cos(FMath::Max(angle, 0.0f)) >= cosHalfFov;
+		}
+	};
+
+	FBudgetView viewOf(UWorld* world)
+	{
+		FBudgetView view;
+
+		APlayerController* playerController = world ? world->GetFirstPlayerController() : nullptr;
+		if (playerController)
+		{
+			FRotator rotation;
+			playerController->GetPlayerViewPoint(view.location, rotation);
+			view.direction = rotation.Vector();
+
+			const float fov = playerController->PlayerCameraManager ? playerController->PlayerCameraManager->GetFOVAngle() : 90.0f;
+			view.cosHalfFov = FMath::Cos(FMath::DegreesToRadians(fov * 0.5f));
+		}
+
+		return view;
+	}
+
+	struct FEvictionCandidate
+	{
+		ACubiquityOctreeNode* node;
+		ACubiquityVolume* volume;
+		uint64 bytes; //This node's share of its mesh
+		float value;
+	};
+}
+
+FCubiquityMeshBudget& FCubiquityMeshBudget::get()
+{
+	static FCubiquityMeshBudget budget;
+	return budget;
+}
+
+void FCubiquityMeshBudget::addVolume(ACubiquityVolume* volume)
+{
+	volumes.AddUnique(volume);
+}
+
+void FCubiquityMeshBudget::removeVolume(ACubiquityVolume* volume)
+{
+	volumes.Remove(volume);
+}
+
+uint64 FCubiquityMeshBudget::budgetBytes() const
+{
+	return uint64(FMath::Max(CVarMeshBudget.GetValueOnGameThread(), 0)) * 1024 * 1024;
+}
+
+void FCubiquityMeshBudget::update()
+{
+	const double now = FPlatformTime::Seconds();
+	if (now - lastUpdated < UpdateInterval)
+	{
+		return;
+	}
+	lastUpdated = now;
+
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityMeshBudgetUpdate);
+
+	volumes.RemoveAll([](const TWeakObjectPtr<ACubiquityVolume>& volume) { return !volume.IsValid(); });
+
+	const uint64 budget = budgetBytes();
+	const float offscreenSeconds = CVarMeshBudgetOffscreenSeconds.GetValueOnGameThread();
+
+	TArray<FEvictionCandidate> candidates;
+	TArray<ACubiquityOctreeNode*> nodesToRestore;
+	TSet<const FCubiquityMeshData*> countedMeshes;
+	uint64 usage = 0;
+	uint64 cpuUsage = 0;
+	uint64 gpuUsage = 0;
+
+	for (const TWeakObjectPtr<ACubiquityVolume>& volumePtr : volumes)
+	{
+		ACubiquityVolume* volume = volumePtr.Get();
+		UWorld* world = volume->GetWorld();
+		const FBudgetView view = viewOf(world);
+		const float worldTime = world ? world->GetTimeSeconds() : 0.0f;
+
+		volume->evictedNodes = 0;
+
+		TArray<UCubiquityMeshComponent*> meshComponents;
+		volume->getMeshComponents(meshComponents);
+		for (UCubiquityMeshComponent* mesh : meshComponents)
+		{
+			ACubiquityOctreeNode* node = Cast<ACubiquityOctreeNode>(mesh->GetOwner());
+			if (!node)
+			{
+				continue;
+			}
+
+			if (node->isMeshEvicted())
+			{
+				//Nodes which are drawn and have come back into view can't wait for there to be room
+				if (budget == 0 || (node->isRendered() && view.canSee(mesh->Bounds)))
+				{
+					nodesToRestore.Add(node);
+				}
+				else
+				{
+					volume->evictedNodes++;
+				}
+				continue;
+			}
+
+			const TSharedPtr<FCubiquityMeshData>& meshData = mesh->getMeshData();
+			if (!meshData.IsValid())
+			{
+				continue;
+			}
+
+			const uint64 meshBytes = meshData->cpuBytes() + meshData->gpuBytes();
+			bool alreadyCounted = false;
+			countedMeshes.Add(meshData.Get(), &alreadyCounted);
+			if (!alreadyCounted)
+			{
+				usage += meshBytes;
+				cpuUsage += meshData->cpuBytes();
+				gpuUsage += meshData->gpuBytes();
+			}
+
+			const float secondsUnseen = FMath::Max(worldTime - mesh->LastRenderTime, 0.0f);
+			const bool evictable = !node->isRendered() || (offscreenSeconds > 0.0f && secondsUnseen > offscreenSeconds && !view.canSee(mesh->Bounds));
+			if (budget > 0 && evictable)
+			{
+				FEvictionCandidate candidate;
+				candidate.node = node;
+				candidate.volume = volume;
+				candidate.bytes = meshBytes / FMath::Max(meshData.GetSharedReferenceCount(), 1);
+				candidate.value = view.screenSize(mesh->Bounds) / (1.0f + secondsUnseen);
+				if (!node->isRendered())
+				{
+					candidate.value *= HiddenNodeWeight;
+				}
+				candidates.Add(candidate);
+			}
+		}
+	}
+
+	uint32 evictions = 0;
+	if (budget > 0 && usage > budget)
+	{
+		candidates.Sort([](const FEvictionCandidate& a, const FEvictionCandidate& b) { return a.value < b.value; });
+
+		const uint64 target = uint64(budget * EvictionTarget);
+		for (const FEvictionCandidate& candidate : candidates)
+		{
+			if (usage <= target)
+			{
+				break;
+			}
+
+			candidate.node->evictMesh();
+			candidate.volume->evictedNodes++;
+			usage -= FMath::Min(candidate.bytes, usage);
+			evictions++;
+		}
+	}
+
+	for (ACubiquityOctreeNode* node : nodesToRestore)
+	{
+		node->restoreMesh();
+	}
+
+	const bool overBudget = budget > 0 && usage > budget;
+	if (overBudget)
+	{
+		UE_LOG(CubiquityLog, Verbose, TEXT("Mesh budget: %llu KB used of %llu KB after evicting %u node meshes"), usage / 1024, budget / 1024, evictions);
+	}
+	used = usage;
+	updateLodThresholdScales(budget, overBudget, now);
+
+	uint32 evictedNodes = 0;
+	float largestScale = 1.0f;
+	for (const TWeakObjectPtr<ACubiquityVolume>& volume : volumes)
+	{
+		evictedNodes += volume->evictedNodes;
+		largestScale = FMath::Max(largestScale, volume->lodThresholdScale);
+	}
+
+	SET_MEMORY_STAT(STAT_CubiquityMeshBudget, budget);
+	SET_MEMORY_STAT(STAT_CubiquityMeshMemoryUsed, usage);
+	SET_MEMORY_STAT(STAT_CubiquityMeshCpuMemory, cpuUsage);
+	SET_MEMORY_STAT(STAT_CubiquityMeshGpuMemory, gpuUsage);
+	SET_DWORD_STAT(STAT_CubiquityEvictedNodes, evictedNodes);
+	INC_DWORD_STAT_BY(STAT_CubiquityNodeEvictions, evictions);
+	INC_DWORD_STAT_BY(STAT_CubiquityNodeRestores, nodesToRestore.Num());
+	SET_FLOAT_STAT(STAT_CubiquityLodThresholdScale, largestScale);
+}
+
+void FCubiquityMeshBudget::updateLodThresholdScales(uint64 budget, bool overBudget, double now)
+{
+	if (overBudget)
+	{
+		lastOverBudget = now;
+	}
+
+	const bool relax = budget == 0 || (used < budget * RelaxTarget && now - lastOverBudget > RelaxDelaySeconds);
+	const float maxScale = FMath::Max(CVarMeshBudgetMaxLodThresholdScale.GetValueOnGameThread(), 1.0f);
+
+	for (const TWeakObjectPtr<ACubiquityVolume>& volumePtr : volumes)
+	{
+		ACubiquityVolume* volume = volumePtr.Get();
+		if (budget == 0)
+		{
+			volume->lodThresholdScale = 1.0f;
+		}
+		else if (overBudget)
+		{
+			volume->lodThresholdScale = FMath::Min(volume->lodThresholdScale * LodThresholdStep, maxScale);
+		}
+		else if (relax)
+		{
+			volume->lodThresholdScale = FMath::Max(volume->lodThresholdScale / LodThresholdStep, 1.0f);
+		}
+	}
+}
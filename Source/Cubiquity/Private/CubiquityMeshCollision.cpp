@@ -0,0 +1,66 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityMeshCollision.h"
+
+#include "CubiquityMeshConverter.h"
+
+UCubiquityMeshCollision::UCubiquityMeshCollision(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+	, bodySetup(nullptr)
+	, volumeType(Cubiquity::VolumeType::ColoredCubes)
+{
+}
+
+void UCubiquityMeshCollision::initialise(const TSharedPtr<FCubiquityMeshData>& inMeshData, Cubiquity::VolumeType inVolumeType)
+{
+	meshData = inMeshData;
+	volumeType = inVolumeType;
+
+	bodySetup = NewObject<UBodySetup>(this);
+	bodySetup->CollisionTraceFlag = CTF_UseComplexAsSimple;
+	bodySetup->bMeshCollideAll = true;
+
+	//Identical triangles get the same GUID so the derived data cache can hand back the cooked collision from an earlier session
+	bodySetup->BodySetupGuid = inMeshData->collisionGuid();
+}
+
+void UCubiquityMeshCollision::invalidate()
+{
+	const TSharedPtr<FCubiquityMeshData> pinnedMeshData = meshData.Pin();
+	if (bodySetup && pinnedMeshData.IsValid())
+	{
+		//This hands out a random GUID, but the new triangles have one of their own
+		bodySetup->InvalidatePhysicsData();
+		bodySetup->BodySetupGuid = pinnedMeshData->collisionGuid();
+	}
+}
+
+void UCubiquityMeshCollision::release()
+{
+	if (bodySetup)
+	{
+		bodySetup->ClearPhysicsMeshes();
+		bodySetup = nullptr;
+	}
+	meshData.Reset();
+}
+
+bool UCubiquityMeshCollision::GetPhysicsTriMeshData(struct FTriMeshCollisionData* CollisionData, bool InUseAllTriData)
+{
+	const TSharedPtr<FCubiquityMeshData> pinnedMeshData = meshData.Pin();
+	if (pinnedMeshData.IsValid() && pinnedMeshData->hasTriangles())
+	{
+		FCubiquityMeshConverter::stageCollision(*pinnedMeshData, volumeType, *CollisionData);
+		return true;
+	}
+
+	return false;
+}
+
+bool UCubiquityMeshCollision::ContainsPhysicsTriMeshData(bool InUseAllTriData) const
+{
+	const TSharedPtr<FCubiquityMeshData> pinnedMeshData = meshData.Pin();
+	return pinnedMeshData.IsValid() && pinnedMeshData->hasTriangles();
+}
@@ -5,6 +5,11 @@
 #include "CubiquityMeshComponent.h"
 #include "CubiquityTerrainVolume.h"
 #include "CubiquityColoredCubesVolume.h"
+#include "CubiquityMeshConverter.h"
+#include "CubiquityPackedFaces.h"
+#include "CubiquityOctreeNode.h"
+#include "CubiquityTerrainVertexFactory.h"
+#include "CubiquityColoredCubesVertexFactory.h"
 
 UCubiquityMeshComponent::UCubiquityMeshComponent(const FObjectInitializer& PCIP)
 	: Super(PCIP)
@@ -33,177 +38,193 @@ void UCubiquityMeshComponent::setVolumeType()
 
 bool UCubiquityMeshComponent::SetGeneratedMeshTriangles(const Cubiquity::OctreeNode& octreeNode)
 {
-	switch (volumeType)
-	{
-		case Cubiquity::VolumeType::Terrain:
-			return SetGeneratedMeshTrianglesTerrain(octreeNode);
-		case Cubiquity::VolumeType::ColoredCubes:
-			return SetGeneratedMeshTrianglesColoredCubes(octreeNode);
-		default:
-			return false;
-	}
-}
+	//UE_LOG(CubiquityLog, Log, TEXT("UCubiquityMeshComponent::SetGeneratedMeshTriangles"));
+	CUBIQUITY_TRACE_NODE_SCOPE("Node mesh sync", traceNode());
 
-bool UCubiquityMeshComponent::SetGeneratedMeshTrianglesTerrain(const Cubiquity::OctreeNode& octreeNode)
-{
-	//UE_LOG(CubiquityLog, Log, TEXT("UCubiquityMeshComponent::SetGeneratedMeshTrianglesTerrain"));
-
-	uint32_t noOfIndices;
-	uint16_t* cubuquityIndices;
-	uint16_t noOfVertices;
-	const Cubiquity::TerrainVertex* cubiquityVertices;
-	octreeNode.getMesh(&noOfVertices, &cubiquityVertices, &noOfIndices, &cubuquityIndices);
+	const FCubiquityConversionSettings settings = conversionSettings();
 
-	for (uint32_t i = 0; i < noOfVertices; ++i)
+	//A baked node doesn't even need its mesh extracting and hashing
+	const TSharedPtr<FCubiquityMeshData> bakedMesh = findBakedMesh(octreeNode);
+	if (bakedMesh.IsValid())
 	{
-		const auto& cubiquityVertex = cubiquityVertices[i];
-
-		FDynamicMeshVertex Vert;
-
-		const auto position = cubiquityVertex.position();
-		Vert.Position = FVector(position.x, position.y, position.z);
-
-		const auto normal = cubiquityVertex.normal();
-		Vert.TangentZ = FVector(normal.x, normal.y, normal.z);// .SafeNormal();
-
-		const auto materials = cubiquityVertex.materials();
-		Vert.Color = FColor(materials[0], materials[1], materials[2], materials[3]); //TODO make this from materials
-
-		Vert.TextureCoordinate.Set(Vert.Position.X, Vert.Position.Y);
-
-		terrainVertices.Add(Vert);
+		setMeshData(bakedMesh, false);
+		return true;
 	}
 
-	//The normals are already set but we need the tangents and bitangents. Set these on a per-triangle basis based on the geometry
-	for (uint16_t i = 0; i < noOfIndices; ++i)
+	//If another node already has this exact mesh then just use theirs, along with its GPU buffers and collision.
+	//Failing that we might have converted it in an earlier session.
+	const FCubiquityMeshKey key = FCubiquityMeshConverter::keyForNode(octreeNode, settings);
+	const TSharedPtr<FCubiquityMeshData> existingMesh = findExistingMesh(key);
+	if (existingMesh.IsValid())
 	{
-		const uint16_t index0 = cubuquityIndices[i];
-		const uint16_t index1 = cubuquityIndices[++i];
-		const uint16_t index2 = cubuquityIndices[++i];
-
-		FDynamicMeshVertex& vertex0 = terrainVertices[index0];
-		FDynamicMeshVertex& vertex1 = terrainVertices[index1];
-		FDynamicMeshVertex& vertex2 = terrainVertices[index2];
-
-		//Reverse winding order
-		indices.Add(index2);
-		indices.Add(index1);
-		indices.Add(index0);
-
-		//Now calculate the tangent vectors
-		const FVector Edge01 = (vertex1.Position - vertex0.Position);
-		const FVector Edge02 = (vertex2.Position - vertex0.Position);
-		const FVector TangentX = Edge01.GetSafeNormal() * 256.0; //Tangent
-		const FVector TangentZ = vertex0.TangentZ; //Normal
-		const FVector TangentY = (TangentX ^ TangentZ); //Binormal (bitangent) I assume?
-
-		vertex1.SetTangents(TangentX, TangentY, vertex1.TangentZ);
-		vertex2.SetTangents(TangentX, TangentY, vertex2.TangentZ);
+		setMeshData(existingMesh, false);
+		return true;
 	}
 
-	if (ModelBodySetup)
+	const TSharedPtr<FCubiquityMeshData> newMeshData = MakeShareable(new FCubiquityMeshData);
 	{
-		ModelBodySetup->InvalidatePhysicsData(); // This is required for the first time after creation
+		CUBIQUITY_TRACE_NODE_SCOPE("Mesh conversion", traceNode());
+		FCubiquityMeshConverter::convert(octreeNode, settings, *newMeshData);
 	}
 
-	UpdateCollision();
+	shareNewMesh(key, newMeshData);
 
-	// Need to recreate scene proxy to send it over
-	MarkRenderStateDirty();
+	return true;
+}
+
+bool UCubiquityMeshComponent::ClearMeshTriangles()
+{
+	//UE_LOG(CubiquityLog, Log, TEXT("UCubiquityMeshComponent::ClearMeshTriangles"));
+	setMeshData(nullptr, false);
 
 	return true;
 }
 
-bool UCubiquityMeshComponent::SetGeneratedMeshTrianglesColoredCubes(const Cubiquity::OctreeNode& octreeNode)
+FCubiquityTraceNode UCubiquityMeshComponent::traceNode() const
 {
-	//UE_LOG(CubiquityLog, Log, TEXT("UCubiquityMeshComponent::SetGeneratedMeshTrianglesColoredCubes"));
+	const ACubiquityOctreeNode* node = Cast<ACubiquityOctreeNode>(GetOwner());
+	return node ? node->traceNode() : FCubiquityTraceNode();
+}
 
-	uint32_t noOfIndices;
-	uint16_t* cubuquityIndices;
-	uint16_t noOfVertices;
-	Cubiquity::ColoredCubesVertex* cubiquityVertices;
-	octreeNode.getMesh(&noOfVertices, &cubiquityVertices, &noOfIndices, &cubuquityIndices);
+FCubiquityConversionSettings UCubiquityMeshComponent::conversionSettings() const
+{
+	const ACubiquityVolume* volume = Cast<ACubiquityVolume>(GetAttachmentRootActor());
+	FCubiquityConversionSettings settings = volume ? volume->conversionSettings() : FCubiquityConversionSettings();
+	settings.volumeType = volumeType;
+	return settings;
+}
 
-	for (uint32_t i = 0; i < noOfVertices; ++i)
+TSharedPtr<FCubiquityMeshData> UCubiquityMeshComponent::findExistingMesh(const FCubiquityMeshKey& key) const
+{
+	ACubiquityVolume* volume = Cast<ACubiquityVolume>(GetAttachmentRootActor());
+	if (!volume)
 	{
-		const auto& cubiquityVertex = cubiquityVertices[i];
+		return nullptr;
+	}
 
-		FColoredCubesVertex Vert;
+	if (volume->deduplicateMeshes)
+	{
+		const TSharedPtr<FCubiquityMeshData> sharedMesh = volume->meshCache().find(key);
+		if (sharedMesh.IsValid())
+		{
+			INC_DWORD_STAT(STAT_CubiquityMeshCacheHits);
+			return sharedMesh;
+		}
+	}
 
-		const auto& position = cubiquityVertex.position();
-		Vert.Position = FVector(position.x, position.y, position.z);
+	const FCubiquityMeshDiskCache* diskCache = volume->meshDiskCache();
+	if (diskCache)
+	{
+		const TSharedPtr<FCubiquityMeshData> cachedMesh = MakeShareable(new FCubiquityMeshData);
+		if (diskCache->load(key, *cachedMesh))
+		{
+			volume->meshesFromDiskCache++;
+			if (volume->deduplicateMeshes)
+			{
+				volume->meshCache().add(key, cachedMesh);
+			}
+			return cachedMesh;
+		}
+	}
 
-		const auto& color = cubiquityVertex.color();
-		Vert.Color = FColor(color.red(), color.green(), color.blue(), color.alpha());
+	return nullptr;
+}
 
-		coloredCubesVertices.Add(Vert);
+TSharedPtr<FCubiquityMeshData> UCubiquityMeshComponent::findBakedMesh(const Cubiquity::OctreeNode& octreeNode) const
+{
+	ACubiquityVolume* volume = Cast<ACubiquityVolume>(GetAttachmentRootActor());
+	FCubiquityMeshKey key;
+	if (!volume || !volume->findBakedMesh(octreeNode, key))
+	{
+		return nullptr;
 	}
 
-	//TODO: Could we do these 6 at at time for each quad?
-	for (uint16_t i = 0; i < noOfIndices; ++i)
+	//Nodes baked with the same mesh share it, as do nodes converted as normal, so another may already have it
+	if (volume->deduplicateMeshes)
 	{
-		const uint16_t index0 = cubuquityIndices[i];
-		const uint16_t index1 = cubuquityIndices[++i];
-		const uint16_t index2 = cubuquityIndices[++i];
-
-		const FColoredCubesVertex& vertex0 = coloredCubesVertices[index0];
-		const FColoredCubesVertex& vertex1 = coloredCubesVertices[index1];
-		const FColoredCubesVertex& vertex2 = coloredCubesVertices[index2];
-
-		//Reverse winding order
-		indices.Add(index2);
-		indices.Add(index1);
-		indices.Add(index0);
-
-		//Now calculate the tangent vectors
-		const FVector Edge01 = (vertex1.Position - vertex0.Position);
-		const FVector Edge02 = (vertex2.Position - vertex0.Position);
-		const FVector normal = (Edge02 ^ Edge01); //Normal
-
-		/*vertex0.SetTangents(TangentX, TangentY, TangentZ);
-		vertex1.SetTangents(TangentX, TangentY, TangentZ);
-		vertex2.SetTangents(TangentX, TangentY, TangentZ);*/
+		const TSharedPtr<FCubiquityMeshData> sharedMesh = volume->meshCache().find(key);
+		if (sharedMesh.IsValid())
+		{
+			INC_DWORD_STAT(STAT_CubiquityMeshCacheHits);
+			return sharedMesh;
+		}
 	}
 
-	if (ModelBodySetup)
+	const TSharedPtr<FCubiquityMeshData> bakedMesh = MakeShareable(new FCubiquityMeshData);
+	if (!volume->bakedMeshes()->load(key, *bakedMesh))
 	{
-		ModelBodySetup->InvalidatePhysicsData(); // This is required for the first time after creation
+		return nullptr;
 	}
 
-	UpdateCollision();
-
-	// Need to recreate scene proxy to send it over
-	MarkRenderStateDirty();
-
-	return true;
+	volume->meshesFromBakedArchive++;
+	if (volume->deduplicateMeshes)
+	{
+		volume->meshCache().add(key, bakedMesh);
+	}
+	return bakedMesh;
 }
 
-bool UCubiquityMeshComponent::ClearMeshTriangles()
+void UCubiquityMeshComponent::shareNewMesh(const FCubiquityMeshKey& key, const TSharedPtr<FCubiquityMeshData>& newMeshData)
 {
-	//UE_LOG(CubiquityLog, Log, TEXT("UCubiquityMeshComponent::ClearMeshTriangles"));
-	terrainVertices.Empty();
-	coloredCubesVertices.Empty();
-	indices.Empty();
+	bool optimisationPending = false;
+	newMeshData->key = key;
 
-	if (ModelBodySetup)
+	ACubiquityVolume* volume = Cast<ACubiquityVolume>(GetAttachmentRootActor());
+	if (volume)
 	{
-		ModelBodySetup->InvalidatePhysicsData(); // This is required for the first time after creation
+		volume->meshesConverted++;
+
+		if (volume->deduplicateMeshes)
+		{
+			volume->meshCache().add(key, newMeshData);
+		}
+
+		if (volume->optimiseMeshes && newMeshData->indices.Num() > 0)
+		{
+			volume->optimiseMesh(newMeshData, volumeType == Cubiquity::VolumeType::Terrain);
+			optimisationPending = true;
+		}
+		else if (volume->meshDiskCache())
+		{
+			volume->meshDiskCache()->save(*newMeshData);
+		}
 	}
 
+	setMeshData(newMeshData, optimisationPending);
+}
+
+void UCubiquityMeshComponent::setMeshData(const TSharedPtr<FCubiquityMeshData>& newMeshData, bool optimisationPending)
+{
+	meshData = newMeshData;
+
+	//The old body may be shared with other nodes so we just let go of it, and the volume frees it once no node uses its mesh.
+	//The new mesh's body gets cooked here if we are the first node to use it.
+	ModelBodySetup = nullptr;
 	UpdateCollision();
 
-	// Need to recreate scene proxy to send it over
-	MarkRenderStateDirty();
+	//The mesh data is already valid so if anything recreates the proxy in the meantime it still draws correctly,
+	//but while it is being optimised we hold off recreating it ourselves. The volume does that once it lands.
+	if (!optimisationPending)
+	{
+		// Need to recreate scene proxy to send it over
+		MarkRenderStateDirty();
+	}
+}
 
-	return true;
+void UCubiquityMeshComponent::releaseMeshData()
+{
+	//If we were the last user the arrays go back to the buffer pools
+	meshData.Reset();
 }
 
 FPrimitiveSceneProxy* UCubiquityMeshComponent::CreateSceneProxy()
 {
 	//UE_LOG(CubiquityLog, Log, TEXT("UCubiquityMeshComponent::CreateSceneProxy"));
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityProxyCreation);
+	CUBIQUITY_TRACE_NODE_SCOPE("Proxy creation", traceNode());
 	FPrimitiveSceneProxy* Proxy = nullptr;
 
-	if (terrainVertices.Num() > 0 || coloredCubesVertices.Num() > 0)
+	if (meshData.IsValid() && meshData->hasTriangles())
 	{
 		if (volumeType == Cubiquity::VolumeType::Terrain)
 		{
@@ -218,6 +239,11 @@ FPrimitiveSceneProxy* UCubiquityMeshComponent::CreateSceneProxy()
 			UE_LOG(CubiquityLog, Warning, TEXT("2 OTHER!"));
 		}
 	}
+
+	if (Proxy)
+	{
+		INC_DWORD_STAT(STAT_CubiquityProxiesCreated);
+	}
 	return Proxy;
 }
 
@@ -246,35 +272,7 @@ bool UCubiquityMeshComponent::GetPhysicsTriMeshData(struct FTriMeshCollisionData
 {
 	if (ContainsPhysicsTriMeshData(true))
 	{
-		if (volumeType == Cubiquity::VolumeType::Terrain)
-		{
-			for (const auto& vertex : terrainVertices)
-			{
-				CollisionData->Vertices.Add(vertex.Position);
-			}
-		}
-		else if (volumeType == Cubiquity::VolumeType::ColoredCubes)
-		{
-			for (const auto& vertex : coloredCubesVertices)
-			{	
-				CollisionData->Vertices.Add(vertex.Position);
-			}
-		}
-		
-		for (auto index = indices.CreateConstIterator(); index;)
-		{
-			FTriIndices Triangle;
-
-			Triangle.v0 = *index++;
-			Triangle.v1 = *index++;
-			Triangle.v2 = *index++;
-
-			CollisionData->Indices.Add(Triangle);
-			//CollisionData->MaterialIndices.Add(i); //For physical material properties
-		}
-
-		CollisionData->bFlipNormals = true;
-
+		FCubiquityMeshConverter::stageCollision(*meshData, volumeType, *CollisionData);
 		return true;
 	}
 
@@ -283,18 +281,21 @@ bool UCubiquityMeshComponent::GetPhysicsTriMeshData(struct FTriMeshCollisionData
 
 bool UCubiquityMeshComponent::ContainsPhysicsTriMeshData(bool InUseAllTriData) const
 {
-	return (terrainVertices.Num() > 0 || coloredCubesVertices.Num() > 0) && (indices.Num() > 0);
+	return meshData.IsValid() && meshData->hasTriangles();
 }
 
 void UCubiquityMeshComponent::UpdateBodySetup()
 {
 	//UE_LOG(CubiquityLog, Log, TEXT("UCubiquityMeshComponent::UpdateBodySetup"));
-	if (!ModelBodySetup)
+	if (!ModelBodySetup && meshData.IsValid())
 	{
-		SetSimulatePhysics(false);
-		ModelBodySetup = NewObject<UBodySetup>(this);
-		ModelBodySetup->CollisionTraceFlag = CTF_UseComplexAsSimple;
-		ModelBodySetup->bMeshCollideAll = true;
+		//The body belongs to the volume rather than to whichever node first needed it, so it always cooks from this mesh
+		ACubiquityVolume* volume = Cast<ACubiquityVolume>(GetAttachmentRootActor());
+		if (volume)
+		{
+			SetSimulatePhysics(false);
+			ModelBodySetup = volume->bodySetupFor(meshData, volumeType);
+		}
 	}
 }
 
@@ -303,12 +304,19 @@ void UCubiquityMeshComponent::UpdateCollision()
 	//UE_LOG(CubiquityLog, Log, TEXT("UCubiquityMeshComponent::UpdateCollision"));
 	if (bPhysicsStateCreated)
 	{
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityCollisionCook);
+		CUBIQUITY_TRACE_NODE_SCOPE("Collision cook", traceNode());
+
 		DestroyPhysicsState();
 		UpdateBodySetup();
-		CreatePhysicsState();
 
-		ModelBodySetup->InvalidatePhysicsData();
-		ModelBodySetup->CreatePhysicsMeshes();
+		//A body which is already cooked was cooked from identical triangles so only a new one needs its meshes creating
+		if (ModelBodySetup)
+		{
+			ModelBodySetup->CreatePhysicsMeshes();
+		}
+
+		CreatePhysicsState();
 
 		//UE_LOG(CubiquityLog, Log, TEXT("Physics updated"));
 	}
@@ -0,0 +1,314 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityMeshConverter.h"
+
+#include "CubiquityBufferPool.h"
+#include "CubiquityGreedyMesher.h"
+#include "CubiquityPackedFaces.h"
+#include "CubiquityMeshOptimiser.h"
+
+FCubiquityMeshKey FCubiquityMeshConverter::keyForNode(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings)
+{
+	uint32_t noOfIndices;
+	uint16_t* cubuquityIndices;
+	uint16_t noOfVertices;
+
+	if (settings.volumeType == Cubiquity::VolumeType::Terrain)
+	{
+		Cubiquity::TerrainVertex* cubiquityVertices;
+		octreeNode.getMesh(&noOfVertices, &cubiquityVertices, &noOfIndices, &cubuquityIndices);
+		return FCubiquityMeshKey::fromPayload(cubiquityVertices, noOfVertices * sizeof(Cubiquity::TerrainVertex), cubuquityIndices, noOfIndices, settings.flags());
+	}
+	else
+	{
+		Cubiquity::ColoredCubesVertex* cubiquityVertices;
+		octreeNode.getMesh(&noOfVertices, &cubiquityVertices, &noOfIndices, &cubuquityIndices);
+		return FCubiquityMeshKey::fromPayload(cubiquityVertices, noOfVertices * sizeof(Cubiquity::ColoredCubesVertex), cubuquityIndices, noOfIndices, settings.flags());
+	}
+}
+
+void FCubiquityMeshConverter::convert(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings, FCubiquityMeshData& outMeshData)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityMeshConversion);
+
+	switch (settings.volumeType)
+	{
+		case Cubiquity::VolumeType::Terrain:
+			convertTerrain(octreeNode, outMeshData);
+			break;
+		case Cubiquity::VolumeType::ColoredCubes:
+			convertColoredCubes(octreeNode, settings, outMeshData);
+			break;
+		default:
+			break;
+	}
+
+	//FCubiquityPackedFacesVertexFactory draws six vertices per packed face, but they are counted as the four corners an expanded face has so the stat compares with unpacked meshes
+	INC_DWORD_STAT_BY(STAT_CubiquityVerticesConverted, outMeshData.terrainVertices.Num() + outMeshData.coloredCubesVertices.Num() + outMeshData.packedFaces.Num() * 4);
+	INC_DWORD_STAT_BY(STAT_CubiquityIndicesConverted, outMeshData.indices.Num());
+}
+
+void FCubiquityMeshConverter::convertTerrain(const Cubiquity::OctreeNode& octreeNode, FCubiquityMeshData& outMeshData)
+{
+	uint32_t noOfIndices;
+	uint16_t* cubuquityIndices;
+	uint16_t noOfVertices;
+	const Cubiquity::TerrainVertex* cubiquityVertices;
+	octreeNode.getMesh(&noOfVertices, &cubiquityVertices, &noOfIndices, &cubuquityIndices);
+
+	TArray<FDynamicMeshVertex>& terrainVertices = outMeshData.terrainVertices;
+	TArray<int32>& indices = outMeshData.indices;
+
+	//Size the buffers up front so the Add calls below never reallocate
+	TCubiquityBufferPool<FDynamicMeshVertex>::get().acquire(terrainVertices, noOfVertices);
+	TCubiquityBufferPool<int32>::get().acquire(indices, noOfIndices);
+
+	for (uint32_t i = 0; i < noOfVertices; ++i)
+	{
+		const auto& cubiquityVertex = cubiquityVertices[i];
+
+		FDynamicMeshVertex Vert;
+
+		const auto position = cubiquityVertex.position();
+		Vert.Position = FVector(position.x, position.y, position.z);
+
+		const auto normal = cubiquityVertex.normal();
+		Vert.TangentZ = FVector(normal.x, normal.y, normal.z);// .SafeNormal();
+
+		const auto materials = cubiquityVertex.materials();
+		Vert.Color = FColor(materials[0], materials[1], materials[2], materials[3]); //TODO make this from materials
+
+		Vert.TextureCoordinate.Set(Vert.Position.X, Vert.Position.Y);
+
+		terrainVertices.Add(Vert);
+	}
+
+	//The normals are already set but we need the tangents and bitangents. Set these on a per-triangle basis based on the geometry
+	for (uint32_t i = 0; i < noOfIndices; ++i)
+	{
+		const uint16_t index0 = cubuquityIndices[i];
+		const uint16_t index1 = cubuquityIndices[++i];
+		const uint16_t index2 = cubuquityIndices[++i];
+
+		FDynamicMeshVertex& vertex0 = terrainVertices[index0];
+		FDynamicMeshVertex& vertex1 = terrainVertices[index1];
+		FDynamicMeshVertex& vertex2 = terrainVertices[index2];
+
+		//Reverse winding order
+		indices.Add(index2);
+		indices.Add(index1);
+		indices.Add(index0);
+
+		//Now calculate the tangent vectors
+		const FVector Edge01 = (vertex1.Position - vertex0.Position);
+		const FVector Edge02 = (vertex2.Position - vertex0.Position);
+		const FVector TangentX = Edge01.GetSafeNormal() * 256.0; //Tangent
+		const FVector TangentZ = vertex0.TangentZ; //Normal
+		const FVector TangentY = (TangentX ^ TangentZ); //Binormal (bitangent) I assume?
+
+		vertex1.SetTangents(TangentX, TangentY, vertex1.TangentZ);
+		vertex2.SetTangents(TangentX, TangentY, vertex2.TangentZ);
+	}
+}
+
+void FCubiquityMeshConverter::convertColoredCubes(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings, FCubiquityMeshData& outMeshData)
+{
+	uint32_t noOfIndices;
+	uint16_t* cubuquityIndices;
+	uint16_t noOfVertices;
+	Cubiquity::ColoredCubesVertex* cubiquityVertices;
+	octreeNode.getMesh(&noOfVertices, &cubiquityVertices, &noOfIndices, &cubuquityIndices);
+
+	TArray<FColoredCubesVertex>& coloredCubesVertices = outMeshData.coloredCubesVertices;
+	TArray<int32>& indices = outMeshData.indices;
+
+	//Size the buffers up front so the Add calls below never reallocate
+	TCubiquityBufferPool<FColoredCubesVertex>::get().acquire(coloredCubesVertices, noOfVertices);
+	TCubiquityBufferPool<int32>::get().acquire(indices, noOfIndices);
+
+	for (uint32_t i = 0; i < noOfVertices; ++i)
+	{
+		const auto& cubiquityVertex = cubiquityVertices[i];
+
+		FColoredCubesVertex Vert;
+
+		const auto& position = cubiquityVertex.position();
+		Vert.Position = FVector(position.x, position.y, position.z);
+
+		const auto& color = cubiquityVertex.color();
+		Vert.Color = FColor(color.red(), color.green(), color.blue(), color.alpha());
+
+		coloredCubesVertices.Add(Vert);
+	}
+
+	//TODO: Could we do these 6 at at time for each quad?
+	for (uint32_t i = 0; i < noOfIndices; ++i)
+	{
+		const uint16_t index0 = cubuquityIndices[i];
+		const uint16_t index1 = cubuquityIndices[++i];
+		const uint16_t index2 = cubuquityIndices[++i];
+
+		const FColoredCubesVertex& vertex0 = coloredCubesVertices[index0];
+		const FColoredCubesVertex& vertex1 = coloredCubesVertices[index1];
+		const FColoredCubesVertex& vertex2 = coloredCubesVertices[index2];
+
+		//Reverse winding order
+		indices.Add(index2);
+		indices.Add(index1);
+		indices.Add(index0);
+
+		//Now calculate the tangent vectors
+		const FVector Edge01 = (vertex1.Position - vertex0.Position);
+		const FVector Edge02 = (vertex2.Position - vertex0.Position);
+		const FVector normal = (Edge02 ^ Edge01); //Normal
+
+		/*vertex0.SetTangents(TangentX, TangentY, TangentZ);
+		vertex1.SetTangents(TangentX, TangentY, TangentZ);
+		vertex2.SetTangents(TangentX, TangentY, TangentZ);*/
+	}
+
+	if (settings.greedyMeshing)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityGreedyMeshing);
+
+		//Only ever used from the game thread so one instance can keep its scratch buffers between nodes
+		static FCubiquityGreedyMesher greedyMesher;
+
+		INC_DWORD_STAT_BY(STAT_CubiquityGreedyTrianglesIn, indices.Num() / 3);
+		if (!greedyMesher.mergeFaces(coloredCubesVertices, indices))
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Greedy meshing skipped a node whose mesh isn't made of axis-aligned quads"));
+		}
+		INC_DWORD_STAT_BY(STAT_CubiquityGreedyTrianglesOut, indices.Num() / 3);
+	}
+
+	if (settings.compactFaceStorage)
+	{
+		static TArray<FCubiquityQuad> quads; //Game thread only, so keep the scratch space around
+
+		TArray<FCubiquityPackedFace>& packedFaces = outMeshData.packedFaces;
+		TArray<FColor>& facePalette = outMeshData.facePalette;
+		if (FCubiquityGreedyMesher::extractQuads(coloredCubesVertices, indices, quads) && FCubiquityPackedFaces::packQuads(quads, packedFaces, facePalette))
+		{
+			//The packed faces are now the only copy. The GPU reads them as they are and collision staging makes its triangles straight from them.
+			TCubiquityBufferPool<FColoredCubesVertex>::get().release(coloredCubesVertices);
+			TCubiquityBufferPool<int32>::get().release(indices);
+		}
+		else
+		{
+			packedFaces.Reset();
+			facePalette.Reset();
+			UE_LOG(CubiquityLog, Warning, TEXT("Compact face storage skipped a node whose mesh couldn't be packed"));
+		}
+	}
+}
+
+void FCubiquityMeshConverter::optimise(FCubiquityOptimisedMesh& mesh, bool isTerrain)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityMeshOptimisation);
+
+	const int32 vertexCount = isTerrain ? mesh.terrainVertices.Num() : mesh.coloredCubesVertices.Num();
+	mesh.before = FCubiquityMeshOptimiser::simulateVertexCache(mesh.indices, vertexCount);
+
+	FCubiquityMeshOptimiser::optimiseVertexCache(mesh.indices, vertexCount);
+	if (isTerrain)
+	{
+		FCubiquityMeshOptimiser::optimiseVertexFetch(mesh.terrainVertices, mesh.indices);
+	}
+	else
+	{
+		FCubiquityMeshOptimiser::optimiseVertexFetch(mesh.coloredCubesVertices, mesh.indices);
+	}
+
+	mesh.after = FCubiquityMeshOptimiser::simulateVertexCache(mesh.indices, isTerrain ? mesh.terrainVertices.Num() : mesh.coloredCubesVertices.Num());
+}
+
+void FCubiquityMeshConverter::applyOptimisedMesh(const FCubiquityOptimisedMesh& optimisedMesh, FCubiquityMeshData& meshData)
+{
+	//Copy rather than swap so we keep our pooled allocations. The result is never bigger than what we have.
+	meshData.terrainVertices.Reset();
+	meshData.terrainVertices.Append(optimisedMesh.terrainVertices);
+	meshData.coloredCubesVertices.Reset();
+	meshData.coloredCubesVertices.Append(optimisedMesh.coloredCubesVertices);
+	meshData.indices.Reset();
+	meshData.indices.Append(optimisedMesh.indices);
+
+	//Any proxy already made from this mesh keeps its old buffers, the next ones get new buffers
+	meshData.terrainRenderData.Reset();
+	meshData.coloredCubesRenderData.Reset();
+
+#if STATS
+	const int32 triangleCount = meshData.indices.Num() / 3;
+	INC_DWORD_STAT_BY(STAT_CubiquityOptimisedTriangles, triangleCount);
+	INC_DWORD_STAT_BY(STAT_CubiquityVertexCacheMissesBefore, FMath::RoundToInt(optimisedMesh.before.acmr * triangleCount));
+	INC_DWORD_STAT_BY(STAT_CubiquityVertexCacheMissesAfter, FMath::RoundToInt(optimisedMesh.after.acmr * triangleCount));
+#endif
+	UE_LOG(CubiquityLog, Verbose, TEXT("Vertex cache optimisation: ACMR %f -> %f, ATVR %f -> %f"), optimisedMesh.before.acmr, optimisedMesh.after.acmr, optimisedMesh.before.atvr, optimisedMesh.after.atvr);
+}
+
+void FCubiquityMeshConverter::stageCollision(const FCubiquityMeshData& meshData, Cubiquity::VolumeType volumeType, FTriMeshCollisionData& outCollisionData)
+{
+	const TArray<FDynamicMeshVertex>& terrainVertices = meshData.terrainVertices;
+	const TArray<FColoredCubesVertex>& coloredCubesVertices = meshData.coloredCubesVertices;
+	const TArray<int32>& indices = meshData.indices;
+	const TArray<FCubiquityPackedFace>& packedFaces = meshData.packedFaces;
+
+	//The collision data is owned by the cooker so we can't pool it, but we can at least size it in one go
+	if (volumeType == Cubiquity::VolumeType::Terrain)
+	{
+		outCollisionData.Vertices.Reserve(outCollisionData.Vertices.Num() + terrainVertices.Num());
+		for (const auto& vertex : terrainVertices)
+		{
+			outCollisionData.Vertices.Add(vertex.Position);
+		}
+	}
+	else if (volumeType == Cubiquity::VolumeType::ColoredCubes)
+	{
+		outCollisionData.Vertices.Reserve(outCollisionData.Vertices.Num() + coloredCubesVertices.Num());
+		for (const auto& vertex : coloredCubesVertices)
+		{
+			outCollisionData.Vertices.Add(vertex.Position);
+		}
+	}
+
+	//Packed faces go straight in as corners and triangles, there's no need to make full vertices for the cooker
+	if (packedFaces.Num() > 0)
+	{
+		outCollisionData.Vertices.Reserve(outCollisionData.Vertices.Num() + packedFaces.Num() * 4);
+		outCollisionData.Indices.Reserve(outCollisionData.Indices.Num() + packedFaces.Num() * 2);
+		for (const FCubiquityPackedFace& face : packedFaces)
+		{
+			const int32 firstVertex = outCollisionData.Vertices.Num();
+			FVector corners[4];
+			FCubiquityPackedFaces::faceCorners(face, corners);
+			outCollisionData.Vertices.Append(corners, 4);
+
+			const int32* triangleCorners = FCubiquityPackedFaces::triangleCorners(face);
+			for (int32 t = 0; t < 6; t += 3)
+			{
+				FTriIndices Triangle;
+				Triangle.v0 = firstVertex + triangleCorners[t];
+				Triangle.v1 = firstVertex + triangleCorners[t + 1];
+				Triangle.v2 = firstVertex + triangleCorners[t + 2];
+				outCollisionData.Indices.Add(Triangle);
+			}
+		}
+	}
+
+	outCollisionData.Indices.Reserve(outCollisionData.Indices.Num() + indices.Num() / 3);
+	for (auto index = indices.CreateConstIterator(); index;)
+	{
+		FTriIndices Triangle;
+
+		Triangle.v0 = *index++;
+		Triangle.v1 = *index++;
+		Triangle.v2 = *index++;
+
+		outCollisionData.Indices.Add(Triangle);
+		//outCollisionData.MaterialIndices.Add(i); //For physical material properties
+	}
+
+	outCollisionData.bFlipNormals = true;
+}
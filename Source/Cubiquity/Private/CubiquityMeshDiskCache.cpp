@@ -0,0 +1,260 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityMeshDiskCache.h"
+
+#include "Async.h"
+
+namespace
+{
+	const uint32 EntryMagic = 0x434D5143; //'CQMC'
+	const uint32 EntryVersion = 1; //Bump this whenever the vertex layouts or the conversion change
+
+	struct FEntryHeader
+	{
+		uint32 magic;
+		uint32 version;
+		uint8 hash[20];
+		uint32 noOfTerrainVertices;
+		uint32 noOfColoredCubesVertices;
+		uint32 noOfIndices;
+		uint32 noOfPackedFaces;
+		uint32 noOfPaletteColors;
+	};
+
+	template <typename ElementType>
+	void appendArray(TArray<uint8>& bytes, const TArray<ElementType>& array)
+	{
+		const int32 size = array.Num() * sizeof(ElementType);
+		const int32 offset = bytes.AddUninitialized(size);
+		FMemory::Memcpy(bytes.GetData() + offset, array.GetData(), size);
+	}
+
+	//The arrays are plain data so they are stored as they are in memory. Entries are only ever read on the machine which wrote them.
+	template <typename ElementType>
+	bool readArray(const uint8*& cursor, const uint8* end, uint32 count, TArray<ElementType>& array)
+	{
+		const SIZE_T size = count * sizeof(ElementType);
+		if (SIZE_T(end - cursor) < size)
+		{
+			return false;
+		}
+
+		array.AddUninitialized(count);
+		FMemory::Memcpy(array.GetData(), cursor, size);
+		cursor += size;
+		return true;
+	}
+}
+
+FCubiquityMeshDiskCache::FCubiquityMeshDiskCache(const FString& volumeFileName, int64 inMaxBytes, int32 inMaxAgeDays)
+	: maxBytes(FMath::Max<int64>(inMaxBytes, 0))
+	, maxAgeDays(FMath::Max(inMaxAgeDays, 0))
+	, state(MakeShareable(new FSharedState))
+{
+	directory = FPaths::GameSavedDir() / TEXT("Cubiquity") / TEXT("MeshCache") / FMD5::HashAnsiString(*FPaths::ConvertRelativePathToFull(volumeFileName));
+
+	//Even without limits this finds out how much is on disk
+	startTrim();
+}
+
+void FCubiquityMeshDiskCache::startTrim() const
+{
+	if (state->trimming.Set(1) != 0)
+	{
+		return;
+	}
+
+	state->tasksInFlight.Increment();
+	const FString trimDirectory = directory;
+	const int64 trimMaxBytes = maxBytes;
+	const int32 trimMaxAgeDays = maxAgeDays;
+	const TSharedRef<FSharedState, ESPMode::ThreadSafe> trimState = state;
+	Async<void>(EAsyncExecution::ThreadPool, [trimDirectory, trimMaxBytes, trimMaxAgeDays, trimState]()
+	{
+		struct FEntry
+		{
+			FString path;
+			int64 size;
+			FDateTime lastUsed;
+		};
+
+		IFileManager& fileManager = IFileManager::Get();
+		TArray<FString> fileNames;
+		fileManager.FindFiles(fileNames, *(trimDirectory / TEXT("*.mesh")), true, false);
+
+		TArray<FEntry> entries;
+		int64 totalBytes = 0;
+		for (const FString& fileName : fileNames)
+		{
+			FEntry entry;
+			entry.path = trimDirectory / fileName;
+			entry.size = fileManager.FileSize(*entry.path);
+			entry.lastUsed = fileManager.GetTimeStamp(*entry.path);
+			if (entry.size >= 0)
+			{
+				totalBytes += entry.size;
+				entries.Add(entry);
+			}
+		}
+
+		//Least recently used first
+		entries.Sort([](const FEntry& a, const FEntry& b) { return a.lastUsed < b.lastUsed; });
+
+		const FDateTime oldestKept = trimMaxAgeDays > 0 ? FDateTime::UtcNow() - FTimespan::FromDays(trimMaxAgeDays) : FDateTime::MinValue();
+		const int64 targetBytes = trimMaxBytes - trimMaxBytes / 10;
+		for (const FEntry& entry : entries)
+		{
+			const bool tooOld = entry.lastUsed < oldestKept;
+			const bool overLimit = trimMaxBytes > 0 && totalBytes > targetBytes;
+			if (!tooOld && !overLimit)
+			{
+				break;
+			}
+
+			if (fileManager.Delete(*entry.path, false, false, true))
+			{
+				totalBytes -= entry.size;
+				trimState->entriesEvicted.Increment();
+				INC_DWORD_STAT(STAT_CubiquityMeshDiskCacheEvictions);
+			}
+		}
+
+		trimState->kilobytesOnDisk.Set(int32(totalBytes / 1024));
+		trimState->trimming.Set(0);
+		trimState->tasksInFlight.Decrement();
+	});
+}
+
+FString FCubiquityMeshDiskCache::entryPath(const FCubiquityMeshKey& key) const
+{
+	return directory / BytesToHex(key.hash.Hash, sizeof(key.hash.Hash)) + TEXT(".mesh");
+}
+
+void FCubiquityMeshDiskCache::writeEntry(const FCubiquityMeshData& meshData, TArray<uint8>& outBytes)
+{
+	FEntryHeader header;
+	header.magic = EntryMagic;
+	header.version = EntryVersion;
+	FMemory::Memcpy(header.hash, meshData.key.hash.Hash, sizeof(header.hash));
+	header.noOfTerrainVertices = meshData.terrainVertices.Num();
+	header.noOfColoredCubesVertices = meshData.coloredCubesVertices.Num();
+	header.noOfIndices = meshData.indices.Num();
+	header.noOfPackedFaces = meshData.packedFaces.Num();
+	header.noOfPaletteColors = meshData.facePalette.Num();
+
+	outBytes.Reserve(outBytes.Num() + sizeof(header) + meshData.cpuBytes());
+	outBytes.Append(reinterpret_cast<const uint8*>(&header), sizeof(header));
+	appendArray(outBytes, meshData.terrainVertices);
+	appendArray(outBytes, meshData.coloredCubesVertices);
+	appendArray(outBytes, meshData.indices);
+	appendArray(outBytes, meshData.packedFaces);
+	appendArray(outBytes, meshData.facePalette);
+}
+
+bool FCubiquityMeshDiskCache::readEntry(const uint8* bytes, int64 size, const FCubiquityMeshKey& key, FCubiquityMeshData& outMeshData)
+{
+	if (size < static_cast<int64>(sizeof(FEntryHeader)))
+	{
+		return false;
+	}
+
+	FEntryHeader header;
+	FMemory::Memcpy(&header, bytes, sizeof(header));
+	if (header.magic != EntryMagic || header.version != EntryVersion || FMemory::Memcmp(header.hash, key.hash.Hash, sizeof(header.hash)) != 0)
+	{
+		return false;
+	}
+
+	TCubiquityBufferPool<FDynamicMeshVertex>::get().acquire(outMeshData.terrainVertices, header.noOfTerrainVertices);
+	TCubiquityBufferPool<FColoredCubesVertex>::get().acquire(outMeshData.coloredCubesVertices, header.noOfColoredCubesVertices);
+	TCubiquityBufferPool<int32>::get().acquire(outMeshData.indices, header.noOfIndices);
+	outMeshData.packedFaces.Reset();
+	outMeshData.facePalette.Reset();
+
+	const uint8* cursor = bytes + sizeof(header);
+	const uint8* end = bytes + size;
+	const bool valid = readArray(cursor, end, header.noOfTerrainVertices, outMeshData.terrainVertices)
+		&& readArray(cursor, end, header.noOfColoredCubesVertices, outMeshData.coloredCubesVertices)
+		&& readArray(cursor, end, header.noOfIndices, outMeshData.indices)
+		&& readArray(cursor, end, header.noOfPackedFaces, outMeshData.packedFaces)
+		&& readArray(cursor, end, header.noOfPaletteColors, outMeshData.facePalette)
+		&& cursor == end;
+
+	if (!valid)
+	{
+		outMeshData.terrainVertices.Reset();
+		outMeshData.coloredCubesVertices.Reset();
+		outMeshData.indices.Reset();
+		outMeshData.packedFaces.Reset();
+		outMeshData.facePalette.Reset();
+		return false;
+	}
+
+	outMeshData.key = key;
+	return true;
+}
+
+bool FCubiquityMeshDiskCache::load(const FCubiquityMeshKey& key, FCubiquityMeshData& outMeshData) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_CubiquityMeshDiskCacheRead);
+
+	const FString path = entryPath(key);
+	TArray<uint8> bytes;
+	if (!FFileHelper::LoadFileToArray(bytes, *path, FILEREAD_Silent) || !readEntry(bytes.GetData(), bytes.Num(), key, outMeshData))
+	{
+		INC_DWORD_STAT(STAT_CubiquityMeshDiskCacheMisses);
+		return false;
+	}
+
+	//The timestamp is what trimming goes by so a hit makes the entry the most recently used
+	IFileManager::Get().SetTimeStamp(*path, FDateTime::UtcNow());
+
+	INC_DWORD_STAT(STAT_CubiquityMeshDiskCacheHits);
+	return true;
+}
+
+void FCubiquityMeshDiskCache::save(const FCubiquityMeshData& meshData) const
+{
+	//Flatten it here so that the worker doesn't touch the mesh data, which the game thread owns
+	TArray<uint8> bytes;
+	writeEntry(meshData, bytes);
+
+	const FString path = entryPath(meshData.key);
+	const TSharedRef<FSharedState, ESPMode::ThreadSafe> saveState = state;
+	saveState->tasksInFlight.Increment();
+	Async<void>(EAsyncExecution::ThreadPool, [bytes, path, saveState]()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityMeshDiskCacheWrite);
+
+		//Write to a temporary file and move it into place so that a reader never sees half an entry
+		const FString temporaryPath = path + FString::Printf(TEXT(".%08x.tmp"), FPlatformTLS::GetCurrentThreadId());
+		if (FFileHelper::SaveArrayToFile(bytes, *temporaryPath))
+		{
+			IFileManager::Get().Move(*path, *temporaryPath, true, true, false, true);
+			saveState->kilobytesOnDisk.Add(FMath::DivideAndRoundUp(bytes.Num(), 1024));
+		}
+		saveState->tasksInFlight.Decrement();
+	});
+
+	if (maxBytes > 0 && bytesOnDisk() > maxBytes)
+	{
+		startTrim();
+	}
+}
+
+void FCubiquityMeshDiskCache::clear() const
+{
+	flush();
+	IFileManager::Get().DeleteDirectory(*directory, false, true);
+	state->kilobytesOnDisk.Set(0);
+}
+
+void FCubiquityMeshDiskCache::flush() const
+{
+	while (state->tasksInFlight.GetValue() > 0)
+	{
+		FPlatformProcess::Sleep(0.001f);
+	}
+}
@@ -0,0 +1,226 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityNetLoopbackCommandlet.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "CubiquityEditStream.h"
+#include "CubiquitySyncSimulator.h"
+
+#include <memory>
+
+namespace
+{
+	//Open a copy of the volume so the original is left alone
+	std::unique_ptr<Cubiquity::Volume> openCopy(const FCubiquitySessionRecording& recording, const FString& volumeFileName, const TCHAR* name, FString& outCopyFileName)
+	{
+		outCopyFileName = FPaths::CreateTempFilename(*(FPaths::GameSavedDir() / TEXT("Cubiquity")), name, TEXT(".vdb"));
+		if (IFileManager::Get().Copy(*outCopyFileName, *volumeFileName) != COPY_OK)
+		{
+			UE_LOG(CubiquityLog, Error, TEXT("Failed to copy %s to %s"), *volumeFileName, *outCopyFileName);
+			return nullptr;
+		}
+
+		if (recording.conversionSettings().volumeType == Cubiquity::VolumeType::Terrain)
+		{
+			return std::make_unique<Cubiquity::TerrainVolume>(TCHAR_TO_ANSI(*outCopyFileName), Cubiquity::WritePermissions::ReadWrite, recording.baseNodeSize());
+		}
+		return std::make_unique<Cubiquity::ColoredCubesVolume>(TCHAR_TO_ANSI(*outCopyFileName), Cubiquity::WritePermissions::ReadWrite, recording.baseNodeSize());
+	}
+
+	int64 countMismatchedVoxels(Cubiquity::Volume& server, Cubiquity::Volume& client)
+	{
+		const auto region = server.enclosingRegion();
+		const bool terrain = server.volumeType() == Cubiquity::VolumeType::Terrain;
+
+		int64 mismatched = 0;
+		for (int32 z = region.first.z; z <= region.second.z; ++z)
+		{
+			for (int32 y = region.first.y; y <= region.second.y; ++y)
+			{
+				for (int32 x = region.first.x; x <= region.second.x; ++x)
+				{
+					const bool same = terrain
+						? static_cast<Cubiquity::TerrainVolume&>(server).getVoxel({ x, y, z }).materialSetStruct().data == static_cast<Cubiquity::TerrainVolume&>(client).getVoxel({ x, y, z }).materialSetStruct().data
+						: static_cast<Cubiquity::ColoredCubesVolume&>(server).getVoxel({ x, y, z }).colorStruct().data == static_cast<Cubiquity::ColoredCubesVolume&>(client).getVoxel({ x, y, z }).colorStruct().data;
+					if (!same)
+					{
+						++mismatched;
+					}
+				}
+			}
+		}
+		return mismatched;
+	}
+}
+
+UCubiquityNetLoopbackCommandlet::UCubiquityNetLoopbackCommandlet(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	LogToConsole = true;
+}
+
+int32 UCubiquityNetLoopbackCommandlet::Main(const FString& Params)
+{
+	if (!FCubiquityCommandletSwitches::validate(Params, { TEXT("Recording="), TEXT("Volume="), TEXT("Output="), TEXT("NetUpdateRate="), TEXT("Reorder") },
+		TEXT("Usage: -run=CubiquityNetLoopback -Recording=Path/To.cqrec [-Volume=Path/To.vdb] [-NetUpdateRate=30] [-Reorder] [-Output=Path/To.json]")))
+	{
+		return 1;
+	}
+
+	FString recordingFileName;
+	FString volumeFileName;
+	FString outputFileName = FPaths::ProfilingDir() / TEXT("Cubiquity") / FString::Printf(TEXT("NetLoopback-%s.json"), *FDateTime::Now().ToString());
+	float netUpdateRate = 30.0f;
+
+	FParse::Value(*Params, TEXT("Recording="), recordingFileName);
+	FParse::Value(*Params, TEXT("Volume="), volumeFileName);
+	FParse::Value(*Params, TEXT("Output="), outputFileName);
+	FParse::Value(*Params, TEXT("NetUpdateRate="), netUpdateRate);
+	const bool reorder = FParse::Param(*Params, TEXT("Reorder"));
+	netUpdateRate = FMath::Max(netUpdateRate, 1.0f);
+
+	FCubiquitySessionRecording recording;
+	if (recordingFileName.IsEmpty() || !recording.load(recordingFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Couldn't read a recording from '%s'. Use -Recording=Path/To.cqrec"), *recordingFileName);
+		return 1;
+	}
+
+	if (volumeFileName.IsEmpty())
+	{
+		volumeFileName = recording.volumeFileName();
+	}
+	if (!FPaths::FileExists(volumeFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Volume %s does not exist. Use -Volume= to say where it is now"), *volumeFileName);
+		return 1;
+	}
+
+	FString serverFileName;
+	FString clientFileName;
+	std::unique_ptr<Cubiquity::Volume> server = openCopy(recording, volumeFileName, TEXT("LoopbackServer"), serverFileName);
+	std::unique_ptr<Cubiquity::Volume> client = openCopy(recording, volumeFileName, TEXT("LoopbackClient"), clientFileName);
+	if (!server || !client)
+	{
+		return 1;
+	}
+
+	FCubiquityEditSender sender;
+	FCubiquityEditReceiver receiver;
+	FCubiquitySamples batchBytes;
+	int64 rawBytes = 0;
+	float duration = 0.0f;
+
+	//A batch goes through the same serialisation as it would over the network before the client sees it
+	TArray<FCubiquityEditBatch> heldBack;
+	auto deliver = [&](const FCubiquityEditBatch& batch)
+	{
+		FBitWriter writer(0, true);
+		bool success = false;
+		const_cast<FCubiquityEditBatch&>(batch).NetSerialize(writer, nullptr, success);
+
+		FBitReader reader(writer.GetData(), writer.GetNumBits());
+		FCubiquityEditBatch received;
+		received.NetSerialize(reader, nullptr, success);
+
+		receiver.receive(received);
+		for (const FCubiquityRecordedEvent& event : receiver.ready)
+		{
+			event.applyTo(*client);
+		}
+		receiver.ready.Reset();
+	};
+
+	auto netUpdate = [&]()
+	{
+		//As the volume sends them, though nothing is left for the next update here
+		while (sender.hasEdits())
+		{
+			const FCubiquityEditBatch batch = sender.takeBatch();
+			batchBytes.add(batch.wireBytes());
+
+			if (!reorder)
+			{
+				deliver(batch);
+			}
+			else if (heldBack.Num() == 0)
+			{
+				heldBack.Add(batch);
+			}
+			else
+			{
+				deliver(batch);
+				deliver(heldBack.Pop());
+			}
+		}
+	};
+
+	const double runStart = FPlatformTime::Seconds();
+	float nextNetUpdate = 1.0f / netUpdateRate;
+	for (const FCubiquityRecordedEvent& event : recording.events())
+	{
+		while (event.time >= nextNetUpdate)
+		{
+			netUpdate();
+			nextNetUpdate += 1.0f / netUpdateRate;
+		}
+		duration = event.time;
+
+		if (event.op == ECubiquityRecordedOp::Camera)
+		{
+			continue;
+		}
+
+		//What sending the event as it is recorded would cost, for comparison
+		TArray<uint8> raw;
+		FMemoryWriter rawWriter(raw);
+		rawWriter << const_cast<FCubiquityRecordedEvent&>(event);
+		rawBytes += raw.Num();
+
+		const FCubiquityRecordedEvent quantised = FCubiquityEditStream::quantise(event);
+		quantised.applyTo(*server);
+		sender.queue(quantised);
+	}
+	netUpdate();
+	while (heldBack.Num() > 0)
+	{
+		deliver(heldBack.Pop());
+	}
+	const double runSeconds = FPlatformTime::Seconds() - runStart;
+
+	const int64 mismatched = countMismatchedVoxels(*server, *client);
+	const bool identical = mismatched == 0 && receiver.opsReceived == sender.opsSent;
+	if (!identical)
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("The client doesn't match the server: %lld voxels differ and it applied %d of %d ops"), mismatched, receiver.opsReceived, sender.opsSent);
+	}
+
+	server.reset();
+	client.reset();
+	IFileManager::Get().Delete(*serverFileName, false, false, true);
+	IFileManager::Get().Delete(*clientFileName, false, false, true);
+
+	FString json = TEXT("{\n");
+	json += FString::Printf(TEXT("\"config\":{\"recording\":\"%s\",\"volume\":\"%s\",\"net_update_rate\":%.1f,\"reorder\":%s},\n"),
+		*recordingFileName.Replace(TEXT("\\"), TEXT("/")), *volumeFileName.Replace(TEXT("\\"), TEXT("/")), netUpdateRate, reorder ? TEXT("true") : TEXT("false"));
+	json += FString::Printf(TEXT("\"identical\":%s,\n\"mismatched_voxels\":%lld,\n\"run_seconds\":%.3f,\n"), identical ? TEXT("true") : TEXT("false"), mismatched, runSeconds);
+	json += FString::Printf(TEXT("\"ops\":%d,\n\"batches\":%d,\n\"batches_out_of_order\":%d,\n\"batches_corrupt\":%d,\n"), sender.opsSent, sender.batchesSent, receiver.batchesOutOfOrder, receiver.batchesCorrupt);
+	json += FString::Printf(TEXT("\"wire_bytes\":%lld,\n\"raw_event_bytes\":%lld,\n"), sender.bytesSent, rawBytes);
+	json += FString::Printf(TEXT("\"bytes_per_op\":%.2f,\n\"bytes_per_second\":%.1f,\n"),
+		sender.opsSent > 0 ? double(sender.bytesSent) / sender.opsSent : 0.0, duration > 0.0f ? sender.bytesSent / duration : 0.0);
+	json += FString::Printf(TEXT("\"batch_bytes\":%s\n"), *batchBytes.toJson(TEXT("bytes")));
+	json += TEXT("}\n");
+
+	UE_LOG(CubiquityLog, Display, TEXT("%s"), *json);
+
+	if (!FFileHelper::SaveStringToFile(json, *outputFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to write %s"), *outputFileName);
+		return 1;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("Wrote loopback results to %s"), *outputFileName);
+	return identical ? 0 : 1;
+}
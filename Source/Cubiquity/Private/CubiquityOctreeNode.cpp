@@ -36,6 +36,10 @@ void ACubiquityOctreeNode::Destroyed()
 
 	//UE_LOG(CubiquityLog, Log, TEXT("ACubiquityOctreeNode::Destroyed"));
 
+	INC_DWORD_STAT(STAT_CubiquityNodeActorsDestroyed);
+
+	mesh->releaseMeshData();
+
 	TArray<AActor*> childrenActors = Children;
 	//UE_LOG(CubiquityLog, Log, TEXT(" Children %d"), childrenActors.Num());
 	for (AActor* childActor : childrenActors)
@@ -56,117 +60,85 @@ void ACubiquityOctreeNode::initialiseOctreeNode(const Cubiquity::OctreeNode& new
 
 	//UE_LOG(CubiquityLog, Log, TEXT("%d My absolute: %d %d %d     Parent absolute: %d %d %d     Relative: %d %d %d"), depth, nodeX, nodeY, nodeZ, parentX, parentY, parentZ, nodeX - parentX, nodeY - parentY, nodeZ - parentZ);
 	
-	structureLastSynced = 0;
-	propertiesLastSynced = 0;
-	meshLastSynced = 0;
-	nodeAndChildrenLastSynced = 0;
+	sync = FCubiquityNodeSyncState();
+	sync.spawnedAt = FPlatformTime::Seconds();
+
+	volumePosition = FIntVector(newOctreeNode.position().x, newOctreeNode.position().y, newOctreeNode.position().z);
+	height = newOctreeNode.height();
 
 	mesh->setVolumeType();
 
 	mesh->SetMaterial(0, material);
 }
 
-int ACubiquityOctreeNode::processOctreeNode(const Cubiquity::OctreeNode& octreeNode, int availableNodeSyncs)
+int ACubiquityOctreeNode::processOctreeNode(const Cubiquity::OctreeNode& octreeNode, int availableNodeSyncs, FCubiquityNodeSyncBudget& budget, bool ancestorDrawn)
+{
+	return TCubiquityNodeSync<ACubiquityOctreeNode>::processOctreeNode(*this, octreeNode, availableNodeSyncs, budget, ancestorDrawn);
+}
+
+int ACubiquityOctreeNode::processEditedNodes(const Cubiquity::OctreeNode& octreeNode, FCubiquityEditLatency& edits, uint32 baseNodeSize, int& availableNodeSyncs)
 {
-	int nodeSyncsPerformed = 0;
+	return TCubiquityNodeSync<ACubiquityOctreeNode>::processEditedNodes(*this, octreeNode, edits, baseNodeSize, availableNodeSyncs);
+}
 
-	if (availableNodeSyncs <= 0)
+void ACubiquityOctreeNode::syncMesh(const Cubiquity::OctreeNode& octreeNode)
+{
+	height = octreeNode.height();
+
+	if (octreeNode.hasMesh())
 	{
-		return nodeSyncsPerformed;
+		//Repopulate the mesh data. This reuses the existing buffers so there is no need to clear them first
+		mesh->SetGeneratedMeshTriangles(octreeNode);
 	}
-
-	if (octreeNode.nodeOrChildrenLastChanged() > nodeAndChildrenLastSynced)
+	else
 	{
-		if (octreeNode.propertiesLastChanged() > propertiesLastSynced)
-		{
-			height = octreeNode.height();
-			renderThisNode = octreeNode.renderThisNode();
+		mesh->ClearMeshTriangles();
+	}
 
-			mesh->SetVisibility(renderThisNode); //Hide the mesh as needed
+	INC_DWORD_STAT(STAT_CubiquityNodesSynced);
+}
 
-			propertiesLastSynced = Cubiquity::currentTime();
-		}
+void ACubiquityOctreeNode::setMeshVisible(bool visible)
+{
+	mesh->SetVisibility(visible);
+}
 
-		if (octreeNode.meshLastChanged() > meshLastSynced)
-		{
-			if (octreeNode.hasMesh())
-			{
-				//Reset all the mesh data and repopulate it
-				mesh->ClearMeshTriangles();
-				mesh->SetGeneratedMeshTriangles(octreeNode);
-			}
-			else
-			{
-				mesh->ClearMeshTriangles();
-			}
+ACubiquityOctreeNode* ACubiquityOctreeNode::spawnChild(const Cubiquity::OctreeNode& childNode, uint32 x, uint32 y, uint32 z)
+{
+	const FVector childNodeVolumePosition = FVector(childNode.position().x, childNode.position().y, childNode.position().z) - FVector(volumePosition);
 
-			meshLastSynced = Cubiquity::currentTime();
+	FActorSpawnParameters spawnParameters;
+	spawnParameters.Owner = this;
+	ACubiquityOctreeNode* childNodeActor = GetWorld()->SpawnActor<ACubiquityOctreeNode>(childNodeVolumePosition, FRotator::ZeroRotator, spawnParameters);
+	INC_DWORD_STAT(STAT_CubiquityNodeActorsSpawned);
+	childNodeActor->initialiseOctreeNode(childNode, getVolume()->Material);
 
-			availableNodeSyncs--;
-			nodeSyncsPerformed++;
-		}
+	children[x][y][z] = childNodeActor;
+	return childNodeActor;
+}
 
-		if (octreeNode.structureLastChanged() > structureLastSynced)
-		{
-			for (uint32_t z = 0; z < 2; z++)
-			{
-				for (uint32_t y = 0; y < 2; y++)
-				{
-					for (uint32_t x = 0; x < 2; x++)
-					{
-						ACubiquityOctreeNode* const childActor = children[x][y][z];
-
-						if (octreeNode.hasChildNode({ x, y, z }))
-						{
-							if (!childActor) //If we don't have a child actor but there is a child node ... create it
-							{
-								const auto& childNode = octreeNode.childNode({ x, y, z });
-
-								const FVector childNodeVolumePosition = FVector(childNode.position().x, childNode.position().y, childNode.position().z) - FVector(octreeNode.position().x, octreeNode.position().y, octreeNode.position().z);
-								
-								FActorSpawnParameters spawnParameters;
-								spawnParameters.Owner = this;
-								ACubiquityOctreeNode* childNodeActor = GetWorld()->SpawnActor<ACubiquityOctreeNode>(childNodeVolumePosition, FRotator::ZeroRotator, spawnParameters);
-								childNodeActor->initialiseOctreeNode(childNode, getVolume()->Material);
-
-								children[x][y][z] = childNodeActor;
-							}
-						}
-						else
-						{
-							if (childActor) //If we have a child actor but there is no child node ... delete it
-							{
-								children[x][y][z]->Destroy();
-								children[x][y][z] = nullptr;
-							}
-						}
-					}
-				}
-			}
+void ACubiquityOctreeNode::destroyChild(uint32 x, uint32 y, uint32 z)
+{
+	children[x][y][z]->Destroy();
+	children[x][y][z] = nullptr;
+}
 
-			structureLastSynced = Cubiquity::currentTime();
-		}
+void ACubiquityOctreeNode::evictMesh()
+{
+	mesh->ClearMeshTriangles();
+	sync.meshEvicted = true;
+}
 
-		for (uint32_t z = 0; z < 2; z++)
-		{
-			for (uint32_t y = 0; y < 2; y++)
-			{
-				for (uint32_t x = 0; x < 2; x++)
-				{
-					if (octreeNode.hasChildNode({ x, y, z }))
-					{
-						// Recursivly call the octree traversal
-						children[x][y][z]->processOctreeNode(octreeNode.childNode({ x, y, z }), availableNodeSyncs);
-					}
-				}
-			}
-		}
+void ACubiquityOctreeNode::restoreMesh()
+{
+	sync.meshEvicted = false;
+	sync.meshLastSynced = 0;
 
-		nodeAndChildrenLastSynced = Cubiquity::currentTime();
-		
+	//processOctreeNode() only walks down branches which have changed so make sure it reaches us
+	for (ACubiquityOctreeNode* node = this; node; node = Cast<ACubiquityOctreeNode>(node->GetOwner()))
+	{
+		node->sync.nodeAndChildrenLastSynced = 0;
 	}
-
-	return nodeSyncsPerformed;
 }
 
 ACubiquityVolume* ACubiquityOctreeNode::getVolume() const
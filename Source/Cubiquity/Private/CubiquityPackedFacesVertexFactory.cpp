@@ -0,0 +1,97 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityPackedFacesVertexFactory.h"
+
+namespace
+{
+	/** The one vertex the packed faces vertex factory's declaration is bound to, with a stride of zero */
+	class FCubiquityZeroVertexBuffer : public FVertexBuffer
+	{
+	public:
+		virtual void InitRHI() override
+		{
+			FRHIResourceCreateInfo CreateInfo;
+			VertexBufferRHI = RHICreateVertexBuffer(sizeof(FVector4), BUF_Static | BUF_ZeroStride, CreateInfo);
+
+			void* VertexBufferData = RHILockVertexBuffer(VertexBufferRHI, 0, sizeof(FVector4), RLM_WriteOnly);
+			FMemory::Memzero(VertexBufferData, sizeof(FVector4));
+			RHIUnlockVertexBuffer(VertexBufferRHI);
+		}
+	};
+
+	TGlobalResource<FCubiquityZeroVertexBuffer> GCubiquityZeroVertexBuffer;
+}
+
+void FCubiquityPackedFacesVertexFactoryShaderParameters::Bind(const FShaderParameterMap& ParameterMap)
+{
+	PackedFacesParameter.Bind(ParameterMap, TEXT("PackedFaces"));
+	FacePaletteParameter.Bind(ParameterMap, TEXT("FacePalette"));
+}
+
+void FCubiquityPackedFacesVertexFactoryShaderParameters::Serialize(FArchive& Ar)
+{
+	Ar << PackedFacesParameter;
+	Ar << FacePaletteParameter;
+}
+
+void FCubiquityPackedFacesVertexFactoryShaderParameters::SetMesh(FRHICommandList& RHICmdList, FShader* Shader, const FVertexFactory* VertexFactory, const FSceneView& View, const FMeshBatchElement& BatchElement, uint32 DataFlags) const
+{
+	const FCubiquityPackedFacesVertexFactory* PackedFacesVertexFactory = static_cast<const FCubiquityPackedFacesVertexFactory*>(VertexFactory);
+	const FVertexShaderRHIParamRef VertexShader = Shader->GetVertexShader();
+
+	if (PackedFacesParameter.IsBound())
+	{
+		RHICmdList.SetShaderResourceViewParameter(VertexShader, PackedFacesParameter.GetBaseIndex(), PackedFacesVertexFactory->PackedFaces->ShaderResourceView);
+	}
+	if (FacePaletteParameter.IsBound())
+	{
+		RHICmdList.SetShaderResourceViewParameter(VertexShader, FacePaletteParameter.GetBaseIndex(), PackedFacesVertexFactory->FacePalette->ShaderResourceView);
+	}
+}
+
+void FCubiquityPackedFacesVertexFactory::Init(const FCubiquityPackedFaceBuffer* InPackedFaces, const FCubiquityFacePaletteBuffer* InFacePalette)
+{
+	check(!IsInRenderingThread());
+
+	ENQUEUE_UNIQUE_RENDER_COMMAND_THREEPARAMETER(
+		InitPackedFacesVertexFactory,
+		FCubiquityPackedFacesVertexFactory*, VertexFactory, this,
+		const FCubiquityPackedFaceBuffer*, PackedFaces, InPackedFaces,
+		const FCubiquityFacePaletteBuffer*, FacePalette, InFacePalette,
+		{
+		VertexFactory->PackedFaces = PackedFaces;
+		VertexFactory->FacePalette = FacePalette;
+		});
+}
+
+void FCubiquityPackedFacesVertexFactory::InitRHI()
+{
+	Data.DummyComponent = FVertexStreamComponent(&GCubiquityZeroVertexBuffer, 0, 0, VET_Float4);
+
+	FVertexDeclarationElementList Elements;
+	Elements.Add(AccessStreamComponent(Data.DummyComponent, 0));
+
+	InitDeclaration(Elements, Data);
+
+	check(IsValidRef(GetDeclaration()));
+}
+
+FCubiquityPackedFacesVertexFactoryShaderParameters* FCubiquityPackedFacesVertexFactory::ConstructShaderParameters(EShaderFrequency ShaderFrequency)
+{
+	if (ShaderFrequency == SF_Vertex)
+	{
+		return new FCubiquityPackedFacesVertexFactoryShaderParameters();
+	}
+
+	return nullptr;
+}
+
+bool FCubiquityPackedFacesVertexFactory::ShouldCache(EShaderPlatform Platform, const class FMaterial* Material, const class FShaderType* ShaderType)
+{
+	return IsFeatureLevelSupported(Platform, ERHIFeatureLevel::SM4);
+}
+
+//The string here refers to the file "CubiquityPackedFacesVertexFactory.usf". It ships in the plugin's Shaders/ and has to be copied to Engine/Shaders.
+IMPLEMENT_VERTEX_FACTORY_TYPE(FCubiquityPackedFacesVertexFactory, "CubiquityPackedFacesVertexFactory", true, false, true, false, false);
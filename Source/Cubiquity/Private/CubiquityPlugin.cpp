@@ -4,3 +4,96 @@
 IMPLEMENT_MODULE(ICubiquityPlugin, Cubiquity)
 
 DEFINE_LOG_CATEGORY(CubiquityLog);
+
+DEFINE_STAT(STAT_CubiquityVolumeUpdate);
+DEFINE_STAT(STAT_CubiquityOctreeTraversal);
+DEFINE_STAT(STAT_CubiquityNodesVisited);
+DEFINE_STAT(STAT_CubiquityNodesSynced);
+DEFINE_STAT(STAT_CubiquityNodeActorsSpawned);
+DEFINE_STAT(STAT_CubiquityNodeActorsDestroyed);
+
+DEFINE_STAT(STAT_CubiquityMeshConversion);
+DEFINE_STAT(STAT_CubiquityVerticesConverted);
+DEFINE_STAT(STAT_CubiquityIndicesConverted);
+
+DEFINE_STAT(STAT_CubiquityCollisionCook);
+
+DEFINE_STAT(STAT_CubiquityProxyCreation);
+DEFINE_STAT(STAT_CubiquityProxiesCreated);
+DEFINE_STAT(STAT_CubiquityTerrainProxyDraw);
+DEFINE_STAT(STAT_CubiquityColoredCubesProxyDraw);
+
+DEFINE_STAT(STAT_CubiquityMeshCpuMemory);
+DEFINE_STAT(STAT_CubiquityMeshGpuMemory);
+
+DEFINE_STAT(STAT_CubiquityBufferAllocations);
+DEFINE_STAT(STAT_CubiquityBufferReuses);
+DEFINE_STAT(STAT_CubiquityPooledBufferMemory);
+
+DEFINE_STAT(STAT_CubiquityGreedyMeshing);
+DEFINE_STAT(STAT_CubiquityGreedyTrianglesIn);
+DEFINE_STAT(STAT_CubiquityGreedyTrianglesOut);
+
+DEFINE_STAT(STAT_CubiquityMeshOptimisation);
+DEFINE_STAT(STAT_CubiquityOptimisedTriangles);
+DEFINE_STAT(STAT_CubiquityVertexCacheMissesBefore);
+DEFINE_STAT(STAT_CubiquityVertexCacheMissesAfter);
+
+DEFINE_STAT(STAT_CubiquityMeshCacheHits);
+
+DEFINE_STAT(STAT_CubiquityMeshDiskCacheRead);
+DEFINE_STAT(STAT_CubiquityMeshDiskCacheWrite);
+DEFINE_STAT(STAT_CubiquityMeshDiskCacheHits);
+DEFINE_STAT(STAT_CubiquityMeshDiskCacheMisses);
+DEFINE_STAT(STAT_CubiquityMeshDiskCacheEvictions);
+
+DEFINE_STAT(STAT_CubiquityBakedMeshRead);
+DEFINE_STAT(STAT_CubiquityBakedMeshHits);
+
+DEFINE_STAT(STAT_CubiquityMeshBudgetUpdate);
+DEFINE_STAT(STAT_CubiquityMeshBudget);
+DEFINE_STAT(STAT_CubiquityMeshMemoryUsed);
+DEFINE_STAT(STAT_CubiquityEvictedNodes);
+DEFINE_STAT(STAT_CubiquityNodeEvictions);
+DEFINE_STAT(STAT_CubiquityNodeRestores);
+DEFINE_STAT(STAT_CubiquityLodThresholdScale);
+
+DEFINE_STAT(STAT_CubiquityLastCommitSeconds);
+DEFINE_STAT(STAT_CubiquityCommitsQueued);
+DEFINE_STAT(STAT_CubiquityCommittedBytes);
+
+DEFINE_STAT(STAT_CubiquityCheckpointSave);
+DEFINE_STAT(STAT_CubiquityCheckpointRestore);
+DEFINE_STAT(STAT_CubiquityCheckpointChunksSaved);
+DEFINE_STAT(STAT_CubiquityCheckpointChunksRestored);
+DEFINE_STAT(STAT_CubiquityCheckpointMemory);
+
+DEFINE_STAT(STAT_CubiquityEditOpsSent);
+DEFINE_STAT(STAT_CubiquityEditBytesSent);
+DEFINE_STAT(STAT_CubiquityEditBytesReceived);
+
+DEFINE_STAT(STAT_CubiquityJoinSyncBytesSent);
+DEFINE_STAT(STAT_CubiquityJoinSyncBytesReceived);
+
+DEFINE_STAT(STAT_CubiquitySaveEdits);
+DEFINE_STAT(STAT_CubiquityLoadEdits);
+
+DEFINE_STAT(STAT_CubiquityBrushesMerged);
+DEFINE_STAT(STAT_CubiquityRemeshesAvoided);
+
+DEFINE_STAT(STAT_CubiquityBrushRead);
+DEFINE_STAT(STAT_CubiquityBrushCompute);
+DEFINE_STAT(STAT_CubiquityBrushWrite);
+DEFINE_STAT(STAT_CubiquityBrushVoxelsProcessed);
+DEFINE_STAT(STAT_CubiquityBrushVoxelsWritten);
+
+DEFINE_STAT(STAT_CubiquityExplosion);
+DEFINE_STAT(STAT_CubiquityIslandsDetached);
+
+DEFINE_STAT(STAT_CubiquityEditLatency);
+DEFINE_STAT(STAT_CubiquityFastLaneSyncs);
+DEFINE_STAT(STAT_CubiquityCoarseNodesDeferred);
+
+DEFINE_STAT(STAT_CubiquityLodFlips);
+DEFINE_STAT(STAT_CubiquityLodFlipsPerSecond);
+DEFINE_STAT(STAT_CubiquityLodChangesHeld);
@@ -5,3 +5,5 @@
 // You should place include statements to your module's private header files here. You only need to
 // add includes for headers that are used in most of your module's source files though.
 #include "ICubiquityPlugin.h"
+#include "CubiquityStats.h"
+#include "CubiquityTrace.h"
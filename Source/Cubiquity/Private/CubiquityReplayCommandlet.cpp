@@ -0,0 +1,111 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityReplayCommandlet.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "CubiquitySessionReplay.h"
+
+UCubiquityReplayCommandlet::UCubiquityReplayCommandlet(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	LogToConsole = true;
+}
+
+int32 UCubiquityReplayCommandlet::Main(const FString& Params)
+{
+	if (!FCubiquityCommandletSwitches::validate(Params, { TEXT("Recording="), TEXT("Volume="), TEXT("Output="), TEXT("SyncsPerFrame="), TEXT("BaseNodeSize="), TEXT("LodHysteresisBand="), TEXT("MinimumNodeLifetime=") },
+		TEXT("Usage: -run=CubiquityReplay -Recording=Path/To.cqrec [-Volume=Path/To.vdb] [-SyncsPerFrame=1] [-BaseNodeSize=32] [-LodHysteresisBand=0] [-MinimumNodeLifetime=0] [-Output=Path/To.json]")))
+	{
+		return 1;
+	}
+
+	FString recordingFileName;
+	FString volumeFileName;
+	FString outputFileName = FPaths::ProfilingDir() / TEXT("Cubiquity") / FString::Printf(TEXT("Replay-%s.json"), *FDateTime::Now().ToString());
+	int32 syncsPerFrame = 1;
+	int32 baseNodeSize = 0;
+	float lodHysteresisBand = 0.0f;
+	float minimumNodeLifetime = 0.0f;
+
+	FParse::Value(*Params, TEXT("Recording="), recordingFileName);
+	FParse::Value(*Params, TEXT("Volume="), volumeFileName);
+	FParse::Value(*Params, TEXT("Output="), outputFileName);
+	FParse::Value(*Params, TEXT("SyncsPerFrame="), syncsPerFrame);
+	FParse::Value(*Params, TEXT("BaseNodeSize="), baseNodeSize);
+	FParse::Value(*Params, TEXT("LodHysteresisBand="), lodHysteresisBand);
+	FParse::Value(*Params, TEXT("MinimumNodeLifetime="), minimumNodeLifetime);
+	syncsPerFrame = FMath::Max(syncsPerFrame, 1);
+
+	FCubiquitySessionRecording recording;
+	if (recordingFileName.IsEmpty() || !recording.load(recordingFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Couldn't read a recording from '%s'. Use -Recording=Path/To.cqrec"), *recordingFileName);
+		return 1;
+	}
+
+	if (volumeFileName.IsEmpty())
+	{
+		volumeFileName = recording.volumeFileName();
+	}
+	if (!FPaths::FileExists(volumeFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Volume %s does not exist. Use -Volume= to say where it is now"), *volumeFileName);
+		return 1;
+	}
+
+	const uint32 nodeSize = baseNodeSize > 0 ? FMath::RoundUpToPowerOfTwo(baseNodeSize) : recording.baseNodeSize();
+
+	FCubiquityReplayResult result;
+	if (!FCubiquitySessionReplay::run(recording, volumeFileName, nodeSize, syncsPerFrame, result, lodHysteresisBand, minimumNodeLifetime))
+	{
+		return 1;
+	}
+
+	//The same path without any hysteresis, to show what it saved
+	FString comparisonJson;
+	if (lodHysteresisBand > 0.0f || minimumNodeLifetime > 0.0f)
+	{
+		FCubiquityReplayResult baseline;
+		if (!FCubiquitySessionReplay::run(recording, volumeFileName, nodeSize, syncsPerFrame, baseline))
+		{
+			return 1;
+		}
+
+		const float baselineFlips = baseline.lodFlipsPerSecond();
+		comparisonJson = FString::Printf(TEXT("\"lod_without_hysteresis\":{\"flips\":%d,\"flips_per_second\":%.2f,\"flip_reduction\":%.3f,\"frame_time_p99_ms\":%.4f},\n"),
+			baseline.lodFlips, baselineFlips, baselineFlips > 0.0f ? 1.0f - result.lodFlipsPerSecond() / baselineFlips : 0.0f, baseline.frameTimes.percentile(0.99));
+	}
+
+	const FCubiquityConversionSettings& settings = recording.conversionSettings();
+	const FPlatformMemoryStats memory = FPlatformMemory::GetStats();
+
+	FString json = TEXT("{\n");
+	json += FString::Printf(TEXT("\"config\":{\"recording\":\"%s\",\"volume\":\"%s\",\"type\":\"%s\",\"base_node_size\":%u,\"syncs_per_frame\":%d,\"greedy\":%s,\"compact\":%s},\n"),
+		*recordingFileName.Replace(TEXT("\\"), TEXT("/")), *volumeFileName.Replace(TEXT("\\"), TEXT("/")),
+		settings.volumeType == Cubiquity::VolumeType::Terrain ? TEXT("Terrain") : TEXT("ColoredCubes"), nodeSize, syncsPerFrame,
+		settings.greedyMeshing ? TEXT("true") : TEXT("false"), settings.compactFaceStorage ? TEXT("true") : TEXT("false"));
+	json += FString::Printf(TEXT("\"peak_process_bytes\":%llu,\n"), static_cast<uint64>(memory.PeakUsedPhysical));
+	json += comparisonJson;
+	json += result.toJsonFields();
+	json += TEXT("}\n");
+
+	UE_LOG(CubiquityLog, Display, TEXT("%s"), *json);
+
+	if (!FFileHelper::SaveStringToFile(json, *outputFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to write %s"), *outputFileName);
+		return 1;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("Wrote replay results to %s"), *outputFileName);
+
+	//The results are still written, but the latencies leave out whatever never synced so a script shouldn't take them as good
+	if (!result.settled)
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("The replay was cut off before the volume caught up with the recording"));
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,250 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquitySaveEditsCommandlet.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "CubiquityEditSave.h"
+
+#include <memory>
+
+namespace
+{
+	const int32 BaseNodeSize = 32;
+
+	//Two chunks deep, with the surface between them
+	const int32 HeightInChunks = 2;
+
+	std::unique_ptr<Cubiquity::Volume> openVolume(bool terrain, const FString& fileName)
+	{
+		if (terrain)
+		{
+			return std::make_unique<Cubiquity::TerrainVolume>(TCHAR_TO_ANSI(*fileName), Cubiquity::WritePermissions::ReadWrite, BaseNodeSize);
+		}
+		return std::make_unique<Cubiquity::ColoredCubesVolume>(TCHAR_TO_ANSI(*fileName), Cubiquity::WritePermissions::ReadWrite, BaseNodeSize);
+	}
+
+	void generate(bool terrain, const FString& fileName, int32 width, int32 height)
+	{
+		if (terrain)
+		{
+			Cubiquity::TerrainVolume volume({ 0, 0, 0 }, { width - 1, width - 1, height - 1 }, TCHAR_TO_ANSI(*fileName), BaseNodeSize);
+			volume.generateFloor(height / 3, 0, height / 2, 1);
+			volume.acceptOverrideChunks();
+			return;
+		}
+
+		//Rolling hills in bands of colour, as the benchmark commandlet makes
+		Cubiquity::ColoredCubesVolume volume({ 0, 0, 0 }, { width - 1, width - 1, height - 1 }, TCHAR_TO_ANSI(*fileName), BaseNodeSize);
+		for (int32 y = 0; y < width; ++y)
+		{
+			for (int32 x = 0; x < width; ++x)
+			{
+				const int32 surface = FMath::Clamp(FMath::RoundToInt(height * (0.5f + 0.25f * FMath::Sin(x * 0.1f) * FMath::Cos(y * 0.13f))), 1, height - 1);
+				for (int32 z = 0; z < surface; ++z)
+				{
+					const uint8 band = uint8(64 + (z * 191) / height);
+					volume.setVoxel({ x, y, z }, Cubiquity::Color(band, uint8(255 - band), 96, 255));
+				}
+			}
+		}
+		volume.acceptOverrideChunks();
+	}
+
+	//A dig, a build or, on terrain, a splash of paint somewhere in the chunk
+	void stroke(Cubiquity::Volume& volume, const FIntVector& chunk, FRandomStream& random, TSet<FIntVector>& editedChunks)
+	{
+		const FVector lower = FVector(chunk.X, chunk.Y, chunk.Z) * FCubiquityVoxelChunk::Size;
+		const FVector position = lower + FVector(random.FRandRange(0.0f, FCubiquityVoxelChunk::Size), random.FRandRange(0.0f, FCubiquityVoxelChunk::Size), random.FRandRange(0.0f, FCubiquityVoxelChunk::Size));
+		const float radius = random.FRandRange(2.0f, 6.0f);
+
+		if (volume.volumeType() == Cubiquity::VolumeType::Terrain)
+		{
+			Cubiquity::TerrainVolume& terrain = static_cast<Cubiquity::TerrainVolume&>(volume);
+			if (random.FRand() < 0.25f)
+			{
+				terrain.paint({ position.X, position.Y, position.Z }, radius * 0.5f, radius, 1.0f, random.RandRange(0, 3));
+			}
+			else
+			{
+				terrain.sculpt({ position.X, position.Y, position.Z }, radius * 0.5f, radius, random.FRand() < 0.5f ? 1.0f : -1.0f);
+			}
+		}
+		else
+		{
+			Cubiquity::ColoredCubesVolume& coloredCubes = static_cast<Cubiquity::ColoredCubesVolume&>(volume);
+			const bool solid = random.FRand() < 0.5f;
+			const Cubiquity::Color color(uint8(random.RandRange(0, 255)), uint8(random.RandRange(0, 255)), uint8(random.RandRange(0, 255)), solid ? 255 : 0);
+			const int32 extent = FMath::CeilToInt(radius);
+			const auto region = volume.enclosingRegion();
+			for (int32 z = -extent; z <= extent; ++z)
+			{
+				for (int32 y = -extent; y <= extent; ++y)
+				{
+					for (int32 x = -extent; x <= extent; ++x)
+					{
+						const FIntVector voxel(FMath::RoundToInt(position.X) + x, FMath::RoundToInt(position.Y) + y, FMath::RoundToInt(position.Z) + z);
+						if (x * x + y * y + z * z <= radius * radius
+							&& voxel.X >= region.first.x && voxel.Y >= region.first.y && voxel.Z >= region.first.z
+							&& voxel.X <= region.second.x && voxel.Y <= region.second.y && voxel.Z <= region.second.z)
+						{
+							coloredCubes.setVoxel({ voxel.X, voxel.Y, voxel.Z }, color);
+						}
+					}
+				}
+			}
+		}
+
+		TArray<FIntVector> touched;
+		FCubiquityVoxelChunk::chunksAround(position, radius + 1.0f, touched);
+		editedChunks.Append(touched);
+	}
+}
+
+UCubiquitySaveEditsCommandlet::UCubiquitySaveEditsCommandlet(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	LogToConsole = true;
+}
+
+int32 UCubiquitySaveEditsCommandlet::Main(const FString& Params)
+{
+	if (!FCubiquityCommandletSwitches::validate(Params, { TEXT("Type="), TEXT("Output="), TEXT("Megabytes="), TEXT("StrokesPerChunk="), TEXT("Seed=") },
+		TEXT("Usage: -run=CubiquitySaveEdits [-Type=ColoredCubes|Terrain] [-Megabytes=100] [-StrokesPerChunk=4] [-Seed=0] [-Output=Path/To.json]")))
+	{
+		return 1;
+	}
+
+	FString typeName = TEXT("ColoredCubes");
+	FString outputFileName = FPaths::ProfilingDir() / TEXT("Cubiquity") / FString::Printf(TEXT("SaveEdits-%s.json"), *FDateTime::Now().ToString());
+	float megabytes = 100.0f;
+	int32 strokesPerChunk = 4;
+	int32 seed = 0;
+
+	FParse::Value(*Params, TEXT("Type="), typeName);
+	FParse::Value(*Params, TEXT("Output="), outputFileName);
+	FParse::Value(*Params, TEXT("Megabytes="), megabytes);
+	FParse::Value(*Params, TEXT("StrokesPerChunk="), strokesPerChunk);
+	FParse::Value(*Params, TEXT("Seed="), seed);
+	strokesPerChunk = FMath::Max(strokesPerChunk, 1);
+
+	if (typeName != TEXT("ColoredCubes") && typeName != TEXT("Terrain"))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Unknown volume type %s. Use ColoredCubes or Terrain"), *typeName);
+		return 1;
+	}
+	const bool terrain = typeName == TEXT("Terrain");
+
+	//Wide enough that the edited chunks fit with some to spare around them
+	const int64 chunkBytes = int64(FCubiquityVoxelChunk::bytesPerVoxel(terrain ? Cubiquity::VolumeType::Terrain : Cubiquity::VolumeType::ColoredCubes))
+		* FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size;
+	const int64 targetBytes = int64(FMath::Max(megabytes, 0.1f) * 1024.0f * 1024.0f);
+	const int32 targetChunks = int32((targetBytes + chunkBytes - 1) / chunkBytes);
+	const int32 widthInChunks = FMath::CeilToInt(FMath::Sqrt(float(targetChunks) / HeightInChunks)) + 1;
+
+	const FString directory = FPaths::GameSavedDir() / TEXT("Cubiquity");
+	const FString baseFileName = FPaths::CreateTempFilename(*directory, TEXT("SaveEditsBase"), TEXT(".vdb"));
+	const FString editedFileName = FPaths::CreateTempFilename(*directory, TEXT("SaveEditsEdited"), TEXT(".vdb"));
+	const FString loadedFileName = FPaths::CreateTempFilename(*directory, TEXT("SaveEditsLoaded"), TEXT(".vdb"));
+
+	const double generationStart = FPlatformTime::Seconds();
+	generate(terrain, baseFileName, widthInChunks * FCubiquityVoxelChunk::Size, HeightInChunks * FCubiquityVoxelChunk::Size);
+	if (IFileManager::Get().Copy(*editedFileName, *baseFileName) != COPY_OK || IFileManager::Get().Copy(*loadedFileName, *baseFileName) != COPY_OK)
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to copy %s"), *baseFileName);
+		return 1;
+	}
+	const double generationSeconds = FPlatformTime::Seconds() - generationStart;
+
+	//Stroke the chunks along the surface, row by row, until enough have been touched
+	std::unique_ptr<Cubiquity::Volume> edited = openVolume(terrain, editedFileName);
+	FRandomStream random(seed);
+	TSet<FIntVector> editedChunks;
+	int32 strokes = 0;
+	const double editStart = FPlatformTime::Seconds();
+	for (int32 z = 0; z < HeightInChunks && editedChunks.Num() < targetChunks; ++z)
+	{
+		for (int32 y = 0; y < widthInChunks && editedChunks.Num() < targetChunks; ++y)
+		{
+			for (int32 x = 0; x < widthInChunks && editedChunks.Num() < targetChunks; ++x)
+			{
+				for (int32 i = 0; i < strokesPerChunk; ++i)
+				{
+					stroke(*edited, FIntVector(x, y, z), random, editedChunks);
+					++strokes;
+				}
+			}
+		}
+	}
+	const double editSeconds = FPlatformTime::Seconds() - editStart;
+
+	TArray<uint8> blob;
+	const double saveStart = FPlatformTime::Seconds();
+	FMemoryWriter writer(blob, true);
+	const bool saved = FCubiquityEditSave::save(*edited, editedChunks, writer);
+	const double saveSeconds = FPlatformTime::Seconds() - saveStart;
+
+	std::unique_ptr<Cubiquity::Volume> loaded = openVolume(terrain, loadedFileName);
+	TArray<FIntVector> loadedChunks;
+	const double loadStart = FPlatformTime::Seconds();
+	FMemoryReader reader(blob, true);
+	const bool loadedOk = saved && FCubiquityEditSave::load(*loaded, reader, loadedChunks);
+	const double loadSeconds = FPlatformTime::Seconds() - loadStart;
+
+	//Every chunk in the volume the edits were loaded into should now match the edited one
+	int64 editBytes = 0;
+	int32 mismatchedChunks = 0;
+	TArray<uint8> editedVoxels;
+	TArray<uint8> loadedVoxels;
+	for (const FIntVector& chunk : editedChunks)
+	{
+		FCubiquityVoxelChunk::read(*edited, chunk, editedVoxels);
+		FCubiquityVoxelChunk::read(*loaded, chunk, loadedVoxels);
+		editBytes += editedVoxels.Num();
+		if (editedVoxels != loadedVoxels)
+		{
+			++mismatchedChunks;
+		}
+	}
+	const bool identical = saved && loadedOk && mismatchedChunks == 0;
+	if (!identical)
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("The loaded edits don't match: saved %s, loaded %s, %d of %d chunks differ"),
+			saved ? TEXT("ok") : TEXT("failed"), loadedOk ? TEXT("ok") : TEXT("failed"), mismatchedChunks, editedChunks.Num());
+	}
+
+	//What saving by committing the same edits costs instead
+	const double commitStart = FPlatformTime::Seconds();
+	edited->acceptOverrideChunks();
+	const double commitSeconds = FPlatformTime::Seconds() - commitStart;
+
+	edited.reset();
+	loaded.reset();
+	IFileManager::Get().Delete(*baseFileName, false, false, true);
+	IFileManager::Get().Delete(*editedFileName, false, false, true);
+	IFileManager::Get().Delete(*loadedFileName, false, false, true);
+
+	const double editMegabytes = editBytes / (1024.0 * 1024.0);
+	FString json = TEXT("{\n");
+	json += FString::Printf(TEXT("\"config\":{\"type\":\"%s\",\"megabytes\":%.1f,\"strokes_per_chunk\":%d,\"seed\":%d},\n"), *typeName, megabytes, strokesPerChunk, seed);
+	json += FString::Printf(TEXT("\"identical\":%s,\n\"mismatched_chunks\":%d,\n"), identical ? TEXT("true") : TEXT("false"), mismatchedChunks);
+	json += FString::Printf(TEXT("\"generation_seconds\":%.3f,\n\"edit_seconds\":%.3f,\n\"strokes\":%d,\n"), generationSeconds, editSeconds, strokes);
+	json += FString::Printf(TEXT("\"edited_chunks\":%d,\n\"edit_megabytes\":%.2f,\n\"blob_bytes\":%d,\n\"compression_ratio\":%.1f,\n"),
+		editedChunks.Num(), editMegabytes, blob.Num(), blob.Num() > 0 ? double(editBytes) / blob.Num() : 0.0);
+	json += FString::Printf(TEXT("\"save_seconds\":%.3f,\n\"load_seconds\":%.3f,\n\"commit_seconds\":%.3f,\n"), saveSeconds, loadSeconds, commitSeconds);
+	json += FString::Printf(TEXT("\"save_megabytes_per_second\":%.1f,\n\"load_megabytes_per_second\":%.1f\n"),
+		saveSeconds > 0.0 ? editMegabytes / saveSeconds : 0.0, loadSeconds > 0.0 ? editMegabytes / loadSeconds : 0.0);
+	json += TEXT("}\n");
+
+	UE_LOG(CubiquityLog, Display, TEXT("%s"), *json);
+
+	if (!FFileHelper::SaveStringToFile(json, *outputFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to write %s"), *outputFileName);
+		return 1;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("Wrote save edits results to %s"), *outputFileName);
+	return identical ? 0 : 1;
+}
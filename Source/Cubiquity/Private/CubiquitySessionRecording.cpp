@@ -0,0 +1,238 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquitySessionRecording.h"
+
+#include "CubiquityVolume.h"
+#include "CubiquityExplosion.h"
+#include "CubiquityBrushEngine.h"
+
+namespace
+{
+	const uint32 RecordingMagic = 0x53525143; //'CQRS'
+	const uint32 RecordingVersion = 7; //4 to 7 have the same layout as 3 but older builds can't replay BlurTerrain, Explosion, WriteChunk and BrushKernel
+
+	void recordCommand(const TArray<FString>& args)
+	{
+		const bool start = args.Num() >= 1 && args[0] == TEXT("Start");
+		const bool stop = args.Num() >= 1 && args[0] == TEXT("Stop");
+		if (!start && !stop)
+		{
+			UE_LOG(CubiquityLog, Display, TEXT("Usage: cubiquity.Record Start|Stop [File]"));
+			return;
+		}
+
+		int32 volumes = 0;
+		for (TObjectIterator<ACubiquityVolume> volume; volume; ++volume)
+		{
+			if (volume->IsTemplate() || !volume->GetWorld() || !volume->GetWorld()->IsGameWorld())
+			{
+				continue;
+			}
+
+			if (start)
+			{
+				volume->startRecording();
+			}
+			else
+			{
+				//With more than one volume a given file name gets the volume name added so they don't overwrite each other
+				FString fileName = args.Num() >= 2 ? args[1] : FString();
+				if (!fileName.IsEmpty() && volumes > 0)
+				{
+					fileName = FPaths::GetPath(fileName) / FPaths::GetBaseFilename(fileName) + TEXT("-") + volume->GetName() + TEXT(".") + FPaths::GetExtension(fileName);
+				}
+				volume->stopRecording(fileName);
+			}
+			++volumes;
+		}
+
+		if (volumes == 0)
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("There are no Cubiquity volumes in play to record"));
+		}
+	}
+
+	FAutoConsoleCommand recordConsoleCommand(
+		TEXT("cubiquity.Record"),
+		TEXT("Record the camera path and edits of every Cubiquity volume for the CubiquityReplay commandlet. 'Start' begins recording and 'Stop [File]' writes it out."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&recordCommand));
+}
+
+void FCubiquityRecordedEvent::applyTo(Cubiquity::Volume& volume) const
+{
+	const Cubiquity::Vector<int32_t> voxel = { int32_t(position.X), int32_t(position.Y), int32_t(position.Z) };
+
+	switch (op)
+	{
+	case ECubiquityRecordedOp::SetColoredCubesVoxel:
+	{
+		const FColor color(static_cast<uint32>(value));
+		static_cast<Cubiquity::ColoredCubesVolume&>(volume).setVoxel(voxel, { color.R, color.G, color.B, color.A });
+		break;
+	}
+	case ECubiquityRecordedOp::SetTerrainVoxel:
+		static_cast<Cubiquity::TerrainVolume&>(volume).setVoxel(voxel, Cubiquity::MaterialSet(value));
+		break;
+	case ECubiquityRecordedOp::SculptTerrain:
+		static_cast<Cubiquity::TerrainVolume&>(volume).sculpt({ position.X, position.Y, position.Z }, innerRadius, outerRadius, opacity);
+		break;
+	case ECubiquityRecordedOp::PaintTerrain:
+		static_cast<Cubiquity::TerrainVolume&>(volume).paint({ position.X, position.Y, position.Z }, innerRadius, outerRadius, opacity, static_cast<uint32_t>(value));
+		break;
+	case ECubiquityRecordedOp::BlurTerrain:
+		static_cast<Cubiquity::TerrainVolume&>(volume).blur({ position.X, position.Y, position.Z }, innerRadius, outerRadius, opacity);
+		break;
+	case ECubiquityRecordedOp::Explosion:
+		FCubiquityExplosion::apply(volume, position, innerRadius, outerRadius - innerRadius, opacity, static_cast<int32>(value), nullptr);
+		break;
+	case ECubiquityRecordedOp::FillColoredCubesRegion:
+	case ECubiquityRecordedOp::FillTerrainRegion:
+	{
+		const FIntVector lower(FMath::RoundToInt(position.X - extent.X), FMath::RoundToInt(position.Y - extent.Y), FMath::RoundToInt(position.Z - extent.Z));
+		const FIntVector upper(FMath::RoundToInt(position.X + extent.X), FMath::RoundToInt(position.Y + extent.Y), FMath::RoundToInt(position.Z + extent.Z));
+		const FColor color(static_cast<uint32>(value));
+		for (int32 z = lower.Z; z <= upper.Z; ++z)
+		{
+			for (int32 y = lower.Y; y <= upper.Y; ++y)
+			{
+				for (int32 x = lower.X; x <= upper.X; ++x)
+				{
+					if (op == ECubiquityRecordedOp::FillTerrainRegion)
+					{
+						static_cast<Cubiquity::TerrainVolume&>(volume).setVoxel({ x, y, z }, Cubiquity::MaterialSet(value));
+					}
+					else
+					{
+						static_cast<Cubiquity::ColoredCubesVolume&>(volume).setVoxel({ x, y, z }, { color.R, color.G, color.B, color.A });
+					}
+				}
+			}
+		}
+		break;
+	}
+	case ECubiquityRecordedOp::WriteChunk:
+	{
+		TArray<uint8> voxels;
+		if (FCubiquityVoxelChunk::uncompress(payload, static_cast<int32>(value), voxels))
+		{
+			FCubiquityVoxelChunk::write(volume, FCubiquityVoxelChunk::containing(position), voxels);
+		}
+		else
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Failed to decompress the voxel chunk at %s"), *position.ToString());
+		}
+		break;
+	}
+	case ECubiquityRecordedOp::BrushKernel:
+	{
+		FCubiquityBrush brush;
+		if (FCubiquityBrushEngine::load(payload, brush))
+		{
+			FCubiquityBrushEngine::apply(volume, position, brush);
+		}
+		else
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("Failed to read the brush at %s"), *position.ToString());
+		}
+		break;
+	}
+	case ECubiquityRecordedOp::CommitChanges:
+		volume.acceptOverrideChunks();
+		break;
+	case ECubiquityRecordedOp::DiscardChanges:
+		volume.discardOverrideChunks();
+		break;
+	case ECubiquityRecordedOp::Camera:
+		break;
+	}
+}
+
+void FCubiquitySessionRecording::start(const FString& inVolumeFileName, uint32 inBaseNodeSize, const FCubiquityConversionSettings& inSettings)
+{
+	recordedVolumeFileName = inVolumeFileName;
+	recordedBaseNodeSize = inBaseNodeSize;
+	settings = inSettings;
+	recordedEvents.Reset();
+	started = FPlatformTime::Seconds();
+}
+
+void FCubiquitySessionRecording::record(FCubiquityRecordedEvent event)
+{
+	event.time = static_cast<float>(FPlatformTime::Seconds() - started);
+	recordedEvents.Add(event);
+}
+
+bool FCubiquitySessionRecording::save(const FString& path) const
+{
+	TArray<uint8> bytes;
+	FMemoryWriter writer(bytes);
+
+	uint32 magic = RecordingMagic;
+	uint32 version = RecordingVersion;
+	FString fileName = recordedVolumeFileName;
+	uint32 nodeSize = recordedBaseNodeSize;
+	uint32 flags = settings.flags();
+	writer << magic << version << fileName << nodeSize << flags;
+	writer << const_cast<TArray<FCubiquityRecordedEvent>&>(recordedEvents);
+
+	return FFileHelper::SaveArrayToFile(bytes, *path);
+}
+
+bool FCubiquitySessionRecording::load(const FString& path)
+{
+	TArray<uint8> bytes;
+	if (!FFileHelper::LoadFileToArray(bytes, *path, FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader reader(bytes);
+
+	uint32 magic = 0;
+	uint32 version = 0;
+	reader << magic << version;
+	if (magic != RecordingMagic || version < 1 || version > RecordingVersion)
+	{
+		return false;
+	}
+
+	//Version 1 recordings were all made with the node size that used to be hard-coded
+	uint32 flags = 0;
+	recordedBaseNodeSize = 32;
+	reader << recordedVolumeFileName;
+	if (version >= 2)
+	{
+		reader << recordedBaseNodeSize;
+	}
+	reader << flags;
+	if (version >= 3)
+	{
+		reader << recordedEvents;
+	}
+	else
+	{
+		//Events didn't have an extent until the Fill events were added
+		int32 numEvents = 0;
+		reader << numEvents;
+		recordedEvents.Reset();
+		for (int32 i = 0; i < numEvents && !reader.IsError(); ++i)
+		{
+			recordedEvents[recordedEvents.AddDefaulted()].serialize(reader, false);
+		}
+	}
+	if (reader.IsError())
+	{
+		recordedEvents.Reset();
+		return false;
+	}
+
+	//The inverse of FCubiquityConversionSettings::flags()
+	settings.volumeType = static_cast<Cubiquity::VolumeType>(flags & 0xFF);
+	settings.optimiseMeshes = (flags & (1 << 8)) != 0;
+	settings.greedyMeshing = (flags & (1 << 9)) != 0;
+	settings.compactFaceStorage = (flags & (1 << 10)) != 0;
+
+	return true;
+}
@@ -0,0 +1,159 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquitySessionReplay.h"
+
+#include "Cubiquity.hpp"
+
+#include <memory>
+
+namespace
+{
+	//How many frames to carry on for after the recording ends while waiting for everything to sync
+	const int32 MaximumSettleFrames = 100000;
+
+	//The clock runs on by this much each settle frame, as if at 60 frames a second
+	const double SettleFrameSeconds = 1.0 / 60.0;
+
+	//An edit which hasn't been fully synced yet
+	struct FPendingEdit
+	{
+		double appliedSeconds;
+		int32 appliedFrame;
+	};
+}
+
+FString FCubiquityReplayResult::toJsonFields()
+{
+	FString json;
+	json += FString::Printf(TEXT("\"recorded_frames\":%d,\n\"settle_frames\":%d,\n\"edits\":%d,\n\"settled\":%s,\n\"run_seconds\":%.3f,\n"),
+		recordedFrames, settleFrames, edits, settled ? TEXT("true") : TEXT("false"), runSeconds);
+	json += FString::Printf(TEXT("\"frame_time\":%s,\n"), *frameTimes.toJson());
+	json += FString::Printf(TEXT("\"sync_latency\":%s,\n"), *syncLatency.toJson());
+	json += FString::Printf(TEXT("\"sync_latency_frames\":%s,\n"), *syncLatencyFrames.toJson(TEXT("frames")));
+	json += FString::Printf(TEXT("\"nodes_synced_per_frame\":%s,\n"), *nodesPerFrame.toJson(TEXT("nodes")));
+	json += FString::Printf(TEXT("\"throughput\":{\"nodes_synced\":%d,\"meshes_converted\":%d,\"meshes_shared\":%d,\"vertices_converted\":%lld},\n"),
+		nodesSynced, meshesConverted, meshesShared, verticesConverted);
+	json += FString::Printf(TEXT("\"lod\":{\"hysteresis_band\":%.2f,\"minimum_node_lifetime\":%.3f,\"flips\":%d,\"flips_per_second\":%.2f,\"changes_held\":%d},\n"),
+		lodHysteresisBand, minimumNodeLifetime, lodFlips, lodFlipsPerSecond(), lodChangesHeld);
+	json += FString::Printf(TEXT("\"peak_mesh_bytes\":%llu\n"), peakMeshBytes);
+	return json;
+}
+
+bool FCubiquitySessionReplay::run(const FCubiquitySessionRecording& recording, const FString& volumeFileName, uint32 baseNodeSize, int32 syncsPerFrame, FCubiquityReplayResult& result,
+	float lodHysteresisBand, float minimumNodeLifetime)
+{
+	//The edits are applied to a copy so the original is left as it was recorded against
+	const FString copyFileName = FPaths::CreateTempFilename(*(FPaths::GameSavedDir() / TEXT("Cubiquity")), TEXT("Replay"), TEXT(".vdb"));
+	if (IFileManager::Get().Copy(*copyFileName, *volumeFileName) != COPY_OK)
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to copy %s to %s"), *volumeFileName, *copyFileName);
+		return false;
+	}
+
+	const FCubiquityConversionSettings& settings = recording.conversionSettings();
+
+	std::unique_ptr<Cubiquity::Volume> volume;
+	if (settings.volumeType == Cubiquity::VolumeType::Terrain)
+	{
+		volume = std::make_unique<Cubiquity::TerrainVolume>(TCHAR_TO_ANSI(*copyFileName), Cubiquity::WritePermissions::ReadWrite, baseNodeSize);
+	}
+	else
+	{
+		volume = std::make_unique<Cubiquity::ColoredCubesVolume>(TCHAR_TO_ANSI(*copyFileName), Cubiquity::WritePermissions::ReadWrite, baseNodeSize);
+	}
+
+	FCubiquityLodHysteresis lod;
+	lod.band = FMath::Max(lodHysteresisBand, 0.0f);
+	lod.minimumNodeLifetime = FMath::Max(minimumNodeLifetime, 0.0f);
+	result.lodHysteresisBand = lod.band;
+	result.minimumNodeLifetime = lod.minimumNodeLifetime;
+
+	FCubiquitySyncSimulator simulator(settings);
+	simulator.lod = &lod;
+	TArray<FPendingEdit> pendingEdits;
+	int32 frames = 0;
+
+	//One frame of the volume: update from the eye and sync what the volume would have synced
+	auto runFrame = [&](const FVector& camera, float lodThreshold, double time)
+	{
+		const double frameStart = FPlatformTime::Seconds();
+		const FVector eye = lod.eyeFor(camera);
+		simulator.now = time;
+		const bool upToDate = volume->update({ eye.X, eye.Y, eye.Z }, lodThreshold);
+		const int32 nodesSynced = volume->hasRootOctreeNode() ? simulator.syncNode(volume->rootOctreeNode(), syncsPerFrame) : 0;
+		const double frameEnd = FPlatformTime::Seconds();
+
+		result.frameTimes.addSeconds(frameEnd - frameStart);
+		result.nodesPerFrame.add(nodesSynced);
+		result.peakMeshBytes = FMath::Max(result.peakMeshBytes, simulator.liveMeshBytes());
+
+		//Once the volume has caught up and there was nothing left to sync, held or deferred every earlier edit is visible
+		result.settled = upToDate && nodesSynced == 0 && simulator.nodesLeftForLater == 0;
+		if (result.settled)
+		{
+			for (const FPendingEdit& edit : pendingEdits)
+			{
+				result.syncLatency.addSeconds(frameEnd - edit.appliedSeconds);
+				result.syncLatencyFrames.add(frames - edit.appliedFrame + 1);
+			}
+			pendingEdits.Reset();
+		}
+
+		++frames;
+	};
+
+	FVector lastEye = FVector::ZeroVector;
+	float lastLodThreshold = 1.0f;
+	double lastTime = 0.0;
+
+	const double runStart = FPlatformTime::Seconds();
+	for (const FCubiquityRecordedEvent& event : recording.events())
+	{
+		if (event.op == ECubiquityRecordedOp::Camera)
+		{
+			lastEye = event.position;
+			lastLodThreshold = event.lodThreshold;
+			lastTime = event.time;
+			runFrame(lastEye, lastLodThreshold, lastTime);
+		}
+		else
+		{
+			event.applyTo(*volume);
+			++result.edits;
+
+			FPendingEdit pending;
+			pending.appliedSeconds = FPlatformTime::Seconds();
+			pending.appliedFrame = frames;
+			pendingEdits.Add(pending);
+		}
+	}
+
+	result.recordedFrames = frames;
+	result.recordedSeconds = static_cast<float>(lastTime);
+	for (int32 i = 0; i < MaximumSettleFrames && !result.settled; ++i)
+	{
+		lastTime += SettleFrameSeconds;
+		runFrame(lastEye, lastLodThreshold, lastTime);
+	}
+	result.settleFrames = frames - result.recordedFrames;
+	result.runSeconds = FPlatformTime::Seconds() - runStart;
+
+	if (!result.settled)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("Gave up on the volume syncing everything %d frames after the recording ended. \"settled\" is false in the results."), MaximumSettleFrames);
+	}
+
+	result.nodesSynced = simulator.nodesSynced;
+	result.meshesConverted = simulator.meshesConverted;
+	result.meshesShared = simulator.meshesShared;
+	result.verticesConverted = simulator.verticesConverted;
+	result.lodFlips = simulator.lodFlips;
+	result.lodChangesHeld = simulator.lodChangesHeld;
+
+	volume.reset();
+	IFileManager::Get().Delete(*copyFileName, false, false, true);
+
+	return true;
+}
@@ -0,0 +1,259 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquitySyncSimulator.h"
+
+double FCubiquitySamples::total() const
+{
+	double sum = 0.0;
+	for (double sample : samples)
+	{
+		sum += sample;
+	}
+	return sum;
+}
+
+double FCubiquitySamples::percentile(double fraction)
+{
+	if (samples.Num() == 0)
+	{
+		return 0.0;
+	}
+
+	samples.Sort();
+
+	return samples[FMath::Clamp(FMath::CeilToInt(fraction * samples.Num()) - 1, 0, samples.Num() - 1)];
+}
+
+FString FCubiquitySamples::toJson(const TCHAR* unit)
+{
+	const double sum = total();
+	return FString::Printf(TEXT("{\"count\":%d,\"total_%s\":%.3f,\"mean_%s\":%.4f,\"p50_%s\":%.4f,\"p90_%s\":%.4f,\"p99_%s\":%.4f,\"max_%s\":%.4f}"),
+		samples.Num(), unit, sum, unit, samples.Num() > 0 ? sum / samples.Num() : 0.0,
+		unit, percentile(0.5), unit, percentile(0.9), unit, percentile(0.99), unit, percentile(1.0));
+}
+
+int32 FCubiquitySyncSimulator::syncNode(const Cubiquity::OctreeNode& octreeNode, int32 availableNodeSyncs)
+{
+	if (!root.IsValid())
+	{
+		root = MakeShareable(new FNodeState);
+		root->simulator = this;
+		root->sync.spawnedAt = now;
+	}
+
+	FCubiquityNodeSyncBudget budget;
+	budget.lod = lod;
+	budget.now = now;
+	coarseNodeSyncs.begin(budget, lazyCoarseNodes, coarseNodeSyncsPerSecond, now);
+
+	const int32 nodeSyncsPerformed = TCubiquityNodeSync<FNodeState>::processOctreeNode(*root, octreeNode, availableNodeSyncs, budget, false);
+
+	coarseNodeSyncs.end(budget);
+	lodFlips += budget.lodFlips;
+	lodChangesHeld += budget.lodChangesHeld;
+	hiddenNodesDeferred += budget.hiddenNodesDeferred;
+	nodesLeftForLater = budget.leftForLater();
+
+	if (meshBudgetBytes > 0)
+	{
+		evictMeshes();
+	}
+
+	return nodeSyncsPerformed;
+}
+
+int32 FCubiquitySyncSimulator::syncEditedNodes(const Cubiquity::OctreeNode& octreeNode, FCubiquityEditLatency& edits, uint32 baseNodeSize, int32& availableNodeSyncs)
+{
+	return root.IsValid() ? TCubiquityNodeSync<FNodeState>::processEditedNodes(*root, octreeNode, edits, baseNodeSize, availableNodeSyncs) : 0;
+}
+
+FCubiquitySyncSimulator::FNodeState* FCubiquitySyncSimulator::FNodeState::spawnChild(const Cubiquity::OctreeNode& childNode, uint32 x, uint32 y, uint32 z)
+{
+	FNodeState* child = new FNodeState;
+	child->simulator = simulator;
+	child->sync.spawnedAt = simulator->now;
+	children[x][y][z] = MakeShareable(child);
+	return child;
+}
+
+void FCubiquitySyncSimulator::noteSyncedEdits(const Cubiquity::OctreeNode& octreeNode, FCubiquityEditLatency& edits, uint32 baseNodeSize) const
+{
+	noteSyncedEditState(octreeNode, root.Get(), edits, baseNodeSize);
+}
+
+void FCubiquitySyncSimulator::noteSyncedEditState(const Cubiquity::OctreeNode& octreeNode, const FNodeState* state, FCubiquityEditLatency& edits, uint32 baseNodeSize)
+{
+	if (!edits.touches(octreeNode, baseNodeSize))
+	{
+		return;
+	}
+
+	const bool inStep = state
+		&& octreeNode.structureLastChanged() <= state->sync.structureLastSynced
+		&& octreeNode.propertiesLastChanged() <= state->sync.propertiesLastSynced
+		&& octreeNode.meshLastChanged() <= state->sync.meshLastSynced;
+	edits.visit(octreeNode, baseNodeSize, inStep);
+
+	//Below a node the walk hasn't reached, the node itself already holds the edits up
+	if (!state)
+	{
+		return;
+	}
+
+	for (uint32_t z = 0; z < 2; z++)
+	{
+		for (uint32_t y = 0; y < 2; y++)
+		{
+			for (uint32_t x = 0; x < 2; x++)
+			{
+				if (octreeNode.hasChildNode({ x, y, z }))
+				{
+					noteSyncedEditState(octreeNode.childNode({ x, y, z }), state->children[x][y][z].Get(), edits, baseNodeSize);
+				}
+			}
+		}
+	}
+}
+
+void FCubiquitySyncSimulator::syncMesh(const Cubiquity::OctreeNode& octreeNode, FNodeState& state)
+{
+	nodesSynced++;
+	if (!octreeNode.hasMesh())
+	{
+		state.meshData.Reset();
+		return;
+	}
+
+	const double start = FPlatformTime::Seconds();
+
+	const FCubiquityMeshKey key = FCubiquityMeshConverter::keyForNode(octreeNode, settings);
+	const TSharedPtr<FCubiquityMeshData> sharedMesh = meshes.find(key);
+	if (sharedMesh.IsValid())
+	{
+		state.meshData = sharedMesh;
+		meshesShared++;
+		conversion.addSeconds(FPlatformTime::Seconds() - start);
+		return;
+	}
+
+	const TSharedPtr<FCubiquityMeshData> meshData = MakeShareable(new FCubiquityMeshData);
+	if (diskCache && diskCache->load(key, *meshData))
+	{
+		meshes.add(key, meshData);
+		state.meshData = meshData;
+		meshesFromDiskCache++;
+		conversion.addSeconds(FPlatformTime::Seconds() - start);
+		return;
+	}
+
+	meshData->key = key;
+	FCubiquityMeshConverter::convert(octreeNode, settings, *meshData);
+	meshes.add(key, meshData);
+	state.meshData = meshData;
+	if (diskCache)
+	{
+		diskCache->save(*meshData);
+	}
+
+	const double converted = FPlatformTime::Seconds();
+	conversion.addSeconds(converted - start);
+	meshesConverted++;
+	verticesConverted += meshData->terrainVertices.Num() + meshData->coloredCubesVertices.Num() + meshData->packedFaces.Num() * 4;
+
+	//Everything the mesh component does before the cooker takes over
+	FTriMeshCollisionData collisionData;
+	FCubiquityMeshConverter::stageCollision(*meshData, settings.volumeType, collisionData);
+	collisionStaging.addSeconds(FPlatformTime::Seconds() - converted);
+	trianglesStaged += collisionData.Indices.Num();
+}
+
+void FCubiquitySyncSimulator::evictMeshes()
+{
+	uint64 used = liveMeshBytes();
+	const uint64 target = static_cast<uint64>(meshBudgetBytes * 0.9);
+	if (used <= meshBudgetBytes || !root.IsValid())
+	{
+		return;
+	}
+
+	TArray<FNodeState*> candidates;
+	findEvictable(*root, candidates);
+	for (FNodeState* node : candidates)
+	{
+		if (used <= target)
+		{
+			break;
+		}
+
+		//A shared mesh is only freed once every node using it has let it go, so each takes its share off
+		const FCubiquityMeshData& meshData = *node->meshData;
+		used -= FMath::Min<uint64>(used, (meshData.cpuBytes() + meshData.gpuBytes()) / FMath::Max(node->meshData.GetSharedReferenceCount(), 1));
+
+		node->meshData.Reset();
+		node->sync.meshEvicted = true;
+		meshesEvicted++;
+	}
+}
+
+void FCubiquitySyncSimulator::findEvictable(FNodeState& state, TArray<FNodeState*>& outNodes)
+{
+	if (!state.sync.renderThisNode && !state.sync.meshEvicted && state.meshData.IsValid())
+	{
+		outNodes.Add(&state);
+	}
+
+	for (uint32_t z = 0; z < 2; z++)
+	{
+		for (uint32_t y = 0; y < 2; y++)
+		{
+			for (uint32_t x = 0; x < 2; x++)
+			{
+				if (state.children[x][y][z].IsValid())
+				{
+					findEvictable(*state.children[x][y][z], outNodes);
+				}
+			}
+		}
+	}
+}
+
+uint64 FCubiquitySyncSimulator::liveMeshBytes() const
+{
+	TSet<const FCubiquityMeshData*> counted;
+	uint64 bytes = 0;
+	if (root.IsValid())
+	{
+		countMeshBytes(*root, counted, bytes);
+	}
+	return bytes;
+}
+
+void FCubiquitySyncSimulator::countMeshBytes(const FNodeState& state, TSet<const FCubiquityMeshData*>& counted, uint64& bytes)
+{
+	const FCubiquityMeshData* meshData = state.meshData.Get();
+	bool alreadyCounted = false;
+	if (meshData)
+	{
+		counted.Add(meshData, &alreadyCounted);
+		if (!alreadyCounted)
+		{
+			bytes += meshData->cpuBytes() + meshData->gpuBytes();
+		}
+	}
+
+	for (uint32_t z = 0; z < 2; z++)
+	{
+		for (uint32_t y = 0; y < 2; y++)
+		{
+			for (uint32_t x = 0; x < 2; x++)
+			{
+				if (state.children[x][y][z].IsValid())
+				{
+					countMeshBytes(*state.children[x][y][z], counted, bytes);
+				}
+			}
+		}
+	}
+}
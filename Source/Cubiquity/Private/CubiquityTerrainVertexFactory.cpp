@@ -5,6 +5,7 @@
 #include "CubiquityTerrainVertexFactory.h"
 
 #include "CubiquityMeshComponent.h"
+#include "CubiquityMeshData.h"
 
 void FGeneratedMeshVertexFactory::Init(const FGeneratedMeshVertexBuffer* VertexBuffer)
 {
@@ -28,24 +29,52 @@ void FGeneratedMeshVertexFactory::Init(const FGeneratedMeshVertexBuffer* VertexB
 		});
 }
 
+FGeneratedMeshRenderData::FGeneratedMeshRenderData(const TArray<FDynamicMeshVertex>& vertices, const TArray<int32>& indices, const FCubiquityTraceNode& traceNode)
+{
+	//Copy the buffers in from the mesh data
+	VertexBuffer.Vertices = vertices;
+	IndexBuffer.Indices = indices;
+
+	// Init vertex factory
+	VertexFactory.Init(&VertexBuffer);
+
+	// Enqueue initialization of render resource. This is where the buffers are uploaded to the GPU.
+	ENQUEUE_UNIQUE_RENDER_COMMAND_TWOPARAMETER(
+		InitGeneratedMeshRenderData,
+		FGeneratedMeshRenderData*, RenderData, this,
+		FCubiquityTraceNode, TraceNode, traceNode,
+		{
+		CUBIQUITY_TRACE_NODE_SCOPE("GPU upload", TraceNode);
+		RenderData->VertexBuffer.InitResource();
+		RenderData->IndexBuffer.InitResource();
+		RenderData->VertexFactory.InitResource();
+		});
+}
+
+FGeneratedMeshRenderData::~FGeneratedMeshRenderData()
+{
+	//The last reference is always held by a proxy so this happens on the rendering thread
+	VertexBuffer.ReleaseResource();
+	IndexBuffer.ReleaseResource();
+	VertexFactory.ReleaseResource();
+}
+
 FGeneratedMeshSceneProxy::FGeneratedMeshSceneProxy(UCubiquityMeshComponent* Component)
 	: FPrimitiveSceneProxy(Component)
 	, MaterialRelevance(Component->GetMaterialRelevance(ERHIFeatureLevel::SM4))
 {
 	//UE_LOG(CubiquityLog, Log, TEXT("Recreating proxy"));
-	//UE_LOG(CubiquityLog, Log, TEXT("Vertices in terrain proxy: %d"), Component->terrainVertices.Num());
+	//UE_LOG(CubiquityLog, Log, TEXT("Vertices in terrain proxy: %d"), Component->meshData->terrainVertices.Num());
 
-	//Copy the buffers in from the component
-	VertexBuffer.Vertices = Component->terrainVertices;
-	IndexBuffer.Indices = Component->indices;
-
-	// Init vertex factory
-	VertexFactory.Init(&VertexBuffer);
-
-	// Enqueue initialization of render resource
-	BeginInitResource(&VertexBuffer);
-	BeginInitResource(&IndexBuffer);
-	BeginInitResource(&VertexFactory);
+	//Use the GPU buffers of any other node with the same mesh, or make them if we're the first
+	FCubiquityMeshData& meshData = *Component->meshData;
+	RenderData = meshData.terrainRenderData.Pin();
+	if (!RenderData.IsValid())
+	{
+		RenderData = TSharedPtr<FGeneratedMeshRenderData, ESPMode::ThreadSafe>(new FGeneratedMeshRenderData(meshData.terrainVertices, meshData.indices,
+			FCubiquityTrace::isRecording() ? Component->traceNode() : FCubiquityTraceNode()));
+		meshData.terrainRenderData = RenderData;
+	}
 
 	// Grab material
 	Material = Component->GetMaterial(0);
@@ -35,18 +35,110 @@ void ACubiquityTerrainVolume::Destroyed()
 	m_volume.reset(nullptr);
 }
 
+FCubiquityConversionSettings ACubiquityTerrainVolume::conversionSettings() const
+{
+	FCubiquityConversionSettings settings = Super::conversionSettings();
+	settings.volumeType = Cubiquity::VolumeType::Terrain;
+	return settings;
+}
+
 void ACubiquityTerrainVolume::loadVolume()
 {
-	m_volume = loadVolumeImpl<Cubiquity::TerrainVolume>();
+	loadVolumeImpl<Cubiquity::TerrainVolume>();
+}
+
+void ACubiquityTerrainVolume::setVolume(Cubiquity::Volume* newVolume)
+{
+	m_volume.reset(static_cast<Cubiquity::TerrainVolume*>(newVolume));
 }
 
 void ACubiquityTerrainVolume::sculptTerrain(FVector localPosition, float innerRadius, float outerRadius, float opacity)
 {
-	m_volume->sculpt({ localPosition.X, localPosition.Y, localPosition.Z }, innerRadius, outerRadius, opacity);
+	if (!m_volume)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("sculptTerrain called before the volume finished opening"));
+		return;
+	}
+
+	FCubiquityRecordedEvent event;
+	event.op = ECubiquityRecordedOp::SculptTerrain;
+	event.position = localPosition;
+	event.innerRadius = innerRadius;
+	event.outerRadius = outerRadius;
+	event.opacity = opacity;
+	applyBrush(event);
+}
+
+void ACubiquityTerrainVolume::paintTerrain(FVector localPosition, float innerRadius, float outerRadius, float opacity, int32 materialIndex)
+{
+	if (!m_volume)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("paintTerrain called before the volume finished opening"));
+		return;
+	}
+
+	FCubiquityRecordedEvent event;
+	event.op = ECubiquityRecordedOp::PaintTerrain;
+	event.position = localPosition;
+	event.innerRadius = innerRadius;
+	event.outerRadius = outerRadius;
+	event.opacity = opacity;
+	event.value = FMath::Max(materialIndex, 0);
+	applyBrush(event);
+}
+
+void ACubiquityTerrainVolume::blurTerrain(FVector localPosition, float innerRadius, float outerRadius, float opacity)
+{
+	if (!m_volume)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("blurTerrain called before the volume finished opening"));
+		return;
+	}
+
+	FCubiquityRecordedEvent event;
+	event.op = ECubiquityRecordedOp::BlurTerrain;
+	event.position = localPosition;
+	event.innerRadius = innerRadius;
+	event.outerRadius = outerRadius;
+	event.opacity = opacity;
+	applyBrush(event);
+}
+
+void ACubiquityTerrainVolume::strokeTerrain(const TArray<FVector>& localPath, ECubiquityTerrainBrush brush, float spacing, float innerRadius, float outerRadius, float opacity, int32 materialIndex)
+{
+	if (!m_volume)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("strokeTerrain called before the volume finished opening"));
+		return;
+	}
+
+	FCubiquityRecordedEvent event;
+	switch (brush)
+	{
+	case ECubiquityTerrainBrush::Sculpt:
+		event.op = ECubiquityRecordedOp::SculptTerrain;
+		break;
+	case ECubiquityTerrainBrush::Paint:
+		event.op = ECubiquityRecordedOp::PaintTerrain;
+		event.value = FMath::Max(materialIndex, 0);
+		break;
+	case ECubiquityTerrainBrush::Blur:
+		event.op = ECubiquityRecordedOp::BlurTerrain;
+		break;
+	}
+	event.innerRadius = innerRadius;
+	event.outerRadius = outerRadius;
+	event.opacity = opacity;
+	applyBrushStroke(localPath, spacing, event);
 }
 
 FVector ACubiquityTerrainVolume::pickSurface(FVector localStartPosition, FVector localDirection) const
 {
+	if (!m_volume)
+	{
+		return FVector::ZeroVector; //Still being opened
+	}
+
 	bool success;
 	auto hitLocation = m_volume->pickSurface({ localStartPosition.X, localStartPosition.Y, localStartPosition.Z }, { localDirection.X, localDirection.Y, localDirection.Z }, &success);
 
@@ -61,11 +153,37 @@ FVector ACubiquityTerrainVolume::pickSurface(FVector localStartPosition, FVector
 
 void ACubiquityTerrainVolume::setVoxel(FVector position, const UCubiquityMaterialSet* materialSet)
 {
-	m_volume->setVoxel({ position.X, position.Y, position.Z }, *materialSet);
+	if (!m_volume)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("setVoxel called before the volume finished opening"));
+		return;
+	}
+
+	FCubiquityRecordedEvent event;
+	event.op = ECubiquityRecordedOp::SetTerrainVoxel;
+	event.position = position;
+	event.value = Cubiquity::MaterialSet(*materialSet).materialSetStruct().data;
+	applyEdit(event);
+}
+
+void ACubiquityTerrainVolume::fillRegion(FVector lowerCorner, FVector upperCorner, const UCubiquityMaterialSet* materialSet)
+{
+	if (!m_volume)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("fillRegion called before the volume finished opening"));
+		return;
+	}
+
+	applyEdit(makeFillEvent(ECubiquityRecordedOp::FillTerrainRegion, lowerCorner, upperCorner, Cubiquity::MaterialSet(*materialSet).materialSetStruct().data));
 }
 
 UCubiquityMaterialSet* ACubiquityTerrainVolume::getVoxel(FVector position) const
 {
+	if (!m_volume)
+	{
+		return nullptr; //Still being opened
+	}
+
 	const auto& voxel = m_volume->getVoxel({ position.X, position.Y, position.Z });
 	return new UCubiquityMaterialSet(voxel);
 }
@@ -0,0 +1,125 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityTrace.h"
+
+namespace
+{
+	//About 50MB of spans. Plenty for a few minutes of play and it stops a forgotten capture eating all the memory.
+	const int32 MaximumSpans = 1 << 20;
+
+	struct FTraceSpan
+	{
+		const TCHAR* name; //Always a literal so it outlives the capture
+		double startSeconds;
+		double endSeconds;
+		uint32 threadId;
+		FCubiquityTraceNode node;
+	};
+
+	FCriticalSection spansLock;
+	TArray<FTraceSpan> spans;
+	double captureStarted = 0.0;
+
+	void traceCommand(const TArray<FString>& args)
+	{
+		if (args.Num() >= 1 && args[0] == TEXT("Start"))
+		{
+			FCubiquityTrace::start();
+		}
+		else if (args.Num() >= 1 && args[0] == TEXT("Stop"))
+		{
+			FCubiquityTrace::stop(args.Num() >= 2 ? args[1] : FString());
+		}
+		else
+		{
+			UE_LOG(CubiquityLog, Display, TEXT("Usage: cubiquity.Trace Start|Stop [File]"));
+		}
+	}
+
+	FAutoConsoleCommand traceConsoleCommand(
+		TEXT("cubiquity.Trace"),
+		TEXT("Capture a timeline of Cubiquity's voxel sync. 'Start' begins a capture and 'Stop [File]' writes it as Chrome trace JSON."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&traceCommand));
+}
+
+FThreadSafeBool FCubiquityTrace::recording = false;
+
+void FCubiquityTrace::start()
+{
+#if CUBIQUITY_TRACE
+	FScopeLock lock(&spansLock);
+	spans.Reset();
+	captureStarted = FPlatformTime::Seconds();
+	recording = true;
+	UE_LOG(CubiquityLog, Display, TEXT("Cubiquity trace started"));
+#else
+	UE_LOG(CubiquityLog, Warning, TEXT("Cubiquity trace is compiled out of this build"));
+#endif
+}
+
+bool FCubiquityTrace::stop(const FString& path)
+{
+	TArray<FTraceSpan> capturedSpans;
+	{
+		FScopeLock lock(&spansLock);
+		recording = false;
+		Exchange(capturedSpans, spans);
+	}
+
+	const FString fileName = path.IsEmpty()
+		? FPaths::ProfilingDir() / TEXT("Cubiquity") / FString::Printf(TEXT("Trace-%s.json"), *FDateTime::Now().ToString())
+		: path;
+
+	//Timestamps are in microseconds from the start of the capture
+	FString json = TEXT("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (int32 i = 0; i < capturedSpans.Num(); ++i)
+	{
+		const FTraceSpan& span = capturedSpans[i];
+		json += FString::Printf(TEXT("{\"name\":\"%s\",\"cat\":\"cubiquity\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f"),
+			span.name, span.threadId, (span.startSeconds - captureStarted) * 1000000.0, (span.endSeconds - span.startSeconds) * 1000000.0);
+
+		if (span.node.height >= 0)
+		{
+			json += FString::Printf(TEXT(",\"args\":{\"x\":%d,\"y\":%d,\"z\":%d,\"height\":%d}"), span.node.position.X, span.node.position.Y, span.node.position.Z, span.node.height);
+		}
+
+		json += (i + 1 < capturedSpans.Num()) ? TEXT("},\n") : TEXT("}\n");
+	}
+	json += TEXT("]}\n");
+
+	if (!FFileHelper::SaveStringToFile(json, *fileName))
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("Failed to write Cubiquity trace to %s"), *fileName);
+		return false;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("Wrote %d spans to %s"), capturedSpans.Num(), *fileName);
+	return true;
+}
+
+void FCubiquityTrace::addSpan(const TCHAR* name, double startSeconds, double endSeconds, const FCubiquityTraceNode& node)
+{
+	FScopeLock lock(&spansLock);
+
+	if (!recording)
+	{
+		return; //Stopped while this span was open
+	}
+
+	if (spans.Num() >= MaximumSpans)
+	{
+		recording = false;
+		UE_LOG(CubiquityLog, Warning, TEXT("Cubiquity trace is full and has stopped capturing. Use 'cubiquity.Trace Stop' to write it out"));
+		return;
+	}
+
+	FTraceSpan span;
+	span.name = name;
+	span.startSeconds = startSeconds;
+	span.endSeconds = endSeconds;
+	span.threadId = FPlatformTLS::GetCurrentThreadId();
+	span.node = node;
+	spans.Add(span);
+}
@@ -0,0 +1,144 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityTuneCommandlet.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "CubiquitySessionReplay.h"
+
+namespace
+{
+	//Candidates this much slower than the fastest still count as fast, and are then picked on memory
+	const double FrameTimeTolerance = 1.1;
+
+	struct FCandidate
+	{
+		uint32 baseNodeSize;
+		FCubiquityReplayResult result;
+		double frameTimeP99;
+	};
+}
+
+UCubiquityTuneCommandlet::UCubiquityTuneCommandlet(const FObjectInitializer& PCIP)
+	: Super(PCIP)
+{
+	LogToConsole = true;
+}
+
+int32 UCubiquityTuneCommandlet::Main(const FString& Params)
+{
+	if (!FCubiquityCommandletSwitches::validate(Params, { TEXT("Recording="), TEXT("Volume="), TEXT("Output="), TEXT("BaseNodeSizes="), TEXT("SyncsPerFrame=") },
+		TEXT("Usage: -run=CubiquityTune -Recording=Path/To.cqrec [-Volume=Path/To.vdb] [-BaseNodeSizes=16,32,64,128] [-SyncsPerFrame=1] [-Output=Path/To.json]")))
+	{
+		return 1;
+	}
+
+	FString recordingFileName;
+	FString volumeFileName;
+	FString outputFileName = FPaths::ProfilingDir() / TEXT("Cubiquity") / FString::Printf(TEXT("Tune-%s.json"), *FDateTime::Now().ToString());
+	FString nodeSizeList = TEXT("16,32,64,128");
+	int32 syncsPerFrame = 1;
+
+	FParse::Value(*Params, TEXT("Recording="), recordingFileName);
+	FParse::Value(*Params, TEXT("Volume="), volumeFileName);
+	FParse::Value(*Params, TEXT("Output="), outputFileName);
+	FParse::Value(*Params, TEXT("BaseNodeSizes="), nodeSizeList, false);
+	FParse::Value(*Params, TEXT("SyncsPerFrame="), syncsPerFrame);
+	syncsPerFrame = FMath::Max(syncsPerFrame, 1);
+
+	FCubiquitySessionRecording recording;
+	if (recordingFileName.IsEmpty() || !recording.load(recordingFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Couldn't read a recording from '%s'. Use -Recording=Path/To.cqrec"), *recordingFileName);
+		return 1;
+	}
+
+	if (volumeFileName.IsEmpty())
+	{
+		volumeFileName = recording.volumeFileName();
+	}
+	if (!FPaths::FileExists(volumeFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Volume %s does not exist. Use -Volume= to say where it is now"), *volumeFileName);
+		return 1;
+	}
+
+	TArray<FString> nodeSizeNames;
+	nodeSizeList.ParseIntoArray(nodeSizeNames, TEXT(","), true);
+
+	TArray<FCandidate> candidates;
+	for (const FString& nodeSizeName : nodeSizeNames)
+	{
+		const uint32 baseNodeSize = FMath::RoundUpToPowerOfTwo(FMath::Clamp(FCString::Atoi(*nodeSizeName), 8, 256));
+		if (candidates.ContainsByPredicate([baseNodeSize](const FCandidate& candidate) { return candidate.baseNodeSize == baseNodeSize; }))
+		{
+			continue;
+		}
+
+		UE_LOG(CubiquityLog, Display, TEXT("Replaying with a base node size of %u"), baseNodeSize);
+
+		FCandidate candidate;
+		candidate.baseNodeSize = baseNodeSize;
+		if (!FCubiquitySessionReplay::run(recording, volumeFileName, baseNodeSize, syncsPerFrame, candidate.result))
+		{
+			return 1;
+		}
+		candidate.frameTimeP99 = candidate.result.frameTimes.percentile(0.99);
+		candidates.Add(MoveTemp(candidate));
+	}
+
+	//Only candidates which caught up with every edit are any use
+	const FCandidate* fastest = nullptr;
+	for (const FCandidate& candidate : candidates)
+	{
+		if (candidate.result.settled && (!fastest || candidate.frameTimeP99 < fastest->frameTimeP99))
+		{
+			fastest = &candidate;
+		}
+	}
+
+	const FCandidate* recommended = fastest;
+	for (const FCandidate& candidate : candidates)
+	{
+		if (recommended && candidate.result.settled && candidate.frameTimeP99 <= fastest->frameTimeP99 * FrameTimeTolerance
+			&& candidate.result.peakMeshBytes < recommended->result.peakMeshBytes)
+		{
+			recommended = &candidate;
+		}
+	}
+
+	FString json = TEXT("{\n");
+	json += FString::Printf(TEXT("\"config\":{\"recording\":\"%s\",\"volume\":\"%s\",\"recorded_base_node_size\":%u,\"syncs_per_frame\":%d},\n"),
+		*recordingFileName.Replace(TEXT("\\"), TEXT("/")), *volumeFileName.Replace(TEXT("\\"), TEXT("/")), recording.baseNodeSize(), syncsPerFrame);
+	json += recommended ? FString::Printf(TEXT("\"recommended_base_node_size\":%u,\n"), recommended->baseNodeSize) : FString(TEXT("\"recommended_base_node_size\":null,\n"));
+	json += TEXT("\"candidates\":[\n");
+	for (int32 i = 0; i < candidates.Num(); ++i)
+	{
+		json += FString::Printf(TEXT("{\n\"base_node_size\":%u,\n"), candidates[i].baseNodeSize);
+		json += candidates[i].result.toJsonFields();
+		json += (i + 1 < candidates.Num()) ? TEXT("},\n") : TEXT("}\n");
+	}
+	json += TEXT("]\n}\n");
+
+	UE_LOG(CubiquityLog, Display, TEXT("%s"), *json);
+
+	if (recommended)
+	{
+		UE_LOG(CubiquityLog, Display, TEXT("Recommended baseNodeSize: %u (p99 frame %.3f ms, peak mesh memory %llu KB)"),
+			recommended->baseNodeSize, recommended->frameTimeP99, recommended->result.peakMeshBytes / 1024);
+	}
+	else
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("No node size caught up with the recorded edits so there is no recommendation"));
+	}
+
+	if (!FFileHelper::SaveStringToFile(json, *outputFileName))
+	{
+		UE_LOG(CubiquityLog, Error, TEXT("Failed to write %s"), *outputFileName);
+		return 1;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("Wrote tuning results to %s"), *outputFileName);
+	return 0;
+}
@@ -7,6 +7,13 @@
 #include "CubiquityOctreeNode.h"
 #include "CubiquityMeshComponent.h"
 #include "CubiquityUpdateComponent.h"
+#include "CubiquityMeshConverter.h"
+#include "CubiquityMeshBudget.h"
+#include "CubiquityJoinSyncComponent.h"
+#include "CubiquityEditSave.h"
+
+//More than any octree will have, so in effect there is no coarsest LOD
+static const int32 MaximumLod = 32;
 
 ACubiquityVolume::ACubiquityVolume(const FObjectInitializer& PCIP)
 	: Super(PCIP)
@@ -17,20 +24,19 @@ ACubiquityVolume::ACubiquityVolume(const FObjectInitializer& PCIP)
 	//AddOwnedComponent(root);
 
 	PrimaryActorTick.bCanEverTick = true;
+
+	//Edits are sent as multicasts, which every client needs wherever it is
+	bReplicates = true;
+	bAlwaysRelevant = true;
 	//PrimaryActorTick.bStartWithTickEnabled = true;
 	//PrimaryActorTick.TickGroup = TG_PrePhysics;
 }
 
 void ACubiquityVolume::PostActorCreated()
 {
+	//The octree gets created once the volume has been opened
 	loadVolume();
 
-	const auto eyePosition = eyePositionInVolumeSpace();
-	//while (!volume()->update({ eyePosition.X, eyePosition.Y, eyePosition.Z }, 0.0)) { /*Keep calling update until it returns true*/ }
-	volume()->update({ eyePosition.X, eyePosition.Y, eyePosition.Z }, lodThreshold);
-
-	createOctree();
-
 	Super::PostActorCreated();
 }
 
@@ -40,12 +46,9 @@ void ACubiquityVolume::PostLoad()
 	//It seems too early to spawn actors as the World doesn't exist yet.
 	//Actors in the tree will have been serialised anyway so should be loaded.
 
+	//Opening happens on a worker thread so this doesn't hold up the level load
 	loadVolume();
 
-	const auto eyePosition = eyePositionInVolumeSpace();
-	//while (!volume()->update({ eyePosition.X, eyePosition.Y, eyePosition.Z }, 0.0)) { /*Keep calling update until it returns true*/ }
-	volume()->update({ eyePosition.X, eyePosition.Y, eyePosition.Z }, lodThreshold);
-
 	Super::PostLoad();
 }
 
@@ -88,29 +91,394 @@ void ACubiquityVolume::Destroyed()
 {
 	UE_LOG(CubiquityLog, Log, TEXT("ACubiquityVolume::Destroyed"));
 
-	TArray<AActor*> children = Children; //Make a copy to avoid overruns
-	//UE_LOG(CubiquityLog, Log, TEXT(" Children %d"), children.Num());
-	for (AActor* childActor : children) //Should only be 1 child of this Actor
+	destroyOctree();
+
+	cancelVolumeLoad();
+	makeQueuedCommit();
+
+	FCubiquityMeshBudget::get().removeVolume(this);
+
+	Super::Destroyed();
+}
+
+void ACubiquityVolume::processOctree()
+{
+	if (!volume())
 	{
-		//UE_LOG(CubiquityLog, Log, TEXT("  Destroying childActor"));
-		if (childActor && !childActor->IsPendingKillPending())
+		//Only one volume opens a frame so the cost is spread out
+		if (pendingVolumeOpen && frameOfLastVolumeOpen != GFrameCounter)
 		{
-			GetWorld()->DestroyActor(childActor);
+			frameOfLastVolumeOpen = GFrameCounter;
+			finishVolumeLoad();
 		}
-		
+		return;
 	}
 
-	Super::Destroyed();
+	applyMeshOptimisations();
+
+	//Players who join later need a way to ask for the chunks they are missing
+	if (sendsEdits())
+	{
+		UCubiquityJoinSyncComponent::addToPlayerControllers(GetWorld());
+	}
+
+	if (keepsChunkHashes() && !chunkHashes.hasAll())
+	{
+		chunkHashes.update(*volume(), joinSyncHashingMilliseconds / 1000.0);
+	}
+
+	applyReceivedEdits();
+
+	applyDueBrushes();
+
+	//Only one volume commits a frame so an autosave of several is spread out
+	if (commitQueued && frameOfLastCommit != GFrameCounter)
+	{
+		frameOfLastCommit = GFrameCounter;
+		makeQueuedCommit();
+	}
+
+	bool upToDate = false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityVolumeUpdate);
+		CUBIQUITY_TRACE_SCOPE("Volume update");
+		const auto cameraPosition = eyePositionInVolumeSpace();
+		lodHysteresis.band = FMath::Max(lodHysteresisBand, 0.0f);
+		const auto eyePosition = lodHysteresis.eyeFor(cameraPosition);
+		upToDate = volume()->update({ eyePosition.X, eyePosition.Y, eyePosition.Z }, effectiveLodThreshold());
+
+		if (recording)
+		{
+			//The camera itself rather than the eye the band held on to, so a replay can try other bands
+			FCubiquityRecordedEvent event;
+			event.op = ECubiquityRecordedOp::Camera;
+			event.position = cameraPosition;
+			event.lodThreshold = effectiveLodThreshold();
+			recording->record(event);
+		}
+	}
+
+	const double now = FPlatformTime::Seconds();
+
+	//Hidden coarse nodes get an allowance which builds up over time
+	FCubiquityNodeSyncBudget budget;
+	budget.now = now;
+	lodHysteresis.minimumNodeLifetime = FMath::Max(minimumNodeLifetime, 0.0f);
+	budget.lod = &lodHysteresis;
+	coarseNodeSyncs.begin(budget, lazyCoarseNodes, coarseNodeSyncsPerSecond, now);
+
+	int nodeSyncsPerformed = 0;
+	if (octreeRootNodeActor)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CubiquityOctreeTraversal);
+		CUBIQUITY_TRACE_SCOPE("Octree traversal");
+		nodeSyncsPerformed = octreeRootNodeActor->processOctreeNode(volume()->rootOctreeNode(), 1, budget, false);
+	}
+
+	coarseNodeSyncs.end(budget);
+	INC_DWORD_STAT_BY(STAT_CubiquityNodesVisited, budget.nodesVisited);
+	INC_DWORD_STAT_BY(STAT_CubiquityLodFlips, budget.lodFlips);
+	deferredCoarseNodes = budget.hiddenNodesDeferred;
+	SET_DWORD_STAT(STAT_CubiquityCoarseNodesDeferred, deferredCoarseNodes);
+
+	lodHysteresis.countFlips(budget.lodFlips, now);
+	lodFlipsPerSecond = lodHysteresis.flipsPerSecond();
+	SET_FLOAT_STAT(STAT_CubiquityLodFlipsPerSecond, lodFlipsPerSecond);
+	SET_DWORD_STAT(STAT_CubiquityLodChangesHeld, budget.lodChangesHeld);
+
+	//Then the nodes over recent edits, so an edit isn't stuck behind the rest of the octree's work
+	if (!editLatency.isEmpty())
+	{
+		CUBIQUITY_TRACE_SCOPE("Edit fast lane");
+		if (octreeRootNodeActor && editFastLaneSyncs > 0)
+		{
+			int availableNodeSyncs = editFastLaneSyncs;
+			const int fastLaneSyncs = octreeRootNodeActor->processEditedNodes(volume()->rootOctreeNode(), editLatency, validBaseNodeSize(), availableNodeSyncs);
+			INC_DWORD_STAT_BY(STAT_CubiquityFastLaneSyncs, fastLaneSyncs);
+			nodeSyncsPerformed += fastLaneSyncs;
+		}
+		else if (octreeRootNodeActor)
+		{
+			//Still note which edits are showing for the statistics
+			int noNodeSyncs = 0;
+			octreeRootNodeActor->processEditedNodes(volume()->rootOctreeNode(), editLatency, validBaseNodeSize(), noNodeSyncs);
+		}
+
+		TArray<double> latencies;
+		editLatency.endFrame(now, upToDate, &latencies);
+		for (double latency : latencies)
+		{
+			lastEditLatencyMilliseconds = static_cast<float>(latency * 1000.0);
+			averageEditLatencyMilliseconds = averageEditLatencyMilliseconds > 0.0f ? FMath::Lerp(averageEditLatencyMilliseconds, lastEditLatencyMilliseconds, 0.1f) : lastEditLatencyMilliseconds;
+		}
+		SET_FLOAT_STAT(STAT_CubiquityEditLatency, lastEditLatencyMilliseconds);
+	}
+
+	if (nodeSyncsPerformed > 0 && !firstMeshVisible)
+	{
+		firstMeshVisible = true;
+		secondsToFirstVisible = FPlatformTime::Seconds() - volumeLoadStarted;
+		UE_LOG(CubiquityLog, Log, TEXT("%s: first node visible after %.3f seconds"), *GetName(), secondsToFirstVisible);
+	}
+
+	//Nodes the walk deferred or held are still out of step with the library, however quiet it is
+	updateStreaming(upToDate && nodeSyncsPerformed == 0 && budget.leftForLater() == 0);
+
+	FCubiquityMeshBudget::get().update();
+
+	//Walking the cache is cheap but there's no point doing it every frame
+	if (now - meshStatisticsLastUpdated > 1.0)
+	{
+		releaseUnusedCollision();
+
+		const FCubiquityMeshSharingStats sharing = meshes.updateStatistics();
+		uniqueMeshes = sharing.uniqueMeshes;
+		sharedMeshNodes = sharing.sharingNodes;
+		meshKilobytesSaved = static_cast<int32>(sharing.bytesSaved / 1024);
+		meshStatisticsLastUpdated = now;
+	}
 }
 
-void ACubiquityVolume::processOctree()
+uint64 ACubiquityVolume::frameOfLastVolumeOpen = 0;
+
+void ACubiquityVolume::cancelVolumeLoad()
+{
+	pendingVolumeOpen = TFunction<Cubiquity::Volume*()>();
+}
+
+void ACubiquityVolume::finishVolumeLoad()
 {
-	const auto eyePosition = eyePositionInVolumeSpace();
-	volume()->update({ eyePosition.X, eyePosition.Y, eyePosition.Z }, lodThreshold);
+	const TFunction<Cubiquity::Volume*()> open = MoveTemp(pendingVolumeOpen);
+	pendingVolumeOpen = TFunction<Cubiquity::Volume*()>();
+	const double openStart = FPlatformTime::Seconds();
+	setVolume(open());
+	volumeOpened = true;
+	secondsToOpen = FPlatformTime::Seconds() - openStart;
 
-	if (octreeRootNodeActor)
+	UE_LOG(CubiquityLog, Log, TEXT("%s: volume opened in %.3f seconds, %.3f seconds after it was asked for"), *GetName(), secondsToOpen, FPlatformTime::Seconds() - volumeLoadStarted);
+
+	diskCache.reset(new FCubiquityMeshDiskCache(volumeFileName, int64(meshDiskCacheMegabytes) * 1024 * 1024, meshDiskCacheMaxAgeDays));
+	meshesFromBakedArchive = 0;
+	meshesFromDiskCache = 0;
+	meshesConverted = 0;
+
+	openBakedMeshArchive();
+
+	lodThresholdScale = 1.0f;
+	evictedNodes = 0;
+	uncommittedChunks.Empty();
+	editedChunks.Empty();
+	chunkHashes.reset(*volume());
+	FCubiquityMeshBudget::get().addVolume(this);
+
+	//Start with only the coarse LODs so that something shows up quickly, then let finer ones in as those are done
+	streamingLod = FMath::Max(coarsestStreamingLod, 0);
+	volume()->setLodRange(streamingLod, MaximumLod);
+
+	firstMeshVisible = false;
+	fullDetailReached = false;
+	secondsToFirstVisible = 0.0f;
+	secondsToFullDetail = 0.0f;
+	onLoadProgress.Broadcast(getLoadProgress());
+
+	lodHysteresis.reset();
+	lodFlipsPerSecond = 0.0f;
+	const auto eyePosition = lodHysteresis.eyeFor(eyePositionInVolumeSpace());
+	volume()->update({ eyePosition.X, eyePosition.Y, eyePosition.Z }, effectiveLodThreshold());
+
+	if (!octreeRootNodeActor)
+	{
+		createOctree();
+		updateMaterial();
+	}
+
+	if (editsToLoad.Num() > 0)
+	{
+		const TArray<uint8> data = MoveTemp(editsToLoad);
+		editsToLoad.Empty();
+		loadEdits(data);
+	}
+}
+
+void ACubiquityVolume::updateStreaming(bool volumeSettled)
+{
+	if (fullDetailReached || !volumeSettled)
+	{
+		return;
+	}
+
+	if (streamingLod > 0)
+	{
+		--streamingLod;
+		volume()->setLodRange(streamingLod, MaximumLod);
+		UE_LOG(CubiquityLog, Verbose, TEXT("%s: streaming in LOD %d"), *GetName(), streamingLod);
+	}
+	else
+	{
+		fullDetailReached = true;
+		secondsToFullDetail = FPlatformTime::Seconds() - volumeLoadStarted;
+		UE_LOG(CubiquityLog, Log, TEXT("%s: full detail after %.3f seconds (%d meshes baked, %d from the disk cache, %d converted)"), *GetName(), secondsToFullDetail, meshesFromBakedArchive, meshesFromDiskCache, meshesConverted);
+	}
+
+	onLoadProgress.Broadcast(getLoadProgress());
+}
+
+void ACubiquityVolume::openBakedMeshArchive()
+{
+	bakedArchive = FCubiquityBakedMeshArchive();
+
+	if (!bakedMeshArchive.IsEmpty())
+	{
+		if (bakedArchive.open(bakedMeshArchive, FCubiquityVolumeRevision::of(volumeFileName), validBaseNodeSize()))
+		{
+			UE_LOG(CubiquityLog, Log, TEXT("%s: using %d baked meshes for %d nodes from %s"), *GetName(), bakedArchive.numEntries(), bakedArchive.numNodes(), *bakedMeshArchive);
+		}
+		else
+		{
+			UE_LOG(CubiquityLog, Warning, TEXT("%s: couldn't open baked mesh archive %s"), *GetName(), *bakedMeshArchive);
+		}
+	}
+}
+
+void ACubiquityVolume::clearMeshDiskCache()
+{
+	if (diskCache)
+	{
+		diskCache->clear();
+	}
+}
+
+float ACubiquityVolume::getLoadProgress() const
+{
+	if (fullDetailReached)
+	{
+		return 1.0f;
+	}
+
+	if (!volumeOpened)
+	{
+		return 0.0f;
+	}
+
+	//Opening counts as one step and then each LOD is another
+	const int32 steps = FMath::Max(coarsestStreamingLod, 0) + 2;
+	const int32 stepsDone = 1 + FMath::Max(coarsestStreamingLod, 0) - streamingLod;
+	return static_cast<float>(stepsDone) / steps;
+}
+
+bool ACubiquityVolume::isFullyLoaded() const
+{
+	return fullDetailReached;
+}
+
+void ACubiquityVolume::optimiseMesh(const TSharedPtr<FCubiquityMeshData>& meshData, bool isTerrain)
+{
+	//Optimise a copy so that the mesh stays usable by the game thread in the meantime
+	FCubiquityOptimisedMesh job;
+	job.terrainVertices = meshData->terrainVertices;
+	job.coloredCubesVertices = meshData->coloredCubesVertices;
+	job.indices = meshData->indices;
+
+	FCubiquityPendingOptimisation pending;
+	pending.meshData = meshData;
+	pending.result = Async<FCubiquityOptimisedMesh>(EAsyncExecution::ThreadPool, [job, isTerrain]() mutable
+	{
+		FCubiquityMeshConverter::optimise(job, isTerrain);
+		return MoveTemp(job);
+	});
+
+	meshesBeingOptimised.Add(MoveTemp(pending));
+}
+
+void ACubiquityVolume::applyMeshOptimisations()
+{
+	if (meshesBeingOptimised.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<TSharedPtr<FCubiquityMeshData>> optimisedMeshes;
+
+	for (int32 i = meshesBeingOptimised.Num() - 1; i >= 0; --i)
+	{
+		FCubiquityPendingOptimisation& pending = meshesBeingOptimised[i];
+		if (!pending.result.IsReady())
+		{
+			continue;
+		}
+
+		//If no node uses the mesh any more there's nothing to do with the result
+		if (!pending.meshData.IsUnique())
+		{
+			const FCubiquityOptimisedMesh& result = pending.result.Get();
+			FCubiquityMeshData& meshData = *pending.meshData;
+
+			FCubiquityMeshConverter::applyOptimisedMesh(result, meshData);
+
+			//Collision was cooked from the unoptimised arrays. The triangles are the same but their order isn't, so cook it again
+			//or face indices in hit results wouldn't match the mesh.
+			if (meshData.collision.IsValid())
+			{
+				meshData.collision->invalidate();
+			}
+
+			optimisedMeshes.Add(pending.meshData);
+
+			//Meshes which are being optimised only go in the disk cache once they are
+			if (meshDiskCache())
+			{
+				meshDiskCache()->save(meshData);
+			}
+		}
+
+		meshesBeingOptimised.RemoveAtSwap(i);
+	}
+
+	if (optimisedMeshes.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<USceneComponent*> children;
+	root->GetChildrenComponents(true, children); //Get all children and grandchildren...
+	for (USceneComponent* childNode : children)
+	{
+		UCubiquityMeshComponent* mesh = Cast<UCubiquityMeshComponent>(childNode);
+		if (mesh && optimisedMeshes.Contains(mesh->getMeshData()))
+		{
+			// Need to recreate scene proxy to send it over
+			mesh->MarkRenderStateDirty();
+			mesh->UpdateCollision();
+		}
+	}
+}
+
+UBodySetup* ACubiquityVolume::bodySetupFor(const TSharedPtr<FCubiquityMeshData>& meshData, Cubiquity::VolumeType volumeType)
+{
+	UCubiquityMeshCollision* collision = meshData->collision.Get();
+	if (!collision)
+	{
+		collision = NewObject<UCubiquityMeshCollision>(this);
+		collision->initialise(meshData, volumeType);
+		meshCollisions.Add(collision);
+		meshData->collision = collision;
+	}
+	return collision->bodySetup;
+}
+
+void ACubiquityVolume::releaseUnusedCollision()
+{
+	for (int32 i = meshCollisions.Num() - 1; i >= 0; --i)
 	{
-		octreeRootNodeActor->processOctreeNode(volume()->rootOctreeNode(), 1);
+		UCubiquityMeshCollision* collision = meshCollisions[i];
+		if (!collision || !collision->isInUse())
+		{
+			if (collision)
+			{
+				collision->release();
+			}
+			meshCollisions.RemoveAtSwap(i);
+		}
 	}
 }
 
@@ -121,32 +489,29 @@ void ACubiquityVolume::PostEditChangeProperty(FPropertyChangedEvent & PropertyCh
 
 	const FName PropertyName = PropertyChangedEvent.Property ? PropertyChangedEvent.Property->GetFName() : NAME_None;
 
-	if (PropertyName == FName(TEXT("volumeFileName")))
+	if (PropertyName == FName(TEXT("volumeFileName")) || PropertyName == FName(TEXT("baseNodeSize")))
 	{
 		//Should we save the old volume? Probably not without asking.
 		//Unload old volume
 		//Load new one
 
-		TArray<AActor*> children = Children; //Make a copy to avoid overruns
-		for (AActor* childActor : children) //Should only be 1 child of this Actor
-		{
-			if (childActor && !childActor->IsPendingKillPending())
-			{
-				GetWorld()->DestroyActor(childActor);
-			}
-
-		}
+		destroyOctree();
 
+		//The octree gets created again once the new volume has been opened
 		loadVolume();
-
-		createOctree();
-
-		updateMaterial(); //TODO needed?
 	}
 	else if (PropertyName == FName(TEXT("Material")))
 	{
 		updateMaterial();
 	}
+	else if (PropertyName == FName(TEXT("bakedMeshArchive")))
+	{
+		openBakedMeshArchive();
+	}
+	else if (PropertyName == FName(TEXT("optimiseMeshes")) || PropertyName == FName(TEXT("deduplicateMeshes")))
+	{
+		recreateOctree();
+	}
 }
 #endif
 
@@ -154,6 +519,11 @@ void ACubiquityVolume::createOctree()
 {
 	UE_LOG(CubiquityLog, Log, TEXT("ACubiquityColoredCubesVolume::loadVolume"));
 
+	if (!volume())
+	{
+		return; //Still being opened. This gets called again once it is.
+	}
+
 	if (volume()->hasRootOctreeNode())
 	{
 		auto rootOctreeNode = volume()->rootOctreeNode();
@@ -163,12 +533,41 @@ void ACubiquityVolume::createOctree()
 		FActorSpawnParameters spawnParameters;
 		spawnParameters.Owner = this;
 		octreeRootNodeActor = GetWorld()->SpawnActor<ACubiquityOctreeNode>(childNodeVolumePosition, FRotator::ZeroRotator, spawnParameters);
+		INC_DWORD_STAT(STAT_CubiquityNodeActorsSpawned);
 		octreeRootNodeActor->initialiseOctreeNode(rootOctreeNode, Material);
 		//octreeRootNodeActor->processOctreeNode(rootOctreeNode, 1);
 	}
 }
 
-void ACubiquityVolume::updateMaterial()
+void ACubiquityVolume::destroyOctree()
+{
+	TArray<AActor*> children = Children; //Make a copy to avoid overruns
+	//UE_LOG(CubiquityLog, Log, TEXT(" Children %d"), children.Num());
+	for (AActor* childActor : children) //Should only be 1 child of this Actor
+	{
+		//UE_LOG(CubiquityLog, Log, TEXT("  Destroying childActor"));
+		if (childActor && !childActor->IsPendingKillPending())
+		{
+			GetWorld()->DestroyActor(childActor);
+		}
+	}
+
+	octreeRootNodeActor = nullptr;
+}
+
+void ACubiquityVolume::recreateOctree()
+{
+	destroyOctree();
+
+	//Whatever changed probably changes how meshes are converted so none of the old ones can be reused
+	meshes.empty();
+	meshesBeingOptimised.Empty();
+
+	createOctree();
+	updateMaterial();
+}
+
+void ACubiquityVolume::getMeshComponents(TArray<UCubiquityMeshComponent*>& outMeshes) const
 {
 	TArray<USceneComponent*> children;
 	root->GetChildrenComponents(true, children); //Get all children and grandchildren...
@@ -177,26 +576,834 @@ void ACubiquityVolume::updateMaterial()
 		UCubiquityMeshComponent* mesh = Cast<UCubiquityMeshComponent>(childNode);
 		if (mesh)
 		{
-			mesh->SetMaterial(0, Material);
+			outMeshes.Add(mesh);
 		}
 	}
 }
 
+void ACubiquityVolume::markUncommitted(const FVector& localPosition, float radius)
+{
+	TArray<FIntVector> chunks;
+	FCubiquityVoxelChunk::chunksAround(localPosition, radius, chunks);
+	uncommittedChunks.Append(chunks);
+	chunksChanged(chunks);
 
-void ACubiquityVolume::commitChanges()
+	editLatency.add(localPosition, radius, FPlatformTime::Seconds());
+}
+
+void ACubiquityVolume::chunksChanged(const TArray<FIntVector>& chunks)
 {
-	if (volume())
+	chunkHashes.changed(chunks);
+	editedChunks.Append(chunks);
+}
+
+bool ACubiquityVolume::findBakedMesh(const Cubiquity::OctreeNode& octreeNode, FCubiquityMeshKey& outKey) const
+{
+	if (!bakedArchive.isOpen())
+	{
+		return false;
+	}
+
+	//The archive has the node as the database had it, so not once a voxel its mesh reads has changed. At coarser LODs
+	//that reaches a voxel of the node's own LOD beyond its bounds.
+	if (editedChunks.Num() > 0)
 	{
-		volume()->acceptOverrideChunks();
+		const int32 height = octreeNode.height();
+		const int32 border = 1 << height;
+		const int32 size = static_cast<int32>(validBaseNodeSize()) << height;
+		const auto position = octreeNode.position();
+		const FIntVector lower = FCubiquityVoxelChunk::containing(FVector(position.x - border, position.y - border, position.z - border));
+		const FIntVector upper = FCubiquityVoxelChunk::containing(FVector(position.x + size + border, position.y + size + border, position.z + size + border));
+		for (const FIntVector& chunk : editedChunks)
+		{
+			if (chunk.X >= lower.X && chunk.X <= upper.X && chunk.Y >= lower.Y && chunk.Y <= upper.Y && chunk.Z >= lower.Z && chunk.Z <= upper.Z)
+			{
+				return false;
+			}
+		}
 	}
+
+	return bakedArchive.find(octreeNode, conversionSettings().flags(), outKey);
 }
 
-void ACubiquityVolume::discardChanges()
+int64 ACubiquityVolume::chunkBytes() const
 {
-	if (volume())
+	//Colored cubes are a 32 bit colour per voxel and terrain a 64 bit material set
+	const int64 bytesPerVoxel = conversionSettings().volumeType == Cubiquity::VolumeType::Terrain ? 8 : 4;
+	return bytesPerVoxel * FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size;
+}
+
+FCubiquityMemoryReport ACubiquityVolume::getMemoryReport() const
+{
+	FCubiquityMemoryReport report;
+
+	report.voxelDatabaseKilobytes = static_cast<int32>(FMath::Max<int64>(IFileManager::Get().FileSize(*volumeFileName), 0) / 1024);
+
+	report.uncommittedChunks = uncommittedChunks.Num();
+	report.uncommittedKilobytes = static_cast<int32>(report.uncommittedChunks * chunkBytes() / 1024);
+	report.checkpointKilobytes = static_cast<int32>(checkpoints.compressedBytes() / 1024);
+
+	//Gather the nodes by walking down from ours, as their actors own their children
+	TArray<const ACubiquityOctreeNode*> nodes;
+	for (const AActor* child : Children)
 	{
-		volume()->discardOverrideChunks();
+		if (const ACubiquityOctreeNode* node = Cast<ACubiquityOctreeNode>(child))
+		{
+			nodes.Add(node);
+		}
+	}
+	for (int32 i = 0; i < nodes.Num(); ++i)
+	{
+		for (const AActor* child : nodes[i]->Children)
+		{
+			if (const ACubiquityOctreeNode* node = Cast<ACubiquityOctreeNode>(child))
+			{
+				nodes.Add(node);
+			}
+		}
 	}
+
+	//Bytes rather than kilobytes until the end so that small meshes don't round away
+	struct FUsageBytes
+	{
+		int32 nodes = 0;
+		int32 meshes = 0;
+		uint64 meshCpu = 0;
+		uint64 meshGpu = 0;
+		uint64 collision = 0;
+		uint64 objects = 0;
+	};
+	TArray<FUsageBytes> byHeight;
+
+	TSet<const FCubiquityMeshData*> countedMeshes;
+	TSet<const UBodySetup*> countedBodySetups;
+	for (const ACubiquityOctreeNode* node : nodes)
+	{
+		const int32 height = node->getHeight();
+		if (byHeight.Num() <= height)
+		{
+			byHeight.SetNum(height + 1);
+		}
+		FUsageBytes& usage = byHeight[height];
+
+		usage.nodes++;
+		usage.objects += node->GetClass()->GetStructureSize();
+
+		const UCubiquityMeshComponent* mesh = node->getMeshComponent();
+		if (!mesh)
+		{
+			continue;
+		}
+		usage.objects += mesh->GetClass()->GetStructureSize();
+
+		const FCubiquityMeshData* meshData = mesh->getMeshData().Get();
+		bool alreadyCounted = true;
+		if (meshData)
+		{
+			countedMeshes.Add(meshData, &alreadyCounted);
+		}
+		if (!alreadyCounted)
+		{
+			usage.meshes++;
+			usage.meshCpu += meshData->cpuBytes();
+
+			//Only meshes a proxy has actually uploaded are on the GPU
+			if (meshData->terrainRenderData.IsValid() || meshData->coloredCubesRenderData.IsValid())
+			{
+				usage.meshGpu += meshData->gpuBytes();
+			}
+		}
+
+		UBodySetup* bodySetup = mesh->ModelBodySetup;
+		alreadyCounted = true;
+		if (bodySetup)
+		{
+			countedBodySetups.Add(bodySetup, &alreadyCounted);
+		}
+		if (!alreadyCounted)
+		{
+			usage.collision += bodySetup->GetResourceSize(EResourceSizeMode::Exclusive);
+			usage.objects += bodySetup->GetClass()->GetStructureSize();
+		}
+	}
+
+	report.byHeight.SetNum(byHeight.Num());
+	for (int32 height = 0; height < byHeight.Num(); ++height)
+	{
+		const FUsageBytes& bytes = byHeight[height];
+		FCubiquityMemoryUsage& usage = report.byHeight[height];
+		usage.nodes = bytes.nodes;
+		usage.meshes = bytes.meshes;
+		usage.meshCpuKilobytes = static_cast<int32>(bytes.meshCpu / 1024);
+		usage.meshGpuKilobytes = static_cast<int32>(bytes.meshGpu / 1024);
+		usage.collisionKilobytes = static_cast<int32>(bytes.collision / 1024);
+		usage.objectKilobytes = static_cast<int32>(bytes.objects / 1024);
+		report.total.add(usage);
+	}
+
+	return report;
+}
+
+void ACubiquityVolume::updateMaterial()
+{
+	TArray<USceneComponent*> children;
+	root->GetChildrenComponents(true, children); //Get all children and grandchildren...
+	for (USceneComponent* childNode : children)
+	{
+		UCubiquityMeshComponent* mesh = Cast<UCubiquityMeshComponent>(childNode);
+		if (mesh)
+		{
+			mesh->SetMaterial(0, Material);
+		}
+	}
+}
+
+
+void ACubiquityVolume::commitChanges()
+{
+	if (volume())
+	{
+		//Queued brushes go in this commit, and so does anything a queued commit would have taken
+		flushBrushes();
+		makeCommit();
+	}
+}
+
+void ACubiquityVolume::commitChangesNextFrame()
+{
+	if (!volume())
+	{
+		return;
+	}
+
+	if (!commitQueued)
+	{
+		commitQueued = true;
+		INC_DWORD_STAT(STAT_CubiquityCommitsQueued);
+	}
+}
+
+uint64 ACubiquityVolume::frameOfLastCommit = 0;
+
+void ACubiquityVolume::makeQueuedCommit()
+{
+	if (commitQueued && volume())
+	{
+		flushBrushes();
+		makeCommit();
+	}
+}
+
+void ACubiquityVolume::makeCommit()
+{
+	//This takes everything a queued commit would have
+	if (commitQueued)
+	{
+		commitQueued = false;
+		DEC_DWORD_STAT(STAT_CubiquityCommitsQueued);
+	}
+
+	const double start = FPlatformTime::Seconds();
+	FString error;
+	{
+		CUBIQUITY_TRACE_SCOPE("Commit");
+		error = volume()->tryAcceptOverrideChunks().c_str();
+	}
+	const bool succeeded = error.IsEmpty();
+
+	lastCommitSeconds = FPlatformTime::Seconds() - start;
+	SET_FLOAT_STAT(STAT_CubiquityLastCommitSeconds, lastCommitSeconds);
+
+	if (succeeded)
+	{
+		//The library doesn't say what it wrote, so this is the chunks' uncompressed size
+		const int64 bytes = uncommittedChunks.Num() * chunkBytes();
+		lastCommitKilobytes = static_cast<int32>(bytes / 1024);
+		INC_MEMORY_STAT_BY(STAT_CubiquityCommittedBytes, bytes);
+		UE_LOG(CubiquityLog, Log, TEXT("%s: committed %d chunks in %.3f seconds"), *GetName(), uncommittedChunks.Num(), lastCommitSeconds);
+		uncommittedChunks.Empty();
+		checkpoints.committed();
+	}
+	else
+	{
+		//The library still has the changes so they are still uncommitted
+		lastCommitKilobytes = 0;
+		UE_LOG(CubiquityLog, Warning, TEXT("%s: commit failed after %.3f seconds: %s"), *GetName(), lastCommitSeconds, *error);
+	}
+
+	//Not sent, as each client's voxel database is its own
+	FCubiquityRecordedEvent event;
+	event.op = ECubiquityRecordedOp::CommitChanges;
+	recordEvent(event);
+
+	onCommitFinished.Broadcast(succeeded, lastCommitSeconds);
+}
+
+void ACubiquityVolume::discardChanges()
+{
+	if (volume())
+	{
+		//A commit asked for before this has to be made first or it would lose the edits it was for. Queued brushes are thrown away.
+		brushQueue.reset();
+		makeQueuedCommit();
+
+		//The uncommitted chunks go back to what was last committed
+		for (const FIntVector& chunk : uncommittedChunks)
+		{
+			keepForJoinSyncs(FCubiquityVoxelChunk::centre(chunk), (FCubiquityVoxelChunk::Size - 1) * 0.5f);
+		}
+		volume()->discardOverrideChunks();
+		chunksChanged(uncommittedChunks.Array());
+		uncommittedChunks.Empty();
+
+		//Checkpoints made since the last commit hold edits which have just been thrown away
+		checkpoints.discarded();
+
+		FCubiquityRecordedEvent event;
+		event.op = ECubiquityRecordedOp::DiscardChanges;
+		recordEvent(event);
+		sendEdit(event);
+	}
+}
+
+void ACubiquityVolume::applyEdit(const FCubiquityRecordedEvent& localEvent)
+{
+	//Anything else has to come after the brushes made before it
+	if (!brushQueue.isEmpty())
+	{
+		flushBrushes();
+	}
+
+	//The server makes exactly the edit the clients will decode so they end up with the same voxels
+	const FCubiquityRecordedEvent event = sendsEdits() ? FCubiquityEditStream::quantise(localEvent) : localEvent;
+
+	recordEvent(event);
+	sendEdit(event);
+	applyEditLocally(event);
+}
+
+void ACubiquityVolume::applyEditLocally(const FCubiquityRecordedEvent& event)
+{
+	checkpoints.beforeEdit(*volume(), event.position, event.radius());
+	keepForJoinSyncs(event.position, event.radius());
+	event.applyTo(*volume());
+	markUncommitted(event.position, event.radius());
+}
+
+void ACubiquityVolume::applyBrush(const FCubiquityRecordedEvent& event)
+{
+	if (!coalesceBrushes)
+	{
+		applyEdit(event);
+		return;
+	}
+
+	brushQueue.mergeDistance = brushMergeDistance;
+	brushQueue.add(event, validBaseNodeSize(), FPlatformTime::Seconds());
+}
+
+void ACubiquityVolume::applyBrushStroke(const TArray<FVector>& localPath, float spacing, const FCubiquityRecordedEvent& brush)
+{
+	brushQueue.mergeDistance = coalesceBrushes ? brushMergeDistance : 0.0f;
+	brushQueue.stroke(localPath, spacing, brush, validBaseNodeSize(), FPlatformTime::Seconds());
+	if (!coalesceBrushes)
+	{
+		flushBrushes();
+	}
+}
+
+void ACubiquityVolume::applyDueBrushes()
+{
+	if (brushQueue.isDue(FPlatformTime::Seconds(), brushWindowSeconds))
+	{
+		flushBrushes();
+	}
+}
+
+void ACubiquityVolume::flushBrushes()
+{
+	TArray<FCubiquityRecordedEvent> brushes;
+	brushQueue.take(brushes);
+	for (const FCubiquityRecordedEvent& brush : brushes)
+	{
+		applyEdit(brush);
+	}
+
+	INC_DWORD_STAT_BY(STAT_CubiquityBrushesMerged, brushQueue.brushesMerged - brushesMerged);
+	INC_DWORD_STAT_BY(STAT_CubiquityRemeshesAvoided, brushQueue.remeshesAvoided - remeshesAvoided);
+	brushesQueued = brushQueue.brushesQueued;
+	brushesMerged = brushQueue.brushesMerged;
+	remeshesAvoided = static_cast<int32>(FMath::Min<int64>(brushQueue.remeshesAvoided, MAX_int32));
+}
+
+void ACubiquityVolume::applyBrushKernel(FVector localPosition, const FCubiquityBrush& brush)
+{
+	if (!volume())
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("applyBrushKernel called before the volume finished opening"));
+		return;
+	}
+
+	FCubiquityRecordedEvent localEvent;
+	localEvent.op = ECubiquityRecordedOp::BrushKernel;
+	localEvent.position = localPosition;
+	localEvent.outerRadius = FCubiquityBrushEngine::halfExtent(brush).GetMax();
+	const bool saved = FCubiquityBrushEngine::save(brush, localEvent.payload);
+	if (!saved && sendsEdits())
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("applyBrushKernel can't send a Custom brush or a heightmap over %d samples to clients, so it wasn't applied"), int32(FCubiquityBrushEngine::MaximumHeightmapSamples));
+		return;
+	}
+
+	//As applyEdit(), except that the brush is applied as given rather than read back from the event
+	if (!brushQueue.isEmpty())
+	{
+		flushBrushes();
+	}
+
+	const FCubiquityRecordedEvent event = sendsEdits() ? FCubiquityEditStream::quantise(localEvent) : localEvent;
+	if (saved)
+	{
+		recordEvent(event);
+		sendEdit(event);
+	}
+
+	checkpoints.beforeEdit(*volume(), event.position, event.radius());
+	keepForJoinSyncs(event.position, event.radius());
+	const FCubiquityBrushResult result = FCubiquityBrushEngine::apply(*volume(), event.position, brush);
+	if (result.voxelsWritten > 0)
+	{
+		markUncommitted(event.position, event.radius());
+	}
+
+	const double seconds = result.readSeconds + result.computeSeconds + result.writeSeconds;
+	lastBrushKernelMilliseconds = static_cast<float>(seconds * 1000.0);
+	brushKernelVoxelsPerSecond = seconds > 0.0 ? static_cast<float>(result.voxelsProcessed / seconds) : 0.0f;
+}
+
+TArray<FCubiquityIsland> ACubiquityVolume::applyExplosion(FVector localPosition, float radius, float falloff, float roughness)
+{
+	TArray<FCubiquityIsland> islands;
+	if (!volume())
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("applyExplosion called before the volume finished opening"));
+		return islands;
+	}
+
+	FCubiquityRecordedEvent localEvent;
+	localEvent.op = ECubiquityRecordedOp::Explosion;
+	localEvent.position = localPosition;
+	localEvent.innerRadius = FMath::Max(radius, 0.0f);
+	localEvent.outerRadius = localEvent.innerRadius + FMath::Max(falloff, 0.0f);
+	localEvent.opacity = FMath::Clamp(roughness, 0.0f, 1.0f);
+	localEvent.value = FMath::Max(explosionSearchMargin, 1);
+
+	//As applyEdit(), except that the islands are wanted back
+	if (!brushQueue.isEmpty())
+	{
+		flushBrushes();
+	}
+
+	const FCubiquityRecordedEvent event = sendsEdits() ? FCubiquityEditStream::quantise(localEvent) : localEvent;
+	recordEvent(event);
+	sendEdit(event);
+
+	checkpoints.beforeEdit(*volume(), event.position, event.radius());
+	keepForJoinSyncs(event.position, event.radius());
+	const FCubiquityExplosionResult result = FCubiquityExplosion::apply(*volume(), event.position, event.innerRadius, event.outerRadius - event.innerRadius, event.opacity, static_cast<int32>(event.value), &islands);
+	markUncommitted(event.position, event.radius());
+
+	lastExplosionMilliseconds = static_cast<float>((result.carveSeconds + result.searchSeconds) * 1000.0);
+	islandsDetached += result.islands;
+	return islands;
+}
+
+bool ACubiquityVolume::sendsEdits() const
+{
+	const ENetMode netMode = GetNetMode();
+	return replicateEdits && GetIsReplicated() && (netMode == NM_ListenServer || netMode == NM_DedicatedServer);
+}
+
+void ACubiquityVolume::sendEdit(const FCubiquityRecordedEvent& event)
+{
+	if (!sendsEdits())
+	{
+		return;
+	}
+
+	//Nothing replicates without a client so the queue would only grow. Anyone who joins later is brought up to date by a join sync.
+	const UNetDriver* netDriver = GetNetDriver();
+	if (!netDriver || netDriver->ClientConnections.Num() == 0)
+	{
+		editSender.dropPending();
+		return;
+	}
+
+	editSender.queue(event);
+}
+
+void ACubiquityVolume::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	//Everything since the last net update goes out, in batches small enough to send on their own
+	for (int32 batches = 0; editSender.hasEdits() && batches < FCubiquityEditSender::MaximumBatchesPerUpdate; ++batches)
+	{
+		multicastEditBatch(editSender.takeBatch());
+	}
+	replicatedEditOps = editSender.opsSent;
+	replicatedEditKilobytes = editSender.bytesSent / 1024.0f;
+}
+
+void ACubiquityVolume::multicastEditBatch_Implementation(const FCubiquityEditBatch& batch)
+{
+	if (HasAuthority())
+	{
+		return; //The server made these edits itself
+	}
+
+	editReceiver.receive(batch);
+	replicatedEditOps = editReceiver.opsReceived;
+	replicatedEditKilobytes = editReceiver.bytesReceived / 1024.0f;
+
+	resyncIfOpsLost();
+	applyReceivedEdits();
+}
+
+void ACubiquityVolume::resyncIfOpsLost()
+{
+	//A sync already under way has its own chunk list and sequence number, so this waits for it to finish
+	if (!editReceiver.lostOps || joinSyncState != EJoinSyncState::Finished)
+	{
+		return;
+	}
+
+	//Going back to NotStarted has UCubiquityJoinSyncComponent ask for another join sync, which only sends the chunks that differ
+	UE_LOG(CubiquityLog, Warning, TEXT("%s: edits from the server were lost so the volume is being resynced"), *GetName());
+	editReceiver.lostOps = false;
+	joinSyncState = EJoinSyncState::NotStarted;
+}
+
+void ACubiquityVolume::applyReceivedEdits()
+{
+	if (!volume() || editReceiver.ready.Num() == 0)
+	{
+		return; //They wait until the volume has been opened
+	}
+
+	if (joinSyncState == EJoinSyncState::Requested || joinSyncState == EJoinSyncState::Receiving)
+	{
+		return; //Some may already be in the chunks on their way, and the rest need those chunks first
+	}
+
+	TArray<FCubiquityRecordedEvent> events;
+	Exchange(events, editReceiver.ready);
+	for (const FCubiquityRecordedEvent& event : events)
+	{
+		switch (event.op)
+		{
+		case ECubiquityRecordedOp::DiscardChanges:
+			discardChanges();
+			break;
+		default:
+			recordEvent(event);
+			applyEditLocally(event);
+			break;
+		}
+	}
+}
+
+bool ACubiquityVolume::keepsChunkHashes() const
+{
+	return sendsEdits() || (replicateEdits && GetNetMode() == NM_Client);
+}
+
+void ACubiquityVolume::keepForJoinSyncs(const FVector& localPosition, float radius)
+{
+	for (int32 i = 0; i < joinSyncSessions.Num(); ++i)
+	{
+		const TSharedPtr<FCubiquityJoinSyncServer> session = joinSyncSessions[i].Pin();
+		if (!session.IsValid() || session->isFinished())
+		{
+			joinSyncSessions.RemoveAtSwap(i--);
+			continue;
+		}
+		session->beforeEdit(*volume(), localPosition, radius);
+	}
+}
+
+bool ACubiquityVolume::needsJoinSync() const
+{
+	return replicateEdits && GetNetMode() == NM_Client && volumeOpened && chunkHashes.hasAll() && joinSyncState == EJoinSyncState::NotStarted;
+}
+
+void ACubiquityVolume::beginJoinSync(const FVector& spawnPoint)
+{
+	joinSyncState = EJoinSyncState::Requested;
+	joinSyncStarted = FPlatformTime::Seconds();
+	joinSync.start(spawnPoint, joinSyncPlayableRadius);
+}
+
+TSharedPtr<FCubiquityJoinSyncServer> ACubiquityVolume::startJoinSyncSession()
+{
+	if (!volume() || !chunkHashes.hasAll())
+	{
+		return nullptr;
+	}
+
+	//Queued brushes have already been sent, so the chunks have to have them for the sequence number to be right
+	flushBrushes();
+	chunkHashes.flush(*volume());
+
+	TSharedPtr<FCubiquityJoinSyncServer> session = MakeShareable(new FCubiquityJoinSyncServer());
+	session->start(chunkHashes, editSender.nextSequence());
+	joinSyncSessions.Add(session);
+	return session;
+}
+
+bool ACubiquityVolume::nextJoinSyncSlice(FCubiquityJoinSyncServer& session, FCubiquityChunkSlice& outSlice)
+{
+	return volume() && session.nextSlice(*volume(), outSlice);
+}
+
+bool ACubiquityVolume::receiveJoinSyncHashes(const FCubiquityChunkHashPage& page, TArray<int32>& outNeeded)
+{
+	if (!volume() || joinSyncState != EJoinSyncState::Requested)
+	{
+		return false;
+	}
+
+	if (!joinSync.receiveHashes(page))
+	{
+		//The server's edits carry on from where we are, which is the best there is without its hashes
+		joinSyncState = EJoinSyncState::Finished;
+		outNeeded.Reset();
+		return true;
+	}
+	if (!joinSync.hasAllHashes())
+	{
+		return false;
+	}
+
+	editReceiver.skipTo(joinSync.sequence());
+	chunkHashes.flush(*volume());
+	joinSync.compare(chunkHashes, outNeeded);
+	joinSyncChunks = joinSync.neededChunks;
+	joinSyncState = EJoinSyncState::Receiving;
+
+	UE_LOG(CubiquityLog, Log, TEXT("%s: %d of the server's %d chunks differ from ours"), *GetName(), joinSync.neededChunks, joinSync.candidateChunks);
+
+	if (joinSync.isPlayable())
+	{
+		joinSyncSecondsToPlayable = FPlatformTime::Seconds() - joinSyncStarted;
+		onJoinSyncPlayable.Broadcast(joinSyncSecondsToPlayable);
+	}
+	return true;
+}
+
+void ACubiquityVolume::receiveJoinSyncSlice(const FCubiquityChunkSlice& slice)
+{
+	if (!volume() || joinSyncState != EJoinSyncState::Receiving)
+	{
+		return;
+	}
+
+	const bool wasPlayable = joinSync.isPlayable();
+	FIntVector chunk;
+	if (joinSync.receiveSlice(*volume(), slice, chunk))
+	{
+		uncommittedChunks.Add(chunk);
+		chunksChanged({ chunk });
+	}
+	joinSyncKilobytes = joinSync.bytesReceived / 1024.0f;
+
+	if (!wasPlayable && joinSync.isPlayable())
+	{
+		joinSyncSecondsToPlayable = FPlatformTime::Seconds() - joinSyncStarted;
+		onJoinSyncPlayable.Broadcast(joinSyncSecondsToPlayable);
+	}
+}
+
+void ACubiquityVolume::finishJoinSync()
+{
+	if (joinSyncState != EJoinSyncState::Receiving)
+	{
+		return;
+	}
+
+	joinSyncState = EJoinSyncState::Finished;
+	joinSyncSeconds = FPlatformTime::Seconds() - joinSyncStarted;
+	UE_LOG(CubiquityLog, Log, TEXT("%s: join sync took %.3f seconds, playable after %.3f, %.1f KB"), *GetName(), joinSyncSeconds, joinSyncSecondsToPlayable, joinSyncKilobytes);
+	onJoinSyncFinished.Broadcast(joinSyncSeconds);
+
+	resyncIfOpsLost();
+	applyReceivedEdits();
+}
+
+FCubiquityRecordedEvent ACubiquityVolume::makeFillEvent(ECubiquityRecordedOp op, const FVector& corner, const FVector& otherCorner, uint64 value)
+{
+	const FVector lower(FMath::RoundToFloat(FMath::Min(corner.X, otherCorner.X)), FMath::RoundToFloat(FMath::Min(corner.Y, otherCorner.Y)), FMath::RoundToFloat(FMath::Min(corner.Z, otherCorner.Z)));
+	const FVector upper(FMath::RoundToFloat(FMath::Max(corner.X, otherCorner.X)), FMath::RoundToFloat(FMath::Max(corner.Y, otherCorner.Y)), FMath::RoundToFloat(FMath::Max(corner.Z, otherCorner.Z)));
+
+	FCubiquityRecordedEvent event;
+	event.op = op;
+	event.position = (lower + upper) * 0.5f;
+	event.extent = (upper - lower) * 0.5f;
+	event.value = value;
+	return event;
+}
+
+int32 ACubiquityVolume::createCheckpoint()
+{
+	if (!volume())
+	{
+		return -1;
+	}
+
+	//Queued brushes were made before the checkpoint so they have to be in the volume first
+	flushBrushes();
+
+	return checkpoints.create();
+}
+
+bool ACubiquityVolume::restoreCheckpoint(int32 checkpoint)
+{
+	if (!volume())
+	{
+		return false;
+	}
+
+	//Queued brushes were made after the newest checkpoint so they would be undone anyway
+	brushQueue.reset();
+
+	const double restoreStart = FPlatformTime::Seconds();
+	TArray<FCubiquityRecordedEvent> writes;
+	if (!checkpoints.restore(checkpoint, writes))
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("%s: there is no checkpoint %d to restore"), *GetName(), checkpoint);
+		return false;
+	}
+
+	//Recorded and sent as edits so replays and clients go back too. The checkpoint starts again from these so they aren't saved.
+	for (const FCubiquityRecordedEvent& event : writes)
+	{
+		recordEvent(event);
+		sendEdit(event);
+		keepForJoinSyncs(event.position, event.radius());
+		event.applyTo(*volume());
+		markUncommitted(event.position, event.radius());
+	}
+
+	UE_LOG(CubiquityLog, Log, TEXT("%s: restored checkpoint %d by rewriting %d chunks in %.3f seconds"), *GetName(), checkpoint, writes.Num(), FPlatformTime::Seconds() - restoreStart);
+	return true;
+}
+
+void ACubiquityVolume::clearCheckpoints()
+{
+	checkpoints.reset();
+}
+
+bool ACubiquityVolume::saveEdits(TArray<uint8>& outData)
+{
+	FMemoryWriter writer(outData, true);
+	return serializeEdits(writer);
+}
+
+bool ACubiquityVolume::loadEdits(const TArray<uint8>& data)
+{
+	if (!volume())
+	{
+		//Checked now so that a save that can't be loaded is refused while the caller can still do something about it
+		FMemoryReader reader(data, true);
+		if (!FCubiquityEditSave::isLoadable(reader))
+		{
+			return false;
+		}
+		editsToLoad = data;
+		return true;
+	}
+
+	FMemoryReader reader(data, true);
+	return serializeEdits(reader);
+}
+
+bool ACubiquityVolume::serializeEdits(FArchive& ar)
+{
+	if (!volume())
+	{
+		return false;
+	}
+
+	//Queued brushes are uncommitted changes too
+	flushBrushes();
+
+	const double start = FPlatformTime::Seconds();
+	const int64 startOffset = ar.Tell();
+
+	if (ar.IsSaving())
+	{
+		if (!FCubiquityEditSave::save(*volume(), uncommittedChunks, ar))
+		{
+			return false;
+		}
+
+		lastSaveEditsSeconds = FPlatformTime::Seconds() - start;
+		savedEditsKilobytes = (ar.Tell() - startOffset) / 1024.0f;
+		UE_LOG(CubiquityLog, Log, TEXT("%s: saved %d uncommitted chunks as %.1f KB in %.3f seconds"), *GetName(), uncommittedChunks.Num(), savedEditsKilobytes, lastSaveEditsSeconds);
+		return true;
+	}
+
+	//Nothing is written unless everything can be, so a damaged blob leaves the volume and its checkpoints as they were
+	TArray<FIntVector> loadedChunks;
+	const bool loaded = FCubiquityEditSave::load(*volume(), ar, loadedChunks);
+	if (loaded)
+	{
+		//The chunks changed without going through beforeEdit()
+		clearCheckpoints();
+	}
+	uncommittedChunks.Append(loadedChunks);
+	chunksChanged(loadedChunks);
+
+	lastLoadEditsSeconds = FPlatformTime::Seconds() - start;
+	UE_LOG(CubiquityLog, Log, TEXT("%s: loaded %d saved chunks in %.3f seconds"), *GetName(), loadedChunks.Num(), lastLoadEditsSeconds);
+	return loaded;
+}
+
+FCubiquityConversionSettings ACubiquityVolume::conversionSettings() const
+{
+	FCubiquityConversionSettings settings;
+	settings.optimiseMeshes = optimiseMeshes;
+	return settings;
+}
+
+void ACubiquityVolume::startRecording()
+{
+	recording.reset(new FCubiquitySessionRecording);
+	recording->start(volumeFileName, validBaseNodeSize(), conversionSettings());
+	UE_LOG(CubiquityLog, Display, TEXT("%s: recording started"), *GetName());
+}
+
+bool ACubiquityVolume::stopRecording(const FString& fileName)
+{
+	if (!recording)
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("%s: stopRecording called while not recording"), *GetName());
+		return false;
+	}
+
+	const FString path = fileName.IsEmpty()
+		? FPaths::GameSavedDir() / TEXT("Cubiquity") / TEXT("Recordings") / FString::Printf(TEXT("%s-%s.cqrec"), *GetName(), *FDateTime::Now().ToString())
+		: fileName;
+
+	std::unique_ptr<FCubiquitySessionRecording> finished = std::move(recording);
+	if (!finished->save(path))
+	{
+		UE_LOG(CubiquityLog, Warning, TEXT("%s: failed to write recording to %s"), *GetName(), *path);
+		return false;
+	}
+
+	UE_LOG(CubiquityLog, Display, TEXT("%s: wrote %d recorded events to %s"), *GetName(), finished->events().Num(), *path);
+	return true;
 }
 
 FVector ACubiquityVolume::worldPositionToVolumePosition(const FVector& worldPosition) const
@@ -0,0 +1,177 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityVoxelChunk.h"
+
+namespace
+{
+	//The voxels of a chunk which are inside the volume, as an inclusive range
+	bool chunkBounds(const Cubiquity::Volume& volume, const FIntVector& chunk, FIntVector& outLower, FIntVector& outUpper)
+	{
+		const auto region = volume.enclosingRegion();
+		const int32 size = FCubiquityVoxelChunk::Size;
+		outLower = FIntVector(FMath::Max(chunk.X * size, region.first.x), FMath::Max(chunk.Y * size, region.first.y), FMath::Max(chunk.Z * size, region.first.z));
+		outUpper = FIntVector(FMath::Min(chunk.X * size + size - 1, region.second.x), FMath::Min(chunk.Y * size + size - 1, region.second.y), FMath::Min(chunk.Z * size + size - 1, region.second.z));
+		return outLower.X <= outUpper.X && outLower.Y <= outUpper.Y && outLower.Z <= outUpper.Z;
+	}
+}
+
+void FCubiquityVoxelChunk::chunksAround(const FVector& position, float radius, TArray<FIntVector>& outChunks)
+{
+	const FIntVector lower(FMath::FloorToInt((position.X - radius) / Size), FMath::FloorToInt((position.Y - radius) / Size), FMath::FloorToInt((position.Z - radius) / Size));
+	const FIntVector upper(FMath::FloorToInt((position.X + radius) / Size), FMath::FloorToInt((position.Y + radius) / Size), FMath::FloorToInt((position.Z + radius) / Size));
+	for (int32 z = lower.Z; z <= upper.Z; ++z)
+	{
+		for (int32 y = lower.Y; y <= upper.Y; ++y)
+		{
+			for (int32 x = lower.X; x <= upper.X; ++x)
+			{
+				outChunks.Add(FIntVector(x, y, z));
+			}
+		}
+	}
+}
+
+int32 FCubiquityVoxelChunk::voxelBytes(const Cubiquity::Volume& volume, const FIntVector& chunk)
+{
+	FIntVector lower;
+	FIntVector upper;
+	if (!chunkBounds(volume, chunk, lower, upper))
+	{
+		return 0;
+	}
+	return (upper.X - lower.X + 1) * (upper.Y - lower.Y + 1) * (upper.Z - lower.Z + 1) * bytesPerVoxel(volume.volumeType());
+}
+
+bool FCubiquityVoxelChunk::read(Cubiquity::Volume& volume, const FIntVector& chunk, TArray<uint8>& outVoxels)
+{
+	FIntVector lower;
+	FIntVector upper;
+	if (!chunkBounds(volume, chunk, lower, upper))
+	{
+		outVoxels.Reset();
+		return false;
+	}
+
+	readRegion(volume, lower, upper, outVoxels);
+	return true;
+}
+
+bool FCubiquityVoxelChunk::write(Cubiquity::Volume& volume, const FIntVector& chunk, const TArray<uint8>& voxels)
+{
+	FIntVector lower;
+	FIntVector upper;
+	if (!chunkBounds(volume, chunk, lower, upper))
+	{
+		return false;
+	}
+
+	return writeRegion(volume, lower, upper, voxels) >= 0;
+}
+
+void FCubiquityVoxelChunk::readRegion(Cubiquity::Volume& volume, const FIntVector& lower, const FIntVector& upper, TArray<uint8>& outVoxels)
+{
+	const Cubiquity::VolumeType volumeType = volume.volumeType();
+	const int32 voxelBytes = bytesPerVoxel(volumeType);
+	const int32 noOfVoxels = (upper.X - lower.X + 1) * (upper.Y - lower.Y + 1) * (upper.Z - lower.Z + 1);
+	outVoxels.SetNumUninitialized(noOfVoxels * voxelBytes);
+
+	uint8* voxel = outVoxels.GetData();
+	for (int32 z = lower.Z; z <= upper.Z; ++z)
+	{
+		for (int32 y = lower.Y; y <= upper.Y; ++y)
+		{
+			for (int32 x = lower.X; x <= upper.X; ++x)
+			{
+				if (volumeType == Cubiquity::VolumeType::Terrain)
+				{
+					const uint64 value = static_cast<Cubiquity::TerrainVolume&>(volume).getVoxel({ x, y, z }).materialSetStruct().data;
+					FMemory::Memcpy(voxel, &value, sizeof(value));
+				}
+				else
+				{
+					const uint32 value = static_cast<Cubiquity::ColoredCubesVolume&>(volume).getVoxel({ x, y, z }).colorStruct().data;
+					FMemory::Memcpy(voxel, &value, sizeof(value));
+				}
+				voxel += voxelBytes;
+			}
+		}
+	}
+}
+
+int64 FCubiquityVoxelChunk::writeRegion(Cubiquity::Volume& volume, const FIntVector& lower, const FIntVector& upper, const TArray<uint8>& voxels, const TArray<uint8>* previousVoxels)
+{
+	const Cubiquity::VolumeType volumeType = volume.volumeType();
+	const int32 voxelBytes = bytesPerVoxel(volumeType);
+	const int32 noOfVoxels = (upper.X - lower.X + 1) * (upper.Y - lower.Y + 1) * (upper.Z - lower.Z + 1);
+	if (voxels.Num() != noOfVoxels * voxelBytes || (previousVoxels && previousVoxels->Num() != voxels.Num()))
+	{
+		return -1; //From a different type or size of volume
+	}
+
+	int64 written = 0;
+	const uint8* voxel = voxels.GetData();
+	const uint8* previous = previousVoxels ? previousVoxels->GetData() : nullptr;
+	for (int32 z = lower.Z; z <= upper.Z; ++z)
+	{
+		for (int32 y = lower.Y; y <= upper.Y; ++y)
+		{
+			for (int32 x = lower.X; x <= upper.X; ++x)
+			{
+				//Every setVoxel() dirties the voxel's nodes so unchanged ones are left alone
+				if (!previous || FMemory::Memcmp(voxel, previous, voxelBytes) != 0)
+				{
+					if (volumeType == Cubiquity::VolumeType::Terrain)
+					{
+						uint64 value;
+						FMemory::Memcpy(&value, voxel, sizeof(value));
+						static_cast<Cubiquity::TerrainVolume&>(volume).setVoxel({ x, y, z }, Cubiquity::MaterialSet(value));
+					}
+					else
+					{
+						uint32 value;
+						FMemory::Memcpy(&value, voxel, sizeof(value));
+						static_cast<Cubiquity::ColoredCubesVolume&>(volume).setVoxel({ x, y, z }, Cubiquity::Color(value));
+					}
+					++written;
+				}
+				voxel += voxelBytes;
+				if (previous)
+				{
+					previous += voxelBytes;
+				}
+			}
+		}
+	}
+
+	return written;
+}
+
+void FCubiquityVoxelChunk::compress(const TArray<uint8>& voxels, TArray<uint8>& outCompressed)
+{
+	//Most chunks are runs of the same few values so they compress very well
+	int32 compressedSize = FCompression::CompressMemoryBound(COMPRESS_ZLIB, voxels.Num());
+	outCompressed.SetNumUninitialized(compressedSize);
+	if (FCompression::CompressMemory(COMPRESS_ZLIB, outCompressed.GetData(), compressedSize, voxels.GetData(), voxels.Num()) && compressedSize < voxels.Num())
+	{
+		outCompressed.SetNum(compressedSize);
+	}
+	else
+	{
+		outCompressed = voxels;
+	}
+	outCompressed.Shrink();
+}
+
+bool FCubiquityVoxelChunk::uncompress(const TArray<uint8>& compressed, int32 uncompressedSize, TArray<uint8>& outVoxels)
+{
+	if (compressed.Num() == uncompressedSize)
+	{
+		outVoxels = compressed;
+		return true;
+	}
+
+	outVoxels.SetNumUninitialized(uncompressedSize);
+	return FCompression::UncompressMemory(COMPRESS_ZLIB, outVoxels.GetData(), outVoxels.Num(), compressed.GetData(), compressed.Num());
+}
@@ -0,0 +1,163 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBakedMeshArchive.h"
+#include "CubiquityMeshConverter.h"
+#include "CubiquityBenchmarkVolume.h"
+
+#include "AutomationTest.h"
+
+namespace
+{
+	//As CubiquityBakeMeshes bakes them, but with whatever LODs the volume has
+	void bakeNodes(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings, TMap<FCubiquityMeshKey, TSharedPtr<FCubiquityMeshData>>& meshes,
+		TArray<FCubiquityBakedMeshArchive::FBakedNode>& nodes)
+	{
+		if (octreeNode.hasMesh())
+		{
+			const auto position = octreeNode.position();
+			FCubiquityBakedMeshArchive::FBakedNode node;
+			node.position = FIntVector(position.x, position.y, position.z);
+			node.height = octreeNode.height();
+			node.key = FCubiquityMeshConverter::keyForNode(octreeNode, settings);
+			nodes.Add(node);
+
+			if (!meshes.Contains(node.key))
+			{
+				const TSharedPtr<FCubiquityMeshData> meshData = MakeShareable(new FCubiquityMeshData);
+				meshData->key = node.key;
+				FCubiquityMeshConverter::convert(octreeNode, settings, *meshData);
+				meshes.Add(node.key, meshData);
+			}
+		}
+
+		for (uint32 z = 0; z < 2; z++)
+		{
+			for (uint32 y = 0; y < 2; y++)
+			{
+				for (uint32 x = 0; x < 2; x++)
+				{
+					if (octreeNode.hasChildNode({ x, y, z }))
+					{
+						bakeNodes(octreeNode.childNode({ x, y, z }), settings, meshes, nodes);
+					}
+				}
+			}
+		}
+	}
+
+	//How many nodes with meshes the archive finds by where they are, with the key and mesh they have now
+	int32 countFound(const Cubiquity::OctreeNode& octreeNode, const FCubiquityConversionSettings& settings, FCubiquityBakedMeshArchive& archive, int32& outWrong)
+	{
+		int32 found = 0;
+		FCubiquityMeshKey key;
+		if (octreeNode.hasMesh() && archive.find(octreeNode, settings.flags(), key))
+		{
+			found++;
+
+			FCubiquityMeshData baked;
+			FCubiquityMeshData converted;
+			FCubiquityMeshConverter::convert(octreeNode, settings, converted);
+			if (!(key == FCubiquityMeshConverter::keyForNode(octreeNode, settings)) || !archive.load(key, baked)
+				|| baked.coloredCubesVertices.Num() != converted.coloredCubesVertices.Num() || baked.indices != converted.indices)
+			{
+				outWrong++;
+			}
+		}
+
+		for (uint32 z = 0; z < 2; z++)
+		{
+			for (uint32 y = 0; y < 2; y++)
+			{
+				for (uint32 x = 0; x < 2; x++)
+				{
+					if (octreeNode.hasChildNode({ x, y, z }))
+					{
+						found += countFound(octreeNode.childNode({ x, y, z }), settings, archive, outWrong);
+					}
+				}
+			}
+		}
+		return found;
+	}
+
+	//Enough of a SQLite header for FCubiquityVolumeRevision, at the given change counter
+	bool writeDatabase(const FString& path, uint32 changeCounter)
+	{
+		TArray<uint8> bytes;
+		bytes.AddZeroed(100);
+		FMemory::Memcpy(bytes.GetData(), "SQLite format 3", 16);
+		bytes[24] = uint8(changeCounter >> 24);
+		bytes[25] = uint8(changeCounter >> 16);
+		bytes[26] = uint8(changeCounter >> 8);
+		bytes[27] = uint8(changeCounter);
+		return FFileHelper::SaveArrayToFile(bytes, *path);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityBakedMeshArchiveNodeLookupTest, "Cubiquity.BakedMeshArchive.NodeLookup", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityBakedMeshArchiveNodeLookupTest::RunTest(const FString& Parameters)
+{
+	const int32 size = 64;
+	const int32 height = 16;
+	const uint32 baseNodeSize = 16;
+	Cubiquity::ColoredCubesVolume volume({ 0, 0, 0 }, { size - 1, size - 1, height - 1 }, "BakedMeshArchiveTest.vdb", baseNodeSize);
+	FCubiquityBenchmarkVolume::generateColoredCubes(volume, size, height);
+	for (int32 update = 0; update < 1000 && !volume.update({ 0.0f, 0.0f, float(height) }, 1.0f); ++update)
+	{
+	}
+	TestTrue(TEXT("The volume has an octree"), volume.hasRootOctreeNode());
+	if (!volume.hasRootOctreeNode())
+	{
+		return false;
+	}
+
+	FCubiquityConversionSettings settings;
+	settings.volumeType = Cubiquity::VolumeType::ColoredCubes;
+
+	TMap<FCubiquityMeshKey, TSharedPtr<FCubiquityMeshData>> meshes;
+	TArray<FCubiquityBakedMeshArchive::FBakedNode> nodes;
+	bakeNodes(volume.rootOctreeNode(), settings, meshes, nodes);
+	TArray<TSharedPtr<FCubiquityMeshData>> meshList;
+	meshes.GenerateValueArray(meshList);
+	TestTrue(TEXT("There are nodes to bake"), nodes.Num() > 0);
+
+	const FString directory = FPaths::GameSavedDir() / TEXT("Cubiquity");
+	const FString databasePath = FPaths::CreateTempFilename(*directory, TEXT("BakedMeshArchiveTest"), TEXT(".vdb"));
+	const FString archivePath = databasePath + TEXT(".meshes");
+	TestTrue(TEXT("The database is written"), writeDatabase(databasePath, 7));
+
+	const FCubiquityVolumeRevision revision = FCubiquityVolumeRevision::of(databasePath);
+	TestEqual(TEXT("The revision has SQLite's change counter"), int32(revision.changeCounter), 7);
+	TestEqual(TEXT("and the file's size"), int32(revision.bytes), 100);
+	TestFalse(TEXT("A missing database has no revision"), FCubiquityVolumeRevision::of(databasePath + TEXT(".missing")).isValid());
+
+	TestTrue(TEXT("The archive is written"), FCubiquityBakedMeshArchive::write(archivePath, revision, baseNodeSize, settings.flags(), nodes, meshList));
+
+	FCubiquityBakedMeshArchive archive;
+	TestTrue(TEXT("The archive opens for the revision it was baked from"), archive.open(archivePath, revision, baseNodeSize));
+	TestEqual(TEXT("with every node"), archive.numNodes(), nodes.Num());
+	TestEqual(TEXT("and every distinct mesh"), archive.numEntries(), meshList.Num());
+
+	int32 wrong = 0;
+	TestEqual(TEXT("Every node is found by where it is"), countFound(volume.rootOctreeNode(), settings, archive, wrong), nodes.Num());
+	TestEqual(TEXT("with the key and mesh it has"), wrong, 0);
+
+	FCubiquityConversionSettings greedySettings = settings;
+	greedySettings.greedyMeshing = true;
+	int32 greedyWrong = 0;
+	TestEqual(TEXT("Nodes aren't found for other conversion settings"), countFound(volume.rootOctreeNode(), greedySettings, archive, greedyWrong), 0);
+
+	TestFalse(TEXT("The archive doesn't open for another base node size"), archive.open(archivePath, revision, baseNodeSize * 2));
+
+	//A commit moves the counter on
+	TestTrue(TEXT("The database is written again"), writeDatabase(databasePath, 8));
+	TestFalse(TEXT("The archive doesn't open once the database has moved on"), archive.open(archivePath, FCubiquityVolumeRevision::of(databasePath), baseNodeSize));
+	TestFalse(TEXT("and isn't left open"), archive.isOpen());
+
+	IFileManager::Get().Delete(*databasePath);
+	IFileManager::Get().Delete(*archivePath);
+	return true;
+}
@@ -0,0 +1,227 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBrushQueue.h"
+
+#include "AutomationTest.h"
+
+namespace
+{
+	const uint32 NodeSize = 16;
+
+	FCubiquityRecordedEvent makeBrush(ECubiquityRecordedOp op, const FVector& position, float opacity, float outerRadius = 4.0f, uint64 material = 0)
+	{
+		FCubiquityRecordedEvent event;
+		event.op = op;
+		event.position = position;
+		event.innerRadius = outerRadius * 0.5f;
+		event.outerRadius = outerRadius;
+		event.opacity = opacity;
+		event.value = material;
+		return event;
+	}
+
+	FCubiquityRecordedEvent makeSculpt(const FVector& position, float opacity)
+	{
+		return makeBrush(ECubiquityRecordedOp::SculptTerrain, position, opacity);
+	}
+
+	//What comes out of a queue after adding the brushes to it
+	TArray<FCubiquityRecordedEvent> queueAll(FCubiquityBrushQueue& queue, const TArray<FCubiquityRecordedEvent>& brushes)
+	{
+		for (const FCubiquityRecordedEvent& brush : brushes)
+		{
+			queue.add(brush, NodeSize, 0.0);
+		}
+		TArray<FCubiquityRecordedEvent> taken;
+		queue.take(taken);
+		return taken;
+	}
+
+	//The x of each brush, for strokes along the x axis
+	FString positionsOf(const TArray<FCubiquityRecordedEvent>& events)
+	{
+		FString positions;
+		for (const FCubiquityRecordedEvent& event : events)
+		{
+			positions += FString::Printf(TEXT("%s%.2f"), positions.IsEmpty() ? TEXT("") : TEXT(" "), event.position.X);
+		}
+		return positions;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityBrushQueueCoalescingTest, "Cubiquity.BrushQueue.Coalescing", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityBrushQueueCoalescingTest::RunTest(const FString& Parameters)
+{
+	TestTrue(TEXT("Sculpts are queued"), FCubiquityBrushQueue::isBrush(makeSculpt(FVector::ZeroVector, 1.0f)));
+	TestTrue(TEXT("as are paints"), FCubiquityBrushQueue::isBrush(makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector::ZeroVector, 1.0f)));
+	TestTrue(TEXT("and blurs"), FCubiquityBrushQueue::isBrush(makeBrush(ECubiquityRecordedOp::BlurTerrain, FVector::ZeroVector, 1.0f)));
+	TestFalse(TEXT("but not explosions"), FCubiquityBrushQueue::isBrush(makeBrush(ECubiquityRecordedOp::Explosion, FVector::ZeroVector, 1.0f)));
+
+	//A held mouse button over one spot
+	{
+		FCubiquityBrushQueue queue;
+		TArray<FCubiquityRecordedEvent> held;
+		for (int32 i = 0; i < 5; ++i)
+		{
+			held.Add(makeSculpt(FVector(10.0f, 10.0f, 10.0f), 0.5f));
+		}
+		const TArray<FCubiquityRecordedEvent> taken = queueAll(queue, held);
+		TestEqual(TEXT("Brushes on one spot become one"), taken.Num(), 1);
+		TestEqual(TEXT("with their opacities added"), taken[0].opacity, 2.5f);
+		TestEqual(TEXT("Every brush is counted"), queue.brushesQueued, 5);
+		TestEqual(TEXT("and every merge"), queue.brushesMerged, 4);
+		TestEqual(TEXT("as one pass"), queue.passesApplied, 1);
+		TestTrue(TEXT("which saves re-meshing the nodes under it"), queue.remeshesAvoided >= 4);
+	}
+
+	TArray<FCubiquityRecordedEvent> strong;
+	for (int32 i = 0; i < 10; ++i)
+	{
+		strong.Add(makeSculpt(FVector::ZeroVector, -0.8f));
+	}
+	FCubiquityBrushQueue strongQueue;
+	TestEqual(TEXT("Merged sculpts stop at the most replication can send"), queueAll(strongQueue, strong)[0].opacity, -float(FCubiquityBrushQueue::MaximumSculptOpacity));
+
+	TArray<FCubiquityRecordedEvent> paints;
+	paints.Add(makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector::ZeroVector, 0.6f, 4.0f, 2));
+	paints.Add(makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector::ZeroVector, 0.6f, 4.0f, 2));
+	FCubiquityBrushQueue paintQueue;
+	TestEqual(TEXT("Merged paints stop at fully painted"), queueAll(paintQueue, paints)[0].opacity, 1.0f);
+
+	TArray<FCubiquityRecordedEvent> weighted;
+	weighted.Add(makeSculpt(FVector(0.0f, 0.0f, 0.0f), 0.3f));
+	weighted.Add(makeSculpt(FVector(1.0f, 0.0f, 0.0f), 0.1f));
+	FCubiquityBrushQueue weightedQueue;
+	TestEqual(TEXT("A merged brush sits at the opacity weighted centre"), queueAll(weightedQueue, weighted)[0].position.X, 0.25f);
+
+	//Brushes which aren't the same brush
+	struct FUnmergeable
+	{
+		const TCHAR* what;
+		FCubiquityRecordedEvent second;
+	};
+	const FCubiquityRecordedEvent first = makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector::ZeroVector, 0.5f, 4.0f, 1);
+	const FUnmergeable unmergeable[] =
+	{
+		{ TEXT("Brushes of different ops don't merge"), makeBrush(ECubiquityRecordedOp::BlurTerrain, FVector::ZeroVector, 0.5f, 4.0f, 1) },
+		{ TEXT("Paints of different materials don't merge"), makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector::ZeroVector, 0.5f, 4.0f, 2) },
+		{ TEXT("Brushes of different sizes don't merge"), makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector::ZeroVector, 0.5f, 5.0f, 1) },
+		{ TEXT("Brushes pushing different ways don't merge"), makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector::ZeroVector, -0.5f, 4.0f, 1) },
+		{ TEXT("Brushes further apart than mergeDistance don't merge"), makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector(2.1f, 0.0f, 0.0f), 0.5f, 4.0f, 1) },
+	};
+	for (const FUnmergeable& pair : unmergeable)
+	{
+		TArray<FCubiquityRecordedEvent> brushes;
+		brushes.Add(first);
+		brushes.Add(pair.second);
+		FCubiquityBrushQueue queue;
+		TestEqual(pair.what, queueAll(queue, brushes).Num(), 2);
+	}
+
+	//A brush can't jump an overlapping brush, as that would change which went on top
+	TArray<FCubiquityRecordedEvent> overlapping;
+	overlapping.Add(makeSculpt(FVector::ZeroVector, 0.5f));
+	overlapping.Add(makeBrush(ECubiquityRecordedOp::PaintTerrain, FVector(1.0f, 0.0f, 0.0f), 0.5f));
+	overlapping.Add(makeSculpt(FVector::ZeroVector, 0.5f));
+	FCubiquityBrushQueue overlappingQueue;
+	const TArray<FCubiquityRecordedEvent> inOrder = queueAll(overlappingQueue, overlapping);
+	TestEqual(TEXT("A brush isn't merged past one it overlaps"), inOrder.Num(), 3);
+	TestTrue(TEXT("and they come out in the order they went in"), inOrder.Num() == 3 && inOrder[1].op == ECubiquityRecordedOp::PaintTerrain);
+
+	overlapping[1].position = FVector(100.0f, 0.0f, 0.0f);
+	FCubiquityBrushQueue apartQueue;
+	TestEqual(TEXT("but is merged past one elsewhere"), queueAll(apartQueue, overlapping).Num(), 2);
+
+	//Waiting for the window
+	FCubiquityBrushQueue queue;
+	TestFalse(TEXT("An empty queue is never due"), queue.isDue(100.0, 0.0f));
+	queue.add(makeSculpt(FVector::ZeroVector, 0.5f), NodeSize, 1.0);
+	queue.add(makeSculpt(FVector(50.0f, 0.0f, 0.0f), 0.5f), NodeSize, 1.125);
+	TestFalse(TEXT("A brush isn't due before its window is up"), queue.isDue(1.125, 0.25f));
+	TestTrue(TEXT("and is once the oldest brush has waited it"), queue.isDue(1.25, 0.25f));
+	TestTrue(TEXT("Anything queued is due with no window"), queue.isDue(1.0, 0.0f));
+
+	TArray<FCubiquityRecordedEvent> taken;
+	queue.take(taken);
+	queue.take(taken);
+	TestEqual(TEXT("Taking an empty queue isn't a pass"), queue.passesApplied, 1);
+	TestTrue(TEXT("Taking empties the queue"), queue.isEmpty() && taken.Num() == 2);
+
+	queue.add(makeSculpt(FVector::ZeroVector, 0.5f), NodeSize, 2.0);
+	queue.reset();
+	TestTrue(TEXT("Resetting drops what was queued"), queue.isEmpty());
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityBrushQueueStrokeTest, "Cubiquity.BrushQueue.Stroke", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityBrushQueueStrokeTest::RunTest(const FString& Parameters)
+{
+	const FCubiquityRecordedEvent brush = makeSculpt(FVector::ZeroVector, 0.25f);
+
+	//Without merging, to see where each brush goes
+	FCubiquityBrushQueue queue;
+	queue.mergeDistance = 0.0f;
+	TArray<FVector> path;
+	path.Add(FVector(0.0f, 0.0f, 0.0f));
+	path.Add(FVector(0.4f, 0.0f, 0.0f));
+	queue.stroke(path, 1.0f, brush, NodeSize, 0.0);
+
+	//The next frame's path starts where the last one ended, so carries on its spacing
+	path.Reset();
+	path.Add(FVector(0.4f, 0.0f, 0.0f));
+	path.Add(FVector(2.5f, 0.0f, 0.0f));
+	path.Add(FVector(2.5f, 0.0f, 0.0f));
+	path.Add(FVector(3.5f, 0.0f, 0.0f));
+	queue.stroke(path, 1.0f, brush, NodeSize, 0.0);
+
+	TArray<FCubiquityRecordedEvent> taken;
+	queue.take(taken);
+	TestEqual(TEXT("A stroke is evenly spaced across frames and corners"), positionsOf(taken), FString(TEXT("0.00 1.00 2.00 3.00")));
+
+	//One somewhere else starts again
+	path.Reset();
+	path.Add(FVector(50.0f, 0.0f, 0.0f));
+	path.Add(FVector(51.0f, 0.0f, 0.0f));
+	queue.stroke(path, 1.0f, brush, NodeSize, 0.0);
+	taken.Reset();
+	queue.take(taken);
+	TestEqual(TEXT("A path which doesn't carry on the last starts a new stroke"), positionsOf(taken), FString(TEXT("50.00 51.00")));
+
+	queue.reset();
+	path.Reset();
+	path.Add(FVector(51.0f, 0.0f, 0.0f));
+	path.Add(FVector(51.5f, 0.0f, 0.0f));
+	queue.stroke(path, 1.0f, brush, NodeSize, 0.0);
+	taken.Reset();
+	queue.take(taken);
+	TestEqual(TEXT("and so does one after a reset"), positionsOf(taken), FString(TEXT("51.00")));
+
+	//A quarter of the brush apart when no spacing is given
+	FCubiquityBrushQueue spaced;
+	spaced.mergeDistance = 0.0f;
+	path.Reset();
+	path.Add(FVector(0.0f, 0.0f, 0.0f));
+	path.Add(FVector(2.0f, 0.0f, 0.0f));
+	spaced.stroke(path, 0.0f, brush, NodeSize, 0.0);
+	taken.Reset();
+	spaced.take(taken);
+	TestEqual(TEXT("Strokes default to a quarter of the brush apart"), positionsOf(taken), FString(TEXT("0.00 1.00 2.00")));
+
+	//Merging along a stroke groups nearby brushes without creeping into one long brush
+	FCubiquityBrushQueue merging;
+	path.Reset();
+	path.Add(FVector(0.0f, 0.0f, 0.0f));
+	path.Add(FVector(10.0f, 0.0f, 0.0f));
+	merging.stroke(path, 1.0f, brush, NodeSize, 0.0);
+	taken.Reset();
+	merging.take(taken);
+	TestEqual(TEXT("A stroke's brushes are all queued"), merging.brushesQueued, 11);
+	TestEqual(TEXT("and merge in threes, each within half a brush of where its first was"), positionsOf(taken), FString(TEXT("1.00 4.00 7.00 9.50")));
+	TestEqual(TEXT("Merging counts every brush it saves"), merging.brushesMerged, 7);
+	TestEqual(TEXT("with each merged brush as strong as the three"), taken[0].opacity, 0.75f);
+	return true;
+}
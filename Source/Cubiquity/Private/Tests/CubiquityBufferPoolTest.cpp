@@ -0,0 +1,130 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityBufferPool.h"
+#include "CubiquityMeshConverter.h"
+#include "CubiquityBenchmarkVolume.h"
+
+#include "AutomationTest.h"
+
+namespace
+{
+	//The first node down the octree with a mesh, or nullptr
+	const Cubiquity::OctreeNode* findMeshedNode(const Cubiquity::OctreeNode& octreeNode, TArray<Cubiquity::OctreeNode>& nodes)
+	{
+		if (octreeNode.hasMesh())
+		{
+			return &octreeNode;
+		}
+
+		for (uint32 z = 0; z < 2; z++)
+		{
+			for (uint32 y = 0; y < 2; y++)
+			{
+				for (uint32 x = 0; x < 2; x++)
+				{
+					if (octreeNode.hasChildNode({ x, y, z }))
+					{
+						//Kept here since OctreeNode::childNode() hands back a value
+						nodes.Add(octreeNode.childNode({ x, y, z }));
+						if (const Cubiquity::OctreeNode* meshed = findMeshedNode(nodes.Last(), nodes))
+						{
+							return meshed;
+						}
+					}
+				}
+			}
+		}
+		return nullptr;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityBufferPoolCountersTest, "Cubiquity.BufferPool.Counters", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityBufferPoolCountersTest::RunTest(const FString& Parameters)
+{
+	//The pool is shared with everything else which meshes, so only what this test does to it is looked at
+	TCubiquityBufferPool<int32>& pool = TCubiquityBufferPool<int32>::get();
+	const uint32 allocations = pool.allocations;
+	const uint32 reuses = pool.reuses;
+
+	//Bigger than the pool will hold, so nothing already pooled can serve it
+	const int32 tooBigToPool = pool.maxPooledBytes / sizeof(int32) + 1;
+
+	TArray<int32> first;
+	pool.acquire(first, tooBigToPool);
+	TestEqual(TEXT("A buffer nothing can serve is allocated"), int32(pool.allocations - allocations), 1);
+	TestTrue(TEXT("with room for what was asked"), first.Max() >= tooBigToPool);
+
+	pool.acquire(first, 100);
+	TestEqual(TEXT("A buffer big enough already keeps its allocation"), int32(pool.reuses - reuses), 1);
+	TestEqual(TEXT("without another allocation"), int32(pool.allocations - allocations), 1);
+
+	pool.release(first);
+	TestEqual(TEXT("An allocation too big for the pool is freed"), first.Max(), 0);
+
+	pool.acquire(first, tooBigToPool);
+	TestEqual(TEXT("so the next buffer that size is allocated again"), int32(pool.allocations - allocations), 2);
+	pool.release(first);
+
+	TArray<int32> second;
+	pool.acquire(second, 1000);
+	const uint32 allocationsBeforeRelease = pool.allocations;
+	pool.release(second);
+	pool.acquire(second, 1000);
+	TestEqual(TEXT("A released allocation serves the next buffer"), int32(pool.allocations - allocationsBeforeRelease), 0);
+	TestTrue(TEXT("which has room for what was asked"), second.Max() >= 1000);
+	pool.release(second);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityBufferPoolSteadyStateTest, "Cubiquity.BufferPool.SteadyState", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityBufferPoolSteadyStateTest::RunTest(const FString& Parameters)
+{
+	const int32 size = 32;
+	const int32 height = 16;
+	Cubiquity::ColoredCubesVolume volume({ 0, 0, 0 }, { size - 1, size - 1, height - 1 }, "BufferPoolTest.vdb", 16);
+	FCubiquityBenchmarkVolume::generateColoredCubes(volume, size, height);
+	for (int32 update = 0; update < 1000 && !volume.update({ 0.0f, 0.0f, 0.0f }, 1.0f); ++update)
+	{
+	}
+
+	//Reserved so the nodes found don't move while the octree is searched
+	TArray<Cubiquity::OctreeNode> nodes;
+	nodes.Reserve(1024);
+	const Cubiquity::OctreeNode* meshed = nullptr;
+	if (volume.hasRootOctreeNode())
+	{
+		nodes.Add(volume.rootOctreeNode());
+		meshed = findMeshedNode(nodes[0], nodes);
+	}
+	TestTrue(TEXT("The volume has a node with a mesh"), meshed != nullptr);
+	if (!meshed)
+	{
+		return false;
+	}
+
+	FCubiquityConversionSettings settings;
+	settings.volumeType = Cubiquity::VolumeType::ColoredCubes;
+
+	//A node meshed again after its old mesh went should find the old mesh's buffers in the pool
+	{
+		FCubiquityMeshData meshData;
+		FCubiquityMeshConverter::convert(*meshed, settings, meshData);
+	}
+
+	const uint32 allocations = TCubiquityBufferPool<FColoredCubesVertex>::get().allocations + TCubiquityBufferPool<int32>::get().allocations;
+	for (int32 remesh = 0; remesh < 4; ++remesh)
+	{
+		FCubiquityMeshData meshData;
+		FCubiquityMeshConverter::convert(*meshed, settings, meshData);
+		TestTrue(TEXT("The mesh has triangles"), meshData.hasTriangles());
+	}
+	const uint32 steadyAllocations = TCubiquityBufferPool<FColoredCubesVertex>::get().allocations + TCubiquityBufferPool<int32>::get().allocations - allocations;
+	TestEqual(TEXT("Remeshing in steady state doesn't allocate"), int32(steadyAllocations), 0);
+
+	return true;
+}
@@ -0,0 +1,223 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityEditSave.h"
+#include "CubiquityBenchmarkVolume.h"
+
+#include "AutomationTest.h"
+
+namespace
+{
+	//Runs of one voxel, of more than a byte's count and of everything in between
+	void makeVoxels(int32 bytesPerVoxel, TArray<uint8>& outVoxels)
+	{
+		const int32 runLengths[] = { 1, 1, 2, 300, 127, 128, 5, 1, 17000 };
+		uint8 value = 1;
+		for (int32 length : runLengths)
+		{
+			for (int32 i = 0; i < length; ++i)
+			{
+				for (int32 byte = 0; byte < bytesPerVoxel; ++byte)
+				{
+					outVoxels.Add(uint8(value + byte));
+				}
+			}
+			value += 3;
+		}
+	}
+
+	//Whether a damaged blob is turned down by both isLoadable() and load(), and load() leaves the volume alone
+	bool refused(Cubiquity::Volume& volume, const TArray<uint8>& blob)
+	{
+		TArray<uint8> before;
+		FCubiquityVoxelChunk::read(volume, FIntVector(0, 0, 0), before);
+
+		FMemoryReader checker(blob, true);
+		const bool loadable = FCubiquityEditSave::isLoadable(checker);
+
+		FMemoryReader reader(blob, true);
+		TArray<FIntVector> chunks;
+		const bool loaded = FCubiquityEditSave::load(volume, reader, chunks);
+
+		TArray<uint8> after;
+		FCubiquityVoxelChunk::read(volume, FIntVector(0, 0, 0), after);
+		return !loadable && !loaded && chunks.Num() == 0 && before == after;
+	}
+
+	//Where the fields after the chunk list start, for a blob with `chunkCount` chunks
+	int32 sizesOffset(int32 chunkCount)
+	{
+		return sizeof(uint32) + sizeof(int32) + sizeof(uint8) + sizeof(int32) + sizeof(int32) + chunkCount * sizeof(int32) * 4;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityEditSaveRunLengthTest, "Cubiquity.EditSave.RunLength", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityEditSaveRunLengthTest::RunTest(const FString& Parameters)
+{
+	for (int32 bytesPerVoxel : { 4, 8 })
+	{
+		const FString type = FString::Printf(TEXT("%d byte voxels"), bytesPerVoxel);
+
+		TArray<uint8> voxels;
+		makeVoxels(bytesPerVoxel, voxels);
+
+		//Two chunks' worth one after another, as save() writes them
+		TArray<uint8> runs;
+		FCubiquityEditSave::runLengthEncode(voxels, bytesPerVoxel, runs);
+		const int32 firstRuns = runs.Num();
+		FCubiquityEditSave::runLengthEncode(voxels, bytesPerVoxel, runs);
+		TestEqual(type + TEXT(" encode the same way each time"), runs.Num(), firstRuns * 2);
+		TestTrue(type + TEXT(" shrink when they are in runs"), firstRuns < voxels.Num() / 100);
+
+		int32 position = 0;
+		TArray<uint8> decoded;
+		TestTrue(type + TEXT(" decode"), FCubiquityEditSave::runLengthDecode(runs, position, bytesPerVoxel, voxels.Num(), decoded));
+		TestTrue(type + TEXT(" as they were"), decoded == voxels);
+		TestEqual(type + TEXT(" using up one chunk's runs"), position, firstRuns);
+		TestTrue(type + TEXT(" and then the next chunk's"), FCubiquityEditSave::runLengthDecode(runs, position, bytesPerVoxel, voxels.Num(), decoded) && decoded == voxels);
+		TestEqual(type + TEXT(" ending at the end"), position, runs.Num());
+
+		//Runs which end early, overrun the chunk or make no sense
+		TArray<uint8> truncated = runs;
+		truncated.SetNum(firstRuns - 1);
+		position = 0;
+		TestFalse(type + TEXT(" which are cut short don't decode"), FCubiquityEditSave::runLengthDecode(truncated, position, bytesPerVoxel, voxels.Num(), decoded));
+
+		position = 0;
+		TestFalse(type + TEXT(" which run past the chunk don't decode"), FCubiquityEditSave::runLengthDecode(runs, position, bytesPerVoxel, voxels.Num() - bytesPerVoxel, decoded));
+
+		TArray<uint8> empty;
+		empty.Add(0);
+		empty.AddZeroed(bytesPerVoxel);
+		position = 0;
+		TestFalse(type + TEXT(" in a run of none don't decode"), FCubiquityEditSave::runLengthDecode(empty, position, bytesPerVoxel, bytesPerVoxel, decoded));
+
+		TArray<uint8> endless;
+		endless.Init(0x80, 8);
+		endless.AddZeroed(bytesPerVoxel);
+		position = 0;
+		TestFalse(type + TEXT(" with a count longer than 32 bits don't decode"), FCubiquityEditSave::runLengthDecode(endless, position, bytesPerVoxel, bytesPerVoxel, decoded));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityEditSaveBlobTest, "Cubiquity.EditSave.Blob", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityEditSaveBlobTest::RunTest(const FString& Parameters)
+{
+	const int32 size = 64;
+	const int32 height = 16;
+	Cubiquity::ColoredCubesVolume volume({ 0, 0, 0 }, { size - 1, size - 1, height - 1 }, "EditSaveTest.vdb", 16);
+	FCubiquityBenchmarkVolume::generateColoredCubes(volume, size, height);
+
+	//Edits in two chunks, which are saved
+	TSet<FIntVector> edited;
+	edited.Add(FIntVector(1, 0, 0));
+	edited.Add(FIntVector(0, 0, 0));
+	for (int32 i = 0; i < 40; ++i)
+	{
+		volume.setVoxel({ i, i % 7, i % height }, Cubiquity::Color(uint8(i * 5), 200, uint8(255 - i), 255));
+	}
+	TArray<uint8> saved[2];
+	FCubiquityVoxelChunk::read(volume, FIntVector(0, 0, 0), saved[0]);
+	FCubiquityVoxelChunk::read(volume, FIntVector(1, 0, 0), saved[1]);
+
+	TArray<uint8> blob;
+	FMemoryWriter writer(blob, true);
+	TestTrue(TEXT("The edits save"), FCubiquityEditSave::save(volume, edited, writer));
+	AddLogItem(FString::Printf(TEXT("Two chunks of %d bytes saved in %d"), saved[0].Num(), blob.Num()));
+	TestTrue(TEXT("in less than their voxels"), blob.Num() < saved[0].Num());
+
+	TArray<uint8> again;
+	FMemoryWriter againWriter(again, true);
+	FCubiquityEditSave::save(volume, edited, againWriter);
+	TestTrue(TEXT("The same edits make the same blob"), again == blob);
+
+	FMemoryReader checker(blob, true);
+	TestTrue(TEXT("The blob is loadable"), FCubiquityEditSave::isLoadable(checker));
+
+	//Edits since the save are put back as they were
+	for (int32 x = 0; x < size; ++x)
+	{
+		volume.setVoxel({ x, 3, 2 }, Cubiquity::Color(0, 0, 0, 0));
+	}
+	FMemoryReader reader(blob, true);
+	TArray<FIntVector> loaded;
+	TestTrue(TEXT("The blob loads"), FCubiquityEditSave::load(volume, reader, loaded));
+	TestTrue(TEXT("into the chunks it was saved from, in order"), loaded.Num() == 2 && loaded[0] == FIntVector(0, 0, 0) && loaded[1] == FIntVector(1, 0, 0));
+	TArray<uint8> restored[2];
+	FCubiquityVoxelChunk::read(volume, FIntVector(0, 0, 0), restored[0]);
+	FCubiquityVoxelChunk::read(volume, FIntVector(1, 0, 0), restored[1]);
+	TestTrue(TEXT("with the voxels they had"), restored[0] == saved[0] && restored[1] == saved[1]);
+
+	TArray<uint8> nothing;
+	FMemoryWriter nothingWriter(nothing, true);
+	FCubiquityEditSave::save(volume, TSet<FIntVector>(), nothingWriter);
+	FMemoryReader nothingReader(nothing, true);
+	TArray<FIntVector> nothingLoaded;
+	TestTrue(TEXT("A blob with no chunks loads"), FCubiquityEditSave::load(volume, nothingReader, nothingLoaded));
+	TestEqual(TEXT("and writes nothing"), nothingLoaded.Num(), 0);
+
+	//From here every load has to be refused without touching the volume
+	volume.setVoxel({ 1, 1, 1 }, Cubiquity::Color(9, 9, 9, 255));
+
+	TArray<uint8> newer = blob;
+	newer[4] = uint8(FCubiquityEditSave::Version + 1);
+	TestTrue(TEXT("A blob from another version is refused"), refused(volume, newer));
+
+	TArray<uint8> notEdits = blob;
+	notEdits[0] ^= 0xFF;
+	TestTrue(TEXT("Something which isn't a blob is refused"), refused(volume, notEdits));
+
+	int32 truncationsLoaded = 0;
+	for (int32 length = 0; length < blob.Num(); ++length)
+	{
+		TArray<uint8> truncated = blob;
+		truncated.SetNum(length);
+		truncationsLoaded += refused(volume, truncated) ? 0 : 1;
+	}
+	TestEqual(TEXT("A blob cut short anywhere is refused"), truncationsLoaded, 0);
+
+	const int32 sizes = sizesOffset(2);
+	TArray<uint8> damaged = blob;
+	damaged.Last() ^= 0x01;
+	TestTrue(TEXT("A blob with a damaged byte fails its checksum"), refused(volume, damaged));
+
+	TArray<uint8> wrongChecksum = blob;
+	wrongChecksum[sizes + sizeof(int64) + sizeof(int32)] ^= 0x10;
+	TestTrue(TEXT("A blob with the wrong checksum is refused"), refused(volume, wrongChecksum));
+
+	TArray<uint8> hugeRuns = blob;
+	hugeRuns[sizes + sizeof(int64) - 1] = 0x7F;
+	TestTrue(TEXT("A blob claiming more runs than its chunks can hold is refused"), refused(volume, hugeRuns));
+
+	TArray<uint8> hugeCount = blob;
+	hugeCount[sizesOffset(0) - 1] = 0x7F;
+	TestTrue(TEXT("A blob claiming more chunks than it has is refused"), refused(volume, hugeCount));
+
+	TArray<uint8> oddChunk = blob;
+	oddChunk[sizesOffset(0) + sizeof(int32) * 3] += 1;
+	TestTrue(TEXT("A chunk whose size isn't whole voxels is refused"), refused(volume, oddChunk));
+
+	//Loadable, but not on this volume
+	Cubiquity::TerrainVolume terrain({ 0, 0, 0 }, { 31, 31, 31 }, "EditSaveTestTerrain.vdb", 16);
+	TSet<FIntVector> terrainChunks;
+	terrainChunks.Add(FIntVector(0, 0, 0));
+	TArray<uint8> terrainBlob;
+	FMemoryWriter terrainWriter(terrainBlob, true);
+	FCubiquityEditSave::save(terrain, terrainChunks, terrainWriter);
+	FMemoryReader terrainChecker(terrainBlob, true);
+	TestTrue(TEXT("A terrain blob is loadable"), FCubiquityEditSave::isLoadable(terrainChecker));
+	FMemoryReader terrainReader(terrainBlob, true);
+	TArray<FIntVector> terrainLoaded;
+	TestFalse(TEXT("but not onto colored cubes"), FCubiquityEditSave::load(volume, terrainReader, terrainLoaded));
+
+	Cubiquity::ColoredCubesVolume smaller({ 0, 0, 0 }, { size - 1, size - 1, height / 2 - 1 }, "EditSaveTestSmaller.vdb", 16);
+	FMemoryReader smallerReader(blob, true);
+	TArray<FIntVector> smallerLoaded;
+	TestFalse(TEXT("A blob is refused by a volume its chunks don't fit"), FCubiquityEditSave::load(smaller, smallerReader, smallerLoaded));
+	TestEqual(TEXT("which is left as it was"), smallerLoaded.Num(), 0);
+	return true;
+}
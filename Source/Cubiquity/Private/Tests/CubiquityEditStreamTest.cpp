@@ -0,0 +1,356 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityEditStream.h"
+#include "CubiquityBrushEngine.h"
+#include "CubiquityBrushQueue.h"
+#include "CubiquityVoxelChunk.h"
+
+#include "AutomationTest.h"
+
+namespace
+{
+	FCubiquityRecordedEvent makeOp(ECubiquityRecordedOp op, const FVector& position, uint64 value = 0)
+	{
+		FCubiquityRecordedEvent event;
+		event.op = op;
+		event.position = position;
+		event.value = value;
+		return event;
+	}
+
+	FCubiquityRecordedEvent makeBrushOp(ECubiquityRecordedOp op, const FVector& position, float innerRadius, float outerRadius, float opacity, uint64 value = 0)
+	{
+		FCubiquityRecordedEvent event = makeOp(op, position, value);
+		event.innerRadius = innerRadius;
+		event.outerRadius = outerRadius;
+		event.opacity = opacity;
+		return event;
+	}
+
+	//One of every op a server sends, none of them on the grid the stream rounds to
+	void makeOps(TArray<FCubiquityRecordedEvent>& outEvents)
+	{
+		outEvents.Add(makeOp(ECubiquityRecordedOp::SetColoredCubesVoxel, FVector(10.7f, 3.2f, 5.9f), FColor(255, 0, 255, 128).DWColor()));
+		outEvents.Add(makeOp(ECubiquityRecordedOp::SetTerrainVoxel, FVector(11.0f, 3.0f, 5.0f), 0x0102030405060708ull));
+
+		FCubiquityRecordedEvent fill = makeOp(ECubiquityRecordedOp::FillColoredCubesRegion, FVector(20.0f, 20.0f, 8.0f), FColor(1, 2, 3, 255).DWColor());
+		fill.extent = FVector(4.0f, 2.0f, 3.0f);
+		outEvents.Add(fill);
+
+		outEvents.Add(makeBrushOp(ECubiquityRecordedOp::SculptTerrain, FVector(12.3f, 40.06f, 7.77f), 2.31f, 4.49f, -0.333f));
+		outEvents.Add(makeBrushOp(ECubiquityRecordedOp::PaintTerrain, FVector(12.9f, 40.5f, 7.0f), 2.0f, 3.0f, 0.5f, 3));
+		outEvents.Add(makeBrushOp(ECubiquityRecordedOp::BlurTerrain, FVector(-3.4f, 0.01f, 2.2f), 1.0f, 2.6f, 1.0f));
+		outEvents.Add(makeBrushOp(ECubiquityRecordedOp::Explosion, FVector(30.2f, 31.1f, 4.05f), 5.0f, 6.51f, 0.3f, 4));
+
+		//A chunk of voxels as a checkpoint restore writes them back
+		TArray<uint8> voxels;
+		voxels.SetNumZeroed(FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * FCubiquityVoxelChunk::Size * sizeof(uint32));
+		for (int32 i = 0; i < voxels.Num(); i += 7)
+		{
+			voxels[i] = uint8(i / 7);
+		}
+		FCubiquityRecordedEvent chunk = makeOp(ECubiquityRecordedOp::WriteChunk, FCubiquityVoxelChunk::centre(FIntVector(1, 0, -1)), voxels.Num());
+		FCubiquityVoxelChunk::compress(voxels, chunk.payload);
+		outEvents.Add(chunk);
+
+		FCubiquityBrush brush;
+		brush.shape = ECubiquityBrushShape::Box;
+		brush.mode = ECubiquityBrushMode::Remove;
+		brush.size = FVector(3.0f, 2.0f, 1.0f);
+		FCubiquityRecordedEvent kernel = makeOp(ECubiquityRecordedOp::BrushKernel, FVector(5.06f, 5.0f, 5.0f));
+		FCubiquityBrushEngine::save(brush, kernel.payload);
+		kernel.outerRadius = FCubiquityBrushEngine::halfExtent(brush).GetMax();
+		outEvents.Add(kernel);
+
+		outEvents.Add(makeOp(ECubiquityRecordedOp::DiscardChanges, FVector::ZeroVector));
+	}
+
+	//Everything but the time, which isn't sent
+	bool sameOp(const FCubiquityRecordedEvent& a, const FCubiquityRecordedEvent& b)
+	{
+		return a.op == b.op && a.position == b.position && a.extent == b.extent && a.innerRadius == b.innerRadius && a.outerRadius == b.outerRadius
+			&& a.opacity == b.opacity && a.value == b.value && a.payload == b.payload;
+	}
+
+	//Voxel sets scattered about the volume, so their positions don't pack down to nothing
+	void makeVoxelSets(int32 count, TArray<FCubiquityRecordedEvent>& outEvents)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			outEvents.Add(makeOp(ECubiquityRecordedOp::SetColoredCubesVoxel, FVector((i * 37) % 500, (i * 11) % 300, i % 60), 0xFF000000u | uint32(i)));
+		}
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityEditStreamQuantiseTest, "Cubiquity.EditStream.Quantise", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityEditStreamQuantiseTest::RunTest(const FString& Parameters)
+{
+	TArray<FCubiquityRecordedEvent> events;
+	makeOps(events);
+
+	for (const FCubiquityRecordedEvent& event : events)
+	{
+		const FCubiquityRecordedEvent quantised = FCubiquityEditStream::quantise(event);
+		const FString op = FString::Printf(TEXT("Op %d"), int32(event.op));
+		TestTrue(op + TEXT(" stays the same op"), quantised.op == event.op);
+		TestTrue(op + TEXT(" doesn't change when quantised again"), sameOp(FCubiquityEditStream::quantise(quantised), quantised));
+	}
+
+	//Voxels are truncated the way applyTo() does
+	TestTrue(TEXT("A voxel set is rounded to the voxel it changes"), FCubiquityEditStream::quantise(events[0]).position == FVector(10.0f, 3.0f, 5.0f));
+	TestEqual(TEXT("with its colour as it was"), int32(FCubiquityEditStream::quantise(events[0]).value), int32(events[0].value));
+	TestTrue(TEXT("A terrain voxel keeps all 64 bits of its material set"), FCubiquityEditStream::quantise(events[1]).value == events[1].value);
+	TestTrue(TEXT("A fill keeps its region"), sameOp(FCubiquityEditStream::quantise(events[2]), events[2]));
+
+	//Brushes go to eighths of a voxel and opacity to 127ths
+	const FCubiquityRecordedEvent sculpt = FCubiquityEditStream::quantise(events[3]);
+	TestEqual(TEXT("A sculpt is moved to the nearest eighth of a voxel in x"), sculpt.position.X, 12.25f, 0.0f);
+	TestEqual(TEXT("in y"), sculpt.position.Y, 40.0f, 0.0f);
+	TestEqual(TEXT("and in z"), sculpt.position.Z, 7.75f, 0.0f);
+	TestEqual(TEXT("Its inner radius is rounded to an eighth"), sculpt.innerRadius, 2.25f, 0.0f);
+	TestEqual(TEXT("and its outer radius"), sculpt.outerRadius, 4.5f, 0.0f);
+	TestEqual(TEXT("Its opacity is the nearest 127th, keeping its sign"), sculpt.opacity, -42.0f / 127.0f, 0.0f);
+	TestEqual(TEXT("A paint keeps its material"), int32(FCubiquityEditStream::quantise(events[4]).value), 3);
+	TestEqual(TEXT("An explosion keeps its search margin"), int32(FCubiquityEditStream::quantise(events[6]).value), 4);
+
+	//Merged sculpts can go past full opacity, but only so far
+	const FCubiquityRecordedEvent strong = FCubiquityEditStream::quantise(makeBrushOp(ECubiquityRecordedOp::SculptTerrain, FVector::ZeroVector, 1.0f, 2.0f, 2.5f));
+	TestEqual(TEXT("A merged sculpt keeps an opacity over 1"), strong.opacity, 2.5f, 0.5f / 127.0f);
+	const FCubiquityRecordedEvent tooStrong = FCubiquityEditStream::quantise(makeBrushOp(ECubiquityRecordedOp::SculptTerrain, FVector::ZeroVector, 1.0f, 2.0f, -100.0f));
+	TestEqual(TEXT("but it is clamped to the most a queue merges"), tooStrong.opacity, -float(FCubiquityBrushQueue::MaximumSculptOpacity), 0.0f);
+
+	const FCubiquityRecordedEvent chunk = FCubiquityEditStream::quantise(events[7]);
+	TestTrue(TEXT("A chunk write keeps its voxels as they are"), chunk.payload == events[7].payload && chunk.value == events[7].value);
+	TestTrue(TEXT("and its chunk"), FCubiquityVoxelChunk::containing(chunk.position) == FIntVector(1, 0, -1));
+
+	const FCubiquityRecordedEvent kernel = FCubiquityEditStream::quantise(events[8]);
+	TestTrue(TEXT("A brush kernel keeps its brush"), kernel.payload == events[8].payload);
+	TestEqual(TEXT("and the reach the brush gives it, falloff included"), kernel.outerRadius, 4.5f, 0.0f);
+	TestEqual(TEXT("with only its position rounded"), kernel.position.X, 5.0f, 0.0f);
+
+	FCubiquityRecordedEvent camera = makeOp(ECubiquityRecordedOp::Camera, FVector(1.3f, 2.7f, 3.1f));
+	camera.lodThreshold = 1.5f;
+	const FCubiquityRecordedEvent sameCamera = FCubiquityEditStream::quantise(camera);
+	TestTrue(TEXT("Camera events aren't sent so aren't rounded"), sameCamera.position == camera.position && sameCamera.lodThreshold == camera.lodThreshold);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityEditStreamBatchTest, "Cubiquity.EditStream.Batch", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityEditStreamBatchTest::RunTest(const FString& Parameters)
+{
+	TArray<FCubiquityRecordedEvent> ops;
+	makeOps(ops);
+
+	//Several rounds so ops follow others of every kind, with a camera event among them which isn't sent
+	TArray<FCubiquityRecordedEvent> events;
+	for (int32 round = 0; round < 3; ++round)
+	{
+		for (const FCubiquityRecordedEvent& op : ops)
+		{
+			events.Add(FCubiquityEditStream::quantise(op));
+		}
+		events.Add(makeOp(ECubiquityRecordedOp::Camera, FVector(round, round, round)));
+	}
+
+	const FCubiquityEditBatch batch = FCubiquityEditStream::encode(events, 100);
+	TestEqual(TEXT("The batch starts at the sequence number it was given"), int32(batch.firstSequence), 100);
+	TestEqual(TEXT("and has every op but the camera events"), batch.numOps, ops.Num() * 3);
+
+	TArray<FCubiquityRecordedEvent> decoded;
+	TestTrue(TEXT("The batch decodes"), FCubiquityEditStream::decode(batch, decoded));
+	TestEqual(TEXT("to as many ops as went in"), decoded.Num(), batch.numOps);
+	int32 different = 0;
+	for (int32 i = 0, event = 0; i < decoded.Num(); ++i, ++event)
+	{
+		if (events[event].op == ECubiquityRecordedOp::Camera)
+		{
+			++event;
+		}
+		different += sameOp(decoded[i], events[event]) ? 0 : 1;
+	}
+	TestEqual(TEXT("Quantised ops come back exactly"), different, 0);
+
+	//Through the network and back
+	FBitWriter writer(0, true);
+	bool success = false;
+	const_cast<FCubiquityEditBatch&>(batch).NetSerialize(writer, nullptr, success);
+	TestTrue(TEXT("The batch is written to the network"), success);
+	TestEqual(TEXT("in as many bytes as it says"), int32(writer.GetNumBytes()), batch.wireBytes());
+
+	FBitReader reader(writer.GetData(), writer.GetNumBits());
+	FCubiquityEditBatch received;
+	received.NetSerialize(reader, nullptr, success);
+	TestTrue(TEXT("and read back"), success);
+	TestTrue(TEXT("as it was"), received.firstSequence == batch.firstSequence && received.numOps == batch.numOps && received.numBits == batch.numBits && received.data == batch.data);
+
+	//What the header promises for a voxel set and for a brush stroke
+	TArray<FCubiquityRecordedEvent> single;
+	single.Add(events[0]);
+	const FCubiquityEditBatch singleBatch = FCubiquityEditStream::encode(single, 0);
+	AddLogItem(FString::Printf(TEXT("A voxel set in %d bytes, %d with the batch header"), singleBatch.data.Num(), singleBatch.wireBytes()));
+	TestTrue(TEXT("A voxel set costs a few bytes"), singleBatch.data.Num() < 10);
+
+	TArray<FCubiquityRecordedEvent> stroke;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		stroke.Add(makeBrushOp(ECubiquityRecordedOp::SculptTerrain, FVector(100.0f + i, 200.0f, 30.0f), 3.0f, 4.5f, 0.8f));
+	}
+	const FCubiquityEditBatch strokeBatch = FCubiquityEditStream::encode(stroke, 0);
+	AddLogItem(FString::Printf(TEXT("%d sculpt ops in %d bytes"), stroke.Num(), strokeBatch.wireBytes()));
+	TestTrue(TEXT("A brush stroke costs under ten bytes an op"), strokeBatch.wireBytes() < 10 * stroke.Num());
+
+	//A capped batch takes as many ops as fit, and the rest follow in the next one
+	TArray<FCubiquityRecordedEvent> sets;
+	makeVoxelSets(200, sets);
+	int32 taken = 0;
+	const FCubiquityEditBatch capped = FCubiquityEditStream::encode(sets, 5, 256, taken);
+	TestTrue(TEXT("A capped batch takes some ops"), taken > 0 && taken < sets.Num());
+	TestEqual(TEXT("and says how many"), capped.numOps, taken);
+	TestTrue(TEXT("within the cap"), capped.data.Num() <= 256);
+	TArray<FCubiquityRecordedEvent> cappedOps;
+	TestTrue(TEXT("A capped batch decodes"), FCubiquityEditStream::decode(capped, cappedOps));
+	TestTrue(TEXT("to the first ops"), cappedOps.Num() == taken && sameOp(cappedOps[taken - 1], sets[taken - 1]));
+
+	TArray<FCubiquityRecordedEvent> tooBig;
+	tooBig.Add(events[7]);
+	tooBig.Add(events[0]);
+	const FCubiquityEditBatch alone = FCubiquityEditStream::encode(tooBig, 0, 16, taken);
+	TestEqual(TEXT("An op too big for the cap goes in a batch by itself"), alone.numOps, 1);
+
+	//Corrupt batches are turned down and leave nothing behind
+	TArray<FCubiquityRecordedEvent> rejected;
+	FCubiquityEditBatch truncated = batch;
+	truncated.numBits /= 2;
+	TestFalse(TEXT("A truncated batch doesn't decode"), FCubiquityEditStream::decode(truncated, rejected));
+	TestEqual(TEXT("and gives no ops"), rejected.Num(), 0);
+
+	FCubiquityEditBatch overlong = batch;
+	overlong.numBits = overlong.data.Num() * 8 + 1;
+	TestFalse(TEXT("A batch with more bits than bytes doesn't decode"), FCubiquityEditStream::decode(overlong, rejected));
+
+	FCubiquityEditBatch extraOps = batch;
+	extraOps.numOps += 1;
+	TestFalse(TEXT("A batch claiming more ops than it has doesn't decode"), FCubiquityEditStream::decode(extraOps, rejected));
+	TestEqual(TEXT("and gives no ops"), rejected.Num(), 0);
+
+	//A chunk write claiming more voxels than any chunk has mustn't get as far as allocating them
+	FCubiquityRecordedEvent hugeChunk = events[7];
+	hugeChunk.value = 0x7FFFFFFF;
+	TArray<FCubiquityRecordedEvent> huge;
+	huge.Add(hugeChunk);
+	TestFalse(TEXT("A chunk bigger than a chunk can be doesn't decode"), FCubiquityEditStream::decode(FCubiquityEditStream::encode(huge, 0), rejected));
+
+	FCubiquityEditBatch garbage = batch;
+	for (int32 i = 0; i < garbage.data.Num(); i += 3)
+	{
+		garbage.data[i] ^= 0x5A;
+	}
+	FCubiquityEditStream::decode(garbage, rejected);
+	AddLogItem(FString::Printf(TEXT("A scrambled batch decoded to %d ops without crashing"), rejected.Num()));
+
+	FBitWriter hostile(0, true);
+	uint32 sequence = 0;
+	uint32 numOps = 1;
+	uint32 numBits = 0x7FFFFFFF;
+	hostile.SerializeIntPacked(sequence);
+	hostile.SerializeIntPacked(numOps);
+	hostile.SerializeIntPacked(numBits);
+	FBitReader hostileReader(hostile.GetData(), hostile.GetNumBits());
+	FCubiquityEditBatch hostileBatch;
+	hostileBatch.NetSerialize(hostileReader, nullptr, success);
+	TestFalse(TEXT("A batch claiming gigabytes isn't read off the network"), success);
+	TestEqual(TEXT("and nothing is allocated for it"), hostileBatch.data.Num(), 0);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityEditStreamSequenceTest, "Cubiquity.EditStream.Sequence", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityEditStreamSequenceTest::RunTest(const FString& Parameters)
+{
+	TArray<FCubiquityRecordedEvent> sets;
+	makeVoxelSets(1500, sets);
+
+	FCubiquityEditSender sender;
+	for (const FCubiquityRecordedEvent& set : sets)
+	{
+		sender.queue(set);
+	}
+	sender.queue(makeOp(ECubiquityRecordedOp::Camera, FVector::ZeroVector));
+	sender.queue(makeOp(ECubiquityRecordedOp::CommitChanges, FVector::ZeroVector));
+	TestEqual(TEXT("Camera events and commits aren't queued"), int32(sender.nextSequence()), sets.Num());
+
+	TArray<FCubiquityEditBatch> batches;
+	while (sender.hasEdits())
+	{
+		batches.Add(sender.takeBatch());
+	}
+	TestTrue(TEXT("A burst of edits goes out as several batches"), batches.Num() > 1);
+	TestEqual(TEXT("with every op"), sender.opsSent, sets.Num());
+
+	int32 oversized = 0;
+	int32 gaps = 0;
+	for (int32 i = 0; i < batches.Num(); ++i)
+	{
+		oversized += batches[i].data.Num() > FCubiquityEditSender::MaximumBatchBytes ? 1 : 0;
+		gaps += i > 0 && batches[i].firstSequence != batches[i - 1].firstSequence + batches[i - 1].numOps ? 1 : 0;
+	}
+	TestEqual(TEXT("Every batch fits in MaximumBatchBytes"), oversized, 0);
+	TestEqual(TEXT("and each carries on from the last"), gaps, 0);
+
+	//Backwards, with one arriving twice
+	FCubiquityEditReceiver receiver;
+	for (int32 i = batches.Num() - 1; i >= 0; --i)
+	{
+		receiver.receive(batches[i]);
+	}
+	receiver.receive(batches[0]);
+	TestEqual(TEXT("Batches arriving early are held back"), receiver.batchesOutOfOrder, batches.Num() - 1);
+	TestEqual(TEXT("Every op comes out once"), receiver.ready.Num(), sets.Num());
+	TestEqual(TEXT("and the receiver expects the next one"), int32(receiver.nextSequence()), sets.Num());
+	int32 outOfOrder = 0;
+	for (int32 i = 0; i < receiver.ready.Num() && i < sets.Num(); ++i)
+	{
+		outOfOrder += sameOp(receiver.ready[i], sets[i]) ? 0 : 1;
+	}
+	TestEqual(TEXT("in the order they were queued"), outOfOrder, 0);
+	TestFalse(TEXT("and none were lost"), receiver.lostOps);
+
+	//A corrupt batch is skipped so the ones after it still flow
+	FCubiquityEditBatch corrupt = batches[0];
+	corrupt.numBits = 3;
+	FCubiquityEditReceiver lossy;
+	lossy.receive(corrupt);
+	lossy.receive(batches[1]);
+	TestTrue(TEXT("A corrupt batch marks ops as lost"), lossy.lostOps);
+	TestEqual(TEXT("and is counted"), lossy.batchesCorrupt, 1);
+	TestEqual(TEXT("The batch after it is applied"), lossy.ready.Num(), batches[1].numOps);
+	TestTrue(TEXT("from its first op"), lossy.ready.Num() > 0 && sameOp(lossy.ready[0], sets[batches[1].firstSequence]));
+
+	//A client given the volume as it was part way through the first batch
+	FCubiquityEditReceiver joining;
+	joining.receive(batches[0]);
+	joining.skipTo(5);
+	TestEqual(TEXT("Skipping drops the ops before the sequence number"), joining.ready.Num(), batches[0].numOps - 5);
+	TestTrue(TEXT("and keeps the rest"), joining.ready.Num() > 0 && sameOp(joining.ready[0], sets[5]));
+
+	//And one given it after the first batch, which has the second batch arrive before it skips
+	FCubiquityEditReceiver late;
+	late.receive(batches[1]);
+	late.skipTo(batches[1].firstSequence);
+	TestEqual(TEXT("Skipping releases a batch which was waiting"), late.ready.Num(), batches[1].numOps);
+	late.receive(batches[0]);
+	TestEqual(TEXT("and an older batch arriving afterwards is ignored"), late.ready.Num(), batches[1].numOps);
+
+	//Ops dropped for want of anyone to send them to still use up their numbers
+	FCubiquityEditSender idle;
+	idle.queue(sets[0]);
+	idle.queue(sets[1]);
+	idle.dropPending();
+	TestFalse(TEXT("Dropped ops aren't sent"), idle.hasEdits());
+	TestEqual(TEXT("but keep their sequence numbers"), int32(idle.nextSequence()), 2);
+	return true;
+}
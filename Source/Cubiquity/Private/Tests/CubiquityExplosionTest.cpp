@@ -0,0 +1,144 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityExplosion.h"
+
+#include "AutomationTest.h"
+
+namespace
+{
+	const int32 VolumeSize = 64;
+
+	//A beam balanced on a pillar, red to the left of the pillar and blue to the right. The beam is deep enough to cross
+	//the slabs the search is split into, so each half only comes out as one island if the slabs are joined.
+	const int32 PillarX = 32;
+	const int32 PillarTop = 23;
+	const int32 BeamLowerX = 20;
+	const int32 BeamUpperX = 44;
+	const int32 BeamLowerZ = 24;
+	const int32 BeamUpperZ = 33;
+	const FVector BeamMiddle(32.5f, 32.5f, 28.5f);
+
+	const FColor Red(255, 0, 0, 255);
+	const FColor Blue(0, 0, 255, 255);
+	const FColor Grey(128, 128, 128, 255);
+
+	void setVoxel(Cubiquity::ColoredCubesVolume& volume, int32 x, int32 y, int32 z, const FColor& color)
+	{
+		volume.setVoxel({ x, y, z }, Cubiquity::Color(color.R, color.G, color.B, color.A));
+	}
+
+	bool isSolid(const Cubiquity::ColoredCubesVolume& volume, const FIntVector& position)
+	{
+		return volume.getVoxel({ position.X, position.Y, position.Z }).alpha() > 0;
+	}
+
+	void buildBeam(Cubiquity::ColoredCubesVolume& volume)
+	{
+		for (int32 z = 0; z <= PillarTop; ++z)
+		{
+			for (int32 y = PillarX; y <= PillarX + 1; ++y)
+			{
+				for (int32 x = PillarX; x <= PillarX + 1; ++x)
+				{
+					setVoxel(volume, x, y, z, Grey);
+				}
+			}
+		}
+
+		for (int32 z = BeamLowerZ; z <= BeamUpperZ; ++z)
+		{
+			for (int32 y = PillarX - 1; y <= PillarX + 1; ++y)
+			{
+				for (int32 x = BeamLowerX; x <= BeamUpperX; ++x)
+				{
+					setVoxel(volume, x, y, z, x <= PillarX ? Red : Blue);
+				}
+			}
+		}
+	}
+
+	//Whether every voxel of an island is on one side of the pillar, the colour that side was and gone from the volume
+	bool isBeamHalf(const Cubiquity::ColoredCubesVolume& volume, const FCubiquityIsland& island, bool left)
+	{
+		if (island.voxels.Num() == 0 || island.colors.Num() != island.voxels.Num())
+		{
+			return false;
+		}
+
+		FIntVector lower = island.voxels[0];
+		FIntVector upper = island.voxels[0];
+		FVector centre = FVector::ZeroVector;
+		for (int32 i = 0; i < island.voxels.Num(); ++i)
+		{
+			const FIntVector& voxel = island.voxels[i];
+			if ((left ? voxel.X >= PillarX : voxel.X <= PillarX + 1) || !(island.colors[i] == (left ? Red : Blue)) || isSolid(volume, voxel))
+			{
+				return false;
+			}
+			lower = FIntVector(FMath::Min(lower.X, voxel.X), FMath::Min(lower.Y, voxel.Y), FMath::Min(lower.Z, voxel.Z));
+			upper = FIntVector(FMath::Max(upper.X, voxel.X), FMath::Max(upper.Y, voxel.Y), FMath::Max(upper.Z, voxel.Z));
+			centre += FVector(voxel.X, voxel.Y, voxel.Z);
+		}
+		centre /= island.voxels.Num();
+
+		return island.lower == lower && island.upper == upper && FVector::Dist(island.centre, centre) < 0.01f
+			&& lower.Z == BeamLowerZ && upper.Z == BeamUpperZ && (left ? lower.X == BeamLowerX : upper.X == BeamUpperX);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityExplosionIslandsTest, "Cubiquity.Explosion.Islands", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityExplosionIslandsTest::RunTest(const FString& Parameters)
+{
+	const float radius = 6.0f;
+	const int32 searchMargin = 14;
+	TestEqual(TEXT("An explosion reaches its radius plus the search margin"), FCubiquityExplosion::reach(radius, 0.0f, 0.0f, searchMargin), radius + searchMargin);
+
+	Cubiquity::ColoredCubesVolume volume({ 0, 0, 0 }, { VolumeSize - 1, VolumeSize - 1, VolumeSize - 1 }, "ExplosionTest.vdb", 16);
+	buildBeam(volume);
+
+	//Cutting the beam in the middle leaves each half hanging
+	TArray<FCubiquityIsland> islands;
+	const FCubiquityExplosionResult result = FCubiquityExplosion::apply(volume, BeamMiddle, radius, 0.0f, 0.0f, searchMargin, &islands);
+	AddLogItem(FString::Printf(TEXT("Carved %lld voxels, searched %lld in %d tasks and detached %lld in %d islands"),
+		result.voxelsCarved, result.voxelsSearched, result.tasks, result.voxelsDetached, result.islands));
+	TestTrue(TEXT("The crater is carved"), result.voxelsCarved > 0);
+	TestTrue(TEXT("The search is split into slabs"), result.tasks > 1);
+	TestEqual(TEXT("The beam comes apart into two islands"), result.islands, 2);
+	TestEqual(TEXT("which are handed back"), islands.Num(), 2);
+	if (islands.Num() != 2)
+	{
+		return false;
+	}
+
+	const bool leftFirst = islands[0].voxels[0].X < PillarX;
+	TestTrue(TEXT("One island is the whole left half of the beam, taken out of the volume"), isBeamHalf(volume, islands[leftFirst ? 0 : 1], true));
+	TestTrue(TEXT("and the other the right half"), isBeamHalf(volume, islands[leftFirst ? 1 : 0], false));
+	TestEqual(TEXT("Every detached voxel is counted"), int32(result.voxelsDetached), islands[0].voxels.Num() + islands[1].voxels.Num());
+
+	TestTrue(TEXT("The pillar stays, as it stands on the ground"), isSolid(volume, FIntVector(PillarX, PillarX, 0)) && isSolid(volume, FIntVector(PillarX, PillarX, 20)));
+
+	//Nothing is left hanging the second time
+	TArray<FCubiquityIsland> none;
+	const FCubiquityExplosionResult again = FCubiquityExplosion::apply(volume, BeamMiddle, radius, 0.0f, 0.0f, searchMargin, &none);
+	TestEqual(TEXT("An explosion which leaves nothing hanging finds no islands"), again.islands, 0);
+	TestEqual(TEXT("and hands none back"), none.Num(), 0);
+
+	//The same explosion on the same voxels does the same thing, as clients replay it
+	Cubiquity::ColoredCubesVolume replayed({ 0, 0, 0 }, { VolumeSize - 1, VolumeSize - 1, VolumeSize - 1 }, "ExplosionTestReplayed.vdb", 16);
+	buildBeam(replayed);
+	TArray<FCubiquityIsland> replayedIslands;
+	FCubiquityExplosion::apply(replayed, BeamMiddle, radius, 0.0f, 0.0f, searchMargin, &replayedIslands);
+	TestTrue(TEXT("Replaying an explosion finds the same islands"), replayedIslands.Num() == 2
+		&& replayedIslands[0].voxels == islands[0].voxels && replayedIslands[1].voxels == islands[1].voxels);
+
+	//A search box too small to hold the halves treats them as running on into the rest of the volume
+	Cubiquity::ColoredCubesVolume cramped({ 0, 0, 0 }, { VolumeSize - 1, VolumeSize - 1, VolumeSize - 1 }, "ExplosionTestCramped.vdb", 16);
+	buildBeam(cramped);
+	const FCubiquityExplosionResult crampedResult = FCubiquityExplosion::apply(cramped, BeamMiddle, radius, 0.0f, 0.0f, 2, nullptr);
+	TestEqual(TEXT("Anything reaching the edge of the search is anchored"), crampedResult.islands, 0);
+	TestTrue(TEXT("and stays in the volume"), isSolid(cramped, FIntVector(BeamLowerX, PillarX, BeamLowerZ)));
+	return true;
+}
@@ -0,0 +1,231 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityLodHysteresis.h"
+#include "CubiquityNodeSync.h"
+#include "CubiquityBenchmarkVolume.h"
+
+#include "AutomationTest.h"
+
+namespace
+{
+	//A node as TCubiquityNodeSync sees it, in place of an octree node actor, remembering what the actor would be showing
+	struct FTestNode
+	{
+		const double* clock = nullptr;
+		FCubiquityNodeSyncState sync;
+		bool visible = false;
+		bool hasMesh = false;
+		TSharedPtr<FTestNode> children[2][2][2];
+
+		FCubiquityNodeSyncState& syncState() { return sync; }
+		void syncMesh(const Cubiquity::OctreeNode& octreeNode) { hasMesh = octreeNode.hasMesh(); }
+		void setMeshVisible(bool inVisible) { visible = inVisible; }
+		FTestNode* getChild(uint32 x, uint32 y, uint32 z) const { return children[x][y][z].Get(); }
+		void destroyChild(uint32 x, uint32 y, uint32 z) { children[x][y][z].Reset(); }
+
+		FTestNode* spawnChild(const Cubiquity::OctreeNode& childNode, uint32 x, uint32 y, uint32 z)
+		{
+			FTestNode* child = new FTestNode;
+			child->clock = clock;
+			child->sync.spawnedAt = *clock;
+			children[x][y][z] = MakeShareable(child);
+			return child;
+		}
+	};
+
+	typedef TCubiquityNodeSync<FTestNode> FTestNodeSync;
+
+	//Whether any node which is showing has another showing above it, i.e. two LODs drawn over each other
+	bool drawsOverItself(const FTestNode& node, bool ancestorVisible)
+	{
+		if (node.visible && ancestorVisible)
+		{
+			return true;
+		}
+
+		for (uint32 z = 0; z < 2; z++)
+		{
+			for (uint32 y = 0; y < 2; y++)
+			{
+				for (uint32 x = 0; x < 2; x++)
+				{
+					if (node.children[x][y][z].IsValid() && drawsOverItself(*node.children[x][y][z], ancestorVisible || node.visible))
+					{
+						return true;
+					}
+				}
+			}
+		}
+		return false;
+	}
+
+	//Whether every node matches what the library has for it, with nothing extra kept
+	bool inStep(const FTestNode& node, const Cubiquity::OctreeNode& octreeNode)
+	{
+		if (node.visible != octreeNode.renderThisNode() || node.sync.meshLastSynced < octreeNode.meshLastChanged() || (node.visible && node.hasMesh != octreeNode.hasMesh()))
+		{
+			return false;
+		}
+
+		for (uint32 z = 0; z < 2; z++)
+		{
+			for (uint32 y = 0; y < 2; y++)
+			{
+				for (uint32 x = 0; x < 2; x++)
+				{
+					const bool hasChild = octreeNode.hasChildNode({ x, y, z });
+					if (hasChild != node.children[x][y][z].IsValid() || (hasChild && !inStep(*node.children[x][y][z], octreeNode.childNode({ x, y, z }))))
+					{
+						return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	struct FReplayResult
+	{
+		int32 lodFlips = 0;
+		int32 lodChangesHeld = 0;
+		bool drewOverItself = false;
+		bool settled = false;
+		bool settledInStep = false;
+	};
+
+	/**
+	 * Sweep an eye back and forth over a volume being edited, walking it the way ACubiquityVolume does each frame with
+	 * a sync allowance of 1, then hold the eye still until the walk settles
+	 */
+	FReplayResult replay(float band, float minimumNodeLifetime)
+	{
+		const int32 size = 64;
+		const int32 height = 16;
+		Cubiquity::ColoredCubesVolume volume({ 0, 0, 0 }, { size - 1, size - 1, height - 1 }, "LodHysteresisTest.vdb", 16);
+		FCubiquityBenchmarkVolume::generateColoredCubes(volume, size, height);
+
+		FCubiquityLodHysteresis lod;
+		lod.band = band;
+		lod.minimumNodeLifetime = minimumNodeLifetime;
+
+		double clock = 0.0;
+		FTestNode root;
+		root.clock = &clock;
+
+		FReplayResult result;
+		FRandomStream random(1);
+		FVector eye = FVector::ZeroVector;
+		const int32 sweepFrames = 240;
+		const int32 maximumSettleFrames = 2000;
+		for (int32 frame = 0; frame < sweepFrames + maximumSettleFrames; ++frame)
+		{
+			clock = frame / 60.0;
+			if (frame < sweepFrames)
+			{
+				//Slowly across the volume and back, jittering a voxel or two either way as a held camera does
+				const float sweep = FMath::Abs(float(frame % 120) - 60.0f) / 60.0f;
+				eye = FVector(size * sweep + random.FRandRange(-2.0f, 2.0f), size * 0.5f + random.FRandRange(-2.0f, 2.0f), height + 8.0f);
+
+				const FCubiquityBenchmarkEdit edit = FCubiquityBenchmarkVolume::coloredCubesEdit(TEXT("Scatter"), random, frame, size, height);
+				FCubiquityBenchmarkVolume::applyColoredCubesEdit(volume, TEXT("Scatter"), edit, size, height);
+			}
+
+			//A low threshold so the nodes the sweep passes split and merge again
+			const FVector heldEye = lod.eyeFor(eye);
+			const bool upToDate = volume.update({ heldEye.X, heldEye.Y, heldEye.Z }, 0.25f);
+
+			FCubiquityNodeSyncBudget budget;
+			budget.lod = &lod;
+			budget.now = clock;
+			const int32 nodeSyncsPerformed = volume.hasRootOctreeNode() ? FTestNodeSync::processOctreeNode(root, volume.rootOctreeNode(), 1, budget, false) : 0;
+
+			result.lodFlips += budget.lodFlips;
+			result.lodChangesHeld += budget.lodChangesHeld;
+			result.drewOverItself |= drawsOverItself(root, false);
+
+			if (frame >= sweepFrames && upToDate && nodeSyncsPerformed == 0 && budget.leftForLater() == 0)
+			{
+				result.settled = true;
+				result.settledInStep = volume.hasRootOctreeNode() && inStep(root, volume.rootOctreeNode());
+				break;
+			}
+		}
+
+		return result;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityLodHysteresisBandTest, "Cubiquity.LodHysteresis.Band", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityLodHysteresisBandTest::RunTest(const FString& Parameters)
+{
+	FCubiquityLodHysteresis lod;
+	lod.band = 4.0f;
+
+	const FVector start(10.0f, 20.0f, 30.0f);
+	TestTrue(TEXT("The first eye is taken as it is"), lod.eyeFor(start) == start);
+	TestTrue(TEXT("Inside the band the eye stays put"), lod.eyeFor(start + FVector(3.0f, 0.0f, 0.0f)) == start);
+	TestTrue(TEXT("On the edge of the band the eye stays put"), lod.eyeFor(start + FVector(0.0f, 4.0f, 0.0f)) == start);
+	TestTrue(TEXT("Jitter back the other way stays put"), lod.eyeFor(start - FVector(2.0f, 2.0f, 2.0f)) == start);
+
+	const FVector moved = start + FVector(0.0f, 0.0f, 4.5f);
+	TestTrue(TEXT("Outside the band the eye moves to the camera"), lod.eyeFor(moved) == moved);
+	TestTrue(TEXT("The band is then around where it moved to"), lod.eyeFor(moved + FVector(3.0f, 0.0f, 0.0f)) == moved);
+
+	lod.reset();
+	TestTrue(TEXT("After a reset the next eye is taken as it is"), lod.eyeFor(start) == start);
+
+	lod.band = 0.0f;
+	const FVector nudged = start + FVector(0.01f, 0.0f, 0.0f);
+	TestTrue(TEXT("With no band the eye always follows the camera"), lod.eyeFor(nudged) == nudged);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityLodHysteresisHoldNodeTest, "Cubiquity.LodHysteresis.HoldNode", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityLodHysteresisHoldNodeTest::RunTest(const FString& Parameters)
+{
+	FCubiquityLodHysteresis lod;
+	lod.minimumNodeLifetime = 0.5f;
+
+	const double since = 100.0;
+	TestTrue(TEXT("Held straight away"), lod.holdNode(since, since));
+	TestTrue(TEXT("Held just inside the lifetime"), lod.holdNode(since, since + 0.499));
+	TestFalse(TEXT("Let go at exactly the lifetime"), lod.holdNode(since, since + 0.5));
+	TestFalse(TEXT("Let go after the lifetime"), lod.holdNode(since, since + 10.0));
+
+	lod.minimumNodeLifetime = 0.0f;
+	TestFalse(TEXT("With no lifetime nothing is held"), lod.holdNode(since, since));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityLodHysteresisReplayTest, "Cubiquity.LodHysteresis.Replay", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityLodHysteresisReplayTest::RunTest(const FString& Parameters)
+{
+	//Through TCubiquityNodeSync, the walk ACubiquityOctreeNode::processOctreeNode() makes, with and without the hysteresis
+	const FReplayResult free = replay(0.0f, 0.0f);
+	const FReplayResult held = replay(3.0f, 0.5f);
+
+	TestTrue(TEXT("The sweep makes nodes flip"), free.lodFlips > 0);
+	TestEqual(TEXT("Nothing is held without the hysteresis"), free.lodChangesHeld, 0);
+	TestTrue(TEXT("The hysteresis holds LOD changes"), held.lodChangesHeld > 0);
+	TestTrue(TEXT("The hysteresis flips fewer nodes"), held.lodFlips < free.lodFlips);
+
+	TestFalse(TEXT("Two LODs are never drawn over each other"), free.drewOverItself);
+	TestFalse(TEXT("Two LODs are never drawn over each other while nodes are held"), held.drewOverItself);
+
+	//A sync allowance of 1 per branch leaves most of the octree for later walks, which have to come back for it
+	TestTrue(TEXT("The walk settles"), free.settled);
+	TestTrue(TEXT("The walk settles with the hysteresis"), held.settled);
+	TestTrue(TEXT("Once settled every node is in step with the library"), free.settledInStep);
+	TestTrue(TEXT("Once settled every node is in step with the library, held nodes included"), held.settledInStep);
+
+	AddLogItem(FString::Printf(TEXT("Without hysteresis %d flips, with it %d flips and %d changes held"), free.lodFlips, held.lodFlips, held.lodChangesHeld));
+
+	return true;
+}
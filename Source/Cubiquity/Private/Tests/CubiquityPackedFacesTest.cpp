@@ -0,0 +1,162 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityMeshData.h"
+#include "CubiquityMeshConverter.h"
+#include "CubiquityPackedFaces.h"
+#include "CubiquityGreedyMesher.h"
+
+#include "AutomationTest.h"
+
+namespace
+{
+	//A quad facing each way along each axis, of assorted sizes and colours, including the largest a packed face holds
+	void makeQuads(TArray<FCubiquityQuad>& outQuads)
+	{
+		const FColor colors[3] = { FColor(255, 0, 0, 255), FColor(12, 200, 34, 255), FColor(1, 2, 3, 128) };
+		for (uint8 axis = 0; axis < 3; ++axis)
+		{
+			for (int32 positive = 0; positive < 2; ++positive)
+			{
+				FCubiquityQuad quad;
+				quad.axis = axis;
+				quad.positive = positive != 0;
+				quad.plane = 3 + axis;
+				quad.u = axis * 5;
+				quad.v = 7;
+				quad.width = 1 + axis;
+				quad.height = 2 + positive;
+				quad.color = colors[(axis + positive) % 3];
+				outQuads.Add(quad);
+			}
+		}
+
+		FCubiquityQuad largest;
+		largest.axis = 2;
+		largest.positive = true;
+		largest.plane = 255;
+		largest.u = 0;
+		largest.v = 0;
+		largest.width = 256;
+		largest.height = 256;
+		largest.color = colors[0];
+		outQuads.Add(largest);
+	}
+
+	bool sameQuad(const FCubiquityQuad& a, const FCubiquityQuad& b)
+	{
+		return a.axis == b.axis && a.positive == b.positive && a.plane == b.plane && a.u == b.u && a.v == b.v
+			&& a.width == b.width && a.height == b.height && a.color == b.color;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityPackedFacesRoundTripTest, "Cubiquity.PackedFaces.RoundTrip", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityPackedFacesRoundTripTest::RunTest(const FString& Parameters)
+{
+	TArray<FCubiquityQuad> quads;
+	makeQuads(quads);
+
+	//Quads as the converter sees them: two triangles each
+	TArray<FColoredCubesVertex> vertices;
+	TArray<int32> indices;
+	FCubiquityGreedyMesher::emitQuads(quads, vertices, indices);
+
+	TArray<FCubiquityQuad> extracted;
+	TestTrue(TEXT("Emitted quads extract"), FCubiquityGreedyMesher::extractQuads(vertices, indices, extracted));
+
+	TArray<FCubiquityPackedFace> faces;
+	TArray<FColor> palette;
+	TestTrue(TEXT("Extracted quads pack"), FCubiquityPackedFaces::packQuads(extracted, faces, palette));
+	TestEqual(TEXT("One packed face per quad"), faces.Num(), quads.Num());
+	TestEqual(TEXT("Each colour in the palette once"), palette.Num(), 3);
+
+	for (int32 i = 0; i < faces.Num(); ++i)
+	{
+		TestTrue(FString::Printf(TEXT("Face %d unpacks to the quad it was packed from"), i), sameQuad(FCubiquityPackedFaces::unpackFace(faces[i], palette), quads[i]));
+	}
+
+	//Expanding on the CPU has to give back exactly the mesh the faces were made from
+	TArray<FColoredCubesVertex> expandedVertices;
+	TArray<int32> expandedIndices;
+	FCubiquityPackedFaces::expandFaces(faces, palette, expandedVertices, expandedIndices);
+	TestEqual(TEXT("Expanded vertex count"), expandedVertices.Num(), vertices.Num());
+	TestEqual(TEXT("Expanded index count"), expandedIndices.Num(), indices.Num());
+	for (int32 i = 0; i < FMath::Min(expandedIndices.Num(), indices.Num()); ++i)
+	{
+		const FColoredCubesVertex& expanded = expandedVertices[expandedIndices[i]];
+		const FColoredCubesVertex& original = vertices[indices[i]];
+		TestTrue(FString::Printf(TEXT("Expanded triangle vertex %d"), i), expanded.Position == original.Position && expanded.Color == original.Color);
+	}
+
+	//The corners the vertex shader and collision staging build, in the order they draw them, have to be the same triangles too
+	for (int32 f = 0; f < faces.Num(); ++f)
+	{
+		FVector corners[4];
+		FCubiquityPackedFaces::faceCorners(faces[f], corners);
+		const int32* triangleCorners = FCubiquityPackedFaces::triangleCorners(faces[f]);
+		for (int32 c = 0; c < 6; ++c)
+		{
+			TestTrue(FString::Printf(TEXT("Face %d vertex %d"), f, c), corners[triangleCorners[c]] == vertices[indices[f * 6 + c]].Position);
+		}
+	}
+
+	FCubiquityMeshData meshData;
+	meshData.packedFaces = faces;
+	meshData.facePalette = palette;
+	FTriMeshCollisionData collisionData;
+	FCubiquityMeshConverter::stageCollision(meshData, Cubiquity::VolumeType::ColoredCubes, collisionData);
+	TestEqual(TEXT("Two collision triangles per face"), collisionData.Indices.Num(), faces.Num() * 2);
+	for (int32 t = 0; t < FMath::Min(collisionData.Indices.Num(), indices.Num() / 3); ++t)
+	{
+		const FTriIndices& triangle = collisionData.Indices[t];
+		TestTrue(FString::Printf(TEXT("Collision triangle %d"), t),
+			collisionData.Vertices[triangle.v0] == vertices[indices[t * 3]].Position
+			&& collisionData.Vertices[triangle.v1] == vertices[indices[t * 3 + 1]].Position
+			&& collisionData.Vertices[triangle.v2] == vertices[indices[t * 3 + 2]].Position);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCubiquityPackedFacesMemoryTest, "Cubiquity.PackedFaces.Memory", EAutomationTestFlags::ATF_ApplicationMask)
+
+bool FCubiquityPackedFacesMemoryTest::RunTest(const FString& Parameters)
+{
+	//A 64 x 64 wall in two colours, one quad per voxel face as Cubiquity extracts it
+	TArray<FCubiquityQuad> quads;
+	for (int32 v = 0; v < 64; ++v)
+	{
+		for (int32 u = 0; u < 64; ++u)
+		{
+			FCubiquityQuad quad;
+			quad.axis = 0;
+			quad.positive = true;
+			quad.plane = 10;
+			quad.u = u;
+			quad.v = v;
+			quad.width = 1;
+			quad.height = 1;
+			quad.color = (u + v) % 2 ? FColor(255, 255, 255, 255) : FColor(0, 0, 0, 255);
+			quads.Add(quad);
+		}
+	}
+
+	FCubiquityMeshData expanded;
+	FCubiquityGreedyMesher::emitQuads(quads, expanded.coloredCubesVertices, expanded.indices);
+
+	FCubiquityMeshData packed;
+	TestTrue(TEXT("Wall packs"), FCubiquityPackedFaces::packQuads(quads, packed.packedFaces, packed.facePalette));
+
+	const uint32 faceCount = quads.Num();
+	TestEqual(TEXT("Expanded GPU bytes"), int32(expanded.gpuBytes()), int32(faceCount * (4 * sizeof(FColoredCubesVertex) + 6 * sizeof(int32))));
+	TestEqual(TEXT("Packed GPU bytes"), int32(packed.gpuBytes()), int32(faceCount * sizeof(FCubiquityPackedFace) + 2 * sizeof(FColor)));
+	TestTrue(TEXT("Packed faces take a tenth of the GPU memory or less"), packed.gpuBytes() * 10 <= expanded.gpuBytes());
+	TestTrue(TEXT("Packed faces take a tenth of the CPU memory or less"), packed.cpuBytes() * 10 <= expanded.cpuBytes());
+
+	AddLogItem(FString::Printf(TEXT("%u faces: expanded %u CPU / %u GPU bytes, packed %u CPU / %u GPU bytes"),
+		faceCount, expanded.cpuBytes(), expanded.gpuBytes(), packed.cpuBytes(), packed.gpuBytes()));
+
+	return true;
+}
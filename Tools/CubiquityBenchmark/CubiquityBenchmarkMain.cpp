@@ -0,0 +1,68 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+/*=============================================================================
+	CubiquityBenchmarkMain.cpp: UCubiquityBenchmarkCommandlet's synthetic run
+	without the editor.
+
+	Takes the same switches and writes the same JSON, with "backend":"stand-in"
+	in the config, but runs against the in-memory library in FakeCubiquity. That
+	has no voxel databases, so there is no -Volume=, and the checkpoints and brush
+	queue need the volume actor, so there is no -CheckpointEvery= or -BrushWindow=.
+	Use the commandlet for those and for numbers from the real library.
+=============================================================================*/
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "CubiquityCommandletSwitches.h"
+#include "CubiquityBenchmarkRun.h"
+
+#include "Async.h"
+
+namespace
+{
+	int32 run(const FString& Params)
+	{
+		if (!FCubiquityCommandletSwitches::validate(Params, FCubiquityBenchmarkOptions::switches(),
+			TEXT("Usage: CubiquityBenchmark [-Type=ColoredCubes|Terrain] [-Size=128] [-Height=32] [-Frames=300] [-Edits=1] [-Pattern=Scatter|Dig|Wall] [-Seed=0] [-BaseNodeSize=32] [-Greedy] [-Compact] [-LodThreshold=1.0] [-SyncsPerFrame=1] [-FastLane=16] [-CoarseNodeSyncsPerSecond=10] [-DiskCache] [-DiskCacheMegabytes=512] [-Output=Path/To.json]")))
+		{
+			return 1;
+		}
+
+		FCubiquityBenchmarkOptions options;
+		options.parse(Params);
+
+		//The stand-in keeps volumes in memory, so the name only keys the disk cache
+		FCubiquityBenchmarkRun benchmark(options);
+		if (!benchmark.openVolume(FPaths::CreateTempFilename(*(FPaths::GameSavedDir() / TEXT("Cubiquity")), TEXT("Benchmark"), TEXT(".vdb"))))
+		{
+			return 1;
+		}
+
+		benchmark.run();
+		return benchmark.writeResults(TEXT("stand-in")) ? 0 : 1;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	FString params;
+	for (int i = 1; i < argc; ++i)
+	{
+		params += (i > 1 ? TEXT(" ") : TEXT("")) + FString(argv[i]);
+	}
+
+	int32 result = 1;
+	try
+	{
+		result = run(params);
+	}
+	catch (const std::exception& error)
+	{
+		//Cubiquity.hpp reports library errors by throwing, which the engine would catch for the commandlet
+		UE_LOG(CubiquityLog, Error, TEXT("%s"), error.what());
+	}
+
+	//Let any disk cache writes finish before the workers go away
+	FStandaloneThreadPool::flush();
+	return result;
+}
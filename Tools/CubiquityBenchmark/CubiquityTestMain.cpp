@@ -0,0 +1,42 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+/*=============================================================================
+	CubiquityTestMain.cpp: Runs the plugin's automation tests which don't need
+	a world, as the editor's Session Frontend would.
+
+	With no arguments every registered test runs. Otherwise only those whose
+	name starts with one of the arguments, e.g. "Cubiquity.PackedFaces".
+=============================================================================*/
+
+#include "CubiquityPluginPrivatePCH.h"
+
+#include "AutomationTest.h"
+
+#include <cstdio>
+
+int main(int argc, char** argv)
+{
+	int32 run = 0;
+	int32 failed = 0;
+	for (FAutomationTestBase* test : FAutomationTestBase::registeredTests())
+	{
+		bool wanted = argc < 2;
+		for (int i = 1; i < argc; ++i)
+		{
+			wanted = wanted || test->GetTestName().StartsWith(FString(argv[i]));
+		}
+		if (!wanted)
+		{
+			continue;
+		}
+
+		std::printf("%s\n", *test->GetTestName());
+		const bool passed = test->RunTest(FString()) && !test->HasErrors();
+		std::printf("  %s\n", passed ? "Passed" : "Failed");
+		run++;
+		failed += passed ? 0 : 1;
+	}
+
+	std::printf("%d tests run, %d failed\n", run, failed);
+	return run > 0 && failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,1051 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "CubiquityC.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	const uint32_t NoNode = 0xFFFFFFFF;
+
+	//Node handles are the volume's index above this many bits and the node's index below
+	const uint32_t NodeIndexBits = 20;
+
+	//How many node meshes one update makes at most, so that an edit is spread over frames as the real library does
+	const int32_t MeshesPerUpdate = 32;
+
+	struct Node
+	{
+		int32_t position[3];
+		uint8_t height;
+		uint32_t parent = NoNode;
+		uint32_t children[2][2][2];
+
+		bool dirty = true; ///< The voxels under it changed since its mesh was made, or it never had one
+		bool render = false;
+
+		uint32_t structureLastChanged = 0;
+		uint32_t propertiesLastChanged = 0;
+		uint32_t meshLastChanged = 0;
+		uint32_t nodeOrChildrenLastChanged = 0;
+
+		std::vector<uint8_t> vertices; ///< CuColoredCubesVertex or CuTerrainVertex
+		std::vector<uint16_t> indices;
+	};
+
+	struct Volume
+	{
+		uint32_t type;
+		int32_t lower[3];
+		int32_t upper[3];
+		int32_t dims[3];
+		uint32_t baseNodeSize;
+		int32_t minimumLod = 0;
+		int32_t maximumLod = 255;
+
+		std::vector<uint64_t> voxels; ///< CuColor or CuMaterialSet, x fastest
+		std::unordered_map<size_t, uint64_t> overridden; ///< Voxel index to the value it had before the first change since the last accept
+		std::vector<Node> nodes; ///< The root is first
+
+		uint32_t handle;
+		int32_t meshBudget = 0;
+		bool workLeft = false;
+		bool renderChanged = false;
+	};
+
+	std::vector<std::unique_ptr<Volume>> volumes;
+	uint32_t currentTime = 1;
+	std::string lastError;
+
+	int32_t fail(int32_t code, const std::string& message)
+	{
+		lastError = message;
+		return code;
+	}
+
+	Volume* findVolume(uint32_t volumeHandle)
+	{
+		return volumeHandle < volumes.size() ? volumes[volumeHandle].get() : nullptr;
+	}
+
+	Node* findNode(uint32_t nodeHandle, Volume** outVolume = nullptr)
+	{
+		Volume* volume = findVolume(nodeHandle >> NodeIndexBits);
+		const uint32_t index = nodeHandle & ((1u << NodeIndexBits) - 1);
+		if (!volume || index >= volume->nodes.size())
+		{
+			return nullptr;
+		}
+		if (outVolume)
+		{
+			*outVolume = volume;
+		}
+		return &volume->nodes[index];
+	}
+
+	int32_t nodeSize(const Volume& volume, const Node& node)
+	{
+		return int32_t(volume.baseNodeSize) << node.height;
+	}
+
+	bool inside(const Volume& volume, int32_t x, int32_t y, int32_t z)
+	{
+		return x >= volume.lower[0] && y >= volume.lower[1] && z >= volume.lower[2] && x <= volume.upper[0] && y <= volume.upper[1] && z <= volume.upper[2];
+	}
+
+	size_t voxelIndex(const Volume& volume, int32_t x, int32_t y, int32_t z)
+	{
+		return (size_t(z - volume.lower[2]) * volume.dims[1] + size_t(y - volume.lower[1])) * volume.dims[0] + size_t(x - volume.lower[0]);
+	}
+
+	uint64_t voxel(const Volume& volume, const std::vector<uint64_t>& voxels, int32_t x, int32_t y, int32_t z)
+	{
+		return inside(volume, x, y, z) ? voxels[voxelIndex(volume, x, y, z)] : 0;
+	}
+
+	uint64_t voxel(const Volume& volume, int32_t x, int32_t y, int32_t z)
+	{
+		return voxel(volume, volume.voxels, x, y, z);
+	}
+
+	uint32_t density(uint64_t materials)
+	{
+		uint32_t sum = 0;
+		for (int32_t i = 0; i < 8; ++i)
+		{
+			sum += (materials >> (i * 8)) & 0xFF;
+		}
+		return sum;
+	}
+
+	bool solid(const Volume& volume, uint64_t value)
+	{
+		return volume.type == CU_COLORED_CUBES ? (value >> 24) != 0 : density(value) >= 128;
+	}
+
+	void touch(Volume& volume, uint32_t index)
+	{
+		//Every ancestor learns that something under it changed
+		for (uint32_t i = index; i != NoNode; i = volume.nodes[i].parent)
+		{
+			volume.nodes[i].nodeOrChildrenLastChanged = currentTime;
+		}
+	}
+
+	uint32_t buildNode(Volume& volume, const int32_t position[3], uint8_t height, uint32_t parent)
+	{
+		const uint32_t index = uint32_t(volume.nodes.size());
+		volume.nodes.emplace_back();
+		{
+			Node& node = volume.nodes.back();
+			std::copy(position, position + 3, node.position);
+			node.height = height;
+			node.parent = parent;
+			node.structureLastChanged = currentTime;
+			node.nodeOrChildrenLastChanged = currentTime;
+			std::fill(&node.children[0][0][0], &node.children[0][0][0] + 8, NoNode);
+		}
+
+		if (height > 0)
+		{
+			const int32_t childSize = int32_t(volume.baseNodeSize) << (height - 1);
+			for (int32_t z = 0; z < 2; ++z)
+			{
+				for (int32_t y = 0; y < 2; ++y)
+				{
+					for (int32_t x = 0; x < 2; ++x)
+					{
+						const int32_t childPosition[3] = { position[0] + x * childSize, position[1] + y * childSize, position[2] + z * childSize };
+						const bool overlaps = childPosition[0] <= volume.upper[0] && childPosition[1] <= volume.upper[1] && childPosition[2] <= volume.upper[2];
+						if (overlaps)
+						{
+							const uint32_t child = buildNode(volume, childPosition, uint8_t(height - 1), index);
+							volume.nodes[index].children[x][y][z] = child;
+						}
+					}
+				}
+			}
+		}
+
+		return index;
+	}
+
+	int32_t newVolume(uint32_t type, int32_t lowerX, int32_t lowerY, int32_t lowerZ, int32_t upperX, int32_t upperY, int32_t upperZ, uint32_t baseNodeSize, uint32_t* result)
+	{
+		if (upperX < lowerX || upperY < lowerY || upperZ < lowerZ)
+		{
+			return fail(CU_INVALID_ARGUMENT, "The upper corner of the volume is below the lower corner");
+		}
+		if (baseNodeSize < 8 || baseNodeSize > 128 || (baseNodeSize & (baseNodeSize - 1)) != 0)
+		{
+			return fail(CU_INVALID_ARGUMENT, "The base node size must be a power of two from 8 to 128");
+		}
+
+		std::unique_ptr<Volume> volume(new Volume);
+		volume->type = type;
+		volume->lower[0] = lowerX;
+		volume->lower[1] = lowerY;
+		volume->lower[2] = lowerZ;
+		volume->upper[0] = upperX;
+		volume->upper[1] = upperY;
+		volume->upper[2] = upperZ;
+		for (int32_t a = 0; a < 3; ++a)
+		{
+			volume->dims[a] = volume->upper[a] - volume->lower[a] + 1;
+		}
+		volume->baseNodeSize = baseNodeSize;
+		volume->voxels.assign(size_t(volume->dims[0]) * volume->dims[1] * volume->dims[2], 0);
+
+		uint8_t rootHeight = 0;
+		const int32_t largest = std::max(volume->dims[0], std::max(volume->dims[1], volume->dims[2]));
+		while ((int32_t(baseNodeSize) << rootHeight) < largest)
+		{
+			++rootHeight;
+		}
+		buildNode(*volume, volume->lower, rootHeight, NoNode);
+		if (volume->nodes.size() >= (1u << NodeIndexBits))
+		{
+			return fail(CU_OUT_OF_MEMORY, "Too many octree nodes for the base node size");
+		}
+
+		volume->handle = uint32_t(volumes.size());
+		*result = volume->handle;
+		volumes.push_back(std::move(volume));
+		return CU_OK;
+	}
+
+	//Dirty every node whose mesh can see the voxel, which reaches one sample past the node on every side
+	void markDirty(Volume& volume, uint32_t index, int32_t x, int32_t y, int32_t z)
+	{
+		Node& node = volume.nodes[index];
+		const int32_t size = nodeSize(volume, node);
+		const int32_t step = 1 << node.height;
+		if (x < node.position[0] - step || y < node.position[1] - step || z < node.position[2] - step
+			|| x > node.position[0] + size || y > node.position[1] + size || z > node.position[2] + size)
+		{
+			return;
+		}
+
+		node.dirty = true;
+		for (uint32_t child : { node.children[0][0][0], node.children[1][0][0], node.children[0][1][0], node.children[1][1][0],
+			node.children[0][0][1], node.children[1][0][1], node.children[0][1][1], node.children[1][1][1] })
+		{
+			if (child != NoNode)
+			{
+				markDirty(volume, child, x, y, z);
+			}
+		}
+	}
+
+	void writeVoxel(Volume& volume, int32_t x, int32_t y, int32_t z, uint64_t value)
+	{
+		if (!inside(volume, x, y, z))
+		{
+			return;
+		}
+
+		const size_t index = voxelIndex(volume, x, y, z);
+		if (volume.voxels[index] == value)
+		{
+			return;
+		}
+
+		volume.overridden.emplace(index, volume.voxels[index]);
+		volume.voxels[index] = value;
+		markDirty(volume, 0, x, y, z);
+	}
+
+	uint16_t encodeNormal(float x, float y, float z)
+	{
+		//Octahedral, as Cubiquity::TerrainVertex::normal() decodes it
+		const float sum = std::fabs(x) + std::fabs(y) + std::fabs(z);
+		float ex = x / sum;
+		float ey = y / sum;
+		if (z < 0.0f)
+		{
+			const float refX = (1.0f - std::fabs(ey)) * (ex >= 0.0f ? 1.0f : -1.0f);
+			const float refY = (1.0f - std::fabs(ex)) * (ey >= 0.0f ? 1.0f : -1.0f);
+			ex = refX;
+			ey = refY;
+		}
+		const uint16_t ux = uint16_t(std::lround((ex + 1.0f) * 127.5f));
+		const uint16_t uy = uint16_t(std::lround((ey + 1.0f) * 127.5f));
+		return uint16_t(ux << 8 | uy);
+	}
+
+	/**
+	 * One quad per exposed face, sampling every 2^height voxels. Positions are in the node's own cells.
+	 * A face towards +axis goes anticlockwise around its corners as seen from outside, and one towards -axis the other way,
+	 * as the real library winds them before the plugin reverses each triangle.
+	 */
+	void meshNode(Volume& volume, Node& node)
+	{
+		node.vertices.clear();
+		node.indices.clear();
+
+		const int32_t step = 1 << node.height;
+		const int32_t cells = int32_t(volume.baseNodeSize);
+		const size_t vertexSize = volume.type == CU_COLORED_CUBES ? sizeof(CuColoredCubesVertex) : sizeof(CuTerrainVertex);
+		const size_t maximumVertices = 65532;
+
+		int32_t cell[3];
+		for (cell[2] = 0; cell[2] < cells; ++cell[2])
+		{
+			for (cell[1] = 0; cell[1] < cells; ++cell[1])
+			{
+				for (cell[0] = 0; cell[0] < cells; ++cell[0])
+				{
+					const int32_t x = node.position[0] + cell[0] * step;
+					const int32_t y = node.position[1] + cell[1] * step;
+					const int32_t z = node.position[2] + cell[2] * step;
+					const uint64_t value = voxel(volume, x, y, z);
+					if (!solid(volume, value))
+					{
+						continue;
+					}
+
+					for (int32_t axis = 0; axis < 3; ++axis)
+					{
+						for (int32_t positive = 0; positive < 2; ++positive)
+						{
+							int32_t neighbour[3] = { x, y, z };
+							neighbour[axis] += positive ? step : -step;
+							if (solid(volume, voxel(volume, neighbour[0], neighbour[1], neighbour[2])))
+							{
+								continue;
+							}
+
+							const size_t firstVertex = node.vertices.size() / vertexSize;
+							if (firstVertex + 4 > maximumVertices)
+							{
+								return;
+							}
+
+							const int32_t uAxis = (axis + 1) % 3;
+							const int32_t vAxis = (axis + 2) % 3;
+							const int32_t cornerU[4] = { 0, 1, 1, 0 };
+							const int32_t cornerV[4] = { 0, 0, 1, 1 };
+							for (int32_t c = 0; c < 4; ++c)
+							{
+								int32_t corner[3] = { cell[0], cell[1], cell[2] };
+								corner[axis] += positive;
+								corner[uAxis] += cornerU[c];
+								corner[vAxis] += cornerV[c];
+
+								const size_t at = node.vertices.size();
+								node.vertices.resize(at + vertexSize);
+								if (volume.type == CU_COLORED_CUBES)
+								{
+									CuColoredCubesVertex vertex = {};
+									vertex.encodedPosX = uint8_t(corner[0]);
+									vertex.encodedPosY = uint8_t(corner[1]);
+									vertex.encodedPosZ = uint8_t(corner[2]);
+									vertex.data.data = uint32_t(value);
+									std::memcpy(&node.vertices[at], &vertex, sizeof(vertex));
+								}
+								else
+								{
+									float normal[3] = { 0.0f, 0.0f, 0.0f };
+									normal[axis] = positive ? 1.0f : -1.0f;
+
+									CuTerrainVertex vertex = {};
+									vertex.encodedPosX = uint16_t(corner[0] * 256);
+									vertex.encodedPosY = uint16_t(corner[1] * 256);
+									vertex.encodedPosZ = uint16_t(corner[2] * 256);
+									vertex.encodedNormal = encodeNormal(normal[0], normal[1], normal[2]);
+									std::memcpy(&vertex.material0, &value, 8);
+									std::memcpy(&node.vertices[at], &vertex, sizeof(vertex));
+								}
+							}
+
+							const uint16_t towardsPositive[6] = { 0, 2, 1, 0, 3, 2 };
+							const uint16_t towardsNegative[6] = { 0, 1, 2, 0, 2, 3 };
+							for (int32_t i = 0; i < 6; ++i)
+							{
+								node.indices.push_back(uint16_t(firstVertex + (positive ? towardsPositive[i] : towardsNegative[i])));
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void remesh(Volume& volume, uint32_t index)
+	{
+		Node& node = volume.nodes[index];
+		if (!node.dirty)
+		{
+			return;
+		}
+
+		if (volume.meshBudget <= 0)
+		{
+			volume.workLeft = true;
+			return;
+		}
+
+		volume.meshBudget--;
+		meshNode(volume, node);
+		node.dirty = false;
+		node.meshLastChanged = ++currentTime;
+		touch(volume, index);
+	}
+
+	void setRender(Volume& volume, uint32_t index, bool render)
+	{
+		Node& node = volume.nodes[index];
+		if (node.render != render)
+		{
+			node.render = render;
+			node.propertiesLastChanged = ++currentTime;
+			touch(volume, index);
+			volume.renderChanged = true;
+		}
+	}
+
+	void hideBelow(Volume& volume, uint32_t index)
+	{
+		for (uint32_t child : { volume.nodes[index].children[0][0][0], volume.nodes[index].children[1][0][0], volume.nodes[index].children[0][1][0], volume.nodes[index].children[1][1][0],
+			volume.nodes[index].children[0][0][1], volume.nodes[index].children[1][0][1], volume.nodes[index].children[0][1][1], volume.nodes[index].children[1][1][1] })
+		{
+			if (child != NoNode)
+			{
+				setRender(volume, child, false);
+				hideBelow(volume, child);
+			}
+		}
+	}
+
+	float distanceToNode(const Volume& volume, const Node& node, const float eye[3])
+	{
+		const int32_t size = nodeSize(volume, node);
+		float squared = 0.0f;
+		for (int32_t a = 0; a < 3; ++a)
+		{
+			const float below = node.position[a] - eye[a];
+			const float above = eye[a] - (node.position[a] + size);
+			const float outside = std::max(0.0f, std::max(below, above));
+			squared += outside * outside;
+		}
+		return std::sqrt(squared);
+	}
+
+	/**
+	 * A node is split when the eye is close to it for its size. Its children are only drawn instead once they all
+	 * have meshes, so nothing disappears while they are being made.
+	 */
+	void updateNode(Volume& volume, uint32_t index, const float eye[3], float lodThreshold)
+	{
+		const Node& node = volume.nodes[index];
+		const bool split = node.height > 0 && node.height > volume.minimumLod
+			&& (node.height > volume.maximumLod || distanceToNode(volume, node, eye) < nodeSize(volume, node) * lodThreshold * 2.0f);
+
+		uint32_t children[8];
+		int32_t childCount = 0;
+		for (int32_t i = 0; i < 8; ++i)
+		{
+			const uint32_t child = (&node.children[0][0][0])[i];
+			if (child != NoNode)
+			{
+				children[childCount++] = child;
+			}
+		}
+
+		bool childrenReady = split;
+		if (split)
+		{
+			for (int32_t i = 0; i < childCount; ++i)
+			{
+				remesh(volume, children[i]);
+				childrenReady = childrenReady && !volume.nodes[children[i]].dirty;
+			}
+		}
+
+		if (childrenReady)
+		{
+			setRender(volume, index, false);
+			for (int32_t i = 0; i < childCount; ++i)
+			{
+				updateNode(volume, children[i], eye, lodThreshold);
+			}
+		}
+		else
+		{
+			remesh(volume, index);
+			setRender(volume, index, true);
+			hideBelow(volume, index);
+		}
+	}
+
+	template <typename FunctionType>
+	void forEachInSphere(Volume& volume, float centreX, float centreY, float centreZ, float radius, FunctionType function)
+	{
+		const int32_t r = int32_t(std::ceil(radius));
+		for (int32_t z = int32_t(std::floor(centreZ)) - r; z <= int32_t(std::ceil(centreZ)) + r; ++z)
+		{
+			for (int32_t y = int32_t(std::floor(centreY)) - r; y <= int32_t(std::ceil(centreY)) + r; ++y)
+			{
+				for (int32_t x = int32_t(std::floor(centreX)) - r; x <= int32_t(std::ceil(centreX)) + r; ++x)
+				{
+					const float distance = std::sqrt((x - centreX) * (x - centreX) + (y - centreY) * (y - centreY) + (z - centreZ) * (z - centreZ));
+					if (distance <= radius && inside(volume, x, y, z))
+					{
+						function(x, y, z, distance);
+					}
+				}
+			}
+		}
+	}
+
+	//1 inside the inner radius, falling to 0 at the outer
+	float falloff(float distance, float innerRadius, float outerRadius)
+	{
+		if (distance <= innerRadius)
+		{
+			return 1.0f;
+		}
+		return outerRadius > innerRadius ? std::max(0.0f, 1.0f - (distance - innerRadius) / (outerRadius - innerRadius)) : 0.0f;
+	}
+
+	uint64_t scaleMaterials(uint64_t materials, float scale)
+	{
+		uint64_t result = 0;
+		for (int32_t i = 0; i < 8; ++i)
+		{
+			const float weight = float((materials >> (i * 8)) & 0xFF) * scale;
+			result |= uint64_t(std::min(255L, std::max(0L, std::lround(weight)))) << (i * 8);
+		}
+		return result;
+	}
+
+	uint64_t blendMaterials(uint64_t from, uint64_t to, float alpha)
+	{
+		uint64_t result = 0;
+		for (int32_t i = 0; i < 8; ++i)
+		{
+			const float a = float((from >> (i * 8)) & 0xFF);
+			const float b = float((to >> (i * 8)) & 0xFF);
+			result |= uint64_t(std::min(255L, std::max(0L, std::lround(a + (b - a) * alpha)))) << (i * 8);
+		}
+		return result;
+	}
+
+	//Blurred from a copy of the voxels so that earlier voxels don't feed later ones
+	uint64_t blurredVoxel(const Volume& volume, const std::vector<uint64_t>& voxels, int32_t x, int32_t y, int32_t z)
+	{
+		float sums[8] = {};
+		for (int32_t dz = -1; dz <= 1; ++dz)
+		{
+			for (int32_t dy = -1; dy <= 1; ++dy)
+			{
+				for (int32_t dx = -1; dx <= 1; ++dx)
+				{
+					const uint64_t value = voxel(volume, voxels, x + dx, y + dy, z + dz);
+					for (int32_t i = 0; i < 8; ++i)
+					{
+						sums[i] += float((value >> (i * 8)) & 0xFF);
+					}
+				}
+			}
+		}
+
+		uint64_t result = 0;
+		for (int32_t i = 0; i < 8; ++i)
+		{
+			result |= uint64_t(std::lround(sums[i] / 27.0f)) << (i * 8);
+		}
+		return result;
+	}
+
+	template <typename FunctionType>
+	int32_t pick(uint32_t volumeHandle, float startX, float startY, float startZ, float dirX, float dirY, float dirZ, uint32_t* success, FunctionType hit)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+
+		//The result is written through a bool by Cubiquity.hpp, so only the first byte is ours
+		*reinterpret_cast<uint8_t*>(success) = 0;
+
+		//The ray's length is how far to look
+		const float length = std::sqrt(dirX * dirX + dirY * dirY + dirZ * dirZ);
+		const int32_t steps = int32_t(std::ceil(length * 4.0f));
+		for (int32_t s = 0; s <= steps; ++s)
+		{
+			const float t = steps > 0 ? float(s) / steps : 0.0f;
+			if (hit(*volume, startX + dirX * t, startY + dirY * t, startZ + dirZ * t))
+			{
+				*reinterpret_cast<uint8_t*>(success) = 1;
+				break;
+			}
+		}
+		return CU_OK;
+	}
+}
+
+extern "C"
+{
+	int32_t cuGetVersionNumber(uint32_t* majorVersion, uint32_t* minorVersion, uint32_t* patchVersion, uint32_t* buildVersion)
+	{
+		//Zero major version marks the stand-in
+		*majorVersion = 0;
+		*minorVersion = 0;
+		*patchVersion = 0;
+		*buildVersion = 0;
+		return CU_OK;
+	}
+
+	const char* cuGetErrorCodeAsString(int32_t errorCode)
+	{
+		switch (errorCode)
+		{
+			case CU_OK: return "CU_OK";
+			case CU_EXCEPTION: return "CU_EXCEPTION";
+			case CU_INVALID_ARGUMENT: return "CU_INVALID_ARGUMENT";
+			case CU_INVALID_OPERATION: return "CU_INVALID_OPERATION";
+			case CU_OUT_OF_MEMORY: return "CU_OUT_OF_MEMORY";
+			case CU_DATABASE_ERROR: return "CU_DATABASE_ERROR";
+			default: return "CU_UNKNOWN_ERROR";
+		}
+	}
+
+	const char* cuGetLastErrorMessage()
+	{
+		return lastError.c_str();
+	}
+
+	CuColor cuMakeColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha)
+	{
+		return CuColor{ uint32_t(red) | uint32_t(green) << 8 | uint32_t(blue) << 16 | uint32_t(alpha) << 24 };
+	}
+
+	uint8_t cuGetRed(CuColor color) { return uint8_t(color.data); }
+	uint8_t cuGetGreen(CuColor color) { return uint8_t(color.data >> 8); }
+	uint8_t cuGetBlue(CuColor color) { return uint8_t(color.data >> 16); }
+	uint8_t cuGetAlpha(CuColor color) { return uint8_t(color.data >> 24); }
+
+	void cuGetAllComponents(CuColor color, uint8_t* red, uint8_t* green, uint8_t* blue, uint8_t* alpha)
+	{
+		*red = cuGetRed(color);
+		*green = cuGetGreen(color);
+		*blue = cuGetBlue(color);
+		*alpha = cuGetAlpha(color);
+	}
+
+	int32_t cuNewEmptyColoredCubesVolume(int32_t lowerX, int32_t lowerY, int32_t lowerZ, int32_t upperX, int32_t upperY, int32_t upperZ, const char* pathToNewVoxelDatabase, uint32_t baseNodeSize, uint32_t* result)
+	{
+		return newVolume(CU_COLORED_CUBES, lowerX, lowerY, lowerZ, upperX, upperY, upperZ, baseNodeSize, result);
+	}
+
+	int32_t cuNewColoredCubesVolumeFromVDB(const char* pathToExistingVoxelDatabase, uint32_t writePermissions, uint32_t baseNodeSize, uint32_t* result)
+	{
+		return fail(CU_DATABASE_ERROR, std::string("The stand-in library can't open voxel databases: ") + pathToExistingVoxelDatabase);
+	}
+
+	int32_t cuNewEmptyTerrainVolume(int32_t lowerX, int32_t lowerY, int32_t lowerZ, int32_t upperX, int32_t upperY, int32_t upperZ, const char* pathToNewVoxelDatabase, uint32_t baseNodeSize, uint32_t* result)
+	{
+		return newVolume(CU_TERRAIN, lowerX, lowerY, lowerZ, upperX, upperY, upperZ, baseNodeSize, result);
+	}
+
+	int32_t cuNewTerrainVolumeFromVDB(const char* pathToExistingVoxelDatabase, uint32_t writePermissions, uint32_t baseNodeSize, uint32_t* result)
+	{
+		return fail(CU_DATABASE_ERROR, std::string("The stand-in library can't open voxel databases: ") + pathToExistingVoxelDatabase);
+	}
+
+	int32_t cuDeleteVolume(uint32_t volumeHandle)
+	{
+		if (!findVolume(volumeHandle))
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+		volumes[volumeHandle].reset();
+		return CU_OK;
+	}
+
+	int32_t cuGetVolumeType(uint32_t volumeHandle, uint32_t* result)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+		*result = volume->type;
+		return CU_OK;
+	}
+
+	int32_t cuGetEnclosingRegion(uint32_t volumeHandle, int32_t* lowerX, int32_t* lowerY, int32_t* lowerZ, int32_t* upperX, int32_t* upperY, int32_t* upperZ)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+		*lowerX = volume->lower[0];
+		*lowerY = volume->lower[1];
+		*lowerZ = volume->lower[2];
+		*upperX = volume->upper[0];
+		*upperY = volume->upper[1];
+		*upperZ = volume->upper[2];
+		return CU_OK;
+	}
+
+	int32_t cuUpdateVolume(uint32_t volumeHandle, float eyePosX, float eyePosY, float eyePosZ, float lodThreshold, uint32_t* isUpToDate)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+
+		const float eye[3] = { eyePosX, eyePosY, eyePosZ };
+		volume->meshBudget = MeshesPerUpdate;
+		volume->workLeft = false;
+		volume->renderChanged = false;
+		updateNode(*volume, 0, eye, lodThreshold);
+
+		*isUpToDate = !volume->workLeft && !volume->renderChanged;
+		return CU_OK;
+	}
+
+	int32_t cuSetLodRange(uint32_t volumeHandle, int32_t minimumLOD, int32_t maximumLOD)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+		volume->minimumLod = minimumLOD;
+		volume->maximumLod = maximumLOD;
+		return CU_OK;
+	}
+
+	int32_t cuGetVoxel(uint32_t volumeHandle, int32_t x, int32_t y, int32_t z, void* value)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+
+		const uint64_t result = voxel(*volume, x, y, z);
+		if (volume->type == CU_COLORED_CUBES)
+		{
+			const uint32_t color = uint32_t(result);
+			std::memcpy(value, &color, sizeof(color));
+		}
+		else
+		{
+			std::memcpy(value, &result, sizeof(result));
+		}
+		return CU_OK;
+	}
+
+	int32_t cuSetVoxel(uint32_t volumeHandle, int32_t x, int32_t y, int32_t z, void* value)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+		if (!inside(*volume, x, y, z))
+		{
+			return fail(CU_INVALID_ARGUMENT, "The voxel is outside the volume");
+		}
+
+		uint64_t newValue = 0;
+		if (volume->type == CU_COLORED_CUBES)
+		{
+			uint32_t color;
+			std::memcpy(&color, value, sizeof(color));
+			newValue = color;
+		}
+		else
+		{
+			std::memcpy(&newValue, value, sizeof(newValue));
+		}
+		writeVoxel(*volume, x, y, z, newValue);
+		return CU_OK;
+	}
+
+	int32_t cuAcceptOverrideChunks(uint32_t volumeHandle)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+		volume->overridden.clear();
+		return CU_OK;
+	}
+
+	int32_t cuDiscardOverrideChunks(uint32_t volumeHandle)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+
+		std::unordered_map<size_t, uint64_t> overridden;
+		overridden.swap(volume->overridden);
+		for (const auto& entry : overridden)
+		{
+			const int32_t x = int32_t(entry.first % volume->dims[0]) + volume->lower[0];
+			const int32_t y = int32_t(entry.first / volume->dims[0] % volume->dims[1]) + volume->lower[1];
+			const int32_t z = int32_t(entry.first / volume->dims[0] / volume->dims[1]) + volume->lower[2];
+			volume->voxels[entry.first] = entry.second;
+			markDirty(*volume, 0, x, y, z);
+		}
+		return CU_OK;
+	}
+
+	int32_t cuHasRootOctreeNode(uint32_t volumeHandle, uint32_t* result)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+		//Written through a bool by Cubiquity.hpp, so only the first byte is ours
+		*reinterpret_cast<uint8_t*>(result) = volume->nodes.empty() ? 0 : 1;
+		return CU_OK;
+	}
+
+	int32_t cuGetRootOctreeNode(uint32_t volumeHandle, uint32_t* result)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume || volume->nodes.empty())
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such volume");
+		}
+		*result = volumeHandle << NodeIndexBits;
+		return CU_OK;
+	}
+
+	int32_t cuGetOctreeNode(uint32_t nodeHandle, CuOctreeNode* result)
+	{
+		Volume* volume = nullptr;
+		const Node* node = findNode(nodeHandle, &volume);
+		if (!node)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such octree node");
+		}
+
+		result->posX = node->position[0];
+		result->posY = node->position[1];
+		result->posZ = node->position[2];
+		result->structureLastChanged = node->structureLastChanged;
+		result->propertiesLastChanged = node->propertiesLastChanged;
+		result->meshLastChanged = node->meshLastChanged;
+		result->nodeOrChildrenLastChanged = node->nodeOrChildrenLastChanged;
+		for (int32_t i = 0; i < 8; ++i)
+		{
+			const uint32_t child = (&node->children[0][0][0])[i];
+			(&result->childHandles[0][0][0])[i] = child == NoNode ? NoNode : (volume->handle << NodeIndexBits | child);
+		}
+		result->hasMesh = node->indices.empty() ? 0 : 1;
+		result->renderThisNode = node->render ? 1 : 0;
+		result->height = node->height;
+		return CU_OK;
+	}
+
+	int32_t cuGetMesh(uint32_t nodeHandle, uint16_t* noOfVertices, void** vertices, uint32_t* noOfIndices, uint16_t** indices)
+	{
+		Volume* volume = nullptr;
+		Node* node = findNode(nodeHandle, &volume);
+		if (!node)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such octree node");
+		}
+
+		const size_t vertexSize = volume->type == CU_COLORED_CUBES ? sizeof(CuColoredCubesVertex) : sizeof(CuTerrainVertex);
+		*noOfVertices = uint16_t(node->vertices.size() / vertexSize);
+		*vertices = node->vertices.data();
+		*noOfIndices = uint32_t(node->indices.size());
+		*indices = node->indices.data();
+		return CU_OK;
+	}
+
+	int32_t cuGetCurrentTime(uint32_t* result)
+	{
+		*result = currentTime;
+		return CU_OK;
+	}
+
+	int32_t cuPickFirstSolidVoxel(uint32_t volumeHandle, float rayStartX, float rayStartY, float rayStartZ, float rayDirX, float rayDirY, float rayDirZ, int32_t* resultX, int32_t* resultY, int32_t* resultZ, uint32_t* success)
+	{
+		return pick(volumeHandle, rayStartX, rayStartY, rayStartZ, rayDirX, rayDirY, rayDirZ, success, [&](const Volume& volume, float x, float y, float z)
+		{
+			const int32_t voxelX = int32_t(std::lround(x));
+			const int32_t voxelY = int32_t(std::lround(y));
+			const int32_t voxelZ = int32_t(std::lround(z));
+			if (solid(volume, voxel(volume, voxelX, voxelY, voxelZ)))
+			{
+				*resultX = voxelX;
+				*resultY = voxelY;
+				*resultZ = voxelZ;
+				return true;
+			}
+			return false;
+		});
+	}
+
+	int32_t cuPickLastEmptyVoxel(uint32_t volumeHandle, float rayStartX, float rayStartY, float rayStartZ, float rayDirX, float rayDirY, float rayDirZ, int32_t* resultX, int32_t* resultY, int32_t* resultZ, uint32_t* success)
+	{
+		int32_t lastEmpty[3] = {};
+		bool anyEmpty = false;
+		const int32_t returnCode = pick(volumeHandle, rayStartX, rayStartY, rayStartZ, rayDirX, rayDirY, rayDirZ, success, [&](const Volume& volume, float x, float y, float z)
+		{
+			const int32_t voxelX = int32_t(std::lround(x));
+			const int32_t voxelY = int32_t(std::lround(y));
+			const int32_t voxelZ = int32_t(std::lround(z));
+			if (solid(volume, voxel(volume, voxelX, voxelY, voxelZ)))
+			{
+				return anyEmpty;
+			}
+			lastEmpty[0] = voxelX;
+			lastEmpty[1] = voxelY;
+			lastEmpty[2] = voxelZ;
+			anyEmpty = true;
+			return false;
+		});
+
+		*resultX = lastEmpty[0];
+		*resultY = lastEmpty[1];
+		*resultZ = lastEmpty[2];
+		return returnCode;
+	}
+
+	int32_t cuPickTerrainSurface(uint32_t volumeHandle, float rayStartX, float rayStartY, float rayStartZ, float rayDirX, float rayDirY, float rayDirZ, float* resultX, float* resultY, float* resultZ, uint32_t* success)
+	{
+		return pick(volumeHandle, rayStartX, rayStartY, rayStartZ, rayDirX, rayDirY, rayDirZ, success, [&](const Volume& volume, float x, float y, float z)
+		{
+			if (solid(volume, voxel(volume, int32_t(std::lround(x)), int32_t(std::lround(y)), int32_t(std::lround(z)))))
+			{
+				*resultX = x;
+				*resultY = y;
+				*resultZ = z;
+				return true;
+			}
+			return false;
+		});
+	}
+
+	int32_t cuSculptTerrainVolume(uint32_t volumeHandle, float brushX, float brushY, float brushZ, float brushInnerRadius, float brushOuterRadius, float opacity)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume || volume->type != CU_TERRAIN)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such terrain volume");
+		}
+
+		//Adds to material 0 or takes away from all materials evenly, by up to a quarter of full density each time
+		forEachInSphere(*volume, brushX, brushY, brushZ, brushOuterRadius, [&](int32_t x, int32_t y, int32_t z, float distance)
+		{
+			const uint64_t value = voxel(*volume, x, y, z);
+			const float amount = opacity * falloff(distance, brushInnerRadius, brushOuterRadius) * 64.0f;
+			const uint32_t total = density(value);
+			uint64_t newValue = value;
+			if (amount > 0.0f)
+			{
+				const uint32_t material0 = uint32_t(value & 0xFF);
+				const uint32_t added = std::min(uint32_t(std::lround(amount)), std::min(255u - material0, 255u - std::min(total, 255u)));
+				newValue = (value & ~uint64_t(0xFF)) | (material0 + added);
+			}
+			else if (amount < 0.0f && total > 0)
+			{
+				newValue = scaleMaterials(value, std::max(0.0f, (total + amount) / total));
+			}
+			writeVoxel(*volume, x, y, z, newValue);
+		});
+		return CU_OK;
+	}
+
+	int32_t cuBlurTerrainVolume(uint32_t volumeHandle, float brushX, float brushY, float brushZ, float brushInnerRadius, float brushOuterRadius, float opacity)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume || volume->type != CU_TERRAIN)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such terrain volume");
+		}
+
+		const std::vector<uint64_t> before = volume->voxels;
+		forEachInSphere(*volume, brushX, brushY, brushZ, brushOuterRadius, [&](int32_t x, int32_t y, int32_t z, float distance)
+		{
+			const float alpha = opacity * falloff(distance, brushInnerRadius, brushOuterRadius);
+			writeVoxel(*volume, x, y, z, blendMaterials(voxel(*volume, before, x, y, z), blurredVoxel(*volume, before, x, y, z), alpha));
+		});
+		return CU_OK;
+	}
+
+	int32_t cuBlurTerrainVolumeRegion(uint32_t volumeHandle, int32_t lowerX, int32_t lowerY, int32_t lowerZ, int32_t upperX, int32_t upperY, int32_t upperZ)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume || volume->type != CU_TERRAIN)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such terrain volume");
+		}
+
+		const std::vector<uint64_t> before = volume->voxels;
+		for (int32_t z = lowerZ; z <= upperZ; ++z)
+		{
+			for (int32_t y = lowerY; y <= upperY; ++y)
+			{
+				for (int32_t x = lowerX; x <= upperX; ++x)
+				{
+					writeVoxel(*volume, x, y, z, blurredVoxel(*volume, before, x, y, z));
+				}
+			}
+		}
+		return CU_OK;
+	}
+
+	int32_t cuPaintTerrainVolume(uint32_t volumeHandle, float brushX, float brushY, float brushZ, float brushInnerRadius, float brushOuterRadius, float opacity, uint32_t materialIndex)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume || volume->type != CU_TERRAIN || materialIndex >= 8)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such terrain volume or material");
+		}
+
+		//Moves the voxel's density towards the one material, keeping the total
+		forEachInSphere(*volume, brushX, brushY, brushZ, brushOuterRadius, [&](int32_t x, int32_t y, int32_t z, float distance)
+		{
+			const uint64_t value = voxel(*volume, x, y, z);
+			const uint64_t painted = uint64_t(std::min(density(value), 255u)) << (materialIndex * 8);
+			writeVoxel(*volume, x, y, z, blendMaterials(value, painted, opacity * falloff(distance, brushInnerRadius, brushOuterRadius)));
+		});
+		return CU_OK;
+	}
+
+	int32_t cuGenerateFloor(uint32_t volumeHandle, int32_t lowerLayerHeight, uint32_t lowerLayerMaterial, int32_t upperLayerHeight, uint32_t upperLayerMaterial)
+	{
+		Volume* volume = findVolume(volumeHandle);
+		if (!volume || volume->type != CU_TERRAIN || lowerLayerMaterial >= 8 || upperLayerMaterial >= 8)
+		{
+			return fail(CU_INVALID_ARGUMENT, "No such terrain volume or material");
+		}
+
+		for (int32_t z = volume->lower[2]; z <= volume->upper[2]; ++z)
+		{
+			const uint64_t value = z <= lowerLayerHeight ? uint64_t(255) << (lowerLayerMaterial * 8) : z <= upperLayerHeight ? uint64_t(255) << (upperLayerMaterial * 8) : 0;
+			for (int32_t y = volume->lower[1]; y <= volume->upper[1]; ++y)
+			{
+				for (int32_t x = volume->lower[0]; x <= volume->upper[0]; ++x)
+				{
+					writeVoxel(*volume, x, y, z, value);
+				}
+			}
+		}
+		return CU_OK;
+	}
+}
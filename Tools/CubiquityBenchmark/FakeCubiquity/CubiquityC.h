@@ -0,0 +1,143 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#ifndef CUBIQUITYC_H_
+#define CUBIQUITYC_H_
+
+/*=============================================================================
+	CubiquityC.h: An in-memory stand-in for the Cubiquity library's C interface.
+
+	Declares the subset of the real CubiquityC.h which Cubiquity.hpp calls, with the
+	same names and layouts, so the plugin's mesh pipeline can be built and timed on
+	platforms the library isn't shipped for. Volumes are dense arrays in memory,
+	meshes are one quad per exposed voxel face, and .vdb files can't be opened.
+
+	Timings against this are only comparable with other runs against it.
+=============================================================================*/
+
+#include <stdint.h>
+
+#define CU_OK 0
+#define CU_EXCEPTION 1
+#define CU_INVALID_ARGUMENT 10
+#define CU_INVALID_OPERATION 11
+#define CU_OUT_OF_MEMORY 20
+#define CU_DATABASE_ERROR 100
+#define CU_UNKNOWN_ERROR 0x7FFFFFFF
+
+#define CU_COLORED_CUBES 0
+#define CU_TERRAIN 1
+
+#define CU_READONLY 0
+#define CU_READWRITE 1
+
+extern "C"
+{
+	struct CuColor
+	{
+		uint32_t data; ///< Red in the low byte, then green, blue and alpha
+	};
+
+	struct CuMaterialSet
+	{
+		uint64_t data; ///< Byte i is the weight of material i
+	};
+
+	struct CuColoredCubesVertex
+	{
+		uint8_t encodedPosX;
+		uint8_t encodedPosY;
+		uint8_t encodedPosZ;
+		uint8_t padding;
+		CuColor data;
+	};
+
+	struct CuTerrainVertex
+	{
+		uint16_t encodedPosX;
+		uint16_t encodedPosY;
+		uint16_t encodedPosZ;
+		uint16_t encodedNormal;
+		uint8_t material0;
+		uint8_t material1;
+		uint8_t material2;
+		uint8_t material3;
+		uint8_t material4;
+		uint8_t material5;
+		uint8_t material6;
+		uint8_t material7;
+	};
+
+	struct CuOctreeNode
+	{
+		int32_t posX;
+		int32_t posY;
+		int32_t posZ;
+
+		uint32_t structureLastChanged;
+		uint32_t propertiesLastChanged;
+		uint32_t meshLastChanged;
+		uint32_t nodeOrChildrenLastChanged;
+
+		uint32_t childHandles[2][2][2]; ///< 0xFFFFFFFF where there is no child
+
+		uint8_t hasMesh;
+		uint8_t renderThisNode;
+		uint8_t height;
+	};
+
+	// Version and errors
+	int32_t cuGetVersionNumber(uint32_t* majorVersion, uint32_t* minorVersion, uint32_t* patchVersion, uint32_t* buildVersion);
+	const char* cuGetErrorCodeAsString(int32_t errorCode);
+	const char* cuGetLastErrorMessage();
+
+	// Colors
+	CuColor cuMakeColor(uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
+	uint8_t cuGetRed(CuColor color);
+	uint8_t cuGetGreen(CuColor color);
+	uint8_t cuGetBlue(CuColor color);
+	uint8_t cuGetAlpha(CuColor color);
+	void cuGetAllComponents(CuColor color, uint8_t* red, uint8_t* green, uint8_t* blue, uint8_t* alpha);
+
+	// Volumes
+	int32_t cuNewEmptyColoredCubesVolume(int32_t lowerX, int32_t lowerY, int32_t lowerZ, int32_t upperX, int32_t upperY, int32_t upperZ, const char* pathToNewVoxelDatabase, uint32_t baseNodeSize, uint32_t* result);
+	int32_t cuNewColoredCubesVolumeFromVDB(const char* pathToExistingVoxelDatabase, uint32_t writePermissions, uint32_t baseNodeSize, uint32_t* result);
+	int32_t cuNewEmptyTerrainVolume(int32_t lowerX, int32_t lowerY, int32_t lowerZ, int32_t upperX, int32_t upperY, int32_t upperZ, const char* pathToNewVoxelDatabase, uint32_t baseNodeSize, uint32_t* result);
+	int32_t cuNewTerrainVolumeFromVDB(const char* pathToExistingVoxelDatabase, uint32_t writePermissions, uint32_t baseNodeSize, uint32_t* result);
+	int32_t cuDeleteVolume(uint32_t volumeHandle);
+
+	int32_t cuGetVolumeType(uint32_t volumeHandle, uint32_t* result);
+	int32_t cuGetEnclosingRegion(uint32_t volumeHandle, int32_t* lowerX, int32_t* lowerY, int32_t* lowerZ, int32_t* upperX, int32_t* upperY, int32_t* upperZ);
+	int32_t cuUpdateVolume(uint32_t volumeHandle, float eyePosX, float eyePosY, float eyePosZ, float lodThreshold, uint32_t* isUpToDate);
+	int32_t cuSetLodRange(uint32_t volumeHandle, int32_t minimumLOD, int32_t maximumLOD);
+
+	/** \param value a CuColor or CuMaterialSet, depending on the volume type */
+	int32_t cuGetVoxel(uint32_t volumeHandle, int32_t x, int32_t y, int32_t z, void* value);
+	int32_t cuSetVoxel(uint32_t volumeHandle, int32_t x, int32_t y, int32_t z, void* value);
+
+	int32_t cuAcceptOverrideChunks(uint32_t volumeHandle);
+	int32_t cuDiscardOverrideChunks(uint32_t volumeHandle);
+
+	// Octree
+	int32_t cuHasRootOctreeNode(uint32_t volumeHandle, uint32_t* result);
+	int32_t cuGetRootOctreeNode(uint32_t volumeHandle, uint32_t* result);
+	int32_t cuGetOctreeNode(uint32_t nodeHandle, CuOctreeNode* result);
+	/** The mesh stays valid until the next call which changes the volume */
+	int32_t cuGetMesh(uint32_t nodeHandle, uint16_t* noOfVertices, void** vertices, uint32_t* noOfIndices, uint16_t** indices);
+
+	// Clock
+	int32_t cuGetCurrentTime(uint32_t* result);
+
+	// Picking
+	int32_t cuPickFirstSolidVoxel(uint32_t volumeHandle, float rayStartX, float rayStartY, float rayStartZ, float rayDirX, float rayDirY, float rayDirZ, int32_t* resultX, int32_t* resultY, int32_t* resultZ, uint32_t* success);
+	int32_t cuPickLastEmptyVoxel(uint32_t volumeHandle, float rayStartX, float rayStartY, float rayStartZ, float rayDirX, float rayDirY, float rayDirZ, int32_t* resultX, int32_t* resultY, int32_t* resultZ, uint32_t* success);
+	int32_t cuPickTerrainSurface(uint32_t volumeHandle, float rayStartX, float rayStartY, float rayStartZ, float rayDirX, float rayDirY, float rayDirZ, float* resultX, float* resultY, float* resultZ, uint32_t* success);
+
+	// Editing
+	int32_t cuSculptTerrainVolume(uint32_t volumeHandle, float brushX, float brushY, float brushZ, float brushInnerRadius, float brushOuterRadius, float opacity);
+	int32_t cuBlurTerrainVolume(uint32_t volumeHandle, float brushX, float brushY, float brushZ, float brushInnerRadius, float brushOuterRadius, float opacity);
+	int32_t cuBlurTerrainVolumeRegion(uint32_t volumeHandle, int32_t lowerX, int32_t lowerY, int32_t lowerZ, int32_t upperX, int32_t upperY, int32_t upperZ);
+	int32_t cuPaintTerrainVolume(uint32_t volumeHandle, float brushX, float brushY, float brushZ, float brushInnerRadius, float brushOuterRadius, float opacity, uint32_t materialIndex);
+	int32_t cuGenerateFloor(uint32_t volumeHandle, int32_t lowerLayerHeight, uint32_t lowerLayerMaterial, int32_t upperLayerHeight, uint32_t upperLayerMaterial);
+}
+
+#endif //CUBIQUITYC_H_
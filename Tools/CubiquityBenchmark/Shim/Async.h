@@ -0,0 +1,32 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include <functional>
+
+#include "Future.h"
+
+namespace EAsyncExecution
+{
+	enum Type { TaskGraph, Thread, ThreadPool };
+}
+
+/** Runs queued work on a couple of worker threads, and finishes everything queued before the program exits */
+class FStandaloneThreadPool
+{
+public:
+
+	static void addWork(std::function<void()> work);
+
+	/** Block until everything queued so far has run */
+	static void flush();
+};
+
+template <typename ResultType, typename CallableType>
+TFuture<ResultType> Async(EAsyncExecution::Type execution, CallableType function)
+{
+	auto task = std::make_shared<std::packaged_task<ResultType()>>(std::move(function));
+	TFuture<ResultType> future(task->get_future().share());
+	FStandaloneThreadPool::addWork([task]() { (*task)(); });
+	return future;
+}
@@ -0,0 +1,58 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "StandaloneCore.h"
+
+namespace EAutomationTestFlags
+{
+	enum Type
+	{
+		ATF_Editor = 0x00000001,
+		ATF_Game = 0x00000004,
+		ATF_ApplicationMask = ATF_Editor | ATF_Game,
+	};
+}
+
+/** The engine's simple automation tests, registered at static init and run by CubiquityTestMain */
+class FAutomationTestBase
+{
+public:
+
+	FAutomationTestBase(const FString& inName);
+	virtual ~FAutomationTestBase() {}
+
+	virtual bool RunTest(const FString& Parameters) = 0;
+
+	const FString& GetTestName() const { return testName; }
+	bool HasErrors() const { return errorCount > 0; }
+
+	void AddError(const FString& error);
+	void AddWarning(const FString& warning);
+	void AddLogItem(const FString& item);
+
+	bool TestTrue(const FString& what, bool value);
+	bool TestFalse(const FString& what, bool value) { return TestTrue(what, !value); }
+	bool TestEqual(const FString& what, int32 actual, int32 expected);
+	bool TestEqual(const FString& what, float actual, float expected, float tolerance = 1.e-4f);
+	bool TestEqual(const FString& what, const FString& actual, const FString& expected);
+
+	static TArray<FAutomationTestBase*>& registeredTests();
+
+private:
+
+	FString testName;
+	int32 errorCount = 0;
+};
+
+#define IMPLEMENT_SIMPLE_AUTOMATION_TEST(TClass, PrettyName, TFlags) \
+	class TClass : public FAutomationTestBase \
+	{ \
+	public: \
+		TClass(const FString& InName) : FAutomationTestBase(InName) {} \
+		virtual bool RunTest(const FString& Parameters) override; \
+	}; \
+	namespace \
+	{ \
+		TClass TClass##AutomationTestInstance(TEXT(PrettyName)); \
+	}
@@ -0,0 +1,13 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "StandaloneCore.h"
+
+class UCommandlet
+{
+public:
+
+	/** Splits a command line into tokens and switches as the engine does. Switches lose their leading '-' or '/'. */
+	static void ParseCommandLine(const TCHAR* commandLine, TArray<FString>& tokens, TArray<FString>& switches);
+};
@@ -0,0 +1,24 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "StandaloneCore.h"
+
+/** Only ever tested and compared here, never dereferenced */
+template <typename ObjectType>
+class TWeakObjectPtr
+{
+public:
+
+	TWeakObjectPtr() : object(nullptr) {}
+	TWeakObjectPtr(ObjectType* inObject) : object(inObject) {}
+
+	ObjectType* Get() const { return object; }
+	bool IsValid() const { return object != nullptr; }
+	void Reset() { object = nullptr; }
+	bool operator==(const TWeakObjectPtr& other) const { return object == other.object; }
+
+private:
+
+	ObjectType* object;
+};
@@ -0,0 +1,25 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "StandaloneCore.h"
+
+struct FDynamicMeshVertex
+{
+	FVector Position;
+	FVector2D TextureCoordinate;
+	FPackedNormal TangentX;
+	FPackedNormal TangentZ;
+	FColor Color;
+
+	FDynamicMeshVertex() {}
+	FDynamicMeshVertex(const FVector& inPosition) : Position(inPosition), TextureCoordinate(0.0f, 0.0f), TangentX(FVector(1, 0, 0)), TangentZ(FVector(0, 0, 1)), Color(255, 255, 255, 255) {}
+
+	void SetTangents(const FVector& tangentX, const FVector& tangentY, const FVector& tangentZ)
+	{
+		TangentX = tangentX;
+		TangentZ = tangentZ;
+	}
+
+	FVector GetTangentY() const { return FVector(TangentZ) ^ FVector(TangentX); }
+};
@@ -0,0 +1,21 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "CoreUObject.h"
+
+struct FTriIndices
+{
+	int32 v0, v1, v2;
+
+	FTriIndices() : v0(0), v1(0), v2(0) {}
+};
+
+struct FTriMeshCollisionData
+{
+	TArray<FVector> Vertices;
+	TArray<FTriIndices> Indices;
+	TArray<uint16> MaterialIndices;
+	bool bFlipNormals = false;
+	bool bDeformableMesh = false;
+};
@@ -0,0 +1,43 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include <future>
+
+#include "StandaloneCore.h"
+
+template <typename ResultType>
+class TFuture
+{
+public:
+
+	TFuture() {}
+	TFuture(std::shared_future<ResultType> inFuture) : future(std::move(inFuture)) {}
+
+	bool IsValid() const { return future.valid(); }
+	bool IsReady() const { return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+	void Wait() const { future.wait(); }
+	const ResultType& Get() const { return future.get(); }
+
+private:
+
+	std::shared_future<ResultType> future;
+};
+
+template <>
+class TFuture<void>
+{
+public:
+
+	TFuture() {}
+	TFuture(std::shared_future<void> inFuture) : future(std::move(inFuture)) {}
+
+	bool IsValid() const { return future.valid(); }
+	bool IsReady() const { return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+	void Wait() const { future.wait(); }
+	void Get() const { future.get(); }
+
+private:
+
+	std::shared_future<void> future;
+};
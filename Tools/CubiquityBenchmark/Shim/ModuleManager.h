@@ -0,0 +1,26 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "StandaloneCore.h"
+
+class IModuleInterface
+{
+public:
+
+	virtual ~IModuleInterface() {}
+	virtual void StartupModule() {}
+	virtual void ShutdownModule() {}
+};
+
+/** There are no modules to load here. Nothing in the harness asks for one. */
+class FModuleManager
+{
+public:
+
+	template <typename ModuleType>
+	static ModuleType& LoadModuleChecked(const TCHAR* name);
+
+	static FModuleManager& Get() { static FModuleManager manager; return manager; }
+	bool IsModuleLoaded(const TCHAR* name) const { return false; }
+};
@@ -0,0 +1,42 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include <thread>
+
+#include "StandaloneCore.h"
+
+/** Runs body(0) to body(num - 1) across a thread per core, the calling thread included, and returns once they are all done */
+template <typename BodyType>
+void ParallelFor(int32 num, const BodyType& body, bool forceSingleThread = false)
+{
+	const int32 noOfThreads = forceSingleThread ? 1 : FMath::Min(num, int32(FMath::Max(std::thread::hardware_concurrency(), 1u)));
+	if (noOfThreads <= 1)
+	{
+		for (int32 index = 0; index < num; ++index)
+		{
+			body(index);
+		}
+		return;
+	}
+
+	std::atomic<int32> next(0);
+	auto work = [&]()
+	{
+		for (int32 index = next++; index < num; index = next++)
+		{
+			body(index);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (int32 thread = 1; thread < noOfThreads; ++thread)
+	{
+		threads.emplace_back(work);
+	}
+	work();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
@@ -0,0 +1,1135 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#include "StandaloneCore.h"
+
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#include <zlib.h>
+
+#include "Async.h"
+#include "AutomationTest.h"
+#include "Commandlets/Commandlet.h"
+
+namespace
+{
+	const std::thread::id gameThreadId = std::this_thread::get_id();
+
+	uint32 rotateLeft(uint32 value, int32 bits)
+	{
+		return (value << bits) | (value >> (32 - bits));
+	}
+
+	//Both sides of '*' in a wildcard, compared without case
+	bool matchesWildcard(const FString& name, const FString& wildcard)
+	{
+		const int32 star = wildcard.Find(TEXT("*"));
+		if (star == INDEX_NONE)
+		{
+			return name.Equals(wildcard, ESearchCase::IgnoreCase);
+		}
+		const FString prefix = wildcard.Left(star);
+		const FString suffix = wildcard.RightChop(star + 1);
+		return name.Len() >= prefix.Len() + suffix.Len() && name.StartsWith(prefix) && name.EndsWith(suffix);
+	}
+
+	std::filesystem::path toPath(const TCHAR* path)
+	{
+		return std::filesystem::path(path);
+	}
+
+	class FStandaloneFileArchive : public FArchive
+	{
+	public:
+
+		FStandaloneFileArchive(const TCHAR* path, bool loading)
+			: file(path, std::ios::binary | (loading ? std::ios::in : std::ios::out | std::ios::trunc))
+		{
+			ArIsLoading = loading;
+			ArIsSaving = !loading;
+		}
+
+		bool isOpen() const { return file.is_open(); }
+
+		virtual void Serialize(void* data, int64 length) override
+		{
+			if (ArIsLoading)
+			{
+				file.read(static_cast<char*>(data), length);
+			}
+			else
+			{
+				file.write(static_cast<const char*>(data), length);
+			}
+			ArIsError |= !file;
+		}
+
+		virtual int64 Tell() override
+		{
+			return ArIsLoading ? int64(file.tellg()) : int64(file.tellp());
+		}
+
+		virtual int64 TotalSize() override
+		{
+			const int64 position = Tell();
+			if (ArIsLoading)
+			{
+				file.seekg(0, std::ios::end);
+			}
+			else
+			{
+				file.seekp(0, std::ios::end);
+			}
+			const int64 size = Tell();
+			Seek(position);
+			return size;
+		}
+
+		virtual void Seek(int64 position) override
+		{
+			if (ArIsLoading)
+			{
+				file.seekg(position);
+			}
+			else
+			{
+				file.seekp(position);
+			}
+			ArIsError |= !file;
+		}
+
+		virtual bool Close() override
+		{
+			file.close();
+			return !ArIsError && !file.fail();
+		}
+
+	private:
+
+		std::fstream file;
+	};
+}
+
+void StandaloneCheckFailed(const char* expression, const char* file, int line)
+{
+	std::fprintf(stderr, "Assertion failed: %s [%s:%d]\n", expression, file, line);
+	std::fflush(stderr);
+	std::abort();
+}
+
+bool IsInGameThread()
+{
+	return std::this_thread::get_id() == gameThreadId;
+}
+
+FSHA1::FSHA1()
+	: length(0)
+	, buffered(0)
+{
+	state[0] = 0x67452301;
+	state[1] = 0xEFCDAB89;
+	state[2] = 0x98BADCFE;
+	state[3] = 0x10325476;
+	state[4] = 0xC3D2E1F0;
+	FMemory::Memzero(digest, sizeof(digest));
+}
+
+void FSHA1::transform(const uint8* block)
+{
+	uint32 w[80];
+	for (int32 i = 0; i < 16; ++i)
+	{
+		w[i] = uint32(block[i * 4]) << 24 | uint32(block[i * 4 + 1]) << 16 | uint32(block[i * 4 + 2]) << 8 | uint32(block[i * 4 + 3]);
+	}
+	for (int32 i = 16; i < 80; ++i)
+	{
+		w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+	}
+
+	uint32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+	for (int32 i = 0; i < 80; ++i)
+	{
+		uint32 f, k;
+		if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+		else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+		else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+		else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+
+		const uint32 temp = rotateLeft(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = rotateLeft(b, 30);
+		b = a;
+		a = temp;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+void FSHA1::Update(const uint8* data, uint64 size)
+{
+	length += size;
+	while (size > 0)
+	{
+		const uint32 taken = uint32(FMath::Min<uint64>(size, 64 - buffered));
+		FMemory::Memcpy(buffer + buffered, data, taken);
+		buffered += taken;
+		data += taken;
+		size -= taken;
+		if (buffered == 64)
+		{
+			transform(buffer);
+			buffered = 0;
+		}
+	}
+}
+
+void FSHA1::Final()
+{
+	const uint64 bitLength = length * 8;
+	const uint8 pad = 0x80;
+	Update(&pad, 1);
+	const uint8 zero = 0;
+	while (buffered != 56)
+	{
+		Update(&zero, 1);
+	}
+	uint8 lengthBytes[8];
+	for (int32 i = 0; i < 8; ++i)
+	{
+		lengthBytes[i] = uint8(bitLength >> (56 - i * 8));
+	}
+	Update(lengthBytes, 8);
+
+	for (int32 i = 0; i < 20; ++i)
+	{
+		digest[i] = uint8(state[i / 4] >> (24 - (i % 4) * 8));
+	}
+}
+
+void FSHA1::GetHash(uint8* outHash) const
+{
+	FMemory::Memcpy(outHash, digest, sizeof(digest));
+}
+
+void FSHA1::HashBuffer(const void* data, uint64 size, uint8* outHash)
+{
+	FSHA1 sha;
+	sha.Update(static_cast<const uint8*>(data), size);
+	sha.Final();
+	sha.GetHash(outHash);
+}
+
+FString FMD5::HashAnsiString(const TCHAR* text)
+{
+	static const uint32 shifts[64] =
+	{
+		7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+		5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+		4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+		6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+	};
+	uint32 constants[64];
+	for (int32 i = 0; i < 64; ++i)
+	{
+		constants[i] = uint32(std::fabs(std::sin(double(i + 1))) * 4294967296.0);
+	}
+
+	std::string message(text);
+	const uint64 bitLength = uint64(message.size()) * 8;
+	message += char(0x80);
+	while (message.size() % 64 != 56)
+	{
+		message += char(0);
+	}
+	for (int32 i = 0; i < 8; ++i)
+	{
+		message += char(uint8(bitLength >> (i * 8)));
+	}
+
+	uint32 h[4] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476 };
+	for (size_t block = 0; block < message.size(); block += 64)
+	{
+		uint32 m[16];
+		for (int32 i = 0; i < 16; ++i)
+		{
+			const uint8* bytes = reinterpret_cast<const uint8*>(message.data() + block + i * 4);
+			m[i] = uint32(bytes[0]) | uint32(bytes[1]) << 8 | uint32(bytes[2]) << 16 | uint32(bytes[3]) << 24;
+		}
+
+		uint32 a = h[0], b = h[1], c = h[2], d = h[3];
+		for (int32 i = 0; i < 64; ++i)
+		{
+			uint32 f;
+			int32 g;
+			if (i < 16) { f = (b & c) | (~b & d); g = i; }
+			else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) % 16; }
+			else if (i < 48) { f = b ^ c ^ d; g = (3 * i + 5) % 16; }
+			else { f = c ^ (b | ~d); g = (7 * i) % 16; }
+
+			const uint32 temp = d;
+			d = c;
+			c = b;
+			b = b + rotateLeft(a + f + constants[i] + m[g], shifts[i]);
+			a = temp;
+		}
+		h[0] += a;
+		h[1] += b;
+		h[2] += c;
+		h[3] += d;
+	}
+
+	FString result;
+	for (int32 i = 0; i < 16; ++i)
+	{
+		result += FString::Printf("%02x", uint8(h[i / 4] >> ((i % 4) * 8)));
+	}
+	return result;
+}
+
+uint32 FCrc::MemCrc32(const void* data, int32 length, uint32 crc)
+{
+	static uint32 table[256];
+	static const bool tableMade = []()
+	{
+		for (uint32 i = 0; i < 256; ++i)
+		{
+			uint32 value = i;
+			for (int32 bit = 0; bit < 8; ++bit)
+			{
+				value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+			}
+			table[i] = value;
+		}
+		return true;
+	}();
+	(void)tableMade;
+
+	crc = ~crc;
+	const uint8* bytes = static_cast<const uint8*>(data);
+	for (int32 i = 0; i < length; ++i)
+	{
+		crc = (crc >> 8) ^ table[(crc ^ bytes[i]) & 0xFF];
+	}
+	return ~crc;
+}
+
+int32 FCompression::CompressMemoryBound(ECompressionFlags flags, int32 uncompressedSize)
+{
+	return int32(compressBound(uLong(uncompressedSize)));
+}
+
+bool FCompression::CompressMemory(ECompressionFlags flags, void* compressedBuffer, int32& compressedSize, const void* uncompressedBuffer, int32 uncompressedSize)
+{
+	const int level = (flags & COMPRESS_BiasSpeed) ? Z_BEST_SPEED : ((flags & COMPRESS_BiasMemory) ? Z_BEST_COMPRESSION : Z_DEFAULT_COMPRESSION);
+	uLongf size = uLongf(compressedSize);
+	if (compress2(static_cast<Bytef*>(compressedBuffer), &size, static_cast<const Bytef*>(uncompressedBuffer), uLong(uncompressedSize), level) != Z_OK)
+	{
+		return false;
+	}
+	compressedSize = int32(size);
+	return true;
+}
+
+bool FCompression::UncompressMemory(ECompressionFlags flags, void* uncompressedBuffer, int32 uncompressedSize, const void* compressedBuffer, int32 compressedSize)
+{
+	uLongf size = uLongf(uncompressedSize);
+	return uncompress(static_cast<Bytef*>(uncompressedBuffer), &size, static_cast<const Bytef*>(compressedBuffer), uLong(compressedSize)) == Z_OK
+		&& size == uLongf(uncompressedSize);
+}
+
+void FArchive::SerializeBits(void* data, int64 lengthBits)
+{
+	Serialize(data, (lengthBits + 7) / 8);
+	if (ArIsLoading && (lengthBits & 7) != 0)
+	{
+		static_cast<uint8*>(data)[lengthBits / 8] &= uint8((1 << (lengthBits & 7)) - 1);
+	}
+}
+
+void FArchive::SerializeIntPacked(uint32& value)
+{
+	if (ArIsLoading)
+	{
+		value = 0;
+		for (int32 shift = 0; shift < 35; shift += 7)
+		{
+			uint8 byte = 0;
+			Serialize(&byte, 1);
+			value |= uint32(byte >> 1) << shift;
+			if ((byte & 1) == 0 || ArIsError)
+			{
+				return;
+			}
+		}
+	}
+	else
+	{
+		uint32 remaining = value;
+		for (;;)
+		{
+			uint8 byte = uint8((remaining & 0x7f) << 1);
+			remaining >>= 7;
+			byte |= remaining ? 1 : 0;
+			Serialize(&byte, 1);
+			if (!remaining)
+			{
+				return;
+			}
+		}
+	}
+}
+
+void FArchive::SerializeCompressed(void* data, int64 length, ECompressionFlags flags)
+{
+	if (ArIsLoading)
+	{
+		int64 uncompressedSize = 0;
+		int32 compressedSize = 0;
+		*this << uncompressedSize << compressedSize;
+		const int64 left = TotalSize() >= 0 ? TotalSize() - Tell() : compressedSize;
+		if (ArIsError || uncompressedSize != length || compressedSize < 0 || compressedSize > left)
+		{
+			ArIsError = true;
+			return;
+		}
+		TArray<uint8> compressed;
+		compressed.SetNumUninitialized(compressedSize);
+		Serialize(compressed.GetData(), compressedSize);
+		if (ArIsError || !FCompression::UncompressMemory(flags, data, int32(length), compressed.GetData(), compressedSize))
+		{
+			ArIsError = true;
+		}
+	}
+	else
+	{
+		int32 compressedSize = FCompression::CompressMemoryBound(flags, int32(length));
+		TArray<uint8> compressed;
+		compressed.SetNumUninitialized(compressedSize);
+		if (!FCompression::CompressMemory(flags, compressed.GetData(), compressedSize, data, int32(length)))
+		{
+			ArIsError = true;
+			return;
+		}
+		int64 uncompressedSize = length;
+		*this << uncompressedSize << compressedSize;
+		Serialize(compressed.GetData(), compressedSize);
+	}
+}
+
+namespace
+{
+	//Bit by bit, bottom of each byte first
+	void copyBits(uint8* dest, int64 destBit, const uint8* src, int64 srcBit, int64 count)
+	{
+		for (int64 i = 0; i < count; ++i)
+		{
+			const int64 from = srcBit + i;
+			const int64 to = destBit + i;
+			if (src[from >> 3] & (1 << (from & 7)))
+			{
+				dest[to >> 3] |= uint8(1 << (to & 7));
+			}
+			else
+			{
+				dest[to >> 3] &= uint8(~(1 << (to & 7)));
+			}
+		}
+	}
+}
+
+FBitWriter::FBitWriter(int64 inMaxBits, bool inAllowResize)
+	: maxBits(inMaxBits)
+	, allowResize(inAllowResize)
+{
+	ArIsSaving = true;
+	buffer.SetNumZeroed(int32((maxBits + 7) >> 3));
+}
+
+bool FBitWriter::allowAppend(int64 lengthBits)
+{
+	if (num + lengthBits > maxBits)
+	{
+		if (!allowResize)
+		{
+			ArIsError = true;
+			return false;
+		}
+		maxBits = FMath::Max(maxBits * 2, num + lengthBits);
+		buffer.SetNumZeroed(int32((maxBits + 7) >> 3));
+	}
+	return true;
+}
+
+void FBitWriter::SerializeBits(void* data, int64 lengthBits)
+{
+	if (lengthBits > 0 && allowAppend(lengthBits))
+	{
+		copyBits(buffer.GetData(), num, static_cast<const uint8*>(data), 0, lengthBits);
+		num += lengthBits;
+	}
+}
+
+void FBitWriter::WriteInt(uint32 value, uint32 valueMax)
+{
+	int64 lengthBits = 0;
+	for (uint64 mask = 1; mask < valueMax; mask *= 2)
+	{
+		++lengthBits;
+	}
+	if (!allowAppend(lengthBits))
+	{
+		return;
+	}
+
+	uint32 newValue = 0;
+	for (uint32 mask = 1; newValue + mask < valueMax && mask; mask *= 2, ++num)
+	{
+		if (value & mask)
+		{
+			buffer[int32(num >> 3)] |= uint8(1 << (num & 7));
+			newValue += mask;
+		}
+	}
+}
+
+void FBitWriter::WriteBit(uint8 bit)
+{
+	if (allowAppend(1))
+	{
+		if (bit)
+		{
+			buffer[int32(num >> 3)] |= uint8(1 << (num & 7));
+		}
+		++num;
+	}
+}
+
+void FBitWriterMark::Pop(FBitWriter& writer)
+{
+	for (int64 bit = num; bit < writer.num; ++bit)
+	{
+		writer.buffer[int32(bit >> 3)] &= uint8(~(1 << (bit & 7)));
+	}
+	writer.ArIsError = overflowed;
+	writer.num = num;
+}
+
+FBitReader::FBitReader(uint8* src, int64 countBits)
+	: num(countBits)
+{
+	ArIsLoading = true;
+	buffer.SetNumZeroed(int32((countBits + 7) >> 3));
+	if (src && countBits > 0)
+	{
+		copyBits(buffer.GetData(), 0, src, 0, countBits);
+	}
+}
+
+void FBitReader::SerializeBits(void* data, int64 lengthBits)
+{
+	if (ArIsError || pos + lengthBits > num)
+	{
+		ArIsError = true;
+		FMemory::Memzero(data, SIZE_T((lengthBits + 7) >> 3));
+		return;
+	}
+	FMemory::Memzero(data, SIZE_T((lengthBits + 7) >> 3));
+	copyBits(static_cast<uint8*>(data), 0, buffer.GetData(), pos, lengthBits);
+	pos += lengthBits;
+}
+
+uint32 FBitReader::ReadInt(uint32 valueMax)
+{
+	uint32 value = 0;
+	for (uint32 mask = 1; value + mask < valueMax && mask; mask *= 2, ++pos)
+	{
+		if (pos >= num)
+		{
+			ArIsError = true;
+			return 0;
+		}
+		if (buffer[int32(pos >> 3)] & (1 << (pos & 7)))
+		{
+			value |= mask;
+		}
+	}
+	return value;
+}
+
+uint8 FBitReader::ReadBit()
+{
+	if (pos >= num)
+	{
+		ArIsError = true;
+		return 0;
+	}
+	const uint8 bit = (buffer[int32(pos >> 3)] >> (pos & 7)) & 1;
+	++pos;
+	return bit;
+}
+
+FString BytesToHex(const uint8* bytes, int32 count)
+{
+	FString result;
+	for (int32 i = 0; i < count; ++i)
+	{
+		result += FString::Printf("%02X", bytes[i]);
+	}
+	return result;
+}
+
+void FPlatformProcess::Sleep(float seconds)
+{
+	std::this_thread::sleep_for(std::chrono::duration<float>(seconds));
+}
+
+uint32 FPlatformTLS::GetCurrentThreadId()
+{
+	return uint32(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+FString FDateTime::ToString() const
+{
+	//The engine's default format, yyyy.mm.dd-hh.mm.ss
+	const auto systemTime = std::chrono::time_point_cast<std::chrono::system_clock::duration>(time - std::filesystem::file_time_type::clock::now() + std::chrono::system_clock::now());
+	const std::time_t seconds = std::chrono::system_clock::to_time_t(systemTime);
+	std::tm parts;
+	gmtime_r(&seconds, &parts);
+	return FString::Printf("%04d.%02d.%02d-%02d.%02d.%02d", parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday, parts.tm_hour, parts.tm_min, parts.tm_sec);
+}
+
+IFileManager& IFileManager::Get()
+{
+	static IFileManager fileManager;
+	return fileManager;
+}
+
+FArchive* IFileManager::CreateFileReader(const TCHAR* path, uint32 readFlags)
+{
+	std::unique_ptr<FStandaloneFileArchive> reader(new FStandaloneFileArchive(path, true));
+	if (!reader->isOpen())
+	{
+		if (!(readFlags & FILEREAD_Silent))
+		{
+			UE_LOG(Standalone, Warning, TEXT("Failed to read file '%s'"), path);
+		}
+		return nullptr;
+	}
+	return reader.release();
+}
+
+FArchive* IFileManager::CreateFileWriter(const TCHAR* path, uint32 writeFlags)
+{
+	std::error_code error;
+	const std::filesystem::path directory = toPath(path).parent_path();
+	if (!directory.empty())
+	{
+		std::filesystem::create_directories(directory, error);
+	}
+
+	std::unique_ptr<FStandaloneFileArchive> writer(new FStandaloneFileArchive(path, false));
+	return writer->isOpen() ? writer.release() : nullptr;
+}
+
+void IFileManager::FindFiles(TArray<FString>& outFileNames, const TCHAR* wildcardPath, bool files, bool directories)
+{
+	outFileNames.Reset();
+
+	const std::filesystem::path path = toPath(wildcardPath);
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(path.parent_path(), error))
+	{
+		const bool isDirectory = entry.is_directory(error);
+		if ((isDirectory ? directories : files) && matchesWildcard(FString(entry.path().filename().string()), FString(path.filename().string())))
+		{
+			outFileNames.Add(FString(entry.path().filename().string()));
+		}
+	}
+}
+
+int64 IFileManager::FileSize(const TCHAR* path)
+{
+	std::error_code error;
+	const auto size = std::filesystem::file_size(toPath(path), error);
+	return error ? -1 : int64(size);
+}
+
+FDateTime IFileManager::GetTimeStamp(const TCHAR* path)
+{
+	std::error_code error;
+	const auto time = std::filesystem::last_write_time(toPath(path), error);
+	return error ? FDateTime::MinValue() : FDateTime{ time };
+}
+
+bool IFileManager::SetTimeStamp(const TCHAR* path, FDateTime timeStamp)
+{
+	std::error_code error;
+	std::filesystem::last_write_time(toPath(path), timeStamp.time, error);
+	return !error;
+}
+
+bool IFileManager::FileExists(const TCHAR* path)
+{
+	std::error_code error;
+	return std::filesystem::is_regular_file(toPath(path), error);
+}
+
+bool IFileManager::DirectoryExists(const TCHAR* path)
+{
+	std::error_code error;
+	return std::filesystem::is_directory(toPath(path), error);
+}
+
+bool IFileManager::Delete(const TCHAR* path, bool requireExists, bool evenReadOnly, bool quiet)
+{
+	std::error_code error;
+	const bool removed = std::filesystem::remove(toPath(path), error);
+	return !error && (removed || !requireExists);
+}
+
+bool IFileManager::Move(const TCHAR* destination, const TCHAR* source, bool replace, bool evenIfReadOnly, bool attributes, bool doNotRetryOrError)
+{
+	std::error_code error;
+	if (!replace && std::filesystem::exists(toPath(destination), error))
+	{
+		return false;
+	}
+	std::filesystem::create_directories(toPath(destination).parent_path(), error);
+	std::filesystem::rename(toPath(source), toPath(destination), error);
+	return !error;
+}
+
+bool IFileManager::MakeDirectory(const TCHAR* path, bool tree)
+{
+	std::error_code error;
+	if (tree)
+	{
+		std::filesystem::create_directories(toPath(path), error);
+	}
+	else
+	{
+		std::filesystem::create_directory(toPath(path), error);
+	}
+	return !error;
+}
+
+bool IFileManager::DeleteDirectory(const TCHAR* path, bool requireExists, bool tree)
+{
+	std::error_code error;
+	const auto removed = tree ? std::filesystem::remove_all(toPath(path), error) : uintmax_t(std::filesystem::remove(toPath(path), error));
+	return !error && (removed > 0 || !requireExists);
+}
+
+bool FFileHelper::LoadFileToArray(TArray<uint8>& result, const TCHAR* path, uint32 flags)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		if (!(flags & FILEREAD_Silent))
+		{
+			UE_LOG(Standalone, Warning, TEXT("Failed to read file '%s'"), path);
+		}
+		return false;
+	}
+
+	const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	result.Reset(int32(bytes.size()));
+	result.Append(reinterpret_cast<const uint8*>(bytes.data()), int32(bytes.size()));
+	return true;
+}
+
+bool FFileHelper::SaveArrayToFile(const TArray<uint8>& bytes, const TCHAR* path)
+{
+	std::error_code error;
+	const std::filesystem::path directory = toPath(path).parent_path();
+	if (!directory.empty())
+	{
+		std::filesystem::create_directories(directory, error);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(bytes.GetData()), bytes.Num());
+	return bool(file);
+}
+
+bool FFileHelper::LoadFileToString(FString& result, const TCHAR* path)
+{
+	TArray<uint8> bytes;
+	if (!LoadFileToArray(bytes, path))
+	{
+		return false;
+	}
+	result = FString(std::string(reinterpret_cast<const char*>(bytes.GetData()), bytes.Num()));
+	return true;
+}
+
+bool FFileHelper::SaveStringToFile(const FString& text, const TCHAR* path)
+{
+	return SaveArrayToFile(TArray<uint8>(reinterpret_cast<const uint8*>(*text), text.Len()), path);
+}
+
+FString FPaths::GameSavedDir()
+{
+	const char* savedDir = std::getenv("CUBIQUITY_SAVED_DIR");
+	const FString directory = savedDir && *savedDir ? FString(savedDir) : FString(TEXT("Saved"));
+	return directory.EndsWith(TEXT("/")) ? directory : directory + TEXT("/");
+}
+
+FString FPaths::ConvertRelativePathToFull(const FString& path)
+{
+	std::error_code error;
+	const std::filesystem::path full = std::filesystem::absolute(toPath(*path), error);
+	return error ? path : FString(full.lexically_normal().generic_string());
+}
+
+FString FPaths::GetPath(const FString& path)
+{
+	return FString(toPath(*path).parent_path().generic_string());
+}
+
+FString FPaths::GetCleanFilename(const FString& path)
+{
+	return FString(toPath(*path).filename().string());
+}
+
+FString FPaths::CreateTempFilename(const TCHAR* path, const TCHAR* prefix, const TCHAR* extension)
+{
+	static std::atomic<uint32> counter(0);
+	return FString(path) / FString::Printf("%s%08X%04X%s", prefix, uint32(std::time(nullptr)), uint32(counter++), extension);
+}
+
+namespace
+{
+	//Where the value for `match` starts in `stream`, or nullptr. As the engine's, matches ignore case and only start at the start of a word.
+	const TCHAR* findValue(const TCHAR* stream, const TCHAR* match)
+	{
+		const std::string haystack = FString(stream).ToLower().toStdString();
+		const std::string needle = FString(match).ToLower().toStdString();
+		for (size_t at = haystack.find(needle); at != std::string::npos; at = haystack.find(needle, at + 1))
+		{
+			if (at == 0 || !std::isalnum(static_cast<unsigned char>(haystack[at - 1])))
+			{
+				return stream + at + needle.size();
+			}
+		}
+		return nullptr;
+	}
+}
+
+bool FParse::Value(const TCHAR* stream, const TCHAR* match, FString& value)
+{
+	const TCHAR* start = findValue(stream, match);
+	if (!start)
+	{
+		return false;
+	}
+
+	if (*start == '"')
+	{
+		const TCHAR* end = std::strchr(start + 1, '"');
+		value = end ? FString(int32(end - start - 1), start + 1) : FString(start + 1);
+	}
+	else
+	{
+		const TCHAR* end = start;
+		while (*end && *end != ' ' && *end != '\t' && *end != ',' && *end != ')')
+		{
+			++end;
+		}
+		value = FString(int32(end - start), start);
+	}
+	return true;
+}
+
+bool FParse::Value(const TCHAR* stream, const TCHAR* match, int32& value)
+{
+	const TCHAR* start = findValue(stream, match);
+	if (start)
+	{
+		value = int32(std::strtol(start, nullptr, 10));
+	}
+	return start != nullptr;
+}
+
+bool FParse::Value(const TCHAR* stream, const TCHAR* match, uint32& value)
+{
+	const TCHAR* start = findValue(stream, match);
+	if (start)
+	{
+		value = uint32(std::strtoul(start, nullptr, 10));
+	}
+	return start != nullptr;
+}
+
+bool FParse::Value(const TCHAR* stream, const TCHAR* match, float& value)
+{
+	const TCHAR* start = findValue(stream, match);
+	if (start)
+	{
+		value = std::strtof(start, nullptr);
+	}
+	return start != nullptr;
+}
+
+bool FParse::Param(const TCHAR* stream, const TCHAR* param)
+{
+	TArray<FString> tokens;
+	TArray<FString> switches;
+	UCommandlet::ParseCommandLine(stream, tokens, switches);
+	for (const FString& givenSwitch : switches)
+	{
+		if (givenSwitch.Equals(FString(param), ESearchCase::IgnoreCase))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UCommandlet::ParseCommandLine(const TCHAR* commandLine, TArray<FString>& tokens, TArray<FString>& switches)
+{
+	tokens.Reset();
+	switches.Reset();
+
+	const TCHAR* at = commandLine;
+	while (*at)
+	{
+		while (*at == ' ' || *at == '\t')
+		{
+			++at;
+		}
+		if (!*at)
+		{
+			break;
+		}
+
+		//A token runs to the next space outside quotes
+		std::string token;
+		bool quoted = false;
+		for (; *at && (quoted || (*at != ' ' && *at != '\t')); ++at)
+		{
+			if (*at == '"')
+			{
+				quoted = !quoted;
+			}
+			token += *at;
+		}
+
+		if (token[0] == '-' || token[0] == '/')
+		{
+			switches.Add(FString(token.substr(1)));
+		}
+		else
+		{
+			tokens.Add(FString(token));
+		}
+	}
+}
+
+void FStandaloneLog::log(ELogVerbosity::Type verbosity, const char* category, const TCHAR* format, ...)
+{
+	if (verbosity >= ELogVerbosity::Verbose)
+	{
+		return;
+	}
+
+	static const char* const names[] = { "", "Fatal", "Error", "Warning", "Display", "Log" };
+	static std::mutex logMutex;
+
+	va_list arguments;
+	va_start(arguments, format);
+	{
+		std::lock_guard<std::mutex> lock(logMutex);
+		if (verbosity == ELogVerbosity::Log || verbosity == ELogVerbosity::Display)
+		{
+			std::fprintf(stderr, "%s: ", category);
+		}
+		else
+		{
+			std::fprintf(stderr, "%s: %s: ", category, names[verbosity]);
+		}
+		std::vfprintf(stderr, format, arguments);
+		std::fprintf(stderr, "\n");
+	}
+	va_end(arguments);
+
+	if (verbosity == ELogVerbosity::Fatal)
+	{
+		std::abort();
+	}
+}
+
+FAutomationTestBase::FAutomationTestBase(const FString& inName)
+	: testName(inName)
+{
+	registeredTests().Add(this);
+}
+
+TArray<FAutomationTestBase*>& FAutomationTestBase::registeredTests()
+{
+	static TArray<FAutomationTestBase*> tests;
+	return tests;
+}
+
+void FAutomationTestBase::AddError(const FString& error)
+{
+	errorCount++;
+	std::fprintf(stderr, "  Error: %s\n", *error);
+}
+
+void FAutomationTestBase::AddWarning(const FString& warning)
+{
+	std::fprintf(stderr, "  Warning: %s\n", *warning);
+}
+
+void FAutomationTestBase::AddLogItem(const FString& item)
+{
+	std::fprintf(stdout, "  %s\n", *item);
+}
+
+bool FAutomationTestBase::TestTrue(const FString& what, bool value)
+{
+	if (!value)
+	{
+		AddError(FString::Printf("%s: expected true", *what));
+	}
+	return value;
+}
+
+bool FAutomationTestBase::TestEqual(const FString& what, int32 actual, int32 expected)
+{
+	if (actual != expected)
+	{
+		AddError(FString::Printf("%s: expected %d, was %d", *what, expected, actual));
+	}
+	return actual == expected;
+}
+
+bool FAutomationTestBase::TestEqual(const FString& what, float actual, float expected, float tolerance)
+{
+	const bool equal = FMath::IsNearlyEqual(actual, expected, tolerance);
+	if (!equal)
+	{
+		AddError(FString::Printf("%s: expected %f, was %f", *what, expected, actual));
+	}
+	return equal;
+}
+
+bool FAutomationTestBase::TestEqual(const FString& what, const FString& actual, const FString& expected)
+{
+	const bool equal = actual.Equals(expected, ESearchCase::CaseSensitive);
+	if (!equal)
+	{
+		AddError(FString::Printf("%s: expected '%s', was '%s'", *what, *expected, *actual));
+	}
+	return equal;
+}
+
+namespace
+{
+	/** Two workers, which is what the mesh disk cache's writes and trims would get on a small machine */
+	class FWorkers
+	{
+	public:
+
+		FWorkers()
+		{
+			for (int32 i = 0; i < 2; ++i)
+			{
+				threads.emplace_back([this]() { run(); });
+			}
+		}
+
+		~FWorkers()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (std::thread& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+		void add(std::function<void()> work)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				queue.push_back(std::move(work));
+				pending++;
+			}
+			wake.notify_one();
+		}
+
+		void flush()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this]() { return pending == 0; });
+		}
+
+	private:
+
+		void run()
+		{
+			while (true)
+			{
+				std::function<void()> work;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+					if (queue.empty())
+					{
+						return;
+					}
+					work = std::move(queue.front());
+					queue.pop_front();
+				}
+
+				work();
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					pending--;
+				}
+				done.notify_all();
+			}
+		}
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		std::deque<std::function<void()>> queue;
+		std::vector<std::thread> threads;
+		int32 pending = 0;
+		bool stopping = false;
+	};
+
+	FWorkers& workers()
+	{
+		static FWorkers instance;
+		return instance;
+	}
+}
+
+void FStandaloneThreadPool::addWork(std::function<void()> work)
+{
+	workers().add(std::move(work));
+}
+
+void FStandaloneThreadPool::flush()
+{
+	workers().flush();
+}
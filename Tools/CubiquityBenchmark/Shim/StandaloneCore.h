@@ -0,0 +1,1625 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+/*=============================================================================
+	StandaloneCore.h: Just enough of the engine's core types for the plugin's
+	mesh pipeline to build without the engine.
+
+	Only what the files listed in CMakeLists.txt use is here, with the same names
+	and behaviour as the engine's versions. TCHAR is char so TEXT() is a no-op.
+	Nothing here is meant to be fast or complete beyond that.
+=============================================================================*/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+typedef uint8_t uint8;
+typedef uint16_t uint16;
+typedef uint32_t uint32;
+typedef unsigned long long uint64;
+typedef int8_t int8;
+typedef int16_t int16;
+typedef int32_t int32;
+typedef long long int64;
+typedef size_t SIZE_T;
+typedef char TCHAR;
+typedef char ANSICHAR;
+
+#define TEXT(x) x
+#define TCHAR_TO_ANSI(x) (x)
+#define ANSI_TO_TCHAR(x) (x)
+#define FORCEINLINE inline
+#define UE_BUILD_SHIPPING 0
+#define PREPROCESSOR_JOIN_INNER(x, y) x##y
+#define PREPROCESSOR_JOIN(x, y) PREPROCESSOR_JOIN_INNER(x, y)
+#define ANONYMOUS_VARIABLE(Name) PREPROCESSOR_JOIN(Name, __LINE__)
+
+#define INDEX_NONE (-1)
+#define MAX_uint8 0xff
+#define MAX_uint16 0xffff
+#define MAX_uint32 0xffffffffu
+#define MAX_int32 0x7fffffff
+#define MAX_int64 0x7fffffffffffffffll
+#define MAX_flt 3.402823466e+38f
+#define PI 3.1415926535897932f
+
+void StandaloneCheckFailed(const char* expression, const char* file, int line);
+
+#define check(expr) do { if (!(expr)) { StandaloneCheckFailed(#expr, __FILE__, __LINE__); } } while (0)
+#define checkf(expr, ...) check(expr)
+#define checkSlow(expr)
+#define verify(expr) check(expr)
+#define ensure(expr) (!!(expr))
+
+/** True on the thread which started the program, which stands in for the game thread */
+bool IsInGameThread();
+
+template <typename T> inline typename std::remove_reference<T>::type&& MoveTemp(T&& value) { return std::move(value); }
+template <typename T> inline T&& Forward(typename std::remove_reference<T>::type& value) { return static_cast<T&&>(value); }
+template <typename T> inline void Swap(T& a, T& b) { std::swap(a, b); }
+template <typename T> inline void Exchange(T& a, T& b) { std::swap(a, b); }
+
+namespace ESearchCase
+{
+	enum Type { CaseSensitive, IgnoreCase };
+}
+
+struct FMemory
+{
+	static void* Memcpy(void* dest, const void* src, SIZE_T size) { return size ? std::memcpy(dest, src, size) : dest; }
+	static void* Memmove(void* dest, const void* src, SIZE_T size) { return size ? std::memmove(dest, src, size) : dest; }
+	static int32 Memcmp(const void* a, const void* b, SIZE_T size) { return size ? std::memcmp(a, b, size) : 0; }
+	static void* Memset(void* dest, uint8 value, SIZE_T size) { return size ? std::memset(dest, value, size) : dest; }
+	static void Memzero(void* dest, SIZE_T size) { Memset(dest, 0, size); }
+	template <typename T> static void Memzero(T& value) { Memzero(&value, sizeof(T)); }
+};
+
+struct FMath
+{
+	template <typename T> static T Min(T a, T b) { return a < b ? a : b; }
+	template <typename T> static T Max(T a, T b) { return a > b ? a : b; }
+	template <typename T> static T Clamp(T x, T lower, T upper) { return x < lower ? lower : (x < upper ? x : upper); }
+	template <typename T> static T Max3(T a, T b, T c) { return Max(Max(a, b), c); }
+	template <typename T> static T Abs(T x) { return x < 0 ? -x : x; }
+	template <typename T> static T Square(T x) { return x * x; }
+	template <typename T> static T DivideAndRoundUp(T dividend, T divisor) { return (dividend + divisor - 1) / divisor; }
+	template <typename T, typename U> static T Lerp(const T& a, const T& b, const U& alpha) { return T(a + alpha * (b - a)); }
+
+	static int32 TruncToInt(float x) { return int32(x); }
+	static int32 FloorToInt(float x) { return int32(std::floor(x)); }
+	static int32 CeilToInt(float x) { return int32(std::ceil(x)); }
+	static int32 RoundToInt(float x) { return FloorToInt(x + 0.5f); }
+	static float FloorToFloat(float x) { return std::floor(x); }
+	static float Frac(float x) { return x - std::floor(x); }
+	static float Sqrt(float x) { return std::sqrt(x); }
+	static float InvSqrt(float x) { return 1.0f / std::sqrt(x); }
+	static float Pow(float a, float b) { return std::pow(a, b); }
+	static float Sin(float x) { return std::sin(x); }
+	static float Cos(float x) { return std::cos(x); }
+	static float Atan2(float y, float x) { return std::atan2(y, x); }
+	static float Exp(float x) { return std::exp(x); }
+	static float Loge(float x) { return std::log(x); }
+	static bool IsFinite(float x) { return std::isfinite(x); }
+	static bool IsNaN(float x) { return std::isnan(x); }
+	static bool IsNearlyEqual(float a, float b, float tolerance = 1.e-8f) { return Abs(a - b) <= tolerance; }
+	static bool IsNearlyZero(float x, float tolerance = 1.e-8f) { return Abs(x) <= tolerance; }
+	static uint32 RoundUpToPowerOfTwo(uint32 x) { uint32 result = 1; while (result < x) { result <<= 1; } return result; }
+	template <typename T> static bool IsPowerOfTwo(T x) { return x > 0 && (x & (x - 1)) == 0; }
+	static uint32 FloorLog2(uint32 x) { uint32 result = 0; while (x >>= 1) { ++result; } return result; }
+};
+
+/** TArray with the engine's growth and allocation behaviour as far as anything here can tell: Reset() keeps the allocation and Empty() frees it */
+template <typename ElementType>
+class TArray
+{
+public:
+
+	typedef ElementType ElementTypeDef;
+
+	TArray() {}
+	TArray(std::initializer_list<ElementType> list) { Append(list.begin(), int32(list.size())); }
+	TArray(const ElementType* ptr, int32 count) { Append(ptr, count); }
+	TArray(const TArray& other) { Append(other); }
+	TArray(TArray&& other) : data(other.data), num(other.num), max(other.max) { other.data = nullptr; other.num = 0; other.max = 0; }
+	~TArray() { Empty(); }
+
+	TArray& operator=(const TArray& other)
+	{
+		if (this != &other)
+		{
+			Reset(other.num);
+			Append(other);
+		}
+		return *this;
+	}
+
+	TArray& operator=(TArray&& other)
+	{
+		if (this != &other)
+		{
+			Empty();
+			data = other.data;
+			num = other.num;
+			max = other.max;
+			other.data = nullptr;
+			other.num = 0;
+			other.max = 0;
+		}
+		return *this;
+	}
+
+	int32 Num() const { return num; }
+	int32 Max() const { return max; }
+	uint32 GetAllocatedSize() const { return uint32(max * sizeof(ElementType)); }
+	bool IsValidIndex(int32 index) const { return index >= 0 && index < num; }
+	ElementType* GetData() { return data; }
+	const ElementType* GetData() const { return data; }
+
+	ElementType& operator[](int32 index) { return data[index]; }
+	const ElementType& operator[](int32 index) const { return data[index]; }
+	ElementType& Last(int32 fromEnd = 0) { return data[num - fromEnd - 1]; }
+	const ElementType& Last(int32 fromEnd = 0) const { return data[num - fromEnd - 1]; }
+	ElementType& Top() { return Last(); }
+
+	void Reserve(int32 count)
+	{
+		if (count > max)
+		{
+			reallocate(count);
+		}
+	}
+
+	void Reset(int32 newSize = 0)
+	{
+		destruct(0, num);
+		num = 0;
+		Reserve(newSize);
+	}
+
+	void Empty(int32 slack = 0)
+	{
+		destruct(0, num);
+		num = 0;
+		if (max != slack)
+		{
+			reallocate(slack);
+		}
+	}
+
+	void Shrink()
+	{
+		if (max != num)
+		{
+			reallocate(num);
+		}
+	}
+
+	int32 Add(const ElementType& item)
+	{
+		if (num == max)
+		{
+			ElementType copy(item); //It may be one of ours
+			grow(num + 1);
+			new(data + num) ElementType(std::move(copy));
+		}
+		else
+		{
+			new(data + num) ElementType(item);
+		}
+		return num++;
+	}
+
+	int32 Add(ElementType&& item)
+	{
+		if (num == max)
+		{
+			ElementType moved(std::move(item));
+			grow(num + 1);
+			new(data + num) ElementType(std::move(moved));
+		}
+		else
+		{
+			new(data + num) ElementType(std::move(item));
+		}
+		return num++;
+	}
+
+	template <typename... ArgsType>
+	int32 Emplace(ArgsType&&... args)
+	{
+		grow(num + 1);
+		new(data + num) ElementType(std::forward<ArgsType>(args)...);
+		return num++;
+	}
+
+	int32 AddUnique(const ElementType& item)
+	{
+		const int32 index = Find(item);
+		return index != INDEX_NONE ? index : Add(item);
+	}
+
+	void Push(const ElementType& item) { Add(item); }
+
+	ElementType Pop()
+	{
+		ElementType result(std::move(data[num - 1]));
+		RemoveAt(num - 1);
+		return result;
+	}
+
+	/** Element types here are plain data or cheap to build, so these are default constructed rather than left as raw memory */
+	int32 AddUninitialized(int32 count = 1)
+	{
+		return AddDefaulted(count);
+	}
+
+	int32 AddDefaulted(int32 count = 1)
+	{
+		const int32 index = num;
+		grow(num + count);
+		for (int32 i = 0; i < count; ++i)
+		{
+			new(data + num + i) ElementType();
+		}
+		num += count;
+		return index;
+	}
+
+	//Value-initialising zeroes the plain types added this way, without a memset the compiler can't see the size of
+	int32 AddZeroed(int32 count = 1) { return AddDefaulted(count); }
+
+	void Init(const ElementType& value, int32 count)
+	{
+		Empty(count);
+		for (int32 i = 0; i < count; ++i)
+		{
+			new(data + i) ElementType(value);
+		}
+		num = count;
+	}
+
+	void SetNum(int32 newNum)
+	{
+		if (newNum > num)
+		{
+			AddDefaulted(newNum - num);
+		}
+		else
+		{
+			RemoveAt(newNum, num - newNum);
+		}
+	}
+
+	void SetNumUninitialized(int32 newNum) { SetNum(newNum); }
+
+	void SetNumZeroed(int32 newNum)
+	{
+		if (newNum > num)
+		{
+			AddZeroed(newNum - num);
+		}
+		else
+		{
+			SetNum(newNum);
+		}
+	}
+
+	void Append(const ElementType* ptr, int32 count)
+	{
+		grow(num + count);
+		for (int32 i = 0; i < count; ++i)
+		{
+			new(data + num + i) ElementType(ptr[i]);
+		}
+		num += count;
+	}
+
+	void Append(const TArray& other) { Append(other.data, other.num); }
+
+	void Append(TArray&& other)
+	{
+		grow(num + other.num);
+		for (int32 i = 0; i < other.num; ++i)
+		{
+			new(data + num + i) ElementType(std::move(other.data[i]));
+		}
+		num += other.num;
+		other.Empty();
+	}
+
+	int32 Insert(const ElementType& item, int32 index)
+	{
+		ElementType copy(item);
+		Add(std::move(copy));
+		std::rotate(data + index, data + num - 1, data + num);
+		return index;
+	}
+
+	void RemoveAt(int32 index, int32 count = 1, bool allowShrinking = true)
+	{
+		std::move(data + index + count, data + num, data + index);
+		destruct(num - count, num);
+		num -= count;
+	}
+
+	void RemoveAtSwap(int32 index, int32 count = 1, bool allowShrinking = true)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			if (index + i != num - 1 - i)
+			{
+				data[index + i] = std::move(data[num - 1 - i]);
+			}
+		}
+		destruct(num - count, num);
+		num -= count;
+	}
+
+	int32 Remove(const ElementType& item)
+	{
+		return RemoveAll([&item](const ElementType& element) { return element == item; });
+	}
+
+	int32 RemoveSingle(const ElementType& item)
+	{
+		const int32 index = Find(item);
+		if (index == INDEX_NONE)
+		{
+			return 0;
+		}
+		RemoveAt(index);
+		return 1;
+	}
+
+	template <typename PredicateType>
+	int32 RemoveAll(const PredicateType& predicate)
+	{
+		ElementType* newEnd = std::remove_if(data, data + num, predicate);
+		const int32 removed = int32(data + num - newEnd);
+		destruct(num - removed, num);
+		num -= removed;
+		return removed;
+	}
+
+	int32 Find(const ElementType& item) const
+	{
+		for (int32 i = 0; i < num; ++i)
+		{
+			if (data[i] == item)
+			{
+				return i;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	bool Find(const ElementType& item, int32& outIndex) const
+	{
+		outIndex = Find(item);
+		return outIndex != INDEX_NONE;
+	}
+
+	bool Contains(const ElementType& item) const { return Find(item) != INDEX_NONE; }
+
+	template <typename PredicateType>
+	int32 IndexOfByPredicate(const PredicateType& predicate) const
+	{
+		for (int32 i = 0; i < num; ++i)
+		{
+			if (predicate(data[i]))
+			{
+				return i;
+			}
+		}
+		return INDEX_NONE;
+	}
+
+	template <typename PredicateType>
+	const ElementType* FindByPredicate(const PredicateType& predicate) const
+	{
+		for (int32 i = 0; i < num; ++i)
+		{
+			if (predicate(data[i]))
+			{
+				return data + i;
+			}
+		}
+		return nullptr;
+	}
+
+	template <typename PredicateType>
+	ElementType* FindByPredicate(const PredicateType& predicate)
+	{
+		return const_cast<ElementType*>(static_cast<const TArray*>(this)->FindByPredicate(predicate));
+	}
+
+	template <typename PredicateType>
+	bool ContainsByPredicate(const PredicateType& predicate) const { return FindByPredicate(predicate) != nullptr; }
+
+	void Sort() { std::sort(data, data + num); }
+	template <typename PredicateType> void Sort(const PredicateType& predicate) { std::sort(data, data + num, predicate); }
+	void StableSort() { std::stable_sort(data, data + num); }
+	template <typename PredicateType> void StableSort(const PredicateType& predicate) { std::stable_sort(data, data + num, predicate); }
+
+	bool operator==(const TArray& other) const { return num == other.num && std::equal(data, data + num, other.data); }
+	bool operator!=(const TArray& other) const { return !(*this == other); }
+
+	ElementType* begin() { return data; }
+	ElementType* end() { return data + num; }
+	const ElementType* begin() const { return data; }
+	const ElementType* end() const { return data + num; }
+
+	template <typename ArrayType, typename ReferenceType>
+	class TIndexedIterator
+	{
+	public:
+		TIndexedIterator(ArrayType& inArray) : array(inArray), index(0) {}
+		TIndexedIterator& operator++() { ++index; return *this; }
+		TIndexedIterator operator++(int) { TIndexedIterator previous(*this); ++index; return previous; }
+		ReferenceType operator*() const { return array[index]; }
+		explicit operator bool() const { return array.IsValidIndex(index); }
+		int32 GetIndex() const { return index; }
+		void RemoveCurrent() { array.RemoveAt(index--); }
+	private:
+		ArrayType& array;
+		int32 index;
+	};
+
+	TIndexedIterator<TArray, ElementType&> CreateIterator() { return TIndexedIterator<TArray, ElementType&>(*this); }
+	TIndexedIterator<const TArray, const ElementType&> CreateConstIterator() const { return TIndexedIterator<const TArray, const ElementType&>(*this); }
+
+private:
+
+	void destruct(int32 first, int32 last)
+	{
+		for (int32 i = first; i < last; ++i)
+		{
+			data[i].~ElementType();
+		}
+	}
+
+	void grow(int32 needed)
+	{
+		if (needed > max)
+		{
+			reallocate(FMath::Max(needed, needed + 3 * needed / 8 + 16));
+		}
+	}
+
+	void reallocate(int32 newMax)
+	{
+		ElementType* newData = newMax > 0 ? static_cast<ElementType*>(::operator new(SIZE_T(newMax) * sizeof(ElementType))) : nullptr;
+		for (int32 i = 0; i < num; ++i)
+		{
+			new(newData + i) ElementType(std::move(data[i]));
+			data[i].~ElementType();
+		}
+		::operator delete(data);
+		data = newData;
+		max = newMax;
+	}
+
+	ElementType* data = nullptr;
+	int32 num = 0;
+	int32 max = 0;
+};
+
+class FString
+{
+public:
+
+	FString() {}
+	FString(const TCHAR* text) : string(text ? text : "") {}
+	FString(const std::string& text) : string(text) {}
+	FString(int32 length, const TCHAR* text) : string(text, length) {}
+
+	const TCHAR* operator*() const { return string.c_str(); }
+	const std::string& toStdString() const { return string; }
+
+	int32 Len() const { return int32(string.size()); }
+	bool IsEmpty() const { return string.empty(); }
+	void Empty() { string.clear(); }
+	TCHAR operator[](int32 index) const { return string[index]; }
+
+	FString& operator+=(const FString& other) { string += other.string; return *this; }
+	FString& operator+=(const TCHAR* other) { string += other; return *this; }
+	FString& operator+=(TCHAR other) { string += other; return *this; }
+	FString& AppendChar(TCHAR character) { string += character; return *this; }
+
+	friend FString operator+(const FString& a, const FString& b) { return FString(a.string + b.string); }
+	friend FString operator+(const FString& a, const TCHAR* b) { return FString(a.string + b); }
+	friend FString operator+(const TCHAR* a, const FString& b) { return FString(a + b.string); }
+
+	/** Joins path components with a single slash between them */
+	friend FString operator/(const FString& a, const FString& b)
+	{
+		if (a.IsEmpty() || a.string.back() == '/' || a.string.back() == '\\')
+		{
+			return a + b;
+		}
+		return a + "/" + b;
+	}
+	friend FString operator/(const FString& a, const TCHAR* b) { return a / FString(b); }
+
+	//The engine compares strings without case by default
+	friend bool operator==(const FString& a, const FString& b) { return a.Equals(b, ESearchCase::IgnoreCase); }
+	friend bool operator==(const FString& a, const TCHAR* b) { return a.Equals(FString(b), ESearchCase::IgnoreCase); }
+	friend bool operator!=(const FString& a, const FString& b) { return !(a == b); }
+	friend bool operator!=(const FString& a, const TCHAR* b) { return !(a == b); }
+	friend bool operator<(const FString& a, const FString& b) { return a.ToLower().string < b.ToLower().string; }
+
+	bool Equals(const FString& other, ESearchCase::Type searchCase = ESearchCase::CaseSensitive) const
+	{
+		return searchCase == ESearchCase::CaseSensitive ? string == other.string : ToLower().string == other.ToLower().string;
+	}
+
+	bool StartsWith(const FString& prefix, ESearchCase::Type searchCase = ESearchCase::IgnoreCase) const
+	{
+		return prefix.Len() <= Len() && Left(prefix.Len()).Equals(prefix, searchCase);
+	}
+
+	bool EndsWith(const FString& suffix, ESearchCase::Type searchCase = ESearchCase::IgnoreCase) const
+	{
+		return suffix.Len() <= Len() && Right(suffix.Len()).Equals(suffix, searchCase);
+	}
+
+	int32 Find(const FString& substring, ESearchCase::Type searchCase = ESearchCase::IgnoreCase) const
+	{
+		const std::string haystack = searchCase == ESearchCase::IgnoreCase ? ToLower().string : string;
+		const std::string needle = searchCase == ESearchCase::IgnoreCase ? substring.ToLower().string : substring.string;
+		const size_t found = haystack.find(needle);
+		return found == std::string::npos ? INDEX_NONE : int32(found);
+	}
+
+	bool Contains(const FString& substring, ESearchCase::Type searchCase = ESearchCase::IgnoreCase) const { return Find(substring, searchCase) != INDEX_NONE; }
+
+	FString Left(int32 count) const { return FString(string.substr(0, FMath::Clamp(count, 0, Len()))); }
+	FString Right(int32 count) const { return FString(string.substr(Len() - FMath::Clamp(count, 0, Len()))); }
+	FString Mid(int32 start, int32 count = MAX_int32) const { return start >= Len() ? FString() : FString(string.substr(start, count)); }
+	FString LeftChop(int32 count) const { return Left(Len() - count); }
+	FString RightChop(int32 count) const { return Right(Len() - count); }
+
+	FString ToLower() const
+	{
+		std::string lower = string;
+		std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return char(std::tolower(static_cast<unsigned char>(c))); });
+		return FString(lower);
+	}
+
+	FString Replace(const TCHAR* from, const TCHAR* to) const
+	{
+		std::string result = string;
+		const std::string fromString(from);
+		if (!fromString.empty())
+		{
+			for (size_t at = result.find(fromString); at != std::string::npos; at = result.find(fromString, at + std::strlen(to)))
+			{
+				result.replace(at, fromString.size(), to);
+			}
+		}
+		return FString(result);
+	}
+
+	int32 ParseIntoArray(TArray<FString>& outArray, const TCHAR* delimiter, bool cullEmpty = true) const
+	{
+		outArray.Reset();
+		const std::string delimiterString(delimiter);
+		size_t start = 0;
+		while (true)
+		{
+			const size_t at = string.find(delimiterString, start);
+			const std::string part = string.substr(start, at == std::string::npos ? std::string::npos : at - start);
+			if (!cullEmpty || !part.empty())
+			{
+				outArray.Add(FString(part));
+			}
+			if (at == std::string::npos)
+			{
+				break;
+			}
+			start = at + delimiterString.size();
+		}
+		return outArray.Num();
+	}
+
+	static FString Printf(const TCHAR* format, ...)
+	{
+		va_list arguments;
+		va_start(arguments, format);
+		va_list counting;
+		va_copy(counting, arguments);
+		const int size = std::vsnprintf(nullptr, 0, format, counting);
+		va_end(counting);
+		std::string result(size > 0 ? size : 0, '\0');
+		if (size > 0)
+		{
+			std::vsnprintf(&result[0], size + 1, format, arguments);
+		}
+		va_end(arguments);
+		return FString(result);
+	}
+
+	static FString FromInt(int32 value) { return Printf("%d", value); }
+
+	friend uint32 GetTypeHash(const FString& text) { return uint32(std::hash<std::string>()(text.ToLower().string)); }
+
+private:
+
+	std::string string;
+};
+
+inline uint32 GetTypeHash(int32 value) { return uint32(value); }
+inline uint32 GetTypeHash(uint32 value) { return value; }
+inline uint32 GetTypeHash(int64 value) { return uint32(value) ^ uint32(value >> 32); }
+inline uint32 GetTypeHash(uint64 value) { return uint32(value) ^ uint32(value >> 32); }
+inline uint32 GetTypeHash(const void* pointer) { return GetTypeHash(uint64(reinterpret_cast<uintptr_t>(pointer))); }
+
+/** The engine's mix of two hashes */
+inline uint32 HashCombine(uint32 a, uint32 c)
+{
+	uint32 b = 0x9e3779b9;
+	a += b;
+	a -= b; a -= c; a ^= (c >> 13);
+	b -= c; b -= a; b ^= (a << 8);
+	c -= a; c -= b; c ^= (b >> 13);
+	a -= b; a -= c; a ^= (c >> 12);
+	b -= c; b -= a; b ^= (a << 16);
+	c -= a; c -= b; c ^= (b >> 5);
+	a -= b; a -= c; a ^= (c >> 3);
+	b -= c; b -= a; b ^= (a << 10);
+	c -= a; c -= b; c ^= (b >> 15);
+	return c;
+}
+
+template <typename KeyType>
+struct TStandaloneKeyHash
+{
+	size_t operator()(const KeyType& key) const { return GetTypeHash(key); }
+};
+
+template <typename KeyType, typename ValueType>
+struct TPair
+{
+	KeyType Key;
+	ValueType Value;
+};
+
+/** TMap on top of the standard library's hash map. References to values stay valid as the map grows, as the engine's do until a rehash. */
+template <typename KeyType, typename ValueType>
+class TMap
+{
+	typedef std::unordered_map<KeyType, TPair<KeyType, ValueType>, TStandaloneKeyHash<KeyType>> FStorage;
+
+public:
+
+	int32 Num() const { return int32(storage.size()); }
+	void Empty() { storage.clear(); }
+	void Reset() { storage.clear(); }
+	void Reserve(int32 number) { storage.reserve(number); }
+
+	ValueType& Add(const KeyType& key, const ValueType& value)
+	{
+		TPair<KeyType, ValueType>& pair = storage[key];
+		pair.Key = key;
+		pair.Value = value;
+		return pair.Value;
+	}
+
+	ValueType& Add(const KeyType& key, ValueType&& value)
+	{
+		TPair<KeyType, ValueType>& pair = storage[key];
+		pair.Key = key;
+		pair.Value = std::move(value);
+		return pair.Value;
+	}
+
+	ValueType& FindOrAdd(const KeyType& key)
+	{
+		auto found = storage.find(key);
+		if (found == storage.end())
+		{
+			found = storage.emplace(key, TPair<KeyType, ValueType>{ key, ValueType() }).first;
+		}
+		return found->second.Value;
+	}
+
+	ValueType* Find(const KeyType& key)
+	{
+		auto found = storage.find(key);
+		return found == storage.end() ? nullptr : &found->second.Value;
+	}
+
+	const ValueType* Find(const KeyType& key) const
+	{
+		auto found = storage.find(key);
+		return found == storage.end() ? nullptr : &found->second.Value;
+	}
+
+	ValueType& FindChecked(const KeyType& key) { ValueType* value = Find(key); check(value); return *value; }
+	const ValueType& FindChecked(const KeyType& key) const { const ValueType* value = Find(key); check(value); return *value; }
+	ValueType FindRef(const KeyType& key) const { const ValueType* value = Find(key); return value ? *value : ValueType(); }
+	bool Contains(const KeyType& key) const { return storage.count(key) != 0; }
+	int32 Remove(const KeyType& key) { return int32(storage.erase(key)); }
+
+	template <typename Allocator> void GenerateKeyArray(TArray<KeyType>& outKeys) const { outKeys.Reset(); for (const auto& entry : storage) { outKeys.Add(entry.first); } }
+	void GenerateKeyArray(TArray<KeyType>& outKeys) const { outKeys.Reset(); for (const auto& entry : storage) { outKeys.Add(entry.first); } }
+	void GenerateValueArray(TArray<ValueType>& outValues) const { outValues.Reset(); for (const auto& entry : storage) { outValues.Add(entry.second.Value); } }
+
+	template <typename IteratorType, typename PairType>
+	class TRangedIterator
+	{
+	public:
+		TRangedIterator(IteratorType inIterator) : iterator(inIterator) {}
+		PairType& operator*() const { return iterator->second; }
+		PairType* operator->() const { return &iterator->second; }
+		TRangedIterator& operator++() { ++iterator; return *this; }
+		bool operator!=(const TRangedIterator& other) const { return iterator != other.iterator; }
+	private:
+		IteratorType iterator;
+	};
+
+	TRangedIterator<typename FStorage::iterator, TPair<KeyType, ValueType>> begin() { return storage.begin(); }
+	TRangedIterator<typename FStorage::iterator, TPair<KeyType, ValueType>> end() { return storage.end(); }
+	TRangedIterator<typename FStorage::const_iterator, const TPair<KeyType, ValueType>> begin() const { return storage.begin(); }
+	TRangedIterator<typename FStorage::const_iterator, const TPair<KeyType, ValueType>> end() const { return storage.end(); }
+
+	/** The engine's iterator, which can remove the entry it is on */
+	class TIterator
+	{
+	public:
+		TIterator(FStorage& inStorage) : storage(inStorage), iterator(inStorage.begin()) {}
+		explicit operator bool() const { return iterator != storage.end(); }
+		TIterator& operator++()
+		{
+			if (!removed)
+			{
+				++iterator;
+			}
+			removed = false;
+			return *this;
+		}
+		const KeyType& Key() const { return iterator->first; }
+		ValueType& Value() const { return iterator->second.Value; }
+		void RemoveCurrent() { iterator = storage.erase(iterator); removed = true; }
+	private:
+		FStorage& storage;
+		typename FStorage::iterator iterator;
+		bool removed = false;
+	};
+
+	TIterator CreateIterator() { return TIterator(storage); }
+
+private:
+
+	FStorage storage;
+};
+
+template <typename ElementType>
+class TSet
+{
+	typedef std::unordered_set<ElementType, TStandaloneKeyHash<ElementType>> FStorage;
+
+public:
+
+	TSet() {}
+	TSet(const TArray<ElementType>& elements) { for (const ElementType& element : elements) { Add(element); } }
+
+	void Add(const ElementType& element, bool* alreadyInSet = nullptr)
+	{
+		const bool added = storage.insert(element).second;
+		if (alreadyInSet)
+		{
+			*alreadyInSet = !added;
+		}
+	}
+
+	void Append(const TArray<ElementType>& elements) { for (const ElementType& element : elements) { Add(element); } }
+	bool Contains(const ElementType& element) const { return storage.count(element) != 0; }
+	int32 Remove(const ElementType& element) { return int32(storage.erase(element)); }
+	int32 Num() const { return int32(storage.size()); }
+	void Empty() { storage.clear(); }
+	void Reset() { storage.clear(); }
+
+	TArray<ElementType> Array() const
+	{
+		TArray<ElementType> result;
+		for (const ElementType& element : storage)
+		{
+			result.Add(element);
+		}
+		return result;
+	}
+
+	typename FStorage::const_iterator begin() const { return storage.begin(); }
+	typename FStorage::const_iterator end() const { return storage.end(); }
+
+private:
+
+	FStorage storage;
+};
+
+namespace ESPMode
+{
+	enum Type { Fast, ThreadSafe };
+}
+
+/** What MakeShareable() hands to the shared pointer types */
+template <typename ObjectType>
+struct TRawPtrProxy
+{
+	ObjectType* object;
+};
+
+template <typename ObjectType>
+TRawPtrProxy<ObjectType> MakeShareable(ObjectType* object) { return TRawPtrProxy<ObjectType>{ object }; }
+
+//The standard library's shared pointers are always thread safe, which covers both modes
+template <typename ObjectType, ESPMode::Type Mode = ESPMode::Fast> class TSharedRef;
+template <typename ObjectType, ESPMode::Type Mode = ESPMode::Fast> class TWeakPtr;
+
+template <typename ObjectType, ESPMode::Type Mode = ESPMode::Fast>
+class TSharedPtr
+{
+public:
+
+	TSharedPtr() {}
+	TSharedPtr(std::nullptr_t) {}
+	template <typename OtherType> TSharedPtr(TRawPtrProxy<OtherType> proxy) : pointer(proxy.object) {}
+	template <typename OtherType> TSharedPtr(const TSharedPtr<OtherType, Mode>& other) : pointer(other.pointer) {}
+	template <typename OtherType> TSharedPtr(const TSharedRef<OtherType, Mode>& other) : pointer(other.pointer) {}
+	explicit TSharedPtr(std::shared_ptr<ObjectType> inPointer) : pointer(std::move(inPointer)) {}
+
+	ObjectType* Get() const { return pointer.get(); }
+	ObjectType* operator->() const { return pointer.get(); }
+	ObjectType& operator*() const { return *pointer; }
+	bool IsValid() const { return pointer != nullptr; }
+	explicit operator bool() const { return IsValid(); }
+	void Reset() { pointer.reset(); }
+	int32 GetSharedReferenceCount() const { return int32(pointer.use_count()); }
+	bool IsUnique() const { return pointer.use_count() == 1; }
+	TSharedRef<ObjectType, Mode> ToSharedRef() const { check(IsValid()); return TSharedRef<ObjectType, Mode>(pointer); }
+
+	friend bool operator==(const TSharedPtr& a, const TSharedPtr& b) { return a.pointer == b.pointer; }
+	friend bool operator!=(const TSharedPtr& a, const TSharedPtr& b) { return a.pointer != b.pointer; }
+
+private:
+
+	template <typename, ESPMode::Type> friend class TSharedPtr;
+	template <typename, ESPMode::Type> friend class TSharedRef;
+	template <typename, ESPMode::Type> friend class TWeakPtr;
+
+	std::shared_ptr<ObjectType> pointer;
+};
+
+template <typename ObjectType, ESPMode::Type Mode>
+class TSharedRef
+{
+public:
+
+	template <typename OtherType> TSharedRef(TRawPtrProxy<OtherType> proxy) : pointer(proxy.object) { check(pointer); }
+	template <typename OtherType> TSharedRef(const TSharedRef<OtherType, Mode>& other) : pointer(other.pointer) {}
+	explicit TSharedRef(std::shared_ptr<ObjectType> inPointer) : pointer(std::move(inPointer)) { check(pointer); }
+
+	ObjectType& Get() const { return *pointer; }
+	ObjectType* operator->() const { return pointer.get(); }
+	ObjectType& operator*() const { return *pointer; }
+	int32 GetSharedReferenceCount() const { return int32(pointer.use_count()); }
+
+private:
+
+	template <typename, ESPMode::Type> friend class TSharedPtr;
+	template <typename, ESPMode::Type> friend class TSharedRef;
+	template <typename, ESPMode::Type> friend class TWeakPtr;
+
+	std::shared_ptr<ObjectType> pointer;
+};
+
+template <typename ObjectType, ESPMode::Type Mode>
+class TWeakPtr
+{
+public:
+
+	TWeakPtr() {}
+	template <typename OtherType> TWeakPtr(const TSharedPtr<OtherType, Mode>& other) : pointer(other.pointer) {}
+	template <typename OtherType> TWeakPtr(const TSharedRef<OtherType, Mode>& other) : pointer(other.pointer) {}
+
+	TSharedPtr<ObjectType, Mode> Pin() const { return TSharedPtr<ObjectType, Mode>(pointer.lock()); }
+	bool IsValid() const { return !pointer.expired(); }
+	void Reset() { pointer.reset(); }
+
+private:
+
+	std::weak_ptr<ObjectType> pointer;
+};
+
+template <typename ObjectType, typename... ArgsType>
+TSharedRef<ObjectType> MakeShared(ArgsType&&... args) { return TSharedRef<ObjectType>(std::make_shared<ObjectType>(std::forward<ArgsType>(args)...)); }
+
+template <typename FunctionType>
+using TFunction = std::function<FunctionType>;
+
+struct FVector
+{
+	float X, Y, Z;
+
+	FVector() {}
+	explicit FVector(float value) : X(value), Y(value), Z(value) {}
+	FVector(float x, float y, float z) : X(x), Y(y), Z(z) {}
+
+	static const FVector ZeroVector;
+	static const FVector OneVector;
+	static const FVector UpVector;
+
+	float& operator[](int32 index) { return (&X)[index]; }
+	float operator[](int32 index) const { return (&X)[index]; }
+
+	FVector operator+(const FVector& other) const { return FVector(X + other.X, Y + other.Y, Z + other.Z); }
+	FVector operator-(const FVector& other) const { return FVector(X - other.X, Y - other.Y, Z - other.Z); }
+	FVector operator+(float bias) const { return FVector(X + bias, Y + bias, Z + bias); }
+	FVector operator-(float bias) const { return FVector(X - bias, Y - bias, Z - bias); }
+	FVector operator*(const FVector& other) const { return FVector(X * other.X, Y * other.Y, Z * other.Z); }
+	FVector operator*(float scale) const { return FVector(X * scale, Y * scale, Z * scale); }
+	FVector operator/(float scale) const { return FVector(X / scale, Y / scale, Z / scale); }
+	FVector operator-() const { return FVector(-X, -Y, -Z); }
+	FVector& operator+=(const FVector& other) { X += other.X; Y += other.Y; Z += other.Z; return *this; }
+	FVector& operator-=(const FVector& other) { X -= other.X; Y -= other.Y; Z -= other.Z; return *this; }
+	FVector& operator*=(float scale) { X *= scale; Y *= scale; Z *= scale; return *this; }
+	FVector& operator/=(float scale) { X /= scale; Y /= scale; Z /= scale; return *this; }
+	friend FVector operator*(float scale, const FVector& vector) { return vector * scale; }
+
+	/** Cross product */
+	FVector operator^(const FVector& other) const { return FVector(Y * other.Z - Z * other.Y, Z * other.X - X * other.Z, X * other.Y - Y * other.X); }
+	/** Dot product */
+	float operator|(const FVector& other) const { return X * other.X + Y * other.Y + Z * other.Z; }
+
+	bool operator==(const FVector& other) const { return X == other.X && Y == other.Y && Z == other.Z; }
+	bool operator!=(const FVector& other) const { return !(*this == other); }
+
+	float Size() const { return FMath::Sqrt(SizeSquared()); }
+	float SizeSquared() const { return X * X + Y * Y + Z * Z; }
+	float GetMax() const { return FMath::Max(FMath::Max(X, Y), Z); }
+	float GetMin() const { return FMath::Min(FMath::Min(X, Y), Z); }
+	FVector GetAbs() const { return FVector(FMath::Abs(X), FMath::Abs(Y), FMath::Abs(Z)); }
+	FVector ComponentMax(const FVector& other) const { return FVector(FMath::Max(X, other.X), FMath::Max(Y, other.Y), FMath::Max(Z, other.Z)); }
+	bool ContainsNaN() const { return !FMath::IsFinite(X) || !FMath::IsFinite(Y) || !FMath::IsFinite(Z); }
+
+	FVector GetSafeNormal(float tolerance = 1.e-8f) const
+	{
+		const float squareSum = SizeSquared();
+		return squareSum > tolerance ? *this * FMath::InvSqrt(squareSum) : ZeroVector;
+	}
+
+	static float DotProduct(const FVector& a, const FVector& b) { return a | b; }
+	static FVector CrossProduct(const FVector& a, const FVector& b) { return a ^ b; }
+	static float Dist(const FVector& a, const FVector& b) { return (a - b).Size(); }
+	static float DistSquared(const FVector& a, const FVector& b) { return (a - b).SizeSquared(); }
+};
+
+inline const FVector FVector::ZeroVector(0.0f, 0.0f, 0.0f);
+inline const FVector FVector::OneVector(1.0f, 1.0f, 1.0f);
+inline const FVector FVector::UpVector(0.0f, 0.0f, 1.0f);
+
+struct FVector2D
+{
+	float X, Y;
+
+	FVector2D() {}
+	FVector2D(float x, float y) : X(x), Y(y) {}
+	void Set(float x, float y) { X = x; Y = y; }
+	float Size() const { return FMath::Sqrt(X * X + Y * Y); }
+};
+
+struct FVector4
+{
+	float X, Y, Z, W;
+};
+
+struct FIntVector
+{
+	int32 X, Y, Z;
+
+	FIntVector() {}
+	explicit FIntVector(int32 value) : X(value), Y(value), Z(value) {}
+	FIntVector(int32 x, int32 y, int32 z) : X(x), Y(y), Z(z) {}
+
+	static const FIntVector ZeroValue;
+
+	int32& operator[](int32 index) { return (&X)[index]; }
+	int32 operator[](int32 index) const { return (&X)[index]; }
+	FIntVector operator+(const FIntVector& other) const { return FIntVector(X + other.X, Y + other.Y, Z + other.Z); }
+	FIntVector operator-(const FIntVector& other) const { return FIntVector(X - other.X, Y - other.Y, Z - other.Z); }
+	FIntVector operator*(int32 scale) const { return FIntVector(X * scale, Y * scale, Z * scale); }
+	bool operator==(const FIntVector& other) const { return X == other.X && Y == other.Y && Z == other.Z; }
+	bool operator!=(const FIntVector& other) const { return !(*this == other); }
+
+	FString ToString() const { return FString::Printf(TEXT("X=%d Y=%d Z=%d"), X, Y, Z); }
+
+	friend uint32 GetTypeHash(const FIntVector& vector) { return uint32(vector.X) * 73856093u ^ uint32(vector.Y) * 19349663u ^ uint32(vector.Z) * 83492791u; }
+};
+
+inline const FIntVector FIntVector::ZeroValue(0, 0, 0);
+
+struct FLinearColor
+{
+	float R, G, B, A;
+
+	FLinearColor() {}
+	FLinearColor(float r, float g, float b, float a = 1.0f) : R(r), G(g), B(b), A(a) {}
+	FLinearColor(const FVector& vector) : R(vector.X), G(vector.Y), B(vector.Z), A(1.0f) {}
+};
+
+/** Laid out B, G, R, A as the engine's is on little-endian platforms, which the packed faces shader relies on */
+struct FColor
+{
+	uint8 B, G, R, A;
+
+	FColor() {}
+	FColor(uint8 r, uint8 g, uint8 b, uint8 a = 255) : B(b), G(g), R(r), A(a) {}
+	explicit FColor(uint32 color) { FMemory::Memcpy(this, &color, sizeof(color)); }
+	FColor(const FLinearColor& color)
+		: B(uint8(FMath::Clamp(FMath::RoundToInt(color.B * 255.0f), 0, 255)))
+		, G(uint8(FMath::Clamp(FMath::RoundToInt(color.G * 255.0f), 0, 255)))
+		, R(uint8(FMath::Clamp(FMath::RoundToInt(color.R * 255.0f), 0, 255)))
+		, A(uint8(FMath::Clamp(FMath::RoundToInt(color.A * 255.0f), 0, 255)))
+	{}
+
+	uint32 DWColor() const { uint32 color; FMemory::Memcpy(&color, this, sizeof(color)); return color; }
+	static const FColor White;
+
+	bool operator==(const FColor& other) const { return DWColor() == other.DWColor(); }
+	bool operator!=(const FColor& other) const { return !(*this == other); }
+
+	friend uint32 GetTypeHash(const FColor& color) { return color.DWColor(); }
+};
+
+inline const FColor FColor::White(255, 255, 255);
+
+/** A unit vector in four bytes, as the engine packs tangents */
+struct FPackedNormal
+{
+	uint8 X, Y, Z, W;
+
+	FPackedNormal() : X(128), Y(128), Z(128), W(128) {}
+	FPackedNormal(const FVector& vector) : X(pack(vector.X)), Y(pack(vector.Y)), Z(pack(vector.Z)), W(128) {}
+
+	operator FVector() const { return FVector(unpack(X), unpack(Y), unpack(Z)); }
+
+private:
+
+	static uint8 pack(float value) { return uint8(FMath::Clamp(FMath::TruncToInt(value * 127.5f + 127.5f), 0, 255)); }
+	static float unpack(uint8 value) { return value / 127.5f - 1.0f; }
+};
+
+struct FSHAHash
+{
+	uint8 Hash[20];
+
+	bool operator==(const FSHAHash& other) const { return FMemory::Memcmp(Hash, other.Hash, sizeof(Hash)) == 0; }
+	bool operator!=(const FSHAHash& other) const { return !(*this == other); }
+};
+
+class FSHA1
+{
+public:
+
+	FSHA1();
+	void Update(const uint8* data, uint64 size);
+	void Final();
+	void GetHash(uint8* outHash) const;
+
+	static void HashBuffer(const void* data, uint64 size, uint8* outHash);
+
+private:
+
+	void transform(const uint8* block);
+
+	uint32 state[5];
+	uint64 length;
+	uint8 buffer[64];
+	uint32 buffered;
+	uint8 digest[20];
+};
+
+class FMD5
+{
+public:
+
+	/** Lower case hex, as the engine gives */
+	static FString HashAnsiString(const TCHAR* text);
+};
+
+struct FGuid
+{
+	uint32 A, B, C, D;
+
+	FGuid() : A(0), B(0), C(0), D(0) {}
+	FGuid(uint32 a, uint32 b, uint32 c, uint32 d) : A(a), B(b), C(c), D(d) {}
+
+	bool IsValid() const { return (A | B | C | D) != 0; }
+	FString ToString() const { return FString::Printf("%08X%08X%08X%08X", A, B, C, D); }
+	bool operator==(const FGuid& other) const { return A == other.A && B == other.B && C == other.C && D == other.D; }
+	bool operator!=(const FGuid& other) const { return !(*this == other); }
+
+	friend uint32 GetTypeHash(const FGuid& guid) { return guid.A ^ guid.B ^ guid.C ^ guid.D; }
+};
+
+struct FCrc
+{
+	static uint32 MemCrc32(const void* data, int32 length, uint32 crc = 0);
+};
+
+/** Upper case hex, as the engine gives */
+FString BytesToHex(const uint8* bytes, int32 count);
+
+/** The same generator as the engine's, so a seed gives the same sequence */
+class FRandomStream
+{
+public:
+
+	FRandomStream() : initialSeed(0), seed(0) {}
+	FRandomStream(int32 inSeed) { Initialize(inSeed); }
+
+	void Initialize(int32 inSeed) { initialSeed = inSeed; seed = uint32(inSeed); }
+	void Reset() { seed = uint32(initialSeed); }
+	int32 GetInitialSeed() const { return initialSeed; }
+
+	float GetFraction()
+	{
+		seed = seed * 196314165u + 907633515u;
+		const uint32 bits = 0x3F800000u | (seed >> 9);
+		float result;
+		FMemory::Memcpy(&result, &bits, sizeof(result));
+		return result - 1.0f;
+	}
+
+	float FRand() { return GetFraction(); }
+	int32 RandHelper(int32 range) { return range > 0 ? FMath::TruncToInt(GetFraction() * range) : 0; }
+	int32 RandRange(int32 lower, int32 upper) { return lower + RandHelper(upper - lower + 1); }
+	float FRandRange(float lower, float upper) { return lower + (upper - lower) * FRand(); }
+
+private:
+
+	int32 initialSeed;
+	uint32 seed;
+};
+
+struct FPlatformTime
+{
+	static double Seconds() { return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+};
+
+struct FPlatformProcess
+{
+	static void Sleep(float seconds);
+};
+
+struct FPlatformTLS
+{
+	static uint32 GetCurrentThreadId();
+};
+
+class FThreadSafeCounter
+{
+public:
+
+	FThreadSafeCounter() : counter(0) {}
+	FThreadSafeCounter(int32 value) : counter(value) {}
+
+	int32 Increment() { return ++counter; }
+	int32 Decrement() { return --counter; }
+	int32 Add(int32 amount) { return counter.fetch_add(amount); }
+	int32 Subtract(int32 amount) { return counter.fetch_sub(amount); }
+	int32 Set(int32 value) { return counter.exchange(value); }
+	int32 Reset() { return counter.exchange(0); }
+	int32 GetValue() const { return counter.load(); }
+
+private:
+
+	std::atomic<int32> counter;
+};
+
+struct FTimespan
+{
+	std::chrono::duration<double> duration;
+
+	static FTimespan FromDays(double days) { return FTimespan{ std::chrono::duration<double>(days * 86400.0) }; }
+	static FTimespan FromSeconds(double seconds) { return FTimespan{ std::chrono::duration<double>(seconds) }; }
+};
+
+/** Held as a file time so it compares with file timestamps directly */
+struct FDateTime
+{
+	std::filesystem::file_time_type time;
+
+	static FDateTime UtcNow() { return FDateTime{ std::filesystem::file_time_type::clock::now() }; }
+	static FDateTime Now() { return UtcNow(); }
+	static FDateTime MinValue() { return FDateTime{ std::filesystem::file_time_type::min() }; }
+
+	FDateTime operator-(const FTimespan& span) const { return FDateTime{ time - std::chrono::duration_cast<std::filesystem::file_time_type::duration>(span.duration) }; }
+	bool operator<(const FDateTime& other) const { return time < other.time; }
+	bool operator>(const FDateTime& other) const { return time > other.time; }
+	bool operator==(const FDateTime& other) const { return time == other.time; }
+	FString ToString() const;
+};
+
+enum EFileRead
+{
+	FILEREAD_None = 0x00,
+	FILEREAD_NoFail = 0x01,
+	FILEREAD_Silent = 0x02,
+};
+
+template <typename T> inline T Align(T value, uint64 alignment) { return T((uint64(value) + alignment - 1) & ~(alignment - 1)); }
+
+enum ECompressionFlags
+{
+	COMPRESS_None = 0x00,
+	COMPRESS_ZLIB = 0x01,
+	COMPRESS_GZIP = 0x02,
+	COMPRESS_BiasMemory = 0x10,
+	COMPRESS_BiasSpeed = 0x20,
+};
+
+/** zlib whatever the flags ask for, as that is all the plugin uses */
+struct FCompression
+{
+	static int32 CompressMemoryBound(ECompressionFlags flags, int32 uncompressedSize);
+	static bool CompressMemory(ECompressionFlags flags, void* compressedBuffer, int32& compressedSize, const void* uncompressedBuffer, int32 uncompressedSize);
+	/** false unless the data uncompresses to exactly uncompressedSize */
+	static bool UncompressMemory(ECompressionFlags flags, void* uncompressedBuffer, int32 uncompressedSize, const void* compressedBuffer, int32 compressedSize);
+};
+
+/** Serialize() one way or the other, with the byte-level calls the plugin makes */
+class FArchive
+{
+public:
+
+	virtual ~FArchive() {}
+
+	virtual void Serialize(void* data, int64 length) = 0;
+	virtual void SerializeBits(void* data, int64 lengthBits);
+	virtual int64 Tell() { return 0; }
+	virtual int64 TotalSize() { return -1; }
+	virtual void Seek(int64 position) {}
+	virtual bool Close() { return !ArIsError; }
+
+	/** Seven bits a byte, as the engine packs them */
+	void SerializeIntPacked(uint32& value);
+
+	/**
+	 * One zlib block with its sizes in front, rather than the engine's chunked layout, so blobs don't move between the two.
+	 * A block which doesn't uncompress to `length` sets the error flag.
+	 */
+	void SerializeCompressed(void* data, int64 length, ECompressionFlags flags);
+
+	bool IsLoading() const { return ArIsLoading; }
+	bool IsSaving() const { return ArIsSaving; }
+	bool IsError() const { return ArIsError; }
+	void SetError() { ArIsError = true; }
+
+protected:
+
+	bool ArIsLoading = false;
+	bool ArIsSaving = false;
+	bool ArIsError = false;
+};
+
+template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type>
+inline FArchive& operator<<(FArchive& ar, T& value)
+{
+	ar.Serialize(&value, sizeof(value));
+	return ar;
+}
+
+inline FArchive& operator<<(FArchive& ar, FVector& vector) { return ar << vector.X << vector.Y << vector.Z; }
+inline FArchive& operator<<(FArchive& ar, FIntVector& vector) { return ar << vector.X << vector.Y << vector.Z; }
+inline FArchive& operator<<(FArchive& ar, FColor& color) { ar.Serialize(&color, sizeof(color)); return ar; }
+
+template <typename ElementType>
+FArchive& operator<<(FArchive& ar, TArray<ElementType>& array)
+{
+	int32 count = array.Num();
+	ar << count;
+	if (ar.IsLoading())
+	{
+		if (count < 0 || ar.IsError())
+		{
+			ar.SetError();
+			array.Empty();
+			return ar;
+		}
+		array.SetNum(count);
+	}
+	for (int32 i = 0; i < count && !ar.IsError(); ++i)
+	{
+		ar << array[i];
+	}
+	return ar;
+}
+
+/** Appends to an array, or overwrites it from the current offset */
+class FMemoryWriter : public FArchive
+{
+public:
+
+	FMemoryWriter(TArray<uint8>& inBytes, bool isPersistent = false, bool setOffset = false)
+		: bytes(inBytes)
+		, offset(setOffset ? inBytes.Num() : 0)
+	{
+		ArIsSaving = true;
+	}
+
+	virtual void Serialize(void* data, int64 length) override
+	{
+		if (offset + length > bytes.Num())
+		{
+			bytes.SetNumUninitialized(int32(offset + length));
+		}
+		FMemory::Memcpy(bytes.GetData() + offset, data, SIZE_T(length));
+		offset += length;
+	}
+
+	virtual int64 Tell() override { return offset; }
+	virtual int64 TotalSize() override { return bytes.Num(); }
+	virtual void Seek(int64 position) override { offset = position; }
+
+private:
+
+	TArray<uint8>& bytes;
+	int64 offset;
+};
+
+/** Reading past the end sets the error flag and leaves the destination alone */
+class FMemoryReader : public FArchive
+{
+public:
+
+	FMemoryReader(const TArray<uint8>& inBytes, bool isPersistent = false)
+		: bytes(inBytes)
+	{
+		ArIsLoading = true;
+	}
+
+	virtual void Serialize(void* data, int64 length) override
+	{
+		if (length <= 0 || ArIsError)
+		{
+			return;
+		}
+		if (length > bytes.Num() - offset)
+		{
+			ArIsError = true;
+			return;
+		}
+		FMemory::Memcpy(data, bytes.GetData() + offset, SIZE_T(length));
+		offset += length;
+	}
+
+	virtual int64 Tell() override { return offset; }
+	virtual int64 TotalSize() override { return bytes.Num(); }
+	virtual void Seek(int64 position) override { offset = position; }
+
+private:
+
+	const TArray<uint8>& bytes;
+	int64 offset = 0;
+};
+
+/** Bits packed from the bottom of each byte up, as the engine packs them */
+class FBitWriter : public FArchive
+{
+public:
+
+	FBitWriter(int64 inMaxBits = 0, bool inAllowResize = false);
+
+	virtual void Serialize(void* data, int64 length) override { SerializeBits(data, length * 8); }
+	virtual void SerializeBits(void* data, int64 lengthBits) override;
+
+	/** In as many bits as valueMax - 1 needs */
+	void WriteInt(uint32 value, uint32 valueMax);
+	void WriteBit(uint8 bit);
+
+	uint8* GetData() { return buffer.GetData(); }
+	const uint8* GetData() const { return buffer.GetData(); }
+	int64 GetNumBytes() const { return (num + 7) >> 3; }
+	int64 GetNumBits() const { return num; }
+
+private:
+
+	friend class FBitWriterMark;
+
+	//Makes room for more bits, or sets the error flag if there isn't any
+	bool allowAppend(int64 lengthBits);
+
+	TArray<uint8> buffer;
+	int64 num = 0;
+	int64 maxBits;
+	bool allowResize;
+};
+
+/** Where a bit writer had got to, so that what was written after can be taken back out */
+class FBitWriterMark
+{
+public:
+
+	FBitWriterMark(FBitWriter& writer) : overflowed(writer.ArIsError), num(writer.num) {}
+
+	void Pop(FBitWriter& writer);
+
+private:
+
+	bool overflowed;
+	int64 num;
+};
+
+/** Reading past the end sets the error flag and gives zeroes */
+class FBitReader : public FArchive
+{
+public:
+
+	FBitReader(uint8* src = nullptr, int64 countBits = 0);
+
+	virtual void Serialize(void* data, int64 length) override { SerializeBits(data, length * 8); }
+	virtual void SerializeBits(void* data, int64 lengthBits) override;
+
+	uint32 ReadInt(uint32 valueMax);
+	uint8 ReadBit();
+
+	int64 GetBitsLeft() const { return num - pos; }
+	int64 GetNumBits() const { return num; }
+	int64 GetPosBits() const { return pos; }
+
+private:
+
+	TArray<uint8> buffer;
+	int64 num;
+	int64 pos = 0;
+};
+
+/** Only what one bit per element needs */
+template <typename Allocator = void>
+class TBitArray
+{
+public:
+
+	explicit TBitArray(bool value = false, int32 count = 0) : bits(size_t(count), value) {}
+
+	std::vector<bool>::reference operator[](int32 index) { return bits[index]; }
+	bool operator[](int32 index) const { return bits[index]; }
+	int32 Num() const { return int32(bits.size()); }
+
+private:
+
+	std::vector<bool> bits;
+};
+
+/** What UnrealHeaderTool reads. It isn't run, so they expand to nothing. */
+#define UENUM(...)
+#define USTRUCT(...)
+#define UCLASS(...)
+#define UPROPERTY(...)
+#define UFUNCTION(...)
+#define GENERATED_USTRUCT_BODY()
+
+class UPackageMap;
+
+struct TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithNetSerializer = false,
+	};
+};
+
+template <typename StructType>
+struct TStructOpsTypeTraits : public TStructOpsTypeTraitsBase
+{
+};
+
+#define MS_ALIGN(n) alignas(n)
+#define GCC_ALIGN(n)
+
+/** The engine's vector maths on four floats, without the intrinsics */
+struct VectorRegister
+{
+	float V[4];
+};
+
+inline VectorRegister MakeVectorRegister(float x, float y, float z, float w) { return VectorRegister{ { x, y, z, w } }; }
+inline VectorRegister VectorZero() { return MakeVectorRegister(0.0f, 0.0f, 0.0f, 0.0f); }
+inline VectorRegister VectorSetFloat1(float value) { return MakeVectorRegister(value, value, value, value); }
+inline VectorRegister VectorLoadAligned(const float* src) { return MakeVectorRegister(src[0], src[1], src[2], src[3]); }
+inline void VectorStoreAligned(const VectorRegister& vector, float* dest) { FMemory::Memcpy(dest, vector.V, sizeof(vector.V)); }
+inline VectorRegister VectorAdd(const VectorRegister& a, const VectorRegister& b) { return MakeVectorRegister(a.V[0] + b.V[0], a.V[1] + b.V[1], a.V[2] + b.V[2], a.V[3] + b.V[3]); }
+inline VectorRegister VectorSubtract(const VectorRegister& a, const VectorRegister& b) { return MakeVectorRegister(a.V[0] - b.V[0], a.V[1] - b.V[1], a.V[2] - b.V[2], a.V[3] - b.V[3]); }
+inline VectorRegister VectorMultiply(const VectorRegister& a, const VectorRegister& b) { return MakeVectorRegister(a.V[0] * b.V[0], a.V[1] * b.V[1], a.V[2] * b.V[2], a.V[3] * b.V[3]); }
+/** a * b + c */
+inline VectorRegister VectorMultiplyAdd(const VectorRegister& a, const VectorRegister& b, const VectorRegister& c) { return VectorAdd(VectorMultiply(a, b), c); }
+
+class IFileManager
+{
+public:
+
+	static IFileManager& Get();
+
+	/** nullptr if the file can't be opened. The caller deletes what it gets. */
+	FArchive* CreateFileReader(const TCHAR* path, uint32 readFlags = 0);
+	FArchive* CreateFileWriter(const TCHAR* path, uint32 writeFlags = 0);
+
+	void FindFiles(TArray<FString>& outFileNames, const TCHAR* wildcardPath, bool files, bool directories);
+	int64 FileSize(const TCHAR* path);
+	FDateTime GetTimeStamp(const TCHAR* path);
+	bool SetTimeStamp(const TCHAR* path, FDateTime timeStamp);
+	bool FileExists(const TCHAR* path);
+	bool DirectoryExists(const TCHAR* path);
+	bool Delete(const TCHAR* path, bool requireExists = false, bool evenReadOnly = false, bool quiet = false);
+	bool Move(const TCHAR* destination, const TCHAR* source, bool replace = true, bool evenIfReadOnly = false, bool attributes = false, bool doNotRetryOrError = false);
+	bool MakeDirectory(const TCHAR* path, bool tree = false);
+	bool DeleteDirectory(const TCHAR* path, bool requireExists = false, bool tree = false);
+};
+
+struct FFileHelper
+{
+	static bool LoadFileToArray(TArray<uint8>& result, const TCHAR* path, uint32 flags = 0);
+	/** Makes the directories the file goes in, as the engine's file writer does */
+	static bool SaveArrayToFile(const TArray<uint8>& bytes, const TCHAR* path);
+	static bool LoadFileToString(FString& result, const TCHAR* path);
+	static bool SaveStringToFile(const FString& text, const TCHAR* path);
+};
+
+struct FPaths
+{
+	/** Saved/ under the working directory, or $CUBIQUITY_SAVED_DIR */
+	static FString GameSavedDir();
+	static FString ProfilingDir() { return GameSavedDir() / TEXT("Profiling/"); }
+	static FString ConvertRelativePathToFull(const FString& path);
+	static bool FileExists(const FString& path) { return IFileManager::Get().FileExists(*path); }
+	static FString GetPath(const FString& path);
+	static FString GetCleanFilename(const FString& path);
+	static FString CreateTempFilename(const TCHAR* path, const TCHAR* prefix, const TCHAR* extension);
+};
+
+struct FParse
+{
+	static bool Value(const TCHAR* stream, const TCHAR* match, FString& value);
+	static bool Value(const TCHAR* stream, const TCHAR* match, int32& value);
+	static bool Value(const TCHAR* stream, const TCHAR* match, uint32& value);
+	static bool Value(const TCHAR* stream, const TCHAR* match, float& value);
+	static bool Param(const TCHAR* stream, const TCHAR* param);
+};
+
+namespace ELogVerbosity
+{
+	enum Type { NoLogging, Fatal, Error, Warning, Display, Log, Verbose, VeryVerbose };
+}
+
+struct FStandaloneLog
+{
+	/** Verbose and VeryVerbose are dropped, Fatal aborts */
+	static void log(ELogVerbosity::Type verbosity, const char* category, const TCHAR* format, ...);
+};
+
+#define DECLARE_LOG_CATEGORY_EXTERN(CategoryName, DefaultVerbosity, CompileTimeVerbosity) struct FLogCategory##CategoryName { static const char* name() { return #CategoryName; } }
+#define DEFINE_LOG_CATEGORY(CategoryName)
+#define UE_LOG(CategoryName, Verbosity, Format, ...) FStandaloneLog::log(ELogVerbosity::Verbosity, FLogCategory##CategoryName::name(), Format, ##__VA_ARGS__)
+
+DECLARE_LOG_CATEGORY_EXTERN(Standalone, Log, All);
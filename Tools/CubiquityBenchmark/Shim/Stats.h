@@ -0,0 +1,25 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "StandaloneCore.h"
+
+//No stats system here: the harness measures what it reports itself, so this builds as UE does with STATS=0
+#define STATS 0
+
+#define DECLARE_STATS_GROUP(GroupDesc, GroupId, GroupCat)
+#define DECLARE_CYCLE_STAT_EXTERN(CounterName, StatId, GroupId, API)
+#define DECLARE_DWORD_COUNTER_STAT_EXTERN(CounterName, StatId, GroupId, API)
+#define DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(CounterName, StatId, GroupId, API)
+#define DECLARE_FLOAT_ACCUMULATOR_STAT_EXTERN(CounterName, StatId, GroupId, API)
+#define DECLARE_MEMORY_STAT_EXTERN(CounterName, StatId, GroupId, API)
+#define SCOPE_CYCLE_COUNTER(StatId)
+#define INC_DWORD_STAT(StatId)
+#define DEC_DWORD_STAT(StatId)
+#define INC_DWORD_STAT_BY(StatId, Amount)
+#define DEC_DWORD_STAT_BY(StatId, Amount)
+#define SET_DWORD_STAT(StatId, Value)
+#define SET_FLOAT_STAT(StatId, Value)
+#define INC_MEMORY_STAT_BY(StatId, Amount)
+#define DEC_MEMORY_STAT_BY(StatId, Amount)
+#define SET_MEMORY_STAT(StatId, Value)
@@ -0,0 +1,20 @@
+// Copyright 2014 Volumes of Fun. All Rights Reserved.
+
+#pragma once
+
+#include "StandaloneCore.h"
+
+class FThreadSafeBool
+{
+public:
+
+	FThreadSafeBool(bool value = false) : flag(value) {}
+
+	operator bool() const { return flag.load(); }
+	bool operator=(bool value) { flag.store(value); return value; }
+	bool AtomicSet(bool value) { return flag.exchange(value); }
+
+private:
+
+	std::atomic<bool> flag;
+};